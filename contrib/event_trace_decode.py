@@ -0,0 +1,175 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+"""
+Decoder of the binary files written by the OpenOCD 'event_trace' command.
+
+Prints one line per event:
+    time_us subsystem event arguments [data]
+
+Usage:
+    event_trace_decode.py [--subsys name[,name...]] [--raw] trace.bin
+"""
+
+import argparse
+import struct
+import sys
+
+FILE_MAGIC = b'OOCDEVTR'
+FILE_HDR = struct.Struct('<8sIIQ')
+RECORD_HDR = struct.Struct('<QHBBI')
+
+SUBSYS = {0: 'jtag', 1: 'dap', 2: 'cmsis-dap'}
+
+TAP_STATES = [
+    'DREXIT2', 'DREXIT1', 'DRSHIFT', 'DRPAUSE', 'IRSELECT', 'DRUPDATE',
+    'DRCAPTURE', 'DRSELECT', 'IREXIT2', 'IREXIT1', 'IRSHIFT', 'IRPAUSE',
+    'IDLE', 'IRUPDATE', 'IRCAPTURE', 'RESET',
+]
+
+DAP_STAGES = ['LOG', 'ERR', 'PND', 'FND', 'LST', 'REP', 'REC']
+DAP_ACKS = {1: 'WAIT', 2: 'OK/FAULT', 4: 'OK'}
+
+# CMSIS-DAP command ids, for the packet dumps
+CMSIS_DAP_CMDS = {
+    0x00: 'INFO', 0x01: 'LED', 0x02: 'CONNECT', 0x03: 'DISCONNECT',
+    0x04: 'TFER_CONFIGURE', 0x05: 'TFER', 0x06: 'TFER_BLOCK',
+    0x07: 'TFER_ABORT', 0x08: 'WRITE_ABORT', 0x09: 'DELAY',
+    0x0a: 'RESET_TARGET', 0x10: 'SWJ_PINS', 0x11: 'SWJ_CLOCK',
+    0x12: 'SWJ_SEQ', 0x13: 'SWD_CONFIGURE', 0x14: 'JTAG_SEQ',
+    0x15: 'JTAG_CONFIGURE', 0x16: 'JTAG_IDCODE', 0x17: 'SWO_TRANSPORT',
+    0x18: 'SWO_MODE', 0x19: 'SWO_BAUDRATE', 0x1a: 'SWO_CONTROL',
+    0x1b: 'SWO_STATUS', 0x1c: 'SWO_DATA', 0x1d: 'SWD_SEQUENCE',
+    0x1e: 'SWO_EX_STATUS', 0x7f: 'EXECUTE_COMMANDS',
+}
+
+
+def tap_state(state):
+    if state < len(TAP_STATES):
+        return TAP_STATES[state]
+    return 'state%d' % state
+
+
+def bits_hex(data, num_bits):
+    value = int.from_bytes(data[:(num_bits + 7) // 8], 'little')
+    return '%db:0x%x' % (num_bits, value)
+
+
+def fmt_jtag_scan(args, data):
+    return '%s scan to %s, %d fields, %d bits' % (
+        'IR' if args[0] else 'DR', tap_state(args[1]), args[2], args[3])
+
+
+def fmt_jtag_out(args, data):
+    return 'out ' + bits_hex(data, args[0])
+
+
+def fmt_jtag_in(args, data):
+    return 'in  ' + bits_hex(data, args[0])
+
+
+def fmt_jtag_runtest(args, data):
+    return 'runtest %d cycles to %s' % (args[0], tap_state(args[1]))
+
+
+def fmt_jtag_reset(args, data):
+    return 'reset trst=%d srst=%d' % (args[0], args[1])
+
+
+def fmt_jtag_tlr_reset(args, data):
+    return 'tlr reset to %s' % tap_state(args[0])
+
+
+def fmt_dap_cmd(args, data):
+    stage, instr, reg, rnw, out, inv, ack = args
+    return '%s %s reg 0x%03x %-5s out 0x%08x in 0x%08x %s' % (
+        DAP_STAGES[stage] if stage < len(DAP_STAGES) else stage,
+        'AP' if instr == 0xfb else 'DP', reg,
+        'READ' if rnw else 'WRITE', out, inv,
+        DAP_ACKS.get(ack, 'INVAL(%x)' % ack))
+
+
+def fmt_cmsis_packet(direction):
+    def fmt(args, data):
+        name = CMSIS_DAP_CMDS.get(data[0], '0x%02x' % data[0]) if data else '-'
+        return '%s %s (%d bytes): %s' % (direction, name, len(data), data.hex(' '))
+    return fmt
+
+
+EVENTS = {
+    0x0100: fmt_jtag_scan,
+    0x0101: fmt_jtag_out,
+    0x0102: fmt_jtag_in,
+    0x0103: fmt_jtag_runtest,
+    0x0104: fmt_jtag_reset,
+    0x0105: fmt_jtag_tlr_reset,
+    0x0200: fmt_dap_cmd,
+    0x0300: fmt_cmsis_packet('cmd'),
+    0x0301: fmt_cmsis_packet('rsp'),
+}
+
+
+def fmt_raw(args, data):
+    text = ' '.join('0x%x' % a for a in args)
+    if data:
+        text += ' [' + data.hex(' ') + ']'
+    return text
+
+
+def decode(f, subsystems, raw, out):
+    hdr = f.read(FILE_HDR.size)
+    if len(hdr) != FILE_HDR.size:
+        raise ValueError('file too short')
+    magic, version, mask, start_us = FILE_HDR.unpack(hdr)
+    if magic != FILE_MAGIC:
+        raise ValueError('not an event trace file')
+    if version != 1:
+        raise ValueError('unsupported version %d' % version)
+
+    names = [SUBSYS.get(i, str(i)) for i in range(32) if mask & (1 << i)]
+    out.write('# start %d us, subsystems: %s\n' % (start_us, ' '.join(names)))
+
+    while True:
+        rec = f.read(RECORD_HDR.size)
+        if not rec:
+            break
+        if len(rec) != RECORD_HDR.size:
+            out.write('# truncated record\n')
+            break
+        time_us, event, subsys, num_args, size = RECORD_HDR.unpack(rec)
+        body_len = 4 * num_args + ((size + 3) & ~3)
+        body = f.read(body_len)
+        if len(body) != body_len:
+            out.write('# truncated record\n')
+            break
+
+        name = SUBSYS.get(subsys, str(subsys))
+        if subsystems and name not in subsystems:
+            continue
+
+        args = struct.unpack_from('<%dI' % num_args, body)
+        data = body[4 * num_args:4 * num_args + size]
+        fmt = fmt_raw if raw else EVENTS.get(event, fmt_raw)
+        out.write('%12d %-9s %04x %s\n' % (time_us, name, event, fmt(args, data)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__,
+                                     formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--subsys', help='comma separated subsystems to print')
+    parser.add_argument('--raw', action='store_true', help='print the arguments undecoded')
+    parser.add_argument('file')
+    opts = parser.parse_args()
+
+    subsystems = set(opts.subsys.split(',')) if opts.subsys else None
+    try:
+        with open(opts.file, 'rb') as f:
+            decode(f, subsystems, opts.raw, sys.stdout)
+    except BrokenPipeError:
+        pass
+    except (OSError, ValueError) as e:
+        sys.exit('%s: %s' % (opts.file, e))
+
+
+if __name__ == '__main__':
+    main()
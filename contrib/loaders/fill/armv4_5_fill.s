@@ -0,0 +1,43 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+/*
+	parameters:
+	r0 - address
+	r1 - number of elements, not zero
+	r2 - pattern
+	r3 - element size, 1, 2 or 4 bytes
+*/
+
+	.text
+	.arch armv4
+	.arm
+
+	.align	2
+
+start:
+	cmp	r3, #4
+	beq	word_loop
+	cmp	r3, #2
+	beq	half_loop
+
+byte_loop:
+	strb	r2, [r0], #1
+	subs	r1, r1, #1
+	bne	byte_loop
+	b	done
+
+half_loop:
+	strh	r2, [r0], #2
+	subs	r1, r1, #1
+	bne	half_loop
+	b	done
+
+word_loop:
+	str	r2, [r0], #4
+	subs	r1, r1, #1
+	bne	word_loop
+
+done:
+	bkpt	#0
+
+	.end
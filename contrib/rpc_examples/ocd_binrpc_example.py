@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+"""
+Client example of the OpenOCD binary RPC service, enabled with
+'rpc port 6667' in the configuration.
+
+Reads memory with several pipelined requests and prints the target state.
+"""
+
+import socket
+import struct
+import sys
+
+RPC_REPLY = 0x8000
+RPC_EVENT = 0xffff
+
+OP_VERSION = 0x00
+OP_STATE = 0x02
+OP_READ_MEMORY = 0x10
+OP_WRITE_MEMORY = 0x11
+OP_HALT = 0x30
+OP_RESUME = 0x31
+OP_COMMAND = 0x60
+
+
+class OpenOcdBinRpc:
+    def __init__(self, host='localhost', port=6667):
+        self.sock = socket.create_connection((host, port))
+        self.next_id = 1
+        self.buf = b''
+
+    def send(self, opcode, payload=b'', flags=0):
+        """Queue a request, returns its id"""
+        req_id = self.next_id
+        self.next_id += 1
+        frame = struct.pack('<IHH', req_id, opcode, flags) + payload
+        self.sock.sendall(struct.pack('<I', len(frame)) + frame)
+        return req_id
+
+    def _read(self, size):
+        while len(self.buf) < size:
+            data = self.sock.recv(65536)
+            if not data:
+                raise ConnectionError('connection closed')
+            self.buf += data
+        data, self.buf = self.buf[:size], self.buf[size:]
+        return data
+
+    def receive(self):
+        """Returns the next reply as (id, opcode, status, payload), skipping events"""
+        while True:
+            length, = struct.unpack('<I', self._read(4))
+            frame = self._read(length)
+            req_id, opcode, _, status = struct.unpack_from('<IHHi', frame)
+            if opcode == RPC_EVENT:
+                event, state, name_len = struct.unpack_from('<IIH', frame, 12)
+                print('event %d state %d on %s' % (event, state, frame[22:22 + name_len].decode()))
+                continue
+            return req_id, opcode & ~RPC_REPLY, status, frame[12:]
+
+    def call(self, opcode, payload=b'', flags=0):
+        req_id = self.send(opcode, payload, flags)
+        reply_id, _, status, payload = self.receive()
+        assert reply_id == req_id
+        if status != 0:
+            raise RuntimeError('request 0x%x failed with error %d' % (opcode, status))
+        return payload
+
+    def read_memory(self, address, width, count):
+        return self.call(OP_READ_MEMORY, struct.pack('<QII', address, width, count))
+
+    def command(self, line):
+        return self.call(OP_COMMAND, line.encode()).decode()
+
+
+def main():
+    rpc = OpenOcdBinRpc(port=int(sys.argv[1]) if len(sys.argv) > 1 else 6667)
+    version, = struct.unpack('<I', rpc.call(OP_VERSION))
+    state, = struct.unpack('<I', rpc.call(OP_STATE))
+    print('protocol version %d, target state %d' % (version, state))
+
+    # pipelined: all the requests are sent before the first reply is read
+    ids = [rpc.send(OP_READ_MEMORY, struct.pack('<QII', 0x20000000 + i * 1024, 4, 256))
+           for i in range(8)]
+    for req_id in ids:
+        reply_id, _, status, data = rpc.receive()
+        assert reply_id == req_id
+        print('request %d: error %d, %d bytes' % (reply_id, status, len(data)))
+
+    print(rpc.command('version'))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,44 @@
+/* SPDX-License-Identifier: CC0-1.0 */
+
+/*
+ * Thread table a firmware can maintain for OpenOCD's threads awareness.
+ *
+ * Instead of walking the kernel lists from the host, OpenOCD reads this
+ * table, published through the openocd_thread_table symbol, with two
+ * memory accesses. It is optional: without the symbol, or with a table
+ * not valid, the kernel lists are walked as usual.
+ *
+ * The firmware bumps version to an odd value before changing the table,
+ * including current, and to the next even value after. OpenOCD ignores
+ * the table while version is odd.
+ *
+ * The id of a thread is the value OpenOCD uses for it with the RTOS,
+ * e.g. the TCB address for FreeRTOS. State is RTOS specific, for FreeRTOS
+ * it is the eTaskState value.
+ *
+ * Add the table to your project, and, if you're using --gc-sections,
+ * ``--undefined=openocd_thread_table'' to your LDFLAGS.
+ */
+
+#ifndef OPENOCD_THREAD_TABLE_H
+#define OPENOCD_THREAD_TABLE_H
+
+#include <stdint.h>
+
+#define OPENOCD_THREAD_TABLE_MAGIC 0x5454434fu	/* "OCTT" */
+
+struct openocd_thread {
+	uint32_t id;			/* non zero */
+	uint32_t state;
+	uint32_t name;			/* address of a NUL terminated name, or 0 */
+};
+
+struct openocd_thread_table {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t count;			/* number of valid entries in threads[] */
+	uint32_t current;		/* id of the running thread, or 0 */
+	struct openocd_thread threads[];
+};
+
+#endif /* OPENOCD_THREAD_TABLE_H */
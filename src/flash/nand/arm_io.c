@@ -18,6 +18,9 @@
 #include <target/armv7m.h>
 #include <target/algorithm.h>
 
+/* Room for a chunk and its share of OOB, a page and its OOB take one run */
+#define ARM_NAND_BUFFER_SIZE(chunk_size)	((chunk_size) + (chunk_size) / 32)
+
 /**
  * Copies code to a working area.  This will allocate room for the code plus the
  * additional amount requested if the working area pointer is null.
@@ -85,9 +88,9 @@ int arm_nandwrite(struct arm_nand_data *nand, uint8_t *data, int size)
 	void *arm_algo;
 	struct arm *arm = target->arch_info;
 	struct reg_param reg_params[3];
-	uint32_t target_buf;
+	uint32_t target_buf, chunk;
 	uint32_t exit_var = 0;
-	int retval;
+	int retval = ERROR_OK;
 
 	/* Inputs:
 	 *  r0	NAND data address (byte wide)
@@ -139,37 +142,51 @@ int arm_nandwrite(struct arm_nand_data *nand, uint8_t *data, int size)
 
 	if (nand->op != ARM_NAND_WRITE || !nand->copy_area) {
 		retval = arm_code_to_working_area(target, target_code_src, target_code_size,
-				nand->chunk_size, &nand->copy_area);
+				ARM_NAND_BUFFER_SIZE(nand->chunk_size), &nand->copy_area);
 		if (retval != ERROR_OK)
 			return retval;
 	}
 
 	nand->op = ARM_NAND_WRITE;
 
-	/* copy data to work area */
+	/* a page may come with its OOB, larger ones take several runs */
 	target_buf = nand->copy_area->address + target_code_size;
-	retval = target_write_buffer(target, target_buf, size, data);
-	if (retval != ERROR_OK)
-		return retval;
+	chunk = nand->copy_area->size - target_code_size;
+	if (!chunk)
+		return ERROR_NAND_NO_BUFFER;
 
 	/* set up parameters */
 	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN);
 	init_reg_param(&reg_params[1], "r1", 32, PARAM_IN);
 	init_reg_param(&reg_params[2], "r2", 32, PARAM_IN);
 
-	buf_set_u32(reg_params[0].value, 0, 32, nand->data);
-	buf_set_u32(reg_params[1].value, 0, 32, target_buf);
-	buf_set_u32(reg_params[2].value, 0, 32, size);
-
 	/* armv4 must exit using a hardware breakpoint */
 	if (arm->arch == ARM_ARCH_V4)
 		exit_var = nand->copy_area->address + target_code_size - 4;
 
-	/* use alg to write data from work area to NAND chip */
-	retval = target_run_algorithm(target, 0, NULL, 3, reg_params,
-			nand->copy_area->address, exit_var, 1000, arm_algo);
-	if (retval != ERROR_OK)
-		LOG_ERROR("error executing hosted NAND write");
+	while (size > 0) {
+		uint32_t thisrun_size = MIN((uint32_t)size, chunk);
+
+		/* copy data to work area */
+		retval = target_write_buffer(target, target_buf, thisrun_size, data);
+		if (retval != ERROR_OK)
+			break;
+
+		buf_set_u32(reg_params[0].value, 0, 32, nand->data);
+		buf_set_u32(reg_params[1].value, 0, 32, target_buf);
+		buf_set_u32(reg_params[2].value, 0, 32, thisrun_size);
+
+		/* use alg to write data from work area to NAND chip */
+		retval = target_run_algorithm(target, 0, NULL, 3, reg_params,
+				nand->copy_area->address, exit_var, 1000, arm_algo);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("error executing hosted NAND write");
+			break;
+		}
+
+		data += thisrun_size;
+		size -= thisrun_size;
+	}
 
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
@@ -195,9 +212,9 @@ int arm_nandread(struct arm_nand_data *nand, uint8_t *data, uint32_t size)
 	void *arm_algo;
 	struct arm *arm = target->arch_info;
 	struct reg_param reg_params[3];
-	uint32_t target_buf;
+	uint32_t target_buf, chunk;
 	uint32_t exit_var = 0;
-	int retval;
+	int retval = ERROR_OK;
 
 	/* Inputs:
 	 *  r0	buffer address
@@ -250,39 +267,54 @@ int arm_nandread(struct arm_nand_data *nand, uint8_t *data, uint32_t size)
 	/* create the copy area if not yet available */
 	if (nand->op != ARM_NAND_READ || !nand->copy_area) {
 		retval = arm_code_to_working_area(target, target_code_src, target_code_size,
-				nand->chunk_size, &nand->copy_area);
+				ARM_NAND_BUFFER_SIZE(nand->chunk_size), &nand->copy_area);
 		if (retval != ERROR_OK)
 			return retval;
 	}
 
 	nand->op = ARM_NAND_READ;
+
 	target_buf = nand->copy_area->address + target_code_size;
+	chunk = nand->copy_area->size - target_code_size;
+	if (!chunk)
+		return ERROR_NAND_NO_BUFFER;
 
 	/* set up parameters */
 	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN);
 	init_reg_param(&reg_params[1], "r1", 32, PARAM_IN);
 	init_reg_param(&reg_params[2], "r2", 32, PARAM_IN);
 
-	buf_set_u32(reg_params[0].value, 0, 32, target_buf);
-	buf_set_u32(reg_params[1].value, 0, 32, nand->data);
-	buf_set_u32(reg_params[2].value, 0, 32, size);
-
 	/* armv4 must exit using a hardware breakpoint */
 	if (arm->arch == ARM_ARCH_V4)
 		exit_var = nand->copy_area->address + target_code_size - 4;
 
-	/* use alg to write data from NAND chip to work area */
-	retval = target_run_algorithm(target, 0, NULL, 3, reg_params,
-			nand->copy_area->address, exit_var, 1000, arm_algo);
-	if (retval != ERROR_OK)
-		LOG_ERROR("error executing hosted NAND read");
+	while (size > 0) {
+		uint32_t thisrun_size = MIN(size, chunk);
+
+		buf_set_u32(reg_params[0].value, 0, 32, target_buf);
+		buf_set_u32(reg_params[1].value, 0, 32, nand->data);
+		buf_set_u32(reg_params[2].value, 0, 32, thisrun_size);
+
+		/* use alg to write data from NAND chip to work area */
+		retval = target_run_algorithm(target, 0, NULL, 3, reg_params,
+				nand->copy_area->address, exit_var, 1000, arm_algo);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("error executing hosted NAND read");
+			break;
+		}
+
+		/* read from work area to the host's memory */
+		retval = target_read_buffer(target, target_buf, thisrun_size, data);
+		if (retval != ERROR_OK)
+			break;
+
+		data += thisrun_size;
+		size -= thisrun_size;
+	}
 
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
 	destroy_reg_param(&reg_params[2]);
 
-	/* read from work area to the host's memory */
-	retval = target_read_buffer(target, target_buf, size, data);
-
 	return retval;
 }
@@ -293,6 +293,8 @@ int nand_probe(struct nand_device *nand)
 	uint8_t manufacturer_id, device_id;
 	uint8_t id_buff[6] = { 0 };	/* zero buff to silence false warning
 					 * from clang static analyzer */
+	struct nand_block *old_blocks = nand->blocks;
+	int old_num_blocks = nand->num_blocks;
 	int retval;
 	int i;
 
@@ -488,14 +490,32 @@ int nand_probe(struct nand_device *nand)
 
 	nand->num_blocks = (nand->device->chip_size * 1024) / (nand->erase_size / 1024);
 	nand->blocks = malloc(sizeof(struct nand_block) * nand->num_blocks);
+	if (!nand->blocks) {
+		LOG_ERROR("no memory for the block table");
+		nand->blocks = old_blocks;
+		nand->device = NULL;
+		return ERROR_FAIL;
+	}
+
+	/* the scan of the bad blocks takes one page read per block, not to
+	 * be redone on every probe of the same chip */
+	id_buff[0] = manufacturer_id;
+	id_buff[1] = device_id;
+	bool same_chip = old_blocks && old_num_blocks == nand->num_blocks &&
+		!memcmp(nand->id, id_buff, sizeof(nand->id));
+	memcpy(nand->id, id_buff, sizeof(nand->id));
 
 	for (i = 0; i < nand->num_blocks; i++) {
 		nand->blocks[i].size = nand->erase_size;
 		nand->blocks[i].offset = i * nand->erase_size;
 		nand->blocks[i].is_erased = -1;
-		nand->blocks[i].is_bad = -1;
+		nand->blocks[i].is_bad = same_chip ? old_blocks[i].is_bad : -1;
 	}
 
+	if (same_chip)
+		LOG_DEBUG("same chip as the last probe, bad block table kept");
+	free(old_blocks);
+
 	return ERROR_OK;
 }
 
@@ -785,6 +805,19 @@ int nand_read_page_raw(struct nand_device *nand, uint32_t page,
 	if (retval != ERROR_OK)
 		return retval;
 
+	if (data && oob && nand->controller->read_block_data) {
+		/* the OOB follows the data in the page register, one block
+		 * read (one algorithm run for the hosted ones) takes both */
+		uint8_t *buf = malloc(data_size + oob_size);
+		if (buf) {
+			retval = nand_read_data_page(nand, buf, data_size + oob_size);
+			memcpy(data, buf, data_size);
+			memcpy(oob, buf + data_size, oob_size);
+			free(buf);
+			return retval;
+		}
+	}
+
 	if (data)
 		nand_read_data_page(nand, data, data_size);
 
@@ -862,6 +895,22 @@ int nand_write_page_raw(struct nand_device *nand, uint32_t page,
 	if (retval != ERROR_OK)
 		return retval;
 
+	if (data && oob && nand->controller->write_block_data) {
+		/* same as two block writes, in one transfer */
+		uint8_t *buf = malloc(data_size + oob_size);
+		if (buf) {
+			memcpy(buf, data, data_size);
+			memcpy(buf + data_size, oob, oob_size);
+			retval = nand_write_data_page(nand, buf, data_size + oob_size);
+			free(buf);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("Unable to write data to NAND device");
+				return retval;
+			}
+			return nand_write_finish(nand);
+		}
+	}
+
 	if (data) {
 		retval = nand_write_data_page(nand, data, data_size);
 		if (retval != ERROR_OK) {
@@ -58,6 +58,9 @@ struct nand_device {
 	bool use_raw;
 	int num_blocks;
 	struct nand_block *blocks;
+	/* ID bytes of the last probe, a new probe finding the same chip keeps
+	 * the bad blocks already known */
+	uint8_t id[6];
 	struct nand_device *next;
 };
 
@@ -165,8 +165,6 @@ static int davinci_read_data(struct nand_device *nand, void *data)
 	return ERROR_OK;
 }
 
-/* REVISIT a bit of native code should let block reads be MUCH faster */
-
 static int davinci_read_block_data(struct nand_device *nand,
 	uint8_t *data, int data_size)
 {
@@ -174,10 +172,18 @@ static int davinci_read_block_data(struct nand_device *nand,
 	struct target *target = nand->target;
 	uint32_t nfdata = info->data;
 	uint32_t tmp;
+	int status;
 
 	if (!halted(target, "read_block"))
 		return ERROR_NAND_OPERATION_FAILED;
 
+	/* try the fast way first */
+	info->io.chunk_size = nand->page_size;
+	status = arm_nandread(&info->io, data, data_size);
+	if (status != ERROR_NAND_NO_BUFFER)
+		return status;
+
+	/* else do it slowly */
 	while (data_size >= 4) {
 		target_read_u32(target, nfdata, &tmp);
 
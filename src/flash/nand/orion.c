@@ -94,6 +94,18 @@ static int orion_nand_fast_block_write(struct nand_device *nand, uint8_t *data,
 	return retval;
 }
 
+static int orion_nand_fast_block_read(struct nand_device *nand, uint8_t *data, int size)
+{
+	struct orion_nand_controller *hw = nand->controller_priv;
+	struct target *target = nand->target;
+
+	CHECK_HALTED;
+	hw->io.chunk_size = nand->page_size;
+
+	/* ERROR_NAND_NO_BUFFER falls back to byte reads */
+	return arm_nandread(&hw->io, data, size);
+}
+
 static int orion_nand_reset(struct nand_device *nand)
 {
 	return orion_nand_command(nand, NAND_CMD_RESET);
@@ -143,6 +155,7 @@ struct nand_flash_controller orion_nand_controller = {
 	.address = orion_nand_address,
 	.read_data = orion_nand_read,
 	.write_data = orion_nand_write,
+	.read_block_data = orion_nand_fast_block_read,
 	.write_block_data = orion_nand_fast_block_write,
 	.reset = orion_nand_reset,
 	.nand_device_command = orion_nand_device_command,
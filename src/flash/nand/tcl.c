@@ -534,6 +534,9 @@ static COMMAND_HELPER(create_nand_device, const char *bank_name,
 	c->address_cycles = 0;
 	c->page_size = 0;
 	c->use_raw = false;
+	c->num_blocks = 0;
+	c->blocks = NULL;
+	memset(c->id, 0, sizeof(c->id));
 	c->next = NULL;
 
 	retval = CALL_COMMAND_HANDLER(controller->nand_device_command, c);
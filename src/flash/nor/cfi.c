@@ -1113,6 +1113,123 @@ static uint32_t cfi_command_val(struct flash_bank *bank, uint8_t cmd)
 	}
 }
 
+/* Stream words to a Cortex-M target that programs them while the host
+ * keeps filling the FIFO, works with every bus width and command set */
+static int cfi_armv7m_write_block_async(struct flash_bank *bank, const uint8_t *buffer,
+	uint32_t address, uint32_t count)
+{
+	struct cfi_flash_bank *cfi_info = bank->driver_priv;
+	struct target *target = bank->target;
+	struct reg_param reg_params[12];
+	struct armv7m_algorithm armv7m_info;
+	struct working_area *write_algorithm;
+	struct working_area *source;
+	uint32_t buffer_size = 32768;
+	int retval;
+
+	/* see contrib/loaders/flash/cfi/armv7m_cfi_async.S for src */
+	static const uint8_t armv7m_cfi_async_code[] = {
+#include "../../../contrib/loaders/flash/cfi/armv7m_cfi_async.inc"
+	};
+
+	if (bank->bus_width != 1 && bank->bus_width != 2 && bank->bus_width != 4)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	if (count < bank->bus_width)
+		return ERROR_OK;
+
+	if (target_alloc_working_area(target, sizeof(armv7m_cfi_async_code),
+			&write_algorithm) != ERROR_OK) {
+		LOG_WARNING("no working area available, can't do block memory writes");
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	retval = target_write_buffer(target, write_algorithm->address,
+			sizeof(armv7m_cfi_async_code), armv7m_cfi_async_code);
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, write_algorithm);
+		return retval;
+	}
+
+	while (target_alloc_working_area_try(target, buffer_size, &source) != ERROR_OK) {
+		buffer_size /= 2;
+		if (buffer_size <= 256) {
+			target_free_working_area(target, write_algorithm);
+
+			LOG_WARNING("no large enough working area available, can't do block memory writes");
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		}
+	}
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);	/* buffer start, status (out) */
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);	/* buffer end */
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);	/* target address */
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);	/* count (bus width units) */
+	init_reg_param(&reg_params[4], "r4", 32, PARAM_OUT);	/* bus width */
+	init_reg_param(&reg_params[5], "r5", 32, PARAM_OUT);	/* word program command */
+	init_reg_param(&reg_params[6], "r6", 32, PARAM_OUT);	/* busy pattern or DQ7 mask */
+	init_reg_param(&reg_params[7], "r7", 32, PARAM_OUT);	/* error pattern or DQ5 mask */
+	init_reg_param(&reg_params[8], "r8", 32, PARAM_OUT);	/* unlock1 address, 0 for Intel */
+	init_reg_param(&reg_params[9], "r9", 32, PARAM_OUT);	/* unlock1 command */
+	init_reg_param(&reg_params[10], "r10", 32, PARAM_OUT);	/* unlock2 address */
+	init_reg_param(&reg_params[11], "r11", 32, PARAM_OUT);	/* unlock2 command */
+
+	buf_set_u32(reg_params[0].value, 0, 32, source->address);
+	buf_set_u32(reg_params[1].value, 0, 32, source->address + source->size);
+	buf_set_u32(reg_params[2].value, 0, 32, address);
+	buf_set_u32(reg_params[3].value, 0, 32, count / bank->bus_width);
+	buf_set_u32(reg_params[4].value, 0, 32, bank->bus_width);
+
+	if (cfi_info->pri_id == 2) {
+		struct cfi_spansion_pri_ext *pri_ext = cfi_info->pri_ext;
+
+		buf_set_u32(reg_params[5].value, 0, 32, cfi_command_val(bank, 0xA0));
+		buf_set_u32(reg_params[6].value, 0, 32, cfi_command_val(bank, 0x80));
+		buf_set_u32(reg_params[7].value, 0, 32,
+			(cfi_info->status_poll_mask & (1 << 5)) ? cfi_command_val(bank, 0x20) : 0);
+		buf_set_u32(reg_params[8].value, 0, 32, cfi_flash_address(bank, 0, pri_ext->_unlock1));
+		buf_set_u32(reg_params[9].value, 0, 32, 0xaaaaaaaa);
+		buf_set_u32(reg_params[10].value, 0, 32, cfi_flash_address(bank, 0, pri_ext->_unlock2));
+		buf_set_u32(reg_params[11].value, 0, 32, 0x55555555);
+	} else {
+		cfi_intel_clear_status_register(bank);
+
+		buf_set_u32(reg_params[5].value, 0, 32, cfi_command_val(bank, 0x40));
+		buf_set_u32(reg_params[6].value, 0, 32, cfi_command_val(bank, 0x80));
+		buf_set_u32(reg_params[7].value, 0, 32, cfi_command_val(bank, 0x7e));
+		buf_set_u32(reg_params[8].value, 0, 32, 0);
+		buf_set_u32(reg_params[9].value, 0, 32, 0);
+		buf_set_u32(reg_params[10].value, 0, 32, 0);
+		buf_set_u32(reg_params[11].value, 0, 32, 0);
+	}
+
+	retval = target_run_flash_async_algorithm(target, buffer, count / bank->bus_width,
+			bank->bus_width,
+			0, NULL,
+			ARRAY_SIZE(reg_params), reg_params,
+			source->address, source->size,
+			write_algorithm->address, 0,
+			&armv7m_info);
+
+	if (retval == ERROR_FLASH_OPERATION_FAILED) {
+		LOG_ERROR("flash write block failed status: 0x%" PRIx32,
+			buf_get_u32(reg_params[0].value, 0, 32));
+		if (cfi_info->pri_id != 2)
+			cfi_intel_clear_status_register(bank);
+	}
+
+	target_free_working_area(target, source);
+	target_free_working_area(target, write_algorithm);
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(reg_params); i++)
+		destroy_reg_param(&reg_params[i]);
+
+	return retval;
+}
+
 static int cfi_intel_write_block(struct flash_bank *bank, const uint8_t *buffer,
 	uint32_t address, uint32_t count)
 {
@@ -1192,6 +1309,15 @@ static int cfi_intel_write_block(struct flash_bank *bank, const uint8_t *buffer,
 	uint32_t target_code_size;
 	int retval = ERROR_OK;
 
+	if (is_armv7m(target_to_armv7m(target))) {
+		/* the ARM-state loader below cannot run on Cortex-M, without working
+		 * area leave it to the word writes of cfi_write() */
+		retval = cfi_armv7m_write_block_async(bank, buffer, address, count);
+		if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+			LOG_DEBUG("no streaming loader, falling back to word writes");
+		return retval;
+	}
+
 	/* check we have a supported arch */
 	if (is_arm(target_to_arm(target))) {
 		/* All other ARM CPUs have 32 bit instructions */
@@ -1782,6 +1908,10 @@ static int cfi_spansion_write_block(struct flash_bank *bank, const uint8_t *buff
 		return cfi_spansion_write_block_mips(bank, buffer, address, count);
 
 	if (is_armv7m(target_to_armv7m(target))) {	/* armv7m target */
+		retval = cfi_armv7m_write_block_async(bank, buffer, address, count);
+		if (retval != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+			return retval;
+
 		armv7m_algo.common_magic = ARMV7M_COMMON_MAGIC;
 		armv7m_algo.core_mode = ARM_MODE_THREAD;
 		arm_algo = &armv7m_algo;
@@ -16,6 +16,7 @@
 #include <flash/nor/core.h>
 #include <flash/nor/imp.h>
 #include <target/image.h>
+#include <helper/time_support.h>
 
 /**
  * @file
@@ -26,12 +27,60 @@
 
 static struct flash_bank *flash_banks;
 
+/**
+ * Host copy of the content of a flash bank. A sector is valid when its
+ * whole content is known, either read back from or written to the bank.
+ */
+struct flash_cache {
+	uint32_t size;
+	unsigned int num_sectors;
+	bool *valid;
+	uint8_t *data;
+	unsigned int hits;
+	unsigned int misses;
+};
+
+static void flash_cache_invalidate(struct flash_bank *bank,
+		uint32_t offset, uint32_t count);
+static void flash_cache_update(struct flash_bank *bank,
+		const uint8_t *buffer, uint32_t offset, uint32_t count);
+static bool flash_cache_lookup(struct flash_bank *bank,
+		uint8_t *buffer, uint32_t offset, uint32_t count);
+
+static void flash_stats_add(struct flash_bank *bank, enum flash_stats_op op,
+		struct duration *bench, uint32_t bytes, int retval)
+{
+	struct flash_op_stats *stats = &bank->stats[op];
+
+	duration_measure(bench);
+	stats->calls++;
+	if (retval != ERROR_OK)
+		stats->errors++;
+	stats->bytes += bytes;
+	stats->elapsed_us += (uint64_t)bench->elapsed.tv_sec * 1000000 + bench->elapsed.tv_usec;
+}
+
+void flash_stats_reset(struct flash_bank *bank)
+{
+	memset(bank->stats, 0, sizeof(bank->stats));
+}
+
 int flash_driver_erase(struct flash_bank *bank, unsigned int first,
 		unsigned int last)
 {
+	struct duration bench;
+	uint32_t bytes = 0;
 	int retval;
 
+	if (last < bank->num_sectors) {
+		bytes = bank->sectors[last].offset + bank->sectors[last].size
+			- bank->sectors[first].offset;
+		flash_cache_invalidate(bank, bank->sectors[first].offset, bytes);
+	}
+
+	duration_start(&bench);
 	retval = bank->driver->erase(bank, first, last);
+	flash_stats_add(bank, FLASH_STATS_ERASE, &bench, bytes, retval);
 	if (retval != ERROR_OK)
 		LOG_ERROR("failed erasing sectors %u to %u", first, last);
 
@@ -75,7 +124,10 @@ int flash_driver_protect(struct flash_bank *bank, int set, unsigned int first,
 	 *
 	 * Drivers only receive valid protection block range.
 	 */
+	struct duration bench;
+	duration_start(&bench);
 	retval = bank->driver->protect(bank, set, first, last);
+	flash_stats_add(bank, FLASH_STATS_PROTECT, &bench, 0, retval);
 	if (retval != ERROR_OK)
 		LOG_ERROR("failed setting protection for blocks %u to %u", first, last);
 
@@ -87,37 +139,61 @@ int flash_driver_write(struct flash_bank *bank,
 {
 	int retval;
 
+	/* sectors only partially written are no longer known */
+	flash_cache_invalidate(bank, offset, count);
+
+	struct duration bench;
+	duration_start(&bench);
 	retval = bank->driver->write(bank, buffer, offset, count);
+	flash_stats_add(bank, FLASH_STATS_WRITE, &bench, count, retval);
 	if (retval != ERROR_OK) {
 		LOG_ERROR(
 			"error writing to flash at address " TARGET_ADDR_FMT
 			" at offset 0x%8.8" PRIx32,
 			bank->base,
 			offset);
+		return retval;
 	}
 
+	flash_cache_update(bank, buffer, offset, count);
+
 	return retval;
 }
 
-int flash_driver_read(struct flash_bank *bank,
+int flash_driver_read_uncached(struct flash_bank *bank,
 	uint8_t *buffer, uint32_t offset, uint32_t count)
 {
 	int retval;
 
 	LOG_DEBUG("call flash_driver_read()");
 
+	struct duration bench;
+	duration_start(&bench);
 	retval = bank->driver->read(bank, buffer, offset, count);
+	flash_stats_add(bank, FLASH_STATS_READ, &bench, count, retval);
 	if (retval != ERROR_OK) {
 		LOG_ERROR(
 			"error reading to flash at address " TARGET_ADDR_FMT
 			" at offset 0x%8.8" PRIx32,
 			bank->base,
 			offset);
+		return retval;
 	}
 
+	flash_cache_update(bank, buffer, offset, count);
+
 	return retval;
 }
 
+int flash_driver_read(struct flash_bank *bank,
+	uint8_t *buffer, uint32_t offset, uint32_t count)
+{
+	if (flash_cache_lookup(bank, buffer, offset, count))
+		return ERROR_OK;
+
+	return flash_driver_read_uncached(bank, buffer, offset, count);
+}
+
 int default_flash_read(struct flash_bank *bank,
 	uint8_t *buffer, uint32_t offset, uint32_t count)
 {
@@ -127,15 +203,21 @@ int default_flash_read(struct flash_bank *bank,
 int flash_driver_verify(struct flash_bank *bank,
 	const uint8_t *buffer, uint32_t offset, uint32_t count)
 {
+	struct duration bench;
 	int retval;
 
+	duration_start(&bench);
 	retval = bank->driver->verify ? bank->driver->verify(bank, buffer, offset, count) :
 		default_flash_verify(bank, buffer, offset, count);
+	flash_stats_add(bank, FLASH_STATS_VERIFY, &bench, count, retval);
 	if (retval != ERROR_OK) {
 		LOG_ERROR("verify failed in bank at " TARGET_ADDR_FMT " starting at 0x%8.8" PRIx32,
 			bank->base, offset);
+		return retval;
 	}
 
+	flash_cache_update(bank, buffer, offset, count);
+
 	return retval;
 }
 
@@ -161,6 +243,185 @@ int default_flash_verify(struct flash_bank *bank,
 		return ERROR_FAIL;
 }
 
+/* Returns the cache of the bank, resized if the bank has been probed again */
+static struct flash_cache *flash_cache_get(struct flash_bank *bank)
+{
+	struct flash_cache *cache = bank->cache;
+
+	if (!cache)
+		return NULL;
+
+	if (cache->size == bank->size && cache->num_sectors == bank->num_sectors)
+		return cache;
+
+	free(cache->valid);
+	free(cache->data);
+	cache->size = bank->size;
+	cache->num_sectors = bank->num_sectors;
+	cache->valid = calloc(bank->num_sectors, sizeof(bool));
+	cache->data = malloc(bank->size);
+	if (!cache->valid || !cache->data) {
+		LOG_ERROR("Out of memory, disabling the cache of flash bank %s", bank->name);
+		flash_cache_enable(bank, false);
+		return NULL;
+	}
+
+	return cache;
+}
+
+static void flash_cache_invalidate(struct flash_bank *bank,
+		uint32_t offset, uint32_t count)
+{
+	struct flash_cache *cache = flash_cache_get(bank);
+
+	if (!cache)
+		return;
+
+	for (unsigned int i = 0; i < bank->num_sectors; i++) {
+		struct flash_sector *sector = &bank->sectors[i];
+		if (sector->offset < offset + count && offset < sector->offset + sector->size)
+			cache->valid[i] = false;
+	}
+}
+
+/* Records the content of a range, which is known to match the bank.
+ * Sectors partially in the range are kept only if already valid. */
+static void flash_cache_update(struct flash_bank *bank,
+		const uint8_t *buffer, uint32_t offset, uint32_t count)
+{
+	struct flash_cache *cache = flash_cache_get(bank);
+
+	if (!cache || offset > bank->size || count > bank->size - offset)
+		return;
+
+	memcpy(cache->data + offset, buffer, count);
+
+	for (unsigned int i = 0; i < bank->num_sectors; i++) {
+		struct flash_sector *sector = &bank->sectors[i];
+		if (sector->offset >= offset && sector->offset + sector->size <= offset + count)
+			cache->valid[i] = true;
+	}
+}
+
+static bool flash_cache_lookup(struct flash_bank *bank,
+		uint8_t *buffer, uint32_t offset, uint32_t count)
+{
+	struct flash_cache *cache = flash_cache_get(bank);
+
+	if (!cache || offset > bank->size || count > bank->size - offset)
+		return false;
+
+	for (unsigned int i = 0; i < bank->num_sectors; i++) {
+		struct flash_sector *sector = &bank->sectors[i];
+		if (sector->offset < offset + count && offset < sector->offset + sector->size
+				&& !cache->valid[i]) {
+			cache->misses++;
+			return false;
+		}
+	}
+
+	memcpy(buffer, cache->data + offset, count);
+	cache->hits++;
+
+	return true;
+}
+
+static int flash_cache_reset_handler(struct target *target,
+		enum target_reset_mode reset_mode, void *priv)
+{
+	/* the application or the boot code may rewrite the flash */
+	for (struct flash_bank *bank = flash_banks; bank; bank = bank->next) {
+		if (bank->target == target && bank->cache)
+			flash_cache_invalidate(bank, 0, bank->size);
+	}
+
+	return ERROR_OK;
+}
+
+int flash_cache_enable(struct flash_bank *bank, bool enable)
+{
+	static bool reset_callback_registered;
+
+	if (!enable) {
+		if (bank->cache) {
+			free(bank->cache->valid);
+			free(bank->cache->data);
+			free(bank->cache);
+			bank->cache = NULL;
+		}
+		return ERROR_OK;
+	}
+
+	if (bank->cache)
+		return ERROR_OK;
+
+	if (!bank->num_sectors) {
+		LOG_ERROR("Flash bank %s has no sector, cannot cache it", bank->name);
+		return ERROR_FAIL;
+	}
+
+	/* a virtual bank shares the content of its master bank */
+	if (strcmp(bank->driver->name, "virtual") == 0) {
+		LOG_ERROR("Flash bank %s is virtual, enable the cache on its master bank",
+			bank->name);
+		return ERROR_FAIL;
+	}
+
+	if (!reset_callback_registered) {
+		int retval = target_register_reset_callback(flash_cache_reset_handler, NULL);
+		if (retval != ERROR_OK)
+			return retval;
+		reset_callback_registered = true;
+	}
+
+	bank->cache = calloc(1, sizeof(struct flash_cache));
+	if (!bank->cache) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	/* allocate the content for the current sector layout */
+	if (!flash_cache_get(bank))
+		return ERROR_FAIL;
+
+	return ERROR_OK;
+}
+
+void flash_cache_stats(struct flash_bank *bank, unsigned int *valid_sectors,
+		unsigned int *hits, unsigned int *misses)
+{
+	struct flash_cache *cache = flash_cache_get(bank);
+
+	*valid_sectors = 0;
+	*hits = 0;
+	*misses = 0;
+	if (!cache)
+		return;
+
+	for (unsigned int i = 0; i < cache->num_sectors; i++)
+		if (cache->valid[i])
+			(*valid_sectors)++;
+	*hits = cache->hits;
+	*misses = cache->misses;
+}
+
+int flash_cache_read(struct target *target, target_addr_t addr,
+		uint32_t count, uint8_t *buffer)
+{
+	for (struct flash_bank *bank = flash_banks; bank; bank = bank->next) {
+		if (bank->target != target || !bank->cache)
+			continue;
+		if (addr < bank->base || addr - bank->base >= bank->size)
+			continue;
+
+		if (flash_cache_lookup(bank, buffer, addr - bank->base, count))
+			return ERROR_OK;
+		break;
+	}
+
+	return ERROR_FAIL;
+}
+
 void flash_bank_add(struct flash_bank *bank)
 {
 	/* put flash bank in linked list */
@@ -233,6 +494,7 @@ void flash_free_all_banks(void)
 			free(bank->prot_blocks);
 		}
 
+		flash_cache_enable(bank, false);
 		free(bank->name);
 		free(bank);
 		bank = next;
@@ -430,6 +692,235 @@ int default_flash_blank_check(struct flash_bank *bank)
 	return retval;
 }
 
+/* Loader code kept in the working area between flash operations */
+struct flash_loader_resident {
+	struct target *target;
+	size_t size;
+	uint32_t checksum;
+	struct working_area *area;
+	/* handed out by flash_loader_alloc() and not freed yet */
+	bool in_use;
+	struct flash_loader_resident *next;
+};
+
+static struct flash_loader_resident *flash_loaders_resident;
+
+static void flash_loader_evict(struct target *target, bool keep_in_use)
+{
+	struct flash_loader_resident **p = &flash_loaders_resident;
+
+	while (*p) {
+		struct flash_loader_resident *r = *p;
+		if (r->target != target || (keep_in_use && r->in_use)) {
+			p = &r->next;
+			continue;
+		}
+		/* the area is NULL if the working areas were freed meanwhile */
+		target_free_working_area(target, r->area);
+		*p = r->next;
+		free(r);
+	}
+}
+
+/* Forget the loaders whose working area got freed by someone else */
+static void flash_loader_purge(struct target *target)
+{
+	struct flash_loader_resident **p = &flash_loaders_resident;
+
+	while (*p) {
+		struct flash_loader_resident *r = *p;
+		if (r->target == target && !r->area) {
+			*p = r->next;
+			free(r);
+		} else {
+			p = &r->next;
+		}
+	}
+}
+
+static int flash_loader_event_handler(struct target *target,
+		enum target_event event, void *priv)
+{
+	/* the application owns the working area memory while it runs */
+	if (event == TARGET_EVENT_RESUMED)
+		flash_loader_evict(target, false);
+
+	return ERROR_OK;
+}
+
+static int flash_loader_reset_handler(struct target *target,
+		enum target_reset_mode reset_mode, void *priv)
+{
+	flash_loader_evict(target, false);
+
+	return ERROR_OK;
+}
+
+/* Any allocation short of working area gets the room of the idle loaders */
+static void flash_loader_reclaim_handler(struct target *target, void *priv)
+{
+	flash_loader_evict(target, true);
+}
+
+static struct flash_loader_resident *flash_loader_find(struct target *target,
+		const uint8_t *code, size_t code_size, uint32_t checksum)
+{
+	for (struct flash_loader_resident *r = flash_loaders_resident; r; r = r->next) {
+		if (r->target != target || r->size != code_size || r->checksum != checksum)
+			continue;
+		if (!r->area)
+			return NULL;
+
+		/* cheap check the code has not been overwritten by someone else */
+		if (code_size >= 4) {
+			uint8_t word[4];
+			if (target_read_memory(target, r->area->address, 4, 1, word) != ERROR_OK
+					|| memcmp(word, code, 4) != 0) {
+				LOG_DEBUG("resident loader at " TARGET_ADDR_FMT " altered, reloading",
+					r->area->address);
+				if (target_write_buffer(target, r->area->address, code_size, code) != ERROR_OK)
+					return NULL;
+			}
+		}
+		return r;
+	}
+
+	return NULL;
+}
+
+/* Allocate the code area of a loader, resident unless its content has to be
+ * backed up: restoring a backup on a running target would corrupt the
+ * application memory */
+static int flash_loader_alloc_code(struct target *target, struct flash_loader *loader,
+		const uint8_t *code, size_t code_size)
+{
+	static bool callbacks_registered;
+	uint32_t checksum;
+	int retval;
+
+	loader->resident = false;
+
+	if (target->backup_working_area
+			|| image_calculate_checksum(code, code_size, &checksum) != ERROR_OK) {
+		if (target_alloc_working_area(target, code_size, &loader->code) != ERROR_OK)
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+		retval = target_write_buffer(target, loader->code->address, code_size, code);
+		if (retval != ERROR_OK)
+			target_free_working_area(target, loader->code);
+		return retval;
+	}
+
+	struct flash_loader_resident *r = flash_loader_find(target, code, code_size, checksum);
+	if (r) {
+		LOG_DEBUG("reusing resident loader at " TARGET_ADDR_FMT, r->area->address);
+		r->in_use = true;
+		loader->code = r->area;
+		loader->resident = true;
+		return ERROR_OK;
+	}
+
+	if (!callbacks_registered) {
+		retval = target_register_event_callback(flash_loader_event_handler, NULL);
+		if (retval != ERROR_OK)
+			return retval;
+		retval = target_register_reset_callback(flash_loader_reset_handler, NULL);
+		if (retval != ERROR_OK)
+			return retval;
+		retval = target_register_reclaim_callback(flash_loader_reclaim_handler, NULL);
+		if (retval != ERROR_OK)
+			return retval;
+		callbacks_registered = true;
+	}
+
+	/* stale entries of areas freed meanwhile */
+	flash_loader_purge(target);
+
+	r = calloc(1, sizeof(*r));
+	if (!r) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	if (target_alloc_working_area(target, code_size, &r->area) != ERROR_OK) {
+		free(r);
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	retval = target_write_buffer(target, r->area->address, code_size, code);
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, r->area);
+		free(r);
+		return retval;
+	}
+
+	r->target = target;
+	r->size = code_size;
+	r->checksum = checksum;
+	r->in_use = true;
+	r->next = flash_loaders_resident;
+	flash_loaders_resident = r;
+
+	loader->code = r->area;
+	loader->resident = true;
+
+	return ERROR_OK;
+}
+
+int flash_loader_alloc(struct flash_bank *bank, struct flash_loader *loader,
+		const uint8_t *code, size_t code_size, uint32_t fifo_size)
+{
+	struct target *target = bank->target;
+	int retval;
+
+	loader->code = NULL;
+	loader->fifo = NULL;
+
+	retval = flash_loader_alloc_code(target, loader, code, code_size);
+	if (retval != ERROR_OK) {
+		loader->code = NULL;
+		if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+			LOG_WARNING("no working area available, can't do block memory writes");
+		return retval;
+	}
+
+	/* fifo size *must* be multiple of word */
+	fifo_size = MIN(fifo_size, target_get_working_area_avail(target)) & ~3UL;
+	while (fifo_size <= 256
+			|| target_alloc_working_area_try(target, fifo_size, &loader->fifo) != ERROR_OK) {
+		fifo_size /= 2;
+		fifo_size &= ~3UL;
+		if (fifo_size <= 256) {
+			flash_loader_free(bank, loader);
+			LOG_WARNING("no large enough working area available, can't do block memory writes");
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		}
+	}
+
+	LOG_DEBUG("loader at " TARGET_ADDR_FMT ", fifo of %" PRIu32 " bytes at " TARGET_ADDR_FMT,
+		loader->code->address, fifo_size, loader->fifo->address);
+
+	return ERROR_OK;
+}
+
+void flash_loader_free(struct flash_bank *bank, struct flash_loader *loader)
+{
+	target_free_working_area(bank->target, loader->fifo);
+	/* a resident loader stays until the target resumes or resets, or its
+	 * room is needed */
+	if (loader->resident) {
+		for (struct flash_loader_resident *r = flash_loaders_resident; r; r = r->next) {
+			if (r->area && r->area == loader->code)
+				r->in_use = false;
+		}
+	} else {
+		target_free_working_area(bank->target, loader->code);
+	}
+	loader->fifo = NULL;
+	loader->code = NULL;
+	loader->resident = false;
+}
+
 /* Manipulate given flash region, selecting the bank according to target
  * and address.  Maps an address range to a set of sectors, and issues
  * the callback() on that set ... e.g. to erase or unprotect its members.
@@ -727,8 +1218,140 @@ static bool flash_write_check_gap(struct flash_bank *bank,
 }
 
 
+/* Size of the host buffer staging an image run, rounded to whole sectors */
+#define FLASH_WRITE_CHUNK_SIZE (4 * 1024 * 1024)
+
+/* Size of the next chunk of a run starting at bank offset, ending at a
+ * sector boundary unless the whole remainder fits in one chunk */
+static uint32_t flash_write_chunk_size(struct flash_bank *c, uint32_t offset,
+	uint32_t remaining)
+{
+	if (remaining <= FLASH_WRITE_CHUNK_SIZE)
+		return remaining;
+
+	uint32_t chunk_end = 0;
+	for (unsigned int sector = 0; sector < c->num_sectors; sector++) {
+		uint32_t sector_end = c->sectors[sector].offset + c->sectors[sector].size;
+		if (sector_end <= offset)
+			continue;
+		if (sector_end - offset > FLASH_WRITE_CHUNK_SIZE && chunk_end)
+			break;
+		chunk_end = sector_end;
+		if (sector_end - offset >= FLASH_WRITE_CHUNK_SIZE)
+			break;
+	}
+
+	/* no sector layout or a sector past the run end: take the rest at once */
+	if (!chunk_end || chunk_end - offset >= remaining)
+		return remaining;
+
+	return chunk_end - offset;
+}
+
+/* unlock, erase, write and verify a buffer, as selected */
+static int flash_write_run(struct target *target, struct flash_bank *c,
+	const uint8_t *buffer, target_addr_t run_address, uint32_t run_size,
+	bool erase, bool unlock, bool write, bool verify)
+{
+	int retval = ERROR_OK;
+
+	if (unlock)
+		retval = flash_unlock_address_range(target, run_address, run_size);
+	if (retval == ERROR_OK) {
+		if (erase) {
+			/* calculate and erase sectors */
+			retval = flash_erase_address_range(target,
+					true, run_address, run_size);
+		}
+	}
+
+	if (retval == ERROR_OK) {
+		if (write) {
+			/* write flash sectors */
+			retval = flash_driver_write(c, buffer, run_address - c->base, run_size);
+		}
+	}
+
+	if (retval == ERROR_OK) {
+		if (verify) {
+			/* verify flash sectors */
+			retval = flash_driver_verify(c, buffer, run_address - c->base, run_size);
+		}
+	}
+
+	return retval;
+}
+
+/* Compare a part of the buffer with the flash content, without logging a mismatch */
+static bool flash_range_unchanged(struct flash_bank *c, const uint8_t *buffer,
+	uint32_t offset, uint32_t count)
+{
+	int retval = c->driver->verify ? c->driver->verify(c, buffer, offset, count) :
+		default_flash_verify(c, buffer, offset, count);
+
+	return retval == ERROR_OK;
+}
+
+/* Like flash_write_run(), but skipping the sectors whose content already
+ * matches the buffer. Consecutive changed sectors are written together. */
+static int flash_write_changed_sectors(struct target *target, struct flash_bank *c,
+	const uint8_t *buffer, target_addr_t run_address, uint32_t run_size,
+	uint32_t *written, bool erase, bool unlock, bool verify)
+{
+	uint32_t run_offset = run_address - c->base;
+	uint32_t run_end = run_offset + run_size;
+	uint32_t span_start = 0, span_end = 0;
+	bool span_pending = false;
+	unsigned int skipped = 0;
+	int retval;
+
+	*written = 0;
+
+	/* one extra iteration flushes the last span */
+	for (unsigned int sector = 0; sector <= c->num_sectors; sector++) {
+		uint32_t start = run_end, end = run_end;
+		bool changed = false;
+
+		if (sector < c->num_sectors) {
+			start = MAX(c->sectors[sector].offset, run_offset);
+			end = MIN(c->sectors[sector].offset + c->sectors[sector].size, run_end);
+			if (start >= end)
+				continue;
+
+			changed = !flash_range_unchanged(c, buffer + (start - run_offset),
+					start, end - start);
+			if (!changed)
+				skipped++;
+		}
+
+		if (changed && span_pending && span_end == start) {
+			span_end = end;
+			continue;
+		}
+
+		if (span_pending) {
+			retval = flash_write_run(target, c, buffer + (span_start - run_offset),
+					c->base + span_start, span_end - span_start,
+					erase, unlock, true, verify);
+			if (retval != ERROR_OK)
+				return retval;
+			*written += span_end - span_start;
+		}
+
+		span_pending = changed;
+		span_start = start;
+		span_end = end;
+	}
+
+	if (skipped)
+		LOG_INFO("Skipped %u unchanged sector(s) of flash bank %s", skipped, c->name);
+
+	return ERROR_OK;
+}
+
 int flash_write_unlock_verify(struct target *target, struct image *image,
-	uint32_t *written, bool erase, bool unlock, bool write, bool verify)
+	uint32_t *written, bool erase, bool unlock, bool write, bool verify,
+	bool skip_unchanged)
 {
 	int retval = ERROR_OK;
 
@@ -894,96 +1517,93 @@ int flash_write_unlock_verify(struct target *target, struct image *image,
 			run_size += delta;
 		}
 
-		/* allocate buffer */
-		buffer = malloc(run_size);
-		if (!buffer) {
-			LOG_ERROR("Out of memory for flash bank buffer");
-			retval = ERROR_FAIL;
-			goto done;
-		}
-
-		if (padding_at_start)
-			memset(buffer, c->default_padded_value, padding_at_start);
-
-		buffer_idx = padding_at_start;
-
-		/* read sections to the buffer */
-		while (buffer_idx < run_size) {
-			size_t size_read;
-
-			size_read = run_size - buffer_idx;
-			if (size_read > sections[section]->size - section_offset)
-				size_read = sections[section]->size - section_offset;
-
-			/* KLUDGE!
-			 *
-			 * #¤%#"%¤% we have to figure out the section # from the sorted
-			 * list of pointers to sections to invoke image_read_section()...
-			 */
-			intptr_t diff = (intptr_t)sections[section] - (intptr_t)image->sections;
-			int t_section_num = diff / sizeof(struct imagesection);
-
-			LOG_DEBUG("image_read_section: section = %d, t_section_num = %d, "
-					"section_offset = %"PRIu32", buffer_idx = %"PRIu32", size_read = %zu",
-				section, t_section_num, section_offset,
-				buffer_idx, size_read);
-			retval = image_read_section(image, t_section_num, section_offset,
-					size_read, buffer + buffer_idx, &size_read);
-			if (retval != ERROR_OK || size_read == 0) {
-				free(buffer);
+		/* Stage and write the run in chunks ending at sector boundaries,
+		 * the host memory used stays bounded for huge images */
+		uint32_t chunk_offset = 0;
+		uint32_t pad_left = padding_at_start;
+		while (chunk_offset < run_size) {
+			uint32_t chunk_size = flash_write_chunk_size(c,
+					run_address + chunk_offset - c->base, run_size - chunk_offset);
+
+			buffer = malloc(chunk_size);
+			if (!buffer) {
+				LOG_ERROR("Out of memory for flash bank buffer");
+				retval = ERROR_FAIL;
 				goto done;
 			}
 
-			buffer_idx += size_read;
-			section_offset += size_read;
+			buffer_idx = 0;
 
-			/* see if we need to pad the section */
-			if (padding[section]) {
-				memset(buffer + buffer_idx, c->default_padded_value, padding[section]);
-				buffer_idx += padding[section];
-			}
+			/* read sections to the buffer */
+			while (buffer_idx < chunk_size) {
+				size_t size_read;
 
-			if (section_offset >= sections[section]->size) {
-				section++;
-				section_offset = 0;
-			}
-		}
+				if (pad_left) {
+					/* padding may continue from the previous chunk */
+					uint32_t pad_now = MIN(pad_left, chunk_size - buffer_idx);
+					memset(buffer + buffer_idx, c->default_padded_value, pad_now);
+					buffer_idx += pad_now;
+					pad_left -= pad_now;
+					continue;
+				}
 
-		retval = ERROR_OK;
+				size_read = chunk_size - buffer_idx;
+				if (size_read > sections[section]->size - section_offset)
+					size_read = sections[section]->size - section_offset;
+
+				/* KLUDGE!
+				 *
+				 * #¤%#"%¤% we have to figure out the section # from the sorted
+				 * list of pointers to sections to invoke image_read_section()...
+				 */
+				intptr_t diff = (intptr_t)sections[section] - (intptr_t)image->sections;
+				int t_section_num = diff / sizeof(struct imagesection);
+
+				LOG_DEBUG("image_read_section: section = %d, t_section_num = %d, "
+						"section_offset = %"PRIu32", buffer_idx = %"PRIu32", size_read = %zu",
+					section, t_section_num, section_offset,
+					buffer_idx, size_read);
+				retval = image_read_section(image, t_section_num, section_offset,
+						size_read, buffer + buffer_idx, &size_read);
+				if (retval != ERROR_OK || size_read == 0) {
+					free(buffer);
+					goto done;
+				}
 
-		if (unlock)
-			retval = flash_unlock_address_range(target, run_address, run_size);
-		if (retval == ERROR_OK) {
-			if (erase) {
-				/* calculate and erase sectors */
-				retval = flash_erase_address_range(target,
-						true, run_address, run_size);
+				buffer_idx += size_read;
+				section_offset += size_read;
+
+				if (section_offset >= sections[section]->size) {
+					/* the section is complete, see if we need to pad it */
+					pad_left = padding[section];
+					section++;
+					section_offset = 0;
+				}
 			}
-		}
 
-		if (retval == ERROR_OK) {
-			if (write) {
-				/* write flash sectors */
-				retval = flash_driver_write(c, buffer, run_address - c->base, run_size);
+			target_addr_t chunk_address = run_address + chunk_offset;
+			uint32_t chunk_written = 0;
+			if (skip_unchanged && write && c->num_sectors) {
+				retval = flash_write_changed_sectors(target, c, buffer, chunk_address,
+						chunk_size, &chunk_written, erase, unlock, verify);
+			} else {
+				retval = flash_write_run(target, c, buffer, chunk_address, chunk_size,
+						erase, unlock, write, verify);
+				chunk_written = chunk_size;
 			}
-		}
 
-		if (retval == ERROR_OK) {
-			if (verify) {
-				/* verify flash sectors */
-				retval = flash_driver_verify(c, buffer, run_address - c->base, run_size);
+			free(buffer);
+
+			if (retval != ERROR_OK) {
+				/* abort operation */
+				goto done;
 			}
-		}
 
-		free(buffer);
+			if (written)
+				*written += chunk_written;	/* add chunk size to total written counter */
 
-		if (retval != ERROR_OK) {
-			/* abort operation */
-			goto done;
+			chunk_offset += chunk_size;
 		}
-
-		if (written)
-			*written += run_size;	/* add run size to total written counter */
 	}
 
 done:
@@ -996,7 +1616,7 @@ done:
 int flash_write(struct target *target, struct image *image,
 	uint32_t *written, bool erase)
 {
-	return flash_write_unlock_verify(target, image, written, erase, false, true, false);
+	return flash_write_unlock_verify(target, image, written, erase, false, true, false, false);
 }
 
 struct flash_sector *alloc_block_array(uint32_t offset, uint32_t size,
@@ -55,6 +55,24 @@ struct flash_sector {
 	int is_protected;
 };
 
+/** Flash operations timed per bank, reported by 'flash stats' */
+enum flash_stats_op {
+	FLASH_STATS_PROTECT,
+	FLASH_STATS_ERASE,
+	FLASH_STATS_WRITE,
+	FLASH_STATS_READ,
+	FLASH_STATS_VERIFY,
+	FLASH_STATS_NUM,
+};
+
+/** Accumulated cost of one kind of flash operation */
+struct flash_op_stats {
+	unsigned int calls;
+	unsigned int errors;
+	uint64_t bytes;
+	uint64_t elapsed_us;
+};
+
 /** Special value for write_start_alignment and write_end_alignment field */
 #define FLASH_WRITE_ALIGN_SECTOR	UINT32_MAX
 
@@ -125,6 +143,12 @@ struct flash_bank {
 	/** Array of protection blocks, allocated and initialized by the flash driver */
 	struct flash_sector *prot_blocks;
 
+	/** Host copy of the bank content, NULL unless enabled by 'flash cache' */
+	struct flash_cache *cache;
+
+	/** Time and bytes spent in the driver, per operation */
+	struct flash_op_stats stats[FLASH_STATS_NUM];
+
 	struct flash_bank *next; /**< The next flash bank on this chip */
 };
 
@@ -182,6 +206,13 @@ void flash_set_dirty(void);
 /** @returns The number of flash banks currently defined. */
 unsigned int flash_get_bank_count(void);
 
+/**
+ * Reads target memory from the cached content of its flash banks.
+ * @returns ERROR_OK if the whole range was found in the cache.
+ */
+int flash_cache_read(struct target *target, target_addr_t addr,
+		uint32_t count, uint8_t *buffer);
+
 /** Deallocates bank->driver_priv */
 void default_flash_free_driver_priv(struct flash_bank *bank);
 
@@ -733,9 +733,7 @@ static int efm32x_write_block(struct flash_bank *bank, const uint8_t *buf,
 	uint32_t address, uint32_t count)
 {
 	struct target *target = bank->target;
-	uint32_t buffer_size = 16384;
-	struct working_area *write_algorithm;
-	struct working_area *source;
+	struct flash_loader loader;
 	struct reg_param reg_params[5];
 	struct armv7m_algorithm armv7m_info;
 	struct efm32x_flash_chip *efm32x_info = bank->driver_priv;
@@ -809,33 +807,11 @@ static int efm32x_write_block(struct flash_bank *bank, const uint8_t *buf,
 			0x00, 0xbe,    /* bkpt    #0 */
 	};
 
-
-	/* flash write code */
-	if (target_alloc_working_area(target, sizeof(efm32x_flash_write_code),
-			&write_algorithm) != ERROR_OK) {
-		LOG_WARNING("no working area available, can't do block memory writes");
-		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
-	}
-
-	ret = target_write_buffer(target, write_algorithm->address,
-			sizeof(efm32x_flash_write_code), efm32x_flash_write_code);
+	ret = flash_loader_alloc(bank, &loader, efm32x_flash_write_code,
+			sizeof(efm32x_flash_write_code), 16384);
 	if (ret != ERROR_OK)
 		return ret;
 
-	/* memory buffer */
-	while (target_alloc_working_area_try(target, buffer_size, &source) != ERROR_OK) {
-		buffer_size /= 2;
-		buffer_size &= ~3UL; /* Make sure it's 4 byte aligned */
-		if (buffer_size <= 256) {
-			/* we already allocated the writing code, but failed to get a
-			 * buffer, free the algorithm */
-			target_free_working_area(target, write_algorithm);
-
-			LOG_WARNING("no large enough working area available, can't do block memory writes");
-			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
-		}
-	}
-
 	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);	/* flash base (in), status (out) */
 	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);	/* count (word-32bit) */
 	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);	/* buffer start */
@@ -844,8 +820,8 @@ static int efm32x_write_block(struct flash_bank *bank, const uint8_t *buf,
 
 	buf_set_u32(reg_params[0].value, 0, 32, efm32x_info->reg_base);
 	buf_set_u32(reg_params[1].value, 0, 32, count);
-	buf_set_u32(reg_params[2].value, 0, 32, source->address);
-	buf_set_u32(reg_params[3].value, 0, 32, source->address + source->size);
+	buf_set_u32(reg_params[2].value, 0, 32, loader.fifo->address);
+	buf_set_u32(reg_params[3].value, 0, 32, loader.fifo->address + loader.fifo->size);
 	buf_set_u32(reg_params[4].value, 0, 32, address);
 
 	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
@@ -854,8 +830,8 @@ static int efm32x_write_block(struct flash_bank *bank, const uint8_t *buf,
 	ret = target_run_flash_async_algorithm(target, buf, count, 4,
 			0, NULL,
 			5, reg_params,
-			source->address, source->size,
-			write_algorithm->address, 0,
+			loader.fifo->address, loader.fifo->size,
+			loader.code->address, 0,
 			&armv7m_info);
 
 	if (ret == ERROR_FLASH_OPERATION_FAILED) {
@@ -873,8 +849,7 @@ static int efm32x_write_block(struct flash_bank *bank, const uint8_t *buf,
 		}
 	}
 
-	target_free_working_area(target, source);
-	target_free_working_area(target, write_algorithm);
+	flash_loader_free(bank, &loader);
 
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
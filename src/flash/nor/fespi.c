@@ -353,6 +353,29 @@ static int fespi_erase_sector(struct flash_bank *bank, int sector)
 	return ERROR_OK;
 }
 
+static int fespi_erase_chip(struct flash_bank *bank)
+{
+	struct fespi_flash_bank *fespi_info = bank->driver_priv;
+	int retval;
+
+	retval = fespi_tx(bank, SPIFLASH_WRITE_ENABLE);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = fespi_txwm_wait(bank);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = fespi_tx(bank, fespi_info->dev->chip_erase_cmd);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = fespi_txwm_wait(bank);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* chip erase takes about as long as erasing all sectors */
+	return fespi_wip(bank, bank->num_sectors * FESPI_MAX_TIMEOUT);
+}
+
 static int fespi_erase(struct flash_bank *bank, unsigned int first,
 		unsigned int last)
 {
@@ -404,6 +427,20 @@ static int fespi_erase(struct flash_bank *bank, unsigned int first,
 	if (retval != ERROR_OK)
 		goto done;
 
+	/* one chip erase instead of many sector erases for the whole device */
+	if (first == 0 && last == (bank->num_sectors - 1) && bank->num_sectors > 1 &&
+		fespi_info->dev->chip_erase_cmd != 0x00 &&
+		fespi_info->dev->chip_erase_cmd != fespi_info->dev->erase_cmd) {
+		LOG_DEBUG("Trying chip erase.");
+		retval = fespi_erase_chip(bank);
+		if (retval == ERROR_OK)
+			goto done;
+		LOG_WARNING("Chip erase failed. Falling back to sector erase.");
+		retval = fespi_wip(bank, bank->num_sectors * FESPI_MAX_TIMEOUT);
+		if (retval != ERROR_OK)
+			goto done;
+	}
+
 	for (unsigned int sector = first; sector <= last; sector++) {
 		retval = fespi_erase_sector(bank, sector);
 		if (retval != ERROR_OK)
@@ -34,11 +34,52 @@ int flash_driver_write(struct flash_bank *bank,
 		const uint8_t *buffer, uint32_t offset, uint32_t count);
 int flash_driver_read(struct flash_bank *bank,
 		uint8_t *buffer, uint32_t offset, uint32_t count);
+/* read from the bank even if the content is cached, e.g. to check it */
+int flash_driver_read_uncached(struct flash_bank *bank,
+		uint8_t *buffer, uint32_t offset, uint32_t count);
 int flash_driver_verify(struct flash_bank *bank,
 		const uint8_t *buffer, uint32_t offset, uint32_t count);
 
-/* write (optional verify) an image to flash memory of the given target */
+/* enable or disable the host copy of the bank content */
+int flash_cache_enable(struct flash_bank *bank, bool enable);
+void flash_cache_stats(struct flash_bank *bank, unsigned int *valid_sectors,
+		unsigned int *hits, unsigned int *misses);
+
+/* clear the time and bytes accounted to the bank operations */
+void flash_stats_reset(struct flash_bank *bank);
+
+/**
+ * Working areas of a flash loader fed through the fifo of
+ * target_run_flash_async_algorithm().
+ */
+struct flash_loader {
+	/** loader code */
+	struct working_area *code;
+	/** fifo, write and read pointers followed by the data */
+	struct working_area *fifo;
+	/** code is kept in the working area until the target resumes or resets */
+	bool resident;
+};
+
+/**
+ * Upload a loader and allocate its fifo, as large as the working area
+ * allows but at most @a fifo_size bytes and more than 256 bytes.
+ * @returns ERROR_TARGET_RESOURCE_NOT_AVAILABLE if the working area is too
+ * small, so callers can fall back to slower writes.
+ *
+ * The code stays resident in the working area after flash_loader_free(),
+ * unless the target backs up its working area, and is reused without
+ * download by the next call with the same code. Any allocation the working
+ * area has no room for frees the resident loaders not in use.
+ */
+int flash_loader_alloc(struct flash_bank *bank, struct flash_loader *loader,
+		const uint8_t *code, size_t code_size, uint32_t fifo_size);
+void flash_loader_free(struct flash_bank *bank, struct flash_loader *loader);
+
+/* write (optional verify) an image to flash memory of the given target,
+ * optionally skipping the sectors which already hold the image content */
 int flash_write_unlock_verify(struct target *target, struct image *image,
-		uint32_t *written, bool erase, bool unlock, bool write, bool verify);
+		uint32_t *written, bool erase, bool unlock, bool write, bool verify,
+		bool skip_unchanged);
 
 #endif /* OPENOCD_FLASH_NOR_IMP_H */
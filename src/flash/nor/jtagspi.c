@@ -10,12 +10,17 @@
 
 #include "imp.h"
 #include <jtag/jtag.h>
+#include <jtag/adapter.h>
 #include <flash/nor/spi.h>
 #include <helper/time_support.h>
 #include <pld/pld.h>
 
 #define JTAGSPI_MAX_TIMEOUT 3000
 
+/* Status reads queued behind a page program, and the delay between them */
+#define JTAGSPI_POLL_BATCH 16
+#define JTAGSPI_POLL_INTERVAL_US 100
+
 
 struct jtagspi_flash_bank {
 	struct jtag_tap *tap;
@@ -99,8 +104,10 @@ static void flip_u8(const uint8_t *in, uint8_t *out, unsigned int len)
 		out[i] = flip_u32(in[i], 8);
 }
 
-static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
-		uint8_t *write_buffer, unsigned int write_len, uint8_t *data_buffer, int data_len)
+/* Queues one SPI transaction. The data of a write is copied to the queue,
+ * a read completes in data_buffer after jtag_execute_queue(). */
+static int jtagspi_add_cmd(struct flash_bank *bank, uint8_t cmd,
+		const uint8_t *write_buffer, unsigned int write_len, uint8_t *data_buffer, int data_len)
 {
 	assert(write_buffer || write_len == 0);
 	assert(data_buffer || data_len == 0);
@@ -124,6 +131,20 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 			return retval;
 	}
 
+	/* the bit reversed copy of the data shifted out, the caller buffers are kept */
+	unsigned int out_len = write_len + (is_read ? 0 : data_len);
+	uint8_t *out_buffer = NULL;
+	if (out_len) {
+		out_buffer = malloc(out_len);
+		if (!out_buffer) {
+			LOG_ERROR("no memory for jtagspi transfer");
+			return ERROR_FAIL;
+		}
+		flip_u8(write_buffer, out_buffer, write_len);
+		if (!is_read)
+			flip_u8(data_buffer, out_buffer + write_len, data_len);
+	}
+
 	int n = 0;
 	const uint8_t marker = 1;
 	uint8_t xfer_bits[4];
@@ -151,9 +172,8 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 	n++;
 
 	if (write_len) {
-		flip_u8(write_buffer, write_buffer, write_len);
 		fields[n].num_bits = write_len * CHAR_BIT;
-		fields[n].out_value = write_buffer;
+		fields[n].out_value = out_buffer;
 		fields[n].in_value = NULL;
 		n++;
 	}
@@ -170,8 +190,7 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 			fields[n].out_value = NULL;
 			fields[n].in_value = data_buffer;
 		} else {
-			flip_u8(data_buffer, data_buffer, data_len);
-			fields[n].out_value = data_buffer;
+			fields[n].out_value = out_buffer + write_len;
 			fields[n].in_value = NULL;
 		}
 		fields[n].num_bits = data_len * CHAR_BIT;
@@ -186,20 +205,38 @@ static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
 
 	if (info->pld_device) {
 		int retval = pld_connect_spi_to_jtag(info->pld_device);
-		if (retval != ERROR_OK)
+		if (retval != ERROR_OK) {
+			free(out_buffer);
 			return retval;
+		}
 	} else {
 		jtagspi_set_user_ir(info);
 	}
 
 	/* passing from an IR scan to SHIFT-DR clears BYPASS registers */
 	jtag_add_dr_scan(info->tap, n, fields, TAP_IDLE);
-	int retval = jtag_execute_queue();
+	/* the out values have been copied to the queue */
+	free(out_buffer);
+
+	return ERROR_OK;
+}
+
+static int jtagspi_cmd(struct flash_bank *bank, uint8_t cmd,
+		const uint8_t *write_buffer, unsigned int write_len, uint8_t *data_buffer, int data_len)
+{
+	struct jtagspi_flash_bank *info = bank->driver_priv;
+
+	int retval = jtagspi_add_cmd(bank, cmd, write_buffer, write_len, data_buffer, data_len);
 	if (retval != ERROR_OK)
 		return retval;
 
-	if (is_read)
-		flip_u8(data_buffer, data_buffer, data_len);
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* negative data_len == read operation */
+	if (data_len < 0)
+		flip_u8(data_buffer, data_buffer, -data_len);
 
 	if (info->pld_device)
 		return pld_disconnect_spi_from_jtag(info->pld_device);
@@ -720,21 +757,79 @@ static int jtagspi_read(struct flash_bank *bank, uint8_t *buffer, uint32_t offse
 	return ERROR_OK;
 }
 
-static int jtagspi_page_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t offset, uint32_t count)
+/*
+ * Through the proxy bitstream, the write enable, its check, the page
+ * program and a first batch of status polls are queued together, so a
+ * page usually takes a single JTAG round trip.
+ */
+static int jtagspi_page_write_queued(struct flash_bank *bank, const uint8_t *buffer,
+		uint32_t count, const uint8_t *addr, unsigned int addr_len)
 {
 	struct jtagspi_flash_bank *info = bank->driver_priv;
-	uint8_t addr[sizeof(uint32_t)];
+	uint8_t status[1 + JTAGSPI_POLL_BATCH];
 	int retval;
 
-	retval = jtagspi_write_enable(bank);
+	retval = jtagspi_add_cmd(bank, SPIFLASH_WRITE_ENABLE, NULL, 0, NULL, 0);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = jtagspi_add_cmd(bank, SPIFLASH_READ_STATUS, NULL, 0, &status[0], -1);
+	if (retval != ERROR_OK)
+		return retval;
+	retval = jtagspi_add_cmd(bank, info->dev.pprog_cmd, addr, addr_len,
+		(uint8_t *)buffer, count);
 	if (retval != ERROR_OK)
 		return retval;
 
+	/* space the polls in TCK cycles, the adapter runs them without host round trip */
+	unsigned int poll_cycles = adapter_get_speed_khz() * JTAGSPI_POLL_INTERVAL_US / 1000;
+	for (unsigned int i = 1; i <= JTAGSPI_POLL_BATCH; i++) {
+		if (poll_cycles)
+			jtag_add_clocks(poll_cycles);
+		retval = jtagspi_add_cmd(bank, SPIFLASH_READ_STATUS, NULL, 0, &status[i], -1);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		return retval;
+
+	flip_u8(status, status, sizeof(status));
+
+	/* a page program without write enable is ignored by the flash */
+	if ((status[0] & SPIFLASH_WE_BIT) == 0) {
+		LOG_ERROR("Cannot enable write to flash. Status=0x%02" PRIx8, status[0]);
+		return ERROR_FAIL;
+	}
+
+	for (unsigned int i = 1; i <= JTAGSPI_POLL_BATCH; i++) {
+		if ((status[i] & SPIFLASH_BSY_BIT) == 0)
+			return ERROR_OK;
+	}
+
+	return jtagspi_wait(bank, JTAGSPI_MAX_TIMEOUT);
+}
+
+static int jtagspi_page_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t offset, uint32_t count)
+{
+	struct jtagspi_flash_bank *info = bank->driver_priv;
+	uint8_t addr[sizeof(uint32_t)];
+	int retval;
+
 	/* ATXP032/064/128 use always 4-byte addresses except for 0x03 read */
 	unsigned int addr_len = ((info->dev.read_cmd != 0x03) && info->always_4byte) ? 4 : info->addr_len;
 
+	/* a PLD driver connects and disconnects the SPI around each transaction */
+	if (!info->pld_device)
+		return jtagspi_page_write_queued(bank, buffer, count,
+			fill_addr(offset, addr_len, addr), addr_len);
+
+	retval = jtagspi_write_enable(bank);
+	if (retval != ERROR_OK)
+		return retval;
+
 	retval = jtagspi_cmd(bank, info->dev.pprog_cmd, fill_addr(offset, addr_len, addr),
-		addr_len, (uint8_t *) buffer, count);
+		addr_len, (uint8_t *)buffer, count);
 	if (retval != ERROR_OK)
 		return retval;
 	return jtagspi_wait(bank, JTAGSPI_MAX_TIMEOUT);
@@ -1303,9 +1303,7 @@ static int kinetis_write_block(struct flash_bank *bank, const uint8_t *buffer,
 		uint32_t offset, uint32_t wcount)
 {
 	struct target *target = bank->target;
-	uint32_t buffer_size;
-	struct working_area *write_algorithm;
-	struct working_area *source;
+	struct flash_loader loader;
 	struct kinetis_flash_bank *k_bank = bank->driver_priv;
 	uint32_t address = k_bank->prog_base + offset;
 	uint32_t end_address;
@@ -1314,33 +1312,12 @@ static int kinetis_write_block(struct flash_bank *bank, const uint8_t *buffer,
 	int retval;
 	uint8_t fstat;
 
-	/* allocate working area with flash programming code */
-	if (target_alloc_working_area(target, sizeof(kinetis_flash_write_code),
-			&write_algorithm) != ERROR_OK) {
-		LOG_WARNING("no working area available, can't do block memory writes");
-		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
-	}
-
-	retval = target_write_buffer(target, write_algorithm->address,
-		sizeof(kinetis_flash_write_code), kinetis_flash_write_code);
+	/* probably won't benefit from more than 16k of fifo ... */
+	retval = flash_loader_alloc(bank, &loader, kinetis_flash_write_code,
+			sizeof(kinetis_flash_write_code), 16384);
 	if (retval != ERROR_OK)
 		return retval;
 
-	/* memory buffer, size *must* be multiple of word */
-	buffer_size = target_get_working_area_avail(target) & ~(sizeof(uint32_t) - 1);
-	if (buffer_size < 256) {
-		LOG_WARNING("large enough working area not available, can't do block memory writes");
-		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
-	} else if (buffer_size > 16384) {
-		/* probably won't benefit from more than 16k ... */
-		buffer_size = 16384;
-	}
-
-	if (target_alloc_working_area(target, buffer_size, &source) != ERROR_OK) {
-		LOG_ERROR("allocating working area failed");
-		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
-	}
-
 	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
 	armv7m_info.core_mode = ARM_MODE_THREAD;
 
@@ -1352,15 +1329,15 @@ static int kinetis_write_block(struct flash_bank *bank, const uint8_t *buffer,
 
 	buf_set_u32(reg_params[0].value, 0, 32, address);
 	buf_set_u32(reg_params[1].value, 0, 32, wcount);
-	buf_set_u32(reg_params[2].value, 0, 32, source->address);
-	buf_set_u32(reg_params[3].value, 0, 32, source->address + source->size);
+	buf_set_u32(reg_params[2].value, 0, 32, loader.fifo->address);
+	buf_set_u32(reg_params[3].value, 0, 32, loader.fifo->address + loader.fifo->size);
 	buf_set_u32(reg_params[4].value, 0, 32, FTFX_FSTAT);
 
 	retval = target_run_flash_async_algorithm(target, buffer, wcount, 4,
 						0, NULL,
 						5, reg_params,
-						source->address, source->size,
-						write_algorithm->address, 0,
+						loader.fifo->address, loader.fifo->size,
+						loader.code->address, 0,
 						&armv7m_info);
 
 	if (retval == ERROR_FLASH_OPERATION_FAILED) {
@@ -1378,8 +1355,7 @@ static int kinetis_write_block(struct flash_bank *bank, const uint8_t *buffer,
 	} else if (retval != ERROR_OK)
 		LOG_ERROR("Error executing kinetis Flash programming algorithm");
 
-	target_free_working_area(target, source);
-	target_free_working_area(target, write_algorithm);
+	flash_loader_free(bank, &loader);
 
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
@@ -1129,7 +1129,7 @@ static int nrf5_erase_page(struct flash_bank *bank,
 static int nrf5_ll_flash_write(struct nrf5_info *chip, uint32_t address, const uint8_t *buffer, uint32_t bytes)
 {
 	struct target *target = chip->target;
-	uint32_t buffer_size = 8192;
+	uint32_t buffer_size;
 	struct working_area *write_algorithm;
 	struct working_area *source;
 	struct reg_param reg_params[6];
@@ -1167,11 +1167,20 @@ static int nrf5_ll_flash_write(struct nrf5_info *chip, uint32_t address, const u
 	retval = target_write_buffer(target, write_algorithm->address,
 				sizeof(nrf5_flash_write_code),
 				nrf5_flash_write_code);
-	if (retval != ERROR_OK)
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, write_algorithm);
 		return retval;
+	}
+
+	/* memory buffer, as large as possible but not larger than the data:
+	 * the loader keeps programming while the host refills the FIFO */
+	buffer_size = target_get_working_area_avail(target) & ~3UL;
+	if (buffer_size > bytes + 8)
+		buffer_size = bytes + 8;
+	if (buffer_size < 256 + 8)
+		buffer_size = 256 + 8;
 
-	/* memory buffer */
-	while (target_alloc_working_area(target, buffer_size, &source) != ERROR_OK) {
+	while (target_alloc_working_area_try(target, buffer_size, &source) != ERROR_OK) {
 		buffer_size /= 2;
 		buffer_size &= ~3UL; /* Make sure it's 4 byte aligned */
 		if (buffer_size <= 256) {
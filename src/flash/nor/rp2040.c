@@ -211,6 +211,88 @@ static int rp2040_stack_grab_and_prep(struct flash_bank *bank)
 	return ERROR_OK;
 }
 
+/* Stream the pages through a fifo, a small loader on the target calls
+ * flash_range_program() for each page while the host refills the fifo.
+ * Needs the stack and the flash out of XIP mode, see rp2040_stack_grab_and_prep() */
+static int rp2040_flash_write_async(struct flash_bank *bank, const uint8_t *buffer,
+		uint32_t offset, uint32_t count)
+{
+	struct rp2040_flash_bank *priv = bank->driver_priv;
+	struct target *target = bank->target;
+	struct working_area *write_algorithm;
+	struct working_area *source;
+	struct reg_param reg_params[7];
+	struct armv7m_algorithm alg_info;
+	const uint32_t pagesize = priv->dev->pagesize;
+
+	/* see contrib/loaders/flash/rp2040/rp2040_write.S for src */
+	static const uint8_t rp2040_write_code[] = {
+#include "../../../contrib/loaders/flash/rp2040/rp2040_write.inc"
+	};
+
+	if (!IS_PWR_OF_2(pagesize) || count % pagesize)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	if (target_alloc_working_area(target, sizeof(rp2040_write_code),
+			&write_algorithm) != ERROR_OK)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	int err = target_write_buffer(target, write_algorithm->address,
+			sizeof(rp2040_write_code), rp2040_write_code);
+	if (err != ERROR_OK) {
+		target_free_working_area(target, write_algorithm);
+		return err;
+	}
+
+	/* fifo of whole pages, a page never wraps around its end */
+	uint32_t avail = target_get_working_area_avail(target);
+	unsigned int fifo_pages = avail > 8 ? (avail - 8) / pagesize : 0;
+	fifo_pages = MIN(fifo_pages, count / pagesize + 1);
+	if (fifo_pages < 2
+			|| target_alloc_working_area_try(target, 8 + fifo_pages * pagesize, &source) != ERROR_OK) {
+		target_free_working_area(target, write_algorithm);
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	LOG_DEBUG("Streaming %" PRIu32 " bytes through %u pages of fifo", count, fifo_pages);
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);	/* buffer start, status (out) */
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);	/* buffer end */
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);	/* flash offset */
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);	/* count (pages) */
+	init_reg_param(&reg_params[4], "r7", 32, PARAM_OUT);	/* flash_range_program() */
+	init_reg_param(&reg_params[5], "r9", 32, PARAM_OUT);	/* page size */
+	init_reg_param(&reg_params[6], "sp", 32, PARAM_OUT);	/* stack for the ROM */
+
+	buf_set_u32(reg_params[0].value, 0, 32, source->address);
+	buf_set_u32(reg_params[1].value, 0, 32, source->address + source->size);
+	buf_set_u32(reg_params[2].value, 0, 32, offset);
+	buf_set_u32(reg_params[3].value, 0, 32, count / pagesize);
+	buf_set_u32(reg_params[4].value, 0, 32, priv->jump_flash_range_program);
+	buf_set_u32(reg_params[5].value, 0, 32, pagesize);
+	buf_set_u32(reg_params[6].value, 0, 32, priv->stack->address + priv->stack->size);
+
+	alg_info.common_magic = ARMV7M_COMMON_MAGIC;
+	alg_info.core_mode = ARM_MODE_THREAD;
+
+	err = target_run_flash_async_algorithm(target, buffer, count / pagesize, pagesize,
+			0, NULL,
+			ARRAY_SIZE(reg_params), reg_params,
+			source->address, source->size,
+			write_algorithm->address, 0,
+			&alg_info);
+	if (err != ERROR_OK)
+		LOG_ERROR("Failed to stream flash programming on target");
+
+	target_free_working_area(target, source);
+	target_free_working_area(target, write_algorithm);
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(reg_params); i++)
+		destroy_reg_param(&reg_params[i]);
+
+	return err;
+}
+
 static int rp2040_flash_write(struct flash_bank *bank, const uint8_t *buffer, uint32_t offset, uint32_t count)
 {
 	LOG_DEBUG("Writing %d bytes starting at 0x%" PRIx32, count, offset);
@@ -229,6 +311,12 @@ static int rp2040_flash_write(struct flash_bank *bank, const uint8_t *buffer, ui
 	if (err != ERROR_OK)
 		goto cleanup;
 
+	err = rp2040_flash_write_async(bank, buffer, offset, count);
+	if (err != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+		goto cleanup;
+
+	LOG_DEBUG("Not enough working area to stream, programming chunk by chunk");
+
 	unsigned int avail_pages = target_get_working_area_avail(target) / priv->dev->pagesize;
 	/* We try to allocate working area rounded down to device page size,
 	 * al least 1 page, at most the write data size
@@ -195,6 +195,7 @@ struct stm32x_flash_bank {
 	bool has_optcr2_pcrop;	/* F72x/73x */
 	unsigned int protection_bits; /* F413/423 */
 	uint32_t user_bank_size;
+	unsigned int parallelism;	/* bits, 0 for the default x16 program, x8 erase */
 };
 
 static bool stm32x_is_otp(struct flash_bank *bank)
@@ -255,6 +256,7 @@ FLASH_BANK_COMMAND_HANDLER(stm32x_flash_bank_command)
 	stm32x_info->probed = false;
 	stm32x_info->otp_unlocked = false;
 	stm32x_info->user_bank_size = bank->size;
+	stm32x_info->parallelism = 0;
 
 	return ERROR_OK;
 }
@@ -264,6 +266,21 @@ static inline int stm32x_get_flash_reg(struct flash_bank *bank, uint32_t reg)
 	return reg;
 }
 
+/* PSIZE used to erase, set by the 'stm32f2x parallelism' command */
+static uint32_t stm32x_erase_psize(struct flash_bank *bank)
+{
+	struct stm32x_flash_bank *stm32x_info = bank->driver_priv;
+
+	switch (stm32x_info->parallelism) {
+	case 16:
+		return FLASH_PSIZE_16;
+	case 32:
+		return FLASH_PSIZE_32;
+	default:
+		return FLASH_PSIZE_8;
+	}
+}
+
 static inline int stm32x_get_flash_status(struct flash_bank *bank, uint32_t *status)
 {
 	struct target *target = bank->target;
@@ -631,7 +648,8 @@ static int stm32x_erase(struct flash_bank *bank, unsigned int first,
 			snb = i;
 
 		retval = target_write_u32(target,
-				stm32x_get_flash_reg(bank, STM32_FLASH_CR), FLASH_SER | FLASH_SNB(snb) | FLASH_STRT);
+				stm32x_get_flash_reg(bank, STM32_FLASH_CR),
+				FLASH_SER | FLASH_SNB(snb) | stm32x_erase_psize(bank) | FLASH_STRT);
 		if (retval != ERROR_OK)
 			return retval;
 
@@ -689,14 +707,14 @@ static int stm32x_protect(struct flash_bank *bank, int set, unsigned int first,
 }
 
 static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
-		uint32_t offset, uint32_t count)
+		uint32_t offset, uint32_t count, unsigned int block_size)
 {
 	struct target *target = bank->target;
 	uint32_t buffer_size = 16384;
 	struct working_area *write_algorithm;
 	struct working_area *source;
 	uint32_t address = bank->base + offset;
-	struct reg_param reg_params[5];
+	struct reg_param reg_params[6];
 	struct armv7m_algorithm armv7m_info;
 	int retval = ERROR_OK;
 
@@ -742,18 +760,21 @@ static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
 	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);		/* buffer start, status (out) */
 	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);		/* buffer end */
 	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);		/* target address */
-	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);		/* count (halfword-16bit) */
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);		/* count (block_size units) */
 	init_reg_param(&reg_params[4], "r4", 32, PARAM_OUT);		/* flash base */
+	init_reg_param(&reg_params[5], "r5", 32, PARAM_OUT);		/* program command */
 
 	buf_set_u32(reg_params[0].value, 0, 32, source->address);
 	buf_set_u32(reg_params[1].value, 0, 32, source->address + source->size);
 	buf_set_u32(reg_params[2].value, 0, 32, address);
 	buf_set_u32(reg_params[3].value, 0, 32, count);
 	buf_set_u32(reg_params[4].value, 0, 32, STM32_FLASH_BASE);
+	buf_set_u32(reg_params[5].value, 0, 32,
+		FLASH_PG | (block_size == 4 ? FLASH_PSIZE_32 : FLASH_PSIZE_16));
 
-	retval = target_run_flash_async_algorithm(target, buffer, count, 2,
+	retval = target_run_flash_async_algorithm(target, buffer, count, block_size,
 			0, NULL,
-			5, reg_params,
+			6, reg_params,
 			source->address, source->size,
 			write_algorithm->address, 0,
 			&armv7m_info);
@@ -782,6 +803,7 @@ static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
 	destroy_reg_param(&reg_params[2]);
 	destroy_reg_param(&reg_params[3]);
 	destroy_reg_param(&reg_params[4]);
+	destroy_reg_param(&reg_params[5]);
 
 	return retval;
 }
@@ -789,9 +811,8 @@ static int stm32x_write_block(struct flash_bank *bank, const uint8_t *buffer,
 static int stm32x_write(struct flash_bank *bank, const uint8_t *buffer,
 		uint32_t offset, uint32_t count)
 {
+	struct stm32x_flash_bank *stm32x_info = bank->driver_priv;
 	struct target *target = bank->target;
-	uint32_t words_remaining = (count / 2);
-	uint32_t bytes_remaining = (count & 0x00000001);
 	uint32_t address = bank->base + offset;
 	uint32_t bytes_written = 0;
 	int retval;
@@ -810,10 +831,16 @@ static int stm32x_write(struct flash_bank *bank, const uint8_t *buffer,
 	if (retval != ERROR_OK)
 		return retval;
 
-	/* multiple half words (2-byte) to be programmed? */
-	if (words_remaining > 0) {
+	/* x32 programming needs word aligned data, else use x16 */
+	unsigned int block_size = 2;
+	if (stm32x_info->parallelism == 32 && !(offset & 0x3))
+		block_size = 4;
+	uint32_t blocks = count / block_size;
+
+	/* multiple blocks to be programmed? */
+	if (blocks > 0) {
 		/* try using a block write */
-		retval = stm32x_write_block(bank, buffer, offset, words_remaining);
+		retval = stm32x_write_block(bank, buffer, offset, blocks, block_size);
 		if (retval != ERROR_OK) {
 			if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
 				/* if block write failed (no sufficient working area),
@@ -821,12 +848,14 @@ static int stm32x_write(struct flash_bank *bank, const uint8_t *buffer,
 				LOG_WARNING("couldn't use block writes, falling back to single memory accesses");
 			}
 		} else {
-			buffer += words_remaining * 2;
-			address += words_remaining * 2;
-			words_remaining = 0;
+			bytes_written = blocks * block_size;
+			address += bytes_written;
 		}
 	}
 
+	uint32_t words_remaining = (count - bytes_written) / 2;
+	uint32_t bytes_remaining = (count - bytes_written) & 0x00000001;
+
 	if ((retval != ERROR_OK) && (retval != ERROR_TARGET_RESOURCE_NOT_AVAILABLE))
 		return retval;
 
@@ -1518,6 +1547,7 @@ static int stm32x_mass_erase(struct flash_bank *bank)
 		flash_mer = FLASH_MER | FLASH_MER1;
 	else
 		flash_mer = FLASH_MER;
+	flash_mer |= stm32x_erase_psize(bank);
 
 	retval = target_write_u32(target, stm32x_get_flash_reg(bank, STM32_FLASH_CR), flash_mer);
 	if (retval != ERROR_OK)
@@ -1725,6 +1755,37 @@ COMMAND_HANDLER(stm32x_handle_otp_command)
 	return retval;
 }
 
+COMMAND_HANDLER(stm32x_handle_parallelism_command)
+{
+	if (CMD_ARGC < 1 || CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct flash_bank *bank;
+	int retval = CALL_COMMAND_HANDLER(flash_command_get_bank_probe_optional, 0,
+		&bank, false);
+	if (retval != ERROR_OK)
+		return retval;
+
+	struct stm32x_flash_bank *stm32x_info = bank->driver_priv;
+
+	if (CMD_ARGC == 2) {
+		unsigned int parallelism;
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], parallelism);
+		if (parallelism != 16 && parallelism != 32) {
+			command_print(CMD, "parallelism must be 16 or 32");
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		stm32x_info->parallelism = parallelism;
+	}
+
+	if (stm32x_info->parallelism)
+		command_print(CMD, "x%u", stm32x_info->parallelism);
+	else
+		command_print(CMD, "default (x16 program, x8 erase)");
+
+	return ERROR_OK;
+}
+
 static const struct command_registration stm32f2x_exec_command_handlers[] = {
 	{
 		.name = "lock",
@@ -1775,6 +1836,13 @@ static const struct command_registration stm32f2x_exec_command_handlers[] = {
 		.usage = "bank_id (enable|disable|show)",
 		.help = "OTP (One Time Programmable) memory write enable/disable.",
 	},
+	{
+		.name = "parallelism",
+		.handler = stm32x_handle_parallelism_command,
+		.mode = COMMAND_ANY,
+		.usage = "bank_id ['16'|'32']",
+		.help = "Set the program and erase parallelism allowed by the supply voltage.",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -42,6 +42,9 @@
 #undef SPIFLASH_READ
 #undef SPIFLASH_PAGE_PROGRAM
 
+/* size of the memory mapped area */
+#define SPI_MM_WINDOW	0x10000000U
+
 /* saved mode settings */
 #define QSPI_MODE (stmqspi_info->saved_ccr & \
 	(0xF0000000U | QSPI_DCYC_MASK | QSPI_4LINE_MODE | QSPI_ALTB_MODE | QSPI_ADDR4))
@@ -319,6 +322,31 @@ static int set_mm_mode(struct flash_bank *bank)
 	return retval;
 }
 
+/* Check whether a flash range can be accessed through the memory mapped
+ * area instead of by indirect reads. This needs the saved configuration to
+ * be memory mapped mode and the range to fit the addressable window. The
+ * very last word is excluded, see silicon bug note in the documentation. */
+static bool stmqspi_mm_usable(struct flash_bank *bank, uint32_t offset, uint32_t count)
+{
+	struct stmqspi_flash_bank *stmqspi_info = bank->driver_priv;
+	uint32_t window = SPI_MM_WINDOW;
+	unsigned int dual;
+
+	/* OCTOSPI memory mapped mode is forced by set_mm_mode, QSPI uses saved CCR */
+	if (!IS_OCTOSPI && (stmqspi_info->saved_ccr & QSPI_MM_MODE) != QSPI_MM_MODE)
+		return false;
+
+	/* 3 byte addresses cover 16 MiB per flash only */
+	dual = (stmqspi_info->saved_cr & BIT(SPI_DUAL_FLASH)) ? 1 : 0;
+	if ((stmqspi_info->saved_ccr & QSPI_ADDR4) != QSPI_ADDR4)
+		window = BIT(24) << dual;
+
+	if (window > bank->size - 4)
+		window = bank->size - 4;
+
+	return offset < window && count <= window - offset;
+}
+
 /* Read the status register of the external SPI flash chip(s). */
 static int read_status_reg(struct flash_bank *bank, uint16_t *status)
 {
@@ -482,54 +510,15 @@ err:
 	return retval;
 }
 
-COMMAND_HANDLER(stmqspi_handle_mass_erase_command)
+/* Erase the whole device(s) with the chip erase command */
+static int stmqspi_mass_erase(struct flash_bank *bank)
 {
-	struct target *target = NULL;
-	struct flash_bank *bank;
-	struct stmqspi_flash_bank *stmqspi_info;
-	struct duration bench;
-	uint32_t io_base;
+	struct target *target = bank->target;
+	struct stmqspi_flash_bank *stmqspi_info = bank->driver_priv;
+	uint32_t io_base = stmqspi_info->io_base;
 	uint16_t status;
-	unsigned int sector;
 	int retval;
 
-	LOG_DEBUG("%s", __func__);
-
-	if (CMD_ARGC != 1)
-		return ERROR_COMMAND_SYNTAX_ERROR;
-
-	retval = CALL_COMMAND_HANDLER(flash_command_get_bank, 0, &bank);
-	if (retval != ERROR_OK)
-		return retval;
-
-	stmqspi_info = bank->driver_priv;
-	target = bank->target;
-
-	if (target->state != TARGET_HALTED) {
-		LOG_ERROR("Target not halted");
-		return ERROR_TARGET_NOT_HALTED;
-	}
-
-	if (!(stmqspi_info->probed)) {
-		LOG_ERROR("Flash bank not probed");
-		return ERROR_FLASH_BANK_NOT_PROBED;
-	}
-
-	if (stmqspi_info->dev.chip_erase_cmd == 0x00) {
-		LOG_ERROR("Mass erase not available for this device");
-		return ERROR_FLASH_OPER_UNSUPPORTED;
-	}
-
-	for (sector = 0; sector < bank->num_sectors; sector++) {
-		if (bank->sectors[sector].is_protected) {
-			LOG_ERROR("Flash sector %u protected", sector);
-			return ERROR_FLASH_PROTECTED;
-		}
-	}
-
-	io_base = stmqspi_info->io_base;
-	duration_start(&bench);
-
 	retval = qspi_write_enable(bank);
 	if (retval != ERROR_OK)
 		goto err;
@@ -577,6 +566,55 @@ COMMAND_HANDLER(stmqspi_handle_mass_erase_command)
 	/* Poll WIP for end of self timed Sector Erase cycle */
 	retval = wait_till_ready(bank, SPI_MASS_ERASE_TIMEOUT);
 
+err:
+	return retval;
+}
+
+COMMAND_HANDLER(stmqspi_handle_mass_erase_command)
+{
+	struct target *target = NULL;
+	struct flash_bank *bank;
+	struct stmqspi_flash_bank *stmqspi_info;
+	struct duration bench;
+	unsigned int sector;
+	int retval;
+
+	LOG_DEBUG("%s", __func__);
+
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	retval = CALL_COMMAND_HANDLER(flash_command_get_bank, 0, &bank);
+	if (retval != ERROR_OK)
+		return retval;
+
+	stmqspi_info = bank->driver_priv;
+	target = bank->target;
+
+	if (target->state != TARGET_HALTED) {
+		LOG_ERROR("Target not halted");
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	if (!(stmqspi_info->probed)) {
+		LOG_ERROR("Flash bank not probed");
+		return ERROR_FLASH_BANK_NOT_PROBED;
+	}
+
+	if (stmqspi_info->dev.chip_erase_cmd == 0x00) {
+		LOG_ERROR("Mass erase not available for this device");
+		return ERROR_FLASH_OPER_UNSUPPORTED;
+	}
+
+	for (sector = 0; sector < bank->num_sectors; sector++) {
+		if (bank->sectors[sector].is_protected) {
+			LOG_ERROR("Flash sector %u protected", sector);
+			return ERROR_FLASH_PROTECTED;
+		}
+	}
+
+	duration_start(&bench);
+	retval = stmqspi_mass_erase(bank);
 	duration_measure(&bench);
 	if (retval == ERROR_OK)
 		command_print(CMD, "stmqspi mass erase completed in %fs (%0.3f KiB/s)",
@@ -586,7 +624,6 @@ COMMAND_HANDLER(stmqspi_handle_mass_erase_command)
 		command_print(CMD, "stmqspi mass erase not completed even after %fs",
 			duration_elapsed(&bench));
 
-err:
 	/* Switch to memory mapped mode before return to prompt */
 	set_mm_mode(bank);
 
@@ -1028,6 +1065,24 @@ static int stmqspi_erase(struct flash_bank *bank, unsigned int first, unsigned i
 		}
 	}
 
+	/* one chip erase instead of many sector erases for the whole device(s) */
+	if (first == 0 && last == (bank->num_sectors - 1) && bank->num_sectors > 1 &&
+		stmqspi_info->dev.chip_erase_cmd != 0x00 &&
+		stmqspi_info->dev.chip_erase_cmd != stmqspi_info->dev.erase_cmd) {
+		LOG_DEBUG("Trying mass erase.");
+		retval = stmqspi_mass_erase(bank);
+		if (retval == ERROR_OK) {
+			set_mm_mode(bank);
+			return retval;
+		}
+		LOG_WARNING("Mass erase failed. Falling back to sector erase.");
+		retval = wait_till_ready(bank, SPI_MASS_ERASE_TIMEOUT);
+		if (retval != ERROR_OK) {
+			set_mm_mode(bank);
+			return retval;
+		}
+	}
+
 	for (sector = first; sector <= last; sector++) {
 		retval = qspi_erase_sector(bank, sector);
 		if (retval != ERROR_OK)
@@ -1591,6 +1646,16 @@ static int stmqspi_read(struct flash_bank *bank, uint8_t *buffer,
 		count = bank->size - offset;
 	}
 
+	/* Plain bus reads through the memory mapped area are fastest */
+	if (stmqspi_mm_usable(bank, offset, count)) {
+		retval = set_mm_mode(bank);
+		if (retval == ERROR_OK)
+			retval = target_read_buffer(target, bank->base + offset, count, buffer);
+		if (retval == ERROR_OK)
+			return ERROR_OK;
+		LOG_DEBUG("memory mapped read failed, using indirect read");
+	}
+
 	/* Abort any previous operation */
 	retval = stmqspi_abort(bank);
 	if (retval != ERROR_OK)
@@ -1701,6 +1766,24 @@ static int stmqspi_verify(struct flash_bank *bank, const uint8_t *buffer,
 		return ERROR_FLASH_DST_BREAKS_ALIGNMENT;
 	}
 
+	/* Let the target checksum the memory mapped area, no loader needed */
+	if (stmqspi_mm_usable(bank, offset, count)) {
+		uint32_t target_crc, image_crc;
+
+		retval = set_mm_mode(bank);
+		if (retval == ERROR_OK)
+			retval = target_checksum_memory(target, bank->base + offset, count, &target_crc);
+		if (retval == ERROR_OK) {
+			retval = image_calculate_checksum(buffer, count, &image_crc);
+			if (retval != ERROR_OK)
+				return retval;
+			LOG_DEBUG("addr " TARGET_ADDR_FMT ", len 0x%08" PRIx32 ", crc 0x%08" PRIx32 " 0x%08" PRIx32,
+				offset + bank->base, count, image_crc, target_crc);
+			return (image_crc == target_crc) ? ERROR_OK : ERROR_FAIL;
+		}
+		LOG_DEBUG("memory mapped checksum failed, using indirect read");
+	}
+
 	/* Abort any previous operation */
 	retval = stmqspi_abort(bank);
 	if (retval != ERROR_OK)
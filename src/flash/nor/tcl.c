@@ -393,7 +393,7 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 {
 	struct target *target = get_current_target(CMD_CTX);
 
-	struct image image;
+	struct image *image;
 	uint32_t written;
 
 	int retval;
@@ -401,6 +401,7 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 	/* flash auto-erase is disabled by default*/
 	int auto_erase = 0;
 	bool auto_unlock = false;
+	bool skip_unchanged = false;
 
 	while (CMD_ARGC) {
 		if (strcmp(CMD_ARGV[0], "erase") == 0) {
@@ -413,6 +414,11 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 			CMD_ARGV++;
 			CMD_ARGC--;
 			command_print(CMD, "auto unlock enabled");
+		} else if (strcmp(CMD_ARGV[0], "skip_unchanged") == 0) {
+			skip_unchanged = true;
+			CMD_ARGV++;
+			CMD_ARGC--;
+			command_print(CMD, "unchanged sectors are skipped");
 		} else
 			break;
 	}
@@ -428,24 +434,22 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 	struct duration bench;
 	duration_start(&bench);
 
+	bool base_address_set = false;
+	long long base_address = 0x0;
 	if (CMD_ARGC >= 2) {
-		image.base_address_set = true;
-		COMMAND_PARSE_NUMBER(llong, CMD_ARGV[1], image.base_address);
-	} else {
-		image.base_address_set = false;
-		image.base_address = 0x0;
+		base_address_set = true;
+		COMMAND_PARSE_NUMBER(llong, CMD_ARGV[1], base_address);
 	}
 
-	image.start_address_set = false;
-
-	retval = image_open(&image, CMD_ARGV[0], (CMD_ARGC == 3) ? CMD_ARGV[2] : NULL);
+	retval = image_open_cached(&image, CMD_ARGV[0], base_address_set, base_address,
+		(CMD_ARGC == 3) ? CMD_ARGV[2] : NULL);
 	if (retval != ERROR_OK)
 		return retval;
 
-	retval = flash_write_unlock_verify(target, &image, &written, auto_erase,
-		auto_unlock, true, false);
+	retval = flash_write_unlock_verify(target, image, &written, auto_erase,
+		auto_unlock, true, false, skip_unchanged);
 	if (retval != ERROR_OK) {
-		image_close(&image);
+		image_release(image);
 		return retval;
 	}
 
@@ -455,7 +459,7 @@ COMMAND_HANDLER(handle_flash_write_image_command)
 			duration_elapsed(&bench), duration_kbps(&bench, written));
 	}
 
-	image_close(&image);
+	image_release(image);
 
 	return retval;
 }
@@ -464,7 +468,7 @@ COMMAND_HANDLER(handle_flash_verify_image_command)
 {
 	struct target *target = get_current_target(CMD_CTX);
 
-	struct image image;
+	struct image *image;
 	uint32_t verified;
 
 	int retval;
@@ -480,24 +484,22 @@ COMMAND_HANDLER(handle_flash_verify_image_command)
 	struct duration bench;
 	duration_start(&bench);
 
+	bool base_address_set = false;
+	long long base_address = 0x0;
 	if (CMD_ARGC >= 2) {
-		image.base_address_set = 1;
-		COMMAND_PARSE_NUMBER(llong, CMD_ARGV[1], image.base_address);
-	} else {
-		image.base_address_set = 0;
-		image.base_address = 0x0;
+		base_address_set = true;
+		COMMAND_PARSE_NUMBER(llong, CMD_ARGV[1], base_address);
 	}
 
-	image.start_address_set = 0;
-
-	retval = image_open(&image, CMD_ARGV[0], (CMD_ARGC == 3) ? CMD_ARGV[2] : NULL);
+	retval = image_open_cached(&image, CMD_ARGV[0], base_address_set, base_address,
+		(CMD_ARGC == 3) ? CMD_ARGV[2] : NULL);
 	if (retval != ERROR_OK)
 		return retval;
 
-	retval = flash_write_unlock_verify(target, &image, &verified, false,
-		false, false, true);
+	retval = flash_write_unlock_verify(target, image, &verified, false,
+		false, false, true, false);
 	if (retval != ERROR_OK) {
-		image_close(&image);
+		image_release(image);
 		return retval;
 	}
 
@@ -507,7 +509,7 @@ COMMAND_HANDLER(handle_flash_verify_image_command)
 			duration_elapsed(&bench), duration_kbps(&bench, verified));
 	}
 
-	image_close(&image);
+	image_release(image);
 
 	return retval;
 }
@@ -623,7 +625,7 @@ COMMAND_HANDLER(handle_flash_fill_command)
 	if (retval != ERROR_OK)
 		goto done;
 
-	retval = flash_driver_read(bank, buffer, address - bank->base, size_bytes);
+	retval = flash_driver_read_uncached(bank, buffer, address - bank->base, size_bytes);
 	if (retval != ERROR_OK)
 		goto done;
 
@@ -1007,7 +1009,7 @@ COMMAND_HANDLER(handle_flash_verify_bank_command)
 		return ERROR_FAIL;
 	}
 
-	retval = flash_driver_read(p, buffer_flash, offset, length);
+	retval = flash_driver_read_uncached(p, buffer_flash, offset, length);
 	if (retval != ERROR_OK) {
 		LOG_ERROR("Flash read error");
 		free(buffer_flash);
@@ -1073,6 +1075,37 @@ COMMAND_HANDLER(handle_flash_padded_value_command)
 	return retval;
 }
 
+COMMAND_HANDLER(handle_flash_cache_command)
+{
+	if (CMD_ARGC < 1 || CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct flash_bank *p;
+	int retval = CALL_COMMAND_HANDLER(flash_command_get_bank, 0, &p);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (CMD_ARGC == 2) {
+		bool enable;
+		COMMAND_PARSE_ON_OFF(CMD_ARGV[1], enable);
+		retval = flash_cache_enable(p, enable);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	if (!p->cache) {
+		command_print(CMD, "flash bank %u cache off", p->bank_number);
+		return ERROR_OK;
+	}
+
+	unsigned int valid_sectors, hits, misses;
+	flash_cache_stats(p, &valid_sectors, &hits, &misses);
+	command_print(CMD, "flash bank %u cache on, %u of %u sectors cached, %u hits, %u misses",
+			p->bank_number, valid_sectors, p->num_sectors, hits, misses);
+
+	return ERROR_OK;
+}
+
 static const struct command_registration flash_exec_command_handlers[] = {
 	{
 		.name = "probe",
@@ -1182,9 +1215,10 @@ static const struct command_registration flash_exec_command_handlers[] = {
 		.name = "write_image",
 		.handler = handle_flash_write_image_command,
 		.mode = COMMAND_EXEC,
-		.usage = "[erase] [unlock] filename [offset [file_type]]",
+		.usage = "[erase] [unlock] [skip_unchanged] filename [offset [file_type]]",
 		.help = "Write an image to flash.  Optionally first unprotect "
-			"and/or erase the region to be used. Allow optional "
+			"and/or erase the region to be used. Optionally skip the "
+			"sectors already holding the image content. Allow optional "
 			"offset from beginning of bank (defaults to zero)",
 	},
 	{
@@ -1229,6 +1263,14 @@ static const struct command_registration flash_exec_command_handlers[] = {
 		.usage = "bank_id value",
 		.help = "Set default flash padded value",
 	},
+	{
+		.name = "cache",
+		.handler = handle_flash_cache_command,
+		.mode = COMMAND_EXEC,
+		.usage = "bank_id ['on'|'off']",
+		.help = "Keep a host copy of the flash bank content to answer "
+			"reads without accessing the target.",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -1349,6 +1391,66 @@ COMMAND_HANDLER(handle_flash_list)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_flash_image_cache_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		bool enable;
+		COMMAND_PARSE_ON_OFF(CMD_ARGV[0], enable);
+		image_cache_enable(enable);
+	}
+
+	const char *filename = image_cache_filename();
+	if (filename)
+		command_print(CMD, "flash image cache on, holding %s", filename);
+	else
+		command_print(CMD, "flash image cache %s",
+			image_cache_enabled() ? "on" : "off");
+
+	return ERROR_OK;
+}
+
+static const char * const flash_stats_op_names[FLASH_STATS_NUM] = {
+	[FLASH_STATS_PROTECT] = "protect",
+	[FLASH_STATS_ERASE] = "erase",
+	[FLASH_STATS_WRITE] = "write",
+	[FLASH_STATS_READ] = "read",
+	[FLASH_STATS_VERIFY] = "verify",
+};
+
+COMMAND_HANDLER(handle_flash_stats_command)
+{
+	bool reset = false;
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		if (strcmp(CMD_ARGV[0], "reset") != 0)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		reset = true;
+	}
+
+	for (struct flash_bank *p = flash_bank_list(); p; p = p->next) {
+		command_print(CMD, "{\n"
+			"    name       %s", p->name);
+		for (unsigned int op = 0; op < FLASH_STATS_NUM; op++) {
+			const struct flash_op_stats *stats = &p->stats[op];
+			command_print(CMD, "    %-10s {calls %u errors %u bytes %" PRIu64
+				" time_us %" PRIu64 "}", flash_stats_op_names[op],
+				stats->calls, stats->errors, stats->bytes, stats->elapsed_us);
+		}
+		command_print(CMD, "}");
+
+		if (reset)
+			flash_stats_reset(p);
+	}
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_flash_init_command)
 {
 	if (CMD_ARGC != 0)
@@ -1390,6 +1492,22 @@ static const struct command_registration flash_config_command_handlers[] = {
 		.help = "Display table with information about flash banks.",
 		.usage = "",
 	},
+	{
+		.name = "image_cache",
+		.mode = COMMAND_ANY,
+		.handler = handle_flash_image_cache_command,
+		.help = "Keep the last image written or verified open, to reuse it "
+			"while the file content is unchanged.",
+		.usage = "['on'|'off']",
+	},
+	{
+		.name = "stats",
+		.mode = COMMAND_ANY,
+		.handler = handle_flash_stats_command,
+		.help = "Report time and bytes spent in each flash operation, "
+			"per flash bank, and optionally clear them.",
+		.usage = "['reset']",
+	},
 	{
 		.name = "list",
 		.mode = COMMAND_ANY,
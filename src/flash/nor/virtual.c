@@ -99,7 +99,7 @@ static int virtual_erase(struct flash_bank *bank, unsigned int first,
 		return ERROR_FLASH_OPERATION_FAILED;
 
 	/* call master handler */
-	retval = master_bank->driver->erase(master_bank, first, last);
+	retval = flash_driver_erase(master_bank, first, last);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -116,7 +116,7 @@ static int virtual_write(struct flash_bank *bank, const uint8_t *buffer,
 		return ERROR_FLASH_OPERATION_FAILED;
 
 	/* call master handler */
-	retval = master_bank->driver->write(master_bank, buffer, offset, count);
+	retval = flash_driver_write(master_bank, buffer, offset, count);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -200,7 +200,7 @@ static int virtual_flash_read(struct flash_bank *bank,
 		return ERROR_FLASH_OPERATION_FAILED;
 
 	/* call master handler */
-	retval = master_bank->driver->read(master_bank, buffer, offset, count);
+	retval = flash_driver_read(master_bank, buffer, offset, count);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -92,7 +92,15 @@ bool buf_eq_mask(const void *_buf1, const void *_buf2,
 
 	const uint8_t *buf1 = _buf1, *buf2 = _buf2, *mask = _mask;
 	unsigned int last = size / 8;
-	for (unsigned int i = 0; i < last; i++) {
+	unsigned int i = 0;
+
+	/* 64 bits at a time, the byte order does not matter here */
+	for (; i + 8 <= last; i += 8) {
+		uint64_t diff = le_to_h_u64(buf1 + i) ^ le_to_h_u64(buf2 + i);
+		if (diff & le_to_h_u64(mask + i))
+			return false;
+	}
+	for (; i < last; i++) {
 		if (!buf_eq_masked(buf1[i], buf2[i], mask[i]))
 			return false;
 	}
@@ -122,7 +130,7 @@ void *buf_set_buf(const void *_src, unsigned int src_start,
 {
 	const uint8_t *src = _src;
 	uint8_t *dst = _dst;
-	unsigned int i, sb, db, sq, dq, lb, lq;
+	unsigned int sb, db, sq, dq, lb, lq;
 
 	sb = src_start / 8;
 	db = dst_start / 8;
@@ -138,25 +146,56 @@ void *buf_set_buf(const void *_src, unsigned int src_start,
 	 * len is a multiple of 8bit so we can simple copy
 	 * the buffer */
 	if ((sq == 0) && (dq == 0) &&  (lq == 0)) {
-		for (i = 0; i < lb; i++)
-			*dst++ = *src++;
+		memcpy(dst, src, lb);
 		return _dst;
 	}
 
-	/* fallback to slow bit copy */
-	for (i = 0; i < len; i++) {
-		if (((*src >> (sq&7)) & 1) == 1)
-			*dst |= 1 << (dq&7);
-		else
-			*dst &= ~(1 << (dq&7));
-		if (sq++ == 7) {
-			sq = 0;
-			src++;
-		}
-		if (dq++ == 7) {
-			dq = 0;
-			dst++;
-		}
+	/* unaligned copy: complete the first destination byte, then fill the
+	 * destination 64 bits at a time and byte by byte for the rest */
+	if (dq != 0) {
+		unsigned int n = MIN(8 - dq, len);
+
+		unsigned int bits = *src >> sq;
+		if (sq + n > 8)
+			bits |= src[1] << (8 - sq);
+
+		uint8_t mask = ((1U << n) - 1) << dq;
+		*dst = (*dst & ~mask) | ((bits << dq) & mask);
+
+		len -= n;
+		dst++;
+		dq = 0;
+		sq += n;
+		src += sq / 8;
+		sq %= 8;
+	}
+
+	for (; len >= 64; len -= 64) {
+		uint64_t bits = le_to_h_u64(src) >> sq;
+		if (sq)
+			bits |= (uint64_t)src[8] << (64 - sq);
+		h_u64_to_le(dst, bits);
+		src += 8;
+		dst += 8;
+	}
+
+	while (len > 0) {
+		unsigned int n = MIN(8 - dq, len);
+
+		/* the n bits may straddle two source bytes */
+		unsigned int bits = *src >> sq;
+		if (sq + n > 8)
+			bits |= src[1] << (8 - sq);
+
+		uint8_t mask = ((1U << n) - 1) << dq;
+		*dst = (*dst & ~mask) | ((bits << dq) & mask);
+
+		len -= n;
+		dst++;
+		dq = 0;
+		sq += n;
+		src += sq / 8;
+		sq %= 8;
 	}
 
 	return _dst;
@@ -397,7 +436,7 @@ size_t hexify(char *hex, const uint8_t *bin, size_t count, size_t length)
 
 void buffer_shr(void *_buf, unsigned int buf_len, unsigned int count)
 {
-	unsigned int i;
+	unsigned int i = 0;
 	unsigned char *buf = _buf;
 	unsigned int bytes_to_remove;
 	unsigned int shift;
@@ -405,10 +444,19 @@ void buffer_shr(void *_buf, unsigned int buf_len, unsigned int count)
 	bytes_to_remove = count / 8;
 	shift = count - (bytes_to_remove * 8);
 
-	for (i = 0; i < (buf_len - 1); i++)
-		buf[i] = (buf[i] >> shift) | ((buf[i+1] << (8 - shift)) & 0xff);
+	if (shift) {
+		/* each word only reads bytes not yet shifted */
+		for (; i + 8 < buf_len; i += 8) {
+			uint64_t v = le_to_h_u64(&buf[i]) >> shift;
+			v |= (uint64_t)buf[i + 8] << (64 - shift);
+			h_u64_to_le(&buf[i], v);
+		}
+
+		for (; i < (buf_len - 1); i++)
+			buf[i] = (buf[i] >> shift) | ((buf[i+1] << (8 - shift)) & 0xff);
 
-	buf[(buf_len - 1)] = buf[(buf_len - 1)] >> shift;
+		buf[(buf_len - 1)] = buf[(buf_len - 1)] >> shift;
+	}
 
 	if (bytes_to_remove) {
 		memmove(buf, &buf[bytes_to_remove], buf_len - bytes_to_remove);
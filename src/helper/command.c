@@ -23,6 +23,7 @@
 #include <target/target.h>
 #include "command.h"
 #include "configuration.h"
+#include "jim_pool.h"
 #include "log.h"
 #include "time_support.h"
 #include "jim-eventloop.h"
@@ -30,6 +31,9 @@
 /* nice short description of source file */
 #define __THIS__FILE__ "command.c"
 
+/* Commands with up to this many words don't allocate the words array */
+#define COMMAND_WORDS_ON_STACK 8
+
 struct log_capture_state {
 	Jim_Interp *interp;
 	Jim_Obj *output;
@@ -38,8 +42,8 @@ struct log_capture_state {
 static int unregister_command(struct command_context *context,
 	const char *cmd_prefix, const char *name);
 static int jim_command_dispatch(Jim_Interp *interp, int argc, Jim_Obj * const *argv);
-static int help_add_command(struct command_context *cmd_ctx,
-	const char *cmd_name, const char *help_text, const char *usage_text);
+static int help_add_command(struct command_context *cmd_ctx, const char *cmd_name,
+	const char *help_text, const char *usage_text, bool copy);
 static int help_del_command(struct command_context *cmd_ctx, const char *cmd_name);
 
 /* set of functions to wrap jimtcl internal data */
@@ -221,9 +225,11 @@ static struct command *command_new(struct command_context *cmd_ctx,
 	c->handler = cr->handler;
 	c->jim_handler = cr->jim_handler;
 	c->mode = cr->mode;
+	c->fast = cr->fast;
 
+	/* the texts of the registrations are literals, no need to copy them */
 	if (cr->help || cr->usage)
-		help_add_command(cmd_ctx, full_name, cr->help, cr->usage);
+		help_add_command(cmd_ctx, full_name, cr->help, cr->usage, false);
 
 	return c;
 }
@@ -440,6 +446,15 @@ void command_print_sameline(struct command_invocation *cmd, const char *format,
 	va_end(ap);
 }
 
+void command_print_binary(struct command_invocation *cmd, const void *data, size_t len)
+{
+	if (!cmd)
+		return;
+
+	Jim_AppendString(cmd->ctx->interp, cmd->output, data, len);
+	cmd->output_binary = true;
+}
+
 void command_print(struct command_invocation *cmd, const char *format, ...)
 {
 	char *string;
@@ -495,11 +510,15 @@ static int exec_command(Jim_Interp *interp, struct command_context *context,
 	if (c->jim_handler)
 		return c->jim_handler(interp, argc, argv);
 
-	/* use c->handler */
-	const char **words = malloc(argc * sizeof(char *));
-	if (!words) {
-		LOG_ERROR("Out of memory");
-		return JIM_ERR;
+	/* use c->handler, the words of short commands stay on the stack */
+	const char *words_buf[COMMAND_WORDS_ON_STACK];
+	const char **words = words_buf;
+	if (argc > COMMAND_WORDS_ON_STACK) {
+		words = malloc(argc * sizeof(char *));
+		if (!words) {
+			LOG_ERROR("Out of memory");
+			return JIM_ERR;
+		}
 	}
 
 	for (int i = 0; i < argc; i++)
@@ -532,15 +551,16 @@ static int exec_command(Jim_Interp *interp, struct command_context *context,
 		 * Drop last '\n' to allow command output concatenation
 		 * while keep using command_print() everywhere.
 		 */
-		const char *output_txt = Jim_String(cmd.output);
-		int len = strlen(output_txt);
-		if (len && output_txt[len - 1] == '\n')
+		int len;
+		const char *output_txt = Jim_GetString(cmd.output, &len);
+		if (len && output_txt[len - 1] == '\n' && !cmd.output_binary)
 			--len;
 		Jim_SetResultString(context->interp, output_txt, len);
 	}
 	Jim_DecrRefCount(context->interp, cmd.output);
 
-	free(words);
+	if (words != words_buf)
+		free(words);
 	return command_retval_set(interp, retval);
 }
 
@@ -710,8 +730,11 @@ static int jim_capture(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
 struct help_entry {
 	struct list_head lh;
 	char *cmd_name;
-	char *help;
-	char *usage;
+	const char *help;
+	const char *usage;
+	/* help and usage were allocated by help_add_command() */
+	bool help_alloc;
+	bool usage_alloc;
 };
 
 static COMMAND_HELPER(command_help_show, struct help_entry *c,
@@ -884,8 +907,10 @@ static char *alloc_concatenate_strings(int argc, Jim_Obj * const *argv)
 
 static int jim_command_dispatch(Jim_Interp *interp, int argc, Jim_Obj * const *argv)
 {
+	struct command *c = jim_to_command(interp);
+
 	/* check subcommands */
-	if (argc > 1) {
+	if (argc > 1 && !c->fast) {
 		char *s = alloc_printf("%s %s", Jim_GetString(argv[0], NULL), Jim_GetString(argv[1], NULL));
 		Jim_Obj *js = Jim_NewStringObj(interp, s, -1);
 		Jim_IncrRefCount(js);
@@ -901,7 +926,6 @@ static int jim_command_dispatch(Jim_Interp *interp, int argc, Jim_Obj * const *a
 
 	script_debug(interp, argc, argv);
 
-	struct command *c = jim_to_command(interp);
 	if (!c->jim_handler && !c->handler) {
 		Jim_EvalObjPrefix(interp, Jim_NewStringObj(interp, "usage", -1), 1, argv);
 		return JIM_ERR;
@@ -985,17 +1009,23 @@ static int jim_command_mode(Jim_Interp *interp, int argc, Jim_Obj *const *argv)
 	return JIM_OK;
 }
 
+static void help_entry_free(struct help_entry *entry)
+{
+	list_del(&entry->lh);
+	free(entry->cmd_name);
+	if (entry->help_alloc)
+		free((char *)entry->help);
+	if (entry->usage_alloc)
+		free((char *)entry->usage);
+	free(entry);
+}
+
 int help_del_all_commands(struct command_context *cmd_ctx)
 {
 	struct help_entry *curr, *n;
 
-	list_for_each_entry_safe(curr, n, cmd_ctx->help_list, lh) {
-		list_del(&curr->lh);
-		free(curr->cmd_name);
-		free(curr->help);
-		free(curr->usage);
-		free(curr);
-	}
+	list_for_each_entry_safe(curr, n, cmd_ctx->help_list, lh)
+		help_entry_free(curr);
 	return ERROR_OK;
 }
 
@@ -1005,11 +1035,7 @@ static int help_del_command(struct command_context *cmd_ctx, const char *cmd_nam
 
 	list_for_each_entry(curr, cmd_ctx->help_list, lh) {
 		if (!strcmp(cmd_name, curr->cmd_name)) {
-			list_del(&curr->lh);
-			free(curr->cmd_name);
-			free(curr->help);
-			free(curr->usage);
-			free(curr);
+			help_entry_free(curr);
 			break;
 		}
 	}
@@ -1017,8 +1043,32 @@ static int help_del_command(struct command_context *cmd_ctx, const char *cmd_nam
 	return ERROR_OK;
 }
 
-static int help_add_command(struct command_context *cmd_ctx,
-	const char *cmd_name, const char *help_text, const char *usage_text)
+/* Replaces one text of a help entry, copied unless it outlives the entry */
+static int help_set_text(const char **text, bool *text_alloc, const char *new_text, bool copy)
+{
+	if (copy) {
+		new_text = strdup(new_text);
+		if (!new_text) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+	}
+
+	if (*text_alloc)
+		free((char *)*text);
+	*text = new_text;
+	*text_alloc = copy;
+
+	return ERROR_OK;
+}
+
+/**
+ * Adds or updates the help entry of a command.
+ * @param copy false when the texts are string literals, e.g. from a
+ * command_registration, which are then referenced instead of duplicated.
+ */
+static int help_add_command(struct command_context *cmd_ctx, const char *cmd_name,
+	const char *help_text, const char *usage_text, bool copy)
 {
 	int cmp = -1; /* add after curr */
 	struct help_entry *curr;
@@ -1048,23 +1098,15 @@ static int help_add_command(struct command_context *cmd_ctx,
 	}
 
 	if (help_text) {
-		char *text = strdup(help_text);
-		if (!text) {
-			LOG_ERROR("Out of memory");
-			return ERROR_FAIL;
-		}
-		free(entry->help);
-		entry->help = text;
+		int retval = help_set_text(&entry->help, &entry->help_alloc, help_text, copy);
+		if (retval != ERROR_OK)
+			return retval;
 	}
 
 	if (usage_text) {
-		char *text = strdup(usage_text);
-		if (!text) {
-			LOG_ERROR("Out of memory");
-			return ERROR_FAIL;
-		}
-		free(entry->usage);
-		entry->usage = text;
+		int retval = help_set_text(&entry->usage, &entry->usage_alloc, usage_text, copy);
+		if (retval != ERROR_OK)
+			return retval;
 	}
 
 	return ERROR_OK;
@@ -1082,7 +1124,7 @@ COMMAND_HANDLER(handle_help_add_command)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 	}
 	const char *cmd_name = CMD_ARGV[0];
-	return help_add_command(CMD_CTX, cmd_name, help, usage);
+	return help_add_command(CMD_CTX, cmd_name, help, usage, true);
 }
 
 /* sleep command sleeps for <n> milliseconds
@@ -1218,6 +1260,9 @@ struct command_context *command_init(const char *startup_tcl, Jim_Interp *interp
 
 	/* Create a jim interpreter if we were not handed one */
 	if (!interp) {
+#if BUILD_JIM_POOL
+		jim_pool_install();
+#endif
 		/* Create an interpreter */
 		interp = Jim_CreateInterp();
 		/* Add all the Jim core commands */
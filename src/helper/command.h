@@ -81,6 +81,8 @@ struct command_invocation {
 	const char **argv;
 	Jim_Obj * const *jimtcl_argv;
 	Jim_Obj *output;
+	/* output is binary data, returned as is */
+	bool output_binary;
 };
 
 /**
@@ -203,6 +205,8 @@ struct command {
 	struct target *jim_override_target;
 		/* Used only for target of target-prefixed cmd */
 	enum command_mode mode;
+	bool fast;
+		/* Dispatched without the subcommand lookup, see command_registration */
 };
 
 /*
@@ -240,6 +244,14 @@ struct command_registration {
 	/** a string listing the options and arguments, required or optional */
 	const char *usage;
 
+	/**
+	 * Lightweight dispatch for the commands issued at high rate, e.g. by
+	 * TCL RPC clients. The command must have no subcommand, neither
+	 * registered nor defined later by a Tcl proc: the dispatcher does not
+	 * look up "name argv[1]" before calling the handler.
+	 */
+	bool fast;
+
 	/**
 	 * If non-NULL, the commands in @c chain will be registered in
 	 * the same context and scope of this registration record.
@@ -391,6 +403,13 @@ __attribute__ ((format (PRINTF_ATTRIBUTE_FORMAT, 2, 3)));
 void command_print_sameline(struct command_invocation *cmd, const char *format, ...)
 __attribute__ ((format (PRINTF_ATTRIBUTE_FORMAT, 2, 3)));
 
+/*
+ * command_print_binary() appends raw bytes to the command output, e.g. for
+ * a Tcl byte string result. The output of the command is then returned
+ * unmodified, the last '\n' is not stripped.
+ */
+void command_print_binary(struct command_invocation *cmd, const void *data, size_t len);
+
 int command_run_line(struct command_context *context, char *line);
 int command_run_linef(struct command_context *context, const char *format, ...)
 __attribute__ ((format (PRINTF_ATTRIBUTE_FORMAT, 2, 3)));
@@ -13,6 +13,7 @@
 #endif
 
 #include "crc32.h"
+#include <stdbool.h>
 #include <stdint.h>
 #include <stddef.h>
 
@@ -30,20 +31,77 @@ static uint32_t crc_le_step(uint32_t poly, uint32_t crc, uint32_t data_in,
 	return crc;
 }
 
+/*
+ * Slicing tables for the last polynomial used: entry [k][i] is the CRC of
+ * byte i followed by k zero bytes. All the users share the same polynomial,
+ * so the tables are computed only once.
+ */
+static uint32_t crc_le_table[8][256];
+static uint32_t crc_le_table_poly;
+static bool crc_le_table_valid;
+
+static void crc_le_init_table(uint32_t poly)
+{
+	if (crc_le_table_valid && crc_le_table_poly == poly)
+		return;
+
+	for (unsigned int i = 0; i < 256; i++)
+		crc_le_table[0][i] = crc_le_step(poly, 0, i, 8);
+
+	for (unsigned int k = 1; k < 8; k++)
+		for (unsigned int i = 0; i < 256; i++) {
+			uint32_t c = crc_le_table[k - 1][i];
+			crc_le_table[k][i] = (c >> 8) ^ crc_le_table[0][c & 0xff];
+		}
+
+	crc_le_table_poly = poly;
+	crc_le_table_valid = true;
+}
+
+static inline uint32_t crc_le_byte(uint32_t crc, uint8_t data_in)
+{
+	return (crc >> 8) ^ crc_le_table[0][(crc ^ data_in) & 0xff];
+}
+
+/* process one 32 bit word, least significant bit first */
+static inline uint32_t crc_le_word(uint32_t crc, uint32_t data_in)
+{
+	crc ^= data_in;
+	return crc_le_table[3][crc & 0xff] ^
+		crc_le_table[2][(crc >> 8) & 0xff] ^
+		crc_le_table[1][(crc >> 16) & 0xff] ^
+		crc_le_table[0][crc >> 24];
+}
+
 uint32_t crc32_le(uint32_t poly, uint32_t seed, const void *_data,
 		size_t data_len)
 {
+	crc_le_init_table(poly);
+
 	if (((uintptr_t)_data & 0x3) || (data_len & 0x3)) {
 		/* data is unaligned, processing data one byte at a time */
 		const uint8_t *data = _data;
 		for (size_t i = 0; i < data_len; i++)
-			seed = crc_le_step(poly, seed, data[i], 8);
+			seed = crc_le_byte(seed, data[i]);
 	} else {
-		/* data is aligned, processing 32 bit at a time */
+		/* data is aligned, processing 32 bit at a time, 64 bit when possible */
 		data_len >>= 2;
 		const uint32_t *data = _data;
-		for (size_t i = 0; i < data_len; i++)
-			seed = crc_le_step(poly, seed, data[i], 32);
+		size_t i = 0;
+		for (; i + 1 < data_len; i += 2) {
+			uint32_t crc = seed ^ data[i];
+			uint32_t next = data[i + 1];
+			seed = crc_le_table[7][crc & 0xff] ^
+				crc_le_table[6][(crc >> 8) & 0xff] ^
+				crc_le_table[5][(crc >> 16) & 0xff] ^
+				crc_le_table[4][crc >> 24] ^
+				crc_le_table[3][next & 0xff] ^
+				crc_le_table[2][(next >> 8) & 0xff] ^
+				crc_le_table[1][(next >> 16) & 0xff] ^
+				crc_le_table[0][next >> 24];
+		}
+		if (i < data_len)
+			seed = crc_le_word(seed, data[i]);
 	}
 
 	return seed;
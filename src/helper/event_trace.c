@@ -0,0 +1,266 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/**
+ * @file
+ * Binary trace of the adapter and DAP traffic, for offline analysis.
+ *
+ * The text debug logs of the traffic cost more than the traffic itself.
+ * Here every event is a small fixed record written to a fully buffered
+ * file; contrib/event_trace_decode.py turns it back into text.
+ *
+ * All the fields are little endian.
+ * - file header (24 bytes): "OOCDEVTR", u32 version, u32 mask of the
+ *   traced subsystems, u64 host time of the start in us.
+ * - records: u64 host time in us relative to the start, u16 event id,
+ *   u8 subsystem, u8 number of arguments, u32 data length, then the
+ *   u32 arguments and the data padded to 4 bytes.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "align.h"
+#include "command.h"
+#include "event_trace.h"
+#include "log.h"
+#include "time_support.h"
+
+#define EVENT_TRACE_VERSION			1
+#define EVENT_TRACE_FILE_HDR_SIZE	24
+#define EVENT_TRACE_RECORD_HDR_SIZE	16
+#define EVENT_TRACE_MAX_ARGS		16
+
+/* Stdio buffer of the trace file */
+#define EVENT_TRACE_BUFFER_SIZE		(256 * 1024)
+
+static const char * const event_trace_subsys_name[EVENT_TRACE_SUBSYS_NUM] = {
+	[EVENT_TRACE_JTAG] = "jtag",
+	[EVENT_TRACE_DAP] = "dap",
+	[EVENT_TRACE_CMSIS_DAP] = "cmsis-dap",
+};
+
+uint32_t event_trace_mask;
+
+static struct {
+	FILE *file;
+	char *filename;
+	uint64_t start_us;
+	uint64_t records;
+	uint64_t bytes;
+	bool error;
+} event_trace;
+
+static uint64_t event_trace_time_us(void)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_usec;
+}
+
+void event_trace_write(enum event_trace_subsys subsys, enum event_trace_id id,
+	const uint32_t *args, unsigned int num_args, const uint8_t *data, size_t size)
+{
+	uint8_t hdr[EVENT_TRACE_RECORD_HDR_SIZE + 4 * EVENT_TRACE_MAX_ARGS];
+	static const uint8_t padding[4];
+
+	if (!event_trace.file || event_trace.error)
+		return;
+
+	assert(num_args <= EVENT_TRACE_MAX_ARGS);
+
+	h_u64_to_le(hdr, event_trace_time_us() - event_trace.start_us);
+	h_u16_to_le(hdr + 8, id);
+	hdr[10] = subsys;
+	hdr[11] = num_args;
+	h_u32_to_le(hdr + 12, size);
+	for (unsigned int i = 0; i < num_args; i++)
+		h_u32_to_le(hdr + EVENT_TRACE_RECORD_HDR_SIZE + 4 * i, args[i]);
+
+	size_t hdr_len = EVENT_TRACE_RECORD_HDR_SIZE + 4 * num_args;
+	size_t pad = ALIGN_UP(size, 4) - size;
+	if (fwrite(hdr, 1, hdr_len, event_trace.file) != hdr_len ||
+			(size && fwrite(data, 1, size, event_trace.file) != size) ||
+			(pad && fwrite(padding, 1, pad, event_trace.file) != pad)) {
+		/* stop writing, a partial record would defeat the decoder */
+		LOG_ERROR("event trace: write to '%s' failed, tracing suspended",
+			event_trace.filename);
+		event_trace.error = true;
+		return;
+	}
+
+	event_trace.records++;
+	event_trace.bytes += hdr_len + size + pad;
+}
+
+static int event_trace_stop(void)
+{
+	int retval = ERROR_OK;
+
+	if (!event_trace.file)
+		return ERROR_OK;
+
+	event_trace_mask = 0;
+	if (fclose(event_trace.file) != 0 || event_trace.error) {
+		LOG_ERROR("event trace: '%s' is incomplete", event_trace.filename);
+		retval = ERROR_FAIL;
+	}
+	event_trace.file = NULL;
+
+	LOG_INFO("event trace: %" PRIu64 " records, %" PRIu64 " bytes written to '%s'",
+		event_trace.records, event_trace.bytes, event_trace.filename);
+
+	return retval;
+}
+
+void event_trace_cleanup(void)
+{
+	event_trace_stop();
+	free(event_trace.filename);
+	event_trace.filename = NULL;
+}
+
+static void event_trace_print_mask(struct command_invocation *cmd, uint32_t mask)
+{
+	for (unsigned int i = 0; i < EVENT_TRACE_SUBSYS_NUM; i++)
+		if (mask & BIT(i))
+			command_print_sameline(cmd, " %s", event_trace_subsys_name[i]);
+}
+
+COMMAND_HANDLER(handle_event_trace_start_command)
+{
+	uint32_t mask = 0;
+
+	if (CMD_ARGC < 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	for (unsigned int i = 1; i < CMD_ARGC; i++) {
+		unsigned int subsys;
+		for (subsys = 0; subsys < EVENT_TRACE_SUBSYS_NUM; subsys++)
+			if (!strcmp(CMD_ARGV[i], event_trace_subsys_name[subsys]))
+				break;
+		if (subsys == EVENT_TRACE_SUBSYS_NUM) {
+			command_print(CMD, "unknown subsystem '%s'", CMD_ARGV[i]);
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		mask |= BIT(subsys);
+	}
+	if (!mask)
+		mask = BIT(EVENT_TRACE_SUBSYS_NUM) - 1;
+
+	if (event_trace.file) {
+		command_print(CMD, "event trace already running");
+		return ERROR_FAIL;
+	}
+
+	FILE *file = fopen(CMD_ARGV[0], "wb");
+	if (!file) {
+		command_print(CMD, "cannot open '%s'", CMD_ARGV[0]);
+		return ERROR_FAIL;
+	}
+	setvbuf(file, NULL, _IOFBF, EVENT_TRACE_BUFFER_SIZE);
+
+	uint8_t hdr[EVENT_TRACE_FILE_HDR_SIZE];
+	uint64_t start_us = event_trace_time_us();
+	memcpy(hdr, "OOCDEVTR", 8);
+	h_u32_to_le(hdr + 8, EVENT_TRACE_VERSION);
+	h_u32_to_le(hdr + 12, mask);
+	h_u64_to_le(hdr + 16, start_us);
+	if (fwrite(hdr, 1, sizeof(hdr), file) != sizeof(hdr)) {
+		fclose(file);
+		command_print(CMD, "cannot write '%s'", CMD_ARGV[0]);
+		return ERROR_FAIL;
+	}
+
+	char *filename = strdup(CMD_ARGV[0]);
+	if (!filename) {
+		fclose(file);
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	free(event_trace.filename);
+	event_trace.filename = filename;
+	event_trace.file = file;
+	event_trace.start_us = start_us;
+	event_trace.records = 0;
+	event_trace.bytes = sizeof(hdr);
+	event_trace.error = false;
+	event_trace_mask = mask;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_event_trace_stop_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	return event_trace_stop();
+}
+
+COMMAND_HANDLER(handle_event_trace_status_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!event_trace.file) {
+		command_print(CMD, "stopped");
+		return ERROR_OK;
+	}
+
+	command_print_sameline(CMD, "tracing to '%s':", event_trace.filename);
+	event_trace_print_mask(CMD, event_trace_mask);
+	command_print(CMD, ", %" PRIu64 " records, %" PRIu64 " bytes%s",
+		event_trace.records, event_trace.bytes,
+		event_trace.error ? ", write error" : "");
+
+	return ERROR_OK;
+}
+
+static const struct command_registration event_trace_subcommand_handlers[] = {
+	{
+		.name = "start",
+		.handler = handle_event_trace_start_command,
+		.mode = COMMAND_ANY,
+		.help = "start writing the events of the subsystems to a binary file, "
+			"all subsystems if none is given",
+		.usage = "filename ['jtag'|'dap'|'cmsis-dap']*",
+	},
+	{
+		.name = "stop",
+		.handler = handle_event_trace_stop_command,
+		.mode = COMMAND_ANY,
+		.help = "stop tracing and close the file",
+		.usage = "",
+	},
+	{
+		.name = "status",
+		.handler = handle_event_trace_status_command,
+		.mode = COMMAND_ANY,
+		.help = "show the state of the event trace",
+		.usage = "",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration event_trace_command_handlers[] = {
+	{
+		.name = "event_trace",
+		.mode = COMMAND_ANY,
+		.help = "binary trace of the adapter and DAP traffic",
+		.usage = "",
+		.chain = event_trace_subcommand_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int event_trace_register_commands(struct command_context *cmd_ctx)
+{
+	return register_commands(cmd_ctx, NULL, event_trace_command_handlers);
+}
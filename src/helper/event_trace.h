@@ -0,0 +1,85 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_HELPER_EVENT_TRACE_H
+#define OPENOCD_HELPER_EVENT_TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "bits.h"
+#include "types.h"
+
+struct command_context;
+
+/* Subsystems that can be traced, stored in the records */
+enum event_trace_subsys {
+	EVENT_TRACE_JTAG = 0,
+	EVENT_TRACE_DAP = 1,
+	EVENT_TRACE_CMSIS_DAP = 2,
+	EVENT_TRACE_SUBSYS_NUM,
+};
+
+/* Event ids, unique over all the subsystems. Keep contrib/event_trace_decode.py in sync */
+enum event_trace_id {
+	/* args: ir_scan, end_state, number of fields, total bits */
+	EVENT_TRACE_JTAG_SCAN = 0x0100,
+	/* args: number of bits, data: bits shifted out */
+	EVENT_TRACE_JTAG_SCAN_OUT = 0x0101,
+	/* args: number of bits, data: bits captured */
+	EVENT_TRACE_JTAG_SCAN_IN = 0x0102,
+	/* args: number of cycles, end_state */
+	EVENT_TRACE_JTAG_RUNTEST = 0x0103,
+	/* args: trst, srst */
+	EVENT_TRACE_JTAG_RESET = 0x0104,
+	/* args: end_state */
+	EVENT_TRACE_JTAG_TLR_RESET = 0x0105,
+
+	/* args: stage, instr, reg_addr, rnw, out value, in value, ack */
+	EVENT_TRACE_DAP_JTAG_CMD = 0x0200,
+
+	/* data: command packet */
+	EVENT_TRACE_CMSIS_DAP_COMMAND = 0x0300,
+	/* data: response packet */
+	EVENT_TRACE_CMSIS_DAP_RESPONSE = 0x0301,
+};
+
+/* Mask of the subsystems being traced, bit n for subsystem n */
+extern uint32_t event_trace_mask;
+
+static inline bool event_trace_enabled(enum event_trace_subsys subsys)
+{
+	return event_trace_mask & BIT(subsys);
+}
+
+/**
+ * Writes one record to the event trace file, with the host time.
+ * Callers check event_trace_enabled() first, so a disabled subsystem
+ * costs a single test.
+ *
+ * @param args Event specific 32 bit arguments.
+ * @param data Optional raw payload, e.g. a packet or scan bits.
+ */
+void event_trace_write(enum event_trace_subsys subsys, enum event_trace_id id,
+	const uint32_t *args, unsigned int num_args, const uint8_t *data, size_t size);
+
+/** Records an event with 32 bit arguments when the subsystem is traced. */
+#define EVENT_TRACE(subsys, id, ...) \
+	do { \
+		if (event_trace_enabled(subsys)) { \
+			const uint32_t _args[] = { __VA_ARGS__ }; \
+			event_trace_write(subsys, id, _args, ARRAY_SIZE(_args), NULL, 0); \
+		} \
+	} while (0)
+
+/** Records an event with raw data when the subsystem is traced. */
+#define EVENT_TRACE_DATA(subsys, id, data, size) \
+	do { \
+		if (event_trace_enabled(subsys)) \
+			event_trace_write(subsys, id, NULL, 0, data, size); \
+	} while (0)
+
+int event_trace_register_commands(struct command_context *cmd_ctx);
+void event_trace_cleanup(void);
+
+#endif /* OPENOCD_HELPER_EVENT_TRACE_H */
@@ -20,16 +20,29 @@
 #include "fileio.h"
 #include "replacements.h"
 
+#if defined(HAVE_SYS_MMAN_H) && !defined(_WIN32)
+#include <sys/mman.h>
+#define FILEIO_HAVE_MMAP
+#endif
+
 struct fileio {
 	char *url;
 	size_t size;
 	enum fileio_type type;
 	enum fileio_access access;
 	FILE *file;
+	/* read only mapping of the whole file, see fileio_map() */
+	void *map;
 };
 
 static inline int fileio_close_local(struct fileio *fileio)
 {
+#ifdef FILEIO_HAVE_MMAP
+	if (fileio->map)
+		munmap(fileio->map, fileio->size);
+	fileio->map = NULL;
+#endif
+
 	int retval = fclose(fileio->file);
 	if (retval != 0) {
 		if (retval == EBADF)
@@ -112,7 +125,7 @@ int fileio_open(struct fileio **fileio, const char *url,
 	int retval;
 	struct fileio *tmp;
 
-	tmp = malloc(sizeof(struct fileio));
+	tmp = calloc(1, sizeof(struct fileio));
 
 	tmp->type = type;
 	tmp->access = access_type;
@@ -247,6 +260,37 @@ int fileio_write_u32(struct fileio *fileio, uint32_t data)
 	return retval;
 }
 
+/**
+ * Maps the whole file read only, so its content can be used in place
+ * instead of being read into a buffer. The mapping lasts until the file
+ * is closed and is independent of the file position.
+ *
+ * @returns ERROR_FILEIO_OPERATION_NOT_SUPPORTED when the file cannot be
+ * mapped: host without mmap(), file opened for writing, empty file or
+ * not a regular file. The caller then falls back to fileio_read().
+ */
+int fileio_map(struct fileio *fileio, const uint8_t **data)
+{
+#ifdef FILEIO_HAVE_MMAP
+	if (!fileio->map) {
+		if (fileio->access != FILEIO_READ || fileio->size == 0)
+			return ERROR_FILEIO_OPERATION_NOT_SUPPORTED;
+
+		void *map = mmap(NULL, fileio->size, PROT_READ, MAP_PRIVATE, fileno(fileio->file), 0);
+		if (map == MAP_FAILED) {
+			LOG_DEBUG("cannot map %s: %s", fileio->url, strerror(errno));
+			return ERROR_FILEIO_OPERATION_NOT_SUPPORTED;
+		}
+		fileio->map = map;
+	}
+
+	*data = fileio->map;
+	return ERROR_OK;
+#else
+	return ERROR_FILEIO_OPERATION_NOT_SUPPORTED;
+#endif
+}
+
 /**
  * FIX!!!!
  *
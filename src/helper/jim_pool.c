@@ -0,0 +1,259 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/**
+ * @file
+ * Pooled allocator for the Jim interpreter, enabled with the configure
+ * option --enable-jim-pool.
+ *
+ * Scripts looping over OpenOCD commands create and drop many small Jim
+ * strings, lists and objects per iteration. The blocks up to
+ * JIM_POOL_MAX_SIZE bytes are taken from per size free lists refilled from
+ * large slabs, the bigger ones go to malloc(). The slabs are never given
+ * back, the memory used stays at the high water mark of the scripts.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "command.h"
+#include "jim_pool.h"
+#include "log.h"
+
+#define JIM_POOL_NUM_CLASSES	5
+#define JIM_POOL_MIN_SIZE		16
+#define JIM_POOL_MAX_SIZE		(JIM_POOL_MIN_SIZE << (JIM_POOL_NUM_CLASSES - 1))
+#define JIM_POOL_SLAB_SIZE		(64 * 1024)
+
+/* Precedes every block, keeps the payload aligned as malloc() does */
+union jim_pool_header {
+	/* payload size for malloc() blocks, JIM_POOL_CLASS(class) for pooled ones */
+	size_t size;
+	union jim_pool_header *next_free;
+	long double align_ld;
+	void *align_ptr;
+	uint64_t align_u64;
+};
+
+/* Sizes above any request to tell pooled blocks apart */
+#define JIM_POOL_CLASS(class)	(SIZE_MAX - (class))
+#define JIM_POOL_IS_CLASS(size)	((size) > SIZE_MAX - JIM_POOL_NUM_CLASSES)
+
+static struct {
+	bool installed;
+	/* free blocks of each class, the header holds the link */
+	union jim_pool_header *free_list[JIM_POOL_NUM_CLASSES];
+	/* remainder of the last slab */
+	uint8_t *slab;
+	size_t slab_left;
+	struct jim_pool_stats stats;
+} jim_pool;
+
+static size_t jim_pool_class_size(unsigned int class)
+{
+	return JIM_POOL_MIN_SIZE << class;
+}
+
+static unsigned int jim_pool_class(size_t size)
+{
+	unsigned int class = 0;
+
+	while (jim_pool_class_size(class) < size)
+		class++;
+	return class;
+}
+
+static void *jim_pool_alloc(size_t size)
+{
+	union jim_pool_header *hdr;
+
+	if (size > JIM_POOL_MAX_SIZE) {
+		hdr = malloc(sizeof(*hdr) + size);
+		if (!hdr)
+			return NULL;
+		hdr->size = size;
+		jim_pool.stats.large_allocs++;
+		jim_pool.stats.large_in_use++;
+		return hdr + 1;
+	}
+
+	unsigned int class = jim_pool_class(size);
+	hdr = jim_pool.free_list[class];
+	if (hdr) {
+		jim_pool.free_list[class] = hdr->next_free;
+	} else {
+		size_t block_size = sizeof(*hdr) + jim_pool_class_size(class);
+		if (jim_pool.slab_left < block_size) {
+			/* the rest of the slab is lost, less than a largest block */
+			jim_pool.slab = malloc(JIM_POOL_SLAB_SIZE);
+			if (!jim_pool.slab) {
+				jim_pool.slab_left = 0;
+				return NULL;
+			}
+			jim_pool.slab_left = JIM_POOL_SLAB_SIZE;
+			jim_pool.stats.slab_bytes += JIM_POOL_SLAB_SIZE;
+		}
+		hdr = (union jim_pool_header *)jim_pool.slab;
+		jim_pool.slab += block_size;
+		jim_pool.slab_left -= block_size;
+	}
+
+	hdr->size = JIM_POOL_CLASS(class);
+	jim_pool.stats.pool_allocs++;
+	jim_pool.stats.pool_in_use++;
+	return hdr + 1;
+}
+
+static void jim_pool_free(void *ptr)
+{
+	union jim_pool_header *hdr = (union jim_pool_header *)ptr - 1;
+
+	if (!JIM_POOL_IS_CLASS(hdr->size)) {
+		jim_pool.stats.large_in_use--;
+		jim_pool.stats.frees++;
+		free(hdr);
+		return;
+	}
+
+	unsigned int class = SIZE_MAX - hdr->size;
+	hdr->next_free = jim_pool.free_list[class];
+	jim_pool.free_list[class] = hdr;
+	jim_pool.stats.pool_in_use--;
+	jim_pool.stats.frees++;
+}
+
+static size_t jim_pool_block_size(void *ptr)
+{
+	union jim_pool_header *hdr = (union jim_pool_header *)ptr - 1;
+
+	if (JIM_POOL_IS_CLASS(hdr->size))
+		return jim_pool_class_size(SIZE_MAX - hdr->size);
+	return hdr->size;
+}
+
+/* Same contract as the default Jim allocator on top of realloc() */
+static void *jim_pool_allocator(void *ptr, size_t size)
+{
+	if (!size) {
+		if (ptr)
+			jim_pool_free(ptr);
+		return NULL;
+	}
+
+	if (!ptr)
+		return jim_pool_alloc(size);
+
+	jim_pool.stats.reallocs++;
+
+	/* shrinking, or growing within the class */
+	size_t old_size = jim_pool_block_size(ptr);
+	union jim_pool_header *hdr = (union jim_pool_header *)ptr - 1;
+	if (JIM_POOL_IS_CLASS(hdr->size) && size <= old_size)
+		return ptr;
+
+	if (!JIM_POOL_IS_CLASS(hdr->size) && size > JIM_POOL_MAX_SIZE) {
+		hdr = realloc(hdr, sizeof(*hdr) + size);
+		if (!hdr)
+			return NULL;
+		hdr->size = size;
+		return hdr + 1;
+	}
+
+	void *new_ptr = jim_pool_alloc(size);
+	if (!new_ptr)
+		return NULL;
+	memcpy(new_ptr, ptr, MIN(old_size, size));
+	jim_pool_free(ptr);
+	return new_ptr;
+}
+
+void jim_pool_install(void)
+{
+	/* must precede the creation of the interpreter, Jim frees with the
+	 * allocator any block it got */
+	Jim_Allocator = jim_pool_allocator;
+	jim_pool.installed = true;
+}
+
+bool jim_pool_get_stats(struct jim_pool_stats *stats)
+{
+	if (!jim_pool.installed)
+		return false;
+
+	*stats = jim_pool.stats;
+	return true;
+}
+
+COMMAND_HANDLER(handle_jim_pool_stats_command)
+{
+	struct jim_pool_stats stats;
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!jim_pool_get_stats(&stats)) {
+		command_print(CMD, "Jim pool not in use, build with --enable-jim-pool");
+		return ERROR_OK;
+	}
+
+	command_print(CMD, "pooled: %" PRIu64 " allocations, %" PRIu64 " in use, %zu bytes of slabs",
+		stats.pool_allocs, stats.pool_in_use, stats.slab_bytes);
+	command_print(CMD, "malloc: %" PRIu64 " allocations, %" PRIu64 " in use",
+		stats.large_allocs, stats.large_in_use);
+	command_print(CMD, "%" PRIu64 " frees, %" PRIu64 " reallocations",
+		stats.frees, stats.reallocs);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_jim_pool_reset_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	/* the blocks in use stay accounted for */
+	jim_pool.stats.pool_allocs = 0;
+	jim_pool.stats.large_allocs = 0;
+	jim_pool.stats.frees = 0;
+	jim_pool.stats.reallocs = 0;
+
+	return ERROR_OK;
+}
+
+static const struct command_registration jim_pool_subcommand_handlers[] = {
+	{
+		.name = "stats",
+		.handler = handle_jim_pool_stats_command,
+		.mode = COMMAND_ANY,
+		.help = "show the allocation counters of the Jim interpreter",
+		.usage = "",
+	},
+	{
+		.name = "reset",
+		.handler = handle_jim_pool_reset_command,
+		.mode = COMMAND_ANY,
+		.help = "clear the allocation, free and reallocation counters",
+		.usage = "",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration jim_pool_command_handlers[] = {
+	{
+		.name = "jim_pool",
+		.mode = COMMAND_ANY,
+		.help = "pooled allocator of the Jim interpreter",
+		.usage = "",
+		.chain = jim_pool_subcommand_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int jim_pool_register_commands(struct command_context *cmd_ctx)
+{
+	return register_commands(cmd_ctx, NULL, jim_pool_command_handlers);
+}
@@ -0,0 +1,37 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_HELPER_JIM_POOL_H
+#define OPENOCD_HELPER_JIM_POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct command_context;
+
+/* Counters of the allocations done by the Jim interpreter */
+struct jim_pool_stats {
+	/* blocks served from the pools */
+	uint64_t pool_allocs;
+	uint64_t pool_in_use;
+	/* blocks too large for the pools, passed on to malloc() */
+	uint64_t large_allocs;
+	uint64_t large_in_use;
+	uint64_t frees;
+	uint64_t reallocs;
+	/* memory taken from malloc() for the pools */
+	size_t slab_bytes;
+};
+
+/**
+ * Makes the pools the allocator of Jim. Called before the interpreter
+ * is created, the blocks allocated until then would be freed wrong.
+ */
+void jim_pool_install(void);
+
+/** Copies the counters, returns false when the pools are not installed. */
+bool jim_pool_get_stats(struct jim_pool_stats *stats);
+
+int jim_pool_register_commands(struct command_context *cmd_ctx);
+
+#endif /* OPENOCD_HELPER_JIM_POOL_H */
@@ -53,6 +53,14 @@ static int64_t last_time;
 
 static int64_t start;
 
+/* Stdio buffer of a log file, written out when full or by log_flush() */
+#define LOG_OUTPUT_BUFFER_SIZE	(64 * 1024)
+/* Longest time messages below warning stay in the buffer */
+#define LOG_FLUSH_MS			100
+
+static int64_t log_flush_time;
+static bool log_flush_pending;
+
 static const char * const log_strings[6] = {
 	"User : ",
 	"Error: ",
@@ -105,7 +113,7 @@ static void log_puts(enum log_levels level,
 	if (level == LOG_LVL_OUTPUT) {
 		/* do not prepend any headers, just print out what we were given and return */
 		fputs(string, log_output);
-		fflush(log_output);
+		log_flush();
 		return;
 	}
 
@@ -135,7 +143,12 @@ static void log_puts(enum log_levels level,
 			(level > LOG_LVL_USER) ? log_strings[level + 1] : "", string);
 	}
 
-	fflush(log_output);
+	/* errors, warnings and user messages are written at once, the rest
+	 * is kept buffered for at most LOG_FLUSH_MS */
+	if (level <= LOG_LVL_WARNING || timeval_ms() - log_flush_time >= LOG_FLUSH_MS)
+		log_flush();
+	else
+		log_flush_pending = true;
 
 	/* Never forward LOG_LVL_DEBUG, too verbose and they can be found in the log if need be */
 	if (level <= LOG_LVL_INFO)
@@ -223,6 +236,29 @@ COMMAND_HANDLER(handle_debug_level_command)
 	return ERROR_OK;
 }
 
+/**
+ * Writes out the buffered log messages.
+ */
+void log_flush(void)
+{
+	if (log_output)
+		fflush(log_output);
+	log_flush_pending = false;
+	log_flush_time = timeval_ms();
+}
+
+static void log_set_output(FILE *file)
+{
+	if (log_output) {
+		fflush(log_output);
+		/* Close previous log file, if it was open and wasn't stderr. */
+		if (log_output != stderr)
+			fclose(log_output);
+	}
+	log_output = file;
+	log_flush_pending = false;
+}
+
 COMMAND_HANDLER(handle_log_output_command)
 {
 	if (CMD_ARGC > 1)
@@ -235,17 +271,15 @@ COMMAND_HANDLER(handle_log_output_command)
 			command_print(CMD, "failed to open output log \"%s\"", CMD_ARGV[0]);
 			return ERROR_FAIL;
 		}
+		/* large full buffering, log_puts() decides when to flush */
+		setvbuf(file, NULL, _IOFBF, LOG_OUTPUT_BUFFER_SIZE);
 		command_print(CMD, "set log_output to \"%s\"", CMD_ARGV[0]);
 	} else {
 		file = stderr;
 		command_print(CMD, "set log_output to default");
 	}
 
-	if (log_output != stderr && log_output) {
-		/* Close previous log file, if it was open and wasn't stderr. */
-		fclose(log_output);
-	}
-	log_output = file;
+	log_set_output(file);
 	return ERROR_OK;
 }
 
@@ -297,11 +331,7 @@ void log_init(void)
 
 void log_exit(void)
 {
-	if (log_output && log_output != stderr) {
-		/* Close log file, if it was open and wasn't stderr. */
-		fclose(log_output);
-	}
-	log_output = NULL;
+	log_set_output(NULL);
 }
 
 /* add/remove log callback handler */
@@ -428,6 +458,10 @@ void keep_alive(void)
 	int64_t current_time = timeval_ms();
 	int64_t delta_time = current_time - last_time;
 
+	/* long operations do not return to the server loop, bound the log latency */
+	if (log_flush_pending && current_time - log_flush_time >= LOG_FLUSH_MS)
+		log_flush();
+
 	if (delta_time > KEEP_ALIVE_TIMEOUT_MS) {
 		last_time = current_time;
 
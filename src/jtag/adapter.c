@@ -187,6 +187,10 @@ int adapter_init(struct command_context *cmd_ctx)
 int adapter_quit(void)
 {
 	if (is_adapter_initialized() && adapter_driver->quit) {
+		/* wait for a queue still in the adapter */
+		if (interface_jtag_complete_submitted() != ERROR_OK)
+			LOG_WARNING("the last JTAG queue failed");
+
 		/* close the JTAG interface */
 		int result = adapter_driver->quit();
 		if (result != ERROR_OK)
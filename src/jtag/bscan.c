@@ -0,0 +1,704 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/**
+ * @file
+ * Boundary scan of the devices of the scan chain, from the cell map of
+ * their boundary scan register (BSR) as given by their BSDL file.
+ *
+ * The devices and their pins are declared with the 'bscan' commands,
+ * usually from a script generated out of the BSDL files. An interconnect
+ * test drives a counting sequence and its complement on the nets: every
+ * net gets its own code, so stuck pins, opens and shorts all show up. All
+ * the devices are in EXTEST at the same time and all the vectors are
+ * queued in one flush, then compared to the expected values of the input
+ * cells with buf_eq_mask().
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <helper/binarybuffer.h>
+#include <helper/command.h>
+#include <helper/log.h>
+#include <helper/time_support.h>
+#include "bscan.h"
+#include "jtag.h"
+
+struct bscan_pin {
+	char *name;
+	/* BSR cells, -1 when the pin has none */
+	int in_cell;
+	int out_cell;
+	int ctrl_cell;
+	/* value of ctrl_cell turning the output off */
+	unsigned int disable_value;
+};
+
+struct bscan_device {
+	char *name;
+	struct jtag_tap *tap;
+	unsigned int length;
+	uint32_t extest;
+	uint32_t sample;
+	/* BSR value with all the outputs off, preloaded before EXTEST */
+	uint8_t *safe;
+	struct bscan_pin *pins;
+	unsigned int num_pins;
+	/* first bit of the BSR in the DR scans of the whole chain */
+	unsigned int chain_offset;
+	struct bscan_device *next;
+};
+
+/* A pin of a net in an interconnect test */
+struct bscan_net_pin {
+	struct bscan_device *device;
+	struct bscan_pin *pin;
+	unsigned int net;
+	bool driver;
+};
+
+static struct bscan_device *bscan_devices;
+
+static struct bscan_device *bscan_device_by_name(const char *name)
+{
+	for (struct bscan_device *device = bscan_devices; device; device = device->next)
+		if (!strcmp(device->name, name))
+			return device;
+	return NULL;
+}
+
+static struct bscan_device *bscan_device_by_tap(struct jtag_tap *tap)
+{
+	for (struct bscan_device *device = bscan_devices; device; device = device->next)
+		if (device->tap == tap)
+			return device;
+	return NULL;
+}
+
+static struct bscan_pin *bscan_pin_by_name(struct bscan_device *device, const char *name)
+{
+	for (unsigned int i = 0; i < device->num_pins; i++)
+		if (!strcmp(device->pins[i].name, name))
+			return &device->pins[i];
+	return NULL;
+}
+
+static void bscan_free_device(struct bscan_device *device)
+{
+	for (unsigned int i = 0; i < device->num_pins; i++)
+		free(device->pins[i].name);
+	free(device->pins);
+	free(device->safe);
+	free(device->name);
+	free(device);
+}
+
+void bscan_cleanup(void)
+{
+	while (bscan_devices) {
+		struct bscan_device *next = bscan_devices->next;
+		bscan_free_device(bscan_devices);
+		bscan_devices = next;
+	}
+}
+
+/* Places the BSR of the devices in the DR scans of the whole chain, the
+ * other TAPs stay in BYPASS */
+static int bscan_chain_layout(unsigned int *ir_bits, unsigned int *dr_bits)
+{
+	*ir_bits = 0;
+	*dr_bits = 0;
+
+	for (struct bscan_device *device = bscan_devices; device; device = device->next) {
+		if (!device->tap->enabled) {
+			LOG_ERROR("bscan: TAP %s of %s is disabled", device->tap->dotted_name,
+				device->name);
+			return ERROR_FAIL;
+		}
+	}
+
+	for (struct jtag_tap *tap = jtag_tap_next_enabled(NULL); tap; tap = jtag_tap_next_enabled(tap)) {
+		struct bscan_device *device = bscan_device_by_tap(tap);
+
+		*ir_bits += tap->ir_length;
+		if (device) {
+			device->chain_offset = *dr_bits;
+			*dr_bits += device->length;
+		} else {
+			*dr_bits += 1;
+		}
+	}
+
+	return ERROR_OK;
+}
+
+/* Instruction of the whole chain, with @a extest or SAMPLE/PRELOAD in the
+ * devices and BYPASS in the other TAPs */
+static void bscan_chain_instruction(uint8_t *ir, unsigned int ir_bits, bool extest)
+{
+	unsigned int offset = 0;
+
+	buf_set_ones(ir, ir_bits);
+	for (struct jtag_tap *tap = jtag_tap_next_enabled(NULL); tap; tap = jtag_tap_next_enabled(tap)) {
+		struct bscan_device *device = bscan_device_by_tap(tap);
+
+		if (device)
+			buf_set_u64(ir, offset, tap->ir_length, extest ? device->extest : device->sample);
+		else if (tap->ir_bypass_value)
+			buf_set_u64(ir, offset, tap->ir_length, tap->ir_bypass_value);
+		offset += tap->ir_length;
+	}
+}
+
+static void bscan_set_cell(uint8_t *dr, struct bscan_device *device, int cell, unsigned int value)
+{
+	buf_set_u32(dr, device->chain_offset + cell, 1, value);
+}
+
+static unsigned int bscan_get_cell(const uint8_t *dr, struct bscan_device *device, int cell)
+{
+	return buf_get_u32(dr, device->chain_offset + cell, 1);
+}
+
+/* Takes the "device:pin" words of a net */
+static int bscan_parse_net(struct command_invocation *cmd, const char *spec, unsigned int net,
+	struct bscan_net_pin **pins, unsigned int *num_pins)
+{
+	bool driver = true;
+
+	while (*spec) {
+		while (*spec == ' ' || *spec == '\t')
+			spec++;
+		if (!*spec)
+			break;
+
+		size_t len = strcspn(spec, " \t");
+		char *word = strndup(spec, len);
+		if (!word) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		spec += len;
+
+		char *pin_name = strchr(word, ':');
+		if (!pin_name) {
+			command_print(cmd, "'%s' is not device:pin", word);
+			free(word);
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		*pin_name++ = '\0';
+
+		struct bscan_device *device = bscan_device_by_name(word);
+		struct bscan_pin *pin = device ? bscan_pin_by_name(device, pin_name) : NULL;
+		if (!pin) {
+			command_print(cmd, "unknown pin %s:%s", word, pin_name);
+			free(word);
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+
+		if (driver ? pin->out_cell < 0 : pin->in_cell < 0) {
+			command_print(cmd, "pin %s:%s has no %s cell", word, pin_name,
+				driver ? "output" : "input");
+			free(word);
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		free(word);
+
+		struct bscan_net_pin *new_pins = realloc(*pins, (*num_pins + 1) * sizeof(**pins));
+		if (!new_pins) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		*pins = new_pins;
+		new_pins[*num_pins].device = device;
+		new_pins[*num_pins].pin = pin;
+		new_pins[*num_pins].net = net;
+		new_pins[*num_pins].driver = driver;
+		(*num_pins)++;
+
+		driver = false;
+	}
+
+	if (driver) {
+		command_print(cmd, "empty net");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	return ERROR_OK;
+}
+
+/* Code of @a net in @a vector: the net number, then its complement */
+static unsigned int bscan_net_value(unsigned int net, unsigned int vector, unsigned int code_bits)
+{
+	unsigned int bit = (net >> (vector % code_bits)) & 1;
+
+	return vector < code_bits ? bit : !bit;
+}
+
+static void bscan_report_pin(struct command_invocation *cmd, const struct bscan_net_pin *pins,
+	unsigned int num_pins, const struct bscan_net_pin *p, uint8_t **in,
+	unsigned int num_nets, unsigned int code_bits)
+{
+	unsigned int mask = BIT(code_bits) - 1;
+	unsigned int code = 0, complement = 0;
+
+	/* the capture of a vector comes with the scan of the next one */
+	for (unsigned int v = 0; v < code_bits; v++) {
+		code |= bscan_get_cell(in[v + 1], p->device, p->pin->in_cell) << v;
+		complement |= bscan_get_cell(in[code_bits + v + 1], p->device, p->pin->in_cell) << v;
+	}
+
+	if (code == p->net && complement == (~code & mask))
+		return;
+
+	command_print_sameline(cmd, "net %u: %s:%s ", p->net, p->device->name, p->pin->name);
+	if (!code && !complement) {
+		command_print(cmd, "stuck at 0");
+	} else if (code == mask && complement == mask) {
+		command_print(cmd, "stuck at 1");
+	} else if (complement == (~code & mask) && code < num_nets) {
+		/* the driver of another net comes first in pins */
+		const struct bscan_net_pin *other = pins;
+		while (other < pins + num_pins && !(other->driver && other->net == code))
+			other++;
+		command_print(cmd, "follows net %u driven by %s:%s", code,
+			other->device->name, other->pin->name);
+	} else {
+		command_print(cmd, "reads 0x%x/0x%x, shorted to other nets", code, complement);
+	}
+}
+
+COMMAND_HANDLER(handle_bscan_interconnect_command)
+{
+	struct bscan_net_pin *pins = NULL;
+	unsigned int num_pins = 0;
+	unsigned int ir_bits, dr_bits;
+	uint8_t *ir = NULL, *base = NULL, *expected = NULL, *mask = NULL;
+	uint8_t **out = NULL, **in = NULL;
+	bool passed;
+	int64_t start = timeval_ms();
+	int retval;
+
+	if (CMD_ARGC < 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	/* enough bits to tell the nets apart */
+	unsigned int num_nets = CMD_ARGC;
+	unsigned int code_bits = 1;
+	while (BIT(code_bits) < num_nets)
+		code_bits++;
+	unsigned int num_vectors = 2 * code_bits;
+
+	for (unsigned int i = 0; i < CMD_ARGC; i++) {
+		retval = bscan_parse_net(CMD, CMD_ARGV[i], i, &pins, &num_pins);
+		if (retval != ERROR_OK)
+			goto out;
+	}
+
+	retval = bscan_chain_layout(&ir_bits, &dr_bits);
+	if (retval != ERROR_OK)
+		goto out;
+
+	size_t ir_size = DIV_ROUND_UP(ir_bits, 8);
+	size_t dr_size = DIV_ROUND_UP(dr_bits, 8);
+	ir = malloc(ir_size);
+	base = calloc(1, dr_size);
+	expected = malloc(dr_size);
+	mask = calloc(1, dr_size);
+	out = calloc(num_vectors + 1, sizeof(*out));
+	in = calloc(num_vectors + 1, sizeof(*in));
+	if (!ir || !base || !expected || !mask || !out || !in) {
+		LOG_ERROR("Out of memory");
+		retval = ERROR_FAIL;
+		goto out;
+	}
+	for (unsigned int v = 0; v <= num_vectors; v++) {
+		out[v] = malloc(dr_size);
+		in[v] = malloc(dr_size);
+		if (!out[v] || !in[v]) {
+			LOG_ERROR("Out of memory");
+			retval = ERROR_FAIL;
+			goto out;
+		}
+	}
+
+	/* the safe values of all the devices, the receivers turned off */
+	for (struct bscan_device *device = bscan_devices; device; device = device->next)
+		buf_set_buf(device->safe, 0, base, device->chain_offset, device->length);
+	for (unsigned int i = 0; i < num_pins; i++) {
+		struct bscan_net_pin *p = &pins[i];
+		if (p->pin->ctrl_cell >= 0)
+			bscan_set_cell(base, p->device, p->pin->ctrl_cell, p->pin->disable_value);
+		if (p->pin->in_cell >= 0)
+			bscan_set_cell(mask, p->device, p->pin->in_cell, 1);
+	}
+
+	for (unsigned int v = 0; v < num_vectors; v++) {
+		memcpy(out[v], base, dr_size);
+		for (unsigned int i = 0; i < num_pins; i++) {
+			struct bscan_net_pin *p = &pins[i];
+			if (!p->driver)
+				continue;
+			if (p->pin->ctrl_cell >= 0)
+				bscan_set_cell(out[v], p->device, p->pin->ctrl_cell, !p->pin->disable_value);
+			bscan_set_cell(out[v], p->device, p->pin->out_cell,
+				bscan_net_value(p->net, v, code_bits));
+		}
+	}
+	/* the last scan only captures the last vector */
+	memcpy(out[num_vectors], base, dr_size);
+
+	bscan_chain_instruction(ir, ir_bits, false);
+	jtag_add_plain_ir_scan(ir_bits, ir, NULL, TAP_IDLE);
+	jtag_add_plain_dr_scan(dr_bits, base, NULL, TAP_IDLE);
+	bscan_chain_instruction(ir, ir_bits, true);
+	jtag_add_plain_ir_scan(ir_bits, ir, NULL, TAP_IDLE);
+	for (unsigned int v = 0; v <= num_vectors; v++)
+		jtag_add_plain_dr_scan(dr_bits, out[v], in[v], TAP_IDLE);
+	/* back to the functional mode, and to the instructions the rest of
+	 * OpenOCD expects */
+	jtag_add_tlr();
+
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		goto out;
+
+	passed = true;
+	for (unsigned int v = 0; v < num_vectors && passed; v++) {
+		memset(expected, 0, dr_size);
+		for (unsigned int i = 0; i < num_pins; i++) {
+			struct bscan_net_pin *p = &pins[i];
+			if (p->pin->in_cell >= 0)
+				bscan_set_cell(expected, p->device, p->pin->in_cell,
+					bscan_net_value(p->net, v, code_bits));
+		}
+		passed = buf_eq_mask(in[v + 1], expected, mask, dr_bits);
+	}
+
+	if (!passed) {
+		for (unsigned int i = 0; i < num_pins; i++)
+			if (pins[i].pin->in_cell >= 0)
+				bscan_report_pin(CMD, pins, num_pins, &pins[i], in, num_nets, code_bits);
+		retval = ERROR_FAIL;
+	}
+
+	command_print(CMD, "interconnect test %s: %u nets, %u pins, %u vectors in %" PRId64 " ms",
+		passed ? "passed" : "failed", num_nets, num_pins, num_vectors, timeval_ms() - start);
+
+out:
+	if (out)
+		for (unsigned int v = 0; v <= num_vectors; v++)
+			free(out[v]);
+	if (in)
+		for (unsigned int v = 0; v <= num_vectors; v++)
+			free(in[v]);
+	free(out);
+	free(in);
+	free(mask);
+	free(expected);
+	free(base);
+	free(ir);
+	free(pins);
+
+	return retval;
+}
+
+COMMAND_HANDLER(handle_bscan_create_command)
+{
+	struct jtag_tap *tap = NULL;
+	unsigned int length = 0;
+	uint32_t extest = 0, sample = 0;
+	bool has_extest = false, has_sample = false;
+
+	if (CMD_ARGC < 1 || CMD_ARGC % 2 != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (bscan_device_by_name(CMD_ARGV[0])) {
+		command_print(CMD, "bscan device %s already exists", CMD_ARGV[0]);
+		return ERROR_FAIL;
+	}
+
+	for (unsigned int i = 1; i < CMD_ARGC; i += 2) {
+		if (!strcmp(CMD_ARGV[i], "-tap")) {
+			tap = jtag_tap_by_string(CMD_ARGV[i + 1]);
+			if (!tap) {
+				command_print(CMD, "Tap: %s unknown", CMD_ARGV[i + 1]);
+				return ERROR_COMMAND_ARGUMENT_INVALID;
+			}
+		} else if (!strcmp(CMD_ARGV[i], "-length")) {
+			COMMAND_PARSE_NUMBER(uint, CMD_ARGV[i + 1], length);
+		} else if (!strcmp(CMD_ARGV[i], "-extest")) {
+			COMMAND_PARSE_NUMBER(u32, CMD_ARGV[i + 1], extest);
+			has_extest = true;
+		} else if (!strcmp(CMD_ARGV[i], "-sample")) {
+			COMMAND_PARSE_NUMBER(u32, CMD_ARGV[i + 1], sample);
+			has_sample = true;
+		} else {
+			command_print(CMD, "unknown option %s", CMD_ARGV[i]);
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+	}
+
+	if (!tap || !length || !has_extest || !has_sample) {
+		command_print(CMD, "-tap, -length, -extest and -sample are required");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	if (tap->ir_length > 64) {
+		command_print(CMD, "TAP %s: IR longer than 64 bits", tap->dotted_name);
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	if (bscan_device_by_tap(tap)) {
+		command_print(CMD, "TAP %s has a bscan device already", tap->dotted_name);
+		return ERROR_FAIL;
+	}
+
+	struct bscan_device *device = calloc(1, sizeof(*device));
+	if (!device) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	device->name = strdup(CMD_ARGV[0]);
+	device->safe = calloc(1, DIV_ROUND_UP(length, 8));
+	if (!device->name || !device->safe) {
+		bscan_free_device(device);
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	device->tap = tap;
+	device->length = length;
+	device->extest = extest;
+	device->sample = sample;
+
+	struct bscan_device **p = &bscan_devices;
+	while (*p)
+		p = &(*p)->next;
+	*p = device;
+
+	return ERROR_OK;
+}
+
+static int bscan_parse_cell(struct command_invocation *cmd, struct bscan_device *device,
+	const char *str, int *cell)
+{
+	unsigned int value;
+
+	int retval = parse_uint(str, &value);
+	if (retval != ERROR_OK || value >= device->length) {
+		command_print(cmd, "cell '%s' out of the %u cells of %s", str, device->length,
+			device->name);
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+	*cell = value;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_bscan_pin_command)
+{
+	struct bscan_pin pin = {
+		.in_cell = -1,
+		.out_cell = -1,
+		.ctrl_cell = -1,
+	};
+	int retval;
+
+	if (CMD_ARGC < 2 || CMD_ARGC % 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct bscan_device *device = bscan_device_by_name(CMD_ARGV[0]);
+	if (!device) {
+		command_print(CMD, "unknown bscan device %s", CMD_ARGV[0]);
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	for (unsigned int i = 2; i < CMD_ARGC; i += 2) {
+		if (!strcmp(CMD_ARGV[i], "-in")) {
+			retval = bscan_parse_cell(CMD, device, CMD_ARGV[i + 1], &pin.in_cell);
+		} else if (!strcmp(CMD_ARGV[i], "-out")) {
+			retval = bscan_parse_cell(CMD, device, CMD_ARGV[i + 1], &pin.out_cell);
+		} else if (!strcmp(CMD_ARGV[i], "-ctrl")) {
+			retval = bscan_parse_cell(CMD, device, CMD_ARGV[i + 1], &pin.ctrl_cell);
+		} else if (!strcmp(CMD_ARGV[i], "-disable")) {
+			COMMAND_PARSE_NUMBER(uint, CMD_ARGV[i + 1], pin.disable_value);
+			retval = pin.disable_value > 1 ? ERROR_COMMAND_ARGUMENT_INVALID : ERROR_OK;
+		} else {
+			command_print(CMD, "unknown option %s", CMD_ARGV[i]);
+			retval = ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	struct bscan_pin *old = bscan_pin_by_name(device, CMD_ARGV[1]);
+	if (old) {
+		/* a new definition replaces the old one */
+		pin.name = old->name;
+		*old = pin;
+		return ERROR_OK;
+	}
+
+	pin.name = strdup(CMD_ARGV[1]);
+	struct bscan_pin *pins = realloc(device->pins, (device->num_pins + 1) * sizeof(*pins));
+	if (!pin.name || !pins) {
+		free(pin.name);
+		if (pins)
+			device->pins = pins;
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	device->pins = pins;
+	device->pins[device->num_pins++] = pin;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_bscan_safe_command)
+{
+	int cell;
+	unsigned int value;
+
+	if (CMD_ARGC != 3)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct bscan_device *device = bscan_device_by_name(CMD_ARGV[0]);
+	if (!device) {
+		command_print(CMD, "unknown bscan device %s", CMD_ARGV[0]);
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	int retval = bscan_parse_cell(CMD, device, CMD_ARGV[1], &cell);
+	if (retval != ERROR_OK)
+		return retval;
+
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[2], value);
+	if (value > 1)
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+
+	buf_set_u32(device->safe, cell, 1, value);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_bscan_sample_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct bscan_device *device = bscan_device_by_name(CMD_ARGV[0]);
+	if (!device) {
+		command_print(CMD, "unknown bscan device %s", CMD_ARGV[0]);
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	uint8_t ir[8];
+	uint8_t *in = malloc(DIV_ROUND_UP(device->length, 8));
+	if (!in) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	struct scan_field field = {
+		.num_bits = device->tap->ir_length,
+		.out_value = ir,
+	};
+	buf_set_u64(ir, 0, device->tap->ir_length, device->sample);
+	jtag_add_ir_scan(device->tap, &field, TAP_IDLE);
+
+	/* SAMPLE/PRELOAD, the safe values get preloaded */
+	field.num_bits = device->length;
+	field.out_value = device->safe;
+	field.in_value = in;
+	jtag_add_dr_scan(device->tap, 1, &field, TAP_IDLE);
+
+	int retval = jtag_execute_queue();
+	if (retval == ERROR_OK) {
+		device->chain_offset = 0;
+		for (unsigned int i = 0; i < device->num_pins; i++) {
+			struct bscan_pin *pin = &device->pins[i];
+			if (pin->in_cell >= 0)
+				command_print(CMD, "%s %u", pin->name, bscan_get_cell(in, device, pin->in_cell));
+		}
+	}
+
+	free(in);
+
+	return retval;
+}
+
+COMMAND_HANDLER(handle_bscan_devices_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	for (struct bscan_device *device = bscan_devices; device; device = device->next)
+		command_print(CMD, "%s: tap %s, %u cells, %u pins, extest 0x%" PRIx32 ", sample 0x%" PRIx32,
+			device->name, device->tap->dotted_name, device->length, device->num_pins,
+			device->extest, device->sample);
+
+	return ERROR_OK;
+}
+
+static const struct command_registration bscan_subcommand_handlers[] = {
+	{
+		.name = "create",
+		.handler = handle_bscan_create_command,
+		.mode = COMMAND_ANY,
+		.help = "declare the boundary scan register of a TAP",
+		.usage = "name -tap tapname -length cells -extest instr -sample instr",
+	},
+	{
+		.name = "pin",
+		.handler = handle_bscan_pin_command,
+		.mode = COMMAND_ANY,
+		.help = "declare the cells of a pin",
+		.usage = "name pin_name [-in cell] [-out cell] [-ctrl cell -disable ('0'|'1')]",
+	},
+	{
+		.name = "safe",
+		.handler = handle_bscan_safe_command,
+		.mode = COMMAND_ANY,
+		.help = "set the safe value of a cell, 0 by default",
+		.usage = "name cell ('0'|'1')",
+	},
+	{
+		.name = "devices",
+		.handler = handle_bscan_devices_command,
+		.mode = COMMAND_ANY,
+		.help = "list the boundary scan devices",
+		.usage = "",
+	},
+	{
+		.name = "sample",
+		.handler = handle_bscan_sample_command,
+		.mode = COMMAND_EXEC,
+		.help = "show the state of the input pins of a device, with SAMPLE/PRELOAD",
+		.usage = "name",
+	},
+	{
+		.name = "interconnect",
+		.handler = handle_bscan_interconnect_command,
+		.mode = COMMAND_EXEC,
+		.help = "test the nets between the pins, the first pin of a net drives it",
+		.usage = "net [net]*",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration bscan_command_handlers[] = {
+	{
+		.name = "bscan",
+		.mode = COMMAND_ANY,
+		.help = "boundary scan engine",
+		.usage = "",
+		.chain = bscan_subcommand_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int bscan_register_commands(struct command_context *cmd_ctx)
+{
+	return register_commands(cmd_ctx, NULL, bscan_command_handlers);
+}
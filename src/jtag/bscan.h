@@ -0,0 +1,11 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_JTAG_BSCAN_H
+#define OPENOCD_JTAG_BSCAN_H
+
+struct command_context;
+
+int bscan_register_commands(struct command_context *cmd_ctx);
+void bscan_cleanup(void);
+
+#endif /* OPENOCD_JTAG_BSCAN_H */
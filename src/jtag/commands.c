@@ -25,13 +25,37 @@
 
 struct cmd_queue_page {
 	struct cmd_queue_page *next;
-	void *address;
+	size_t size;
 	size_t used;
+	/* allocations are aligned to the size of this union */
+	union {
+		int i;
+		long l;
+		float f;
+		double d;
+		void *v;
+	} address[];
 };
 
 #define CMD_QUEUE_PAGE_SIZE (1024 * 1024)
-static struct cmd_queue_page *cmd_queue_pages;
-static struct cmd_queue_page *cmd_queue_pages_tail;
+/* pages kept allocated when the queue is reset, larger ones are freed */
+#define CMD_QUEUE_KEEP_PAGES 4
+
+/* The pages form an arena: the queue of the next flush reuses the pages
+ * of the previous one, only the pages above CMD_QUEUE_KEEP_PAGES and
+ * those holding oversized allocations go back to the heap. */
+struct cmd_queue_arena {
+	struct cmd_queue_page *pages;
+	/* page allocations are currently taken from */
+	struct cmd_queue_page *tail;
+};
+
+/* Two arenas, so that a queue can be built while the previous one is
+ * executed by the adapter, see jtag_command_queue_park(). */
+static struct cmd_queue_arena cmd_queue_arenas[2];
+static struct cmd_queue_arena *cmd_queue_arena = &cmd_queue_arenas[0];
+static struct cmd_queue_arena *cmd_queue_parked;
+static struct cmd_queue_stats cmd_queue_stats;
 
 static struct jtag_command *jtag_command_queue;
 static struct jtag_command **next_command_pointer = &jtag_command_queue;
@@ -65,93 +89,277 @@ void jtag_queue_command(struct jtag_command *cmd)
 
 void *cmd_queue_alloc(size_t size)
 {
-	struct cmd_queue_page **p_page = &cmd_queue_pages;
-	int offset;
-	uint8_t *t;
+	struct cmd_queue_arena *arena = cmd_queue_arena;
+	/* the first allocation after a reset starts with the first retained page */
+	struct cmd_queue_page *page = arena->tail ? arena->tail : arena->pages;
 
 	/*
-	 * WARNING:
-	 *    We align/round the *SIZE* per below
-	 *    so that all pointers returned by
-	 *    this function are reasonably well
-	 *    aligned.
-	 *
-	 * If we did not, then an "odd-length" request would cause the
-	 * *next* allocation to be at an *odd* address, and because
-	 * this function has the same type of api as malloc() - we
-	 * must also return pointers that have the same type of
-	 * alignment.
-	 *
-	 * What I do not/have is a reasonable portable means
-	 * to align by...
-	 *
-	 * The solution here, is based on these suggestions.
-	 * http://gcc.gnu.org/ml/gcc-help/2008-12/msg00041.html
-	 *
+	 * Round the size so that the next allocation, hence all the pointers
+	 * returned by this function, keeps the alignment of malloc().
 	 */
-	union worse_case_align {
-		int i;
-		long l;
-		float f;
-		void *v;
-	};
-#define ALIGN_SIZE  (sizeof(union worse_case_align))
-
-	/* The alignment process. */
-	size = (size + ALIGN_SIZE - 1) & (~(ALIGN_SIZE - 1));
-	/* Done... */
+	const size_t align_size = sizeof(page->address[0]);
+	size = (size + align_size - 1) & ~(align_size - 1);
 
-	if (*p_page) {
-		p_page = &cmd_queue_pages_tail;
-		if (CMD_QUEUE_PAGE_SIZE < (*p_page)->used + size)
-			p_page = &((*p_page)->next);
+	/* move to the next retained page, they are all empty */
+	if (page && page->size < page->used + size) {
+		page = page->next;
+		if (page && page->size < size)
+			page = NULL;
 	}
 
-	if (!*p_page) {
-		*p_page = malloc(sizeof(struct cmd_queue_page));
-		(*p_page)->used = 0;
-		size_t alloc_size = (size < CMD_QUEUE_PAGE_SIZE) ?
-					CMD_QUEUE_PAGE_SIZE : size;
-		(*p_page)->address = malloc(alloc_size);
-		(*p_page)->next = NULL;
-		cmd_queue_pages_tail = *p_page;
+	if (!page) {
+		size_t alloc_size = MAX(size, (size_t)CMD_QUEUE_PAGE_SIZE);
+		page = malloc(sizeof(*page) + alloc_size);
+		if (!page) {
+			LOG_ERROR("Out of memory for the JTAG queue");
+			exit(-1);
+		}
+		page->size = alloc_size;
+		page->used = 0;
+
+		/* insert after the current page, ahead of the retained ones */
+		if (arena->tail) {
+			page->next = arena->tail->next;
+			arena->tail->next = page;
+		} else {
+			page->next = arena->pages;
+			arena->pages = page;
+		}
+
+		cmd_queue_stats.pages_allocated++;
+		cmd_queue_stats.retained += alloc_size;
 	}
+	arena->tail = page;
+
+	uint8_t *t = (uint8_t *)page->address + page->used;
+	page->used += size;
 
-	offset = (*p_page)->used;
-	(*p_page)->used += size;
+	cmd_queue_stats.used += size;
+	if (cmd_queue_stats.used > cmd_queue_stats.peak)
+		cmd_queue_stats.peak = cmd_queue_stats.used;
 
-	t = (*p_page)->address;
-	return t + offset;
+	return t;
 }
 
-static void cmd_queue_free(void)
+static void cmd_queue_free(struct cmd_queue_arena *arena)
 {
-	struct cmd_queue_page *page = cmd_queue_pages;
+	struct cmd_queue_page **p_page = &arena->pages;
+	unsigned int kept = 0;
 
-	while (page) {
-		struct cmd_queue_page *last = page;
-		free(page->address);
-		page = page->next;
-		free(last);
+	while (*p_page) {
+		struct cmd_queue_page *page = *p_page;
+
+		if (page->size == CMD_QUEUE_PAGE_SIZE && kept < CMD_QUEUE_KEEP_PAGES) {
+			page->used = 0;
+			kept++;
+			p_page = &page->next;
+			continue;
+		}
+
+		*p_page = page->next;
+		cmd_queue_stats.retained -= page->size;
+		free(page);
 	}
 
-	cmd_queue_pages = NULL;
-	cmd_queue_pages_tail = NULL;
+	arena->tail = NULL;
+}
+
+void cmd_queue_get_stats(struct cmd_queue_stats *stats)
+{
+	*stats = cmd_queue_stats;
+}
+
+void cmd_queue_reset_stats(void)
+{
+	cmd_queue_stats.peak = cmd_queue_stats.used;
+	cmd_queue_stats.pages_allocated = 0;
+	cmd_queue_stats.flushes = 0;
+	cmd_queue_stats.ir_scans_dropped = 0;
+	cmd_queue_stats.commands_merged = 0;
+	cmd_queue_stats.bits_avoided = 0;
 }
 
 void jtag_command_queue_reset(void)
 {
-	cmd_queue_free();
+	cmd_queue_free(cmd_queue_arena);
+	cmd_queue_stats.used = 0;
+	cmd_queue_stats.flushes++;
 
 	jtag_command_queue = NULL;
 	next_command_pointer = &jtag_command_queue;
 }
 
+struct jtag_command *jtag_command_queue_park(void)
+{
+	struct jtag_command *queue = jtag_command_queue;
+
+	assert(!cmd_queue_parked);
+	cmd_queue_parked = cmd_queue_arena;
+	cmd_queue_arena = (cmd_queue_arena == &cmd_queue_arenas[0]) ?
+		&cmd_queue_arenas[1] : &cmd_queue_arenas[0];
+	cmd_queue_stats.used = 0;
+	cmd_queue_stats.flushes++;
+
+	jtag_command_queue = NULL;
+	next_command_pointer = &jtag_command_queue;
+
+	return queue;
+}
+
+void jtag_command_queue_release_parked(void)
+{
+	if (!cmd_queue_parked)
+		return;
+
+	cmd_queue_free(cmd_queue_parked);
+	cmd_queue_parked = NULL;
+}
+
 struct jtag_command *jtag_command_queue_get(void)
 {
 	return jtag_command_queue;
 }
 
+static bool jtag_queue_optimizer_enabled;
+
+void jtag_command_queue_set_optimize(bool enable)
+{
+	jtag_queue_optimizer_enabled = enable;
+}
+
+bool jtag_command_queue_get_optimize(void)
+{
+	return jtag_queue_optimizer_enabled;
+}
+
+/* IR scan that leaves the same instruction in every TAP and captures nothing */
+static bool jtag_ir_scan_is_redundant(const struct scan_command *prev, const struct scan_command *scan)
+{
+	if (prev->num_fields != scan->num_fields)
+		return false;
+
+	for (unsigned int i = 0; i < scan->num_fields; i++) {
+		const struct scan_field *a = &prev->fields[i];
+		const struct scan_field *b = &scan->fields[i];
+
+		if (b->in_value || !a->out_value || !b->out_value || a->num_bits != b->num_bits)
+			return false;
+		if (!buf_eq(a->out_value, b->out_value, a->num_bits))
+			return false;
+	}
+
+	return true;
+}
+
+/* Unlink the command following *p_cmd's predecessor, keeping the queue tail valid */
+static void jtag_command_queue_unlink(struct jtag_command **p_cmd)
+{
+	struct jtag_command *cmd = *p_cmd;
+
+	*p_cmd = cmd->next;
+	if (next_command_pointer == &cmd->next)
+		next_command_pointer = p_cmd;
+}
+
+/*
+ * Peephole pass run before the queue is handed to the adapter:
+ * - drops an IR scan loading the instructions already loaded by the
+ *   previous IR scan of the queue, when it captures nothing and the TAP
+ *   already is in its end state;
+ * - merges a RUNTEST ending in Run-Test/Idle with the RUNTEST following it;
+ * - concatenates adjacent TMS sequences;
+ * - drops a TLR reset following another one.
+ * The memory of the dropped commands is reclaimed with the queue.
+ */
+void jtag_command_queue_optimize(void)
+{
+	if (!jtag_queue_optimizer_enabled)
+		return;
+
+	enum tap_state state = tap_get_state();
+	const struct scan_command *last_ir = NULL;
+	struct jtag_command **p_cmd = &jtag_command_queue;
+	struct jtag_command *prev = NULL;
+
+	while (*p_cmd) {
+		struct jtag_command *cmd = *p_cmd;
+		bool drop = false;
+
+		switch (cmd->type) {
+			case JTAG_SCAN: {
+				struct scan_command *scan = cmd->cmd.scan;
+				if (!scan->ir_scan) {
+					state = scan->end_state;
+					break;
+				}
+				if (last_ir && state == scan->end_state && jtag_ir_scan_is_redundant(last_ir, scan)) {
+					drop = true;
+					cmd_queue_stats.ir_scans_dropped++;
+					cmd_queue_stats.bits_avoided += jtag_scan_size(scan);
+					break;
+				}
+				/* only a scan driving all the bits tells the instructions */
+				last_ir = scan;
+				for (unsigned int i = 0; i < scan->num_fields; i++)
+					if (!scan->fields[i].out_value)
+						last_ir = NULL;
+				state = scan->end_state;
+				break;
+			}
+			case JTAG_RUNTEST:
+				if (prev && prev->type == JTAG_RUNTEST && prev->cmd.runtest->end_state == TAP_IDLE) {
+					prev->cmd.runtest->num_cycles += cmd->cmd.runtest->num_cycles;
+					prev->cmd.runtest->end_state = cmd->cmd.runtest->end_state;
+					drop = true;
+					cmd_queue_stats.commands_merged++;
+				}
+				state = cmd->cmd.runtest->end_state;
+				break;
+			case JTAG_TMS:
+				if (prev && prev->type == JTAG_TMS) {
+					struct tms_command *a = prev->cmd.tms;
+					struct tms_command *b = cmd->cmd.tms;
+					uint8_t *bits = cmd_queue_alloc(DIV_ROUND_UP(a->num_bits + b->num_bits, 8));
+					buf_set_buf(a->bits, 0, bits, 0, a->num_bits);
+					buf_set_buf(b->bits, 0, bits, a->num_bits, b->num_bits);
+					a->bits = bits;
+					a->num_bits += b->num_bits;
+					drop = true;
+					cmd_queue_stats.commands_merged++;
+				}
+				/* raw TMS, the resulting state and instructions are unknown */
+				state = TAP_INVALID;
+				last_ir = NULL;
+				break;
+			case JTAG_TLR_RESET:
+				if (prev && prev->type == JTAG_TLR_RESET &&
+						prev->cmd.statemove->end_state == cmd->cmd.statemove->end_state) {
+					drop = true;
+					/* the TMS clocks of the sequence to Test-Logic-Reset */
+					cmd_queue_stats.bits_avoided += 5;
+				}
+				state = cmd->cmd.statemove->end_state;
+				last_ir = NULL;
+				break;
+			case JTAG_SLEEP:
+				break;
+			default:
+				/* resets, path moves, stable clocks */
+				state = TAP_INVALID;
+				last_ir = NULL;
+				break;
+		}
+
+		if (drop) {
+			jtag_command_queue_unlink(p_cmd);
+			continue;
+		}
+
+		prev = cmd;
+		p_cmd = &cmd->next;
+	}
+}
+
 /**
  * Copy a struct scan_field for insertion into the queue.
  *
@@ -241,8 +449,13 @@ int jtag_read_buffer(uint8_t *buffer, const struct scan_command *cmd)
 		 */
 		if (cmd->fields[i].in_value) {
 			const unsigned int num_bits = cmd->fields[i].num_bits;
-			uint8_t *captured = buf_set_buf(buffer, bit_count,
-					malloc(DIV_ROUND_UP(num_bits, 8)), 0, num_bits);
+			uint8_t *captured = cmd->fields[i].in_value;
+
+			/* unpack straight into the field, clearing the bits past
+			 * its end in the last byte as buf_cpy() does */
+			buf_set_buf(buffer, bit_count, captured, 0, num_bits);
+			if (num_bits % 8)
+				captured[num_bits / 8] &= (1 << (num_bits % 8)) - 1;
 
 			if (LOG_LEVEL_IS(LOG_LVL_DEBUG_IO)) {
 				char *char_buf = buf_to_hex_str(captured,
@@ -254,11 +467,6 @@ int jtag_read_buffer(uint8_t *buffer, const struct scan_command *cmd)
 						i, num_bits, char_buf);
 				free(char_buf);
 			}
-
-			if (cmd->fields[i].in_value)
-				buf_cpy(captured, cmd->fields[i].in_value, num_bits);
-
-			free(captured);
 		}
 		bit_count += cmd->fields[i].num_bits;
 	}
@@ -149,12 +149,50 @@ struct jtag_command {
 	struct jtag_command *next;
 };
 
+/** Memory usage of the JTAG command queue, see cmd_queue_alloc() */
+struct cmd_queue_stats {
+	/** bytes allocated by the commands currently queued */
+	size_t used;
+	/** highest value of @a used since the last cmd_queue_reset_stats() */
+	size_t peak;
+	/** bytes held by the queue pages, including the retained empty ones */
+	size_t retained;
+	/** pages obtained from the heap since the last cmd_queue_reset_stats() */
+	unsigned int pages_allocated;
+	/** number of queue resets since the last cmd_queue_reset_stats() */
+	unsigned int flushes;
+	/** IR scans removed by jtag_command_queue_optimize() */
+	unsigned int ir_scans_dropped;
+	/** RUNTEST and TMS commands merged into the previous one */
+	unsigned int commands_merged;
+	/** TCK cycles of the dropped commands */
+	uint64_t bits_avoided;
+};
+
 void *cmd_queue_alloc(size_t size);
+void cmd_queue_get_stats(struct cmd_queue_stats *stats);
+void cmd_queue_reset_stats(void);
 
 void jtag_queue_command(struct jtag_command *cmd);
 void jtag_command_queue_reset(void);
+
+/**
+ * Detach the queued commands, and the memory they were allocated from,
+ * so that a new queue can be built while the adapter executes them.
+ * Only one queue can be parked at a time.
+ * @returns the parked command list
+ */
+struct jtag_command *jtag_command_queue_park(void);
+/** Release the memory of the queue detached by jtag_command_queue_park() */
+void jtag_command_queue_release_parked(void);
 struct jtag_command *jtag_command_queue_get(void);
 
+/** Enable the peephole pass of jtag_command_queue_optimize() */
+void jtag_command_queue_set_optimize(bool enable);
+bool jtag_command_queue_get_optimize(void);
+/** Remove the redundant commands of the queue, if enabled, before its execution */
+void jtag_command_queue_optimize(void);
+
 void jtag_scan_field_clone(struct scan_field *dst, const struct scan_field *src);
 enum scan_type jtag_scan_type(const struct scan_command *cmd);
 unsigned int jtag_scan_size(const struct scan_command *cmd);
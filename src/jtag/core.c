@@ -24,7 +24,9 @@
 #include "swd.h"
 #include "interface.h"
 #include <transport/transport.h>
+#include <helper/event_trace.h>
 #include <helper/jep106.h>
+#include <helper/time_support.h>
 #include "helper/system.h"
 
 #ifdef HAVE_STRINGS_H
@@ -44,6 +46,12 @@ static unsigned int jtag_flush_queue_count;
 /* Sleep this # of ms after flushing the queue */
 static int jtag_flush_queue_sleep;
 
+/* see jtag_get_stats() */
+static struct jtag_stats jtag_stats;
+
+/* start of the round trip of the queue submitted to the adapter */
+static struct duration jtag_submit_duration;
+
 static void jtag_add_scan_check(struct jtag_tap *active,
 		void (*jtag_add_scan)(struct jtag_tap *active,
 		int in_num_fields,
@@ -91,6 +99,7 @@ enum tap_state cmd_queue_cur_state = TAP_RESET;
 
 static bool jtag_verify_capture_ir = true;
 static bool jtag_verify = true;
+static bool jtag_verify_deferred;
 
 /* how long the OpenOCD should wait before attempting JTAG communication after reset lines
  *deasserted (in ms) */
@@ -422,6 +431,108 @@ static int jtag_check_value_mask_callback(jtag_callback_data_t data0,
 		(int)data3);
 }
 
+/*
+ * Deferred verification: instead of a callback per checked field, the
+ * fields checked in a queue are appended to a single list and verified
+ * by one callback, after the queue has been executed. Only the first
+ * mismatch of the queue is reported in detail.
+ */
+struct jtag_deferred_check {
+	uint8_t *captured;
+	uint8_t *value;
+	uint8_t *mask;
+	unsigned int num_bits;
+};
+
+/* the checks of a queue, allocated with the queue */
+struct jtag_deferred_batch {
+	uint64_t first;
+	unsigned int count;
+};
+
+static struct jtag_deferred_check *jtag_deferred_checks;
+static unsigned int jtag_deferred_num_checks;
+static unsigned int jtag_deferred_max_checks;
+/* sequence number of jtag_deferred_checks[0] */
+static uint64_t jtag_deferred_base;
+/* batch of the queue being built, identified by the flush count */
+static struct jtag_deferred_batch *jtag_deferred_batch;
+static unsigned int jtag_deferred_batch_flush;
+
+static int jtag_check_deferred_callback(jtag_callback_data_t data0,
+	jtag_callback_data_t data1,
+	jtag_callback_data_t data2,
+	jtag_callback_data_t data3)
+{
+	struct jtag_deferred_batch *batch = (struct jtag_deferred_batch *)data0;
+
+	/* queues complete in order, older checks belong to queues that failed */
+	assert(batch->first >= jtag_deferred_base);
+	unsigned int start = batch->first - jtag_deferred_base;
+	unsigned int end = start + batch->count;
+	assert(end <= jtag_deferred_num_checks);
+
+	unsigned int failed = 0;
+	unsigned int first_failed = 0;
+	for (unsigned int i = start; i < end; i++) {
+		struct jtag_deferred_check *check = &jtag_deferred_checks[i];
+		bool ok;
+		if (check->mask)
+			ok = buf_eq_mask(check->captured, check->value, check->mask, check->num_bits);
+		else
+			ok = buf_eq(check->captured, check->value, check->num_bits);
+		if (!ok && !failed++)
+			first_failed = i;
+	}
+
+	int retval = ERROR_OK;
+	if (failed) {
+		LOG_WARNING("%u of %u deferred scan checks failed, first failure on check %u:",
+			failed, batch->count, first_failed - start);
+		struct jtag_deferred_check *check = &jtag_deferred_checks[first_failed];
+		retval = jtag_check_value_inner(check->captured, check->value, check->mask,
+			check->num_bits);
+	}
+
+	jtag_deferred_num_checks -= end;
+	memmove(jtag_deferred_checks, jtag_deferred_checks + end,
+		jtag_deferred_num_checks * sizeof(*jtag_deferred_checks));
+	jtag_deferred_base += end;
+
+	return retval;
+}
+
+static void jtag_add_check_deferred(struct scan_field *field)
+{
+	if (!jtag_deferred_batch || jtag_deferred_batch_flush != jtag_flush_queue_count) {
+		jtag_deferred_batch = cmd_queue_alloc(sizeof(*jtag_deferred_batch));
+		jtag_deferred_batch->first = jtag_deferred_base + jtag_deferred_num_checks;
+		jtag_deferred_batch->count = 0;
+		jtag_deferred_batch_flush = jtag_flush_queue_count;
+		jtag_add_callback4(jtag_check_deferred_callback,
+			(jtag_callback_data_t)jtag_deferred_batch, 0, 0, 0);
+	}
+
+	if (jtag_deferred_num_checks == jtag_deferred_max_checks) {
+		unsigned int new_max = jtag_deferred_max_checks ? 2 * jtag_deferred_max_checks : 64;
+		struct jtag_deferred_check *new_checks = realloc(jtag_deferred_checks,
+			new_max * sizeof(*jtag_deferred_checks));
+		if (!new_checks) {
+			LOG_ERROR("Out of memory");
+			exit(-1);
+		}
+		jtag_deferred_checks = new_checks;
+		jtag_deferred_max_checks = new_max;
+	}
+
+	struct jtag_deferred_check *check = &jtag_deferred_checks[jtag_deferred_num_checks++];
+	check->captured = field->in_value;
+	check->value = field->check_value;
+	check->mask = field->check_mask;
+	check->num_bits = field->num_bits;
+	jtag_deferred_batch->count++;
+}
+
 static void jtag_add_scan_check(struct jtag_tap *active, void (*jtag_add_scan)(
 		struct jtag_tap *active,
 		int in_num_fields,
@@ -432,13 +543,17 @@ static void jtag_add_scan_check(struct jtag_tap *active, void (*jtag_add_scan)(
 	jtag_add_scan(active, in_num_fields, in_fields, state);
 
 	for (int i = 0; i < in_num_fields; i++) {
-		if ((in_fields[i].check_value) && (in_fields[i].in_value)) {
+		if (!in_fields[i].check_value || !in_fields[i].in_value)
+			continue;
+
+		if (jtag_verify_deferred)
+			jtag_add_check_deferred(&in_fields[i]);
+		else
 			jtag_add_callback4(jtag_check_value_mask_callback,
 				(jtag_callback_data_t)in_fields[i].in_value,
 				(jtag_callback_data_t)in_fields[i].check_value,
 				(jtag_callback_data_t)in_fields[i].check_mask,
 				(jtag_callback_data_t)in_fields[i].num_bits);
-		}
 	}
 }
 
@@ -942,31 +1057,8 @@ void jtag_check_value_mask(struct scan_field *field, uint8_t *value, uint8_t *ma
 	jtag_set_error(retval);
 }
 
-int default_interface_jtag_execute_queue(void)
+static void jtag_log_queue(struct jtag_command *cmd)
 {
-	if (!is_adapter_initialized()) {
-		LOG_ERROR("No JTAG interface configured yet.  "
-			"Issue 'init' command in startup scripts "
-			"before communicating with targets.");
-		return ERROR_FAIL;
-	}
-
-	if (!transport_is_jtag()) {
-		/*
-		 * FIXME: This should not happen!
-		 * There could be old code that queues jtag commands with non jtag interfaces so, for
-		 * the moment simply highlight it by log an error and return on empty execute_queue.
-		 * We should fix it quitting with assert(0) because it is an internal error.
-		 * The fix can be applied immediately after next release (v0.11.0 ?)
-		 */
-		LOG_ERROR("JTAG API jtag_execute_queue() called on non JTAG interface");
-		if (!adapter_driver->jtag_ops || !adapter_driver->jtag_ops->execute_queue)
-			return ERROR_OK;
-	}
-
-	struct jtag_command *cmd = jtag_command_queue_get();
-	int result = adapter_driver->jtag_ops->execute_queue(cmd);
-
 	while (debug_level >= LOG_LVL_DEBUG_IO && cmd) {
 		switch (cmd->type) {
 			case JTAG_SCAN:
@@ -1024,6 +1116,162 @@ int default_interface_jtag_execute_queue(void)
 		}
 		cmd = cmd->next;
 	}
+}
+
+static void jtag_trace_queue(const struct jtag_command *cmd)
+{
+	if (!event_trace_enabled(EVENT_TRACE_JTAG))
+		return;
+
+	for (; cmd; cmd = cmd->next) {
+		switch (cmd->type) {
+		case JTAG_SCAN:
+			EVENT_TRACE(EVENT_TRACE_JTAG, EVENT_TRACE_JTAG_SCAN,
+				cmd->cmd.scan->ir_scan, cmd->cmd.scan->end_state,
+				cmd->cmd.scan->num_fields, jtag_scan_size(cmd->cmd.scan));
+			for (unsigned int i = 0; i < cmd->cmd.scan->num_fields; i++) {
+				const struct scan_field *field = cmd->cmd.scan->fields + i;
+				const uint32_t num_bits = field->num_bits;
+				if (field->out_value)
+					event_trace_write(EVENT_TRACE_JTAG, EVENT_TRACE_JTAG_SCAN_OUT, &num_bits, 1,
+						field->out_value, DIV_ROUND_UP(num_bits, 8));
+				if (field->in_value)
+					event_trace_write(EVENT_TRACE_JTAG, EVENT_TRACE_JTAG_SCAN_IN, &num_bits, 1,
+						field->in_value, DIV_ROUND_UP(num_bits, 8));
+			}
+			break;
+		case JTAG_RUNTEST:
+			EVENT_TRACE(EVENT_TRACE_JTAG, EVENT_TRACE_JTAG_RUNTEST,
+				cmd->cmd.runtest->num_cycles, cmd->cmd.runtest->end_state);
+			break;
+		case JTAG_RESET:
+			EVENT_TRACE(EVENT_TRACE_JTAG, EVENT_TRACE_JTAG_RESET,
+				cmd->cmd.reset->trst, cmd->cmd.reset->srst);
+			break;
+		case JTAG_TLR_RESET:
+			EVENT_TRACE(EVENT_TRACE_JTAG, EVENT_TRACE_JTAG_TLR_RESET,
+				cmd->cmd.statemove->end_state);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static void jtag_stats_account_queue(const struct jtag_command *cmd)
+{
+	if (!cmd)
+		jtag_stats.empty_flushes++;
+
+	for (; cmd; cmd = cmd->next) {
+		jtag_stats.commands++;
+		switch (cmd->type) {
+		case JTAG_SCAN:
+			jtag_stats.scans++;
+			jtag_stats.scan_bits += jtag_scan_size(cmd->cmd.scan);
+			break;
+		case JTAG_RUNTEST:
+			jtag_stats.clocks += cmd->cmd.runtest->num_cycles;
+			break;
+		case JTAG_STABLECLOCKS:
+			jtag_stats.clocks += cmd->cmd.stableclocks->num_cycles;
+			break;
+		case JTAG_TMS:
+			jtag_stats.clocks += cmd->cmd.tms->num_bits;
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+static void jtag_stats_account_round_trip(struct duration *duration)
+{
+	if (duration_measure(duration) != ERROR_OK)
+		return;
+
+	uint64_t us = (uint64_t)duration->elapsed.tv_sec * 1000000 + duration->elapsed.tv_usec;
+	jtag_stats.round_trip_total_us += us;
+	if (us > jtag_stats.round_trip_max_us)
+		jtag_stats.round_trip_max_us = us;
+
+	unsigned int bucket = 0;
+	while (us && bucket < JTAG_STATS_ROUND_TRIP_BUCKETS - 1) {
+		us >>= 1;
+		bucket++;
+	}
+	jtag_stats.round_trips[bucket]++;
+}
+
+void jtag_get_stats(struct jtag_stats *stats)
+{
+	*stats = jtag_stats;
+}
+
+void jtag_reset_stats(void)
+{
+	memset(&jtag_stats, 0, sizeof(jtag_stats));
+}
+
+int default_interface_jtag_execute_queue(void)
+{
+	if (!is_adapter_initialized()) {
+		LOG_ERROR("No JTAG interface configured yet.  "
+			"Issue 'init' command in startup scripts "
+			"before communicating with targets.");
+		return ERROR_FAIL;
+	}
+
+	if (!transport_is_jtag()) {
+		/*
+		 * FIXME: This should not happen!
+		 * There could be old code that queues jtag commands with non jtag interfaces so, for
+		 * the moment simply highlight it by log an error and return on empty execute_queue.
+		 * We should fix it quitting with assert(0) because it is an internal error.
+		 * The fix can be applied immediately after next release (v0.11.0 ?)
+		 */
+		LOG_ERROR("JTAG API jtag_execute_queue() called on non JTAG interface");
+		if (!adapter_driver->jtag_ops || !adapter_driver->jtag_ops->execute_queue)
+			return ERROR_OK;
+	}
+
+	struct jtag_command *cmd = jtag_command_queue_get();
+	struct duration round_trip;
+	duration_start(&round_trip);
+	int result = adapter_driver->jtag_ops->execute_queue(cmd);
+	jtag_stats_account_round_trip(&round_trip);
+
+	jtag_stats_account_queue(cmd);
+	jtag_log_queue(cmd);
+	jtag_trace_queue(cmd);
+
+	return result;
+}
+
+bool default_interface_jtag_can_submit(void)
+{
+	return is_adapter_initialized() && transport_is_jtag() &&
+		adapter_driver->jtag_ops &&
+		(adapter_driver->jtag_ops->supported & DEBUG_CAP_ASYNC_QUEUE) &&
+		adapter_driver->jtag_ops->submit_queue &&
+		adapter_driver->jtag_ops->complete_queue;
+}
+
+int default_interface_jtag_submit_queue(struct jtag_command *cmd_queue)
+{
+	duration_start(&jtag_submit_duration);
+	return adapter_driver->jtag_ops->submit_queue(cmd_queue);
+}
+
+int default_interface_jtag_complete_queue(struct jtag_command *cmd_queue)
+{
+	int result = adapter_driver->jtag_ops->complete_queue();
+	/* includes the time the queue was shifted while the next one was built */
+	jtag_stats_account_round_trip(&jtag_submit_duration);
+
+	jtag_stats_account_queue(cmd_queue);
+	jtag_log_queue(cmd_queue);
+	jtag_trace_queue(cmd_queue);
 
 	return result;
 }
@@ -1031,6 +1279,7 @@ int default_interface_jtag_execute_queue(void)
 void jtag_execute_queue_noclear(void)
 {
 	jtag_flush_queue_count++;
+	jtag_stats.flushes++;
 	jtag_set_error(interface_jtag_execute_queue());
 
 	if (jtag_flush_queue_sleep > 0) {
@@ -1042,6 +1291,13 @@ void jtag_execute_queue_noclear(void)
 	}
 }
 
+void jtag_submit_queue(void)
+{
+	jtag_flush_queue_count++;
+	jtag_stats.flushes++;
+	jtag_set_error(interface_jtag_submit_queue());
+}
+
 unsigned int jtag_get_flush_queue_count(void)
 {
 	return jtag_flush_queue_count;
@@ -1094,7 +1350,7 @@ void jtag_sleep(uint32_t us)
 /* a larger IR length than we ever expect to autoprobe */
 #define JTAG_IRLEN_MAX          60
 
-static int jtag_examine_chain_execute(uint8_t *idcode_buffer, unsigned int num_idcode)
+static void jtag_examine_chain_queue(uint8_t *idcode_buffer, unsigned int num_idcode)
 {
 	struct scan_field field = {
 		.num_bits = num_idcode * 32,
@@ -1108,7 +1364,6 @@ static int jtag_examine_chain_execute(uint8_t *idcode_buffer, unsigned int num_i
 
 	jtag_add_plain_dr_scan(field.num_bits, field.out_value, field.in_value, TAP_DRPAUSE);
 	jtag_add_tlr();
-	return jtag_execute_queue();
 }
 
 static bool jtag_examine_chain_check(uint8_t *idcodes, unsigned int count)
@@ -1223,10 +1478,67 @@ static bool jtag_examine_chain_match_tap(const struct jtag_tap *tap)
 	return false;
 }
 
+/* IR scan of jtag_validate_ircapture(), possibly queued with the
+ * examination of the chain */
+struct jtag_ircapture_scan {
+	uint8_t *ir_test;
+	unsigned int num_bits;
+	/* number of TAPs the scan was sized for */
+	unsigned int num_taps;
+};
+
+static bool jtag_chain_irlen_known(void)
+{
+	struct jtag_tap *tap = jtag_tap_next_enabled(NULL);
+
+	if (!tap)
+		return false;
+
+	for (; tap; tap = jtag_tap_next_enabled(tap))
+		if (tap->ir_length == 0)
+			return false;
+
+	return true;
+}
+
+static int jtag_validate_ircapture_queue(struct jtag_ircapture_scan *scan)
+{
+	struct jtag_tap *tap;
+
+	/* when autoprobing, accommodate huge IR lengths */
+	unsigned int total_ir_length = 0;
+	for (tap = jtag_tap_next_enabled(NULL); tap; tap = jtag_tap_next_enabled(tap)) {
+		if (tap->ir_length == 0)
+			total_ir_length += JTAG_IRLEN_MAX;
+		else
+			total_ir_length += tap->ir_length;
+	}
+
+	/* increase length to add 2 bit sentinel after scan */
+	total_ir_length += 2;
+
+	scan->ir_test = malloc(DIV_ROUND_UP(total_ir_length, 8));
+	if (!scan->ir_test)
+		return ERROR_FAIL;
+	scan->num_bits = total_ir_length;
+	scan->num_taps = jtag_tap_count_enabled();
+
+	/* after this scan, all TAPs will capture BYPASS instructions */
+	buf_set_ones(scan->ir_test, total_ir_length);
+
+	jtag_add_plain_ir_scan(total_ir_length, scan->ir_test, scan->ir_test, TAP_IDLE);
+
+	return ERROR_OK;
+}
+
 /* Try to examine chain layout according to IEEE 1149.1 §12
  * This is called a "blind interrogation" of the scan chain.
+ *
+ * When the IR lengths of all the TAPs are known, the scan of
+ * jtag_validate_ircapture() is queued in the same batch and returned
+ * in @a ircapture, saving a round trip per step.
  */
-static int jtag_examine_chain(void)
+static int jtag_examine_chain(struct jtag_ircapture_scan *ircapture)
 {
 	int retval;
 	unsigned int max_taps = jtag_tap_count();
@@ -1246,9 +1558,15 @@ static int jtag_examine_chain(void)
 	 * Then make sure the scan data has both ones and zeroes.
 	 */
 	LOG_DEBUG("DR scan interrogation for IDCODE/BYPASS");
-	retval = jtag_examine_chain_execute(idcode_buffer, max_taps);
-	if (retval != ERROR_OK)
+	jtag_examine_chain_queue(idcode_buffer, max_taps);
+	if (jtag_chain_irlen_known() && jtag_validate_ircapture_queue(ircapture) == ERROR_OK)
+		LOG_DEBUG("IR capture validation scan");
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK) {
+		free(ircapture->ir_test);
+		ircapture->ir_test = NULL;
 		goto out;
+	}
 	if (!jtag_examine_chain_check(idcode_buffer, max_taps)) {
 		retval = ERROR_JTAG_INIT_FAILED;
 		goto out;
@@ -1341,44 +1659,38 @@ out:
  *
  * Entry state can be anything.  On non-error exit, all TAPs are in
  * bypass mode.  On error exits, the scan chain is reset.
+ *
+ * If jtag_examine_chain() already executed the scan, @a scan holds the
+ * captured data and only the checks are done.
  */
-static int jtag_validate_ircapture(void)
+static int jtag_validate_ircapture(struct jtag_ircapture_scan *scan)
 {
 	struct jtag_tap *tap;
-	uint8_t *ir_test = NULL;
-	struct scan_field field;
+	uint8_t *ir_test;
+	unsigned int total_ir_length;
 	int chain_pos = 0;
-	int retval;
+	int retval = ERROR_OK;
 
-	/* when autoprobing, accommodate huge IR lengths */
-	unsigned int total_ir_length = 0;
-	for (tap = jtag_tap_next_enabled(NULL); tap; tap = jtag_tap_next_enabled(tap)) {
-		if (tap->ir_length == 0)
-			total_ir_length += JTAG_IRLEN_MAX;
-		else
-			total_ir_length += tap->ir_length;
+	/* the scan queued with the chain examination is only valid if the
+	 * latter did not find more TAPs */
+	if (scan->ir_test && scan->num_taps != jtag_tap_count_enabled()) {
+		free(scan->ir_test);
+		scan->ir_test = NULL;
 	}
 
-	/* increase length to add 2 bit sentinel after scan */
-	total_ir_length += 2;
-
-	ir_test = malloc(DIV_ROUND_UP(total_ir_length, 8));
-	if (!ir_test)
-		return ERROR_FAIL;
-
-	/* after this scan, all TAPs will capture BYPASS instructions */
-	buf_set_ones(ir_test, total_ir_length);
-
-	field.num_bits = total_ir_length;
-	field.out_value = ir_test;
-	field.in_value = ir_test;
+	if (!scan->ir_test) {
+		retval = jtag_validate_ircapture_queue(scan);
+		if (retval != ERROR_OK)
+			return retval;
 
-	jtag_add_plain_ir_scan(field.num_bits, field.out_value, field.in_value, TAP_IDLE);
+		LOG_DEBUG("IR capture validation scan");
+		retval = jtag_execute_queue();
+		if (retval != ERROR_OK)
+			goto done;
+	}
 
-	LOG_DEBUG("IR capture validation scan");
-	retval = jtag_execute_queue();
-	if (retval != ERROR_OK)
-		goto done;
+	ir_test = scan->ir_test;
+	total_ir_length = scan->num_bits;
 
 	tap = NULL;
 	chain_pos = 0;
@@ -1449,7 +1761,8 @@ static int jtag_validate_ircapture(void)
 	}
 
 done:
-	free(ir_test);
+	free(scan->ir_test);
+	scan->ir_test = NULL;
 	if (retval != ERROR_OK) {
 		jtag_add_tlr();
 		jtag_execute_queue();
@@ -1549,7 +1862,8 @@ int jtag_init_inner(struct command_context *cmd_ctx)
 	 * prevent communication ... hardware issues like TDO stuck, or
 	 * configuring the wrong number of (enabled) TAPs.
 	 */
-	retval = jtag_examine_chain();
+	struct jtag_ircapture_scan ircapture = { 0 };
+	retval = jtag_examine_chain(&ircapture);
 	switch (retval) {
 		case ERROR_OK:
 			/* complete success */
@@ -1575,7 +1889,7 @@ int jtag_init_inner(struct command_context *cmd_ctx)
 	 * latter is uncommon, but easily worked around:  provide
 	 * ircapture/irmask values during TAP setup.)
 	 */
-	retval = jtag_validate_ircapture();
+	retval = jtag_validate_ircapture(&ircapture);
 	if (retval != ERROR_OK) {
 		/* The target might be powered down. The user
 		 * can power it up and reset it after firing
@@ -1710,6 +2024,16 @@ bool jtag_will_verify(void)
 	return jtag_verify;
 }
 
+void jtag_set_verify_deferred(bool enable)
+{
+	jtag_verify_deferred = enable;
+}
+
+bool jtag_will_verify_deferred(void)
+{
+	return jtag_verify_deferred;
+}
+
 void jtag_set_verify_capture_ir(bool enable)
 {
 	jtag_verify_capture_ir = enable;
@@ -1948,3 +2272,20 @@ int adapter_poll_trace(uint8_t *buf, size_t *size)
 
 	return ERROR_FAIL;
 }
+
+int adapter_config_watch(bool enabled, struct adapter_watch *watch)
+{
+	if (adapter_driver->config_watch)
+		return adapter_driver->config_watch(enabled, watch);
+
+	watch->active = false;
+	return enabled ? ERROR_NOT_IMPLEMENTED : ERROR_OK;
+}
+
+int adapter_poll_watch(struct adapter_watch *watch, bool *changed, uint32_t *value)
+{
+	if (adapter_driver->poll_watch && watch->active)
+		return adapter_driver->poll_watch(watch, changed, value);
+
+	return ERROR_FAIL;
+}
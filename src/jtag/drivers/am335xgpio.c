@@ -223,6 +223,16 @@ static int am335xgpio_write(int tck, int tms, int tdi)
 	return ERROR_OK;
 }
 
+static int am335xgpio_write_buffer(const uint8_t *waveform, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		am335xgpio_write(waveform[i] & BITBANG_TCK ? 1 : 0,
+				waveform[i] & BITBANG_TMS ? 1 : 0,
+				waveform[i] & BITBANG_TDI ? 1 : 0);
+
+	return ERROR_OK;
+}
+
 static int am335xgpio_swd_write(int swclk, int swdio)
 {
 	set_gpio_value(&adapter_gpio_config[ADAPTER_GPIO_IDX_SWDIO], swdio);
@@ -286,6 +296,7 @@ static int am335xgpio_blink(bool on)
 static const struct bitbang_interface am335xgpio_bitbang = {
 	.read = am335xgpio_read,
 	.write = am335xgpio_write,
+	.write_buffer = am335xgpio_write_buffer,
 	.swdio_read = am335xgpio_swdio_read,
 	.swdio_drive = am335xgpio_swdio_drive,
 	.swd_write = am335xgpio_swd_write,
@@ -207,6 +207,16 @@ static int bcm2835gpio_write(int tck, int tms, int tdi)
 	return ERROR_OK;
 }
 
+static int bcm2835gpio_write_buffer(const uint8_t *waveform, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		bcm2835gpio_write(waveform[i] & BITBANG_TCK ? 1 : 0,
+				waveform[i] & BITBANG_TMS ? 1 : 0,
+				waveform[i] & BITBANG_TDI ? 1 : 0);
+
+	return ERROR_OK;
+}
+
 /* Requires push-pull drive mode for swclk and swdio */
 static int bcm2835gpio_swd_write_fast(int swclk, int swdio)
 {
@@ -430,6 +440,7 @@ static int bcm2835gpio_blink(bool on)
 static struct bitbang_interface bcm2835gpio_bitbang = {
 	.read = bcm2835gpio_read,
 	.write = bcm2835gpio_write,
+	.write_buffer = bcm2835gpio_write_buffer,
 	.swdio_read = bcm2835_swdio_read,
 	.swdio_drive = bcm2835_swdio_drive,
 	.swd_write = bcm2835gpio_swd_write_generic,
@@ -39,6 +39,34 @@ static void bitbang_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay
 
 const struct bitbang_interface *bitbang_interface;
 
+/* Pending JTAG writes, for the interfaces implementing write_buffer() */
+#define BITBANG_WAVEFORM_SIZE 4096
+static uint8_t bitbang_waveform[BITBANG_WAVEFORM_SIZE];
+static size_t bitbang_waveform_len;
+
+static int bitbang_write_flush(void)
+{
+	if (!bitbang_waveform_len)
+		return ERROR_OK;
+
+	int retval = bitbang_interface->write_buffer(bitbang_waveform, bitbang_waveform_len);
+	bitbang_waveform_len = 0;
+	return retval;
+}
+
+static int bitbang_write(int tck, int tms, int tdi)
+{
+	if (!bitbang_interface->write_buffer)
+		return bitbang_interface->write(tck, tms, tdi);
+
+	bitbang_waveform[bitbang_waveform_len++] = (tck ? BITBANG_TCK : 0) |
+		(tms ? BITBANG_TMS : 0) | (tdi ? BITBANG_TDI : 0);
+	if (bitbang_waveform_len == BITBANG_WAVEFORM_SIZE)
+		return bitbang_write_flush();
+
+	return ERROR_OK;
+}
+
 /* DANGER!!!! clock absolutely *MUST* be 0 in idle or reset won't work!
  *
  * Set this to 1 and str912 reset halt will fail.
@@ -74,12 +102,12 @@ static int bitbang_state_move(int skip)
 
 	for (i = skip; i < tms_count; i++) {
 		tms = (tms_scan >> i) & 1;
-		if (bitbang_interface->write(0, tms, 0) != ERROR_OK)
+		if (bitbang_write(0, tms, 0) != ERROR_OK)
 			return ERROR_FAIL;
-		if (bitbang_interface->write(1, tms, 0) != ERROR_OK)
+		if (bitbang_write(1, tms, 0) != ERROR_OK)
 			return ERROR_FAIL;
 	}
-	if (bitbang_interface->write(CLOCK_IDLE(), tms, 0) != ERROR_OK)
+	if (bitbang_write(CLOCK_IDLE(), tms, 0) != ERROR_OK)
 		return ERROR_FAIL;
 
 	tap_set_state(tap_get_end_state());
@@ -98,14 +126,22 @@ static int bitbang_execute_tms(struct jtag_command *cmd)
 	LOG_DEBUG_IO("TMS: %u bits", num_bits);
 
 	int tms = 0;
+	if (bitbang_interface->shift && num_bits) {
+		if (bitbang_write_flush() != ERROR_OK)
+			return ERROR_FAIL;
+		if (bitbang_interface->shift(num_bits, bits, NULL, NULL) != ERROR_OK)
+			return ERROR_FAIL;
+		tms = (bits[(num_bits - 1) / 8] >> ((num_bits - 1) % 8)) & 1;
+		num_bits = 0;
+	}
 	for (unsigned int i = 0; i < num_bits; i++) {
 		tms = ((bits[i/8] >> (i % 8)) & 1);
-		if (bitbang_interface->write(0, tms, 0) != ERROR_OK)
+		if (bitbang_write(0, tms, 0) != ERROR_OK)
 			return ERROR_FAIL;
-		if (bitbang_interface->write(1, tms, 0) != ERROR_OK)
+		if (bitbang_write(1, tms, 0) != ERROR_OK)
 			return ERROR_FAIL;
 	}
-	if (bitbang_interface->write(CLOCK_IDLE(), tms, 0) != ERROR_OK)
+	if (bitbang_write(CLOCK_IDLE(), tms, 0) != ERROR_OK)
 		return ERROR_FAIL;
 
 	return ERROR_OK;
@@ -130,9 +166,9 @@ static int bitbang_path_move(struct pathmove_command *cmd)
 			exit(-1);
 		}
 
-		if (bitbang_interface->write(0, tms, 0) != ERROR_OK)
+		if (bitbang_write(0, tms, 0) != ERROR_OK)
 			return ERROR_FAIL;
-		if (bitbang_interface->write(1, tms, 0) != ERROR_OK)
+		if (bitbang_write(1, tms, 0) != ERROR_OK)
 			return ERROR_FAIL;
 
 		tap_set_state(cmd->path[state_count]);
@@ -140,7 +176,7 @@ static int bitbang_path_move(struct pathmove_command *cmd)
 		num_states--;
 	}
 
-	if (bitbang_interface->write(CLOCK_IDLE(), tms, 0) != ERROR_OK)
+	if (bitbang_write(CLOCK_IDLE(), tms, 0) != ERROR_OK)
 		return ERROR_FAIL;
 
 	tap_set_end_state(tap_get_state());
@@ -159,13 +195,20 @@ static int bitbang_runtest(unsigned int num_cycles)
 	}
 
 	/* execute num_cycles */
+	if (bitbang_interface->shift && num_cycles) {
+		if (bitbang_write_flush() != ERROR_OK)
+			return ERROR_FAIL;
+		if (bitbang_interface->shift(num_cycles, NULL, NULL, NULL) != ERROR_OK)
+			return ERROR_FAIL;
+		num_cycles = 0;
+	}
 	for (unsigned int i = 0; i < num_cycles; i++) {
-		if (bitbang_interface->write(0, 0, 0) != ERROR_OK)
+		if (bitbang_write(0, 0, 0) != ERROR_OK)
 			return ERROR_FAIL;
-		if (bitbang_interface->write(1, 0, 0) != ERROR_OK)
+		if (bitbang_write(1, 0, 0) != ERROR_OK)
 			return ERROR_FAIL;
 	}
-	if (bitbang_interface->write(CLOCK_IDLE(), 0, 0) != ERROR_OK)
+	if (bitbang_write(CLOCK_IDLE(), 0, 0) != ERROR_OK)
 		return ERROR_FAIL;
 
 	/* finish in end_state */
@@ -183,15 +226,35 @@ static int bitbang_stableclocks(unsigned int num_cycles)
 
 	/* send num_cycles clocks onto the cable */
 	for (unsigned int i = 0; i < num_cycles; i++) {
-		if (bitbang_interface->write(1, tms, 0) != ERROR_OK)
+		if (bitbang_write(1, tms, 0) != ERROR_OK)
 			return ERROR_FAIL;
-		if (bitbang_interface->write(0, tms, 0) != ERROR_OK)
+		if (bitbang_write(0, tms, 0) != ERROR_OK)
 			return ERROR_FAIL;
 	}
 
 	return ERROR_OK;
 }
 
+/* Clock the whole scan through the shift() callback, TMS set on the last bit */
+static int bitbang_scan_shift(enum scan_type type, uint8_t *buffer,
+		unsigned int scan_size)
+{
+	if (bitbang_write_flush() != ERROR_OK)
+		return ERROR_FAIL;
+
+	uint8_t *tms = calloc(DIV_ROUND_UP(scan_size, 8), 1);
+	if (!tms)
+		return ERROR_FAIL;
+
+	buf_set_u32(tms, scan_size - 1, 1, 1);
+	int retval = bitbang_interface->shift(scan_size, tms,
+			type != SCAN_IN ? buffer : NULL,
+			type != SCAN_OUT ? buffer : NULL);
+	free(tms);
+
+	return retval;
+}
+
 static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
 		unsigned int scan_size)
 {
@@ -211,6 +274,13 @@ static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
 		bitbang_end_state(saved_end_state);
 	}
 
+	if (bitbang_interface->shift && scan_size) {
+		if (bitbang_scan_shift(type, buffer, scan_size) != ERROR_OK)
+			return ERROR_FAIL;
+		/* the bits are all out, skip the loop below */
+		scan_size = 0;
+	}
+
 	size_t buffered = 0;
 	for (bit_cnt = 0; bit_cnt < scan_size; bit_cnt++) {
 		int tms = (bit_cnt == scan_size-1) ? 1 : 0;
@@ -226,10 +296,13 @@ static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
 		if ((type != SCAN_IN) && (buffer[bytec] & bcval))
 			tdi = 1;
 
-		if (bitbang_interface->write(0, tms, tdi) != ERROR_OK)
+		if (bitbang_write(0, tms, tdi) != ERROR_OK)
 			return ERROR_FAIL;
 
 		if (type != SCAN_OUT) {
+			/* TDO must be sampled after the writes above took effect */
+			if (bitbang_write_flush() != ERROR_OK)
+				return ERROR_FAIL;
 			if (bitbang_interface->buf_size) {
 				if (bitbang_interface->sample() != ERROR_OK)
 					return ERROR_FAIL;
@@ -248,7 +321,7 @@ static int bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer,
 			}
 		}
 
-		if (bitbang_interface->write(1, tms, tdi) != ERROR_OK)
+		if (bitbang_write(1, tms, tdi) != ERROR_OK)
 			return ERROR_FAIL;
 
 		if (type != SCAN_OUT && bitbang_interface->buf_size &&
@@ -303,6 +376,9 @@ int bitbang_execute_queue(struct jtag_command *cmd_queue)
 		exit(-1);
 	}
 
+	/* drop the writes left over by a failed queue */
+	bitbang_waveform_len = 0;
+
 	/* return ERROR_OK, unless a jtag_read_buffer returns a failed check
 	 * that wasn't handled by a caller-provided error handler
 	 */
@@ -363,6 +439,8 @@ int bitbang_execute_queue(struct jtag_command *cmd_queue)
 				break;
 			case JTAG_SLEEP:
 				LOG_DEBUG_IO("sleep %" PRIu32, cmd->cmd.sleep->us);
+				if (bitbang_write_flush() != ERROR_OK)
+					return ERROR_FAIL;
 				if (bitbang_interface->flush && (bitbang_interface->flush() != ERROR_OK))
 					return ERROR_FAIL;
 				bitbang_sleep(cmd->cmd.sleep->us);
@@ -376,6 +454,8 @@ int bitbang_execute_queue(struct jtag_command *cmd_queue)
 		}
 		cmd = cmd->next;
 	}
+	if (bitbang_write_flush() != ERROR_OK)
+		return ERROR_FAIL;
 	if (bitbang_interface->blink) {
 		if (bitbang_interface->blink(false) != ERROR_OK)
 			return ERROR_FAIL;
@@ -20,6 +20,11 @@ enum bb_value {
 	BB_ERROR
 };
 
+/** Bits of the waveform entries passed to bitbang_interface::write_buffer() */
+#define BITBANG_TDI	(1 << 0)
+#define BITBANG_TMS	(1 << 1)
+#define BITBANG_TCK	(1 << 2)
+
 /** Low level callbacks (for bitbang).
  *
  * Either read(), or sample() and read_sample() must be implemented.
@@ -44,6 +49,22 @@ struct bitbang_interface {
 	/** Set TCK, TMS, and TDI to the given values. */
 	int (*write)(int tck, int tms, int tdi);
 
+	/** Apply @a count successive TCK, TMS and TDI settings (optional).
+	 *
+	 * Each entry of @a waveform is a combination of BITBANG_TCK, BITBANG_TMS
+	 * and BITBANG_TDI, equivalent to one write() call. When implemented, the
+	 * JTAG writes are buffered and handed over in one call, up to the next
+	 * TDO sample. */
+	int (*write_buffer)(const uint8_t *waveform, size_t count);
+
+	/** Clock @a num_bits JTAG bits at once (optional).
+	 *
+	 * For each bit, TCK is driven low with the TMS and TDI values taken from
+	 * @a tms and @a tdi, TDO is sampled into @a tdo and TCK is driven high.
+	 * A NULL @a tms or @a tdi stands for all zeros, a NULL @a tdo discards
+	 * the samples. @a tdo may be the same buffer as @a tdi. */
+	int (*shift)(unsigned int num_bits, const uint8_t *tms, const uint8_t *tdi, uint8_t *tdo);
+
 	/** Blink led (optional). */
 	int (*blink)(bool on);
 
@@ -29,6 +29,7 @@
 
 #include <transport/transport.h>
 #include "helper/replacements.h"
+#include <helper/event_trace.h>
 #include <jtag/adapter.h>
 #include <jtag/swd.h>
 #include <jtag/interface.h>
@@ -165,6 +166,13 @@ static bool swd_mode;
  * Prevent using it until we have at least r/w operations. */
 #define CMD_DAP_TFER_BLOCK_MIN_OPS 4
 
+/* A run of the same operation at the end of a packet with mixed operations,
+ * e.g. the DRW accesses following a TAR write, is sent as DAP_TransferBlock.
+ * Both the DAP_Transfer of the leading operations and the DAP_TransferBlock
+ * are wrapped in DAP_ExecuteCommands, if the adapter supports it. */
+#define CMD_DAP_EXECUTE_COMMANDS  0x7F
+#define CMD_DAP_TFER_SPLIT_MIN_OPS 8
+
 /* DAP Status Code */
 #define DAP_OK                    0
 #define DAP_ERROR                 0xFF
@@ -331,10 +339,10 @@ static int cmsis_dap_xfer(struct cmsis_dap *dap, int txlen)
 	}
 	if (dap->pending_fifo_block_count) {
 		LOG_ERROR("pending %u blocks, flushing", dap->pending_fifo_block_count);
-		while (dap->pending_fifo_block_count) {
-			dap->backend->read(dap, 10, CMSIS_DAP_BLOCKING);
-			dap->pending_fifo_block_count--;
-		}
+		/* the responses may already be requested in any FIFO slot */
+		dap->backend->cancel_all(dap);
+		cmsis_dap_flush_read(dap);
+		dap->pending_fifo_block_count = 0;
 		dap->pending_fifo_put_idx = 0;
 		dap->pending_fifo_get_idx = 0;
 	}
@@ -343,11 +351,13 @@ static int cmsis_dap_xfer(struct cmsis_dap *dap, int txlen)
 	int retval = dap->backend->write(dap, txlen, LIBUSB_TIMEOUT_MS);
 	if (retval < 0)
 		return retval;
+	EVENT_TRACE_DATA(EVENT_TRACE_CMSIS_DAP, EVENT_TRACE_CMSIS_DAP_COMMAND, dap->command, txlen);
 
 	/* get reply */
 	retval = dap->backend->read(dap, LIBUSB_TIMEOUT_MS, CMSIS_DAP_BLOCKING);
 	if (retval < 0)
 		return retval;
+	EVENT_TRACE_DATA(EVENT_TRACE_CMSIS_DAP, EVENT_TRACE_CMSIS_DAP_RESPONSE, dap->response, retval);
 
 	uint8_t *resp = dap->response;
 	if (resp[0] == DAP_ERROR) {
@@ -770,48 +780,19 @@ static void cmsis_dap_swd_cancel_transfers(struct cmsis_dap *dap)
 	cmsis_dap_swd_discard_all_pending(dap);
 }
 
-static void cmsis_dap_swd_write_from_queue(struct cmsis_dap *dap)
+static bool cmsis_dap_swd_split_tfer(struct cmsis_dap *dap, unsigned int transfer_count,
+		unsigned int tail_count)
 {
-	uint8_t *command = dap->command;
-	struct pending_request_block *block = &dap->pending_fifo[dap->pending_fifo_put_idx];
-
-	assert(dap->write_count + dap->read_count == block->transfer_count);
-
-	/* Reset packet size check counters for the next packet */
-	dap->write_count = 0;
-	dap->read_count = 0;
-
-	LOG_DEBUG_IO("Executing %d queued transactions from FIFO index %u%s",
-				 block->transfer_count, dap->pending_fifo_put_idx,
-				 cmsis_dap_handle->swd_cmds_differ ? "" : ", same swd ops");
-
-	if (queued_retval != ERROR_OK) {
-		LOG_DEBUG("Skipping due to previous errors: %d", queued_retval);
-		goto skip;
-	}
-
-	if (block->transfer_count == 0) {
-		LOG_ERROR("internal: write an empty queue?!");
-		goto skip;
-	}
-
-	bool block_cmd = !cmsis_dap_handle->swd_cmds_differ
-					 && block->transfer_count >= CMD_DAP_TFER_BLOCK_MIN_OPS;
-	block->command = block_cmd ? CMD_DAP_TFER_BLOCK : CMD_DAP_TFER;
-
-	command[0] = block->command;
-	command[1] = 0x00;	/* DAP Index */
-
-	unsigned int idx;
-	if (block_cmd) {
-		h_u16_to_le(&command[2], block->transfer_count);
-		idx = 4;	/* The first transfer will store the common DAP register */
-	} else {
-		command[2] = block->transfer_count;
-		idx = 3;
-	}
+	return (dap->caps & INFO_CAPS_ATOMIC_CMDS) && !dap->quirk_mode
+		&& tail_count >= CMD_DAP_TFER_SPLIT_MIN_OPS && tail_count < transfer_count
+		&& transfer_count - tail_count <= 255;
+}
 
-	for (unsigned int i = 0; i < block->transfer_count; i++) {
+static unsigned int cmsis_dap_swd_encode_transfers(uint8_t *command, unsigned int idx,
+		struct pending_request_block *block, unsigned int start, unsigned int end,
+		bool block_cmd)
+{
+	for (unsigned int i = start; i < end; i++) {
 		struct pending_transfer_result *transfer = &(block->transfers[i]);
 		uint8_t cmd = transfer->cmd;
 		uint32_t data = transfer->data;
@@ -840,7 +821,7 @@ static void cmsis_dap_swd_write_from_queue(struct cmsis_dap *dap)
 			data &= ~CORUNDETECT;
 		}
 
-		if (!block_cmd || i == 0)
+		if (!block_cmd || i == start)
 			command[idx++] = (cmd >> 1) & 0x0f;
 
 		if (!(cmd & SWD_CMD_RNW)) {
@@ -849,11 +830,83 @@ static void cmsis_dap_swd_write_from_queue(struct cmsis_dap *dap)
 		}
 	}
 
+	return idx;
+}
+
+static void cmsis_dap_swd_write_from_queue(struct cmsis_dap *dap)
+{
+	uint8_t *command = dap->command;
+	struct pending_request_block *block = &dap->pending_fifo[dap->pending_fifo_put_idx];
+
+	assert(dap->write_count + dap->read_count == block->transfer_count);
+
+	/* Reset packet size check counters for the next packet */
+	dap->write_count = 0;
+	dap->read_count = 0;
+
+	LOG_DEBUG_IO("Executing %d queued transactions from FIFO index %u%s",
+				 block->transfer_count, dap->pending_fifo_put_idx,
+				 cmsis_dap_handle->swd_cmds_differ ? "" : ", same swd ops");
+
+	if (queued_retval != ERROR_OK) {
+		LOG_DEBUG("Skipping due to previous errors: %d", queued_retval);
+		goto skip;
+	}
+
+	if (block->transfer_count == 0) {
+		LOG_ERROR("internal: write an empty queue?!");
+		goto skip;
+	}
+
+	bool block_cmd = !cmsis_dap_handle->swd_cmds_differ
+					 && block->transfer_count >= CMD_DAP_TFER_BLOCK_MIN_OPS;
+	bool split = !block_cmd && cmsis_dap_swd_split_tfer(dap, block->transfer_count,
+					 dap->tail_swd_cmd_count);
+
+	unsigned int idx;
+	if (split) {
+		/* DAP_Transfer of the leading operations, DAP_TransferBlock of the tail */
+		block->command = CMD_DAP_EXECUTE_COMMANDS;
+		block->block_start = block->transfer_count - dap->tail_swd_cmd_count;
+		command[0] = CMD_DAP_EXECUTE_COMMANDS;
+		command[1] = 2;	/* Number of commands */
+
+		command[2] = CMD_DAP_TFER;
+		command[3] = 0x00;	/* DAP Index */
+		command[4] = block->block_start;
+		idx = cmsis_dap_swd_encode_transfers(command, 5, block, 0, block->block_start, false);
+
+		command[idx++] = CMD_DAP_TFER_BLOCK;
+		command[idx++] = 0x00;	/* DAP Index */
+		h_u16_to_le(&command[idx], dap->tail_swd_cmd_count);
+		idx += 2;
+		idx = cmsis_dap_swd_encode_transfers(command, idx, block, block->block_start,
+			block->transfer_count, true);
+	} else {
+		block->command = block_cmd ? CMD_DAP_TFER_BLOCK : CMD_DAP_TFER;
+		block->block_start = block_cmd ? 0 : block->transfer_count;
+
+		command[0] = block->command;
+		command[1] = 0x00;	/* DAP Index */
+
+		if (block_cmd) {
+			h_u16_to_le(&command[2], block->transfer_count);
+			idx = 4;	/* The first transfer will store the common DAP register */
+		} else {
+			command[2] = block->transfer_count;
+			idx = 3;
+		}
+
+		idx = cmsis_dap_swd_encode_transfers(command, idx, block, 0, block->transfer_count,
+			block_cmd);
+	}
+
 	int retval = dap->backend->write(dap, idx, LIBUSB_TIMEOUT_MS);
 	if (retval < 0) {
 		queued_retval = retval;
 		goto skip;
 	}
+	EVENT_TRACE_DATA(EVENT_TRACE_CMSIS_DAP, EVENT_TRACE_CMSIS_DAP_COMMAND, dap->command, idx);
 
 	unsigned int packet_count = dap->quirk_mode ? 1 : dap->packet_count;
 	dap->pending_fifo_put_idx = (dap->pending_fifo_put_idx + 1) % packet_count;
@@ -907,6 +960,8 @@ static void cmsis_dap_swd_read_process(struct cmsis_dap *dap, enum cmsis_dap_blo
 		goto skip;
 	}
 
+	EVENT_TRACE_DATA(EVENT_TRACE_CMSIS_DAP, EVENT_TRACE_CMSIS_DAP_RESPONSE, dap->response, retval);
+
 	uint8_t *resp = dap->response;
 	if (resp[0] != block->command) {
 		LOG_ERROR("CMSIS-DAP command mismatch. Expected 0x%x received 0x%" PRIx8,
@@ -916,60 +971,87 @@ static void cmsis_dap_swd_read_process(struct cmsis_dap *dap, enum cmsis_dap_blo
 		return;
 	}
 
-	unsigned int transfer_count;
-	unsigned int idx;
-	if (block->command == CMD_DAP_TFER_BLOCK) {
-		transfer_count = le_to_h_u16(&resp[1]);
-		idx = 3;
-	} else {
-		transfer_count = resp[1];
+	/* DAP_ExecuteCommands wraps the responses of a DAP_Transfer of the
+	 * transfers before block_start and of a DAP_TransferBlock of the others */
+	unsigned int num_cmds = 1;
+	unsigned int idx = 0;
+	if (block->command == CMD_DAP_EXECUTE_COMMANDS) {
+		if (resp[1] != 2 || resp[2] != CMD_DAP_TFER) {
+			LOG_ERROR("CMSIS-DAP DAP_ExecuteCommands response mismatch");
+			cmsis_dap_swd_cancel_transfers(dap);
+			queued_retval = ERROR_FAIL;
+			return;
+		}
+		num_cmds = 2;
 		idx = 2;
 	}
-	if (resp[idx] & 0x08) {
-		LOG_DEBUG("CMSIS-DAP Protocol Error @ %d (wrong parity)", transfer_count);
-		queued_retval = ERROR_FAIL;
-		goto skip;
-	}
-	uint8_t ack = resp[idx++] & 0x07;
-	if (ack != SWD_ACK_OK) {
-		LOG_DEBUG("SWD ack not OK @ %d %s", transfer_count,
-			  ack == SWD_ACK_WAIT ? "WAIT" : ack == SWD_ACK_FAULT ? "FAULT" : "JUNK");
-		queued_retval = swd_ack_to_error_code(ack);
-		/* TODO: use results of transfers completed before the error occurred? */
-		goto skip;
-	}
-
-	if (block->transfer_count != transfer_count) {
-		LOG_ERROR("CMSIS-DAP transfer count mismatch: expected %d, got %d",
-			  block->transfer_count, transfer_count);
-		cmsis_dap_swd_cancel_transfers(dap);
-		queued_retval = ERROR_FAIL;
-		return;
-	}
 
 	LOG_DEBUG_IO("Received results of %d queued transactions FIFO index %u, %s mode",
-				 transfer_count, dap->pending_fifo_get_idx,
+				 block->transfer_count, dap->pending_fifo_get_idx,
 				 blocking ? "blocking" : "nonblocking");
 
-	for (unsigned int i = 0; i < transfer_count; i++) {
-		struct pending_transfer_result *transfer = &(block->transfers[i]);
-		if (transfer->cmd & SWD_CMD_RNW) {
-			static uint32_t last_read;
-			uint32_t data = le_to_h_u32(&resp[idx]);
-			uint32_t tmp = data;
-			idx += 4;
+	for (unsigned int n = 0; n < num_cmds; n++) {
+		bool block_resp = resp[idx] == CMD_DAP_TFER_BLOCK;
+		unsigned int start = block_resp ? block->block_start : 0;
+		unsigned int end = block_resp ? block->transfer_count : block->block_start;
 
-			LOG_DEBUG_IO("Read result: %" PRIx32, data);
+		if (n == 1 && !block_resp) {
+			LOG_ERROR("CMSIS-DAP DAP_ExecuteCommands response mismatch");
+			cmsis_dap_swd_cancel_transfers(dap);
+			queued_retval = ERROR_FAIL;
+			return;
+		}
 
-			/* Imitate posted AP reads */
-			if ((transfer->cmd & SWD_CMD_APNDP) ||
-			    ((transfer->cmd & SWD_CMD_A32) >> 1 == DP_RDBUFF)) {
-				tmp = last_read;
-				last_read = data;
-			}
+		unsigned int transfer_count;
+		if (block_resp) {
+			transfer_count = le_to_h_u16(&resp[idx + 1]);
+			idx += 3;
+		} else {
+			transfer_count = resp[idx + 1];
+			idx += 2;
+		}
+		if (resp[idx] & 0x08) {
+			LOG_DEBUG("CMSIS-DAP Protocol Error @ %d (wrong parity)", start + transfer_count);
+			queued_retval = ERROR_FAIL;
+			goto skip;
+		}
+		uint8_t ack = resp[idx++] & 0x07;
+		if (ack != SWD_ACK_OK) {
+			LOG_DEBUG("SWD ack not OK @ %d %s", start + transfer_count,
+				  ack == SWD_ACK_WAIT ? "WAIT" : ack == SWD_ACK_FAULT ? "FAULT" : "JUNK");
+			queued_retval = swd_ack_to_error_code(ack);
+			/* TODO: use results of transfers completed before the error occurred? */
+			goto skip;
+		}
 
-			if (transfer->buffer)
-				*(uint32_t *)(transfer->buffer) = tmp;
+		if (end - start != transfer_count) {
+			LOG_ERROR("CMSIS-DAP transfer count mismatch: expected %d, got %d",
+				  end - start, transfer_count);
+			cmsis_dap_swd_cancel_transfers(dap);
+			queued_retval = ERROR_FAIL;
+			return;
+		}
+
+		for (unsigned int i = start; i < end; i++) {
+			struct pending_transfer_result *transfer = &(block->transfers[i]);
+			if (transfer->cmd & SWD_CMD_RNW) {
+				static uint32_t last_read;
+				uint32_t data = le_to_h_u32(&resp[idx]);
+				uint32_t tmp = data;
+				idx += 4;
+
+				LOG_DEBUG_IO("Read result: %" PRIx32, data);
+
+				/* Imitate posted AP reads */
+				if ((transfer->cmd & SWD_CMD_APNDP) ||
+				    ((transfer->cmd & SWD_CMD_A32) >> 1 == DP_RDBUFF)) {
+					tmp = last_read;
+					last_read = data;
+				}
+
+				if (transfer->buffer)
+					*(uint32_t *)(transfer->buffer) = tmp;
+			}
 		}
 	}
 
@@ -1050,21 +1132,39 @@ static void cmsis_dap_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data)
 		block_cmd = !cmsis_dap_handle->swd_cmds_differ
 					&& cmd == cmsis_dap_handle->common_swd_cmd;
 
+	unsigned int tail_count = 1;
+	if (write_count + read_count && cmd == cmsis_dap_handle->tail_swd_cmd)
+		tail_count = cmsis_dap_handle->tail_swd_cmd_count + 1;
+
 	if (cmd & SWD_CMD_RNW)
 		read_count++;
 	else
 		write_count++;
 
-	unsigned int cmd_size = cmsis_dap_tfer_cmd_size(write_count, read_count,
-													block_cmd);
-	unsigned int resp_size = cmsis_dap_tfer_resp_size(write_count, read_count,
-													block_cmd);
-	unsigned int max_transfer_count = block_cmd ? 65535 : 255;
+	unsigned int cmd_size, resp_size, max_transfer_count;
+	if (!block_cmd && cmsis_dap_swd_split_tfer(cmsis_dap_handle, write_count + read_count,
+			tail_count)) {
+		/* the tail holds only reads or only writes, like cmd */
+		unsigned int tail_writes = (cmd & SWD_CMD_RNW) ? 0 : tail_count;
+		unsigned int tail_reads = (cmd & SWD_CMD_RNW) ? tail_count : 0;
+		cmd_size = 2 + cmsis_dap_tfer_cmd_size(write_count - tail_writes,
+					read_count - tail_reads, false)
+				+ cmsis_dap_tfer_cmd_size(tail_writes, tail_reads, true);
+		resp_size = 2 + cmsis_dap_tfer_resp_size(write_count - tail_writes,
+					read_count - tail_reads, false)
+				+ cmsis_dap_tfer_resp_size(tail_writes, tail_reads, true);
+		max_transfer_count = pending_queue_len;
+	} else {
+		cmd_size = cmsis_dap_tfer_cmd_size(write_count, read_count, block_cmd);
+		resp_size = cmsis_dap_tfer_resp_size(write_count, read_count, block_cmd);
+		max_transfer_count = block_cmd ? 65535 : 255;
+	}
 
 	/* Does the DAP Transfer command and also its expected response fit into one packet? */
 	if (cmd_size > tfer_max_command_size
 			|| resp_size > tfer_max_response_size
-			|| write_count + read_count > max_transfer_count) {
+			|| write_count + read_count > max_transfer_count
+			|| write_count + read_count > pending_queue_len) {
 		if (cmsis_dap_handle->pending_fifo_block_count)
 			cmsis_dap_swd_read_process(cmsis_dap_handle, CMSIS_DAP_NON_BLOCKING);
 
@@ -1091,6 +1191,12 @@ static void cmsis_dap_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data)
 	} else if (cmd != cmsis_dap_handle->common_swd_cmd) {
 		cmsis_dap_handle->swd_cmds_differ = true;
 	}
+	if (block->transfer_count == 0 || cmd != cmsis_dap_handle->tail_swd_cmd) {
+		cmsis_dap_handle->tail_swd_cmd = cmd;
+		cmsis_dap_handle->tail_swd_cmd_count = 1;
+	} else {
+		cmsis_dap_handle->tail_swd_cmd_count++;
+	}
 
 	if (cmd & SWD_CMD_RNW) {
 		/* Queue a read transaction */
@@ -1998,6 +2104,42 @@ static bool calculate_swo_prescaler(unsigned int traceclkin_freq,
 	return true;
 }
 
+/* Baud rates tried, from the highest the adapter accepts, by the autodetection */
+#define CMSIS_DAP_SWO_DETECT_TRIES	32
+
+/*
+ * Find the highest SWO baud rate the adapter sets exactly enough for a
+ * TPIU prescaler. The adapter reports the baud rate it actually uses, so
+ * the highest one is what it answers to TRACECLKIN, the TPIU maximum.
+ */
+static int cmsis_dap_detect_swo_freq(unsigned int traceclkin_hz,
+		unsigned int *swo_freq)
+{
+	uint32_t max_freq;
+	uint16_t prescaler;
+
+	int retval = cmsis_dap_cmd_dap_swo_baudrate(traceclkin_hz, &max_freq);
+	if (retval != ERROR_OK)
+		return retval;
+
+	unsigned int presc = DIV_ROUND_UP(traceclkin_hz, max_freq);
+	for (unsigned int i = 0; i < CMSIS_DAP_SWO_DETECT_TRIES; i++, presc++) {
+		uint32_t freq;
+
+		retval = cmsis_dap_cmd_dap_swo_baudrate(traceclkin_hz / presc, &freq);
+		if (retval != ERROR_OK)
+			return retval;
+
+		if (calculate_swo_prescaler(traceclkin_hz, freq, &prescaler)) {
+			*swo_freq = freq;
+			return ERROR_OK;
+		}
+	}
+
+	LOG_ERROR("SWO-trace frequency autodetection failed, please set it.");
+	return ERROR_FAIL;
+}
+
 /**
  * @see adapter_driver::config_trace
  */
@@ -2020,7 +2162,11 @@ static int cmsis_dap_config_trace(
 			}
 		}
 		cmsis_dap_handle->trace_enabled = false;
-		LOG_INFO("SWO-trace disabled.");
+		if (cmsis_dap_handle->trace_overruns)
+			LOG_INFO("SWO-trace disabled, trace buffer overrun %u times.",
+				cmsis_dap_handle->trace_overruns);
+		else
+			LOG_INFO("SWO-trace disabled.");
 		return ERROR_OK;
 	}
 
@@ -2042,16 +2188,12 @@ static int cmsis_dap_config_trace(
 		return ERROR_FAIL;
 	}
 
-	if (*swo_freq == 0) {
-		LOG_INFO("SWO-trace frequency autodetection not implemented.");
-		return ERROR_FAIL;
-	}
-
 	retval = cmsis_dap_cmd_dap_swo_control(DAP_SWO_CONTROL_STOP);
 	if (retval != ERROR_OK)
 		return retval;
 
 	cmsis_dap_handle->trace_enabled = false;
+	cmsis_dap_handle->trace_overruns = 0;
 
 	retval = cmsis_dap_get_swo_buf_sz(&cmsis_dap_handle->swo_buf_sz);
 	if (retval != ERROR_OK)
@@ -2065,6 +2207,12 @@ static int cmsis_dap_config_trace(
 	if (retval != ERROR_OK)
 		return retval;
 
+	if (*swo_freq == 0) {
+		retval = cmsis_dap_detect_swo_freq(traceclkin_hz, swo_freq);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
 	retval = cmsis_dap_cmd_dap_swo_baudrate(*swo_freq, swo_freq);
 	if (retval != ERROR_OK)
 		return retval;
@@ -2107,6 +2255,12 @@ static int cmsis_dap_poll_trace(uint8_t *buf, size_t *size)
 	if ((trace_status & DAP_SWO_STATUS_CAPTURE_MASK) != DAP_SWO_STATUS_CAPTURE_ACTIVE)
 		return ERROR_FAIL;
 
+	if (trace_status & DAP_SWO_STATUS_BUFFER_OVERRUN_MASK) {
+		if (cmsis_dap_handle->trace_overruns++ == 0)
+			LOG_WARNING("SWO-trace buffer overrun, trace data lost. "
+				"Lower the SWO frequency or the trace data rate.");
+	}
+
 	*size = trace_count < *size ? trace_count : *size;
 	size_t read_so_far = 0;
 	do {
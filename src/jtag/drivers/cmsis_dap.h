@@ -16,11 +16,13 @@ struct pending_transfer_result {
 
 /* Up to MIN(packet_count, MAX_PENDING_REQUESTS) requests may be issued
  * until the first response arrives */
-#define MAX_PENDING_REQUESTS 4
+#define MAX_PENDING_REQUESTS 8
 
 struct pending_request_block {
 	struct pending_transfer_result *transfers;
 	unsigned int transfer_count;
+	/* first transfer sent within DAP_TransferBlock, transfer_count if none */
+	unsigned int block_start;
 	uint8_t command;
 };
 
@@ -45,6 +47,11 @@ struct cmsis_dap {
 	uint8_t common_swd_cmd;
 	bool swd_cmds_differ;
 
+	/* Length of the run of the same SWD operation ending the packet,
+	 * which can be sent as DAP_TransferBlock within DAP_ExecuteCommands */
+	uint8_t tail_swd_cmd;
+	unsigned int tail_swd_cmd_count;
+
 	/* Pending requests are organized as a FIFO - circular buffer */
 	struct pending_request_block pending_fifo[MAX_PENDING_REQUESTS];
 	unsigned int packet_count;
@@ -56,6 +63,8 @@ struct cmsis_dap {
 
 	uint32_t swo_buf_sz;
 	bool trace_enabled;
+	/* SWO polls which found the trace buffer overrun, data was lost */
+	unsigned int trace_overruns;
 };
 
 /* Read mode */
@@ -440,6 +440,27 @@ static void LIBUSB_CALL cmsis_dap_usb_callback(struct libusb_transfer *transfer)
 	}
 }
 
+static int cmsis_dap_usb_submit_read(struct cmsis_dap *dap, unsigned int idx, int timeout_ms)
+{
+	struct cmsis_dap_bulk_transfer *tr = &dap->bdata->response_transfers[idx];
+
+	libusb_fill_bulk_transfer(tr->transfer,
+							  dap->bdata->dev_handle, dap->bdata->ep_in,
+							  tr->buffer, dap->packet_size,
+							  &cmsis_dap_usb_callback, tr,
+							  timeout_ms);
+	LOG_DEBUG_IO("submit read @ %u", idx);
+	tr->status = CMSIS_DAP_TRANSFER_PENDING;
+	int err = libusb_submit_transfer(tr->transfer);
+	if (err) {
+		tr->status = CMSIS_DAP_TRANSFER_IDLE;
+		LOG_ERROR("error submitting USB read: %s", libusb_strerror(err));
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
 static int cmsis_dap_usb_read(struct cmsis_dap *dap, int transfer_timeout_ms,
 							  enum cmsis_dap_blocking blocking)
 {
@@ -448,20 +469,11 @@ static int cmsis_dap_usb_read(struct cmsis_dap *dap, int transfer_timeout_ms,
 	struct cmsis_dap_bulk_transfer *tr;
 	tr = &dap->bdata->response_transfers[dap->pending_fifo_get_idx];
 
+	/* usually already submitted by cmsis_dap_usb_write() */
 	if (tr->status == CMSIS_DAP_TRANSFER_IDLE) {
-		libusb_fill_bulk_transfer(tr->transfer,
-								  dap->bdata->dev_handle, dap->bdata->ep_in,
-								  tr->buffer, dap->packet_size,
-								  &cmsis_dap_usb_callback, tr,
-								  transfer_timeout_ms);
-		LOG_DEBUG_IO("submit read @ %u", dap->pending_fifo_get_idx);
-		tr->status = CMSIS_DAP_TRANSFER_PENDING;
-		err = libusb_submit_transfer(tr->transfer);
-		if (err) {
-			tr->status = CMSIS_DAP_TRANSFER_IDLE;
-			LOG_ERROR("error submitting USB read: %s", libusb_strerror(err));
-			return ERROR_FAIL;
-		}
+		err = cmsis_dap_usb_submit_read(dap, dap->pending_fifo_get_idx, transfer_timeout_ms);
+		if (err != ERROR_OK)
+			return err;
 	}
 
 	struct timeval tv;
@@ -577,6 +589,13 @@ static int cmsis_dap_usb_write(struct cmsis_dap *dap, int txlen, int timeout_ms)
 		return ERROR_FAIL;
 	}
 
+	/* Queue the read of the response right away: the probe answers the
+	 * commands in order, so the IN transfers complete in the order of the
+	 * commands, and each one completes as soon as the probe sends the
+	 * response, while the next commands are being prepared. */
+	if (dap->bdata->response_transfers[dap->pending_fifo_put_idx].status == CMSIS_DAP_TRANSFER_IDLE)
+		return cmsis_dap_usb_submit_read(dap, dap->pending_fifo_put_idx, timeout_ms);
+
 	return ERROR_OK;
 }
 
@@ -44,6 +44,21 @@ static void jtag_callback_queue_reset(void)
 	jtag_callback_queue_tail = NULL;
 }
 
+/* Allocate a scan command with room for @a num_fields fields in one go */
+static struct scan_field *jtag_alloc_scan_command(size_t num_fields,
+		struct jtag_command **cmd, struct scan_command **scan)
+{
+	struct {
+		struct jtag_command cmd;
+		struct scan_command scan;
+		struct scan_field fields[];
+	} *p = cmd_queue_alloc(sizeof(*p) + num_fields * sizeof(p->fields[0]));
+
+	*cmd = &p->cmd;
+	*scan = &p->scan;
+	return p->fields;
+}
+
 /**
  * see jtag_add_ir_scan()
  *
@@ -53,9 +68,9 @@ int interface_jtag_add_ir_scan(struct jtag_tap *active,
 {
 	size_t num_taps = jtag_tap_count_enabled();
 
-	struct jtag_command *cmd = cmd_queue_alloc(sizeof(struct jtag_command));
-	struct scan_command *scan = cmd_queue_alloc(sizeof(struct scan_command));
-	struct scan_field *out_fields = cmd_queue_alloc(num_taps  * sizeof(struct scan_field));
+	struct jtag_command *cmd;
+	struct scan_command *scan;
+	struct scan_field *out_fields = jtag_alloc_scan_command(num_taps, &cmd, &scan);
 
 	jtag_queue_command(cmd);
 
@@ -131,9 +146,9 @@ int interface_jtag_add_dr_scan(struct jtag_tap *active, int in_num_fields,
 		return ERROR_FAIL;
 	}
 
-	struct jtag_command *cmd = cmd_queue_alloc(sizeof(struct jtag_command));
-	struct scan_command *scan = cmd_queue_alloc(sizeof(struct scan_command));
-	struct scan_field *out_fields = cmd_queue_alloc((in_num_fields + bypass_devices) * sizeof(struct scan_field));
+	struct jtag_command *cmd;
+	struct scan_command *scan;
+	struct scan_field *out_fields = jtag_alloc_scan_command(in_num_fields + bypass_devices, &cmd, &scan);
 
 	jtag_queue_command(cmd);
 
@@ -186,9 +201,9 @@ int interface_jtag_add_dr_scan(struct jtag_tap *active, int in_num_fields,
 static int jtag_add_plain_scan(int num_bits, const uint8_t *out_bits,
 		uint8_t *in_bits, enum tap_state state, bool ir_scan)
 {
-	struct jtag_command *cmd = cmd_queue_alloc(sizeof(struct jtag_command));
-	struct scan_command *scan = cmd_queue_alloc(sizeof(struct scan_command));
-	struct scan_field *out_fields = cmd_queue_alloc(sizeof(struct scan_field));
+	struct jtag_command *cmd;
+	struct scan_command *scan;
+	struct scan_field *out_fields = jtag_alloc_scan_command(1, &cmd, &scan);
 
 	jtag_queue_command(cmd);
 
@@ -363,27 +378,96 @@ static void interface_jtag_add_callback4(jtag_callback_t callback,
 	}
 }
 
+static int jtag_queue_reentry;
+
+/* queue handed over to the adapter by interface_jtag_submit_queue() */
+static bool jtag_queue_submitted;
+static struct jtag_command *jtag_submitted_queue;
+static struct jtag_callback_entry *jtag_submitted_callbacks;
+
+static int jtag_run_callbacks(struct jtag_callback_entry *entry)
+{
+	for (; entry; entry = entry->next) {
+		int retval = entry->callback(entry->data0, entry->data1, entry->data2, entry->data3);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	return ERROR_OK;
+}
+
+/* wait for the submitted queue and run its callbacks */
+int interface_jtag_complete_submitted(void)
+{
+	if (!jtag_queue_submitted)
+		return ERROR_OK;
+
+	int retval = default_interface_jtag_complete_queue(jtag_submitted_queue);
+	if (retval == ERROR_OK)
+		retval = jtag_run_callbacks(jtag_submitted_callbacks);
+
+	jtag_command_queue_release_parked();
+	jtag_queue_submitted = false;
+	jtag_submitted_queue = NULL;
+	jtag_submitted_callbacks = NULL;
+
+	return retval;
+}
+
 int interface_jtag_execute_queue(void)
 {
-	static int reentry;
+	assert(jtag_queue_reentry == 0);
+	jtag_queue_reentry++;
 
-	assert(reentry == 0);
-	reentry++;
+	int submitted_retval = interface_jtag_complete_submitted();
 
+	jtag_command_queue_optimize();
 	int retval = default_interface_jtag_execute_queue();
-	if (retval == ERROR_OK) {
-		struct jtag_callback_entry *entry;
-		for (entry = jtag_callback_queue_head; entry; entry = entry->next) {
-			retval = entry->callback(entry->data0, entry->data1, entry->data2, entry->data3);
-			if (retval != ERROR_OK)
-				break;
-		}
-	}
+	if (retval == ERROR_OK)
+		retval = jtag_run_callbacks(jtag_callback_queue_head);
 
 	jtag_command_queue_reset();
 	jtag_callback_queue_reset();
 
-	reentry--;
+	jtag_queue_reentry--;
+
+	return (submitted_retval != ERROR_OK) ? submitted_retval : retval;
+}
+
+int interface_jtag_submit_queue(void)
+{
+	if (!default_interface_jtag_can_submit())
+		return interface_jtag_execute_queue();
+
+	assert(jtag_queue_reentry == 0);
+	jtag_queue_reentry++;
+
+	/* double buffering: one queue in the adapter, one being built */
+	int retval = interface_jtag_complete_submitted();
+
+	jtag_command_queue_optimize();
+	struct jtag_command *cmd = jtag_command_queue_get();
+	if (!cmd) {
+		/* nothing to shift, only callbacks */
+		if (retval == ERROR_OK)
+			retval = jtag_run_callbacks(jtag_callback_queue_head);
+		jtag_command_queue_reset();
+		jtag_callback_queue_reset();
+	} else {
+		int submit_retval = default_interface_jtag_submit_queue(cmd);
+		if (submit_retval == ERROR_OK) {
+			jtag_submitted_queue = jtag_command_queue_park();
+			jtag_submitted_callbacks = jtag_callback_queue_head;
+			jtag_queue_submitted = true;
+		} else {
+			jtag_command_queue_reset();
+			if (retval == ERROR_OK)
+				retval = submit_retval;
+		}
+		jtag_callback_queue_reset();
+	}
+
+	jtag_queue_reentry--;
 
 	return retval;
 }
@@ -9,7 +9,10 @@
 #include "config.h"
 #endif
 
+#include <jtag/adapter.h>
 #include <jtag/interface.h>
+#include <jtag/swd.h>
+#include <target/arm_adi_v5.h>
 #include "bitbang.h"
 #include "hello.h"
 
@@ -107,31 +110,459 @@ static int dummy_speed(int speed)
 	return ERROR_OK;
 }
 
+/*
+ * Simulated SW-DP for SWD transport, to measure the queueing of the DAP,
+ * target and GDB layers without hardware. AP 0 is a MEM-AP backed by host
+ * memory, the other APs are absent. Each queue run costs the configured
+ * latency plus the SWD clocks of its transactions at the adapter speed,
+ * and is accounted in the statistics.
+ */
+
+#define DUMMY_DPIDR		0x2ba01477	/* DPv1 SW-DP */
+#define DUMMY_AP_IDR		0x24770011	/* AHB3-AP */
+/* request, turnaround, ack, data and parity of one transaction */
+#define DUMMY_SWD_CLOCKS	46
+/* idle clocks closing a queue run, see bitbang_swd_run_queue() */
+#define DUMMY_SWD_IDLE_CLOCKS	8
+/* words watched by the simulated firmware, see dummy_config_watch() */
+#define DUMMY_MAX_WATCHES	8
+
+static uint32_t dummy_mem_base = 0x20000000;
+static uint32_t dummy_mem_size = 0x10000;
+static uint8_t *dummy_mem;
+/* fixed cost of a queue run, like the USB round trip of a real adapter */
+static unsigned int dummy_latency_us;
+
+static uint32_t dummy_dp_ctrl_stat;
+static uint32_t dummy_dp_select;
+static uint32_t dummy_dp_rdbuff;
+static uint32_t dummy_ap_csw;
+static uint32_t dummy_ap_tar;
+
+static int dummy_swd_queued_retval;
+static unsigned int dummy_swd_queued;
+
+static struct adapter_watch *dummy_watches[DUMMY_MAX_WATCHES];
+
+static struct {
+	uint64_t runs;
+	uint64_t reads;
+	uint64_t writes;
+	uint64_t ap_accesses;
+	uint64_t faults;
+	uint64_t clocks;
+	uint64_t time_us;
+	uint64_t watch_polls;
+} dummy_swd_stats;
+
+/* Access @a size bytes of the memory behind the MEM-AP, data in the byte
+ * lanes given by the address */
+static bool dummy_mem_access(uint32_t address, unsigned int size, uint32_t *data, bool write)
+{
+	/* the MEM-AP ignores the address bits below the transfer size */
+	address &= ~(size - 1);
+	if (!dummy_mem || address < dummy_mem_base || address - dummy_mem_base > dummy_mem_size - size)
+		return false;
+
+	uint8_t *p = dummy_mem + (address - dummy_mem_base);
+	unsigned int lane = address & 3;
+
+	if (write) {
+		for (unsigned int i = 0; i < size; i++)
+			p[i] = *data >> (8 * (lane + i));
+	} else {
+		*data = 0;
+		for (unsigned int i = 0; i < size; i++)
+			*data |= (uint32_t)p[i] << (8 * (lane + i));
+	}
+
+	return true;
+}
+
+static uint8_t dummy_ap_access(unsigned int reg, uint32_t *data, bool write)
+{
+	unsigned int size = 1 << (dummy_ap_csw & CSW_SIZE_MASK);
+
+	/* AP 0 is the only one */
+	if (dummy_dp_select & ADIV5_DP_SELECT_APSEL) {
+		if (!write)
+			*data = 0;
+		return SWD_ACK_OK;
+	}
+
+	switch (reg) {
+	case ADIV5_MEM_AP_REG_CSW:
+		if (write) {
+			dummy_ap_csw = *data & ~(CSW_SIZE_MASK | CSW_ADDRINC_MASK | CSW_DEVICE_EN | CSW_TRIN_PROG);
+			/* 8, 16 and 32 bit transfers, no packing */
+			if ((*data & CSW_SIZE_MASK) <= CSW_32BIT)
+				dummy_ap_csw |= *data & CSW_SIZE_MASK;
+			else
+				dummy_ap_csw |= CSW_32BIT;
+			if ((*data & CSW_ADDRINC_MASK) == CSW_ADDRINC_PACKED)
+				dummy_ap_csw |= CSW_ADDRINC_SINGLE;
+			else
+				dummy_ap_csw |= *data & CSW_ADDRINC_MASK;
+		} else {
+			*data = dummy_ap_csw | CSW_DEVICE_EN;
+		}
+		return SWD_ACK_OK;
+	case ADIV5_MEM_AP_REG_TAR:
+		if (write)
+			dummy_ap_tar = *data;
+		else
+			*data = dummy_ap_tar;
+		return SWD_ACK_OK;
+	case ADIV5_MEM_AP_REG_DRW:
+		if (!dummy_mem_access(dummy_ap_tar, size, data, write))
+			return SWD_ACK_FAULT;
+		/* the address only increments within 1 KiB */
+		if ((dummy_ap_csw & CSW_ADDRINC_MASK) == CSW_ADDRINC_SINGLE)
+			dummy_ap_tar = (dummy_ap_tar & ~0x3ffu) | ((dummy_ap_tar + size) & 0x3ff);
+		return SWD_ACK_OK;
+	case ADIV5_MEM_AP_REG_BD0:
+	case ADIV5_MEM_AP_REG_BD1:
+	case ADIV5_MEM_AP_REG_BD2:
+	case ADIV5_MEM_AP_REG_BD3:
+		if (!dummy_mem_access((dummy_ap_tar & ~0xfu) + (reg & 0xc), 4, data, write))
+			return SWD_ACK_FAULT;
+		return SWD_ACK_OK;
+	case ADIV5_MEM_AP_REG_BASE:
+		/* legacy format, no ROM table */
+		if (!write)
+			*data = 0xffffffff;
+		return SWD_ACK_OK;
+	case ADIV5_AP_REG_IDR:
+		if (!write)
+			*data = DUMMY_AP_IDR;
+		return SWD_ACK_OK;
+	default:
+		if (!write)
+			*data = 0;
+		return SWD_ACK_OK;
+	}
+}
+
+static uint8_t dummy_dp_access(unsigned int reg, uint32_t *data, bool write)
+{
+	unsigned int bank = dummy_dp_select & DP_SELECT_DPBANK;
+
+	switch (reg) {
+	case 0x0:
+		if (write) {
+			/* ABORT */
+			if (*data & STKERRCLR)
+				dummy_dp_ctrl_stat &= ~SSTICKYERR;
+			if (*data & ORUNERRCLR)
+				dummy_dp_ctrl_stat &= ~SSTICKYORUN;
+			if (*data & STKCMPCLR)
+				dummy_dp_ctrl_stat &= ~SSTICKYCMP;
+		} else {
+			*data = bank ? 0 : DUMMY_DPIDR;
+		}
+		return SWD_ACK_OK;
+	case 0x4:
+		if (bank) {
+			/* DLCR and the other banked registers read as zero */
+			if (!write)
+				*data = 0;
+		} else if (write) {
+			dummy_dp_ctrl_stat = (dummy_dp_ctrl_stat & SSTICKYERR)
+				| (*data & (CDBGRSTREQ | CDBGPWRUPREQ | CSYSPWRUPREQ));
+		} else {
+			/* power and reset requests are acknowledged at once */
+			*data = dummy_dp_ctrl_stat | ((dummy_dp_ctrl_stat &
+					(CDBGRSTREQ | CDBGPWRUPREQ | CSYSPWRUPREQ)) << 1);
+		}
+		return SWD_ACK_OK;
+	case 0x8:
+		if (write)
+			dummy_dp_select = *data;
+		else
+			*data = 0;
+		return SWD_ACK_OK;
+	default:
+		/* RDBUFF, TARGETSEL writes are ignored */
+		if (!write)
+			*data = dummy_dp_rdbuff;
+		return SWD_ACK_OK;
+	}
+}
+
+static void dummy_swd_transaction(uint8_t cmd, uint32_t *value, bool write)
+{
+	unsigned int reg = (cmd & SWD_CMD_A32) >> 1;
+	uint32_t data = write ? *value : 0;
+	uint8_t ack;
+
+	if (dummy_swd_queued_retval != ERROR_OK)
+		return;
+
+	dummy_swd_queued++;
+	if (write)
+		dummy_swd_stats.writes++;
+	else
+		dummy_swd_stats.reads++;
+
+	if (cmd & SWD_CMD_APNDP) {
+		dummy_swd_stats.ap_accesses++;
+		if (dummy_dp_ctrl_stat & SSTICKYERR) {
+			ack = SWD_ACK_FAULT;
+		} else {
+			reg |= dummy_dp_select & ADIV5_DP_SELECT_APBANK;
+			ack = dummy_ap_access(reg, &data, write);
+			if (ack == SWD_ACK_FAULT)
+				dummy_dp_ctrl_stat |= SSTICKYERR;
+		}
+		/* AP reads are posted, the data comes with the next read */
+		if (!write && ack == SWD_ACK_OK) {
+			uint32_t posted = dummy_dp_rdbuff;
+			dummy_dp_rdbuff = data;
+			data = posted;
+		}
+	} else {
+		ack = dummy_dp_access(reg, &data, write);
+	}
+
+	if (ack != SWD_ACK_OK) {
+		LOG_DEBUG_IO("dummy SWD %s %s reg %x ack %u", write ? "write" : "read",
+			(cmd & SWD_CMD_APNDP) ? "AP" : "DP", reg, ack);
+		dummy_swd_stats.faults++;
+		dummy_swd_queued_retval = swd_ack_to_error_code(ack);
+		return;
+	}
+
+	if (!write && value)
+		*value = data;
+}
+
+static int dummy_swd_init(void)
+{
+	return ERROR_OK;
+}
+
+static int dummy_swd_switch_seq(enum swd_special_seq seq)
+{
+	LOG_DEBUG_IO("dummy SWD sequence %d", seq);
+	return ERROR_OK;
+}
+
+static void dummy_swd_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay_hint)
+{
+	dummy_swd_transaction(cmd, value, false);
+}
+
+static void dummy_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay_hint)
+{
+	dummy_swd_transaction(cmd, &value, true);
+}
+
+static int dummy_swd_run_queue(void)
+{
+	uint64_t clocks = (uint64_t)dummy_swd_queued * DUMMY_SWD_CLOCKS + DUMMY_SWD_IDLE_CLOCKS;
+	unsigned int khz = adapter_get_speed_khz();
+	uint64_t time_us = dummy_latency_us;
+
+	if (khz)
+		time_us += clocks * 1000 / khz;
+
+	dummy_swd_stats.runs++;
+	dummy_swd_stats.clocks += clocks;
+	dummy_swd_stats.time_us += time_us;
+	if (time_us)
+		jtag_sleep(time_us);
+
+	int retval = dummy_swd_queued_retval;
+	dummy_swd_queued_retval = ERROR_OK;
+	dummy_swd_queued = 0;
+	return retval;
+}
+
+static const struct swd_driver dummy_swd = {
+	.init = dummy_swd_init,
+	.switch_seq = dummy_swd_switch_seq,
+	.read_reg = dummy_swd_read_reg,
+	.write_reg = dummy_swd_write_reg,
+	.run = dummy_swd_run_queue,
+};
+
+/* The simulated firmware reads the watched words of the MEM-AP memory
+ * directly, without SWD transactions and without touching the AP registers */
+static int dummy_config_watch(bool enabled, struct adapter_watch *watch)
+{
+	unsigned int i;
+
+	for (i = 0; i < DUMMY_MAX_WATCHES; i++) {
+		if (dummy_watches[i] == watch)
+			dummy_watches[i] = NULL;
+	}
+	watch->active = false;
+
+	if (!enabled)
+		return ERROR_OK;
+
+	uint32_t data;
+	if (watch->ap_num != 0 || (watch->address & 3) || watch->address > UINT32_MAX ||
+			!dummy_mem_access(watch->address, 4, &data, false)) {
+		LOG_DEBUG("cannot watch 0x%" PRIx64 " on AP 0x%" PRIx64,
+			(uint64_t)watch->address, watch->ap_num);
+		return ERROR_FAIL;
+	}
+
+	for (i = 0; i < DUMMY_MAX_WATCHES; i++) {
+		if (!dummy_watches[i]) {
+			dummy_watches[i] = watch;
+			watch->active = true;
+			return ERROR_OK;
+		}
+	}
+
+	LOG_DEBUG("no free watch");
+	return ERROR_FAIL;
+}
+
+static int dummy_poll_watch(struct adapter_watch *watch, bool *changed, uint32_t *value)
+{
+	uint32_t data;
+
+	dummy_swd_stats.watch_polls++;
+
+	if (!dummy_mem_access(watch->address, 4, &data, false))
+		return ERROR_FAIL;
+
+	*changed = (data ^ watch->value) & watch->mask;
+	if (*changed)
+		*value = data;
+	return ERROR_OK;
+}
+
 static int dummy_init(void)
 {
 	bitbang_interface = &dummy_bitbang;
 
+	dummy_mem = calloc(1, dummy_mem_size);
+	if (!dummy_mem) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
 	return ERROR_OK;
 }
 
 static int dummy_quit(void)
 {
+	for (unsigned int i = 0; i < DUMMY_MAX_WATCHES; i++) {
+		if (dummy_watches[i]) {
+			dummy_watches[i]->active = false;
+			dummy_watches[i] = NULL;
+		}
+	}
+
+	free(dummy_mem);
+	dummy_mem = NULL;
+
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(dummy_handle_memory_command)
+{
+	if (CMD_ARGC == 0) {
+		command_print(CMD, "0x%08" PRIx32 " 0x%08" PRIx32, dummy_mem_base, dummy_mem_size);
+		return ERROR_OK;
+	}
+
+	if (CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	uint32_t base, size;
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[0], base);
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], size);
+	if (!size || (base & 3) || (size & 3) || base + (uint64_t)size > 0x100000000ull) {
+		command_print(CMD, "memory must be word aligned and within 32 bit addresses");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	dummy_mem_base = base;
+	dummy_mem_size = size;
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(dummy_handle_latency_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], dummy_latency_us);
+
+	command_print(CMD, "%u us", dummy_latency_us);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(dummy_handle_stats_command)
+{
+	if (CMD_ARGC > 1 || (CMD_ARGC == 1 && strcmp(CMD_ARGV[0], "clear")))
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	command_print(CMD, "queue runs:   %" PRIu64, dummy_swd_stats.runs);
+	command_print(CMD, "reads:        %" PRIu64, dummy_swd_stats.reads);
+	command_print(CMD, "writes:       %" PRIu64, dummy_swd_stats.writes);
+	command_print(CMD, "AP accesses:  %" PRIu64, dummy_swd_stats.ap_accesses);
+	command_print(CMD, "faults:       %" PRIu64, dummy_swd_stats.faults);
+	command_print(CMD, "SWD clocks:   %" PRIu64, dummy_swd_stats.clocks);
+	command_print(CMD, "time (us):    %" PRIu64, dummy_swd_stats.time_us);
+	command_print(CMD, "watch polls:  %" PRIu64, dummy_swd_stats.watch_polls);
+
+	if (CMD_ARGC == 1)
+		memset(&dummy_swd_stats, 0, sizeof(dummy_swd_stats));
+
+	return ERROR_OK;
+}
+
+static const struct command_registration dummy_subcommand_handlers[] = {
+	{
+		.name = "memory",
+		.handler = dummy_handle_memory_command,
+		.mode = COMMAND_CONFIG,
+		.help = "set the memory behind the simulated MEM-AP",
+		.usage = "[base size]",
+	},
+	{
+		.name = "latency",
+		.handler = dummy_handle_latency_command,
+		.mode = COMMAND_ANY,
+		.help = "set the time spent on every SWD queue run, in microseconds",
+		.usage = "[us]",
+	},
+	{
+		.name = "stats",
+		.handler = dummy_handle_stats_command,
+		.mode = COMMAND_EXEC,
+		.help = "show the SWD transaction counters",
+		.usage = "['clear']",
+	},
+	{
+		.chain = hello_command_handlers,
+	},
+	COMMAND_REGISTRATION_DONE,
+};
+
 static const struct command_registration dummy_command_handlers[] = {
 	{
 		.name = "dummy",
 		.mode = COMMAND_ANY,
 		.help = "dummy interface driver commands",
-		.chain = hello_command_handlers,
+		.chain = dummy_subcommand_handlers,
 		.usage = "",
 	},
 	COMMAND_REGISTRATION_DONE,
 };
 
+static const char * const dummy_transports[] = { "jtag", "swd", NULL };
+
 /* The dummy driver is used to easily check the code path
- * where the target is unresponsive.
+ * where the target is unresponsive with JTAG, and to simulate
+ * a DAP with SWD.
  */
 static struct jtag_interface dummy_interface = {
 	.supported = DEBUG_CAP_TMS_SEQ,
@@ -140,7 +571,7 @@ static struct jtag_interface dummy_interface = {
 
 struct adapter_driver dummy_adapter_driver = {
 	.name = "dummy",
-	.transports = jtag_only,
+	.transports = dummy_transports,
 	.commands = dummy_command_handlers,
 
 	.init = &dummy_init,
@@ -149,6 +580,9 @@ struct adapter_driver dummy_adapter_driver = {
 	.speed = &dummy_speed,
 	.khz = &dummy_khz,
 	.speed_div = &dummy_speed_div,
+	.config_watch = &dummy_config_watch,
+	.poll_watch = &dummy_poll_watch,
 
 	.jtag_ops = &dummy_interface,
+	.swd_ops = &dummy_swd,
 };
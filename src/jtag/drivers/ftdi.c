@@ -104,6 +104,8 @@ struct signal {
 };
 
 static struct signal *signals;
+/* SWDIO_OE, looked up once instead of for each turnaround of an SWD transaction */
+static struct signal *swdio_oe;
 
 /* FIXME: Where to store per-instance data? We need an SWD context. */
 static struct swd_cmd_queue_entry {
@@ -113,6 +115,8 @@ static struct swd_cmd_queue_entry {
 } *swd_cmd_queue;
 static size_t swd_cmd_queue_length;
 static size_t swd_cmd_queue_alloced;
+/* Growing the queue requires a flush, start with about what fits in one MPSSE buffer */
+#define SWD_CMD_QUEUE_INITIAL_SIZE 512
 static int queued_retval;
 static int freq;
 
@@ -624,7 +628,7 @@ static void ftdi_execute_command(struct jtag_command *cmd)
 	}
 }
 
-static int ftdi_execute_queue(struct jtag_command *cmd_queue)
+static void ftdi_queue_commands(struct jtag_command *cmd_queue)
 {
 	/* blink, if the current layout has that feature */
 	struct signal *led = find_signal_by_name("LED");
@@ -638,6 +642,11 @@ static int ftdi_execute_queue(struct jtag_command *cmd_queue)
 
 	if (led)
 		ftdi_set_signal(led, '0');
+}
+
+static int ftdi_execute_queue(struct jtag_command *cmd_queue)
+{
+	ftdi_queue_commands(cmd_queue);
 
 	int retval = mpsse_flush(mpsse_ctx);
 	if (retval != ERROR_OK)
@@ -646,6 +655,26 @@ static int ftdi_execute_queue(struct jtag_command *cmd_queue)
 	return retval;
 }
 
+static int ftdi_submit_queue(struct jtag_command *cmd_queue)
+{
+	ftdi_queue_commands(cmd_queue);
+
+	int retval = mpsse_flush_submit(mpsse_ctx);
+	if (retval != ERROR_OK)
+		LOG_ERROR("error while flushing MPSSE queue: %d", retval);
+
+	return retval;
+}
+
+static int ftdi_complete_queue(void)
+{
+	int retval = mpsse_flush_complete(mpsse_ctx);
+	if (retval != ERROR_OK)
+		LOG_ERROR("error while flushing MPSSE queue: %d", retval);
+
+	return retval;
+}
+
 static int ftdi_initialize(void)
 {
 	if (tap_get_tms_path_len(TAP_IRPAUSE, TAP_IRPAUSE) == 7)
@@ -808,6 +837,9 @@ COMMAND_HANDLER(ftdi_handle_layout_signal_command)
 	sig->invert_oe = invert_oe;
 	sig->oe_mask = oe_mask;
 
+	if (strcmp(sig->name, "SWDIO_OE") == 0)
+		swdio_oe = sig;
+
 	return ERROR_OK;
 }
 
@@ -1028,7 +1060,7 @@ static int ftdi_swd_init(void)
 	if (create_signals() != ERROR_OK)
 		return ERROR_FAIL;
 
-	swd_cmd_queue_alloced = 10;
+	swd_cmd_queue_alloced = SWD_CMD_QUEUE_INITIAL_SIZE;
 	swd_cmd_queue = malloc(swd_cmd_queue_alloced * sizeof(*swd_cmd_queue));
 
 	return swd_cmd_queue ? ERROR_OK : ERROR_FAIL;
@@ -1036,7 +1068,7 @@ static int ftdi_swd_init(void)
 
 static void ftdi_swd_swdio_en(bool enable)
 {
-	struct signal *oe = find_signal_by_name("SWDIO_OE");
+	struct signal *oe = swdio_oe;
 	if (oe) {
 		if (oe->data_mask)
 			ftdi_set_signal(oe, enable ? '1' : '0');
@@ -1250,8 +1282,10 @@ static const struct swd_driver ftdi_swd = {
 static const char * const ftdi_transports[] = { "jtag", "swd", NULL };
 
 static struct jtag_interface ftdi_interface = {
-	.supported = DEBUG_CAP_TMS_SEQ,
+	.supported = DEBUG_CAP_TMS_SEQ | DEBUG_CAP_ASYNC_QUEUE,
 	.execute_queue = ftdi_execute_queue,
+	.submit_queue = ftdi_submit_queue,
+	.complete_queue = ftdi_complete_queue,
 };
 
 struct adapter_driver ftdi_adapter_driver = {
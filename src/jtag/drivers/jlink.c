@@ -50,6 +50,11 @@ static bool trace_enabled;
 
 #define JLINK_MAX_SPEED			12000
 #define JLINK_TAP_BUFFER_SIZE	2048
+/*
+ * Upper limit of the SWD transaction buffer. The size actually used is bound
+ * by the free device internal memory, see adjust_swd_buffer_size().
+ */
+#define JLINK_SWD_BUFFER_SIZE	16384
 
 static unsigned int swd_buffer_size = JLINK_TAP_BUFFER_SIZE;
 
@@ -472,7 +477,7 @@ static bool adjust_swd_buffer_size(void)
 		return false;
 	}
 
-	tmp = MIN(JLINK_TAP_BUFFER_SIZE, (tmp - 16) / 2);
+	tmp = MIN(JLINK_SWD_BUFFER_SIZE, (tmp - 16) / 2);
 
 	if (tmp != swd_buffer_size) {
 		swd_buffer_size = tmp;
@@ -1964,9 +1969,9 @@ static void jlink_swd_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay_c
 
 static unsigned int tap_length;
 /* In SWD mode use tms buffer for direction control */
-static uint8_t tms_buffer[JLINK_TAP_BUFFER_SIZE];
-static uint8_t tdi_buffer[JLINK_TAP_BUFFER_SIZE];
-static uint8_t tdo_buffer[JLINK_TAP_BUFFER_SIZE];
+static uint8_t tms_buffer[JLINK_SWD_BUFFER_SIZE];
+static uint8_t tdi_buffer[JLINK_SWD_BUFFER_SIZE];
+static uint8_t tdo_buffer[JLINK_SWD_BUFFER_SIZE];
 
 struct pending_scan_result {
 	/** First bit position in tdo_buffer to read. */
@@ -1981,17 +1986,21 @@ struct pending_scan_result {
 	uint8_t swd_cmd;
 };
 
-#define MAX_PENDING_SCAN_RESULTS 256
+/* enough for a full SWD buffer of the shortest (46 bits) transactions */
+#define MAX_PENDING_SCAN_RESULTS DIV_ROUND_UP(JLINK_SWD_BUFFER_SIZE * 8, 46)
 
 static int pending_scan_results_length;
 static struct pending_scan_result pending_scan_results_buffer[MAX_PENDING_SCAN_RESULTS];
 
 static void jlink_tap_init(void)
 {
+	/* only the bytes used by the previous transfer need to be cleared */
+	unsigned int used = MIN(DIV_ROUND_UP(tap_length, 8), sizeof(tms_buffer));
+
 	tap_length = 0;
 	pending_scan_results_length = 0;
-	memset(tms_buffer, 0, sizeof(tms_buffer));
-	memset(tdi_buffer, 0, sizeof(tdi_buffer));
+	memset(tms_buffer, 0, used);
+	memset(tdi_buffer, 0, used);
 }
 
 static void jlink_clock_data(const uint8_t *out, unsigned int out_offset,
@@ -36,6 +36,9 @@ static struct sockaddr_in serv_addr;
 static uint8_t *last_ir_buf;
 static int last_ir_num_bits;
 
+/* IR scans of a runtest sent before their replies are read back */
+#define RUNTEST_BATCH_SCANS 64
+
 static int write_sock(char *buf, size_t len)
 {
 	if (!buf) {
@@ -190,26 +193,38 @@ static int jtag_dpi_runtest(unsigned int num_cycles)
 	}
 	snprintf(buf, sizeof(buf), "ib %d\n", num_bits);
 	while (num_cycles > 0) {
-		ret = write_sock(buf, strlen(buf));
-		if (ret != ERROR_OK) {
-			LOG_ERROR("write_sock() fail, file %s, line %d",
-				__FILE__, __LINE__);
-			goto out;
-		}
-		ret = write_sock((char *)data_buf, bytes);
-		if (ret != ERROR_OK) {
-			LOG_ERROR("write_sock() fail, file %s, line %d",
-				__FILE__, __LINE__);
-			goto out;
-		}
-		ret = read_sock((char *)read_scan, bytes);
-		if (ret != ERROR_OK) {
-			LOG_ERROR("read_sock() fail, file %s, line %d",
-				__FILE__, __LINE__);
-			goto out;
+		/* the replies are not used: send a batch of scans, then drain
+		 * their replies, rather than waiting for each of them */
+		unsigned int batch = 0;
+		while (num_cycles > 0 && batch < RUNTEST_BATCH_SCANS) {
+			ret = write_sock(buf, strlen(buf));
+			if (ret != ERROR_OK) {
+				LOG_ERROR("write_sock() fail, file %s, line %d",
+					__FILE__, __LINE__);
+				goto out;
+			}
+			ret = write_sock((char *)data_buf, bytes);
+			if (ret != ERROR_OK) {
+				LOG_ERROR("write_sock() fail, file %s, line %d",
+					__FILE__, __LINE__);
+				goto out;
+			}
+			batch++;
+
+			if (num_cycles <= (unsigned int)num_bits + 6)
+				num_cycles = 0;
+			else
+				num_cycles -= num_bits + 6;
 		}
 
-		num_cycles -= num_bits + 6;
+		while (batch--) {
+			ret = read_sock((char *)read_scan, bytes);
+			if (ret != ERROR_OK) {
+				LOG_ERROR("read_sock() fail, file %s, line %d",
+					__FILE__, __LINE__);
+				goto out;
+			}
+		}
 	}
 
 out:
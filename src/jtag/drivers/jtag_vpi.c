@@ -22,7 +22,15 @@
 #include <netinet/tcp.h>
 #endif
 
+#ifdef HAVE_SYS_MMAN_H
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #include "helper/replacements.h"
+#include <helper/time_support.h>
 
 #define NO_TAP_SHIFT	0
 #define TAP_SHIFT	1
@@ -38,6 +46,10 @@
 #define CMD_SCAN_CHAIN_FLIP_TMS	3
 #define CMD_STOP_SIMU		4
 
+/* Scan replies left unread before waiting for them. A reply is about 1 KiB,
+ * keep them well within what the socket buffers can hold. */
+#define MAX_PENDING_XFERS	32
+
 /* jtag_vpi server port and address to connect to */
 static int server_port = DEFAULT_SERVER_PORT;
 static char *server_address;
@@ -48,6 +60,60 @@ static bool stop_sim_on_exit;
 static int sockfd;
 static struct sockaddr_in serv_addr;
 
+/*
+ * Shared memory transport, for a simulator on the same machine: a file
+ * set up by the simulator side, mapped by both processes. The packets
+ * are the same struct vpi_cmd as over TCP, in two rings of slots.
+ *
+ * - header (64 bytes): "OOCDVPIS", u32 version (1), u32 number of slots
+ *   of each ring, u32 slot size (sizeof(struct vpi_cmd)), u32 ready,
+ *   set to 1 by the simulator once the rest is set up.
+ * - ring to the simulator then ring from the simulator, each with a
+ *   64 byte line holding the u32 count of packets written, a 64 byte line
+ *   holding the u32 count of packets read, then the slots.
+ *
+ * All the fields are in host endianness, the packets in little endian.
+ * The counts wrap at 2^32, packet n is in slot n % number of slots.
+ */
+#define SHM_MAGIC			"OOCDVPIS"
+#define SHM_VERSION			1
+#define SHM_HDR_SIZE		64
+#define SHM_LINE_SIZE		64
+/* busy polls before yielding the CPU, then before sleeping */
+#define SHM_SPINS			1000
+#define SHM_YIELDS			1000
+/* time without progress of the simulator after which it is given up */
+#define SHM_TIMEOUT_MS		30000
+
+struct jtag_vpi_ring {
+	volatile uint32_t *head;
+	volatile uint32_t *tail;
+	uint8_t *slots;
+};
+
+static char *shm_path;
+static struct {
+	uint8_t *map;
+	size_t size;
+	uint32_t num_slots;
+	struct jtag_vpi_ring to_sim;
+	struct jtag_vpi_ring from_sim;
+} shm;
+
+/* Scan chunks sent, whose reply has not been read yet */
+static struct {
+	uint8_t *bits;
+	int nb_bits;
+} pending_xfers[MAX_PENDING_XFERS];
+static unsigned int pending_xfers_count;
+
+/* Scans waiting for the replies of their chunks */
+static struct {
+	struct scan_command *cmd;
+	uint8_t *buf;
+} pending_scans[MAX_PENDING_XFERS];
+static unsigned int pending_scans_count;
+
 /* One jtag_vpi "packet" as sent over a TCP channel. */
 struct vpi_cmd {
 	union {
@@ -84,6 +150,163 @@ static char *jtag_vpi_cmd_to_str(int cmd_num)
 	}
 }
 
+#ifdef HAVE_SYS_MMAN_H
+struct jtag_vpi_shm_waiter {
+	unsigned int polls;
+	/* end of the wait, set once done spinning */
+	int64_t timeout;
+};
+
+/* Returns ERROR_TIMEOUT_REACHED once the simulator made no progress for
+ * SHM_TIMEOUT_MS */
+static int jtag_vpi_shm_wait(struct jtag_vpi_shm_waiter *w, const char *what)
+{
+	w->polls++;
+	if (w->polls < SHM_SPINS)
+		return ERROR_OK;
+	if (w->polls == SHM_SPINS) {
+		w->timeout = timeval_ms() + SHM_TIMEOUT_MS;
+	} else if (timeval_ms() > w->timeout) {
+		LOG_ERROR("jtag_vpi: timeout waiting for the simulator %s", what);
+		return ERROR_TIMEOUT_REACHED;
+	}
+	if (w->polls < SHM_SPINS + SHM_YIELDS)
+		sched_yield();
+	else
+		usleep(50);
+	return ERROR_OK;
+}
+
+static int jtag_vpi_shm_send(const struct vpi_cmd *vpi)
+{
+	struct jtag_vpi_ring *ring = &shm.to_sim;
+	uint32_t head = *ring->head;
+	struct jtag_vpi_shm_waiter w = { 0 };
+
+	/* wait for a free slot */
+	while (head - __atomic_load_n(ring->tail, __ATOMIC_ACQUIRE) >= shm.num_slots) {
+		int retval = jtag_vpi_shm_wait(&w, "to read a packet");
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	memcpy(ring->slots + (size_t)(head % shm.num_slots) * sizeof(*vpi), vpi, sizeof(*vpi));
+	__atomic_store_n(ring->head, head + 1, __ATOMIC_RELEASE);
+
+	return ERROR_OK;
+}
+
+static int jtag_vpi_shm_receive(struct vpi_cmd *vpi)
+{
+	struct jtag_vpi_ring *ring = &shm.from_sim;
+	uint32_t tail = *ring->tail;
+	struct jtag_vpi_shm_waiter w = { 0 };
+
+	while (__atomic_load_n(ring->head, __ATOMIC_ACQUIRE) == tail) {
+		int retval = jtag_vpi_shm_wait(&w, "to reply");
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	memcpy(vpi, ring->slots + (size_t)(tail % shm.num_slots) * sizeof(*vpi), sizeof(*vpi));
+	__atomic_store_n(ring->tail, tail + 1, __ATOMIC_RELEASE);
+
+	return ERROR_OK;
+}
+
+static void jtag_vpi_shm_ring(struct jtag_vpi_ring *ring, uint8_t *base)
+{
+	ring->head = (volatile uint32_t *)base;
+	ring->tail = (volatile uint32_t *)(base + SHM_LINE_SIZE);
+	ring->slots = base + 2 * SHM_LINE_SIZE;
+}
+
+static int jtag_vpi_shm_open(void)
+{
+	int fd = open(shm_path, O_RDWR);
+	if (fd < 0) {
+		LOG_ERROR("jtag_vpi: cannot open '%s': %s", shm_path, strerror(errno));
+		return ERROR_COMMAND_CLOSE_CONNECTION;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) < 0 || st.st_size < SHM_HDR_SIZE) {
+		close(fd);
+		LOG_ERROR("jtag_vpi: '%s' is not a jtag_vpi shared memory file", shm_path);
+		return ERROR_FAIL;
+	}
+
+	uint8_t *map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		LOG_ERROR("jtag_vpi: cannot map '%s': %s", shm_path, strerror(errno));
+		return ERROR_FAIL;
+	}
+
+	uint32_t version, num_slots, slot_size;
+	memcpy(&version, map + 8, 4);
+	memcpy(&num_slots, map + 12, 4);
+	memcpy(&slot_size, map + 16, 4);
+	size_t ring_size = 2 * SHM_LINE_SIZE + (size_t)num_slots * sizeof(struct vpi_cmd);
+	if (memcmp(map, SHM_MAGIC, 8) || version != SHM_VERSION || !num_slots ||
+			slot_size != sizeof(struct vpi_cmd) ||
+			(size_t)st.st_size < SHM_HDR_SIZE + 2 * ring_size) {
+		munmap(map, st.st_size);
+		LOG_ERROR("jtag_vpi: '%s' is not a jtag_vpi shared memory file of version %d",
+			shm_path, SHM_VERSION);
+		return ERROR_FAIL;
+	}
+
+	/* the simulator may still be setting up the rings */
+	volatile uint32_t *ready = (volatile uint32_t *)(map + 20);
+	struct jtag_vpi_shm_waiter w = { 0 };
+	while (!__atomic_load_n(ready, __ATOMIC_ACQUIRE)) {
+		if (jtag_vpi_shm_wait(&w, "to set up the rings") != ERROR_OK) {
+			munmap(map, st.st_size);
+			return ERROR_FAIL;
+		}
+		keep_alive();
+	}
+
+	shm.map = map;
+	shm.size = st.st_size;
+	shm.num_slots = num_slots;
+	jtag_vpi_shm_ring(&shm.to_sim, map + SHM_HDR_SIZE);
+	jtag_vpi_shm_ring(&shm.from_sim, map + SHM_HDR_SIZE + ring_size);
+
+	LOG_INFO("jtag_vpi: using shared memory '%s', %" PRIu32 " slots", shm_path, num_slots);
+
+	return ERROR_OK;
+}
+
+static void jtag_vpi_shm_close(void)
+{
+	if (shm.map)
+		munmap(shm.map, shm.size);
+	shm.map = NULL;
+}
+#else
+static int jtag_vpi_shm_send(const struct vpi_cmd *vpi)
+{
+	return ERROR_FAIL;
+}
+
+static int jtag_vpi_shm_receive(struct vpi_cmd *vpi)
+{
+	return ERROR_FAIL;
+}
+
+static int jtag_vpi_shm_open(void)
+{
+	LOG_ERROR("jtag_vpi: shared memory not supported on this host");
+	return ERROR_FAIL;
+}
+
+static void jtag_vpi_shm_close(void)
+{
+}
+#endif /* HAVE_SYS_MMAN_H */
+
 static int jtag_vpi_send_cmd(struct vpi_cmd *vpi)
 {
 	int retval;
@@ -125,6 +348,9 @@ static int jtag_vpi_send_cmd(struct vpi_cmd *vpi)
 	h_u32_to_le(vpi->length_buf, vpi->length);
 	h_u32_to_le(vpi->nb_bits_buf, vpi->nb_bits);
 
+	if (shm.map)
+		return jtag_vpi_shm_send(vpi) == ERROR_OK ? ERROR_OK : ERROR_FAIL;
+
 retry_write:
 	retval = write_socket(sockfd, vpi, sizeof(struct vpi_cmd));
 
@@ -159,6 +385,14 @@ retry_write:
 static int jtag_vpi_receive_cmd(struct vpi_cmd *vpi)
 {
 	unsigned int bytes_buffered = 0;
+
+	if (shm.map) {
+		int retval = jtag_vpi_shm_receive(vpi);
+		if (retval != ERROR_OK)
+			return ERROR_FAIL;
+		bytes_buffered = sizeof(struct vpi_cmd);
+	}
+
 	while (bytes_buffered < sizeof(struct vpi_cmd)) {
 		int bytes_to_receive = sizeof(struct vpi_cmd) - bytes_buffered;
 		int retval = read_socket(sockfd, ((char *)vpi) + bytes_buffered, bytes_to_receive);
@@ -289,6 +523,69 @@ static int jtag_vpi_state_move(enum tap_state state)
 	return ERROR_OK;
 }
 
+static int jtag_vpi_receive_xfer(uint8_t *bits, int nb_bits)
+{
+	struct vpi_cmd vpi;
+	int nb_bytes = DIV_ROUND_UP(nb_bits, 8);
+
+	int retval = jtag_vpi_receive_cmd(&vpi);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* Optional low-level JTAG debug */
+	if (LOG_LEVEL_IS(LOG_LVL_DEBUG_IO)) {
+		char *char_buf = buf_to_hex_str(vpi.buffer_in,
+				(nb_bits > DEBUG_JTAG_IOZ) ? DEBUG_JTAG_IOZ : nb_bits);
+		LOG_DEBUG_IO("recvd JTAG VPI data: nb_bits=%d, buf_in=0x%s%s",
+			nb_bits, char_buf, (nb_bits > DEBUG_JTAG_IOZ) ? "(...)" : "");
+		free(char_buf);
+	}
+
+	if (bits)
+		memcpy(bits, vpi.buffer_in, nb_bytes);
+
+	return ERROR_OK;
+}
+
+/**
+ * jtag_vpi_flush - collect the replies of the scan chunks sent so far
+ *
+ * The replies come back in the order the chunks were sent. Once they are all
+ * in, the scans they belong to are completed.
+ */
+/* Forget the chunks and scans in flight, after an error */
+static void jtag_vpi_drop_pending(void)
+{
+	for (unsigned int i = 0; i < pending_scans_count; i++)
+		free(pending_scans[i].buf);
+	pending_scans_count = 0;
+	pending_xfers_count = 0;
+}
+
+static int jtag_vpi_flush(void)
+{
+	int retval = ERROR_OK;
+
+	for (unsigned int i = 0; i < pending_xfers_count; i++) {
+		int ret = jtag_vpi_receive_xfer(pending_xfers[i].bits, pending_xfers[i].nb_bits);
+		if (ret != ERROR_OK) {
+			jtag_vpi_drop_pending();
+			return ret;
+		}
+	}
+	pending_xfers_count = 0;
+
+	for (unsigned int i = 0; i < pending_scans_count; i++) {
+		int ret = jtag_read_buffer(pending_scans[i].buf, pending_scans[i].cmd);
+		if (ret != ERROR_OK)
+			retval = ret;
+		free(pending_scans[i].buf);
+	}
+	pending_scans_count = 0;
+
+	return retval;
+}
+
 static int jtag_vpi_queue_tdi_xfer(uint8_t *bits, int nb_bits, int tap_shift)
 {
 	struct vpi_cmd vpi;
@@ -306,25 +603,21 @@ static int jtag_vpi_queue_tdi_xfer(uint8_t *bits, int nb_bits, int tap_shift)
 	vpi.length = nb_bytes;
 	vpi.nb_bits = nb_bits;
 
-	int retval = jtag_vpi_send_cmd(&vpi);
-	if (retval != ERROR_OK)
-		return retval;
+	if (pending_xfers_count == MAX_PENDING_XFERS) {
+		int retval = jtag_vpi_flush();
+		if (retval != ERROR_OK)
+			return retval;
+	}
 
-	retval = jtag_vpi_receive_cmd(&vpi);
+	int retval = jtag_vpi_send_cmd(&vpi);
 	if (retval != ERROR_OK)
 		return retval;
 
-	/* Optional low-level JTAG debug */
-	if (LOG_LEVEL_IS(LOG_LVL_DEBUG_IO)) {
-		char *char_buf = buf_to_hex_str(vpi.buffer_in,
-				(nb_bits > DEBUG_JTAG_IOZ) ? DEBUG_JTAG_IOZ : nb_bits);
-		LOG_DEBUG_IO("recvd JTAG VPI data: nb_bits=%d, buf_in=0x%s%s",
-			nb_bits, char_buf, (nb_bits > DEBUG_JTAG_IOZ) ? "(...)" : "");
-		free(char_buf);
-	}
-
-	if (bits)
-		memcpy(bits, vpi.buffer_in, nb_bytes);
+	/* the reply is collected by jtag_vpi_flush(), so that the simulator
+	 * gets the next commands without waiting for a round trip */
+	pending_xfers[pending_xfers_count].bits = bits;
+	pending_xfers[pending_xfers_count].nb_bits = nb_bits;
+	pending_xfers_count++;
 
 	return ERROR_OK;
 }
@@ -393,21 +686,21 @@ static int jtag_vpi_scan(struct scan_command *cmd)
 	if (cmd->ir_scan) {
 		retval = jtag_vpi_state_move(TAP_IRSHIFT);
 		if (retval != ERROR_OK)
-			return retval;
+			goto error;
 	} else {
 		retval = jtag_vpi_state_move(TAP_DRSHIFT);
 		if (retval != ERROR_OK)
-			return retval;
+			goto error;
 	}
 
 	if (cmd->end_state == TAP_DRSHIFT) {
 		retval = jtag_vpi_queue_tdi(buf, scan_bits, NO_TAP_SHIFT);
 		if (retval != ERROR_OK)
-			return retval;
+			goto error;
 	} else {
 		retval = jtag_vpi_queue_tdi(buf, scan_bits, TAP_SHIFT);
 		if (retval != ERROR_OK)
-			return retval;
+			goto error;
 	}
 
 	if (cmd->end_state != TAP_DRSHIFT) {
@@ -417,7 +710,7 @@ static int jtag_vpi_scan(struct scan_command *cmd)
 		 */
 		retval = jtag_vpi_clock_tms(0);
 		if (retval != ERROR_OK)
-			return retval;
+			goto error;
 
 		if (cmd->ir_scan)
 			tap_set_state(TAP_IRPAUSE);
@@ -425,11 +718,15 @@ static int jtag_vpi_scan(struct scan_command *cmd)
 			tap_set_state(TAP_DRPAUSE);
 	}
 
-	retval = jtag_read_buffer(buf, cmd);
-	if (retval != ERROR_OK)
-		return retval;
-
-	free(buf);
+	/* completed by jtag_vpi_flush(), with the replies */
+	if (pending_scans_count == MAX_PENDING_XFERS) {
+		retval = jtag_vpi_flush();
+		if (retval != ERROR_OK)
+			goto error;
+	}
+	pending_scans[pending_scans_count].cmd = cmd;
+	pending_scans[pending_scans_count].buf = buf;
+	pending_scans_count++;
 
 	if (cmd->end_state != TAP_DRSHIFT) {
 		retval = jtag_vpi_state_move(cmd->end_state);
@@ -438,6 +735,12 @@ static int jtag_vpi_scan(struct scan_command *cmd)
 	}
 
 	return ERROR_OK;
+
+error:
+	/* chunks of this scan may be in flight, their replies would land in buf */
+	jtag_vpi_drop_pending();
+	free(buf);
+	return retval;
 }
 
 static int jtag_vpi_runtest(unsigned int num_cycles, enum tap_state state)
@@ -519,6 +822,10 @@ static int jtag_vpi_execute_queue(struct jtag_command *cmd_queue)
 		}
 	}
 
+	int flush_retval = jtag_vpi_flush();
+	if (retval == ERROR_OK)
+		retval = flush_retval;
+
 	return retval;
 }
 
@@ -526,6 +833,9 @@ static int jtag_vpi_init(void)
 {
 	int flag = 1;
 
+	if (shm_path)
+		return jtag_vpi_shm_open();
+
 	sockfd = socket(AF_INET, SOCK_STREAM, 0);
 	if (sockfd < 0) {
 		LOG_ERROR("jtag_vpi: Could not create client socket");
@@ -581,11 +891,14 @@ static int jtag_vpi_quit(void)
 		if (jtag_vpi_stop_simulation() != ERROR_OK)
 			LOG_WARNING("jtag_vpi: failed to send \"stop simulation\" command");
 	}
-	if (close_socket(sockfd) != 0) {
+	if (shm_path) {
+		jtag_vpi_shm_close();
+	} else if (close_socket(sockfd) != 0) {
 		LOG_WARNING("jtag_vpi: could not close jtag_vpi client socket");
 		log_socket_error("jtag_vpi");
 	}
 	free(server_address);
+	free(shm_path);
 	return ERROR_OK;
 }
 
@@ -613,6 +926,18 @@ COMMAND_HANDLER(jtag_vpi_set_address)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(jtag_vpi_set_shm)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	free(shm_path);
+	shm_path = strdup(CMD_ARGV[0]);
+	LOG_INFO("jtag_vpi: shared memory file set to %s", shm_path);
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(jtag_vpi_stop_sim_on_exit_handler)
 {
 	if (CMD_ARGC != 1)
@@ -637,6 +962,14 @@ static const struct command_registration jtag_vpi_subcommand_handlers[] = {
 		.help = "set the IP address of the jtag_vpi server (default: 127.0.0.1)",
 		.usage = "ipv4_addr",
 	},
+	{
+		.name = "set_shm",
+		.handler = &jtag_vpi_set_shm,
+		.mode = COMMAND_CONFIG,
+		.help = "use the shared memory file set up by the simulator, "
+			"instead of TCP",
+		.usage = "filename",
+	},
 	{
 		.name = "stop_sim_on_exit",
 		.handler = &jtag_vpi_stop_sim_on_exit_handler,
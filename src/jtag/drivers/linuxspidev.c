@@ -66,6 +66,9 @@
 // Maximum number of SWD transactions to queue together in a SPI exchange
 #define MAX_QUEUE_ENTRIES 64
 
+// Largest single transfer the spidev kernel driver accepts
+#define SPIDEV_BUFSIZ_PATH "/sys/module/spidev/parameters/bufsiz"
+
 #define CMD_BITS 8
 #define TURN_BITS 1
 #define ACK_BITS 3
@@ -241,6 +244,21 @@ static void spidev_clear_queue(void)
 	memset(tx_flip_buf, 0, queue_buf_size);
 }
 
+/* Largest transfer spidev accepts in one message, 0 when unknown */
+static unsigned int spidev_max_transfer(void)
+{
+	unsigned int bufsiz = 0;
+	FILE *f = fopen(SPIDEV_BUFSIZ_PATH, "r");
+
+	if (!f)
+		return 0;
+	if (fscanf(f, "%u", &bufsiz) != 1)
+		bufsiz = 0;
+	fclose(f);
+
+	return bufsiz;
+}
+
 static int spidev_alloc_queue(unsigned int new_queue_entries)
 {
 	if (queue_fill || queue_buf_fill) {
@@ -332,8 +350,23 @@ static int spidev_init(void)
 	LOG_INFO("Opened SPI device at %s in mode 0x%" PRIx32 " with %" PRIu8 " bits ",
 		spi_path, spi_mode, spi_bits);
 
+	/* Fill the largest transfer spidev allows, so long runs of transactions
+	 * go out in as few ioctl calls as possible */
+	unsigned int max_transfer = spidev_max_transfer();
+	unsigned int max_entries = MAX_QUEUE_ENTRIES;
+	if (max_transfer > END_IDLE_BYTES)
+		max_entries = (max_transfer - END_IDLE_BYTES) / (SWD_OP_BYTES + AP_DELAY_BYTES);
+
 	if (max_queue_entries == 0) {
-		ret = spidev_alloc_queue(MAX_QUEUE_ENTRIES);
+		ret = spidev_alloc_queue(MAX(max_entries, MAX_QUEUE_ENTRIES));
+		if (ret != ERROR_OK)
+			return ERROR_JTAG_INIT_FAILED;
+	}
+
+	if (max_transfer && queue_buf_size > max_transfer) {
+		LOG_WARNING("Queue of %u bytes exceeds spidev bufsiz %u, limiting to %u entries",
+			queue_buf_size, max_transfer, max_entries);
+		ret = spidev_alloc_queue(max_entries);
 		if (ret != ERROR_OK)
 			return ERROR_JTAG_INIT_FAILED;
 	}
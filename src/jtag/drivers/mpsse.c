@@ -48,10 +48,36 @@
 #define SIO_GET_LATENCY_TIMER_REQUEST 0x0A
 #define SIO_SET_BITMODE_REQUEST       0x0B
 
+/* Number of read transfers kept in flight by mpsse_flush() */
+#define MPSSE_READ_TRANSFERS 4
+
 #define SIO_RESET_SIO 0
 #define SIO_RESET_PURGE_RX 1
 #define SIO_RESET_PURGE_TX 2
 
+struct mpsse_ctx;
+
+/* Context needed by the callbacks */
+struct transfer_result {
+	struct mpsse_ctx *ctx;
+	bool done;
+	unsigned int transferred;
+	/* number of transfers submitted and not completed yet */
+	unsigned int in_flight;
+};
+
+/* Transfers of a flush started by mpsse_flush_submit() */
+struct mpsse_flush_state {
+	bool pending;
+	/* libusb error met while submitting */
+	int usb_retval;
+	struct libusb_transfer *write_transfer;
+	struct libusb_transfer *read_transfer[MPSSE_READ_TRANSFERS];
+	unsigned int read_transfers;
+	struct transfer_result write_result;
+	struct transfer_result read_result;
+};
+
 struct mpsse_ctx {
 	struct libusb_context *usb_ctx;
 	struct libusb_device_handle *usb_dev;
@@ -73,6 +99,7 @@ struct mpsse_ctx {
 	unsigned int read_chunk_size;
 	struct bit_copy_queue read_queue;
 	int retval;
+	struct mpsse_flush_state flush;
 };
 
 static void mpsse_purge(struct mpsse_ctx *ctx);
@@ -342,7 +369,7 @@ struct mpsse_ctx *mpsse_open(const uint16_t vids[], const uint16_t pids[], const
 	ctx->read_chunk_size = 16384;
 	ctx->read_size = 16384;
 	ctx->write_size = 16384;
-	ctx->read_chunk = malloc(ctx->read_chunk_size);
+	ctx->read_chunk = malloc(ctx->read_chunk_size * MPSSE_READ_TRANSFERS);
 	ctx->read_buffer = malloc(ctx->read_size);
 
 	/* Use calloc to make valgrind happy: buffer_write() sets payload
@@ -406,6 +433,9 @@ error:
 
 void mpsse_close(struct mpsse_ctx *ctx)
 {
+	if (ctx->flush.pending)
+		mpsse_flush_complete(ctx);
+
 	if (ctx->usb_dev)
 		libusb_close(ctx->usb_dev);
 	if (ctx->usb_ctx)
@@ -446,19 +476,34 @@ static void mpsse_purge(struct mpsse_ctx *ctx)
 	}
 }
 
+/* The buffers still belong to a submitted flush until it completes; its
+ * error is reported by the next mpsse_flush() */
+static void buffer_wait_pending(struct mpsse_ctx *ctx)
+{
+	if (!ctx->flush.pending)
+		return;
+
+	int retval = mpsse_flush_complete(ctx);
+	if (retval != ERROR_OK && ctx->retval == ERROR_OK)
+		ctx->retval = retval;
+}
+
 static unsigned int buffer_write_space(struct mpsse_ctx *ctx)
 {
+	buffer_wait_pending(ctx);
 	/* Reserve one byte for SEND_IMMEDIATE */
 	return ctx->write_size - ctx->write_count - 1;
 }
 
 static unsigned int buffer_read_space(struct mpsse_ctx *ctx)
 {
+	buffer_wait_pending(ctx);
 	return ctx->read_size - ctx->read_count;
 }
 
 static void buffer_write_byte(struct mpsse_ctx *ctx, uint8_t data)
 {
+	buffer_wait_pending(ctx);
 	LOG_DEBUG_IO("%02x", data);
 	assert(ctx->write_count < ctx->write_size);
 	ctx->write_buffer[ctx->write_count++] = data;
@@ -467,6 +512,7 @@ static void buffer_write_byte(struct mpsse_ctx *ctx, uint8_t data)
 static unsigned int buffer_write(struct mpsse_ctx *ctx, const uint8_t *out, unsigned int out_offset,
 	unsigned int bit_count)
 {
+	buffer_wait_pending(ctx);
 	LOG_DEBUG_IO("%d bits", bit_count);
 	assert(ctx->write_count + DIV_ROUND_UP(bit_count, 8) <= ctx->write_size);
 	bit_copy(ctx->write_buffer + ctx->write_count, 0, out, out_offset, bit_count);
@@ -477,6 +523,7 @@ static unsigned int buffer_write(struct mpsse_ctx *ctx, const uint8_t *out, unsi
 static unsigned int buffer_add_read(struct mpsse_ctx *ctx, uint8_t *in, unsigned int in_offset,
 	unsigned int bit_count, unsigned int offset)
 {
+	buffer_wait_pending(ctx);
 	LOG_DEBUG_IO("%d bits, offset %d", bit_count, offset);
 	assert(ctx->read_count + DIV_ROUND_UP(bit_count, 8) <= ctx->read_size);
 	bit_copy_queued(&ctx->read_queue, in, in_offset, ctx->read_buffer + ctx->read_count, offset,
@@ -781,13 +828,6 @@ int mpsse_set_frequency(struct mpsse_ctx *ctx, int frequency)
 	return frequency;
 }
 
-/* Context needed by the callbacks */
-struct transfer_result {
-	struct mpsse_ctx *ctx;
-	bool done;
-	unsigned int transferred;
-};
-
 static LIBUSB_CALL void read_cb(struct libusb_transfer *transfer)
 {
 	struct transfer_result *res = transfer->user_data;
@@ -795,10 +835,21 @@ static LIBUSB_CALL void read_cb(struct libusb_transfer *transfer)
 
 	unsigned int packet_size = ctx->max_packet_size;
 
+	res->in_flight--;
+
+	/* the other transfers in flight may complete after all the data is in */
+	if (res->done)
+		return;
+
+	if (transfer->status == LIBUSB_TRANSFER_CANCELLED) {
+		res->done = true;
+		return;
+	}
+
 	DEBUG_PRINT_BUF(transfer->buffer, transfer->actual_length);
 
 	/* Strip the two status bytes sent at the beginning of each USB packet
-	 * while copying the chunk buffer to the read buffer */
+	 * while copying the buffer of this transfer to the read buffer */
 	unsigned int num_packets = DIV_ROUND_UP(transfer->actual_length, packet_size);
 	unsigned int chunk_remains = transfer->actual_length;
 	for (unsigned int i = 0; i < num_packets && chunk_remains > 2; i++) {
@@ -808,7 +859,7 @@ static LIBUSB_CALL void read_cb(struct libusb_transfer *transfer)
 		if (this_size > ctx->read_count - res->transferred)
 			this_size = ctx->read_count - res->transferred;
 		memcpy(ctx->read_buffer + res->transferred,
-			ctx->read_chunk + packet_size * i + 2,
+			transfer->buffer + packet_size * i + 2,
 			this_size);
 		res->transferred += this_size;
 		chunk_remains -= this_size + 2;
@@ -821,9 +872,12 @@ static LIBUSB_CALL void read_cb(struct libusb_transfer *transfer)
 	LOG_DEBUG_IO("raw chunk %d, transferred %d of %d", transfer->actual_length, res->transferred,
 		ctx->read_count);
 
-	if (!res->done)
+	if (!res->done) {
 		if (libusb_submit_transfer(transfer) != LIBUSB_SUCCESS)
 			res->done = true;
+		else
+			res->in_flight++;
+	}
 }
 
 static LIBUSB_CALL void write_cb(struct libusb_transfer *transfer)
@@ -847,13 +901,25 @@ static LIBUSB_CALL void write_cb(struct libusb_transfer *transfer)
 	}
 }
 
-int mpsse_flush(struct mpsse_ctx *ctx)
+int mpsse_flush_submit(struct mpsse_ctx *ctx)
 {
-	int retval = ctx->retval;
+	struct mpsse_flush_state *flush = &ctx->flush;
+	int retval;
+
+	if (flush->pending) {
+		retval = mpsse_flush_complete(ctx);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	retval = ctx->retval;
 
 	if (retval != ERROR_OK) {
 		LOG_DEBUG_IO("Ignoring flush due to previous error");
-		assert(ctx->write_count == 0 && ctx->read_count == 0);
+		/* drop what was queued after a failed submitted flush */
+		ctx->write_count = 0;
+		ctx->read_count = 0;
+		bit_copy_discard(&ctx->read_queue);
 		ctx->retval = ERROR_OK;
 		return retval;
 	}
@@ -863,45 +929,93 @@ int mpsse_flush(struct mpsse_ctx *ctx)
 	assert(ctx->write_count > 0 || ctx->read_count == 0); /* No read data without write data */
 
 	if (ctx->write_count == 0)
-		return retval;
+		return ERROR_OK;
 
-	struct libusb_transfer *read_transfer = NULL;
-	struct transfer_result read_result = { .ctx = ctx, .done = true };
+	memset(flush, 0, sizeof(*flush));
+	flush->read_result.ctx = ctx;
+	flush->read_result.done = true;
 	if (ctx->read_count) {
 		buffer_write_byte(ctx, 0x87); /* SEND_IMMEDIATE */
-		read_result.done = false;
+		flush->read_result.done = false;
 		/* delay read transaction to ensure the FTDI chip can support us with data
 		   immediately after processing the MPSSE commands in the write transaction */
 	}
-
-	struct transfer_result write_result = { .ctx = ctx, .done = false };
-	struct libusb_transfer *write_transfer = libusb_alloc_transfer(0);
-	libusb_fill_bulk_transfer(write_transfer, ctx->usb_dev, ctx->out_ep, ctx->write_buffer,
-		ctx->write_count, write_cb, &write_result, ctx->usb_write_timeout);
-	retval = libusb_submit_transfer(write_transfer);
-	if (retval != LIBUSB_SUCCESS)
-		goto error_check;
+	flush->pending = true;
+
+	flush->write_result.ctx = ctx;
+	flush->write_transfer = libusb_alloc_transfer(0);
+	libusb_fill_bulk_transfer(flush->write_transfer, ctx->usb_dev, ctx->out_ep, ctx->write_buffer,
+		ctx->write_count, write_cb, &flush->write_result, ctx->usb_write_timeout);
+	flush->usb_retval = libusb_submit_transfer(flush->write_transfer);
+	if (flush->usb_retval != LIBUSB_SUCCESS) {
+		flush->write_result.done = true;
+		flush->read_result.done = true;
+		return ERROR_OK;
+	}
 
 	if (ctx->read_count) {
-		read_transfer = libusb_alloc_transfer(0);
-		libusb_fill_bulk_transfer(read_transfer, ctx->usb_dev, ctx->in_ep, ctx->read_chunk,
-			ctx->read_chunk_size, read_cb, &read_result,
-			ctx->usb_read_timeout);
-		retval = libusb_submit_transfer(read_transfer);
-		if (retval != LIBUSB_SUCCESS)
-			goto error_check;
+		/* Spread the expected response, two status bytes in each USB packet,
+		 * over several transfers so that the next one is already queued when
+		 * the previous one completes. The chunk follows the packet size, so
+		 * it adapts to full speed and high speed chips. */
+		unsigned int packet_size = ctx->max_packet_size;
+		unsigned int raw_size = DIV_ROUND_UP(ctx->read_count, packet_size - 2) * packet_size;
+		unsigned int chunk_size = DIV_ROUND_UP(raw_size, MPSSE_READ_TRANSFERS);
+		chunk_size = DIV_ROUND_UP(chunk_size, packet_size) * packet_size;
+		chunk_size = MIN(chunk_size, ctx->read_chunk_size);
+		flush->read_transfers = MIN(MPSSE_READ_TRANSFERS, DIV_ROUND_UP(raw_size, chunk_size));
+
+		for (unsigned int i = 0; i < flush->read_transfers; i++) {
+			flush->read_transfer[i] = libusb_alloc_transfer(0);
+			libusb_fill_bulk_transfer(flush->read_transfer[i], ctx->usb_dev, ctx->in_ep,
+				ctx->read_chunk + ctx->read_chunk_size * i,
+				chunk_size, read_cb, &flush->read_result,
+				ctx->usb_read_timeout);
+			flush->usb_retval = libusb_submit_transfer(flush->read_transfer[i]);
+			if (flush->usb_retval != LIBUSB_SUCCESS)
+				break;
+			flush->read_result.in_flight++;
+		}
+		if (flush->read_result.in_flight) {
+			/* carry on with the transfers already submitted */
+			flush->usb_retval = LIBUSB_SUCCESS;
+		} else {
+			/* the write is in flight, wait for it before giving up */
+			flush->read_result.done = true;
+		}
 	}
 
+	return ERROR_OK;
+}
+
+int mpsse_flush_complete(struct mpsse_ctx *ctx)
+{
+	struct mpsse_flush_state *flush = &ctx->flush;
+	struct transfer_result *write_result = &flush->write_result;
+	struct transfer_result *read_result = &flush->read_result;
+	bool read_cancelled = false;
+	int retval = flush->usb_retval;
+
+	if (!flush->pending)
+		return ERROR_OK;
+
 	/* Polling loop, more or less taken from libftdi */
 	int64_t start = timeval_ms();
 	int64_t warn_after = 2000;
-	while (!write_result.done || !read_result.done) {
+	while (!write_result->done || !read_result->done || read_result->in_flight) {
+		/* all data is in, reclaim the transfers still queued */
+		if (read_result->done && read_result->in_flight && !read_cancelled) {
+			for (unsigned int i = 0; i < flush->read_transfers; i++)
+				libusb_cancel_transfer(flush->read_transfer[i]);
+			read_cancelled = true;
+		}
+
 		struct timeval timeout_usb;
 
 		timeout_usb.tv_sec = 1;
 		timeout_usb.tv_usec = 0;
 
-		retval = libusb_handle_events_timeout_completed(ctx->usb_ctx, &timeout_usb, NULL);
+		int usb_retval = libusb_handle_events_timeout_completed(ctx->usb_ctx, &timeout_usb, NULL);
 		keep_alive();
 
 		int64_t now = timeval_ms();
@@ -911,28 +1025,28 @@ int mpsse_flush(struct mpsse_ctx *ctx)
 			warn_after *= 2;
 		}
 
-		if (retval == LIBUSB_ERROR_INTERRUPTED)
+		if (usb_retval == LIBUSB_ERROR_INTERRUPTED)
 			continue;
 
-		if (retval != LIBUSB_SUCCESS) {
-			libusb_cancel_transfer(write_transfer);
-			if (read_transfer)
-				libusb_cancel_transfer(read_transfer);
+		if (usb_retval != LIBUSB_SUCCESS) {
+			retval = usb_retval;
+			libusb_cancel_transfer(flush->write_transfer);
+			for (unsigned int i = 0; i < flush->read_transfers; i++)
+				libusb_cancel_transfer(flush->read_transfer[i]);
 		}
 	}
 
-error_check:
 	if (retval != LIBUSB_SUCCESS) {
 		LOG_ERROR("libusb_handle_events() failed with %s", libusb_error_name(retval));
 		retval = ERROR_FAIL;
-	} else if (write_result.transferred < ctx->write_count) {
+	} else if (write_result->transferred < ctx->write_count) {
 		LOG_ERROR("ftdi device did not accept all data: %d, tried %d",
-			write_result.transferred,
+			write_result->transferred,
 			ctx->write_count);
 		retval = ERROR_FAIL;
-	} else if (read_result.transferred < ctx->read_count) {
+	} else if (read_result->transferred < ctx->read_count) {
 		LOG_ERROR("ftdi device did not return all data: %d, expected %d",
-			read_result.transferred,
+			read_result->transferred,
 			ctx->read_count);
 		retval = ERROR_FAIL;
 	} else if (ctx->read_count) {
@@ -949,9 +1063,19 @@ error_check:
 	if (retval != ERROR_OK)
 		mpsse_purge(ctx);
 
-	libusb_free_transfer(write_transfer);
-	if (read_transfer)
-		libusb_free_transfer(read_transfer);
+	libusb_free_transfer(flush->write_transfer);
+	for (unsigned int i = 0; i < flush->read_transfers; i++)
+		libusb_free_transfer(flush->read_transfer[i]);
+	flush->pending = false;
 
 	return retval;
 }
+
+int mpsse_flush(struct mpsse_ctx *ctx)
+{
+	int retval = mpsse_flush_submit(ctx);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return mpsse_flush_complete(ctx);
+}
@@ -66,5 +66,9 @@ int mpsse_set_frequency(struct mpsse_ctx *ctx, int frequency);
 
 /* Queue handling */
 int mpsse_flush(struct mpsse_ctx *ctx);
+/* mpsse_flush() in two steps: start the USB transfers and return, then wait
+ * for them. Queuing more commands waits for the submitted flush first. */
+int mpsse_flush_submit(struct mpsse_ctx *ctx);
+int mpsse_flush_complete(struct mpsse_ctx *ctx);
 
 #endif /* OPENOCD_JTAG_DRIVERS_MPSSE_H */
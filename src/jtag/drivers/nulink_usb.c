@@ -477,6 +477,78 @@ static int nulink_usb_write_reg(void *handle, unsigned int regsel, uint32_t val)
 	return nulink_usb_xfer(handle, h->databuf, 4 * 2);
 }
 
+/* register entries per CMD_WRITE_REG, as for the word memory accesses */
+#define NULINK_REGS_PER_CMD 3
+
+static int nulink_usb_regs_list(void *handle, const unsigned int *regsel,
+		uint32_t *read_val, const uint32_t *write_val, unsigned int count)
+{
+	struct nulink_usb_handle *h = handle;
+
+	assert(handle);
+
+	while (count) {
+		unsigned int n = MIN(count, NULINK_REGS_PER_CMD);
+
+		nulink_usb_init_buffer(handle, 8 + 12 * n);
+		/* set command ID */
+		h_u32_to_le(h->cmdbuf + h->cmdidx, CMD_WRITE_REG);
+		h->cmdidx += 4;
+		/* Count of registers */
+		h->cmdbuf[h->cmdidx] = n;
+		h->cmdidx += 1;
+		/* Array of bool value (u8ReadOld) */
+		h->cmdbuf[h->cmdidx] = read_val ? 0xFF : 0x00;
+		h->cmdidx += 1;
+		/* Array of bool value (u8Verify) */
+		h->cmdbuf[h->cmdidx] = 0x00;
+		h->cmdidx += 1;
+		/* ignore */
+		h->cmdbuf[h->cmdidx] = 0;
+		h->cmdidx += 1;
+
+		for (unsigned int i = 0; i < n; i++) {
+			/* u32Addr */
+			h_u32_to_le(h->cmdbuf + h->cmdidx, regsel[i]);
+			h->cmdidx += 4;
+			/* u32Data */
+			h_u32_to_le(h->cmdbuf + h->cmdidx, read_val ? 0 : write_val[i]);
+			h->cmdidx += 4;
+			/* u32Mask */
+			h_u32_to_le(h->cmdbuf + h->cmdidx, read_val ? 0xFFFFFFFFUL : 0x00000000UL);
+			h->cmdidx += 4;
+		}
+
+		int res = nulink_usb_xfer(handle, h->databuf, 4 * n * 2);
+		if (res != ERROR_OK)
+			return res;
+
+		if (read_val) {
+			for (unsigned int i = 0; i < n; i++)
+				read_val[i] = le_to_h_u32(h->databuf + 4 * (2 * i + 1));
+			read_val += n;
+		} else {
+			write_val += n;
+		}
+		regsel += n;
+		count -= n;
+	}
+
+	return ERROR_OK;
+}
+
+static int nulink_usb_read_regs_list(void *handle, const unsigned int *regsel,
+		uint32_t *val, unsigned int count)
+{
+	return nulink_usb_regs_list(handle, regsel, val, NULL, count);
+}
+
+static int nulink_usb_write_regs_list(void *handle, const unsigned int *regsel,
+		const uint32_t *val, unsigned int count)
+{
+	return nulink_usb_regs_list(handle, regsel, NULL, val, count);
+}
+
 static int nulink_usb_read_mem8(void *handle, uint32_t addr, uint16_t len,
 		uint8_t *buffer)
 {
@@ -1166,6 +1238,8 @@ struct hl_layout_api nulink_usb_layout_api = {
 	.step = nulink_usb_step,
 	.read_reg = nulink_usb_read_reg,
 	.write_reg = nulink_usb_write_reg,
+	.read_regs_list = nulink_usb_read_regs_list,
+	.write_regs_list = nulink_usb_write_regs_list,
 	.read_mem = nulink_usb_read_mem,
 	.write_mem = nulink_usb_write_mem,
 	.write_debug_reg = nulink_usb_write_debug_reg,
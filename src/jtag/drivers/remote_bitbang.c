@@ -32,6 +32,11 @@ static uint8_t remote_bitbang_send_buf[512];
 static unsigned int remote_bitbang_send_buf_used;
 
 static bool use_remote_sleep;
+static bool use_shift_commands;
+
+/* Bits clocked by one shift request, so that its TDO response fits in the
+ * receive buffer and the request in the send buffer */
+#define REMOTE_BITBANG_SHIFT_MAX_BITS 1024
 
 /* Circular buffer. When start == end, the buffer is empty. */
 static char remote_bitbang_recv_buf[256];
@@ -211,6 +216,60 @@ static enum bb_value remote_bitbang_read_sample(void)
 	return char_to_int(c);
 }
 
+/* Blocking read of @a size bytes of binary response */
+static int remote_bitbang_read_bytes(uint8_t *dst, unsigned int size)
+{
+	while (size) {
+		if (remote_bitbang_recv_buf_empty()) {
+			if (remote_bitbang_fill_buf(BLOCK) != ERROR_OK)
+				return ERROR_FAIL;
+		}
+		*dst++ = remote_bitbang_recv_buf[remote_bitbang_recv_buf_start];
+		remote_bitbang_recv_buf_start =
+			(remote_bitbang_recv_buf_start + 1) % sizeof(remote_bitbang_recv_buf);
+		size--;
+	}
+	return ERROR_OK;
+}
+
+static int remote_bitbang_shift(unsigned int num_bits, const uint8_t *tms,
+		const uint8_t *tdi, uint8_t *tdo)
+{
+	uint8_t tdo_chunk[REMOTE_BITBANG_SHIFT_MAX_BITS / 8];
+
+	for (unsigned int offset = 0; offset < num_bits; offset += REMOTE_BITBANG_SHIFT_MAX_BITS) {
+		unsigned int len = MIN(num_bits - offset, REMOTE_BITBANG_SHIFT_MAX_BITS);
+		unsigned int bytes = DIV_ROUND_UP(len, 8);
+		unsigned int frame_size = 3 + 2 * bytes;
+
+		if (remote_bitbang_send_buf_used + frame_size > sizeof(remote_bitbang_send_buf)) {
+			if (remote_bitbang_flush() != ERROR_OK)
+				return ERROR_FAIL;
+		}
+
+		/* 'X' or 'Y', bit count (16 bits LE), TMS vector, TDI vector */
+		uint8_t *frame = remote_bitbang_send_buf + remote_bitbang_send_buf_used;
+		frame[0] = tdo ? 'Y' : 'X';
+		h_u16_to_le(&frame[1], len);
+		memset(&frame[3], 0, 2 * bytes);
+		if (tms)
+			buf_set_buf(tms, offset, &frame[3], 0, len);
+		if (tdi)
+			buf_set_buf(tdi, offset, &frame[3 + bytes], 0, len);
+		remote_bitbang_send_buf_used += frame_size;
+
+		if (tdo) {
+			if (remote_bitbang_flush() != ERROR_OK)
+				return ERROR_FAIL;
+			if (remote_bitbang_read_bytes(tdo_chunk, bytes) != ERROR_OK)
+				return ERROR_FAIL;
+			buf_set_buf(tdo_chunk, 0, tdo, offset, len);
+		}
+	}
+
+	return ERROR_OK;
+}
+
 static int remote_bitbang_write(int tck, int tms, int tdi)
 {
 	char c = '0' + ((tck ? 0x4 : 0x0) | (tms ? 0x2 : 0x0) | (tdi ? 0x1 : 0x0));
@@ -278,7 +337,7 @@ static int remote_bitbang_swd_write(int swclk, int swdio)
 	return remote_bitbang_queue(c, NO_FLUSH);
 }
 
-static const struct bitbang_interface remote_bitbang_bitbang = {
+static struct bitbang_interface remote_bitbang_bitbang = {
 	.buf_size = sizeof(remote_bitbang_recv_buf) - 1,
 	.sample = &remote_bitbang_sample,
 	.read_sample = &remote_bitbang_read_sample,
@@ -370,6 +429,8 @@ static int remote_bitbang_init_unix(void)
 
 static int remote_bitbang_init(void)
 {
+	if (use_shift_commands)
+		remote_bitbang_bitbang.shift = &remote_bitbang_shift;
 	bitbang_interface = &remote_bitbang_bitbang;
 
 	remote_bitbang_recv_buf_start = 0;
@@ -424,6 +485,16 @@ COMMAND_HANDLER(remote_bitbang_handle_remote_bitbang_use_remote_sleep_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(remote_bitbang_handle_remote_bitbang_use_shift_commands_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_ON_OFF(CMD_ARGV[0], use_shift_commands);
+
+	return ERROR_OK;
+}
+
 static const struct command_registration remote_bitbang_subcommand_handlers[] = {
 	{
 		.name = "port",
@@ -449,6 +520,14 @@ static const struct command_registration remote_bitbang_subcommand_handlers[] =
 			"instruction stream for the remote host.",
 		.usage = "(on|off)",
 	},
+	{
+		.name = "use_shift_commands",
+		.handler = remote_bitbang_handle_remote_bitbang_use_shift_commands_command,
+		.mode = COMMAND_CONFIG,
+		.help = "Send JTAG scans as packed TMS/TDI vectors and receive "
+			"packed TDO, rather than one request per clock edge.",
+		.usage = "(on|off)",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -178,6 +178,12 @@ struct stlink_backend {
 	int (*close)(void *handle);
 	/** */
 	int (*xfer_noerrcheck)(void *handle, const uint8_t *buf, int size);
+	/**
+	 * Optional: same as xfer_noerrcheck() followed by the last R/W status
+	 * query, issued together to save a round trip per memory access.
+	 */
+	int (*xfer_rw_status)(void *handle, const uint8_t *buf, int size,
+			uint8_t *status, int status_size);
 	/** */
 	int (*read_trace)(void *handle, const uint8_t *buf, int size);
 };
@@ -797,6 +803,57 @@ static int stlink_usb_xfer_rw(void *handle, int cmdsize, const uint8_t *buf, int
 			n_transfers,
 			STLINK_WRITE_TIMEOUT);
 }
+
+/*
+ * Submit the memory access in cmdbuf, its data phase, the status query and
+ * the read of the status at once: the adapter executes the commands in
+ * order, so the status query waits on the bus instead of in the host.
+ */
+static int stlink_usb_usb_xfer_rw_status(void *handle, const uint8_t *buf, int size,
+		uint8_t *status, int status_size)
+{
+	struct stlink_usb_handle *h = handle;
+
+	assert(handle);
+
+	uint8_t status_cmd[STLINK_CMD_SIZE_V2] = {
+		STLINK_DEBUG_COMMAND,
+		(status_size == 12) ? STLINK_DEBUG_APIV2_GETLASTRWSTATUS2 : STLINK_DEBUG_APIV2_GETLASTRWSTATUS,
+	};
+
+	size_t n_transfers = 0;
+	struct jtag_xfer transfers[4];
+
+	memset(transfers, 0, sizeof(transfers));
+
+	transfers[n_transfers].ep = h->tx_ep;
+	transfers[n_transfers].buf = h->cmdbuf;
+	transfers[n_transfers].size = STLINK_CMD_SIZE_V2;
+	++n_transfers;
+
+	if (size) {
+		transfers[n_transfers].ep = (h->direction == h->tx_ep) ? h->tx_ep : h->rx_ep;
+		transfers[n_transfers].buf = (uint8_t *)buf;
+		transfers[n_transfers].size = size;
+		++n_transfers;
+	}
+
+	transfers[n_transfers].ep = h->tx_ep;
+	transfers[n_transfers].buf = status_cmd;
+	transfers[n_transfers].size = STLINK_CMD_SIZE_V2;
+	++n_transfers;
+
+	transfers[n_transfers].ep = h->rx_ep;
+	transfers[n_transfers].buf = status;
+	transfers[n_transfers].size = status_size;
+	++n_transfers;
+
+	return jtag_libusb_bulk_transfer_n(
+			h->usb_backend_priv.fd,
+			transfers,
+			n_transfers,
+			STLINK_WRITE_TIMEOUT);
+}
 #else
 static int stlink_usb_xfer_rw(void *handle, int cmdsize, const uint8_t *buf, int size)
 {
@@ -913,6 +970,22 @@ static int stlink_usb_usb_xfer_noerrcheck(void *handle, const uint8_t *buf, int
 }
 
 
+static int stlink_tcp_check_status(const uint8_t *recv_buf)
+{
+	uint32_t tcp_ss = le_to_h_u32(recv_buf);
+	if (tcp_ss != STLINK_TCP_SS_OK) {
+		if (tcp_ss == STLINK_TCP_SS_TCP_BUSY) {
+			LOG_DEBUG("TCP busy");
+			return ERROR_WAIT;
+		}
+
+		LOG_ERROR("TCP error status 0x%X", tcp_ss);
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
 static int stlink_tcp_send_cmd(void *handle, int send_size, int recv_size, bool check_tcp_status)
 {
 	struct stlink_usb_handle *h = handle;
@@ -961,32 +1034,24 @@ static int stlink_tcp_send_cmd(void *handle, int send_size, int recv_size, bool
 		return retval;
 	}
 
-	if (check_tcp_status) {
-		uint32_t tcp_ss = le_to_h_u32(h->tcp_backend_priv.recv_buf);
-		if (tcp_ss != STLINK_TCP_SS_OK) {
-			if (tcp_ss == STLINK_TCP_SS_TCP_BUSY) {
-				LOG_DEBUG("TCP busy");
-				return ERROR_WAIT;
-			}
-
-			LOG_ERROR("TCP error status 0x%X", tcp_ss);
-			return ERROR_FAIL;
-		}
-	}
+	if (check_tcp_status)
+		return stlink_tcp_check_status(h->tcp_backend_priv.recv_buf);
 
 	return ERROR_OK;
 }
 
-/** */
-static int stlink_tcp_xfer_noerrcheck(void *handle, const uint8_t *buf, int size)
+/*
+ * Frame the command in cmdbuf and its data phase as a STLINK_TCP_CMD_SEND_USB_CMD
+ * request, and compute the sizes of the request and of its response.
+ */
+static int stlink_tcp_frame_usb_cmd(void *handle, const uint8_t *buf, int size,
+		int *send_size_out, int *recv_size_out)
 {
 	struct stlink_usb_handle *h = handle;
 
 	int send_size = STLINK_TCP_USB_CMD_SIZE;
 	int recv_size = STLINK_TCP_SS_SIZE;
 
-	assert(handle);
-
 	/* prepare the TCP command */
 	h->tcp_backend_priv.send_buf[0] = STLINK_TCP_CMD_SEND_USB_CMD;
 	memset(&h->tcp_backend_priv.send_buf[1], 0, 3); /* reserved for alignment and future use, must be zero */
@@ -1022,7 +1087,23 @@ static int stlink_tcp_xfer_noerrcheck(void *handle, const uint8_t *buf, int size
 		}
 	}
 
-	int ret = stlink_tcp_send_cmd(h, send_size, recv_size, true);
+	*send_size_out = send_size;
+	*recv_size_out = recv_size;
+	return ERROR_OK;
+}
+
+static int stlink_tcp_xfer_noerrcheck(void *handle, const uint8_t *buf, int size)
+{
+	struct stlink_usb_handle *h = handle;
+	int send_size, recv_size;
+
+	assert(handle);
+
+	int ret = stlink_tcp_frame_usb_cmd(handle, buf, size, &send_size, &recv_size);
+	if (ret != ERROR_OK)
+		return ret;
+
+	ret = stlink_tcp_send_cmd(h, send_size, recv_size, true);
 	if (ret != ERROR_OK)
 		return ret;
 
@@ -1037,6 +1118,60 @@ static int stlink_tcp_xfer_noerrcheck(void *handle, const uint8_t *buf, int size
 	return ERROR_OK;
 }
 
+/*
+ * Send the memory access in cmdbuf and the last R/W status query in a single
+ * burst, and collect both responses, instead of a round trip each.
+ */
+static int stlink_tcp_xfer_rw_status(void *handle, const uint8_t *buf, int size,
+		uint8_t *status, int status_size)
+{
+	struct stlink_usb_handle *h = handle;
+	int send_size, recv_size;
+
+	assert(handle);
+
+	int ret = stlink_tcp_frame_usb_cmd(handle, buf, size, &send_size, &recv_size);
+	if (ret != ERROR_OK)
+		return ret;
+
+	int status_offset = recv_size;
+	if (send_size + STLINK_TCP_USB_CMD_SIZE > STLINK_TCP_SEND_BUFFER_SIZE ||
+			recv_size + STLINK_TCP_SS_SIZE + status_size > STLINK_TCP_RECV_BUFFER_SIZE) {
+		LOG_ERROR("STLINK_TCP command buffer overflow");
+		return ERROR_FAIL;
+	}
+
+	/* append the status query to the same burst */
+	uint8_t *frame = &h->tcp_backend_priv.send_buf[send_size];
+	frame[0] = STLINK_TCP_CMD_SEND_USB_CMD;
+	memset(&frame[1], 0, 3); /* reserved for alignment and future use, must be zero */
+	h_u32_to_le(&frame[4], h->tcp_backend_priv.connect_id);
+	memset(&frame[8], 0, STLINK_CMD_SIZE_V2);
+	frame[8] = STLINK_DEBUG_COMMAND;
+	frame[9] = (status_size == 12) ? STLINK_DEBUG_APIV2_GETLASTRWSTATUS2 : STLINK_DEBUG_APIV2_GETLASTRWSTATUS;
+	frame[24] = h->rx_ep;
+	memset(&frame[25], 0, 3); /* reserved for alignment and future use, must be zero */
+	h_u32_to_le(&frame[28], status_size);
+
+	send_size += STLINK_TCP_USB_CMD_SIZE;
+	recv_size += STLINK_TCP_SS_SIZE + status_size;
+
+	ret = stlink_tcp_send_cmd(h, send_size, recv_size, true);
+	if (ret != ERROR_OK)
+		return ret;
+
+	ret = stlink_tcp_check_status(&h->tcp_backend_priv.recv_buf[status_offset]);
+	if (ret != ERROR_OK)
+		return ret;
+
+	if (h->direction != h->tx_ep && buf != &h->tcp_backend_priv.recv_buf[4])
+		memcpy((uint8_t *)buf, &h->tcp_backend_priv.recv_buf[4], size);
+
+	memcpy(status, &h->tcp_backend_priv.recv_buf[status_offset + STLINK_TCP_SS_SIZE], status_size);
+
+	return ERROR_OK;
+}
+
 /** */
 static int stlink_tcp_read_trace(void *handle, const uint8_t *buf, int size)
 {
@@ -2463,6 +2598,53 @@ static int stlink_usb_write_reg(void *handle, unsigned int regsel, uint32_t val)
 	return stlink_cmd_allow_retry(handle, h->databuf, 2);
 }
 
+/*
+ * READALLREGS returns R0-R15, xPSR, MSP and PSP in regsel order, followed
+ * by two words which are not registers.
+ */
+#define STLINK_READALLREGS_LAST_REGSEL	0x12
+
+/** */
+static int stlink_usb_read_regs_list(void *handle, const unsigned int *regsel,
+		uint32_t *val, unsigned int count)
+{
+	struct stlink_usb_handle *h = handle;
+	unsigned int in_allregs = 0;
+	int res;
+
+	assert(handle);
+
+	for (unsigned int i = 0; i < count; i++)
+		if (regsel[i] <= STLINK_READALLREGS_LAST_REGSEL)
+			in_allregs++;
+
+	/* a single register is cheaper with READREG */
+	if (in_allregs > 1) {
+		res = stlink_usb_read_regs(handle);
+		if (res != ERROR_OK)
+			return res;
+
+		const uint8_t *regs = h->databuf;
+		if (h->version.jtag_api != STLINK_JTAG_API_V1)
+			regs += 4;
+
+		for (unsigned int i = 0; i < count; i++)
+			if (regsel[i] <= STLINK_READALLREGS_LAST_REGSEL)
+				val[i] = le_to_h_u32(regs + 4 * regsel[i]);
+	}
+
+	for (unsigned int i = 0; i < count; i++) {
+		if (in_allregs > 1 && regsel[i] <= STLINK_READALLREGS_LAST_REGSEL)
+			continue;
+
+		res = stlink_usb_read_reg(handle, regsel[i], &val[i]);
+		if (res != ERROR_OK)
+			return res;
+	}
+
+	return ERROR_OK;
+}
+
 static int stlink_usb_get_rw_status(void *handle)
 {
 	struct stlink_usb_handle *h = handle;
@@ -2484,11 +2666,45 @@ static int stlink_usb_get_rw_status(void *handle)
 	}
 }
 
+/*
+ * Issue the memory access in cmdbuf and check its status. For reads, the
+ * @a read_len bytes received in databuf are copied to @a read_buffer.
+ */
+static int stlink_usb_xfer_mem(void *handle, const uint8_t *buf, int size,
+		uint8_t *read_buffer, int read_len)
+{
+	struct stlink_usb_handle *h = handle;
+	uint8_t status[12];
+	int status_size = 0;
+
+	assert(handle);
+
+	if (h->backend->xfer_rw_status && h->version.stlink != 1 &&
+			h->version.jtag_api != STLINK_JTAG_API_V1)
+		status_size = (h->version.flags & STLINK_F_HAS_GETLASTRWSTATUS2) ? 12 : 2;
+
+	int res;
+	if (status_size)
+		res = h->backend->xfer_rw_status(handle, buf, size, status, status_size);
+	else
+		res = stlink_usb_xfer_noerrcheck(handle, buf, size);
+	if (res != ERROR_OK)
+		return res;
+
+	if (read_buffer)
+		memcpy(read_buffer, h->databuf, read_len);
+
+	if (!status_size)
+		return stlink_usb_get_rw_status(handle);
+
+	memcpy(h->databuf, status, status_size);
+	return stlink_usb_error_check(handle);
+}
+
 /** */
 static int stlink_usb_read_mem8(void *handle, uint8_t ap_num, uint32_t csw,
 		uint32_t addr, uint16_t len, uint8_t *buffer)
 {
-	int res;
 	uint16_t read_len = len;
 	struct stlink_usb_handle *h = handle;
 
@@ -2519,21 +2735,13 @@ static int stlink_usb_read_mem8(void *handle, uint8_t ap_num, uint32_t csw,
 	if (read_len == 1)
 		read_len++;
 
-	res = stlink_usb_xfer_noerrcheck(handle, h->databuf, read_len);
-
-	if (res != ERROR_OK)
-		return res;
-
-	memcpy(buffer, h->databuf, len);
-
-	return stlink_usb_get_rw_status(handle);
+	return stlink_usb_xfer_mem(handle, h->databuf, read_len, buffer, len);
 }
 
 /** */
 static int stlink_usb_write_mem8(void *handle, uint8_t ap_num, uint32_t csw,
 		uint32_t addr, uint16_t len, const uint8_t *buffer)
 {
-	int res;
 	struct stlink_usb_handle *h = handle;
 
 	assert(handle);
@@ -2559,19 +2767,13 @@ static int stlink_usb_write_mem8(void *handle, uint8_t ap_num, uint32_t csw,
 	h_u24_to_le(h->cmdbuf + h->cmdidx, csw >> 8);
 	h->cmdidx += 3;
 
-	res = stlink_usb_xfer_noerrcheck(handle, buffer, len);
-
-	if (res != ERROR_OK)
-		return res;
-
-	return stlink_usb_get_rw_status(handle);
+	return stlink_usb_xfer_mem(handle, buffer, len, NULL, 0);
 }
 
 /** */
 static int stlink_usb_read_mem16(void *handle, uint8_t ap_num, uint32_t csw,
 		uint32_t addr, uint16_t len, uint8_t *buffer)
 {
-	int res;
 	struct stlink_usb_handle *h = handle;
 
 	assert(handle);
@@ -2605,21 +2807,13 @@ static int stlink_usb_read_mem16(void *handle, uint8_t ap_num, uint32_t csw,
 	h_u24_to_le(h->cmdbuf + h->cmdidx, csw >> 8);
 	h->cmdidx += 3;
 
-	res = stlink_usb_xfer_noerrcheck(handle, h->databuf, len);
-
-	if (res != ERROR_OK)
-		return res;
-
-	memcpy(buffer, h->databuf, len);
-
-	return stlink_usb_get_rw_status(handle);
+	return stlink_usb_xfer_mem(handle, h->databuf, len, buffer, len);
 }
 
 /** */
 static int stlink_usb_write_mem16(void *handle, uint8_t ap_num, uint32_t csw,
 		uint32_t addr, uint16_t len, const uint8_t *buffer)
 {
-	int res;
 	struct stlink_usb_handle *h = handle;
 
 	assert(handle);
@@ -2653,19 +2847,13 @@ static int stlink_usb_write_mem16(void *handle, uint8_t ap_num, uint32_t csw,
 	h_u24_to_le(h->cmdbuf + h->cmdidx, csw >> 8);
 	h->cmdidx += 3;
 
-	res = stlink_usb_xfer_noerrcheck(handle, buffer, len);
-
-	if (res != ERROR_OK)
-		return res;
-
-	return stlink_usb_get_rw_status(handle);
+	return stlink_usb_xfer_mem(handle, buffer, len, NULL, 0);
 }
 
 /** */
 static int stlink_usb_read_mem32(void *handle, uint8_t ap_num, uint32_t csw,
 		uint32_t addr, uint16_t len, uint8_t *buffer)
 {
-	int res;
 	struct stlink_usb_handle *h = handle;
 
 	assert(handle);
@@ -2696,21 +2884,13 @@ static int stlink_usb_read_mem32(void *handle, uint8_t ap_num, uint32_t csw,
 	h_u24_to_le(h->cmdbuf + h->cmdidx, csw >> 8);
 	h->cmdidx += 3;
 
-	res = stlink_usb_xfer_noerrcheck(handle, h->databuf, len);
-
-	if (res != ERROR_OK)
-		return res;
-
-	memcpy(buffer, h->databuf, len);
-
-	return stlink_usb_get_rw_status(handle);
+	return stlink_usb_xfer_mem(handle, h->databuf, len, buffer, len);
 }
 
 /** */
 static int stlink_usb_write_mem32(void *handle, uint8_t ap_num, uint32_t csw,
 		uint32_t addr, uint16_t len, const uint8_t *buffer)
 {
-	int res;
 	struct stlink_usb_handle *h = handle;
 
 	assert(handle);
@@ -2741,12 +2921,7 @@ static int stlink_usb_write_mem32(void *handle, uint8_t ap_num, uint32_t csw,
 	h_u24_to_le(h->cmdbuf + h->cmdidx, csw >> 8);
 	h->cmdidx += 3;
 
-	res = stlink_usb_xfer_noerrcheck(handle, buffer, len);
-
-	if (res != ERROR_OK)
-		return res;
-
-	return stlink_usb_get_rw_status(handle);
+	return stlink_usb_xfer_mem(handle, buffer, len, NULL, 0);
 }
 
 static int stlink_usb_read_mem32_noaddrinc(void *handle, uint8_t ap_num, uint32_t csw,
@@ -2782,13 +2957,7 @@ static int stlink_usb_read_mem32_noaddrinc(void *handle, uint8_t ap_num, uint32_
 	h_u24_to_le(h->cmdbuf + h->cmdidx, csw >> 8);
 	h->cmdidx += 3;
 
-	int retval = stlink_usb_xfer_noerrcheck(handle, h->databuf, len);
-	if (retval != ERROR_OK)
-		return retval;
-
-	memcpy(buffer, h->databuf, len);
-
-	return stlink_usb_get_rw_status(handle);
+	return stlink_usb_xfer_mem(handle, h->databuf, len, buffer, len);
 }
 
 static int stlink_usb_write_mem32_noaddrinc(void *handle, uint8_t ap_num, uint32_t csw,
@@ -2824,11 +2993,7 @@ static int stlink_usb_write_mem32_noaddrinc(void *handle, uint8_t ap_num, uint32
 	h_u24_to_le(h->cmdbuf + h->cmdidx, csw >> 8);
 	h->cmdidx += 3;
 
-	int retval = stlink_usb_xfer_noerrcheck(handle, buffer, len);
-	if (retval != ERROR_OK)
-		return retval;
-
-	return stlink_usb_get_rw_status(handle);
+	return stlink_usb_xfer_mem(handle, buffer, len, NULL, 0);
 }
 
 static uint32_t stlink_max_block_size(uint32_t tar_autoincr_block, uint32_t address)
@@ -3715,6 +3880,9 @@ static struct stlink_backend stlink_usb_backend = {
 	.open = stlink_usb_usb_open,
 	.close = stlink_usb_usb_close,
 	.xfer_noerrcheck = stlink_usb_usb_xfer_noerrcheck,
+#ifdef USE_LIBUSB_ASYNCIO
+	.xfer_rw_status = stlink_usb_usb_xfer_rw_status,
+#endif
 	.read_trace = stlink_usb_usb_read_trace,
 };
 
@@ -3722,6 +3890,7 @@ static struct stlink_backend stlink_tcp_backend = {
 	.open = stlink_tcp_open,
 	.close = stlink_tcp_close,
 	.xfer_noerrcheck = stlink_tcp_xfer_noerrcheck,
+	.xfer_rw_status = stlink_tcp_xfer_rw_status,
 	.read_trace = stlink_tcp_read_trace,
 };
 
@@ -4059,6 +4228,8 @@ struct hl_layout_api stlink_usb_layout_api = {
 	/** */
 	.write_reg = stlink_usb_write_reg,
 	/** */
+	.read_regs_list = stlink_usb_read_regs_list,
+	/** */
 	.read_mem = stlink_usb_read_mem,
 	/** */
 	.write_mem = stlink_usb_write_mem,
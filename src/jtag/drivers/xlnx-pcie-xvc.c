@@ -13,11 +13,13 @@
 #include <stdlib.h>
 #include <math.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <linux/pci.h>
 
 #include <jtag/interface.h>
 #include <jtag/swd.h>
 #include <jtag/commands.h>
+#include <helper/align.h>
 #include <helper/replacements.h>
 #include <helper/bits.h>
 
@@ -38,6 +40,16 @@
 #define XLNX_XVC_VSEC_ID	0x8
 #define XLNX_XVC_MAX_BITS	0x20
 
+/* register layout of the debug bridge when mapped through a BAR */
+#define XLNX_XVC_BAR_LEN_REG	0x00
+#define XLNX_XVC_BAR_TMS_REG	0x04
+#define XLNX_XVC_BAR_TDI_REG	0x08
+#define XLNX_XVC_BAR_TDO_REG	0x0C
+#define XLNX_XVC_BAR_CTRL_REG	0x10
+#define XLNX_XVC_BAR_REGS_SIZE	0x14
+#define XLNX_XVC_BAR_CTRL_START	BIT(0)
+#define XLNX_XVC_BAR_TIMEOUT	100000
+
 #define MASK_ACK(x) (((x) >> 9) & 0x7)
 #define MASK_PAR(x) ((int)((x) & 0x1))
 
@@ -45,9 +57,18 @@ struct xlnx_pcie_xvc {
 	int fd;
 	unsigned int offset;
 	char *device;
+	/* BAR holding the registers, or -1 to use the config space VSEC */
+	int bar;
+	off_t bar_offset;
+	void *map_base;
+	size_t map_size;
+	volatile uint32_t *regs;
 };
 
-static struct xlnx_pcie_xvc xlnx_pcie_xvc_state;
+static struct xlnx_pcie_xvc xlnx_pcie_xvc_state = {
+	.fd = -1,
+	.bar = -1,
+};
 static struct xlnx_pcie_xvc *xlnx_pcie_xvc = &xlnx_pcie_xvc_state;
 
 static int xlnx_pcie_xvc_read_reg(const int offset, uint32_t *val)
@@ -91,11 +112,60 @@ static int xlnx_pcie_xvc_write_reg(const int offset, const uint32_t val)
 	return ERROR_OK;
 }
 
+static inline void xlnx_pcie_xvc_mmio_write(const int offset, const uint32_t val)
+{
+	uint32_t le;
+
+	h_u32_to_le((uint8_t *)&le, val);
+	xlnx_pcie_xvc->regs[offset / 4] = le;
+}
+
+static inline uint32_t xlnx_pcie_xvc_mmio_read(const int offset)
+{
+	uint32_t le = xlnx_pcie_xvc->regs[offset / 4];
+
+	return le_to_h_u32((const uint8_t *)&le);
+}
+
+/* One shift through the mapped registers: no syscalls, and barriers
+ * only around the start bit so the FPGA sees LEN/TMS/TDI before it and
+ * TDO is read after completion */
+static int xlnx_pcie_xvc_mmio_transact(size_t num_bits, uint32_t tms, uint32_t tdi,
+				       uint32_t *tdo)
+{
+	xlnx_pcie_xvc_mmio_write(XLNX_XVC_BAR_LEN_REG, num_bits);
+	xlnx_pcie_xvc_mmio_write(XLNX_XVC_BAR_TMS_REG, tms);
+	xlnx_pcie_xvc_mmio_write(XLNX_XVC_BAR_TDI_REG, tdi);
+	__sync_synchronize();
+	xlnx_pcie_xvc_mmio_write(XLNX_XVC_BAR_CTRL_REG, XLNX_XVC_BAR_CTRL_START);
+
+	unsigned int timeout = XLNX_XVC_BAR_TIMEOUT;
+	while (xlnx_pcie_xvc_mmio_read(XLNX_XVC_BAR_CTRL_REG) & XLNX_XVC_BAR_CTRL_START) {
+		if (!--timeout) {
+			LOG_ERROR("Timeout waiting for shift of %zu bits", num_bits);
+			return ERROR_JTAG_DEVICE_ERROR;
+		}
+	}
+	__sync_synchronize();
+
+	if (tdo)
+		*tdo = xlnx_pcie_xvc_mmio_read(XLNX_XVC_BAR_TDO_REG);
+
+	return ERROR_OK;
+}
+
 static int xlnx_pcie_xvc_transact(size_t num_bits, uint32_t tms, uint32_t tdi,
 				  uint32_t *tdo)
 {
 	int err;
 
+	if (xlnx_pcie_xvc->regs) {
+		err = xlnx_pcie_xvc_mmio_transact(num_bits, tms, tdi, tdo);
+		if (err != ERROR_OK)
+			return err;
+		goto done;
+	}
+
 	err = xlnx_pcie_xvc_write_reg(XLNX_XVC_LEN_REG, num_bits);
 	if (err != ERROR_OK)
 		return err;
@@ -112,6 +182,7 @@ static int xlnx_pcie_xvc_transact(size_t num_bits, uint32_t tms, uint32_t tdi,
 	if (err != ERROR_OK)
 		return err;
 
+done:
 	if (tdo)
 		LOG_DEBUG_IO("Transact num_bits: %zu, tms: %" PRIx32 ", tdi: %" PRIx32 ", tdo: %" PRIx32,
 			     num_bits, tms, tdi, *tdo);
@@ -379,12 +450,53 @@ static int xlnx_pcie_xvc_execute_queue(struct jtag_command *cmd_queue)
 }
 
 
+static int xlnx_pcie_xvc_init_bar(void)
+{
+	char filename[PATH_MAX];
+	long page_size = sysconf(_SC_PAGESIZE);
+
+	snprintf(filename, PATH_MAX, "/sys/bus/pci/devices/%s/resource%d",
+		 xlnx_pcie_xvc->device, xlnx_pcie_xvc->bar);
+	xlnx_pcie_xvc->fd = open(filename, O_RDWR | O_SYNC);
+	if (xlnx_pcie_xvc->fd < 0) {
+		LOG_ERROR("Failed to open device: %s", filename);
+		return ERROR_JTAG_INIT_FAILED;
+	}
+
+	/* mmap() requires page aligned offsets */
+	off_t start = ALIGN_DOWN(xlnx_pcie_xvc->bar_offset, page_size);
+	off_t end = ALIGN_UP(xlnx_pcie_xvc->bar_offset + XLNX_XVC_BAR_REGS_SIZE, page_size);
+
+	xlnx_pcie_xvc->map_size = end - start;
+	xlnx_pcie_xvc->map_base = mmap(NULL, xlnx_pcie_xvc->map_size,
+				       PROT_READ | PROT_WRITE, MAP_SHARED,
+				       xlnx_pcie_xvc->fd, start);
+	if (xlnx_pcie_xvc->map_base == MAP_FAILED) {
+		LOG_ERROR("Mapping %s at offset 0x%jx failed", filename,
+			  (uintmax_t)start);
+		xlnx_pcie_xvc->map_base = NULL;
+		close(xlnx_pcie_xvc->fd);
+		return ERROR_JTAG_INIT_FAILED;
+	}
+
+	xlnx_pcie_xvc->regs = (volatile uint32_t *)((uint8_t *)xlnx_pcie_xvc->map_base +
+						     (xlnx_pcie_xvc->bar_offset - start));
+
+	LOG_INFO("Using Xilinx XVC/PCIe registers in BAR%d at offset: 0x%jx",
+		 xlnx_pcie_xvc->bar, (uintmax_t)xlnx_pcie_xvc->bar_offset);
+
+	return ERROR_OK;
+}
+
 static int xlnx_pcie_xvc_init(void)
 {
 	char filename[PATH_MAX];
 	uint32_t cap, vh;
 	int err;
 
+	if (xlnx_pcie_xvc->bar >= 0)
+		return xlnx_pcie_xvc_init_bar();
+
 	snprintf(filename, PATH_MAX, "/sys/bus/pci/devices/%s/config",
 		 xlnx_pcie_xvc->device);
 	xlnx_pcie_xvc->fd = open(filename, O_RDWR | O_SYNC);
@@ -438,6 +550,12 @@ static int xlnx_pcie_xvc_quit(void)
 {
 	int err;
 
+	if (xlnx_pcie_xvc->map_base &&
+	    munmap(xlnx_pcie_xvc->map_base, xlnx_pcie_xvc->map_size) == -1)
+		LOG_ERROR("Failed to unmap XVC registers");
+	xlnx_pcie_xvc->map_base = NULL;
+	xlnx_pcie_xvc->regs = NULL;
+
 	err = close(xlnx_pcie_xvc->fd);
 	if (err)
 		return err;
@@ -460,6 +578,27 @@ COMMAND_HANDLER(xlnx_pcie_xvc_handle_config_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(xlnx_pcie_xvc_handle_bar_command)
+{
+	unsigned int bar;
+	uint64_t offset = 0;
+
+	if (CMD_ARGC < 1 || CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], bar);
+	if (bar > 5) {
+		LOG_ERROR("BAR must be between 0 and 5");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+	if (CMD_ARGC == 2)
+		COMMAND_PARSE_NUMBER(u64, CMD_ARGV[1], offset);
+
+	xlnx_pcie_xvc->bar = bar;
+	xlnx_pcie_xvc->bar_offset = offset;
+	return ERROR_OK;
+}
+
 static const struct command_registration xlnx_pcie_xvc_subcommand_handlers[] = {
 	{
 		.name = "config",
@@ -468,6 +607,13 @@ static const struct command_registration xlnx_pcie_xvc_subcommand_handlers[] = {
 		.help = "Configure XVC/PCIe JTAG adapter",
 		.usage = "device",
 	},
+	{
+		.name = "bar",
+		.handler = xlnx_pcie_xvc_handle_bar_command,
+		.mode = COMMAND_CONFIG,
+		.help = "Access the XVC registers memory mapped through a BAR",
+		.usage = "bar_number [offset]",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -88,3 +88,37 @@ int hl_layout_init(struct hl_interface *adapter)
 	}
 	return ERROR_OK;
 }
+
+int hl_layout_read_regs(struct hl_interface *adapter, const unsigned int *regsel,
+		uint32_t *val, unsigned int count)
+{
+	const struct hl_layout_api *api = adapter->layout->api;
+
+	if (api->read_regs_list)
+		return api->read_regs_list(adapter->handle, regsel, val, count);
+
+	for (unsigned int i = 0; i < count; i++) {
+		int retval = api->read_reg(adapter->handle, regsel[i], &val[i]);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	return ERROR_OK;
+}
+
+int hl_layout_write_regs(struct hl_interface *adapter, const unsigned int *regsel,
+		const uint32_t *val, unsigned int count)
+{
+	const struct hl_layout_api *api = adapter->layout->api;
+
+	if (api->write_regs_list)
+		return api->write_regs_list(adapter->handle, regsel, val, count);
+
+	for (unsigned int i = 0; i < count; i++) {
+		int retval = api->write_reg(adapter->handle, regsel[i], val[i]);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	return ERROR_OK;
+}
@@ -60,6 +60,34 @@ struct hl_layout_api {
 	 * @returns ERROR_OK on success, or an error code on failure.
 	 */
 	int (*write_reg)(void *handle, unsigned int regsel, uint32_t val);
+	/**
+	 * Read several registers from the target
+	 *
+	 * Optional; without it hl_layout_read_regs() reads the registers
+	 * one at a time with read_reg.
+	 *
+	 * @param handle A pointer to the device-specific handle
+	 * @param regsel Array of register selection indexes, as for read_reg
+	 * @param val Array to retrieve the register values
+	 * @param count Number of registers
+	 * @returns ERROR_OK on success, or an error code on failure.
+	 */
+	int (*read_regs_list)(void *handle, const unsigned int *regsel,
+			uint32_t *val, unsigned int count);
+	/**
+	 * Write several registers to the target
+	 *
+	 * Optional; without it hl_layout_write_regs() writes the registers
+	 * one at a time with write_reg.
+	 *
+	 * @param handle A pointer to the device-specific handle
+	 * @param regsel Array of register selection indexes, as for write_reg
+	 * @param val Array of the values to be written
+	 * @param count Number of registers
+	 * @returns ERROR_OK on success, or an error code on failure.
+	 */
+	int (*write_regs_list)(void *handle, const unsigned int *regsel,
+			const uint32_t *val, unsigned int count);
 	/** */
 	int (*read_mem)(void *handle, uint32_t addr, uint32_t size,
 			uint32_t count, uint8_t *buffer);
@@ -132,5 +160,11 @@ struct hl_layout {
 const struct hl_layout *hl_layout_get_list(void);
 /** */
 int hl_layout_init(struct hl_interface *adapter);
+/** */
+int hl_layout_read_regs(struct hl_interface *adapter, const unsigned int *regsel,
+		uint32_t *val, unsigned int count);
+/** */
+int hl_layout_write_regs(struct hl_interface *adapter, const unsigned int *regsel,
+		const uint32_t *val, unsigned int count);
 
 #endif /* OPENOCD_JTAG_HLA_HLA_LAYOUT_H */
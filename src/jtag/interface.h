@@ -185,6 +185,8 @@ struct jtag_interface {
 	 */
 	unsigned int supported;
 #define DEBUG_CAP_TMS_SEQ	(1 << 0)
+/* submit_queue() and complete_queue() are implemented */
+#define DEBUG_CAP_ASYNC_QUEUE	(1 << 1)
 
 	/**
 	 * Execute commands in the supplied queue
@@ -193,6 +195,44 @@ struct jtag_interface {
 	 */
 
 	int (*execute_queue)(struct jtag_command *cmd_queue);
+
+	/**
+	 * Optional, with DEBUG_CAP_ASYNC_QUEUE: start the execution of the
+	 * supplied queue and return without waiting for the adapter. The
+	 * commands, and the buffers they point to, stay valid until
+	 * complete_queue() returns. At most one queue is submitted at a time,
+	 * the core builds the next one meanwhile. The ftdi driver implements
+	 * this with asynchronous libusb transfers, see mpsse_flush_submit().
+	 * @param cmd_queue - a linked list of commands to execute
+	 * @returns ERROR_OK on success, or an error code on failure.
+	 */
+	int (*submit_queue)(struct jtag_command *cmd_queue);
+
+	/**
+	 * Wait for the end of the queue started by submit_queue(), storing
+	 * the captured data in the in_value buffers of its scan fields.
+	 * @returns ERROR_OK on success, or an error code on failure.
+	 */
+	int (*complete_queue)(void);
+};
+
+/**
+ * A word of target memory the adapter firmware reads repeatedly on its own,
+ * reporting when some bits of it change, see adapter_config_watch().
+ * This saves the host the USB round trips of polling e.g. a status register
+ * while the target runs.
+ */
+struct adapter_watch {
+	/** MEM-AP used to read the word */
+	uint64_t ap_num;
+	/** word aligned address of the word */
+	target_addr_t address;
+	/** bits to watch */
+	uint32_t mask;
+	/** value of the watched bits when the watch starts */
+	uint32_t value;
+	/** set while the adapter watches the word */
+	bool active;
 };
 
 /**
@@ -338,6 +378,31 @@ struct adapter_driver {
 	 */
 	int (*poll_trace)(uint8_t *buf, size_t *size);
 
+	/**
+	 * Start or stop watching a word of target memory in the adapter
+	 * firmware. The firmware reads the word between the host requests and
+	 * must leave the DP SELECT and the AP CSW and TAR registers as the host
+	 * programmed them. Several words can be watched at the same time.
+	 *
+	 * @param enabled Whether to start or stop the watch
+	 * @param watch The word to watch; the driver sets watch->active
+	 * @returns ERROR_OK on success, an error code on failure.
+	 */
+	int (*config_watch)(bool enabled, struct adapter_watch *watch);
+
+	/**
+	 * Check whether the firmware reported a change of a watched word. This
+	 * must not access the target, only collect the notifications received.
+	 *
+	 * @param watch A watch started with config_watch
+	 * @param changed Set if the watched bits differ from watch->value
+	 * @param value The last value read by the firmware, when @a changed.
+	 * Sticky bits cleared by reading the word are reported there.
+	 * @returns ERROR_OK on success, an error code if the firmware stopped
+	 * watching the word, e.g. because of a fault reading it.
+	 */
+	int (*poll_watch)(struct adapter_watch *watch, bool *changed, uint32_t *value);
+
 	/** Low-level JTAG APIs */
 	struct jtag_interface *jtag_ops;
 
@@ -363,6 +428,8 @@ int adapter_config_trace(bool enabled, enum tpiu_pin_protocol pin_protocol,
 		uint32_t port_size, unsigned int *trace_freq,
 		unsigned int traceclkin_freq, uint16_t *prescaler);
 int adapter_poll_trace(uint8_t *buf, size_t *size);
+int adapter_config_watch(bool enabled, struct adapter_watch *watch);
+int adapter_poll_watch(struct adapter_watch *watch, bool *changed, uint32_t *value);
 
 extern struct adapter_driver am335xgpio_adapter_driver;
 extern struct adapter_driver amt_jtagaccel_adapter_driver;
@@ -250,6 +250,15 @@ void jtag_set_verify(bool enable);
 /** @returns True if data scan verification will be performed. */
 bool jtag_will_verify(void);
 
+/**
+ * Enable or disable deferred verification: the fields checked in a queue
+ * are compared in a single pass after its execution, and only the first
+ * mismatch is reported in detail.
+ */
+void jtag_set_verify_deferred(bool enable);
+/** @returns True if scan verification is deferred. */
+bool jtag_will_verify_deferred(void);
+
 /** Enable or disable verification of IR scan checking. */
 void jtag_set_verify_capture_ir(bool enable);
 /** @returns True if IR scan verification will be performed. */
@@ -521,9 +530,55 @@ int jtag_execute_queue(void);
 /** same as jtag_execute_queue() but does not clear the error flag */
 void jtag_execute_queue_noclear(void);
 
+/**
+ * Hand the queue over to the adapter without waiting for its execution,
+ * when the adapter supports it (DEBUG_CAP_ASYNC_QUEUE), so that the next
+ * queue is built while the previous one is shifted. Otherwise the queue
+ * is executed as by jtag_execute_queue_noclear().
+ *
+ * The buffers passed to the queued jtag_add_xxx() calls must stay valid,
+ * and captured data must not be used, until the next jtag_execute_queue().
+ * It waits for the submitted queue, runs its callbacks (e.g. the checks
+ * of jtag_add_dr_scan_check()) and reports any error, of the submitted
+ * queue or of its own. The error flag is not cleared.
+ */
+void jtag_submit_queue(void);
+
 /** @returns the number of times the scan queue has been flushed */
 unsigned int jtag_get_flush_queue_count(void);
 
+/** Number of buckets in the round trip histogram of struct jtag_stats */
+#define JTAG_STATS_ROUND_TRIP_BUCKETS	20
+
+/** Activity of the JTAG queue, see jtag_get_stats() */
+struct jtag_stats {
+	/** calls to jtag_execute_queue() and jtag_submit_queue() */
+	unsigned int flushes;
+	/** flushes with no command queued, e.g. only to collect errors */
+	unsigned int empty_flushes;
+	/** commands handed over to the adapter */
+	uint64_t commands;
+	/** IR and DR scans among @a commands */
+	uint64_t scans;
+	/** bits shifted by @a scans */
+	uint64_t scan_bits;
+	/** TCK cycles of the RUNTEST, STABLECLOCKS and TMS commands */
+	uint64_t clocks;
+	/** time spent waiting for the adapter, in microseconds */
+	uint64_t round_trip_total_us;
+	uint64_t round_trip_max_us;
+	/**
+	 * round_trips[0] counts the round trips shorter than 1 us,
+	 * round_trips[i] those lasting from 2^(i-1) us to 2^i us, and
+	 * the last bucket all the longer ones
+	 */
+	unsigned int round_trips[JTAG_STATS_ROUND_TRIP_BUCKETS];
+};
+
+/** Copy the statistics collected since the last jtag_reset_stats() */
+void jtag_get_stats(struct jtag_stats *stats);
+void jtag_reset_stats(void);
+
 /** Report Tcl event to all TAPs */
 void jtag_notify_event(enum jtag_event);
 
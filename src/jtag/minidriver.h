@@ -30,6 +30,8 @@
  * The following core functions are declared in this file for use by
  * the minidriver and do @b not need to be defined by an implementation:
  * - default_interface_jtag_execute_queue()
+ * - default_interface_jtag_submit_queue()
+ * - default_interface_jtag_complete_queue()
  */
 
 /* this header will be provided by the minidriver implementation, */
@@ -69,6 +71,8 @@ int interface_jtag_add_reset(int trst, int srst);
 int interface_jtag_add_sleep(uint32_t us);
 int interface_jtag_add_clocks(unsigned int num_cycles);
 int interface_jtag_execute_queue(void);
+int interface_jtag_submit_queue(void);
+int interface_jtag_complete_submitted(void);
 
 /**
  * Calls the interface callback to execute the queue.  This routine
@@ -76,4 +80,14 @@ int interface_jtag_execute_queue(void);
  */
 int default_interface_jtag_execute_queue(void);
 
+/**
+ * @returns true if the interface can execute a queue asynchronously,
+ * see DEBUG_CAP_ASYNC_QUEUE
+ */
+bool default_interface_jtag_can_submit(void);
+/** Calls the interface callback to start the execution of @a cmd_queue */
+int default_interface_jtag_submit_queue(struct jtag_command *cmd_queue);
+/** Calls the interface callback to wait for the end of @a cmd_queue */
+int default_interface_jtag_complete_queue(struct jtag_command *cmd_queue);
+
 #endif /* OPENOCD_JTAG_MINIDRIVER_H */
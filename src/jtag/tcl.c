@@ -41,6 +41,8 @@
  * Holds support for accessing JTAG-specific mechanisms from TCl scripts.
  */
 
+extern struct adapter_driver *adapter_driver;
+
 static const struct nvp nvp_jtag_tap_event[] = {
 	{ .value = JTAG_TRST_ASSERTED,          .name = "post-reset" },
 	{ .value = JTAG_TAP_EVENT_SETUP,        .name = "setup" },
@@ -670,6 +672,87 @@ COMMAND_HANDLER(handle_jtag_names)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_jtag_queue_stats)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		if (strcmp(CMD_ARGV[0], "reset"))
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		cmd_queue_reset_stats();
+		return ERROR_OK;
+	}
+
+	struct cmd_queue_stats stats;
+	cmd_queue_get_stats(&stats);
+	command_print(CMD, "queued: %zu bytes, peak: %zu bytes", stats.used, stats.peak);
+	command_print(CMD, "pages: %zu bytes held, %u allocated in %u flushes",
+		stats.retained, stats.pages_allocated, stats.flushes);
+	if (jtag_command_queue_get_optimize())
+		command_print(CMD, "optimizer: %u IR scans dropped, %u commands merged, %" PRIu64 " bits avoided",
+			stats.ir_scans_dropped, stats.commands_merged, stats.bits_avoided);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_jtag_stats)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		if (strcmp(CMD_ARGV[0], "reset"))
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		jtag_reset_stats();
+		return ERROR_OK;
+	}
+
+	struct jtag_stats stats;
+	jtag_get_stats(&stats);
+	command_print(CMD, "adapter: %s", adapter_driver ? adapter_driver->name : "none");
+	command_print(CMD, "flushes: %u, %u of them empty", stats.flushes, stats.empty_flushes);
+	command_print(CMD, "commands: %" PRIu64 ", scans: %" PRIu64 ", scan bits: %" PRIu64
+		", clocks: %" PRIu64, stats.commands, stats.scans, stats.scan_bits, stats.clocks);
+
+	unsigned int round_trips = 0;
+	for (unsigned int i = 0; i < JTAG_STATS_ROUND_TRIP_BUCKETS; i++)
+		round_trips += stats.round_trips[i];
+	if (!round_trips)
+		return ERROR_OK;
+
+	command_print(CMD, "round trips: %u, total %" PRIu64 " us, average %" PRIu64
+		" us, max %" PRIu64 " us", round_trips, stats.round_trip_total_us,
+		stats.round_trip_total_us / round_trips, stats.round_trip_max_us);
+	for (unsigned int i = 0; i < JTAG_STATS_ROUND_TRIP_BUCKETS; i++) {
+		if (!stats.round_trips[i])
+			continue;
+		if (i == 0)
+			command_print(CMD, "  %8s < %8u us: %u", "", 1, stats.round_trips[i]);
+		else if (i == JTAG_STATS_ROUND_TRIP_BUCKETS - 1)
+			command_print(CMD, "  %8u <=          us: %u", 1u << (i - 1), stats.round_trips[i]);
+		else
+			command_print(CMD, "  %8u <= %8u us: %u", 1u << (i - 1), 1u << i, stats.round_trips[i]);
+	}
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_jtag_queue_optimize)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		bool enable;
+		COMMAND_PARSE_ON_OFF(CMD_ARGV[0], enable);
+		jtag_command_queue_set_optimize(enable);
+	}
+
+	command_print(CMD, "%s", jtag_command_queue_get_optimize() ? "on" : "off");
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_jtag_init_command)
 {
 	if (CMD_ARGC != 0)
@@ -774,6 +857,31 @@ static const struct command_registration jtag_subcommand_handlers[] = {
 		.help = "Returns list of all JTAG tap names.",
 		.usage = "",
 	},
+	{
+		.name = "queue_stats",
+		.mode = COMMAND_ANY,
+		.handler = handle_jtag_queue_stats,
+		.help = "Display the memory used by the JTAG command queue, "
+			"or reset the peak and the counters.",
+		.usage = "['reset']",
+	},
+	{
+		.name = "stats",
+		.mode = COMMAND_ANY,
+		.handler = handle_jtag_stats,
+		.help = "Display the number of JTAG queue flushes, of commands "
+			"and bits shifted and the histogram of the adapter round "
+			"trip times, or reset them.",
+		.usage = "['reset']",
+	},
+	{
+		.name = "queue_optimize",
+		.mode = COMMAND_ANY,
+		.handler = handle_jtag_queue_optimize,
+		.help = "Remove redundant IR scans, RUNTEST, TMS and TLR reset "
+			"commands from the JTAG queue before executing it.",
+		.usage = "['on'|'off']",
+	},
 	{
 		.chain = jtag_command_handlers_to_move,
 	},
@@ -1019,13 +1127,20 @@ COMMAND_HANDLER(handle_verify_jtag_command)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
 	if (CMD_ARGC == 1) {
-		bool enable;
-		COMMAND_PARSE_ENABLE(CMD_ARGV[0], enable);
-		jtag_set_verify(enable);
+		if (!strcmp(CMD_ARGV[0], "deferred")) {
+			jtag_set_verify(true);
+			jtag_set_verify_deferred(true);
+		} else {
+			bool enable;
+			COMMAND_PARSE_ENABLE(CMD_ARGV[0], enable);
+			jtag_set_verify(enable);
+			jtag_set_verify_deferred(false);
+		}
 	}
 
 	const char *status = jtag_will_verify() ? "enabled" : "disabled";
-	command_print(CMD, "verify jtag capture is %s", status);
+	command_print(CMD, "verify jtag capture is %s%s", status,
+		(jtag_will_verify() && jtag_will_verify_deferred()) ? ", deferred" : "");
 
 	return ERROR_OK;
 }
@@ -1170,8 +1285,9 @@ static const struct command_registration jtag_command_handlers[] = {
 		.handler = handle_verify_jtag_command,
 		.mode = COMMAND_ANY,
 		.help = "Display or assign flag controlling whether to "
-			"verify values captured during IR and DR scans.",
-		.usage = "['enable'|'disable']",
+			"verify values captured during IR and DR scans, "
+			"on each field or once per queue flush.",
+		.usage = "['enable'|'disable'|'deferred']",
 	},
 	{
 		.name = "tms_sequence",
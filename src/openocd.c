@@ -17,16 +17,21 @@
 
 #include "openocd.h"
 #include <jtag/adapter.h>
+#include <jtag/bscan.h>
 #include <jtag/jtag.h>
 #include <transport/transport.h>
 #include <helper/util.h>
 #include <helper/configuration.h>
+#include <helper/event_trace.h>
+#include <helper/jim_pool.h>
 #include <flash/nor/core.h>
 #include <flash/nand/core.h>
 #include <pld/pld.h>
 #include <target/arm_cti.h>
 #include <target/arm_adi_v5.h>
 #include <target/arm_tpiu_swo.h>
+#include <target/image.h>
+#include <target/trace_recorder.h>
 #include <rtt/rtt.h>
 
 #include <server/server.h>
@@ -237,9 +242,12 @@ static int (* const command_registrants[])(struct command_context *cmd_ctx_value
 	server_register_commands,
 	gdb_register_commands,
 	log_register_commands,
+	event_trace_register_commands,
+	jim_pool_register_commands,
 	rtt_server_register_commands,
 	transport_register_commands,
 	adapter_register_commands,
+	bscan_register_commands,
 	target_register_commands,
 	flash_register_commands,
 	nand_register_commands,
@@ -247,6 +255,7 @@ static int (* const command_registrants[])(struct command_context *cmd_ctx_value
 	cti_register_commands,
 	dap_register_commands,
 	arm_tpiu_swo_register_commands,
+	trace_recorder_register_commands,
 };
 
 static struct command_context *setup_command_handler(Jim_Interp *interp)
@@ -351,8 +360,11 @@ int openocd_main(int argc, char *argv[])
 	ret = openocd_thread(argc, argv, cmd_ctx);
 
 	flash_free_all_banks();
+	image_cache_free();
 	gdb_service_free();
 	arm_tpiu_swo_cleanup_all();
+	trace_recorder_cleanup();
+	bscan_cleanup();
 	server_free();
 
 	unregister_all_commands(cmd_ctx, NULL);
@@ -372,6 +384,8 @@ int openocd_main(int argc, char *argv[])
 	rtt_exit();
 	free_config();
 
+	event_trace_cleanup();
+
 	log_exit();
 
 #if USE_GCOV
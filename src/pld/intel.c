@@ -53,9 +53,9 @@ static int intel_check_config(struct intel_pld_device *intel_info)
 	return ERROR_OK;
 }
 
-static int intel_read_file(struct raw_bit_file *bit_file, const char *filename)
+static int intel_open_file(const char *filename, FILE **input_file, size_t *length)
 {
-	if (!filename || !bit_file)
+	if (!filename)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
 	/* check if binary .bin or ascii .bit/.hex */
@@ -66,7 +66,7 @@ static int intel_read_file(struct raw_bit_file *bit_file, const char *filename)
 	}
 
 	if (strcasecmp(file_ending_pos, ".rbf") == 0)
-		return cpld_read_raw_bit_file(bit_file, filename);
+		return cpld_open_raw_bit_file(filename, input_file, length);
 
 	LOG_ERROR("Unable to detect filetype");
 	return ERROR_PLD_FILE_LOAD_FAILED;
@@ -112,35 +112,32 @@ static int intel_load(struct pld_device *pld_device, const char *filename)
 	if (retval != ERROR_OK)
 		return retval;
 
-	struct raw_bit_file bit_file;
-	retval = intel_read_file(&bit_file, filename);
+	FILE *input_file;
+	size_t length;
+	retval = intel_open_file(filename, &input_file, &length);
 	if (retval != ERROR_OK)
 		return retval;
 
 	retval = intel_set_instr(tap, 0x002);
 	if (retval != ERROR_OK) {
-		free(bit_file.data);
+		fclose(input_file);
 		return retval;
 	}
 	jtag_add_runtest(speed, TAP_IDLE);
 	retval = jtag_execute_queue();
 	if (retval != ERROR_OK) {
-		free(bit_file.data);
+		fclose(input_file);
 		return retval;
 	}
 
 	/* shift in the bitstream */
-	struct scan_field field;
-	field.num_bits = bit_file.length * 8;
-	field.out_value = bit_file.data;
-	field.in_value = NULL;
-
-	jtag_add_dr_scan(tap, 1, &field, TAP_DRPAUSE);
-	retval = jtag_execute_queue();
-	free(bit_file.data);
+	retval = cpld_shift_bitstream(tap, input_file, length, false, TAP_DRPAUSE);
+	fclose(input_file);
 	if (retval != ERROR_OK)
 		return retval;
 
+	struct scan_field field;
+
 	retval = intel_set_instr(tap, 0x004);
 	if (retval != ERROR_OK)
 		return retval;
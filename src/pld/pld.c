@@ -246,6 +246,27 @@ COMMAND_HANDLER(handle_pld_devices_command)
 	return ERROR_OK;
 }
 
+static int pld_check_load_file(const char *filename)
+{
+	struct stat input_stat;
+	if (stat(filename, &input_stat) == -1) {
+		LOG_ERROR("couldn't stat() %s: %s", filename, strerror(errno));
+		return ERROR_PLD_FILE_LOAD_FAILED;
+	}
+
+	if (S_ISDIR(input_stat.st_mode)) {
+		LOG_ERROR("%s is a directory", filename);
+		return ERROR_PLD_FILE_LOAD_FAILED;
+	}
+
+	if (input_stat.st_size == 0) {
+		LOG_ERROR("Empty file %s", filename);
+		return ERROR_PLD_FILE_LOAD_FAILED;
+	}
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_pld_load_command)
 {
 	int retval;
@@ -254,42 +275,44 @@ COMMAND_HANDLER(handle_pld_load_command)
 
 	gettimeofday(&start, NULL);
 
-	if (CMD_ARGC < 2)
+	if (CMD_ARGC < 2 || CMD_ARGC % 2)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
-	p = get_pld_device_by_name_or_numstr(CMD_ARGV[0]);
-	if (!p) {
-		command_print(CMD, "pld device '#%s' is out of bounds or unknown", CMD_ARGV[0]);
-		return ERROR_OK;
-	}
+	/* check all the pairs first, not to leave a board half configured */
+	for (unsigned int i = 0; i < CMD_ARGC; i += 2) {
+		p = get_pld_device_by_name_or_numstr(CMD_ARGV[i]);
+		if (!p) {
+			command_print(CMD, "pld device '#%s' is out of bounds or unknown", CMD_ARGV[i]);
+			return ERROR_OK;
+		}
 
-	struct stat input_stat;
-	if (stat(CMD_ARGV[1], &input_stat) == -1) {
-		LOG_ERROR("couldn't stat() %s: %s", CMD_ARGV[1], strerror(errno));
-		return ERROR_PLD_FILE_LOAD_FAILED;
-	}
+		for (unsigned int j = 0; j < i; j += 2) {
+			if (get_pld_device_by_name_or_numstr(CMD_ARGV[j]) == p) {
+				command_print(CMD, "pld device %s given twice", CMD_ARGV[i]);
+				return ERROR_COMMAND_ARGUMENT_INVALID;
+			}
+		}
 
-	if (S_ISDIR(input_stat.st_mode)) {
-		LOG_ERROR("%s is a directory", CMD_ARGV[1]);
-		return ERROR_PLD_FILE_LOAD_FAILED;
+		retval = pld_check_load_file(CMD_ARGV[i + 1]);
+		if (retval != ERROR_OK)
+			return retval;
 	}
 
-	if (input_stat.st_size == 0) {
-		LOG_ERROR("Empty file %s", CMD_ARGV[1]);
-		return ERROR_PLD_FILE_LOAD_FAILED;
-	}
+	for (unsigned int i = 0; i < CMD_ARGC; i += 2) {
+		p = get_pld_device_by_name_or_numstr(CMD_ARGV[i]);
+
+		retval = p->driver->load(p, CMD_ARGV[i + 1]);
+		if (retval != ERROR_OK) {
+			command_print(CMD, "failed loading file %s to pld device %s",
+				CMD_ARGV[i + 1], CMD_ARGV[i]);
+			return retval;
+		}
 
-	retval = p->driver->load(p, CMD_ARGV[1]);
-	if (retval != ERROR_OK) {
-		command_print(CMD, "failed loading file %s to pld device %s",
-			CMD_ARGV[1], CMD_ARGV[0]);
-		return retval;
-	} else {
 		gettimeofday(&end, NULL);
 		timeval_subtract(&duration, &end, &start);
 
 		command_print(CMD, "loaded file %s to pld device %s in %jis %jius",
-			CMD_ARGV[1], CMD_ARGV[0],
+			CMD_ARGV[i + 1], CMD_ARGV[i],
 			(intmax_t)duration.tv_sec, (intmax_t)duration.tv_usec);
 	}
 
@@ -308,8 +331,8 @@ static const struct command_registration pld_exec_command_handlers[] = {
 		.name = "load",
 		.handler = handle_pld_load_command,
 		.mode = COMMAND_EXEC,
-		.help = "load configuration file into PLD",
-		.usage = "pld_name filename",
+		.help = "load configuration files into PLDs, one after another",
+		.usage = "pld_name filename [pld_name filename]*",
 	},
 	COMMAND_REGISTRATION_DONE
 };
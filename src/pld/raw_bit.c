@@ -12,29 +12,43 @@
 #include "raw_bit.h"
 #include "pld.h"
 
+#include <helper/binarybuffer.h>
 #include <helper/system.h>
 #include <helper/log.h>
 
 
-int cpld_read_raw_bit_file(struct raw_bit_file *bit_file, const char *filename)
+int cpld_open_raw_bit_file(const char *filename, FILE **input_file, size_t *length)
 {
-	FILE *input_file = fopen(filename, "rb");
+	FILE *file = fopen(filename, "rb");
 
-	if (!input_file) {
+	if (!file) {
 		LOG_ERROR("Couldn't open %s: %s", filename, strerror(errno));
 		return ERROR_PLD_FILE_LOAD_FAILED;
 	}
 
-	fseek(input_file, 0, SEEK_END);
-	long length = ftell(input_file);
-	fseek(input_file, 0, SEEK_SET);
+	fseek(file, 0, SEEK_END);
+	long file_length = ftell(file);
+	fseek(file, 0, SEEK_SET);
 
-	if (length < 0) {
-		fclose(input_file);
+	if (file_length < 0) {
+		fclose(file);
 		LOG_ERROR("Failed to get length of file %s: %s", filename, strerror(errno));
 		return ERROR_PLD_FILE_LOAD_FAILED;
 	}
-	bit_file->length = (size_t)length;
+
+	*input_file = file;
+	*length = (size_t)file_length;
+
+	return ERROR_OK;
+}
+
+int cpld_read_raw_bit_file(struct raw_bit_file *bit_file, const char *filename)
+{
+	FILE *input_file;
+
+	int retval = cpld_open_raw_bit_file(filename, &input_file, &bit_file->length);
+	if (retval != ERROR_OK)
+		return retval;
 
 	bit_file->data = malloc(bit_file->length);
 	if (!bit_file->data) {
@@ -53,3 +67,46 @@ int cpld_read_raw_bit_file(struct raw_bit_file *bit_file, const char *filename)
 
 	return ERROR_OK;
 }
+
+int cpld_shift_bitstream(struct jtag_tap *tap, FILE *input_file, size_t length,
+	bool flip_bits, enum tap_state end_state)
+{
+	struct scan_field field;
+	int retval = ERROR_OK;
+
+	uint8_t *buffer = malloc(MIN(length, CPLD_BITSTREAM_CHUNK_SIZE));
+	if (!buffer) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	field.in_value = NULL;
+	field.out_value = buffer;
+
+	while (length > 0) {
+		size_t chunk = MIN(length, CPLD_BITSTREAM_CHUNK_SIZE);
+
+		if (fread(buffer, 1, chunk, input_file) != chunk) {
+			LOG_ERROR("Couldn't read the bitstream");
+			retval = ERROR_PLD_FILE_LOAD_FAILED;
+			break;
+		}
+
+		if (flip_bits)
+			for (size_t i = 0; i < chunk; i++)
+				buffer[i] = flip_u32(buffer[i], 8);
+
+		length -= chunk;
+
+		/* the scan is copied to the queue, run it before reading more */
+		field.num_bits = chunk * 8;
+		jtag_add_dr_scan(tap, 1, &field, length ? TAP_DRPAUSE : end_state);
+		retval = jtag_execute_queue();
+		if (retval != ERROR_OK)
+			break;
+	}
+
+	free(buffer);
+
+	return retval;
+}
@@ -8,8 +8,15 @@
 #ifndef OPENOCD_PLD_RAW_BIN_H
 #define OPENOCD_PLD_RAW_BIN_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+
+#include <jtag/jtag.h>
+
+/* Bitstream bytes shifted per DR scan by cpld_shift_bitstream() */
+#define CPLD_BITSTREAM_CHUNK_SIZE	(1024 * 1024)
 
 struct raw_bit_file {
 	size_t length;
@@ -18,4 +25,22 @@ struct raw_bit_file {
 
 int cpld_read_raw_bit_file(struct raw_bit_file *bit_file, const char *filename);
 
+/** Opens a bitstream file for cpld_shift_bitstream(), gives its length. */
+int cpld_open_raw_bit_file(const char *filename, FILE **input_file, size_t *length);
+
+/**
+ * Shifts @a length bytes read from @a input_file into the DR of @a tap, in
+ * DR scans of CPLD_BITSTREAM_CHUNK_SIZE bytes joined through Pause-DR, so
+ * without Update-DR nor Capture-DR in between. Only one chunk is held in
+ * memory, whatever the size of the bitstream.
+ *
+ * For devices that take their configuration data over several scans ending
+ * in Pause-DR, the last scan ends in @a end_state.
+ *
+ * @param flip_bits Reverse the bits of every byte, for the files written
+ * MSB first.
+ */
+int cpld_shift_bitstream(struct jtag_tap *tap, FILE *input_file, size_t length,
+	bool flip_bits, enum tap_state end_state);
+
 #endif /* OPENOCD_PLD_RAW_BIN_H */
@@ -11,6 +11,7 @@
 
 #include "virtex2.h"
 #include "xilinx_bit.h"
+#include "raw_bit.h"
 #include "pld.h"
 
 static const struct virtex2_command_set virtex2_default_commands = {
@@ -229,30 +230,24 @@ static int virtex2_load(struct pld_device *pld_device, const char *filename)
 {
 	struct virtex2_pld_device *virtex2_info = pld_device->driver_priv;
 	struct xilinx_bit_file bit_file;
+	FILE *data_file;
 	int retval;
-	unsigned int i;
-	struct scan_field field;
 
-	field.in_value = NULL;
-
-	retval = xilinx_read_bit_file(&bit_file, filename);
+	retval = xilinx_open_bit_file(&bit_file, filename, &data_file);
 	if (retval != ERROR_OK)
 		return retval;
 
 	retval = virtex2_load_prepare(pld_device);
 	if (retval != ERROR_OK) {
+		fclose(data_file);
 		xilinx_free_bit_file(&bit_file);
 		return retval;
 	}
 
-	for (i = 0; i < bit_file.length; i++)
-		bit_file.data[i] = flip_u32(bit_file.data[i], 8);
-
-	field.num_bits = bit_file.length * 8;
-	field.out_value = bit_file.data;
-
-	jtag_add_dr_scan(virtex2_info->tap, 1, &field, TAP_DRPAUSE);
-	retval = jtag_execute_queue();
+	/* CFG_IN takes the bitstream over several scans through Pause-DR */
+	retval = cpld_shift_bitstream(virtex2_info->tap, data_file, bit_file.length,
+			true, TAP_DRPAUSE);
+	fclose(data_file);
 	if (retval != ERROR_OK) {
 		xilinx_free_bit_file(&bit_file);
 		return retval;
@@ -8,6 +8,8 @@
 #ifndef OPENOCD_PLD_XILINX_BIT_H
 #define OPENOCD_PLD_XILINX_BIT_H
 
+#include <stdio.h>
+
 #include "helper/types.h"
 
 struct xilinx_bit_file {
@@ -22,6 +24,14 @@ struct xilinx_bit_file {
 
 int xilinx_read_bit_file(struct xilinx_bit_file *bit_file, const char *filename);
 
+/**
+ * Reads the header of a bit file, without the bitstream. The file is left
+ * open in @a data_file at the first of the bit_file->length bytes of the
+ * bitstream.
+ */
+int xilinx_open_bit_file(struct xilinx_bit_file *bit_file, const char *filename,
+	FILE **data_file);
+
 void xilinx_free_bit_file(struct xilinx_bit_file *bit_file);
 
 #endif /* OPENOCD_PLD_XILINX_BIT_H */
@@ -76,12 +76,31 @@ static const struct freertos_params freertos_params_list[] = {
 	},
 };
 
+/* Per target state, pointed to by rtos_specific_params */
+struct freertos {
+	const struct freertos_params *params;
+	/* The thread list was walked with the scheduler running, when
+	 * uxTaskNumber and uxCurrentNumberOfTasks had these values */
+	bool list_valid;
+	uint32_t task_number;
+	uint32_t thread_list_size;
+};
+
+static const struct freertos_params *freertos_get_params(const struct rtos *rtos)
+{
+	const struct freertos *freertos = rtos->rtos_specific_params;
+
+	return freertos->params;
+}
+
 static bool freertos_detect_rtos(struct target *target);
 static int freertos_create(struct target *target);
 static int freertos_update_threads(struct rtos *rtos);
 static int freertos_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 		struct rtos_reg **reg_list, int *num_regs);
 static int freertos_get_symbol_list_to_lookup(struct symbol_table_elem *symbol_list[]);
+static int freertos_get_thread_stack(struct rtos *rtos, threadid_t thread_id,
+		struct rtos_stack_region *region);
 
 const struct rtos_type freertos_rtos = {
 	.name = "FreeRTOS",
@@ -91,6 +110,7 @@ const struct rtos_type freertos_rtos = {
 	.update_threads = freertos_update_threads,
 	.get_thread_reg_list = freertos_get_thread_reg_list,
 	.get_symbol_list_to_lookup = freertos_get_symbol_list_to_lookup,
+	.get_thread_stack = freertos_get_thread_stack,
 };
 
 enum freertos_symbol_values {
@@ -106,6 +126,8 @@ enum freertos_symbol_values {
 	FREERTOS_VAL_UX_CURRENT_NUMBER_OF_TASKS = 9,
 	FREERTOS_VAL_UX_TOP_USED_PRIORITY = 10,
 	FREERTOS_VAL_X_SCHEDULER_RUNNING = 11,
+	FREERTOS_VAL_UX_TASK_NUMBER = 12,
+	FREERTOS_VAL_OPENOCD_THREAD_TABLE = 13,
 };
 
 struct symbols {
@@ -126,79 +148,87 @@ static const struct symbols freertos_symbol_list[] = {
 	{ "uxCurrentNumberOfTasks", false },
 	{ "uxTopUsedPriority", true }, /* Unavailable since v7.5.3 */
 	{ "xSchedulerRunning", false },
+	{ "uxTaskNumber", true }, /* Only used to detect an unchanged task list */
+	{ "openocd_thread_table", true }, /* See contrib/rtos-helpers/openocd-thread-table.h */
 	{ NULL, false }
 };
 
+/* eTaskState names, for the firmware thread table */
+static const char * const freertos_task_states[] = {
+	"Running",
+	"Ready",
+	"Blocked",
+	"Suspended",
+	"Deleted",
+};
+
 /* TODO: */
 /* this is not safe for little endian yet */
 /* may be problems reading if sizes are not 32 bit long integers. */
 /* test mallocs for failure */
 
-static int freertos_update_threads(struct rtos *rtos)
-{
-	int retval;
-	unsigned int tasks_found = 0;
-	const struct freertos_params *param;
-
-	if (!rtos->rtos_specific_params)
-		return -1;
+#define FREERTOS_THREAD_NAME_STR_SIZE (200)
 
-	param = (const struct freertos_params *) rtos->rtos_specific_params;
+static int freertos_read_thread_name(struct rtos *rtos, const struct freertos_params *param,
+		threadid_t threadid, char **name)
+{
+	char tmp_str[FREERTOS_THREAD_NAME_STR_SIZE];
 
-	if (!rtos->symbols) {
-		LOG_ERROR("No symbols for FreeRTOS");
-		return -3;
+	int retval = target_read_buffer(rtos->target,
+			threadid + param->thread_name_offset,
+			FREERTOS_THREAD_NAME_STR_SIZE,
+			(uint8_t *)&tmp_str);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error reading thread name in FreeRTOS thread list");
+		return retval;
 	}
+	tmp_str[FREERTOS_THREAD_NAME_STR_SIZE-1] = '\x00';
+	LOG_DEBUG("FreeRTOS: Read Thread Name at 0x%" PRIx64 ", value '%s'",
+										threadid + param->thread_name_offset,
+										tmp_str);
 
-	if (rtos->symbols[FREERTOS_VAL_UX_CURRENT_NUMBER_OF_TASKS].address == 0) {
-		LOG_ERROR("Don't have the number of threads in FreeRTOS");
-		return -2;
-	}
+	if (tmp_str[0] == '\x00')
+		strcpy(tmp_str, "No Name");
 
-	uint32_t thread_list_size = 0;
-	retval = target_read_u32(rtos->target,
-			rtos->symbols[FREERTOS_VAL_UX_CURRENT_NUMBER_OF_TASKS].address,
-			&thread_list_size);
-	LOG_DEBUG("FreeRTOS: Read uxCurrentNumberOfTasks at 0x%" PRIx64 ", value %" PRIu32,
-										rtos->symbols[FREERTOS_VAL_UX_CURRENT_NUMBER_OF_TASKS].address,
-										thread_list_size);
+	*name = strdup(tmp_str);
+	return ERROR_OK;
+}
 
-	if (retval != ERROR_OK) {
-		LOG_ERROR("Could not read FreeRTOS thread count from target");
-		return retval;
+/* Take over the name of a thread already in the previous thread list */
+static char *freertos_take_thread_name(struct thread_detail *old_threads, int old_count,
+		threadid_t threadid)
+{
+	for (int i = 0; i < old_count; i++) {
+		if (old_threads[i].threadid == threadid && old_threads[i].thread_name_str) {
+			char *name = old_threads[i].thread_name_str;
+			old_threads[i].thread_name_str = NULL;
+			return name;
+		}
 	}
 
-	/* wipe out previous thread details if any */
-	rtos_free_threadlist(rtos);
+	return NULL;
+}
 
-	/* read the current thread */
-	uint32_t pointer_casts_are_bad;
-	retval = target_read_u32(rtos->target,
-			rtos->symbols[FREERTOS_VAL_PX_CURRENT_TCB].address,
-			&pointer_casts_are_bad);
-	if (retval != ERROR_OK) {
-		LOG_ERROR("Error reading current thread in FreeRTOS thread list");
-		return retval;
-	}
-	rtos->current_thread = pointer_casts_are_bad;
-	LOG_DEBUG("FreeRTOS: Read pxCurrentTCB at 0x%" PRIx64 ", value 0x%" PRIx64,
-										rtos->symbols[FREERTOS_VAL_PX_CURRENT_TCB].address,
-										rtos->current_thread);
+static void freertos_set_running_thread(struct rtos *rtos)
+{
+	for (int i = 0; i < rtos->thread_count; i++) {
+		struct thread_detail *detail = &rtos->thread_details[i];
 
-	/* read scheduler running */
-	uint32_t scheduler_running;
-	retval = target_read_u32(rtos->target,
-			rtos->symbols[FREERTOS_VAL_X_SCHEDULER_RUNNING].address,
-			&scheduler_running);
-	if (retval != ERROR_OK) {
-		LOG_ERROR("Error reading FreeRTOS scheduler state");
-		return retval;
+		free(detail->extra_info_str);
+		detail->extra_info_str = NULL;
+		if (detail->threadid == rtos->current_thread)
+			detail->extra_info_str = strdup("State: Running");
 	}
-	LOG_DEBUG("FreeRTOS: Read xSchedulerRunning at 0x%" PRIx64 ", value 0x%" PRIx32,
-										rtos->symbols[FREERTOS_VAL_X_SCHEDULER_RUNNING].address,
-										scheduler_running);
+}
 
-	if ((thread_list_size  == 0) || (rtos->current_thread == 0) || (scheduler_running != 1)) {
+static int freertos_walk_threads(struct rtos *rtos, uint32_t thread_list_size,
+		bool scheduler_running, struct thread_detail *old_threads, int old_count)
+{
+	int retval;
+	unsigned int tasks_found = 0;
+	const struct freertos_params *param = freertos_get_params(rtos);
+
+	if (!scheduler_running) {
 		/* Either : No RTOS threads - there is always at least the current execution though */
 		/* OR     : No current thread - all threads suspended - show the current execution
 		 * of idling */
@@ -261,8 +291,12 @@ static int freertos_update_threads(struct rtos *rtos)
 
 	symbol_address_t *list_of_lists =
 		malloc(sizeof(symbol_address_t) * (config_max_priorities + 5));
-	if (!list_of_lists) {
+	/* list headers, one list_width slot per list */
+	uint8_t *list_headers = malloc(param->list_width * (config_max_priorities + 5));
+	if (!list_of_lists || !list_headers) {
 		LOG_ERROR("Error allocating memory for %u priorities", config_max_priorities);
+		free(list_of_lists);
+		free(list_headers);
 		return ERROR_FAIL;
 	}
 
@@ -277,118 +311,240 @@ static int freertos_update_threads(struct rtos *rtos)
 	list_of_lists[num_lists++] = rtos->symbols[FREERTOS_VAL_X_SUSPENDED_TASK_LIST].address;
 	list_of_lists[num_lists++] = rtos->symbols[FREERTOS_VAL_X_TASKS_WAITING_TERMINATION].address;
 
+	/* The ready lists are an array, read all their headers at once. The
+	 * other lists only need the item count and the first item pointer. */
+	retval = target_read_buffer(rtos->target, list_of_lists[0],
+			config_max_priorities * param->list_width, list_headers);
+	for (unsigned int i = config_max_priorities; retval == ERROR_OK && i < num_lists; i++) {
+		if (list_of_lists[i] == 0)
+			continue;
+		retval = target_read_buffer(rtos->target, list_of_lists[i],
+				param->list_next_offset + param->pointer_width,
+				list_headers + i * param->list_width);
+	}
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error reading FreeRTOS thread lists");
+		free(list_headers);
+		free(list_of_lists);
+		return retval;
+	}
+
+	/* one read per list item gets both the next and the owner pointers */
+	const unsigned int list_elem_size = MAX(param->list_elem_next_offset,
+			param->list_elem_content_offset) + param->pointer_width;
+	uint8_t list_elem[UINT8_MAX + 8];
+
 	for (unsigned int i = 0; i < num_lists; i++) {
 		if (list_of_lists[i] == 0)
 			continue;
 
-		/* Read the number of threads in this list */
-		uint32_t list_thread_count = 0;
-		retval = target_read_u32(rtos->target,
-				list_of_lists[i],
-				&list_thread_count);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading number of threads in FreeRTOS thread list");
-			free(list_of_lists);
-			return retval;
-		}
+		const uint8_t *list_header = list_headers + i * param->list_width;
+
+		/* The number of threads in this list */
+		uint32_t list_thread_count = target_buffer_get_u32(rtos->target, list_header);
 		LOG_DEBUG("FreeRTOS: Read thread count for list %u at 0x%" PRIx64 ", value %" PRIu32,
 										i, list_of_lists[i], list_thread_count);
 
 		if (list_thread_count == 0)
 			continue;
 
-		/* Read the location of first list item */
+		/* The location of first list item */
 		uint32_t prev_list_elem_ptr = -1;
-		uint32_t list_elem_ptr = 0;
-		retval = target_read_u32(rtos->target,
-				list_of_lists[i] + param->list_next_offset,
-				&list_elem_ptr);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading first thread item location in FreeRTOS thread list");
-			free(list_of_lists);
-			return retval;
-		}
+		uint32_t list_elem_ptr = target_buffer_get_u32(rtos->target,
+				list_header + param->list_next_offset);
 		LOG_DEBUG("FreeRTOS: Read first item for list %u at 0x%" PRIx64 ", value 0x%" PRIx32,
 										i, list_of_lists[i] + param->list_next_offset, list_elem_ptr);
 
 		while ((list_thread_count > 0) && (list_elem_ptr != 0) &&
 				(list_elem_ptr != prev_list_elem_ptr) &&
 				(tasks_found < thread_list_size)) {
-			/* Get the location of the thread structure. */
-			retval = target_read_u32(rtos->target,
-					list_elem_ptr + param->list_elem_content_offset,
-					&pointer_casts_are_bad);
+			retval = target_read_buffer(rtos->target, list_elem_ptr,
+					list_elem_size, list_elem);
 			if (retval != ERROR_OK) {
-				LOG_ERROR("Error reading thread list item object in FreeRTOS thread list");
+				LOG_ERROR("Error reading thread list item in FreeRTOS thread list");
+				free(list_headers);
 				free(list_of_lists);
 				return retval;
 			}
-			rtos->thread_details[tasks_found].threadid = pointer_casts_are_bad;
+
+			/* Get the location of the thread structure. */
+			struct thread_detail *detail = &rtos->thread_details[tasks_found];
+			detail->threadid = target_buffer_get_u32(rtos->target,
+					list_elem + param->list_elem_content_offset);
 			LOG_DEBUG("FreeRTOS: Read Thread ID at 0x%" PRIx32 ", value 0x%" PRIx64,
 										list_elem_ptr + param->list_elem_content_offset,
-										rtos->thread_details[tasks_found].threadid);
-
-			/* get thread name */
-
-			#define FREERTOS_THREAD_NAME_STR_SIZE (200)
-			char tmp_str[FREERTOS_THREAD_NAME_STR_SIZE];
-
-			/* Read the thread name */
-			retval = target_read_buffer(rtos->target,
-					rtos->thread_details[tasks_found].threadid + param->thread_name_offset,
-					FREERTOS_THREAD_NAME_STR_SIZE,
-					(uint8_t *)&tmp_str);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("Error reading first thread item location in FreeRTOS thread list");
-				free(list_of_lists);
-				return retval;
+										detail->threadid);
+
+			/* A thread keeps its name, only read the names of new threads */
+			detail->thread_name_str = freertos_take_thread_name(old_threads, old_count,
+					detail->threadid);
+			if (!detail->thread_name_str) {
+				retval = freertos_read_thread_name(rtos, param, detail->threadid,
+						&detail->thread_name_str);
+				if (retval != ERROR_OK) {
+					free(list_headers);
+					free(list_of_lists);
+					return retval;
+				}
 			}
-			tmp_str[FREERTOS_THREAD_NAME_STR_SIZE-1] = '\x00';
-			LOG_DEBUG("FreeRTOS: Read Thread Name at 0x%" PRIx64 ", value '%s'",
-										rtos->thread_details[tasks_found].threadid + param->thread_name_offset,
-										tmp_str);
-
-			if (tmp_str[0] == '\x00')
-				strcpy(tmp_str, "No Name");
-
-			rtos->thread_details[tasks_found].thread_name_str =
-				malloc(strlen(tmp_str)+1);
-			strcpy(rtos->thread_details[tasks_found].thread_name_str, tmp_str);
-			rtos->thread_details[tasks_found].exists = true;
-
-			if (rtos->thread_details[tasks_found].threadid == rtos->current_thread) {
-				char running_str[] = "State: Running";
-				rtos->thread_details[tasks_found].extra_info_str = malloc(
-						sizeof(running_str));
-				strcpy(rtos->thread_details[tasks_found].extra_info_str,
-					running_str);
-			} else
-				rtos->thread_details[tasks_found].extra_info_str = NULL;
+			detail->exists = true;
+			detail->extra_info_str = NULL;
 
 			tasks_found++;
 			list_thread_count--;
 			rtos->thread_count = tasks_found;
 
 			prev_list_elem_ptr = list_elem_ptr;
-			list_elem_ptr = 0;
-			retval = target_read_u32(rtos->target,
-					prev_list_elem_ptr + param->list_elem_next_offset,
-					&list_elem_ptr);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("Error reading next thread item location in FreeRTOS thread list");
-				free(list_of_lists);
-				return retval;
-			}
+			list_elem_ptr = target_buffer_get_u32(rtos->target,
+					list_elem + param->list_elem_next_offset);
 			LOG_DEBUG("FreeRTOS: Read next thread location at 0x%" PRIx32 ", value 0x%" PRIx32,
 										prev_list_elem_ptr + param->list_elem_next_offset,
 										list_elem_ptr);
 		}
 	}
 
+	free(list_headers);
 	free(list_of_lists);
 	return 0;
 }
 
+static int freertos_update_threads(struct rtos *rtos)
+{
+	int retval;
+	struct freertos *freertos;
+
+	if (!rtos->rtos_specific_params)
+		return -1;
+
+	freertos = rtos->rtos_specific_params;
+
+	if (!rtos->symbols) {
+		LOG_ERROR("No symbols for FreeRTOS");
+		return -3;
+	}
+
+	/* a thread table maintained by the firmware avoids walking the lists */
+	if (rtos->symbols[FREERTOS_VAL_OPENOCD_THREAD_TABLE].address != 0) {
+		retval = rtos_thread_table_update(rtos,
+				rtos->symbols[FREERTOS_VAL_OPENOCD_THREAD_TABLE].address,
+				freertos_task_states, ARRAY_SIZE(freertos_task_states));
+		if (retval == ERROR_OK) {
+			freertos->list_valid = false;
+			return ERROR_OK;
+		}
+		LOG_DEBUG("FreeRTOS: thread table not usable, walking the task lists");
+	}
+
+	if (rtos->symbols[FREERTOS_VAL_UX_CURRENT_NUMBER_OF_TASKS].address == 0) {
+		LOG_ERROR("Don't have the number of threads in FreeRTOS");
+		return -2;
+	}
+
+	uint32_t thread_list_size = 0;
+	retval = target_read_u32(rtos->target,
+			rtos->symbols[FREERTOS_VAL_UX_CURRENT_NUMBER_OF_TASKS].address,
+			&thread_list_size);
+	LOG_DEBUG("FreeRTOS: Read uxCurrentNumberOfTasks at 0x%" PRIx64 ", value %" PRIu32,
+										rtos->symbols[FREERTOS_VAL_UX_CURRENT_NUMBER_OF_TASKS].address,
+										thread_list_size);
+
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Could not read FreeRTOS thread count from target");
+		return retval;
+	}
+
+	/* keep the previous thread details, to reuse what did not change */
+	struct thread_detail *old_threads = rtos->thread_details;
+	int old_count = rtos->thread_count;
+	rtos->thread_details = NULL;
+	rtos->thread_count = 0;
+	rtos->current_threadid = -1;
+
+	/* read the current thread */
+	uint32_t pointer_casts_are_bad;
+	retval = target_read_u32(rtos->target,
+			rtos->symbols[FREERTOS_VAL_PX_CURRENT_TCB].address,
+			&pointer_casts_are_bad);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error reading current thread in FreeRTOS thread list");
+		goto out;
+	}
+	rtos->current_thread = pointer_casts_are_bad;
+	LOG_DEBUG("FreeRTOS: Read pxCurrentTCB at 0x%" PRIx64 ", value 0x%" PRIx64,
+										rtos->symbols[FREERTOS_VAL_PX_CURRENT_TCB].address,
+										rtos->current_thread);
+
+	/* read scheduler running */
+	uint32_t scheduler_running;
+	retval = target_read_u32(rtos->target,
+			rtos->symbols[FREERTOS_VAL_X_SCHEDULER_RUNNING].address,
+			&scheduler_running);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Error reading FreeRTOS scheduler state");
+		goto out;
+	}
+	LOG_DEBUG("FreeRTOS: Read xSchedulerRunning at 0x%" PRIx64 ", value 0x%" PRIx32,
+										rtos->symbols[FREERTOS_VAL_X_SCHEDULER_RUNNING].address,
+										scheduler_running);
+
+	bool running = (thread_list_size != 0) && (rtos->current_thread != 0) &&
+		(scheduler_running == 1);
+
+	/* uxTaskNumber is incremented on each task creation, with an unchanged
+	 * number of tasks it tells that the set of tasks did not change */
+	uint32_t task_number = 0;
+	bool have_task_number = rtos->symbols[FREERTOS_VAL_UX_TASK_NUMBER].address != 0;
+	if (have_task_number) {
+		retval = target_read_u32(rtos->target,
+				rtos->symbols[FREERTOS_VAL_UX_TASK_NUMBER].address,
+				&task_number);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("Error reading FreeRTOS task number");
+			goto out;
+		}
+		LOG_DEBUG("FreeRTOS: Read uxTaskNumber at 0x%" PRIx64 ", value %" PRIu32,
+										rtos->symbols[FREERTOS_VAL_UX_TASK_NUMBER].address,
+										task_number);
+	}
+
+	if (running && have_task_number && freertos->list_valid && old_threads &&
+			task_number == freertos->task_number &&
+			thread_list_size == freertos->thread_list_size) {
+		LOG_DEBUG("FreeRTOS: no task created or deleted, keeping the thread list");
+		rtos->thread_details = old_threads;
+		rtos->thread_count = old_count;
+		freertos_set_running_thread(rtos);
+		return ERROR_OK;
+	}
+
+	/* uxCurrentNumberOfTasks moved by the tasks created less the tasks
+	 * deleted. A task created after another was deleted can get its TCB,
+	 * so the names of the previous list are only taken over when no task
+	 * was created, or none was deleted, since it was walked */
+	bool reuse_names = have_task_number && freertos->list_valid &&
+		(task_number == freertos->task_number ||
+		 thread_list_size - freertos->thread_list_size == task_number - freertos->task_number);
+
+	freertos->list_valid = false;
+	retval = freertos_walk_threads(rtos, thread_list_size, running, old_threads,
+			reuse_names ? old_count : 0);
+	if (retval != ERROR_OK)
+		goto out;
+
+	freertos_set_running_thread(rtos);
+	freertos->list_valid = running;
+	freertos->task_number = task_number;
+	freertos->thread_list_size = thread_list_size;
+
+out:
+	for (int i = 0; i < old_count; i++) {
+		free(old_threads[i].thread_name_str);
+		free(old_threads[i].extra_info_str);
+	}
+	free(old_threads);
+	return retval;
+}
+
 static int freertos_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 		struct rtos_reg **reg_list, int *num_regs)
 {
@@ -405,7 +561,7 @@ static int freertos_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 	if (!rtos->rtos_specific_params)
 		return -1;
 
-	param = (const struct freertos_params *) rtos->rtos_specific_params;
+	param = freertos_get_params(rtos);
 
 	/* Read the stack pointer */
 	uint32_t pointer_casts_are_bad;
@@ -466,6 +622,38 @@ static int freertos_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 		return rtos_generic_stack_read(rtos->target, param->stacking_info_cm3, stack_ptr, reg_list, num_regs);
 }
 
+/* tskSTACK_FILL_BYTE */
+#define FREERTOS_STACK_FILL_BYTE 0xa5
+
+static int freertos_get_thread_stack(struct rtos *rtos, threadid_t thread_id,
+		struct rtos_stack_region *region)
+{
+	const struct freertos_params *param = freertos_get_params(rtos);
+	uint32_t top_of_stack, stack;
+
+	/* thread 1 stands for the current execution, it has no TCB */
+	if (thread_id == 0 || thread_id == 1)
+		return ERROR_FAIL;
+
+	/* pxStack is the TCB field just before pcTaskName */
+	int retval = target_read_u32(rtos->target, thread_id + param->thread_stack_offset,
+			&top_of_stack);
+	if (retval == ERROR_OK)
+		retval = target_read_u32(rtos->target,
+				thread_id + param->thread_name_offset - param->pointer_width, &stack);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* the stack grows down, from the saved stack pointer nothing is unused */
+	if (top_of_stack < stack)
+		return ERROR_FAIL;
+
+	region->base = stack;
+	region->size = top_of_stack - stack;
+	region->fill = FREERTOS_STACK_FILL_BYTE;
+	return ERROR_OK;
+}
+
 static int freertos_get_symbol_list_to_lookup(struct symbol_table_elem *symbol_list[])
 {
 	unsigned int i;
@@ -501,9 +689,8 @@ static int freertos_get_thread_ascii_info(struct rtos *rtos, threadid_t thread_i
 	if (!rtos->rtos_specific_params)
 		return -3;
 
-	param = (const struct freertos_params *) rtos->rtos_specific_params;
+	param = freertos_get_params(rtos);
 
-#define FREERTOS_THREAD_NAME_STR_SIZE (200)
 	char tmp_str[FREERTOS_THREAD_NAME_STR_SIZE];
 
 	/* Read the thread name */
@@ -541,7 +728,13 @@ static int freertos_create(struct target *target)
 {
 	for (unsigned int i = 0; i < ARRAY_SIZE(freertos_params_list); i++)
 		if (strcmp(freertos_params_list[i].target_name, target_type_name(target)) == 0) {
-			target->rtos->rtos_specific_params = (void *)&freertos_params_list[i];
+			struct freertos *freertos = calloc(1, sizeof(*freertos));
+			if (!freertos) {
+				LOG_ERROR("FreeRTOS: out of memory");
+				return -1;
+			}
+			freertos->params = &freertos_params_list[i];
+			target->rtos->rtos_specific_params = freertos;
 			return 0;
 		}
 
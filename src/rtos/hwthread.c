@@ -251,6 +251,11 @@ static int hwthread_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 	if (retval != ERROR_OK)
 		return retval;
 
+	/* batch the register reads where the core supports it */
+	retval = target_fetch_regs(curr, reg_list, reg_list_size);
+	if (retval != ERROR_OK)
+		LOG_TARGET_DEBUG(curr, "Batched register read failed");
+
 	int j = 0;
 	for (int i = 0; i < reg_list_size; i++) {
 		if (!reg_list[i] || !reg_list[i]->exist || reg_list[i]->hidden)
@@ -316,7 +321,8 @@ static int hwthread_get_thread_reg(struct rtos *rtos, int64_t thread_id,
 		return ERROR_FAIL;
 	}
 
-	if (reg->type->get(reg) != ERROR_OK)
+	/* the register cache of the core stays valid until it resumes */
+	if (!reg->valid && reg->type->get(reg) != ERROR_OK)
 		return ERROR_FAIL;
 
 	rtos_reg->number = reg->number;
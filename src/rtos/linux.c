@@ -118,20 +118,22 @@ static int linux_read_memory(struct target *target,
 	uint32_t address, uint32_t size, uint32_t count,
 	uint8_t *buffer)
 {
-#ifdef PHYS
-	struct linux_os *linux_os = (struct linux_os *)
-		target->rtos->rtos_specific_params;
-	uint32_t pa = (address & linux_os->phys_mask) + linux_os->phys_base;
-#endif
 	if (address < 0xc0000000) {
 		LOG_ERROR("linux awareness : address in user space");
 		return ERROR_FAIL;
 	}
 #ifdef PHYS
-	target_read_phys_memory(target, pa, size, count, buffer);
+	/*  kernel addresses are in the linear map, the offset computed once
+	 *  by linux_compute_virt2phys() avoids a translation per access */
+	struct linux_os *linux_os = (struct linux_os *)
+		target->rtos->rtos_specific_params;
+	if (linux_os->phys_base != 0) {
+		uint32_t pa = (address & linux_os->phys_mask) + linux_os->phys_base;
+		if (target_read_phys_memory(target, pa, size, count, buffer) == ERROR_OK)
+			return ERROR_OK;
+	}
 #endif
-	target_read_memory(target, address, size, count, buffer);
-	return ERROR_OK;
+	return target_read_memory(target, address, size, count, buffer);
 }
 
 static int fill_buffer(struct target *target, uint32_t addr, uint8_t *buffer)
@@ -336,6 +338,41 @@ static int fill_task(struct target *target, struct threads *t)
 	return retval;
 }
 
+/*  the part of task_struct used, from its start to the end of comm */
+#define TASK_STRUCT_SIZE (COMM + 16)
+
+/*  read state, pid, on_cpu, mm, tasks.next and comm of a task with one
+ *  access, instead of fill_task(), get_name() and next_task() */
+static int read_task(struct target *target, struct threads *t, uint32_t *next)
+{
+	uint8_t buffer[TASK_STRUCT_SIZE];
+	int retval = linux_read_memory(target, t->base_addr, 4,
+			TASK_STRUCT_SIZE / 4, buffer);
+
+	if (retval != ERROR_OK) {
+		LOG_ERROR("read_task: unable to read memory");
+		return retval;
+	}
+
+	t->state = get_buffer(target, buffer);
+	t->pid = get_buffer(target, buffer + PID);
+	t->oncpu = get_buffer(target, buffer + ONCPU);
+	*next = get_buffer(target, buffer + NEXT) - NEXT;
+	memcpy(t->name, buffer + COMM, 16);
+	t->name[16] = 0;
+
+	uint32_t mm = get_buffer(target, buffer + MEM);
+	t->asid = 0;
+	if (mm != 0) {
+		if (fill_buffer(target, mm + MM_CTX, buffer) == ERROR_OK)
+			t->asid = get_buffer(target, buffer);
+		else
+			LOG_ERROR("read_task: unable to read memory -- ASID");
+	}
+
+	return ERROR_OK;
+}
+
 static int get_name(struct target *target, struct threads *t)
 {
 	int retval;
@@ -694,8 +731,8 @@ static int linux_get_tasks(struct target *target, int context)
 	while (((t->base_addr != linux_os->init_task_addr) &&
 		(t->base_addr != 0)) || (loop == 0)) {
 		loop++;
-		fill_task(target, t);
-		retval = get_name(target, t);
+		uint32_t base_addr = 0;
+		retval = read_task(target, t, &base_addr);
 
 		if (loop > MAX_THREADS) {
 			free(t);
@@ -710,7 +747,6 @@ static int linux_get_tasks(struct target *target, int context)
 
 		/*  check that this thread is not one the current threads already
 		 *  created */
-		uint32_t base_addr;
 #ifdef PID_CHECK
 
 		if (!current_pid(linux_os, t->pid)) {
@@ -731,10 +767,8 @@ static int linux_get_tasks(struct target *target, int context)
 				t->context =
 					cpu_context_read(target, t->base_addr,
 						&t->thread_info_addr);
-			base_addr = next_task(target, t);
 		} else {
 			/*LOG_INFO("thread %s is a current thread already created",t->name); */
-			base_addr = next_task(target, t);
 			free(t);
 		}
 
@@ -993,9 +1027,8 @@ static int linux_task_update(struct target *target, int context)
 		}
 
 		if (found == 0) {
-			uint32_t base_addr;
-			fill_task(target, t);
-			get_name(target, t);
+			uint32_t base_addr = 0;
+			read_task(target, t, &base_addr);
 			retval = insert_into_threadlist(target, t);
 			t->thread_info_addr = 0xdeadbeef;
 
@@ -1004,7 +1037,6 @@ static int linux_task_update(struct target *target, int context)
 					cpu_context_read(target, t->base_addr,
 						&t->thread_info_addr);
 
-			base_addr = next_task(target, t);
 			t = calloc(1, sizeof(struct threads));
 			t->base_addr = base_addr;
 			linux_os->thread_count++;
@@ -12,6 +12,7 @@
 #include "rtos.h"
 #include "target/target.h"
 #include "helper/log.h"
+#include "helper/align.h"
 #include "helper/binarybuffer.h"
 #include "server/gdb_server.h"
 
@@ -35,6 +36,7 @@ static const struct rtos_type *rtos_types[] = {
 };
 
 static int rtos_try_next(struct target *target);
+static void rtos_call_update_threads(struct rtos *rtos);
 
 int rtos_smp_init(struct target *target)
 {
@@ -72,6 +74,60 @@ static int os_alloc(struct target *target, const struct rtos_type *ostype)
 	return JIM_OK;
 }
 
+static bool rtos_thread_regs_cached(const struct rtos *rtos, const struct rtos_reg *reg_list)
+{
+	for (unsigned int i = 0; i < rtos->thread_regs_count; i++)
+		if (rtos->thread_regs[i].reg_list == reg_list)
+			return true;
+	return false;
+}
+
+static void rtos_free_thread_regs(struct rtos *rtos)
+{
+	for (unsigned int i = 0; i < rtos->thread_regs_count; i++)
+		free(rtos->thread_regs[i].reg_list);
+	free(rtos->thread_regs);
+	rtos->thread_regs = NULL;
+	rtos->thread_regs_count = 0;
+}
+
+/* Get the registers of a thread, reading the saved frame only the first
+ * time. The list belongs to the cache, it must not be freed. */
+static int rtos_get_thread_regs(struct rtos *rtos, threadid_t threadid,
+		struct rtos_reg **reg_list, int *num_regs)
+{
+	for (unsigned int i = 0; i < rtos->thread_regs_count; i++) {
+		if (rtos->thread_regs[i].threadid == threadid) {
+			*reg_list = rtos->thread_regs[i].reg_list;
+			*num_regs = rtos->thread_regs[i].num_regs;
+			return ERROR_OK;
+		}
+	}
+
+	struct rtos_thread_regs *thread_regs = realloc(rtos->thread_regs,
+			(rtos->thread_regs_count + 1) * sizeof(*thread_regs));
+	if (!thread_regs) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	rtos->thread_regs = thread_regs;
+
+	int retval = rtos->type->get_thread_reg_list(rtos, threadid, reg_list, num_regs);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* in smp the registers of the current threads are live, do not keep them */
+	if (rtos->target->smp)
+		return ERROR_OK;
+
+	thread_regs[rtos->thread_regs_count].threadid = threadid;
+	thread_regs[rtos->thread_regs_count].reg_list = *reg_list;
+	thread_regs[rtos->thread_regs_count].num_regs = *num_regs;
+	rtos->thread_regs_count++;
+
+	return ERROR_OK;
+}
+
 static void os_free(struct target *target)
 {
 	if (!target->rtos)
@@ -79,6 +135,7 @@ static void os_free(struct target *target)
 
 	free(target->rtos->symbols);
 	rtos_free_threadlist(target->rtos);
+	rtos_free_thread_regs(target->rtos);
 	free(target->rtos);
 	target->rtos = NULL;
 }
@@ -166,7 +223,8 @@ static struct symbol_table_elem *find_symbol(const struct rtos *os, const char *
 	return NULL;
 }
 
-static struct symbol_table_elem *next_symbol(struct rtos *os, char *cur_symbol, uint64_t cur_addr)
+static struct symbol_table_elem *next_symbol(struct rtos *os, char *cur_symbol, uint64_t cur_addr,
+		bool cur_lto_priv)
 {
 	if (!os->symbols)
 		os->type->get_symbol_list_to_lookup(&os->symbols);
@@ -179,6 +237,8 @@ static struct symbol_table_elem *next_symbol(struct rtos *os, char *cur_symbol,
 		return NULL;
 
 	s->address = cur_addr;
+	if (cur_addr)
+		s->lto_priv = cur_lto_priv;
 	s++;
 	return s;
 }
@@ -205,6 +265,8 @@ static struct symbol_table_elem *next_symbol(struct rtos *os, char *cur_symbol,
  * with ".lto_priv.0" appended to it.  We only consider the first static
  * symbol here from the -flto case.  (Each subsequent static symbol with
  * the same name is exported as .lto_priv.1, .lto_priv.2, etc.)
+ * A symbol found with the suffix is asked with it first on the next lookup,
+ * e.g. when GDB reconnects, to save a round trip per static symbol.
  *
  * rtos_qsymbol() returns 1 if an RTOS has been detected, or 0 otherwise.
  */
@@ -232,18 +294,18 @@ int rtos_qsymbol(struct connection *connection, char const *packet, int packet_s
 	const size_t lto_suffix_len = strlen(lto_suffix);
 
 	const char *cur_suffix;
-	const char *next_suffix;
+	const char *next_suffix = NULL;
+	bool cur_lto_priv;
 
-	/* Detect what suffix was used during the previous symbol lookup attempt, and
-	 * speculatively determine the next suffix (only used for the unknown address case) */
+	/* Detect what suffix was used during the previous symbol lookup attempt */
 	if (len > lto_suffix_len && !strcmp(cur_sym + len - lto_suffix_len, lto_suffix)) {
 		/* Trim the suffix from cur_sym for comparison purposes below */
 		cur_sym[len - lto_suffix_len] = '\0';
 		cur_suffix = lto_suffix;
-		next_suffix = NULL;
+		cur_lto_priv = true;
 	} else {
 		cur_suffix = no_suffix;
-		next_suffix = lto_suffix;
+		cur_lto_priv = false;
 	}
 
 	if ((strcmp(packet, "qSymbol::") != 0) &&               /* GDB is not offering symbol lookup for the first time */
@@ -252,8 +314,10 @@ int rtos_qsymbol(struct connection *connection, char const *packet, int packet_s
 		/* GDB could not find an address for the previous symbol */
 		struct symbol_table_elem *sym = find_symbol(os, cur_sym);
 
-		if (next_suffix) {
+		if (sym && sym->lto_priv == cur_lto_priv) {
+			/* first attempt failed, try with the other suffix */
 			next_sym = sym;
+			next_suffix = cur_lto_priv ? no_suffix : lto_suffix;
 		} else if (sym && !sym->optional) {	/* the symbol is mandatory for this RTOS */
 			if (!target->rtos_auto_detect) {
 				LOG_WARNING("RTOS %s not detected. (GDB could not find symbol \'%s\')", os->type->name, cur_sym);
@@ -274,14 +338,15 @@ int rtos_qsymbol(struct connection *connection, char const *packet, int packet_s
 	LOG_DEBUG("RTOS: Address of symbol '%s%s' is 0x%" PRIx64, cur_sym, cur_suffix, addr);
 
 	if (!next_sym) {
-		next_sym = next_symbol(os, cur_sym, addr);
-		next_suffix = no_suffix;
-	}
+		next_sym = next_symbol(os, cur_sym, addr, cur_lto_priv);
 
-	/* Should never happen unless the debugger misbehaves */
-	if (!next_sym) {
-		LOG_WARNING("RTOS: Debugger sent us qSymbol with '%s%s' that we did not ask for", cur_sym, cur_suffix);
-		goto done;
+		/* Should never happen unless the debugger misbehaves */
+		if (!next_sym) {
+			LOG_WARNING("RTOS: Debugger sent us qSymbol with '%s%s' that we did not ask for", cur_sym, cur_suffix);
+			goto done;
+		}
+
+		next_suffix = next_sym->lto_priv ? lto_suffix : no_suffix;
 	}
 
 	if (!next_sym->symbol_name) {
@@ -393,7 +458,7 @@ int rtos_thread_packet(struct connection *connection, char const *packet, int pa
 				target->rtos_auto_detect = false;
 				target->rtos->type->create(target);
 			}
-			target->rtos->type->update_threads(target->rtos);
+			rtos_call_update_threads(target->rtos);
 		}
 		return ERROR_OK;
 	} else if (strncmp(packet, "qfThreadInfo", 12) == 0) {
@@ -528,7 +593,7 @@ int rtos_get_gdb_reg(struct connection *connection, int reg_num)
 				return retval;
 			}
 		} else {
-			retval = target->rtos->type->get_thread_reg_list(target->rtos,
+			retval = rtos_get_thread_regs(target->rtos,
 					current_threadid,
 					&reg_list,
 					&num_regs);
@@ -538,15 +603,18 @@ int rtos_get_gdb_reg(struct connection *connection, int reg_num)
 			}
 		}
 
+		retval = ERROR_FAIL;
 		for (int i = 0; i < num_regs; ++i) {
 			if (reg_list[i].number == (uint32_t)reg_num) {
 				rtos_put_gdb_reg_list(connection, reg_list + i, 1);
-				free(reg_list);
-				return ERROR_OK;
+				retval = ERROR_OK;
+				break;
 			}
 		}
 
-		free(reg_list);
+		if (!rtos_thread_regs_cached(target->rtos, reg_list))
+			free(reg_list);
+		return retval;
 	}
 	return ERROR_FAIL;
 }
@@ -568,7 +636,7 @@ int rtos_get_gdb_reg_list(struct connection *connection)
 										current_threadid,
 										target->rtos->current_thread);
 
-		int retval = target->rtos->type->get_thread_reg_list(target->rtos,
+		int retval = rtos_get_thread_regs(target->rtos,
 				current_threadid,
 				&reg_list,
 				&num_regs);
@@ -578,7 +646,8 @@ int rtos_get_gdb_reg_list(struct connection *connection)
 		}
 
 		rtos_put_gdb_reg_list(connection, reg_list, num_regs);
-		free(reg_list);
+		if (!rtos_thread_regs_cached(target->rtos, reg_list))
+			free(reg_list);
 
 		return ERROR_OK;
 	}
@@ -590,6 +659,7 @@ int rtos_set_reg(struct connection *connection, int reg_num,
 {
 	struct target *target = get_target_from_connection(connection);
 	int64_t current_threadid = target->rtos->current_threadid;
+	rtos_free_thread_regs(target->rtos);
 	if ((target->rtos) &&
 			(target->rtos->type->set_reg) &&
 			(current_threadid != -1) &&
@@ -685,10 +755,54 @@ static int rtos_try_next(struct target *target)
 	return 1;
 }
 
+static uint32_t rtos_hash(uint32_t hash, const void *data, size_t len)
+{
+	const uint8_t *p = data;
+
+	/* FNV-1a */
+	for (size_t i = 0; i < len; i++)
+		hash = (hash ^ p[i]) * 16777619u;
+	return hash;
+}
+
+static uint32_t rtos_thread_list_hash(const struct rtos *rtos)
+{
+	uint32_t hash = rtos_hash(2166136261u, &rtos->thread_count, sizeof(rtos->thread_count));
+
+	for (int i = 0; i < rtos->thread_count; i++) {
+		const struct thread_detail *thread = &rtos->thread_details[i];
+
+		hash = rtos_hash(hash, &thread->threadid, sizeof(thread->threadid));
+		hash = rtos_hash(hash, &thread->exists, sizeof(thread->exists));
+		/* include the terminator, it separates the two strings */
+		if (thread->thread_name_str)
+			hash = rtos_hash(hash, thread->thread_name_str, strlen(thread->thread_name_str) + 1);
+		hash = rtos_hash(hash, "", 1);
+		if (thread->extra_info_str)
+			hash = rtos_hash(hash, thread->extra_info_str, strlen(thread->extra_info_str) + 1);
+		hash = rtos_hash(hash, "", 1);
+	}
+
+	return hash;
+}
+
+static void rtos_call_update_threads(struct rtos *rtos)
+{
+	rtos->type->update_threads(rtos);
+
+	uint32_t hash = rtos_thread_list_hash(rtos);
+	if (hash != rtos->thread_list_hash) {
+		rtos->thread_list_hash = hash;
+		rtos->thread_list_version++;
+	}
+}
+
 int rtos_update_threads(struct target *target)
 {
+	if (target->rtos)
+		rtos_free_thread_regs(target->rtos);
 	if ((target->rtos) && (target->rtos->type))
-		target->rtos->type->update_threads(target->rtos);
+		rtos_call_update_threads(target->rtos);
 	return ERROR_OK;
 }
 
@@ -721,7 +835,414 @@ int rtos_read_buffer(struct target *target, target_addr_t address,
 int rtos_write_buffer(struct target *target, target_addr_t address,
 		uint32_t size, const uint8_t *buffer)
 {
+	/* the write may hit a saved frame */
+	rtos_free_thread_regs(target->rtos);
 	if (target->rtos->type->write_buffer)
 		return target->rtos->type->write_buffer(target->rtos, address, size, buffer);
 	return ERROR_NOT_IMPLEMENTED;
 }
+
+/* Largest span of a structure fetched with one access by rtos_read_struct() */
+#define RTOS_STRUCT_MAX_SPAN 256
+
+/**
+ * Read some fields of a kernel structure. When the fields are close enough,
+ * the span from the first to the last field is fetched with a single memory
+ * access instead of one access per field. The values are returned in host
+ * order, in the order of @a fields.
+ */
+int rtos_read_struct(struct target *target, target_addr_t address,
+		const struct rtos_struct_field *fields, unsigned int num_fields,
+		uint64_t *values)
+{
+	uint8_t buf[RTOS_STRUCT_MAX_SPAN];
+	unsigned int start = UINT32_MAX;
+	unsigned int end = 0;
+
+	if (num_fields == 0)
+		return ERROR_OK;
+
+	for (unsigned int i = 0; i < num_fields; i++) {
+		start = MIN(start, fields[i].offset);
+		end = MAX(end, (unsigned int)fields[i].offset + fields[i].size);
+	}
+
+	bool single = end - start <= RTOS_STRUCT_MAX_SPAN;
+	if (single) {
+		int retval = target_read_buffer(target, address + start, end - start, buf);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	for (unsigned int i = 0; i < num_fields; i++) {
+		const uint8_t *field;
+
+		if (single) {
+			field = buf + fields[i].offset - start;
+		} else {
+			int retval = target_read_buffer(target, address + fields[i].offset,
+					fields[i].size, buf);
+			if (retval != ERROR_OK)
+				return retval;
+			field = buf;
+		}
+
+		switch (fields[i].size) {
+		case 1:
+			values[i] = *field;
+			break;
+		case 2:
+			values[i] = target_buffer_get_u16(target, field);
+			break;
+		case 4:
+			values[i] = target_buffer_get_u32(target, field);
+			break;
+		case 8:
+			values[i] = target_buffer_get_u64(target, field);
+			break;
+		default:
+			LOG_ERROR("Unsupported RTOS structure field size %u", fields[i].size);
+			return ERROR_FAIL;
+		}
+	}
+
+	return ERROR_OK;
+}
+
+/**
+ * Walk a linked list of kernel structures, reading the fields described by
+ * @a layout of each node with rtos_read_struct(). The walk stops on a NULL
+ * next pointer, when the list loops back to the first node or to the same
+ * node, after @a max_nodes nodes or when @a node_cb fails.
+ */
+int rtos_walk_list(struct rtos *rtos, target_addr_t first,
+		const struct rtos_list_layout *layout, unsigned int max_nodes,
+		rtos_list_node_cb node_cb, void *priv)
+{
+	uint64_t *values = malloc(layout->num_fields * sizeof(*values));
+	if (!values) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	int retval = ERROR_OK;
+	target_addr_t node = first;
+	for (unsigned int n = 0; node != 0 && n < max_nodes; n++) {
+		retval = rtos_read_struct(rtos->target, node, layout->fields,
+				layout->num_fields, values);
+		if (retval != ERROR_OK)
+			break;
+
+		retval = node_cb(rtos, node, values, priv);
+		if (retval != ERROR_OK)
+			break;
+
+		target_addr_t next = values[layout->next_field];
+		if (next == first || next == node)
+			break;
+		node = next;
+	}
+
+	free(values);
+	return retval;
+}
+
+/* Thread table maintained by the firmware,
+ * see contrib/rtos-helpers/openocd-thread-table.h */
+#define RTOS_THREAD_TABLE_MAGIC			0x5454434f
+#define RTOS_THREAD_TABLE_HEADER_SIZE	16
+#define RTOS_THREAD_TABLE_ENTRY_SIZE	12
+#define RTOS_THREAD_TABLE_MAX_THREADS	1024
+#define RTOS_THREAD_TABLE_NAME_SIZE		32
+
+static char *rtos_thread_table_name(struct rtos *rtos, struct thread_detail *old_threads,
+		int old_count, threadid_t threadid, target_addr_t name_ptr)
+{
+	/* the name of a thread already known does not change */
+	for (int i = 0; i < old_count; i++) {
+		if (old_threads[i].threadid == threadid && old_threads[i].thread_name_str) {
+			char *name = old_threads[i].thread_name_str;
+			old_threads[i].thread_name_str = NULL;
+			return name;
+		}
+	}
+
+	char tmp_str[RTOS_THREAD_TABLE_NAME_SIZE] = "";
+	if (name_ptr != 0 &&
+			target_read_buffer(rtos->target, name_ptr, sizeof(tmp_str),
+				(uint8_t *)tmp_str) != ERROR_OK)
+		tmp_str[0] = '\0';
+	tmp_str[sizeof(tmp_str) - 1] = '\0';
+
+	if (tmp_str[0] == '\0')
+		return strdup("No Name");
+	return strdup(tmp_str);
+}
+
+/**
+ * Build the thread list from a thread table maintained by the firmware,
+ * with one read for the header and one for the entries. The list is kept
+ * as is while the version of the table does not change.
+ * Returns ERROR_NOT_IMPLEMENTED when the table is not usable, the backend
+ * then walks the kernel lists.
+ */
+int rtos_thread_table_update(struct rtos *rtos, symbol_address_t table,
+		const char * const *state_names, unsigned int num_states)
+{
+	struct target *target = rtos->target;
+	uint8_t header[RTOS_THREAD_TABLE_HEADER_SIZE];
+
+	rtos->thread_table_valid = rtos->thread_table_valid && rtos->thread_details;
+	int retval = target_read_buffer(target, table, sizeof(header), header);
+	if (retval != ERROR_OK) {
+		rtos->thread_table_valid = false;
+		return retval;
+	}
+
+	uint32_t magic = target_buffer_get_u32(target, header);
+	uint32_t version = target_buffer_get_u32(target, header + 4);
+	uint32_t count = target_buffer_get_u32(target, header + 8);
+	uint32_t current = target_buffer_get_u32(target, header + 12);
+
+	if (magic != RTOS_THREAD_TABLE_MAGIC || (version & 1) ||
+			count == 0 || count > RTOS_THREAD_TABLE_MAX_THREADS) {
+		LOG_DEBUG("RTOS: thread table not usable, magic 0x%" PRIx32 " version %" PRIu32
+				" count %" PRIu32, magic, version, count);
+		rtos->thread_table_valid = false;
+		return ERROR_NOT_IMPLEMENTED;
+	}
+
+	if (rtos->thread_table_valid && version == rtos->thread_table_version) {
+		rtos->current_threadid = -1;
+		rtos->current_thread = current;
+		return ERROR_OK;
+	}
+
+	uint8_t *entries = malloc(count * RTOS_THREAD_TABLE_ENTRY_SIZE);
+	struct thread_detail *details = calloc(count, sizeof(*details));
+	if (!entries || !details) {
+		LOG_ERROR("Out of memory");
+		free(entries);
+		free(details);
+		return ERROR_FAIL;
+	}
+
+	retval = target_read_buffer(target, table + RTOS_THREAD_TABLE_HEADER_SIZE,
+			count * RTOS_THREAD_TABLE_ENTRY_SIZE, entries);
+	if (retval == ERROR_OK) {
+		/* the firmware changed the table while it was read */
+		uint8_t version_buf[4];
+		retval = target_read_buffer(target, table + 4, sizeof(version_buf), version_buf);
+		if (retval == ERROR_OK && target_buffer_get_u32(target, version_buf) != version)
+			retval = ERROR_NOT_IMPLEMENTED;
+	}
+	if (retval != ERROR_OK) {
+		free(entries);
+		free(details);
+		rtos->thread_table_valid = false;
+		return retval;
+	}
+
+	struct thread_detail *old_threads = rtos->thread_details;
+	int old_count = rtos->thread_count;
+	int found = 0;
+
+	for (uint32_t i = 0; i < count; i++) {
+		const uint8_t *entry = entries + i * RTOS_THREAD_TABLE_ENTRY_SIZE;
+		uint32_t id = target_buffer_get_u32(target, entry);
+		uint32_t state = target_buffer_get_u32(target, entry + 4);
+		uint32_t name_ptr = target_buffer_get_u32(target, entry + 8);
+
+		if (id == 0)
+			continue;
+
+		struct thread_detail *detail = &details[found++];
+		detail->threadid = id;
+		detail->exists = true;
+		detail->thread_name_str = rtos_thread_table_name(rtos, old_threads, old_count,
+				id, name_ptr);
+		if (state < num_states)
+			detail->extra_info_str = alloc_printf("State: %s", state_names[state]);
+		else
+			detail->extra_info_str = alloc_printf("State: %" PRIu32, state);
+	}
+	free(entries);
+
+	rtos_free_threadlist(rtos);
+	rtos->thread_details = details;
+	rtos->thread_count = found;
+	rtos->current_threadid = -1;
+	rtos->current_thread = current;
+	rtos->thread_table_valid = true;
+	rtos->thread_table_version = version;
+
+	return ERROR_OK;
+}
+
+/* Fill pattern search in a stack, in words from its base */
+struct rtos_stack_scan {
+	target_addr_t base;
+	uint32_t lo;	/* the first lo words hold the fill pattern */
+	uint32_t hi;	/* the fill pattern cannot go past hi words */
+	uint8_t fill;
+};
+
+static int rtos_stack_scan_host(struct target *target, struct rtos_stack_scan *scan)
+{
+	uint8_t buf[256];
+	uint32_t fill_word = scan->fill * 0x01010101u;
+
+	while (scan->lo < scan->hi) {
+		uint32_t words = MIN(scan->hi - scan->lo, (uint32_t)(sizeof(buf) / 4));
+		int retval = target_read_buffer(target, scan->base + scan->lo * 4, words * 4, buf);
+		if (retval != ERROR_OK)
+			return retval;
+
+		for (uint32_t i = 0; i < words; i++) {
+			if (target_buffer_get_u32(target, buf + i * 4) != fill_word) {
+				scan->hi = scan->lo;
+				return ERROR_OK;
+			}
+			scan->lo++;
+		}
+	}
+
+	return ERROR_OK;
+}
+
+/*
+ * Search the fill patterns of all the stacks at once: each round halves the
+ * unknown part of every stack, checking it with one run of the target blank
+ * check algorithm for all of them. Returns ERROR_NOT_IMPLEMENTED when the
+ * target has no such algorithm or no working area.
+ */
+static int rtos_stack_scan_target(struct target *target, struct rtos_stack_scan *scans,
+		unsigned int num_scans)
+{
+	struct target_memory_check_block *blocks = calloc(num_scans, sizeof(*blocks));
+	unsigned int *index = calloc(num_scans, sizeof(*index));
+	int retval = ERROR_OK;
+
+	if (!blocks || !index) {
+		LOG_ERROR("Out of memory");
+		free(blocks);
+		free(index);
+		return ERROR_FAIL;
+	}
+
+	while (retval == ERROR_OK) {
+		unsigned int num_blocks = 0;
+		for (unsigned int i = 0; i < num_scans; i++) {
+			struct rtos_stack_scan *scan = &scans[i];
+			if (scan->lo >= scan->hi)
+				continue;
+			uint32_t mid = scan->lo + (scan->hi - scan->lo + 1) / 2;
+			blocks[num_blocks].address = scan->base + scan->lo * 4;
+			blocks[num_blocks].size = (mid - scan->lo) * 4;
+			blocks[num_blocks].result = UINT32_MAX;
+			index[num_blocks++] = i;
+		}
+		if (num_blocks == 0)
+			break;
+
+		/* one call per run of blocks with the same fill byte */
+		for (unsigned int done = 0; done < num_blocks; ) {
+			unsigned int n = 1;
+			while (done + n < num_blocks &&
+					scans[index[done + n]].fill == scans[index[done]].fill)
+				n++;
+
+			int checked = target_blank_check_memory(target, blocks + done, n,
+					scans[index[done]].fill);
+			if (checked < 1) {
+				retval = ERROR_NOT_IMPLEMENTED;
+				break;
+			}
+			done += checked;
+		}
+		if (retval != ERROR_OK)
+			break;
+
+		for (unsigned int k = 0; k < num_blocks; k++) {
+			struct rtos_stack_scan *scan = &scans[index[k]];
+			uint32_t mid = scan->lo + (scan->hi - scan->lo + 1) / 2;
+			if (blocks[k].result == 1)
+				scan->lo = mid;
+			else
+				scan->hi = mid - 1;
+		}
+	}
+
+	free(blocks);
+	free(index);
+	return retval;
+}
+
+/**
+ * Report the part of each thread stack that was never used, i.e. that
+ * still holds the fill pattern from its base.
+ */
+int rtos_stack_usage(struct command_invocation *cmd, struct target *target)
+{
+	struct rtos *rtos = target->rtos;
+
+	if (!rtos || !rtos->type || !rtos->type->get_thread_stack) {
+		command_print(cmd, "The RTOS does not report the thread stacks");
+		return ERROR_FAIL;
+	}
+
+	if (!rtos->thread_details || rtos->thread_count == 0) {
+		command_print(cmd, "No thread");
+		return ERROR_OK;
+	}
+
+	struct rtos_stack_scan *scans = calloc(rtos->thread_count, sizeof(*scans));
+	bool *known = calloc(rtos->thread_count, sizeof(*known));
+	if (!scans || !known) {
+		LOG_ERROR("Out of memory");
+		free(scans);
+		free(known);
+		return ERROR_FAIL;
+	}
+
+	for (int i = 0; i < rtos->thread_count; i++) {
+		struct rtos_stack_region region;
+		if (rtos->type->get_thread_stack(rtos, rtos->thread_details[i].threadid,
+				&region) != ERROR_OK)
+			continue;
+
+		/* the algorithm checks words */
+		target_addr_t base = ALIGN_UP(region.base, 4);
+		if (region.base + region.size < base)
+			continue;
+		scans[i].base = base;
+		scans[i].hi = (region.base + region.size - base) / 4;
+		scans[i].fill = region.fill;
+		known[i] = true;
+	}
+
+	int retval = rtos_stack_scan_target(target, scans, rtos->thread_count);
+	if (retval == ERROR_NOT_IMPLEMENTED) {
+		LOG_DEBUG("RTOS: scanning the stacks from the host");
+		retval = ERROR_OK;
+		for (int i = 0; i < rtos->thread_count && retval == ERROR_OK; i++)
+			retval = rtos_stack_scan_host(target, &scans[i]);
+	}
+
+	if (retval == ERROR_OK) {
+		for (int i = 0; i < rtos->thread_count; i++) {
+			const struct thread_detail *detail = &rtos->thread_details[i];
+			const char *name = detail->thread_name_str ? detail->thread_name_str : "";
+			if (known[i])
+				command_print(cmd, "0x%08" PRIx64 " %-24s %" PRIu32 " bytes never used",
+						detail->threadid, name, scans[i].lo * 4);
+			else
+				command_print(cmd, "0x%08" PRIx64 " %-24s unknown",
+						detail->threadid, name);
+		}
+	}
+
+	free(scans);
+	free(known);
+	return retval;
+}
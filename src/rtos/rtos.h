@@ -24,6 +24,8 @@ struct symbol_table_elem {
 	const char *symbol_name;
 	symbol_address_t address;
 	bool optional;
+	/* found with the ".lto_priv.0" suffix, asked that way first next time */
+	bool lto_priv;
 };
 
 struct thread_detail {
@@ -33,6 +35,13 @@ struct thread_detail {
 	char *extra_info_str;
 };
 
+/* Registers of a thread, as returned by get_thread_reg_list() */
+struct rtos_thread_regs {
+	threadid_t threadid;
+	struct rtos_reg *reg_list;
+	int num_regs;
+};
+
 struct rtos {
 	const struct rtos_type *type;
 
@@ -45,6 +54,18 @@ struct rtos {
 	threadid_t current_thread;
 	struct thread_detail *thread_details;
 	int thread_count;
+	/* Incremented by rtos_update_threads() when the thread list changed,
+	 * lets the gdb server reuse its serialized copy of the list */
+	unsigned int thread_list_version;
+	uint32_t thread_list_hash;
+	/* Registers of the threads read since the last update of the thread
+	 * list, the saved frames do not change while the target is halted */
+	struct rtos_thread_regs *thread_regs;
+	unsigned int thread_regs_count;
+	/* Version of the firmware thread table the thread list was built
+	 * from, see rtos_thread_table_update() */
+	bool thread_table_valid;
+	uint32_t thread_table_version;
 	int (*gdb_thread_packet)(struct connection *connection, char const *packet, int packet_size);
 	int (*gdb_target_for_threadid)(struct connection *connection, int64_t thread_id, struct target **p_target);
 	void *rtos_specific_params;
@@ -56,6 +77,13 @@ struct rtos_reg {
 	uint8_t value[16];
 };
 
+/* The part of a thread stack that can still hold the fill pattern */
+struct rtos_stack_region {
+	target_addr_t base;			/* lowest address of the stack */
+	uint32_t size;				/* bytes from base, e.g. to the saved stack pointer */
+	uint8_t fill;				/* byte the RTOS fills a new stack with */
+};
+
 struct rtos_type {
 	const char *name;
 	bool (*detect_rtos)(struct target *target);
@@ -70,6 +98,9 @@ struct rtos_type {
 	int (*get_symbol_list_to_lookup)(struct symbol_table_elem *symbol_list[]);
 	int (*clean)(struct target *target);
 	char * (*ps_command)(struct target *target);
+	/** Optional, the stack of a thread, for rtos_stack_usage(). */
+	int (*get_thread_stack)(struct rtos *rtos, threadid_t thread_id,
+			struct rtos_stack_region *region);
 	int (*set_reg)(struct rtos *rtos, uint32_t reg_num, uint8_t *reg_value);
 	/* Implement these if different threads in the RTOS can see memory
 	 * differently (for instance because address translation might be different
@@ -111,6 +142,24 @@ struct rtos_register_stacking {
 		uint8_t *stack_data);
 };
 
+/* A field of a kernel structure, read by rtos_read_struct() */
+struct rtos_struct_field {
+	unsigned short offset;		/* offset in bytes from the start of the structure */
+	unsigned char size;			/* 1, 2, 4 or 8 bytes */
+};
+
+/* A linked list of kernel structures, walked by rtos_walk_list() */
+struct rtos_list_layout {
+	const struct rtos_struct_field *fields;
+	unsigned int num_fields;
+	/* index in fields of the pointer to the next node */
+	unsigned int next_field;
+};
+
+/* Called by rtos_walk_list() for each node, with the values of the fields */
+typedef int (*rtos_list_node_cb)(struct rtos *rtos, target_addr_t node,
+		const uint64_t *values, void *priv);
+
 #define GDB_THREAD_PACKET_NOT_CONSUMED (-40)
 
 int rtos_create(struct jim_getopt_info *goi, struct target *target);
@@ -135,6 +184,15 @@ int rtos_read_buffer(struct target *target, target_addr_t address,
 		uint32_t size, uint8_t *buffer);
 int rtos_write_buffer(struct target *target, target_addr_t address,
 		uint32_t size, const uint8_t *buffer);
+int rtos_read_struct(struct target *target, target_addr_t address,
+		const struct rtos_struct_field *fields, unsigned int num_fields,
+		uint64_t *values);
+int rtos_walk_list(struct rtos *rtos, target_addr_t first,
+		const struct rtos_list_layout *layout, unsigned int max_nodes,
+		rtos_list_node_cb node_cb, void *priv);
+int rtos_thread_table_update(struct rtos *rtos, symbol_address_t table,
+		const char * const *state_names, unsigned int num_states);
+int rtos_stack_usage(struct command_invocation *cmd, struct target *target);
 
 extern const struct rtos_type chibios_rtos;
 extern const struct rtos_type chromium_ec_rtos;
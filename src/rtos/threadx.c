@@ -28,6 +28,8 @@ static int threadx_create(struct target *target);
 static int threadx_update_threads(struct rtos *rtos);
 static int threadx_get_thread_reg_list(struct rtos *rtos, int64_t thread_id, struct rtos_reg **reg_list, int *num_regs);
 static int threadx_get_symbol_list_to_lookup(struct symbol_table_elem *symbol_list[]);
+static int threadx_get_thread_stack(struct rtos *rtos, threadid_t thread_id,
+		struct rtos_stack_region *region);
 
 
 
@@ -198,6 +200,7 @@ const struct rtos_type threadx_rtos = {
 	.update_threads = threadx_update_threads,
 	.get_thread_reg_list = threadx_get_thread_reg_list,
 	.get_symbol_list_to_lookup = threadx_get_symbol_list_to_lookup,
+	.get_thread_stack = threadx_get_thread_stack,
 };
 
 static const struct rtos_register_stacking *get_stacking_info(const struct rtos *rtos, int64_t stack_ptr)
@@ -254,6 +257,76 @@ static int is_thread_id_valid_arm926ejs(const struct rtos *rtos, int64_t thread_
 	return (thread_id != 0 && thread_id != 1);
 }
 
+enum threadx_thread_fields {
+	THREADX_FIELD_NAME,
+	THREADX_FIELD_STATE,
+	THREADX_FIELD_NEXT,
+};
+
+static int threadx_add_thread(struct rtos *rtos, target_addr_t thread_ptr,
+		const uint64_t *values, void *priv)
+{
+	int *tasks_found = priv;
+	struct thread_detail *detail = &rtos->thread_details[*tasks_found];
+	int retval;
+
+	#define THREADX_THREAD_NAME_STR_SIZE (200)
+	char tmp_str[THREADX_THREAD_NAME_STR_SIZE];
+	unsigned int i = 0;
+	target_addr_t name_ptr = values[THREADX_FIELD_NAME];
+
+	/* Save the thread pointer */
+	detail->threadid = thread_ptr;
+
+	/* Read the thread name */
+	tmp_str[0] = '\x00';
+
+	/* Check if thread has a valid name */
+	if (name_ptr != 0) {
+		retval =
+			target_read_buffer(rtos->target,
+				name_ptr,
+				THREADX_THREAD_NAME_STR_SIZE,
+				(uint8_t *)&tmp_str);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("Error reading thread name from ThreadX target");
+			return retval;
+		}
+		tmp_str[THREADX_THREAD_NAME_STR_SIZE - 1] = '\x00';
+	}
+
+	if (tmp_str[0] == '\x00')
+		strcpy(tmp_str, "No Name");
+
+	detail->thread_name_str = malloc(strlen(tmp_str)+1);
+	strcpy(detail->thread_name_str, tmp_str);
+
+	/* The thread status */
+	int64_t thread_status = values[THREADX_FIELD_STATE];
+
+	for (i = 0; (i < THREADX_NUM_STATES) &&
+			(threadx_thread_states[i].value != thread_status); i++) {
+		/* empty */
+	}
+
+	const char *state_desc;
+	if  (i < THREADX_NUM_STATES)
+		state_desc = threadx_thread_states[i].desc;
+	else
+		state_desc = "Unknown state";
+
+	detail->extra_info_str = malloc(strlen(state_desc)+8);
+	sprintf(detail->extra_info_str, "State: %s", state_desc);
+
+	detail->exists = true;
+
+	(*tasks_found)++;
+	/* keep the list consistent if a later read fails */
+	rtos->thread_count = *tasks_found;
+
+	return ERROR_OK;
+}
+
 static int threadx_update_threads(struct rtos *rtos)
 {
 	int retval;
@@ -346,94 +419,21 @@ static int threadx_update_threads(struct rtos *rtos)
 		return retval;
 	}
 
-	/* loop over all threads */
-	int64_t prev_thread_ptr = 0;
-	while ((thread_ptr != prev_thread_ptr) && (tasks_found < thread_list_size)) {
-
-		#define THREADX_THREAD_NAME_STR_SIZE (200)
-		char tmp_str[THREADX_THREAD_NAME_STR_SIZE];
-		unsigned int i = 0;
-		int64_t name_ptr = 0;
-
-		/* Save the thread pointer */
-		rtos->thread_details[tasks_found].threadid = thread_ptr;
-
-		/* read the name pointer */
-		retval = target_read_buffer(rtos->target,
-				thread_ptr + param->thread_name_offset,
-				param->pointer_width,
-				(uint8_t *)&name_ptr);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Could not read ThreadX thread name pointer from target");
-			return retval;
-		}
-
-		/* Read the thread name */
-		tmp_str[0] = '\x00';
-
-		/* Check if thread has a valid name */
-		if (name_ptr != 0) {
-			retval =
-				target_read_buffer(rtos->target,
-					name_ptr,
-					THREADX_THREAD_NAME_STR_SIZE,
-					(uint8_t *)&tmp_str);
-			if (retval != ERROR_OK) {
-				LOG_ERROR("Error reading thread name from ThreadX target");
-				return retval;
-			}
-			tmp_str[THREADX_THREAD_NAME_STR_SIZE - 1] = '\x00';
-		}
-
-		if (tmp_str[0] == '\x00')
-			strcpy(tmp_str, "No Name");
-
-		rtos->thread_details[tasks_found].thread_name_str =
-			malloc(strlen(tmp_str)+1);
-		strcpy(rtos->thread_details[tasks_found].thread_name_str, tmp_str);
-
-		/* Read the thread status */
-		int64_t thread_status = 0;
-		retval = target_read_buffer(rtos->target,
-				thread_ptr + param->thread_state_offset,
-				4,
-				(uint8_t *)&thread_status);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading thread state from ThreadX target");
-			return retval;
-		}
-
-		for (i = 0; (i < THREADX_NUM_STATES) &&
-				(threadx_thread_states[i].value != thread_status); i++) {
-			/* empty */
-		}
-
-		const char *state_desc;
-		if  (i < THREADX_NUM_STATES)
-			state_desc = threadx_thread_states[i].desc;
-		else
-			state_desc = "Unknown state";
-
-		rtos->thread_details[tasks_found].extra_info_str = malloc(strlen(
-					state_desc)+8);
-		sprintf(rtos->thread_details[tasks_found].extra_info_str, "State: %s", state_desc);
-
-		rtos->thread_details[tasks_found].exists = true;
-
-		tasks_found++;
-		prev_thread_ptr = thread_ptr;
-
-		/* Get the location of the next thread structure. */
-		thread_ptr = 0;
-		retval = target_read_buffer(rtos->target,
-				prev_thread_ptr + param->thread_next_offset,
-				param->pointer_width,
-				(uint8_t *) &thread_ptr);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Error reading next thread pointer in ThreadX thread list");
-			return retval;
-		}
-	}
+	/* loop over all threads, reading the fields of each one at once */
+	const struct rtos_struct_field fields[] = {
+		[THREADX_FIELD_NAME] = { param->thread_name_offset, param->pointer_width },
+		[THREADX_FIELD_STATE] = { param->thread_state_offset, 4 },
+		[THREADX_FIELD_NEXT] = { param->thread_next_offset, param->pointer_width },
+	};
+	const struct rtos_list_layout layout = {
+		.fields = fields,
+		.num_fields = ARRAY_SIZE(fields),
+		.next_field = THREADX_FIELD_NEXT,
+	};
+	retval = rtos_walk_list(rtos, thread_ptr, &layout, thread_list_size - tasks_found,
+			threadx_add_thread, &tasks_found);
+	if (retval != ERROR_OK)
+		return retval;
 
 	rtos->thread_count = tasks_found;
 
@@ -486,6 +486,38 @@ static int threadx_get_thread_reg_list(struct rtos *rtos, int64_t thread_id,
 	return rtos_generic_stack_read(rtos->target, stacking_info, stack_ptr, reg_list, num_regs);
 }
 
+/* TX_STACK_FILL, unless ThreadX is built with TX_DISABLE_STACK_FILLING */
+#define THREADX_STACK_FILL_BYTE 0xef
+
+static int threadx_get_thread_stack(struct rtos *rtos, threadid_t thread_id,
+		struct rtos_stack_region *region)
+{
+	const struct threadx_params *param = rtos->rtos_specific_params;
+
+	if (!is_thread_id_valid(rtos, thread_id) || thread_id == 1)
+		return ERROR_FAIL;
+
+	/* tx_thread_stack_start follows tx_thread_stack_ptr */
+	const struct rtos_struct_field fields[] = {
+		{ param->thread_stack_offset, param->pointer_width },
+		{ param->thread_stack_offset + param->pointer_width, param->pointer_width },
+	};
+	uint64_t values[ARRAY_SIZE(fields)];
+	int retval = rtos_read_struct(rtos->target, thread_id, fields, ARRAY_SIZE(fields), values);
+	if (retval != ERROR_OK)
+		return retval;
+
+	target_addr_t stack_ptr = values[0];
+	target_addr_t stack_start = values[1];
+	if (stack_ptr < stack_start)
+		return ERROR_FAIL;
+
+	region->base = stack_start;
+	region->size = stack_ptr - stack_start;
+	region->fill = THREADX_STACK_FILL_BYTE;
+	return ERROR_OK;
+}
+
 static int threadx_get_symbol_list_to_lookup(struct symbol_table_elem *symbol_list[])
 {
 	unsigned int i;
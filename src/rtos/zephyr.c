@@ -503,57 +503,82 @@ static uint32_t zephyr_kptr(const struct rtos *rtos, enum zephyr_offsets off)
 	return rtos->symbols[ZEPHYR_VAL__KERNEL].address + params->offsets[off];
 }
 
-static int zephyr_fetch_thread(const struct rtos *rtos,
-				struct zephyr_thread *thread, uint32_t ptr)
+/* Largest part of a k_thread read with one access */
+#define ZEPHYR_THREAD_MAX_BLOCK 1024
+
+/* Size of the k_thread fields read by zephyr_fetch_thread() */
+static uint32_t zephyr_thread_field_size(enum zephyr_offsets off)
 {
-	const struct zephyr_params *param = rtos->rtos_specific_params;
-	int retval;
+	switch (off) {
+	case OFFSET_T_ENTRY:
+	case OFFSET_T_NEXT_THREAD:
+	case OFFSET_T_STACK_POINTER:
+		return 4;
+	case OFFSET_T_STATE:
+	case OFFSET_T_USER_OPTIONS:
+	case OFFSET_T_PRIO:
+		return 1;
+	case OFFSET_T_NAME:
+		return sizeof(((struct zephyr_thread *)NULL)->name) - 1;
+	default:
+		return 0;
+	}
+}
 
-	thread->ptr = ptr;
+/* Find the part of a k_thread covering all the fields read, from the
+ * offsets table, so that each thread is fetched as one block */
+static int zephyr_thread_block(const struct zephyr_params *param,
+		uint32_t *block_start, uint32_t *block_size)
+{
+	uint32_t start = UINT32_MAX;
+	uint32_t end = 0;
 
-	retval = target_read_u32(rtos->target, ptr + param->offsets[OFFSET_T_ENTRY],
-				 &thread->entry);
-	if (retval != ERROR_OK)
-		return retval;
+	for (enum zephyr_offsets off = OFFSET_T_ENTRY; off <= OFFSET_T_NAME; off++) {
+		if (param->offsets[off] == UNIMPLEMENTED)
+			continue;
+		start = MIN(start, param->offsets[off]);
+		end = MAX(end, param->offsets[off] + zephyr_thread_field_size(off));
+	}
 
-	retval = target_read_u32(rtos->target,
-				 ptr + param->offsets[OFFSET_T_NEXT_THREAD],
-				 &thread->next_ptr);
-	if (retval != ERROR_OK)
-		return retval;
+	if (start >= end || end - start > ZEPHYR_THREAD_MAX_BLOCK) {
+		LOG_ERROR("Unexpected k_thread layout in Zephyr offsets");
+		return ERROR_FAIL;
+	}
 
-	retval = target_read_u32(rtos->target,
-				 ptr + param->offsets[OFFSET_T_STACK_POINTER],
-				 &thread->stack_pointer);
-	if (retval != ERROR_OK)
-		return retval;
+	*block_start = start;
+	*block_size = end - start;
+	return ERROR_OK;
+}
 
-	retval = target_read_u8(rtos->target, ptr + param->offsets[OFFSET_T_STATE],
-				&thread->state);
-	if (retval != ERROR_OK)
-		return retval;
+static int zephyr_fetch_thread(const struct rtos *rtos,
+				struct zephyr_thread *thread, uint32_t ptr,
+				uint8_t *block, uint32_t block_start, uint32_t block_size)
+{
+	const struct zephyr_params *param = rtos->rtos_specific_params;
+	int retval;
 
-	retval = target_read_u8(rtos->target,
-				ptr + param->offsets[OFFSET_T_USER_OPTIONS],
-				&thread->user_options);
-	if (retval != ERROR_OK)
-		return retval;
+	thread->ptr = ptr;
 
-	uint8_t prio;
-	retval = target_read_u8(rtos->target,
-				ptr + param->offsets[OFFSET_T_PRIO], &prio);
+	retval = target_read_buffer(rtos->target, ptr + block_start, block_size, block);
 	if (retval != ERROR_OK)
 		return retval;
-	thread->prio = prio;
+
+	/* decode the fields on the host */
+	const uint8_t *base = block - block_start;
+	thread->entry = target_buffer_get_u32(rtos->target,
+			base + param->offsets[OFFSET_T_ENTRY]);
+	thread->next_ptr = target_buffer_get_u32(rtos->target,
+			base + param->offsets[OFFSET_T_NEXT_THREAD]);
+	thread->stack_pointer = target_buffer_get_u32(rtos->target,
+			base + param->offsets[OFFSET_T_STACK_POINTER]);
+	thread->state = base[param->offsets[OFFSET_T_STATE]];
+	thread->user_options = base[param->offsets[OFFSET_T_USER_OPTIONS]];
+	thread->prio = (int8_t)base[param->offsets[OFFSET_T_PRIO]];
 
 	thread->name[0] = '\0';
 	if (param->offsets[OFFSET_T_NAME] != UNIMPLEMENTED) {
-		retval = target_read_buffer(rtos->target,
-					ptr + param->offsets[OFFSET_T_NAME],
-					sizeof(thread->name) - 1, (uint8_t *)thread->name);
-		if (retval != ERROR_OK)
-			return retval;
-
+		memcpy(thread->name, base + param->offsets[OFFSET_T_NAME],
+				sizeof(thread->name) - 1);
 		thread->name[sizeof(thread->name) - 1] = '\0';
 	}
 
@@ -580,10 +605,21 @@ static int zephyr_fetch_thread_list(struct rtos *rtos, uint32_t current_thread)
 		return retval;
 	}
 
+	uint32_t block_start, block_size;
+	retval = zephyr_thread_block(rtos->rtos_specific_params, &block_start, &block_size);
+	if (retval != ERROR_OK)
+		return retval;
+
+	uint8_t *block = malloc(block_size);
+	if (!block) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
 	zephyr_array_init(&thread_array);
 
 	for (; curr; curr = thread.next_ptr) {
-		retval = zephyr_fetch_thread(rtos, &thread, curr);
+		retval = zephyr_fetch_thread(rtos, &thread, curr, block, block_start, block_size);
 		if (retval != ERROR_OK)
 			goto error;
 
@@ -610,6 +646,7 @@ static int zephyr_fetch_thread_list(struct rtos *rtos, uint32_t current_thread)
 
 	LOG_DEBUG("Got information for %zu threads", thread_array.elements);
 
+	free(block);
 	rtos_free_threadlist(rtos);
 
 	rtos->thread_count = (int)thread_array.elements;
@@ -628,6 +665,7 @@ error:
 	}
 
 	zephyr_array_free(&thread_array);
+	free(block);
 
 	return ERROR_FAIL;
 }
@@ -708,19 +746,21 @@ static int zephyr_update_threads(struct rtos *rtos)
 	}
 	/* We can fetch the whole array for version 0, as they're supposed
 	 * to grow only */
-	uint32_t address;
-	address  = rtos->symbols[ZEPHYR_VAL__KERNEL_OPENOCD_OFFSETS].address;
-	for (size_t i = 0; i < OFFSET_MAX; i++, address += param->size_width) {
-		if (i >= param->num_offsets) {
+	uint8_t offsets[OFFSET_MAX * 4];
+	size_t num_read = MIN(param->num_offsets, (uint32_t)OFFSET_MAX);
+	retval = target_read_buffer(rtos->target,
+			rtos->symbols[ZEPHYR_VAL__KERNEL_OPENOCD_OFFSETS].address,
+			num_read * param->size_width, offsets);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("Could not fetch offsets from Zephyr");
+		return ERROR_FAIL;
+	}
+	for (size_t i = 0; i < OFFSET_MAX; i++) {
+		if (i >= num_read)
 			param->offsets[i] = UNIMPLEMENTED;
-			continue;
-		}
-
-		retval = target_read_u32(rtos->target, address, &param->offsets[i]);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("Could not fetch offsets from Zephyr");
-			return ERROR_FAIL;
-		}
+		else
+			param->offsets[i] = target_buffer_get_u32(rtos->target,
+					offsets + i * param->size_width);
 	}
 
 	LOG_DEBUG("Zephyr OpenOCD support version %" PRId32,
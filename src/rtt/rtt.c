@@ -19,6 +19,14 @@
 
 #include "rtt.h"
 
+/* Host data a down-channel queues between two polls */
+#define RTT_DOWN_QUEUE_SIZE	4096
+
+struct rtt_down_queue {
+	uint8_t buffer[RTT_DOWN_QUEUE_SIZE];
+	size_t length;
+};
+
 static struct {
 	struct rtt_source source;
 	/** Control block. */
@@ -40,9 +48,18 @@ static struct {
 	bool found_cb;
 
 	struct rtt_sink_list **sink_list;
+	/** Polling state of the up-channels, one per sink list entry. */
+	struct rtt_channel_poll *poll;
 	size_t sink_list_length;
 
+	/** Host data waiting for the next poll, one per down-channel. */
+	struct rtt_down_queue *down_queue;
+	size_t down_queue_length;
+
+	/** Interval of the polling timer, the shortest of the channels. */
 	unsigned int polling_interval;
+	/** Polling interval of the channels without bounds of their own. */
+	unsigned int default_interval;
 } rtt;
 
 int rtt_init(void)
@@ -51,13 +68,22 @@ int rtt_init(void)
 	rtt.sink_list = calloc(rtt.sink_list_length,
 		sizeof(struct rtt_sink_list *));
 
-	if (!rtt.sink_list)
+	rtt.poll = calloc(rtt.sink_list_length, sizeof(struct rtt_channel_poll));
+
+	if (!rtt.sink_list || !rtt.poll) {
+		free(rtt.sink_list);
+		free(rtt.poll);
 		return ERROR_FAIL;
+	}
 
 	rtt.sink_list[0] = NULL;
 	rtt.started = false;
 
 	rtt.polling_interval = 100;
+	rtt.default_interval = rtt.polling_interval;
+	rtt.poll[0].min_interval = rtt.default_interval;
+	rtt.poll[0].max_interval = rtt.default_interval;
+	rtt.poll[0].interval = rtt.default_interval;
 
 	return ERROR_OK;
 }
@@ -65,16 +91,76 @@ int rtt_init(void)
 int rtt_exit(void)
 {
 	free(rtt.sink_list);
+	free(rtt.poll);
+	free(rtt.down_queue);
 
 	return ERROR_OK;
 }
 
+/* Write the data queued for the down-channels since the last poll */
+static int flush_down_queues(void)
+{
+	for (size_t i = 0; i < rtt.down_queue_length; i++) {
+		struct rtt_down_queue *queue = &rtt.down_queue[i];
+		size_t length = queue->length;
+
+		if (!length)
+			continue;
+
+		int ret = rtt.source.write(rtt.target, &rtt.ctrl, i, queue->buffer,
+			&length, NULL);
+
+		if (ret != ERROR_OK)
+			return ret;
+
+		/* keep what did not fit in the target buffer for the next poll */
+		queue->length -= length;
+		memmove(queue->buffer, queue->buffer + length, queue->length);
+	}
+
+	return ERROR_OK;
+}
+
+static int read_channel_callback(void *user_data);
+
+/* Adapt the polling interval of each channel to its last fill level */
+static void adapt_polling_interval(void)
+{
+	unsigned int interval = 0;
+
+	for (size_t i = 0; i < rtt.sink_list_length; i++) {
+		struct rtt_channel_poll *poll = &rtt.poll[i];
+
+		if (!rtt.sink_list[i])
+			continue;
+
+		if (poll->size && poll->pending > poll->size / 2)
+			poll->interval = MAX(poll->interval / 2, poll->min_interval);
+		else if (!poll->pending)
+			poll->interval = MIN(poll->interval * 2, poll->max_interval);
+
+		if (!interval || poll->interval < interval)
+			interval = poll->interval;
+	}
+
+	if (!interval || interval == rtt.polling_interval)
+		return;
+
+	LOG_DEBUG("rtt: Polling every %u ms", interval);
+	target_unregister_timer_callback(&read_channel_callback, NULL);
+	target_register_timer_callback(&read_channel_callback, interval, 1, NULL);
+	rtt.polling_interval = interval;
+}
+
 static int read_channel_callback(void *user_data)
 {
 	int ret;
 
-	ret = rtt.source.read(rtt.target, &rtt.ctrl, rtt.sink_list,
-		rtt.sink_list_length, NULL);
+	ret = flush_down_queues();
+
+	if (ret == ERROR_OK)
+		ret = rtt.source.read(rtt.target, &rtt.ctrl, rtt.sink_list, rtt.poll,
+			rtt.sink_list_length, NULL);
 
 	if (ret != ERROR_OK) {
 		target_unregister_timer_callback(&read_channel_callback, NULL);
@@ -82,6 +168,8 @@ static int read_channel_callback(void *user_data)
 		return ret;
 	}
 
+	adapt_polling_interval();
+
 	return ERROR_OK;
 }
 
@@ -94,10 +182,14 @@ int rtt_setup(target_addr_t address, size_t size, const char *id)
 		return ERROR_COMMAND_ARGUMENT_INVALID;
 	}
 
+	/* keep the control block found with the same configuration */
+	if (!rtt.configured || rtt.addr != address || rtt.size != size
+			|| strcmp(rtt.id, id) != 0)
+		rtt.changed = true;
+
 	rtt.addr = address;
 	rtt.size = size;
 	strncpy(rtt.id, id, id_length + 1);
-	rtt.changed = true;
 	rtt.configured = true;
 
 	return ERROR_OK;
@@ -129,6 +221,22 @@ int rtt_start(void)
 	if (rtt.started)
 		return ERROR_OK;
 
+	/*
+	 * The control block found before is checked first, it stays valid as
+	 * long as the same firmware runs.
+	 */
+	bool ctrl_read = false;
+
+	if (rtt.found_cb && !rtt.changed) {
+		ret = rtt.source.read_cb(rtt.target, rtt.ctrl.address, &rtt.ctrl, NULL);
+		ctrl_read = ret == ERROR_OK && strcmp(rtt.ctrl.id, rtt.id) == 0;
+
+		if (!ctrl_read) {
+			LOG_INFO("rtt: Control block moved, searching again");
+			rtt.found_cb = false;
+		}
+	}
+
 	if (!rtt.found_cb || rtt.changed) {
 		rtt.source.find_cb(rtt.target, &addr, rtt.size, rtt.id,
 			&rtt.found_cb, NULL);
@@ -145,10 +253,12 @@ int rtt_start(void)
 		}
 	}
 
-	ret = rtt.source.read_cb(rtt.target, rtt.ctrl.address, &rtt.ctrl, NULL);
+	if (!ctrl_read) {
+		ret = rtt.source.read_cb(rtt.target, rtt.ctrl.address, &rtt.ctrl, NULL);
 
-	if (ret != ERROR_OK)
-		return ret;
+		if (ret != ERROR_OK)
+			return ret;
+	}
 
 	ret = rtt.source.start(rtt.target, &rtt.ctrl, NULL);
 
@@ -174,6 +284,10 @@ int rtt_stop(void)
 	target_unregister_timer_callback(&read_channel_callback, NULL);
 	rtt.started = false;
 
+	/* the data still queued is dropped */
+	for (size_t i = 0; i < rtt.down_queue_length; i++)
+		rtt.down_queue[i].length = 0;
+
 	ret = rtt.source.stop(rtt.target, NULL);
 
 	if (ret != ERROR_OK)
@@ -185,6 +299,7 @@ int rtt_stop(void)
 static int adjust_sink_list(size_t length)
 {
 	struct rtt_sink_list **tmp;
+	struct rtt_channel_poll *tmp_poll;
 
 	if (length <= rtt.sink_list_length)
 		return ERROR_OK;
@@ -194,10 +309,23 @@ static int adjust_sink_list(size_t length)
 	if (!tmp)
 		return ERROR_FAIL;
 
-	for (size_t i = rtt.sink_list_length; i < length; i++)
+	rtt.sink_list = tmp;
+
+	tmp_poll = realloc(rtt.poll, sizeof(struct rtt_channel_poll) * length);
+
+	if (!tmp_poll)
+		return ERROR_FAIL;
+
+	rtt.poll = tmp_poll;
+
+	for (size_t i = rtt.sink_list_length; i < length; i++) {
 		tmp[i] = NULL;
+		memset(&tmp_poll[i], 0, sizeof(tmp_poll[i]));
+		tmp_poll[i].min_interval = rtt.default_interval;
+		tmp_poll[i].max_interval = rtt.default_interval;
+		tmp_poll[i].interval = rtt.default_interval;
+	}
 
-	rtt.sink_list = tmp;
 	rtt.sink_list_length = length;
 
 	return ERROR_OK;
@@ -274,27 +402,86 @@ int rtt_set_polling_interval(unsigned int interval)
 	if (!interval)
 		return ERROR_FAIL;
 
-	if (rtt.polling_interval != interval) {
+	if (rtt.polling_interval != interval && rtt.started) {
 		target_unregister_timer_callback(&read_channel_callback, NULL);
 		target_register_timer_callback(&read_channel_callback, interval, 1,
 			NULL);
 	}
 
 	rtt.polling_interval = interval;
+	rtt.default_interval = interval;
+
+	/* a fixed interval for all the channels */
+	for (size_t i = 0; i < rtt.sink_list_length; i++) {
+		rtt.poll[i].min_interval = interval;
+		rtt.poll[i].max_interval = interval;
+		rtt.poll[i].interval = interval;
+	}
+
+	return ERROR_OK;
+}
+
+int rtt_set_channel_polling_interval(unsigned int channel_index,
+		unsigned int min_interval, unsigned int max_interval)
+{
+	if (!min_interval || min_interval > max_interval)
+		return ERROR_FAIL;
+
+	if (adjust_sink_list(channel_index + 1) != ERROR_OK)
+		return ERROR_FAIL;
+
+	struct rtt_channel_poll *poll = &rtt.poll[channel_index];
+	poll->min_interval = min_interval;
+	poll->max_interval = max_interval;
+	poll->interval = MIN(MAX(poll->interval, min_interval), max_interval);
 
 	return ERROR_OK;
 }
 
+const struct rtt_channel_poll *rtt_get_channel_poll(unsigned int channel_index)
+{
+	if (channel_index >= rtt.sink_list_length)
+		return NULL;
+
+	return &rtt.poll[channel_index];
+}
+
 int rtt_write_channel(unsigned int channel_index, const uint8_t *buffer,
 		size_t *length)
 {
-	if (channel_index >= rtt.ctrl.num_up_channels) {
+	if (channel_index >= rtt.ctrl.num_down_channels) {
 		LOG_WARNING("rtt: Down-channel %u is not available", channel_index);
 		return ERROR_OK;
 	}
 
-	return rtt.source.write(rtt.target, &rtt.ctrl, channel_index, buffer,
-		length, NULL);
+	if (!rtt.started)
+		return rtt.source.write(rtt.target, &rtt.ctrl, channel_index, buffer,
+			length, NULL);
+
+	if (channel_index >= rtt.down_queue_length) {
+		struct rtt_down_queue *tmp = realloc(rtt.down_queue,
+			sizeof(struct rtt_down_queue) * rtt.ctrl.num_down_channels);
+
+		if (!tmp)
+			return ERROR_FAIL;
+
+		for (size_t i = rtt.down_queue_length; i < rtt.ctrl.num_down_channels; i++)
+			tmp[i].length = 0;
+
+		rtt.down_queue = tmp;
+		rtt.down_queue_length = rtt.ctrl.num_down_channels;
+	}
+
+	/*
+	 * Queue the data, it is written at the next poll together with what
+	 * arrives until then.
+	 */
+	struct rtt_down_queue *queue = &rtt.down_queue[channel_index];
+	*length = MIN(*length, RTT_DOWN_QUEUE_SIZE - queue->length);
+	memcpy(queue->buffer + queue->length, buffer, *length);
+	queue->length += *length;
+
+	return ERROR_OK;
 }
 
 bool rtt_configured(void)
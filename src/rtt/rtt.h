@@ -77,6 +77,24 @@ struct rtt_channel_info {
 	uint32_t flags;
 };
 
+/** RTT up-channel polling state. */
+struct rtt_channel_poll {
+	/** Lower bound of the polling interval in milliseconds. */
+	unsigned int min_interval;
+	/** Upper bound of the polling interval in milliseconds. */
+	unsigned int max_interval;
+	/** Current polling interval in milliseconds. */
+	unsigned int interval;
+	/** Buffer size in bytes, as seen at the last read. */
+	uint32_t size;
+	/** Bytes pending in the buffer at the last read. */
+	uint32_t pending;
+	/** Total number of bytes read. */
+	uint64_t bytes;
+	/** Number of reads which found the buffer full, data may be lost. */
+	unsigned int full;
+};
+
 typedef int (*rtt_sink_read)(unsigned int channel, const uint8_t *buffer,
 		size_t length, void *user_data);
 
@@ -112,7 +130,8 @@ struct rtt_source {
 	int (*stop)(struct target *target, void *user_data);
 	int (*read)(struct target *target,
 		const struct rtt_control *ctrl, struct rtt_sink_list **sinks,
-		size_t num_channels, void *user_data);
+		struct rtt_channel_poll *poll, size_t num_channels,
+		void *user_data);
 	int (*write)(struct target *target,
 		struct rtt_control *ctrl, unsigned int channel,
 		const uint8_t *buffer, size_t *length, void *user_data);
@@ -186,6 +205,32 @@ int rtt_get_polling_interval(unsigned int *interval);
  */
 int rtt_set_polling_interval(unsigned int interval);
 
+/**
+ * Set the polling interval bounds of an up-channel.
+ *
+ * The interval is halved, down to @p min_interval, when a read finds the
+ * buffer more than half full and doubled, up to @p max_interval, when it
+ * finds it empty. RTT is polled at the shortest interval of all channels.
+ *
+ * @param[in] channel_index Up-channel index.
+ * @param[in] min_interval Minimal polling interval in milliseconds.
+ * @param[in] max_interval Maximal polling interval in milliseconds.
+ *
+ * @returns ERROR_OK on success, an error code on failure.
+ */
+int rtt_set_channel_polling_interval(unsigned int channel_index,
+		unsigned int min_interval, unsigned int max_interval);
+
+/**
+ * Get the polling state of an up-channel.
+ *
+ * @param[in] channel_index Up-channel index.
+ *
+ * @returns The polling state, NULL when no sink was ever registered or no
+ *          bounds were set for the channel.
+ */
+const struct rtt_channel_poll *rtt_get_channel_poll(unsigned int channel_index);
+
 /**
  * Get whether RTT is configured.
  *
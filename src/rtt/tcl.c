@@ -103,6 +103,26 @@ COMMAND_HANDLER(handle_rtt_polling_interval_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_rtt_channel_polling_interval_command)
+{
+	unsigned int channel_index, min_interval, max_interval;
+
+	if (CMD_ARGC != 3)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], channel_index);
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], min_interval);
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[2], max_interval);
+
+	if (!min_interval || min_interval > max_interval) {
+		command_print(CMD, "Invalid polling interval bounds");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	return rtt_set_channel_polling_interval(channel_index, min_interval,
+		max_interval);
+}
+
 COMMAND_HANDLER(handle_rtt_channels_command)
 {
 	int ret;
@@ -134,8 +154,17 @@ COMMAND_HANDLER(handle_rtt_channels_command)
 		if (!info.size)
 			continue;
 
-		command_print(CMD, "%u: %s %u %u", i, info.name, info.size,
-			info.flags);
+		const struct rtt_channel_poll *poll = rtt_get_channel_poll(i);
+
+		if (!poll) {
+			command_print(CMD, "%u: %s %u %u", i, info.name, info.size,
+				info.flags);
+			continue;
+		}
+
+		command_print(CMD, "%u: %s %u %u, %" PRIu64 " bytes read, "
+			"%u times full, polled every %u ms", i, info.name, info.size,
+			info.flags, poll->bytes, poll->full, poll->interval);
 	}
 
 	command_print(CMD, "Down-channels:");
@@ -247,6 +276,13 @@ static const struct command_registration rtt_subcommand_handlers[] = {
 		.help = "show or set polling interval in ms",
 		.usage = "[interval]"
 	},
+	{
+		.name = "channel_polling_interval",
+		.handler = handle_rtt_channel_polling_interval_command,
+		.mode = COMMAND_EXEC,
+		.help = "set the polling interval bounds of an up-channel in ms",
+		.usage = "<channel> <min> <max>"
+	},
 	{
 		.name = "channels",
 		.handler = handle_rtt_channels_command,
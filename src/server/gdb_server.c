@@ -59,9 +59,11 @@ enum gdb_output_flag {
 	GDB_OUTPUT_ALL,
 };
 
-struct target_desc_format {
-	char *tdesc;
-	uint32_t tdesc_length;
+/* pending stop reply of a thread in non-stop mode */
+struct gdb_stop_notif {
+	int64_t thread_id;
+	/* signal overriding the one from the debug reason, -1 if none */
+	int signal;
 };
 
 /* private connection data for GDB */
@@ -72,6 +74,9 @@ struct gdb_connection {
 	bool ctrl_c;
 	enum target_state frontend_state;
 	struct image *vflash_image;
+	/* streamed vFlashWrite programming: WRITE_START sent, first error */
+	bool vflash_streaming;
+	int vflash_error;
 	bool closed;
 	/* set to prevent re-entrance from log messages during gdb_get_packet()
 	 * and gdb_put_packet(). */
@@ -93,14 +98,35 @@ struct gdb_connection {
 	bool attached;
 	/* set when extended protocol is used */
 	bool extended_protocol;
-	/* temporarily used for target description support */
-	struct target_desc_format target_desc;
-	/* temporarily used for thread list support */
+	/* serialized qXfer:threads reply, valid while thread_list_version
+	 * matches the one of the rtos */
 	char *thread_list;
+	size_t thread_list_len;
+	unsigned int thread_list_version;
+	/* serialized qXfer:memory-map reply, rebuilt when a transfer starts */
+	char *memory_map;
+	size_t memory_map_len;
 	/* flag to mask the output from gdb_log_callback() */
 	enum gdb_output_flag output_flag;
 	/* Unique index for this GDB connection. */
 	unsigned int unique_index;
+	/* set by QNonStop:1, cores of the SMP group are controlled one by one */
+	bool non_stop;
+	/* multiprocess extensions negotiated by qSupported, thread ids are pPID.TID */
+	bool multiprocess;
+	/* process selected by GDB, index in the processes of the service */
+	unsigned int current_process;
+	/* threads whose stop was not yet acknowledged by vStopped, oldest first */
+	struct gdb_stop_notif *stop_notifs;
+	unsigned int num_stop_notifs;
+	/* a %Stop notification is waiting for GDB to drain the queue */
+	bool stop_notif_sent;
+	/* reusable buffer where outgoing packets are assembled, see gdb_packet_start() */
+	char *out_buf;
+	size_t out_len;
+	size_t out_size;
+	unsigned char out_checksum;
+	bool out_error;
 };
 
 #if 0
@@ -114,6 +140,16 @@ static enum breakpoint_type gdb_breakpoint_override_type;
 
 static int gdb_error(struct connection *connection, int retval);
 static char *gdb_port;
+
+struct target *get_target_from_connection(struct connection *connection)
+{
+	struct gdb_service *gdb_service = connection->service->priv;
+	struct gdb_connection *gdb_connection = connection->priv;
+
+	if (gdb_service->processes)
+		gdb_service = gdb_service->processes[gdb_connection->current_process];
+	return gdb_service->target;
+}
 static char *gdb_port_next;
 
 static void gdb_log_callback(void *priv, const char *file, unsigned int line,
@@ -125,12 +161,18 @@ static void gdb_sig_halted(struct connection *connection);
  * in helper/log.c when no gdb connections are actually active */
 static int gdb_actual_connections;
 
+/* packets received, indexed by their first character */
+static uint64_t gdb_packet_counts[128];
+
 /* set if we are sending a memory map to gdb
  * via qXfer:memory-map:read packet */
 /* enabled by default*/
 static bool gdb_use_memory_map = true;
 /* enabled by default*/
 static bool gdb_flash_program = true;
+/* program complete sectors while vFlashWrite packets are still arriving,
+ * disabled by default */
+static bool gdb_flash_program_stream;
 
 /* if set, data aborts cause an error to be reported in memory read packets
  * see the code in gdb_read_memory_packet() for further explanations.
@@ -149,6 +191,14 @@ static bool gdb_use_target_description = true;
 /* current processing free-run type, used by file-I/O */
 static char gdb_running_type;
 
+/* serve all the targets on one port as processes of the GDB multiprocess
+ * extensions, disabled by default */
+static bool gdb_multiprocess;
+/* services of the processes of the multiprocess port, the first one is
+ * owned by the port */
+static struct gdb_service **gdb_processes;
+static unsigned int gdb_num_processes;
+
 static int gdb_last_signal(struct target *target)
 {
 	LOG_TARGET_DEBUG(target, "Debug reason is: %s",
@@ -220,8 +270,14 @@ static int gdb_get_char_inner(struct connection *connection, int *next_char)
 #ifdef _DEBUG_GDB_IO_
 	char *debug_buffer;
 #endif
+	/* GDB will not send anything before it got our packet */
+	if (connection_flush(connection) != ERROR_OK) {
+		gdb_con->closed = true;
+		return ERROR_SERVER_REMOTE_CLOSED;
+	}
+
 	for (;; ) {
-		if (connection->service->type != CONNECTION_TCP)
+		if (!connection_is_socket(connection))
 			gdb_con->buf_cnt = read(connection->fd, gdb_con->buffer, GDB_BUFFER_SIZE);
 		else {
 			retval = check_pending(connection, 1, NULL);
@@ -401,18 +457,34 @@ static void gdb_log_outgoing_packet(struct connection *connection, const char *p
 			gdb_connection->unique_index, packet_len, packet_buf, checksum);
 }
 
+/* Escape binary data as required by the 'x' and 'X' packets.
+ * @a dst must have room for 2 * @a len characters. */
+static size_t gdb_escape_binary(char *dst, const uint8_t *src, size_t len)
+{
+	size_t out = 0;
+
+	for (size_t i = 0; i < len; i++) {
+		uint8_t c = src[i];
+		if (c == '#' || c == '$' || c == '}' || c == '*') {
+			dst[out++] = '}';
+			c ^= 0x20;
+		}
+		dst[out++] = c;
+	}
+
+	return out;
+}
+
+/* Send the packet payload in @a buffer and wait for GDB to acknowledge it.
+ * If @a framed is set, @a buffer is preceded by '$' and followed by the
+ * "#xx" checksum trailer in memory, and the whole packet is sent at once. */
 static int gdb_put_packet_inner(struct connection *connection,
-		const char *buffer, int len)
+		const char *buffer, int len, unsigned char my_checksum, bool framed)
 {
-	int i;
-	unsigned char my_checksum = 0;
 	int reply;
 	int retval;
 	struct gdb_connection *gdb_con = connection->priv;
 
-	for (i = 0; i < len; i++)
-		my_checksum += buffer[i];
-
 #ifdef _DEBUG_GDB_IO_
 	/*
 	 * At this point we should have nothing in the input queue from GDB,
@@ -445,7 +517,11 @@ static int gdb_put_packet_inner(struct connection *connection,
 
 		char local_buffer[1024];
 		local_buffer[0] = '$';
-		if ((size_t)len + 4 <= sizeof(local_buffer)) {
+		if (framed) {
+			retval = gdb_write(connection, buffer - 1, len + 4);
+			if (retval != ERROR_OK)
+				return retval;
+		} else if ((size_t)len + 4 <= sizeof(local_buffer)) {
 			/* performance gain on smaller packets by only a single call to gdb_write() */
 			memcpy(local_buffer + 1, buffer, len++);
 			len += snprintf(local_buffer + len, sizeof(local_buffer) - len, "#%02x", my_checksum);
@@ -525,8 +601,129 @@ static int gdb_put_packet_inner(struct connection *connection,
 int gdb_put_packet(struct connection *connection, const char *buffer, int len)
 {
 	struct gdb_connection *gdb_con = connection->priv;
+	unsigned char my_checksum = 0;
+
+	for (int i = 0; i < len; i++)
+		my_checksum += buffer[i];
+
 	gdb_con->busy = true;
-	int retval = gdb_put_packet_inner(connection, buffer, len);
+	int retval = gdb_put_packet_inner(connection, buffer, len, my_checksum, false);
+	gdb_con->busy = false;
+
+	/* we sent some data, reset timer for keep alive messages */
+	kept_alive();
+
+	return retval;
+}
+
+/*
+ * Packets can be assembled in place in a buffer owned by the connection,
+ * which is reused for all the replies. The writers below fill the payload
+ * and update the checksum on the fly, so gdb_packet_send() only appends
+ * the trailer and writes the whole packet with a single call.
+ */
+
+/* Make room for @a len more characters plus the "#xx" trailer. */
+static char *gdb_packet_reserve(struct gdb_connection *gdb_con, size_t len)
+{
+	if (gdb_con->out_error)
+		return NULL;
+
+	size_t needed = gdb_con->out_len + len + 4;
+	if (needed > gdb_con->out_size) {
+		size_t new_size = MAX(needed, 2 * gdb_con->out_size);
+		char *new_buf = realloc(gdb_con->out_buf, new_size);
+		if (!new_buf) {
+			LOG_ERROR("Out of memory assembling GDB packet");
+			gdb_con->out_error = true;
+			return NULL;
+		}
+		gdb_con->out_buf = new_buf;
+		gdb_con->out_size = new_size;
+	}
+
+	return gdb_con->out_buf + gdb_con->out_len;
+}
+
+/* Account for @a len characters written at gdb_packet_reserve()'s pointer. */
+static void gdb_packet_commit(struct gdb_connection *gdb_con, size_t len)
+{
+	const char *p = gdb_con->out_buf + gdb_con->out_len;
+
+	for (size_t i = 0; i < len; i++)
+		gdb_con->out_checksum += p[i];
+	gdb_con->out_len += len;
+}
+
+static void gdb_packet_start(struct gdb_connection *gdb_con)
+{
+	gdb_con->out_len = 0;
+	gdb_con->out_checksum = 0;
+	gdb_con->out_error = false;
+
+	char *p = gdb_packet_reserve(gdb_con, 1);
+	if (!p)
+		return;
+	/* the frame marker is not part of the checksum */
+	p[0] = '$';
+	gdb_con->out_len = 1;
+}
+
+static void gdb_packet_append(struct gdb_connection *gdb_con, const char *data, size_t len)
+{
+	char *p = gdb_packet_reserve(gdb_con, len);
+	if (!p)
+		return;
+
+	memcpy(p, data, len);
+	gdb_packet_commit(gdb_con, len);
+}
+
+static void gdb_packet_append_hex(struct gdb_connection *gdb_con, const uint8_t *data, size_t len)
+{
+	static const char hex_digits[] = "0123456789abcdef";
+
+	char *p = gdb_packet_reserve(gdb_con, 2 * len);
+	if (!p)
+		return;
+
+	unsigned char checksum = gdb_con->out_checksum;
+	for (size_t i = 0; i < len; i++) {
+		char hi = hex_digits[data[i] >> 4];
+		char lo = hex_digits[data[i] & 0xf];
+		*p++ = hi;
+		*p++ = lo;
+		checksum += hi + lo;
+	}
+	gdb_con->out_checksum = checksum;
+	gdb_con->out_len += 2 * len;
+}
+
+/* Append binary data, escaping the characters that have a meaning in the
+ * protocol, as used by 'x' replies and qXfer transfers. */
+static void gdb_packet_append_binary(struct gdb_connection *gdb_con, const uint8_t *data, size_t len)
+{
+	char *p = gdb_packet_reserve(gdb_con, 2 * len);
+	if (!p)
+		return;
+
+	size_t encoded_len = gdb_escape_binary(p, data, len);
+	gdb_packet_commit(gdb_con, encoded_len);
+}
+
+static int gdb_packet_send(struct connection *connection)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+
+	if (gdb_con->out_error || !gdb_con->out_buf)
+		return ERROR_FAIL;
+
+	/* gdb_packet_reserve() always keeps room for the trailer */
+	snprintf(gdb_con->out_buf + gdb_con->out_len, 4, "#%02x", gdb_con->out_checksum);
+
+	gdb_con->busy = true;
+	int retval = gdb_put_packet_inner(connection, gdb_con->out_buf + 1,
+			gdb_con->out_len - 1, gdb_con->out_checksum, true);
 	gdb_con->busy = false;
 
 	/* we sent some data, reset timer for keep alive messages */
@@ -769,12 +966,198 @@ static int gdb_output(struct command_context *context, const char *line)
 	return ERROR_OK;
 }
 
+/*
+ * Multiprocess extensions. With "gdb multiprocess enable" all the targets are
+ * served on one port, each target or SMP group being a process whose id is
+ * its position plus one. GDB then writes thread ids as pPID.TID; a target
+ * without RTOS has the single thread 1. Packets naming a process select it,
+ * so the other handlers keep working on get_target_from_connection().
+ */
+
+/* Process id of @a target on the port of @a gdb_service, 0 if not served */
+static unsigned int gdb_mp_target_pid(struct gdb_service *gdb_service, struct target *target)
+{
+	for (unsigned int i = 0; i < gdb_service->num_processes; i++)
+		if (target->gdb_service == gdb_service->processes[i])
+			return i + 1;
+	return 0;
+}
+
+static int64_t gdb_mp_thread_id(struct target *target)
+{
+	if (target->rtos && target->rtos->thread_count)
+		return target->rtos->current_thread;
+	return 1;
+}
+
+/* "thread:pPID.TID;" stop reply field for @a target */
+static int gdb_mp_stop_thread(struct connection *connection, struct target *target,
+		char *buf, size_t size)
+{
+	struct gdb_service *gdb_service = connection->service->priv;
+
+	return snprintf(buf, size, "thread:p%x.%" PRIx64 ";",
+			gdb_mp_target_pid(gdb_service, target), gdb_mp_thread_id(target));
+}
+
+static int gdb_mp_select(struct connection *connection, int64_t pid)
+{
+	struct gdb_service *gdb_service = connection->service->priv;
+	struct gdb_connection *gdb_connection = connection->priv;
+
+	/* 0 is any process and -1 all of them, keep the current one */
+	if (pid == 0 || pid == -1)
+		return ERROR_OK;
+	if (pid < 0 || (uint64_t)pid > gdb_service->num_processes)
+		return ERROR_FAIL;
+
+	gdb_connection->current_process = pid - 1;
+	return ERROR_OK;
+}
+
+/* Copy @a in to @a out, which has room for strlen(in) + 1 characters,
+ * turning the thread ids at offset @a id_pos and after every ':' from
+ * pPID.TID into TID and from pPID into -1. The first process named is
+ * selected. */
+static int gdb_mp_strip_pids(struct connection *connection, const char *in,
+		size_t id_pos, char *out)
+{
+	bool selected = false;
+	size_t o = 0;
+
+	for (size_t i = 0; in[i]; ) {
+		bool id_start = i == id_pos || (i > 0 && in[i - 1] == ':');
+		if (!id_start || in[i] != 'p') {
+			out[o++] = in[i++];
+			continue;
+		}
+
+		char *end;
+		int64_t pid = strtoll(in + i + 1, &end, 16);
+		i = end - in;
+		if (!selected) {
+			if (gdb_mp_select(connection, pid) != ERROR_OK)
+				return ERROR_FAIL;
+			selected = pid > 0;
+		}
+
+		if (in[i] == '.') {
+			i++;
+		} else {
+			out[o++] = '-';
+			out[o++] = '1';
+		}
+	}
+	out[o] = '\0';
+
+	return ERROR_OK;
+}
+
+/* qfThreadInfo: the threads of all the processes in one reply */
+static int gdb_mp_thread_list(struct connection *connection)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+	struct gdb_service *gdb_service = connection->service->priv;
+	char id[48];
+	char sep = 'm';
+
+	gdb_packet_start(gdb_con);
+	for (unsigned int i = 0; i < gdb_service->num_processes; i++) {
+		struct target *target = gdb_service->processes[i]->target;
+		int len;
+
+		if (!target)
+			continue;
+
+		if (target->rtos && target->state == TARGET_HALTED)
+			rtos_update_threads(target);
+
+		if (!target->rtos || !target->rtos->thread_count) {
+			len = snprintf(id, sizeof(id), "%cp%x.1", sep, i + 1);
+			gdb_packet_append(gdb_con, id, len);
+			sep = ',';
+			continue;
+		}
+
+		for (int t = 0; t < target->rtos->thread_count; t++) {
+			len = snprintf(id, sizeof(id), "%cp%x.%" PRIx64, sep, i + 1,
+					target->rtos->thread_details[t].threadid);
+			gdb_packet_append(gdb_con, id, len);
+			sep = ',';
+		}
+	}
+	if (sep == 'm')
+		gdb_packet_append(gdb_con, "l", 1);
+
+	return gdb_packet_send(connection);
+}
+
+/* Thread related packets once the multiprocess extensions are in use */
+static int gdb_mp_thread_packet(struct connection *connection,
+		const char *packet, int packet_size)
+{
+	static char stripped[GDB_BUFFER_SIZE + 1];
+	struct gdb_connection *gdb_connection = connection->priv;
+	struct target *target = get_target_from_connection(connection);
+	size_t id_pos;
+
+	if (strncmp(packet, "qfThreadInfo", 12) == 0)
+		return gdb_mp_thread_list(connection);
+
+	if (strncmp(packet, "qsThreadInfo", 12) == 0) {
+		gdb_put_packet(connection, "l", 1);
+		return ERROR_OK;
+	}
+
+	if (strncmp(packet, "qAttached", 9) == 0) {
+		gdb_put_packet(connection, "1", 1);
+		return ERROR_OK;
+	}
+
+	if (strcmp(packet, "qC") == 0) {
+		char reply[48];
+		int len = snprintf(reply, sizeof(reply), "QCp%x.%" PRIx64,
+				gdb_connection->current_process + 1, gdb_mp_thread_id(target));
+		gdb_put_packet(connection, reply, len);
+		return ERROR_OK;
+	}
+
+	if (packet[0] == 'H')
+		id_pos = 2;
+	else if (packet[0] == 'T')
+		id_pos = 1;
+	else if (strncmp(packet, "qThreadExtraInfo,", 17) == 0)
+		id_pos = 17;
+	else
+		return gdb_thread_packet(connection, packet, packet_size);
+
+	/* only H changes the process GDB works on */
+	unsigned int current_process = gdb_connection->current_process;
+	int retval = ERROR_OK;
+
+	if (gdb_mp_strip_pids(connection, packet, id_pos, stripped) != ERROR_OK) {
+		gdb_put_packet(connection, "E01", 3);
+	} else if (packet[0] == 'T' && !get_target_from_connection(connection)->rtos) {
+		if (strtoll(stripped + 1, NULL, 16) == 1)
+			gdb_put_packet(connection, "OK", 2);
+		else
+			gdb_put_packet(connection, "E01", 3);
+	} else {
+		retval = gdb_thread_packet(connection, stripped, strlen(stripped));
+	}
+
+	if (packet[0] != 'H')
+		gdb_connection->current_process = current_process;
+
+	return retval;
+}
+
 static void gdb_signal_reply(struct target *target, struct connection *connection)
 {
 	struct gdb_connection *gdb_connection = connection->priv;
-	char sig_reply[65];
+	char sig_reply[96];
 	char stop_reason[32];
-	char current_thread[25];
+	char current_thread[48];
 	int sig_reply_len;
 	int signal_var;
 
@@ -824,7 +1207,9 @@ static void gdb_signal_reply(struct target *target, struct connection *connectio
 		}
 
 		current_thread[0] = '\0';
-		if (target->rtos)
+		if (gdb_connection->multiprocess)
+			gdb_mp_stop_thread(connection, target, current_thread, sizeof(current_thread));
+		else if (target->rtos)
 			snprintf(current_thread, sizeof(current_thread), "thread:%" PRIx64 ";",
 					target->rtos->current_thread);
 
@@ -951,14 +1336,297 @@ static void gdb_frontend_halted(struct target *target, struct connection *connec
 	}
 }
 
+/*
+ * Non-stop mode. Each core of the SMP group is a thread (the hwthread RTOS
+ * numbering: position in the group plus one) which GDB resumes, steps and
+ * halts individually. Stops are reported with %Stop notifications, further
+ * pending stops are then fetched by GDB with vStopped.
+ */
+
+static struct target *gdb_nonstop_target(struct target *target, int64_t thread_id)
+{
+	struct target_list *head;
+	int64_t tid = 1;
+
+	foreach_smp_target(head, target->smp_targets) {
+		if (tid++ == thread_id)
+			return head->target;
+	}
+
+	return NULL;
+}
+
+static int64_t gdb_nonstop_thread_id(struct target *target, struct target *ct)
+{
+	struct target_list *head;
+	int64_t tid = 1;
+
+	foreach_smp_target(head, target->smp_targets) {
+		if (head->target == ct)
+			return tid;
+		tid++;
+	}
+
+	return 0;
+}
+
+static int gdb_nonstop_stop_reply(struct target *target, const struct gdb_stop_notif *notif,
+		char *reply, size_t size)
+{
+	struct target *ct = gdb_nonstop_target(target, notif->thread_id);
+	int signal_var = notif->signal;
+
+	if (signal_var < 0)
+		signal_var = ct ? gdb_last_signal(ct) : 0;
+
+	return snprintf(reply, size, "T%2.2xthread:%" PRIx64 ";", signal_var, notif->thread_id);
+}
+
+/* Notifications are not acknowledged, they are framed with '%' */
+static int gdb_put_notification(struct connection *connection, const char *name,
+		const char *data, int len)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+
+	gdb_packet_start(gdb_con);
+	if (!gdb_con->out_error)
+		gdb_con->out_buf[0] = '%';
+	gdb_packet_append(gdb_con, name, strlen(name));
+	gdb_packet_append(gdb_con, ":", 1);
+	gdb_packet_append(gdb_con, data, len);
+	char *trailer = gdb_packet_reserve(gdb_con, 0);
+	if (!trailer)
+		return ERROR_FAIL;
+	snprintf(trailer, 4, "#%02x", gdb_con->out_checksum);
+
+	LOG_DEBUG("{%d} sending notification: %.*s", gdb_con->unique_index,
+		(int)gdb_con->out_len + 3, gdb_con->out_buf);
+	return gdb_write(connection, gdb_con->out_buf, gdb_con->out_len + 3);
+}
+
+/* Queue the stop of core @a ct, notifying GDB if nothing is pending yet */
+static void gdb_nonstop_halted(struct connection *connection, struct target *ct, int signal)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+	struct target *target = get_target_from_connection(connection);
+	int64_t thread_id = gdb_nonstop_thread_id(target, ct);
+
+	if (!thread_id || !gdb_con->stop_notifs)
+		return;
+
+	for (unsigned int i = 0; i < gdb_con->num_stop_notifs; i++)
+		if (gdb_con->stop_notifs[i].thread_id == thread_id)
+			return;
+
+	struct gdb_stop_notif *notif = &gdb_con->stop_notifs[gdb_con->num_stop_notifs++];
+	notif->thread_id = thread_id;
+	notif->signal = signal;
+
+	if (gdb_con->stop_notif_sent)
+		return;
+
+	char reply[64];
+	int len = gdb_nonstop_stop_reply(target, notif, reply, sizeof(reply));
+	if (gdb_put_notification(connection, "Stop", reply, len) == ERROR_OK)
+		gdb_con->stop_notif_sent = true;
+}
+
+static int gdb_nonstop_enable(struct connection *connection, bool enable)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+	struct target *target = get_target_from_connection(connection);
+	struct target_list *head;
+
+	if (enable) {
+		if (!target->smp || !target->rtos || strcmp(target->rtos->type->name, "hwthread")) {
+			LOG_TARGET_ERROR(target, "non-stop mode requires an SMP group with the hwthread RTOS");
+			return ERROR_FAIL;
+		}
+
+		unsigned int num_cores = 0;
+		foreach_smp_target(head, target->smp_targets)
+			num_cores++;
+
+		struct gdb_stop_notif *notifs = calloc(num_cores, sizeof(*notifs));
+		if (!notifs) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		free(gdb_con->stop_notifs);
+		gdb_con->stop_notifs = notifs;
+	} else {
+		free(gdb_con->stop_notifs);
+		gdb_con->stop_notifs = NULL;
+	}
+
+	gdb_con->num_stop_notifs = 0;
+	gdb_con->stop_notif_sent = false;
+	gdb_con->non_stop = enable;
+	foreach_smp_target(head, target->smp_targets)
+		head->target->smp_nonstop = enable;
+
+	LOG_TARGET_DEBUG(target, "non-stop mode %s", enable ? "enabled" : "disabled");
+	return ERROR_OK;
+}
+
+/* Resume, step or halt a single core. The SMP implementations act on the
+ * whole group when target->smp is set, thus hide it for the operation. */
+static int gdb_nonstop_core_action(struct connection *connection, struct target *ct, char action)
+{
+	unsigned int smp = ct->smp;
+	int retval = ERROR_OK;
+
+	ct->smp = 0;
+	switch (action) {
+		case 'c':
+		case 'C':
+			if (ct->state == TARGET_HALTED)
+				retval = target_resume(ct, true, 0, false, false);
+			break;
+		case 's':
+		case 'S':
+			if (ct->state == TARGET_HALTED) {
+				retval = target_step(ct, true, 0, false);
+				if (retval == ERROR_OK)
+					retval = target_poll(ct);
+			}
+			break;
+		case 't':
+			if (ct->state == TARGET_RUNNING)
+				retval = target_halt(ct);
+			break;
+	}
+	ct->smp = smp;
+
+	/* GDB expects signal 0 for the stop of a 't' action */
+	if (retval == ERROR_OK && ct->state == TARGET_HALTED)
+		gdb_nonstop_halted(connection, ct, action == 't' ? 0 : -1);
+
+	return retval;
+}
+
+/* vCont;action[:thread-id]... in non-stop mode, the leftmost action
+ * matching a thread applies to it */
+static void gdb_nonstop_vcont(struct connection *connection, const char *parse)
+{
+	struct target *target = get_target_from_connection(connection);
+	struct target_list *head;
+	int64_t tid = 1;
+
+	gdb_put_packet(connection, "OK", 2);
+
+	foreach_smp_target(head, target->smp_targets) {
+		const char *p = parse;
+		char action = 0;
+
+		while (*p == ';' && !action) {
+			char a = p[1];
+			p += 2;
+			/* skip the signal of C and S actions */
+			if (a == 'C' || a == 'S')
+				strtoul(p, (char **)&p, 16);
+
+			bool match = true;
+			if (*p == ':') {
+				p++;
+				/* skip the process id of multiprocess thread-ids */
+				if (*p == 'p') {
+					p = strchr(p, '.');
+					p = p ? p + 1 : "";
+				}
+				int64_t action_tid = strtoll(p, (char **)&p, 16);
+				match = action_tid == -1 || action_tid == tid;
+			}
+			if (match)
+				action = a;
+		}
+
+		if (action) {
+			struct target *ct = head->target;
+			LOG_TARGET_DEBUG(ct, "non-stop action '%c' on thread %" PRId64, action, tid);
+			if (action != 't')
+				target_call_event_callbacks(ct, TARGET_EVENT_GDB_START);
+			if (gdb_nonstop_core_action(connection, ct, action) != ERROR_OK)
+				LOG_TARGET_ERROR(ct, "non-stop action '%c' failed", action);
+		}
+		tid++;
+	}
+}
+
+/* vStopped: the oldest pending stop was seen by GDB, send the next one */
+static void gdb_nonstop_vstopped(struct connection *connection)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+	struct target *target = get_target_from_connection(connection);
+
+	if (gdb_con->num_stop_notifs) {
+		gdb_con->num_stop_notifs--;
+		memmove(gdb_con->stop_notifs, gdb_con->stop_notifs + 1,
+			gdb_con->num_stop_notifs * sizeof(*gdb_con->stop_notifs));
+	}
+
+	if (!gdb_con->num_stop_notifs) {
+		gdb_con->stop_notif_sent = false;
+		gdb_put_packet(connection, "OK", 2);
+		return;
+	}
+
+	char reply[64];
+	int len = gdb_nonstop_stop_reply(target, &gdb_con->stop_notifs[0], reply, sizeof(reply));
+	gdb_put_packet(connection, reply, len);
+}
+
+/* '?' in non-stop mode: report all the halted cores, starting the vStopped sequence */
+static void gdb_nonstop_last_signal(struct connection *connection)
+{
+	struct gdb_connection *gdb_con = connection->priv;
+	struct target *target = get_target_from_connection(connection);
+	struct target_list *head;
+
+	gdb_con->num_stop_notifs = 0;
+	/* the reply below takes the role of the notification */
+	gdb_con->stop_notif_sent = true;
+	foreach_smp_target(head, target->smp_targets)
+		if (head->target->state == TARGET_HALTED)
+			gdb_nonstop_halted(connection, head->target, -1);
+
+	if (!gdb_con->num_stop_notifs) {
+		gdb_con->stop_notif_sent = false;
+		gdb_put_packet(connection, "OK", 2);
+		return;
+	}
+
+	char reply[64];
+	int len = gdb_nonstop_stop_reply(target, &gdb_con->stop_notifs[0], reply, sizeof(reply));
+	gdb_put_packet(connection, reply, len);
+}
+
 static int gdb_target_callback_event_handler(struct target *target,
 		enum target_event event, void *priv)
 {
 	struct connection *connection = priv;
 	struct gdb_service *gdb_service = connection->service->priv;
+	struct gdb_connection *gdb_connection = connection->priv;
 
-	if (gdb_service->target != target)
+	if (gdb_connection->non_stop) {
+		/* every core of the group reports its own stops */
+		if (event == TARGET_EVENT_HALTED && target->smp_nonstop) {
+			target_call_event_callbacks(target, TARGET_EVENT_GDB_END);
+			gdb_nonstop_halted(connection, target, -1);
+		}
 		return ERROR_OK;
+	}
+
+	if (gdb_connection->multiprocess) {
+		/* every process may stop, the stop reply tells GDB which one */
+		unsigned int pid = gdb_mp_target_pid(gdb_service, target);
+		if (!pid || gdb_service->processes[pid - 1]->target != target)
+			return ERROR_OK;
+		if (event == TARGET_EVENT_GDB_HALT && gdb_connection->frontend_state == TARGET_RUNNING)
+			gdb_connection->current_process = pid - 1;
+	} else if (gdb_service->target != target) {
+		return ERROR_OK;
+	}
 
 	switch (event) {
 		case TARGET_EVENT_GDB_HALT:
@@ -974,16 +1642,27 @@ static int gdb_target_callback_event_handler(struct target *target,
 	return ERROR_OK;
 }
 
+/* Send @a event to the processes of a multiprocess port other than the first */
+static void gdb_mp_call_event_callbacks(struct gdb_service *gdb_service, enum target_event event)
+{
+	for (unsigned int i = 1; i < gdb_service->num_processes; i++)
+		if (gdb_service->processes[i]->target)
+			target_call_event_callbacks(gdb_service->processes[i]->target, event);
+}
+
 static int gdb_new_connection(struct connection *connection)
 {
 	struct gdb_connection *gdb_connection = malloc(sizeof(struct gdb_connection));
+	struct gdb_service *gdb_service = connection->service->priv;
 	struct target *target;
 	int retval;
 	int initial_ack;
 	static unsigned int next_unique_id = 1;
 
-	target = get_target_from_connection(connection);
+	/* a new GDB starts with the first process */
+	gdb_connection->current_process = 0;
 	connection->priv = gdb_connection;
+	target = get_target_from_connection(connection);
 	connection->cmd_ctx->current_target = target;
 
 	/* initialize gdb connection information */
@@ -992,6 +1671,8 @@ static int gdb_new_connection(struct connection *connection)
 	gdb_connection->ctrl_c = false;
 	gdb_connection->frontend_state = TARGET_HALTED;
 	gdb_connection->vflash_image = NULL;
+	gdb_connection->vflash_streaming = false;
+	gdb_connection->vflash_error = ERROR_OK;
 	gdb_connection->closed = false;
 	gdb_connection->busy = false;
 	gdb_connection->noack_mode = 0;
@@ -999,11 +1680,23 @@ static int gdb_new_connection(struct connection *connection)
 	gdb_connection->mem_write_error = false;
 	gdb_connection->attached = true;
 	gdb_connection->extended_protocol = false;
-	gdb_connection->target_desc.tdesc = NULL;
-	gdb_connection->target_desc.tdesc_length = 0;
 	gdb_connection->thread_list = NULL;
+	gdb_connection->thread_list_len = 0;
+	gdb_connection->thread_list_version = 0;
+	gdb_connection->memory_map = NULL;
+	gdb_connection->memory_map_len = 0;
 	gdb_connection->output_flag = GDB_OUTPUT_NO;
 	gdb_connection->unique_index = next_unique_id++;
+	gdb_connection->non_stop = false;
+	gdb_connection->multiprocess = false;
+	gdb_connection->stop_notifs = NULL;
+	gdb_connection->num_stop_notifs = 0;
+	gdb_connection->stop_notif_sent = false;
+	gdb_connection->out_buf = NULL;
+	gdb_connection->out_len = 0;
+	gdb_connection->out_size = 0;
+	gdb_connection->out_checksum = 0;
+	gdb_connection->out_error = false;
 
 	/* output goes through gdb connection */
 	command_set_output_handler(connection->cmd_ctx, gdb_output, connection);
@@ -1014,6 +1707,13 @@ static int gdb_new_connection(struct connection *connection)
 	 */
 	breakpoint_clear_target(target);
 	watchpoint_clear_target(target);
+	for (unsigned int i = 1; i < gdb_service->num_processes; i++) {
+		struct target *t = gdb_service->processes[i]->target;
+		if (t) {
+			breakpoint_clear_target(t);
+			watchpoint_clear_target(t);
+		}
+	}
 
 	/* Since version 3.95 (gdb-19990504), with the exclusion of 6.5~6.8, GDB
 	 * sends an ACK at connection with the following comment in its source code:
@@ -1029,6 +1729,7 @@ static int gdb_new_connection(struct connection *connection)
 		gdb_putback_char(connection, initial_ack);
 
 	target_call_event_callbacks(target, TARGET_EVENT_GDB_ATTACH);
+	gdb_mp_call_event_callbacks(gdb_service, TARGET_EVENT_GDB_ATTACH);
 
 	if (target->rtos) {
 		/* clean previous rtos session if supported*/
@@ -1093,7 +1794,10 @@ static int gdb_connection_closed(struct connection *connection)
 {
 	struct target *target;
 	struct gdb_connection *gdb_connection = connection->priv;
+	struct gdb_service *gdb_service = connection->service->priv;
 
+	/* the events below go to the first process, then to the others */
+	gdb_connection->current_process = 0;
 	target = get_target_from_connection(connection);
 
 	/* we're done forwarding messages. Tear down callback before
@@ -1107,6 +1811,10 @@ static int gdb_connection_closed(struct connection *connection)
 		target_state_name(target),
 		gdb_actual_connections);
 
+	/* a streamed flash write was interrupted */
+	if (gdb_connection->vflash_streaming)
+		target_call_event_callbacks(target, TARGET_EVENT_GDB_FLASH_WRITE_END);
+
 	/* see if an image built with vFlash commands is left */
 	if (gdb_connection->vflash_image) {
 		image_close(gdb_connection->vflash_image);
@@ -1117,14 +1825,25 @@ static int gdb_connection_closed(struct connection *connection)
 	/* if this connection registered a debug-message receiver delete it */
 	delete_debug_msg_receiver(connection->cmd_ctx, target);
 
+	if (gdb_connection->non_stop) {
+		struct target_list *head;
+		foreach_smp_target(head, target->smp_targets)
+			head->target->smp_nonstop = false;
+	}
+	free(gdb_connection->stop_notifs);
+	free(gdb_connection->thread_list);
+	free(gdb_connection->memory_map);
+	free(gdb_connection->out_buf);
 	free(connection->priv);
 	connection->priv = NULL;
 
 	target_unregister_event_callback(gdb_target_callback_event_handler, connection);
 
 	target_call_event_callbacks(target, TARGET_EVENT_GDB_END);
+	gdb_mp_call_event_callbacks(gdb_service, TARGET_EVENT_GDB_END);
 
 	target_call_event_callbacks(target, TARGET_EVENT_GDB_DETACH);
+	gdb_mp_call_event_callbacks(gdb_service, TARGET_EVENT_GDB_DETACH);
 
 	return ERROR_OK;
 }
@@ -1151,8 +1870,21 @@ static int gdb_last_signal_packet(struct connection *connection,
 		return ERROR_OK;
 	}
 
+	if (gdb_con->non_stop) {
+		gdb_nonstop_last_signal(connection);
+		return ERROR_OK;
+	}
+
 	signal_var = gdb_last_signal(target);
 
+	if (gdb_con->multiprocess) {
+		char reply[64];
+		int len = snprintf(reply, sizeof(reply), "T%2.2x", signal_var);
+		len += gdb_mp_stop_thread(connection, target, reply + len, sizeof(reply) - len);
+		gdb_put_packet(connection, reply, len);
+		return ERROR_OK;
+	}
+
 	snprintf(sig_reply, 4, "S%2.2x", signal_var);
 	gdb_put_packet(connection, sig_reply, 3);
 
@@ -1241,12 +1973,10 @@ static int gdb_get_registers_packet(struct connection *connection,
 		char const *packet, int packet_size)
 {
 	struct target *target = get_target_from_connection(connection);
+	struct gdb_connection *gdb_con = connection->priv;
 	struct reg **reg_list;
 	int reg_list_size;
 	int retval;
-	int reg_packet_size = 0;
-	char *reg_packet;
-	char *reg_packet_p;
 	int i;
 
 #ifdef _DEBUG_GDB_IO_
@@ -1261,44 +1991,41 @@ static int gdb_get_registers_packet(struct connection *connection,
 	if (retval != ERROR_OK)
 		return gdb_error(connection, retval);
 
-	for (i = 0; i < reg_list_size; i++) {
-		if (!reg_list[i] || !reg_list[i]->exist || reg_list[i]->hidden)
-			continue;
-		reg_packet_size += DIV_ROUND_UP(reg_list[i]->size, 8) * 2;
-	}
-
-	assert(reg_packet_size > 0);
-
-	reg_packet = malloc(reg_packet_size + 1); /* plus one for string termination null */
-	if (!reg_packet)
-		return ERROR_FAIL;
+	/* read the invalid registers in one batch where the target supports it,
+	 * whatever is left is read one by one below */
+	retval = target_fetch_regs(target, reg_list, reg_list_size);
+	if (retval != ERROR_OK)
+		LOG_DEBUG("Batched register read failed, reading registers one by one");
 
-	reg_packet_p = reg_packet;
+	/* the reply is assembled directly in the connection's packet buffer */
+	gdb_packet_start(gdb_con);
 
 	for (i = 0; i < reg_list_size; i++) {
 		if (!reg_list[i] || !reg_list[i]->exist || reg_list[i]->hidden)
 			continue;
+		const unsigned int len = DIV_ROUND_UP(reg_list[i]->size, 8) * 2;
+		/* plus one for the string termination null */
+		char *reg_packet_p = gdb_packet_reserve(gdb_con, len + 1);
+		if (!reg_packet_p) {
+			free(reg_list);
+			return ERROR_FAIL;
+		}
 		retval = gdb_get_reg_value_as_str(target, reg_packet_p, reg_list[i]);
 		if (retval != ERROR_OK && gdb_report_register_access_error) {
 			LOG_DEBUG("Couldn't get register %s.", reg_list[i]->name);
-			free(reg_packet);
 			free(reg_list);
 			return gdb_error(connection, retval);
 		}
-		reg_packet_p += DIV_ROUND_UP(reg_list[i]->size, 8) * 2;
+		gdb_packet_commit(gdb_con, len);
 	}
 
+	assert(gdb_con->out_len > 1);
+
 #ifdef _DEBUG_GDB_IO_
-	{
-		char *reg_packet_p_debug;
-		reg_packet_p_debug = strndup(reg_packet, reg_packet_size);
-		LOG_DEBUG("reg_packet: %s", reg_packet_p_debug);
-		free(reg_packet_p_debug);
-	}
+	LOG_DEBUG("reg_packet: %.*s", (int)gdb_con->out_len - 1, gdb_con->out_buf + 1);
 #endif
 
-	gdb_put_packet(connection, reg_packet, reg_packet_size);
-	free(reg_packet);
+	gdb_packet_send(connection);
 
 	free(reg_list);
 
@@ -1495,42 +2222,18 @@ static int gdb_error(struct connection *connection, int retval)
 	return ERROR_OK;
 }
 
-static int gdb_read_memory_packet(struct connection *connection,
-		char const *packet, int packet_size)
-{
-	struct target *target = get_target_from_connection(connection);
-	char *separator;
-	uint64_t addr = 0;
-	uint32_t len = 0;
-
-	uint8_t *buffer;
-	char *hex_buffer;
+/* Memory reads larger than this chunk size are streamed to GDB: the target
+ * read of the next chunk overlaps with the transmission of the current one. */
+#define GDB_MEMORY_READ_CHUNK	2048
 
-	int retval = ERROR_OK;
-
-	/* skip command character */
-	packet++;
-
-	addr = strtoull(packet, &separator, 16);
-
-	if (*separator != ',') {
-		LOG_ERROR("incomplete read memory packet received, dropping connection");
-		return ERROR_SERVER_REMOTE_CLOSED;
-	}
-
-	len = strtoul(separator + 1, NULL, 16);
-
-	if (!len) {
-		LOG_WARNING("invalid read memory packet received (len == 0)");
-		gdb_put_packet(connection, "", 0);
+static int gdb_read_memory_chunk(struct target *target, uint64_t addr,
+		uint32_t len, uint8_t *buffer)
+{
+	/* flash content cached on the host, if enabled */
+	if (flash_cache_read(target, addr, len, buffer) == ERROR_OK)
 		return ERROR_OK;
-	}
 
-	buffer = malloc(len);
-
-	LOG_DEBUG("addr: 0x%16.16" PRIx64 ", len: 0x%8.8" PRIx32 "", addr, len);
-
-	retval = ERROR_NOT_IMPLEMENTED;
+	int retval = ERROR_NOT_IMPLEMENTED;
 	if (target->rtos)
 		retval = rtos_read_buffer(target, addr, len, buffer);
 	if (retval == ERROR_NOT_IMPLEMENTED)
@@ -1554,14 +2257,150 @@ static int gdb_read_memory_packet(struct connection *connection,
 		retval = ERROR_OK;
 	}
 
-	if (retval == ERROR_OK) {
-		hex_buffer = malloc(len * 2 + 1);
+	return retval;
+}
+
+/* Send a large memory read reply chunk by chunk, without waiting for the
+ * whole area being read from the target. The packet cannot be retransmitted,
+ * so this is only used in no-ack mode. A read failure after the first chunk
+ * truncates the reply, GDB accepts replies shorter than requested. */
+static int gdb_stream_memory_reply(struct connection *connection, uint64_t addr,
+		uint32_t len, bool binary)
+{
+	struct target *target = get_target_from_connection(connection);
+	struct gdb_connection *gdb_con = connection->priv;
+	unsigned char checksum = 0;
+	uint32_t sent = 0;
+	int retval;
+
+	uint8_t *buffer = malloc(GDB_MEMORY_READ_CHUNK);
+	char *encoded = malloc(2 * GDB_MEMORY_READ_CHUNK + 1);
+	if (!buffer || !encoded) {
+		LOG_ERROR("Out of memory");
+		free(buffer);
+		free(encoded);
+		return ERROR_FAIL;
+	}
+
+	uint32_t chunk = MIN(len, GDB_MEMORY_READ_CHUNK);
+	retval = gdb_read_memory_chunk(target, addr, chunk, buffer);
+	if (retval != ERROR_OK) {
+		free(buffer);
+		free(encoded);
+		return gdb_error(connection, retval);
+	}
+
+	gdb_con->busy = true;
+
+	encoded[0] = '$';
+	size_t encoded_len = 1;
+	if (binary) {
+		encoded[encoded_len++] = 'b';
+		checksum += 'b';
+	}
+	retval = gdb_write(connection, encoded, encoded_len);
+
+	while (retval == ERROR_OK) {
+		if (binary)
+			encoded_len = gdb_escape_binary(encoded, buffer, chunk);
+		else
+			encoded_len = hexify(encoded, buffer, chunk, 2 * GDB_MEMORY_READ_CHUNK + 1);
+
+		for (size_t i = 0; i < encoded_len; i++)
+			checksum += encoded[i];
+
+		/* the socket sends this chunk while the next one is read from the target */
+		retval = gdb_write(connection, encoded, encoded_len);
+		if (retval != ERROR_OK)
+			break;
+		sent += chunk;
+
+		if (sent == len)
+			break;
+
+		chunk = MIN(len - sent, GDB_MEMORY_READ_CHUNK);
+		if (gdb_read_memory_chunk(target, addr + sent, chunk, buffer) != ERROR_OK) {
+			LOG_DEBUG("memory read failed at 0x%16.16" PRIx64 ", truncating reply",
+				addr + sent);
+			break;
+		}
+	}
+
+	if (retval == ERROR_OK) {
+		char trailer[4];
+		snprintf(trailer, sizeof(trailer), "#%02x", checksum);
+		retval = gdb_write(connection, trailer, 3);
+		LOG_TARGET_DEBUG(target, "{%d} sending packet: $<streamed-%" PRIu32 "-bytes>#%2.2x",
+			gdb_con->unique_index, sent, checksum);
+	}
+
+	gdb_con->busy = false;
+
+	/* we sent some data, reset timer for keep alive messages */
+	kept_alive();
+
+	free(buffer);
+	free(encoded);
+
+	return retval;
+}
+
+/* Handle 'm' (hex reply) and 'x' (binary reply) memory read packets */
+static int gdb_read_memory_packet(struct connection *connection,
+		char const *packet, int packet_size)
+{
+	struct target *target = get_target_from_connection(connection);
+	struct gdb_connection *gdb_con = connection->priv;
+	char *separator;
+	uint64_t addr = 0;
+	uint32_t len = 0;
+	bool binary = packet[0] == 'x';
+
+	uint8_t *buffer;
+
+	int retval = ERROR_OK;
+
+	/* skip command character */
+	packet++;
+
+	addr = strtoull(packet, &separator, 16);
+
+	if (*separator != ',') {
+		LOG_ERROR("incomplete read memory packet received, dropping connection");
+		return ERROR_SERVER_REMOTE_CLOSED;
+	}
+
+	len = strtoul(separator + 1, NULL, 16);
+
+	if (!len) {
+		if (binary) {
+			/* valid probe for 'x' packet support */
+			gdb_put_packet(connection, "b", 1);
+			return ERROR_OK;
+		}
+		LOG_WARNING("invalid read memory packet received (len == 0)");
+		gdb_put_packet(connection, "", 0);
+		return ERROR_OK;
+	}
 
-		size_t pkt_len = hexify(hex_buffer, buffer, len, len * 2 + 1);
+	LOG_DEBUG("addr: 0x%16.16" PRIx64 ", len: 0x%8.8" PRIx32 "", addr, len);
+
+	if (gdb_con->noack_mode && len > GDB_MEMORY_READ_CHUNK)
+		return gdb_stream_memory_reply(connection, addr, len, binary);
+
+	buffer = malloc(len);
 
-		gdb_put_packet(connection, hex_buffer, pkt_len);
+	retval = gdb_read_memory_chunk(target, addr, len, buffer);
 
-		free(hex_buffer);
+	if (retval == ERROR_OK) {
+		gdb_packet_start(gdb_con);
+		if (binary) {
+			gdb_packet_append(gdb_con, "b", 1);
+			gdb_packet_append_binary(gdb_con, buffer, len);
+		} else {
+			gdb_packet_append_hex(gdb_con, buffer, len);
+		}
+		gdb_packet_send(connection);
 	} else
 		retval = gdb_error(connection, retval);
 
@@ -1894,35 +2733,22 @@ static int compare_bank(const void *a, const void *b)
 		return -1;
 }
 
-static int gdb_memory_map(struct connection *connection,
-		char const *packet, int packet_size)
+static int gdb_generate_memory_map(struct target *target, char **xml_out, size_t *len_out)
 {
 	/* We get away with only specifying flash here. Regions that are not
 	 * specified are treated as if we provided no memory map(if not we
 	 * could detect the holes and mark them as RAM).
-	 * Normally we only execute this code once, but no big deal if we
-	 * have to regenerate it a couple of times.
 	 */
 
-	struct target *target = get_target_from_connection(connection);
 	struct flash_bank *p;
 	char *xml = NULL;
 	int size = 0;
 	int pos = 0;
 	int retval = ERROR_OK;
 	struct flash_bank **banks;
-	int offset;
-	int length;
-	char *separator;
 	target_addr_t ram_start = 0;
 	unsigned int target_flash_banks = 0;
 
-	/* skip command character */
-	packet += 23;
-
-	offset = strtoul(packet, &separator, 16);
-	length = strtoul(separator + 1, &separator, 16);
-
 	xml_printf(&retval, &xml, &pos, &size, "<memory-map>\n");
 
 	/* Sort banks in ascending order.  We need to report non-flash
@@ -1938,7 +2764,7 @@ static int gdb_memory_map(struct connection *connection,
 		retval = get_flash_bank_by_num(i, &p);
 		if (retval != ERROR_OK) {
 			free(banks);
-			gdb_error(connection, retval);
+			free(xml);
 			return retval;
 		}
 		banks[target_flash_banks++] = p;
@@ -2024,21 +2850,55 @@ static int gdb_memory_map(struct connection *connection,
 
 	if (retval != ERROR_OK) {
 		free(xml);
-		gdb_error(connection, retval);
 		return retval;
 	}
 
-	if (offset + length > pos)
-		length = pos - offset;
+	*xml_out = xml;
+	*len_out = pos;
+	return ERROR_OK;
+}
+
+static int gdb_memory_map(struct connection *connection,
+		char const *packet, int packet_size)
+{
+	struct target *target = get_target_from_connection(connection);
+	struct gdb_connection *gdb_con = connection->priv;
+	char *separator;
+
+	/* skip command character */
+	packet += 23;
+
+	size_t offset = strtoul(packet, &separator, 16);
+	size_t length = strtoul(separator + 1, &separator, 16);
+
+	/* Flash banks may have been probed since the previous transfer,
+	 * serialize the map once per transfer and slice the chunks from it. */
+	if (offset == 0 || !gdb_con->memory_map) {
+		free(gdb_con->memory_map);
+		gdb_con->memory_map = NULL;
+		int retval = gdb_generate_memory_map(target, &gdb_con->memory_map,
+				&gdb_con->memory_map_len);
+		if (retval != ERROR_OK) {
+			gdb_error(connection, retval);
+			return retval;
+		}
+	}
+
+	offset = MIN(offset, gdb_con->memory_map_len);
+	length = MIN(length, gdb_con->memory_map_len - offset);
+	char transfer_type = (offset + length < gdb_con->memory_map_len) ? 'm' : 'l';
 
-	char *t = malloc(length + 1);
-	t[0] = 'l';
-	memcpy(t + 1, xml + offset, length);
-	gdb_put_packet(connection, t, length + 1);
+	gdb_packet_start(gdb_con);
+	gdb_packet_append(gdb_con, &transfer_type, 1);
+	gdb_packet_append_binary(gdb_con, (const uint8_t *)gdb_con->memory_map + offset, length);
+	int retval = gdb_packet_send(connection);
 
-	free(t);
-	free(xml);
-	return ERROR_OK;
+	if (transfer_type == 'l') {
+		free(gdb_con->memory_map);
+		gdb_con->memory_map = NULL;
+	}
+
+	return retval;
 }
 
 static const char *gdb_get_reg_type_name(enum reg_type type)
@@ -2540,27 +3400,89 @@ error:
 	return retval;
 }
 
-static int gdb_get_target_description_chunk(struct target *target, struct target_desc_format *target_desc,
-		char **chunk, int32_t offset, uint32_t length)
+static uint32_t gdb_layout_hash(uint32_t hash, uint64_t value)
 {
-	if (!target_desc) {
-		LOG_ERROR("Unable to Generate Target Description");
-		return ERROR_FAIL;
+	/* FNV-1a, one byte at a time */
+	for (unsigned int i = 0; i < sizeof(value); i++, value >>= 8)
+		hash = (hash ^ (value & 0xff)) * 16777619u;
+	return hash;
+}
+
+/* Fingerprint of everything the target description is generated from. Driver
+ * register caches are usually created once, so reallocation or changes of the
+ * exist/hidden flags, e.g. on target examine, alter the fingerprint. */
+static uint32_t gdb_reg_layout_fingerprint(struct target *target,
+		struct reg **reg_list, int reg_list_size)
+{
+	uint32_t hash = 2166136261u;
+
+	hash = gdb_layout_hash(hash, (uintptr_t)target_get_gdb_arch(target));
+	hash = gdb_layout_hash(hash, reg_list_size);
+	for (int i = 0; i < reg_list_size; i++) {
+		struct reg *reg = reg_list[i];
+		hash = gdb_layout_hash(hash, (uintptr_t)reg);
+		hash = gdb_layout_hash(hash, (uintptr_t)reg->name);
+		hash = gdb_layout_hash(hash, (uintptr_t)reg->feature);
+		hash = gdb_layout_hash(hash, (uintptr_t)reg->reg_data_type);
+		hash = gdb_layout_hash(hash, (uintptr_t)reg->group);
+		hash = gdb_layout_hash(hash, reg->number);
+		hash = gdb_layout_hash(hash, reg->size);
+		hash = gdb_layout_hash(hash, reg->exist | reg->hidden << 1 | reg->caller_save << 2);
+	}
+
+	return hash;
+}
+
+/* Return the target description cached on the target, regenerating it if
+ * the register layout changed since it was generated. */
+static int gdb_get_cached_target_description(struct target *target, const char **tdesc_out)
+{
+	struct reg **reg_list = NULL;
+	int reg_list_size;
+
+	int retval = smp_reg_list_noread(target, &reg_list, &reg_list_size, REG_CLASS_ALL);
+	if (retval != ERROR_OK)
+		return retval;
+
+	uint32_t layout = gdb_reg_layout_fingerprint(target, reg_list, reg_list_size);
+	free(reg_list);
+
+	if (!target->gdb_tdesc || target->gdb_tdesc_layout != layout) {
+		char *tdesc;
+		retval = gdb_generate_target_description(target, &tdesc);
+		if (retval != ERROR_OK)
+			return retval;
+
+		LOG_TARGET_DEBUG(target, "%s target description",
+			target->gdb_tdesc ? "regenerated" : "generated");
+		free(target->gdb_tdesc);
+		target->gdb_tdesc = tdesc;
+		target->gdb_tdesc_layout = layout;
 	}
 
-	char *tdesc = target_desc->tdesc;
-	uint32_t tdesc_length = target_desc->tdesc_length;
+	*tdesc_out = target->gdb_tdesc;
+	return ERROR_OK;
+}
+
+/* Assemble the qXfer:features:read reply in the connection's packet buffer */
+static int gdb_get_target_description_chunk(struct target *target, struct gdb_connection *gdb_con,
+		int32_t offset, uint32_t length)
+{
+	const char *tdesc = target->gdb_tdesc;
 
-	if (!tdesc) {
-		int retval = gdb_generate_target_description(target, &tdesc);
+	/* only check the layout when a new transfer starts */
+	if (offset == 0 || !tdesc) {
+		int retval = gdb_get_cached_target_description(target, &tdesc);
 		if (retval != ERROR_OK) {
 			LOG_ERROR("Unable to Generate Target Description");
 			return ERROR_FAIL;
 		}
-
-		tdesc_length = strlen(tdesc);
 	}
 
+	uint32_t tdesc_length = strlen(tdesc);
+	if ((uint32_t)offset > tdesc_length)
+		offset = tdesc_length;
+
 	char transfer_type;
 
 	if (length < (tdesc_length - offset))
@@ -2568,28 +3490,10 @@ static int gdb_get_target_description_chunk(struct target *target, struct target
 	else
 		transfer_type = 'l';
 
-	*chunk = malloc(length + 2);
-	if (!*chunk) {
-		LOG_ERROR("Unable to allocate memory");
-		return ERROR_FAIL;
-	}
-
-	(*chunk)[0] = transfer_type;
-	if (transfer_type == 'm') {
-		strncpy((*chunk) + 1, tdesc + offset, length);
-		(*chunk)[1 + length] = '\0';
-	} else {
-		strncpy((*chunk) + 1, tdesc + offset, tdesc_length - offset);
-		(*chunk)[1 + (tdesc_length - offset)] = '\0';
-
-		/* After gdb-server sends out last chunk, invalidate tdesc. */
-		free(tdesc);
-		tdesc = NULL;
-		tdesc_length = 0;
-	}
-
-	target_desc->tdesc = tdesc;
-	target_desc->tdesc_length = tdesc_length;
+	gdb_packet_start(gdb_con);
+	gdb_packet_append(gdb_con, &transfer_type, 1);
+	gdb_packet_append_binary(gdb_con, (const uint8_t *)tdesc + offset,
+		MIN(length, tdesc_length - offset));
 
 	return ERROR_OK;
 }
@@ -2639,7 +3543,8 @@ error:
 	return retval;
 }
 
-static int gdb_generate_thread_list(struct target *target, char **thread_list_out)
+static int gdb_generate_thread_list(struct target *target, char **thread_list_out,
+		size_t *thread_list_len)
 {
 	struct rtos *rtos = target->rtos;
 	int retval = ERROR_OK;
@@ -2687,53 +3592,52 @@ static int gdb_generate_thread_list(struct target *target, char **thread_list_ou
 	xml_printf(&retval, &thread_list, &pos, &size,
 		   "</threads>\n");
 
-	if (retval == ERROR_OK)
+	if (retval == ERROR_OK) {
 		*thread_list_out = thread_list;
-	else
+		*thread_list_len = pos;
+	} else {
 		free(thread_list);
+	}
 
 	return retval;
 }
 
-static int gdb_get_thread_list_chunk(struct target *target, char **thread_list,
-		char **chunk, int32_t offset, uint32_t length)
+/* Assemble the qXfer:threads:read reply in the connection's packet buffer.
+ * The serialized list is kept across transfers until the rtos reports a
+ * different thread list, see rtos_update_threads(). */
+static int gdb_get_thread_list_chunk(struct target *target, struct gdb_connection *gdb_con,
+		int32_t offset, uint32_t length)
 {
-	if (!*thread_list) {
-		int retval = gdb_generate_thread_list(target, thread_list);
+	unsigned int version = target->rtos ? target->rtos->thread_list_version : 0;
+
+	if (gdb_con->thread_list && offset == 0 && gdb_con->thread_list_version != version) {
+		free(gdb_con->thread_list);
+		gdb_con->thread_list = NULL;
+	}
+
+	if (!gdb_con->thread_list) {
+		int retval = gdb_generate_thread_list(target, &gdb_con->thread_list,
+				&gdb_con->thread_list_len);
 		if (retval != ERROR_OK) {
 			LOG_ERROR("Unable to Generate Thread List");
 			return ERROR_FAIL;
 		}
+		gdb_con->thread_list_version = version;
 	}
 
-	size_t thread_list_length = strlen(*thread_list);
+	size_t thread_list_length = gdb_con->thread_list_len;
+	size_t start = MIN((size_t)offset, thread_list_length);
 	char transfer_type;
 
-	length = MIN(length, thread_list_length - offset);
-	if (length < (thread_list_length - offset))
+	length = MIN(length, thread_list_length - start);
+	if (length < (thread_list_length - start))
 		transfer_type = 'm';
 	else
 		transfer_type = 'l';
 
-	*chunk = malloc(length + 2 + 3);
-	/* Allocating extra 3 bytes prevents false positive valgrind report
-	 * of strlen(chunk) word access:
-	 * Invalid read of size 4
-	 * Address 0x4479934 is 44 bytes inside a block of size 45 alloc'd */
-	if (!*chunk) {
-		LOG_ERROR("Unable to allocate memory");
-		return ERROR_FAIL;
-	}
-
-	(*chunk)[0] = transfer_type;
-	strncpy((*chunk) + 1, (*thread_list) + offset, length);
-	(*chunk)[1 + length] = '\0';
-
-	/* After gdb-server sends out last chunk, invalidate thread list. */
-	if (transfer_type == 'l') {
-		free(*thread_list);
-		*thread_list = NULL;
-	}
+	gdb_packet_start(gdb_con);
+	gdb_packet_append(gdb_con, &transfer_type, 1);
+	gdb_packet_append_binary(gdb_con, (const uint8_t *)gdb_con->thread_list + start, length);
 
 	return ERROR_OK;
 }
@@ -2878,14 +3782,23 @@ static int gdb_query_packet(struct connection *connection,
 			gdb_target_desc_supported = false;
 		}
 
+		/* the multiprocess port lists the threads of all its processes
+		 * with qfThreadInfo, qXfer:threads would only cover one */
+		struct gdb_service *gdb_service = connection->service->priv;
+		gdb_connection->multiprocess = gdb_service->processes &&
+			strstr(packet, "multiprocess+");
+
 		xml_printf(&retval,
 			&buffer,
 			&pos,
 			&size,
-			"PacketSize=%x;qXfer:memory-map:read%c;qXfer:features:read%c;qXfer:threads:read+;QStartNoAckMode+;vContSupported+",
+			"PacketSize=%x;qXfer:memory-map:read%c;qXfer:features:read%c;qXfer:threads:read%c;QStartNoAckMode+;vContSupported+;binary-upload+%s%s",
 			GDB_BUFFER_SIZE,
 			(gdb_use_memory_map && (flash_get_bank_count() > 0)) ? '+' : '-',
-			gdb_target_desc_supported ? '+' : '-');
+			gdb_target_desc_supported ? '+' : '-',
+			gdb_connection->multiprocess ? '-' : '+',
+			(target->smp && target->rtos) ? ";QNonStop+" : "",
+			gdb_connection->multiprocess ? ";multiprocess+" : "");
 
 		if (retval != ERROR_OK) {
 			gdb_send_error(connection, 01);
@@ -2900,7 +3813,6 @@ static int gdb_query_packet(struct connection *connection,
 		   && (flash_get_bank_count() > 0))
 		return gdb_memory_map(connection, packet, packet_size);
 	else if (strncmp(packet, "qXfer:features:read:", 20) == 0) {
-		char *xml = NULL;
 		int retval = ERROR_OK;
 
 		int offset;
@@ -2919,19 +3831,16 @@ static int gdb_query_packet(struct connection *connection,
 		 * there are *more* chunks to transfer. 'l' for it is the *last*
 		 * chunk of target description.
 		 */
-		retval = gdb_get_target_description_chunk(target, &gdb_connection->target_desc,
-				&xml, offset, length);
+		retval = gdb_get_target_description_chunk(target, gdb_connection,
+				offset, length);
 		if (retval != ERROR_OK) {
 			gdb_error(connection, retval);
 			return retval;
 		}
 
-		gdb_put_packet(connection, xml, strlen(xml));
-
-		free(xml);
+		gdb_packet_send(connection);
 		return ERROR_OK;
 	} else if (strncmp(packet, "qXfer:threads:read:", 19) == 0) {
-		char *xml = NULL;
 		int retval = ERROR_OK;
 
 		int offset;
@@ -2950,16 +3859,21 @@ static int gdb_query_packet(struct connection *connection,
 		 * there are *more* chunks to transfer. 'l' for it is the *last*
 		 * chunk of target description.
 		 */
-		retval = gdb_get_thread_list_chunk(target, &gdb_connection->thread_list,
-						   &xml, offset, length);
+		retval = gdb_get_thread_list_chunk(target, gdb_connection,
+						   offset, length);
 		if (retval != ERROR_OK) {
 			gdb_error(connection, retval);
 			return retval;
 		}
 
-		gdb_put_packet(connection, xml, strlen(xml));
-
-		free(xml);
+		gdb_packet_send(connection);
+		return ERROR_OK;
+	} else if (strncmp(packet, "QNonStop:", 9) == 0) {
+		if (gdb_nonstop_enable(connection, packet[9] == '1') != ERROR_OK) {
+			gdb_send_error(connection, 01);
+			return ERROR_OK;
+		}
+		gdb_put_packet(connection, "OK", 2);
 		return ERROR_OK;
 	} else if (strncmp(packet, "QStartNoAckMode", 15) == 0) {
 		gdb_connection->noack_mode = 1;
@@ -2988,12 +3902,20 @@ static bool gdb_handle_vcont_packet(struct connection *connection, const char *p
 	if (parse[0] == '?') {
 		if (target->type->step) {
 			/* gdb doesn't accept c without C and s without S */
-			gdb_put_packet(connection, "vCont;c;C;s;S", 13);
+			if (gdb_connection->non_stop)
+				gdb_put_packet(connection, "vCont;c;C;s;S;t", 15);
+			else
+				gdb_put_packet(connection, "vCont;c;C;s;S", 13);
 			return true;
 		}
 		return false;
 	}
 
+	if (gdb_connection->non_stop) {
+		gdb_nonstop_vcont(connection, parse);
+		return true;
+	}
+
 	if (parse[0] == ';') {
 		++parse;
 	}
@@ -3107,8 +4029,12 @@ static bool gdb_handle_vcont_packet(struct connection *connection, const char *p
 
 			LOG_DEBUG("fake step thread %"PRIx64, thread_id);
 
-			sig_reply_len = snprintf(sig_reply, sizeof(sig_reply),
-									"T05thread:%016"PRIx64";", thread_id);
+			if (gdb_connection->multiprocess)
+				sig_reply_len = snprintf(sig_reply, sizeof(sig_reply), "T05thread:p%x.%" PRIx64 ";",
+						gdb_mp_target_pid(connection->service->priv, target), thread_id);
+			else
+				sig_reply_len = snprintf(sig_reply, sizeof(sig_reply),
+										"T05thread:%016"PRIx64";", thread_id);
 
 			gdb_put_packet(connection, sig_reply, sig_reply_len);
 			gdb_connection->output_flag = GDB_OUTPUT_NO;
@@ -3242,6 +4168,58 @@ static bool gdb_handle_vrun_packet(struct connection *connection, const char *pa
 	return true;
 }
 
+/* Program the flash sectors completely received by vFlashWrite so far.
+ * Called after the packet has been acknowledged, so the target is
+ * programmed while GDB sends the next packets. */
+static int gdb_vflash_stream(struct connection *connection)
+{
+	struct gdb_connection *gdb_connection = connection->priv;
+	struct target *target = get_target_from_connection(connection);
+	struct image *image = gdb_connection->vflash_image;
+	struct imagesection *last = &image->sections[image->num_sections - 1];
+	target_addr_t end = last->base_address + last->size;
+	struct flash_bank *bank;
+	struct image head;
+	uint32_t written;
+
+	int retval = get_flash_bank_by_addr(target, end - 1, false, &bank);
+	if (retval != ERROR_OK || !bank)
+		return retval;
+
+	/* GDB writes in address order, so nothing below the sector holding
+	 * the end of the received data is written again */
+	target_addr_t boundary = bank->base;
+	for (unsigned int i = 0; i < bank->num_sectors; i++) {
+		target_addr_t sector_end = bank->base + bank->sectors[i].offset +
+			bank->sectors[i].size;
+		if (sector_end > end)
+			break;
+		boundary = sector_end;
+	}
+	if (boundary <= image->sections[0].base_address)
+		return ERROR_OK;
+
+	retval = image_open(&head, "", "build");
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = image_split_below(image, boundary, &head);
+	if (retval == ERROR_OK && head.num_sections) {
+		if (!gdb_connection->vflash_streaming) {
+			target_call_event_callbacks(target,
+					TARGET_EVENT_GDB_FLASH_WRITE_START);
+			gdb_connection->vflash_streaming = true;
+		}
+		retval = flash_write(target, &head, &written, false);
+		if (retval == ERROR_OK)
+			LOG_DEBUG("streamed %u bytes below " TARGET_ADDR_FMT " to flash",
+					(unsigned int)written, boundary);
+	}
+
+	image_close(&head);
+	return retval;
+}
+
 static int gdb_v_packet(struct connection *connection,
 		char const *packet, int packet_size)
 {
@@ -3251,11 +4229,22 @@ static int gdb_v_packet(struct connection *connection,
 	struct target *target = get_target_from_connection(connection);
 
 	if (strncmp(packet, "vCont", 5) == 0) {
+		static char stripped[GDB_BUFFER_SIZE + 1];
 		bool handled;
 
 		packet += 5;
 		packet_size -= 5;
 
+		/* the non-stop code skips process ids itself */
+		if (gdb_connection->multiprocess && !gdb_connection->non_stop) {
+			if (gdb_mp_strip_pids(connection, packet, SIZE_MAX, stripped) != ERROR_OK) {
+				gdb_send_error(connection, 01);
+				return ERROR_OK;
+			}
+			packet = stripped;
+			packet_size = strlen(stripped);
+		}
+
 		handled = gdb_handle_vcont_packet(connection, packet, packet_size);
 		if (!handled)
 			gdb_put_packet(connection, "", 0);
@@ -3263,6 +4252,38 @@ static int gdb_v_packet(struct connection *connection,
 		return ERROR_OK;
 	}
 
+	if (strncmp(packet, "vStopped", 8) == 0 && gdb_connection->non_stop) {
+		gdb_nonstop_vstopped(connection);
+		return ERROR_OK;
+	}
+
+	if (strncmp(packet, "vAttach;", 8) == 0 && gdb_connection->multiprocess) {
+		if (gdb_mp_select(connection, strtoll(packet + 8, NULL, 16)) != ERROR_OK) {
+			gdb_send_error(connection, 01);
+			return ERROR_OK;
+		}
+
+		target = get_target_from_connection(connection);
+		LOG_TARGET_DEBUG(target, "GDB attaches to process %s", packet + 8);
+		if (target->state == TARGET_RUNNING) {
+			result = target_halt(target);
+			if (result == ERROR_OK)
+				result = target_wait_state(target, TARGET_HALTED, 1000);
+			if (result != ERROR_OK) {
+				gdb_send_error(connection, EFAULT);
+				return ERROR_OK;
+			}
+		}
+		gdb_signal_reply(target, connection);
+		return ERROR_OK;
+	}
+
+	if (strncmp(packet, "vKill;", 6) == 0 && gdb_connection->multiprocess) {
+		/* hardware can't be killed, GDB just forgets about the process */
+		gdb_put_packet(connection, "OK", 2);
+		return ERROR_OK;
+	}
+
 	if (strncmp(packet, "vRun", 4) == 0) {
 		bool handled;
 
@@ -3304,6 +4325,19 @@ static int gdb_v_packet(struct connection *connection,
 			return ERROR_SERVER_REMOTE_CLOSED;
 		}
 
+		/* every load starts with its erases, drop the state of a previous
+		 * load that was aborted without vFlashDone */
+		if (gdb_connection->vflash_streaming) {
+			target_call_event_callbacks(target, TARGET_EVENT_GDB_FLASH_WRITE_END);
+			gdb_connection->vflash_streaming = false;
+		}
+		gdb_connection->vflash_error = ERROR_OK;
+		if (gdb_connection->vflash_image) {
+			image_close(gdb_connection->vflash_image);
+			free(gdb_connection->vflash_image);
+			gdb_connection->vflash_image = NULL;
+		}
+
 		/* assume all sectors need erasing - stops any problems
 		 * when flash_write is called multiple times */
 		flash_set_dirty();
@@ -3366,8 +4400,22 @@ static int gdb_v_packet(struct connection *connection,
 		if (retval != ERROR_OK)
 			return retval;
 
+		/* a failed streamed write is reported on the next packet */
+		if (gdb_connection->vflash_error != ERROR_OK) {
+			gdb_send_error(connection, EIO);
+			return ERROR_OK;
+		}
+
 		gdb_put_packet(connection, "OK", 2);
 
+		if (gdb_flash_program_stream) {
+			retval = gdb_vflash_stream(connection);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("streamed flash write failed: %d", retval);
+				gdb_connection->vflash_error = retval;
+			}
+		}
+
 		return ERROR_OK;
 	}
 
@@ -3381,14 +4429,21 @@ static int gdb_v_packet(struct connection *connection,
 			return ERROR_OK;
 		}
 
-		/* process the flashing buffer. No need to erase as GDB
-		 * always issues a vFlashErase first. */
-		target_call_event_callbacks(target,
-				TARGET_EVENT_GDB_FLASH_WRITE_START);
-		result = flash_write(target, gdb_connection->vflash_image,
-			&written, false);
+		/* process the flashing buffer, or what is left of it after
+		 * streaming. No need to erase as GDB always issues a
+		 * vFlashErase first. */
+		if (!gdb_connection->vflash_streaming)
+			target_call_event_callbacks(target,
+					TARGET_EVENT_GDB_FLASH_WRITE_START);
+		result = gdb_connection->vflash_error;
+		written = 0;
+		if (result == ERROR_OK && gdb_connection->vflash_image->num_sections)
+			result = flash_write(target, gdb_connection->vflash_image,
+				&written, false);
 		target_call_event_callbacks(target,
 			TARGET_EVENT_GDB_FLASH_WRITE_END);
+		gdb_connection->vflash_streaming = false;
+		gdb_connection->vflash_error = ERROR_OK;
 		if (result != ERROR_OK) {
 			if (result == ERROR_FLASH_DST_OUT_OF_BANK)
 				gdb_put_packet(connection, "E.memtype", 9);
@@ -3506,8 +4561,6 @@ static int gdb_input_inner(struct connection *connection)
 	struct gdb_connection *gdb_con = connection->priv;
 	static bool warn_use_ext;
 
-	target = get_target_from_connection(connection);
-
 	/* drain input buffer. If one of the packets fail, then an error
 	 * packet is replied, if applicable.
 	 *
@@ -3528,22 +4581,35 @@ static int gdb_input_inner(struct connection *connection)
 		/* terminate with zero */
 		gdb_packet_buffer[packet_size] = '\0';
 
+		/* the previous packet may have selected another process */
+		target = get_target_from_connection(connection);
+
 		if (packet_size > 0) {
 
 			gdb_log_incoming_packet(connection, gdb_packet_buffer);
+			gdb_packet_counts[packet[0] & 0x7f]++;
 
 			retval = ERROR_OK;
 			switch (packet[0]) {
 				case 'T':	/* Is thread alive? */
-					gdb_thread_packet(connection, packet, packet_size);
+					if (gdb_con->multiprocess)
+						gdb_mp_thread_packet(connection, packet, packet_size);
+					else
+						gdb_thread_packet(connection, packet, packet_size);
 					break;
 				case 'H':	/* Set current thread ( 'c' for step and continue,
 							 * 'g' for all other operations ) */
-					gdb_thread_packet(connection, packet, packet_size);
+					if (gdb_con->multiprocess)
+						gdb_mp_thread_packet(connection, packet, packet_size);
+					else
+						gdb_thread_packet(connection, packet, packet_size);
 					break;
 				case 'q':
 				case 'Q':
-					retval = gdb_thread_packet(connection, packet, packet_size);
+					if (gdb_con->multiprocess)
+						retval = gdb_mp_thread_packet(connection, packet, packet_size);
+					else
+						retval = gdb_thread_packet(connection, packet, packet_size);
 					if (retval == GDB_THREAD_PACKET_NOT_CONSUMED)
 						retval = gdb_query_packet(connection, packet, packet_size);
 					break;
@@ -3560,6 +4626,7 @@ static int gdb_input_inner(struct connection *connection)
 					retval = gdb_set_register_packet(connection, packet, packet_size);
 					break;
 				case 'm':
+				case 'x':
 					gdb_con->output_flag = GDB_OUTPUT_NOTIF;
 					retval = gdb_read_memory_packet(connection, packet, packet_size);
 					gdb_con->output_flag = GDB_OUTPUT_NO;
@@ -3655,6 +4722,19 @@ static int gdb_input_inner(struct connection *connection)
 					retval = gdb_v_packet(connection, packet, packet_size);
 					break;
 				case 'D':
+					if (gdb_con->multiprocess && packet[1] == ';') {
+						/* one process is detached, the connection stays */
+						struct gdb_service *gdb_service = connection->service->priv;
+						int64_t pid = strtoll(packet + 2, NULL, 16);
+						if (pid <= 0 || (uint64_t)pid > gdb_service->num_processes) {
+							gdb_send_error(connection, 01);
+							break;
+						}
+						target_call_event_callbacks(gdb_service->processes[pid - 1]->target,
+								TARGET_EVENT_GDB_DETACH);
+						gdb_put_packet(connection, "OK", 2);
+						break;
+					}
 					retval = gdb_detach(connection);
 					break;
 				case 'X':
@@ -3720,6 +4800,7 @@ static int gdb_input_inner(struct connection *connection)
 		}
 
 		if (gdb_con->ctrl_c) {
+			target = get_target_from_connection(connection);
 			if (target->state == TARGET_RUNNING) {
 				struct target *t = target;
 				if (target->rtos)
@@ -3819,6 +4900,24 @@ static const struct service_driver gdb_service_driver = {
 	.keep_client_alive_handler = gdb_keep_client_alive,
 };
 
+static void gdb_service_init(struct gdb_service *gdb_service, struct target *target)
+{
+	gdb_service->target = target;
+	gdb_service->core[0] = -1;
+	gdb_service->core[1] = -1;
+	gdb_service->processes = NULL;
+	gdb_service->num_processes = 0;
+	target->gdb_service = gdb_service;
+
+	/* initialize all targets gdb service with the same pointer */
+	struct target_list *head;
+	foreach_smp_target(head, target->smp_targets) {
+		struct target *curr = head->target;
+		if (curr != target)
+			curr->gdb_service = gdb_service;
+	}
+}
+
 static int gdb_target_start(struct target *target, const char *port)
 {
 	struct gdb_service *gdb_service;
@@ -3830,21 +4929,9 @@ static int gdb_target_start(struct target *target, const char *port)
 
 	LOG_TARGET_INFO(target, "starting gdb server on %s", port);
 
-	gdb_service->target = target;
-	gdb_service->core[0] = -1;
-	gdb_service->core[1] = -1;
-	target->gdb_service = gdb_service;
+	gdb_service_init(gdb_service, target);
 
 	ret = add_service(&gdb_service_driver, port, target->gdb_max_connections, gdb_service);
-	/* initialize all targets gdb service with the same pointer */
-	{
-		struct target_list *head;
-		foreach_smp_target(head, target->smp_targets) {
-			struct target *curr = head->target;
-			if (curr != target)
-				curr->gdb_service = gdb_service;
-		}
-	}
 	return ret;
 }
 
@@ -3904,6 +4991,61 @@ static int gdb_target_add_one(struct target *target)
 	return retval;
 }
 
+/* One port for all the targets, each target or SMP group is a process */
+static int gdb_target_add_multiprocess(struct target *target)
+{
+	struct gdb_service *port_service = NULL;
+
+	if (strcmp(gdb_port_next, "disabled") == 0) {
+		LOG_INFO("gdb port disabled");
+		return ERROR_OK;
+	}
+
+	for (; target; target = target->next) {
+		if ((target->smp && target->gdb_service) || !target_supports_gdb_connection(target))
+			continue;
+
+		if (target->gdb_port_override && strcmp(target->gdb_port_override, "disabled") == 0) {
+			LOG_TARGET_INFO(target, "gdb port disabled");
+			continue;
+		}
+
+		struct gdb_service **processes = realloc(gdb_processes,
+				(gdb_num_processes + 1) * sizeof(*processes));
+		if (!processes) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		gdb_processes = processes;
+
+		if (!port_service) {
+			int retval = gdb_target_start(target, gdb_port_next);
+			if (retval != ERROR_OK)
+				return retval;
+			port_service = target->gdb_service;
+		} else {
+			struct gdb_service *gdb_service = malloc(sizeof(struct gdb_service));
+			if (!gdb_service) {
+				LOG_ERROR("Out of memory");
+				return ERROR_FAIL;
+			}
+			gdb_service_init(gdb_service, target);
+		}
+		gdb_processes[gdb_num_processes++] = target->gdb_service;
+
+		free(target->gdb_port_override);
+		target->gdb_port_override = strdup(gdb_port_next);
+		LOG_TARGET_INFO(target, "gdb process %u on port %s", gdb_num_processes, gdb_port_next);
+	}
+
+	if (port_service) {
+		port_service->processes = gdb_processes;
+		port_service->num_processes = gdb_num_processes;
+	}
+
+	return ERROR_OK;
+}
+
 int gdb_target_add_all(struct target *target)
 {
 	if (!target) {
@@ -3911,6 +5053,9 @@ int gdb_target_add_all(struct target *target)
 		return ERROR_OK;
 	}
 
+	if (gdb_multiprocess)
+		return gdb_target_add_multiprocess(target);
+
 	while (target) {
 		int retval = gdb_target_add_one(target);
 		if (retval != ERROR_OK)
@@ -3966,6 +5111,24 @@ COMMAND_HANDLER(handle_gdb_flash_program_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_gdb_flash_program_stream_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_ENABLE(CMD_ARGV[0], gdb_flash_program_stream);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_gdb_multiprocess_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_ENABLE(CMD_ARGV[0], gdb_multiprocess);
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_gdb_report_data_abort_command)
 {
 	if (CMD_ARGC != 1)
@@ -4097,6 +5260,21 @@ static const struct command_registration gdb_subcommand_handlers[] = {
 		.help = "enable or disable flash program",
 		.usage = "('enable'|'disable')"
 	},
+	{
+		.name = "flash_program_stream",
+		.handler = handle_gdb_flash_program_stream_command,
+		.mode = COMMAND_CONFIG,
+		.help = "enable or disable programming while vFlashWrite packets arrive",
+		.usage = "('enable'|'disable')"
+	},
+	{
+		.name = "multiprocess",
+		.handler = handle_gdb_multiprocess_command,
+		.mode = COMMAND_CONFIG,
+		.help = "enable or disable serving all targets on one port "
+			"as processes of the GDB multiprocess extensions",
+		.usage = "('enable'|'disable')"
+	},
 	{
 		.name = "report_data_abort",
 		.handler = handle_gdb_report_data_abort_command,
@@ -4158,9 +5336,21 @@ void gdb_service_free(void)
 {
 	free(gdb_port);
 	free(gdb_port_next);
+
+	/* the service of the first process is freed with the port */
+	for (unsigned int i = 1; i < gdb_num_processes; i++)
+		free(gdb_processes[i]);
+	free(gdb_processes);
+	gdb_processes = NULL;
+	gdb_num_processes = 0;
 }
 
 int gdb_get_actual_connections(void)
 {
 	return gdb_actual_connections;
 }
+
+uint64_t gdb_get_packet_count(char type)
+{
+	return gdb_packet_counts[type & 0x7f];
+}
@@ -31,12 +31,10 @@ void gdb_service_free(void);
 int gdb_put_packet(struct connection *connection, const char *buffer, int len);
 
 int gdb_get_actual_connections(void);
+/* Number of packets received whose first character is @a type */
+uint64_t gdb_get_packet_count(char type);
 
-static inline struct target *get_target_from_connection(struct connection *connection)
-{
-	struct gdb_service *gdb_service = connection->service->priv;
-	return gdb_service->target;
-}
+struct target *get_target_from_connection(struct connection *connection);
 
 #define ERROR_GDB_BUFFER_TOO_SMALL (-800)
 #define ERROR_GDB_TIMEOUT (-801)
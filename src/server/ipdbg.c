@@ -24,6 +24,12 @@
 #define IPDBG_MAX_DR_LENGTH 13
 #define IPDBG_TCP_PORT_STR_MAX_LENGTH 6
 #define IPDBG_SCRATCH_MEMORY_SIZE 1024
+/* the hub is polled every IPDBG_POLL_MS while busy, up to
+ * IPDBG_MAX_POLL_PERIOD times less often while idle */
+#define IPDBG_POLL_MS 2
+#define IPDBG_MAX_POLL_PERIOD 16
+/* batches of empty transfers per poll while the hub has data for us */
+#define IPDBG_MAX_DRAIN_BATCHES 64
 
 /* private connection data for IPDBG */
 struct ipdbg_fifo {
@@ -76,6 +82,9 @@ struct ipdbg_hub {
 	uint8_t data_register_length;
 	uint8_t dn_xoff;
 	uint8_t flow_control_enabled;
+	/* polls skipped between two transfers, grows while idle */
+	unsigned int poll_period;
+	unsigned int poll_countdown;
 	struct ipdbg_virtual_ir_info *virtual_ir;
 	struct ipdbg_hub_scratch_memory scratch_memory;
 };
@@ -354,12 +363,12 @@ static int ipdbg_shift_instr(struct ipdbg_hub *hub, uint32_t instr)
 
 	struct scan_field fields;
 	ipdbg_init_scan_field(&fields, NULL, tap->ir_length, ir_out_val);
+	/* queued only, the data transfers that follow flush the queue */
 	jtag_add_ir_scan(tap, &fields, TAP_IDLE);
-	int retval = jtag_execute_queue();
 
 	free(ir_out_val);
 
-	return retval;
+	return ERROR_OK;
 }
 
 static int ipdbg_shift_vir(struct ipdbg_hub *hub)
@@ -381,9 +390,8 @@ static int ipdbg_shift_vir(struct ipdbg_hub *hub)
 	ipdbg_init_scan_field(hub->scratch_memory.fields, NULL,
 		hub->virtual_ir->length, hub->scratch_memory.vir_out_val);
 	jtag_add_dr_scan(tap, 1, hub->scratch_memory.fields, TAP_IDLE);
-	retval = jtag_execute_queue();
 
-	return retval;
+	return ERROR_OK;
 }
 
 static int ipdbg_shift_data(struct ipdbg_hub *hub, uint32_t dn_data, uint32_t *up_data)
@@ -446,7 +454,7 @@ static void ipdbg_check_for_xoff(struct ipdbg_hub *hub, size_t tool,
 	hub->last_dn_tool = tool;
 }
 
-static int ipdbg_shift_empty_data(struct ipdbg_hub *hub)
+static int ipdbg_shift_empty_data(struct ipdbg_hub *hub, bool *got_data)
 {
 	if (!hub)
 		return ERROR_FAIL;
@@ -473,6 +481,8 @@ static int ipdbg_shift_empty_data(struct ipdbg_hub *hub)
 			up_data = buf_get_u32(hub->scratch_memory.dr_in_vals +
 									i * dreg_buffer_size, 0,
 									hub->data_register_length);
+			if (up_data & hub->valid_mask)
+				*got_data = true;
 			int rv = ipdbg_distribute_data_from_hub(hub, up_data);
 			if (rv != ERROR_OK)
 				retval = rv;
@@ -564,6 +574,12 @@ static int ipdbg_jtag_transfer_bytes(struct ipdbg_hub *hub,
 static int ipdbg_polling_callback(void *priv)
 {
 	struct ipdbg_hub *hub = priv;
+	bool active = false;
+
+	if (hub->poll_countdown) {
+		hub->poll_countdown--;
+		return ERROR_OK;
+	}
 
 	int ret = ipdbg_shift_vir(hub);
 	if (ret != ERROR_OK)
@@ -579,6 +595,7 @@ static int ipdbg_polling_callback(void *priv)
 		if (conn && conn->priv) {
 			struct ipdbg_connection *connection = conn->priv;
 			while (((hub->dn_xoff & BIT(tool)) == 0) && !ipdbg_fifo_is_empty(&connection->dn_fifo)) {
+				active = true;
 				if (hub->flow_control_enabled & BIT(tool))
 					ret = ipdbg_jtag_transfer_byte(hub, tool, connection);
 				else
@@ -589,10 +606,17 @@ static int ipdbg_polling_callback(void *priv)
 		}
 	}
 
-	/* some transfers to get data from jtag-hub in case there is no dn data */
-	ret = ipdbg_shift_empty_data(hub);
-	if (ret != ERROR_OK)
-		return ret;
+	/* some transfers to get data from jtag-hub in case there is no dn data,
+	 * more while the hub returns some, to drain its fifos */
+	for (unsigned int batch = 0; batch < IPDBG_MAX_DRAIN_BATCHES; batch++) {
+		bool got_data = false;
+		ret = ipdbg_shift_empty_data(hub, &got_data);
+		if (ret != ERROR_OK)
+			return ret;
+		if (!got_data)
+			break;
+		active = true;
+	}
 
 	/* write from up fifos to sockets */
 	for (size_t tool = 0; tool < hub->max_tools; ++tool) {
@@ -605,6 +629,13 @@ static int ipdbg_polling_callback(void *priv)
 		}
 	}
 
+	/* back off while nothing moves, new dn data resets the period */
+	if (active)
+		hub->poll_period = 1;
+	else if (hub->poll_period < IPDBG_MAX_POLL_PERIOD)
+		hub->poll_period *= 2;
+	hub->poll_countdown = hub->poll_period - 1;
+
 	return ERROR_OK;
 }
 
@@ -667,9 +698,11 @@ static int ipdbg_start_polling(struct ipdbg_service *service, struct connection
 
 	LOG_INFO("IPDBG start_polling");
 
-	const int time_ms = 20;
+	hub->poll_period = 1;
+	hub->poll_countdown = 0;
+
 	const int periodic = 1;
-	return target_register_timer_callback(ipdbg_polling_callback, time_ms, periodic, hub);
+	return target_register_timer_callback(ipdbg_polling_callback, IPDBG_POLL_MS, periodic, hub);
 }
 
 static int ipdbg_stop_polling(struct ipdbg_service *service)
@@ -726,6 +759,11 @@ static int ipdbg_on_connection_input(struct connection *connection)
 
 	fifo->count += bytes_read;
 
+	/* poll again right away */
+	struct ipdbg_service *service = connection->service->priv;
+	service->hub->poll_period = 1;
+	service->hub->poll_countdown = 0;
+
 	return ERROR_OK;
 }
 
@@ -0,0 +1,486 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/**
+ * @file
+ * Metrics server: exports the activity counters of the adapter, DAPs,
+ * targets, GDB server, RTT, SWO and flash banks in the Prometheus text
+ * format, so a long running OpenOCD can be watched by the usual monitoring
+ * tools.
+ *
+ * Any HTTP request gets the current snapshot of all the counters, after
+ * which the connection is closed. Counters are never reset by a scrape;
+ * 'jtag stats clear', 'flash stats clear' etc. still reset the ones they
+ * cover, which monitoring tools see as a counter reset.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "metrics_server.h"
+#include "gdb_server.h"
+#include <flash/nor/core.h>
+#include <jtag/jtag.h>
+#include <rtt/rtt.h>
+#include <target/arm_adi_v5.h>
+#include <target/arm_tpiu_swo.h>
+#include <target/target.h>
+
+/* requests longer than this are answered without reading the rest */
+#define METRICS_REQUEST_MAX		4096
+
+struct metrics_connection {
+	char request[METRICS_REQUEST_MAX];
+	size_t request_len;
+};
+
+/* text being built for a scrape */
+struct metrics_text {
+	char *data;
+	size_t len;
+	size_t size;
+	bool oom;
+};
+
+static char *metrics_port;
+
+static const char * const metrics_flash_op_names[FLASH_STATS_NUM] = {
+	[FLASH_STATS_PROTECT] = "protect",
+	[FLASH_STATS_ERASE] = "erase",
+	[FLASH_STATS_WRITE] = "write",
+	[FLASH_STATS_READ] = "read",
+	[FLASH_STATS_VERIFY] = "verify",
+};
+
+static void metrics_printf(struct metrics_text *text, const char *format, ...)
+	__attribute__ ((format (PRINTF_ATTRIBUTE_FORMAT, 2, 3)));
+
+static void metrics_printf(struct metrics_text *text, const char *format, ...)
+{
+	va_list ap;
+
+	if (text->oom)
+		return;
+
+	while (true) {
+		va_start(ap, format);
+		int len = vsnprintf(text->data + text->len, text->size - text->len, format, ap);
+		va_end(ap);
+
+		if (len < 0) {
+			text->oom = true;
+			return;
+		}
+		if ((size_t)len < text->size - text->len) {
+			text->len += len;
+			return;
+		}
+
+		size_t size = MAX(2 * text->size, text->len + len + 1);
+		char *data = realloc(text->data, size);
+		if (!data) {
+			text->oom = true;
+			return;
+		}
+		text->data = data;
+		text->size = size;
+	}
+}
+
+/* Print @a value as a label value, quoted and escaped */
+static void metrics_label(struct metrics_text *text, const char *value)
+{
+	metrics_printf(text, "\"");
+	for (const char *c = value; *c; c++) {
+		if (*c == '"' || *c == '\\')
+			metrics_printf(text, "\\%c", *c);
+		else if (*c == '\n')
+			metrics_printf(text, "\\n");
+		else
+			metrics_printf(text, "%c", *c);
+	}
+	metrics_printf(text, "\"");
+}
+
+static void metrics_header(struct metrics_text *text, const char *name,
+		const char *type, const char *help)
+{
+	metrics_printf(text, "# HELP openocd_%s %s\n", name, help);
+	metrics_printf(text, "# TYPE openocd_%s %s\n", name, type);
+}
+
+static void metrics_adapter(struct metrics_text *text)
+{
+	struct jtag_stats stats;
+
+	jtag_get_stats(&stats);
+
+	metrics_header(text, "jtag_queue_flushes_total", "counter",
+		"Executions of the JTAG command queue.");
+	metrics_printf(text, "openocd_jtag_queue_flushes_total %u\n", stats.flushes);
+	metrics_header(text, "jtag_queue_empty_flushes_total", "counter",
+		"Executions of the JTAG command queue with no command queued.");
+	metrics_printf(text, "openocd_jtag_queue_empty_flushes_total %u\n", stats.empty_flushes);
+	metrics_header(text, "adapter_commands_total", "counter",
+		"Commands handed over to the adapter driver.");
+	metrics_printf(text, "openocd_adapter_commands_total %" PRIu64 "\n", stats.commands);
+	metrics_header(text, "jtag_scan_bits_total", "counter",
+		"Bits shifted by IR and DR scans.");
+	metrics_printf(text, "openocd_jtag_scan_bits_total %" PRIu64 "\n", stats.scan_bits);
+	metrics_header(text, "jtag_clocks_total", "counter",
+		"TCK cycles of RUNTEST, STABLECLOCKS and TMS commands.");
+	metrics_printf(text, "openocd_jtag_clocks_total %" PRIu64 "\n", stats.clocks);
+
+	/* round_trips[i] counts the round trips up to 2^i us, the last one the others */
+	metrics_header(text, "adapter_round_trip_seconds", "histogram",
+		"Time spent waiting for the adapter per queue execution.");
+	uint64_t count = 0;
+	for (unsigned int i = 0; i < JTAG_STATS_ROUND_TRIP_BUCKETS - 1; i++) {
+		count += stats.round_trips[i];
+		metrics_printf(text, "openocd_adapter_round_trip_seconds_bucket{le=\"%g\"} %" PRIu64 "\n",
+			(double)(1u << i) / 1000000, count);
+	}
+	count += stats.round_trips[JTAG_STATS_ROUND_TRIP_BUCKETS - 1];
+	metrics_printf(text, "openocd_adapter_round_trip_seconds_bucket{le=\"+Inf\"} %" PRIu64 "\n", count);
+	metrics_printf(text, "openocd_adapter_round_trip_seconds_sum %.6f\n",
+		(double)stats.round_trip_total_us / 1000000);
+	metrics_printf(text, "openocd_adapter_round_trip_seconds_count %" PRIu64 "\n", count);
+}
+
+static void metrics_dap_counter(struct metrics_text *text, const char *name,
+		const char *help, uint64_t (*value)(const struct adiv5_dap_stats *stats))
+{
+	metrics_header(text, name, "counter", help);
+	for (struct adiv5_dap *dap = dap_get_next(NULL); dap; dap = dap_get_next(dap)) {
+		metrics_printf(text, "openocd_%s{dap=", name);
+		metrics_label(text, adiv5_dap_name(dap));
+		metrics_printf(text, "} %" PRIu64 "\n", value(&dap->stats));
+	}
+}
+
+static uint64_t dap_transactions(const struct adiv5_dap_stats *stats)
+{
+	return stats->transactions;
+}
+
+static uint64_t dap_runs(const struct adiv5_dap_stats *stats)
+{
+	return stats->runs;
+}
+
+static uint64_t dap_waits(const struct adiv5_dap_stats *stats)
+{
+	return stats->waits;
+}
+
+static uint64_t dap_faults(const struct adiv5_dap_stats *stats)
+{
+	return stats->faults;
+}
+
+static uint64_t dap_reconnects(const struct adiv5_dap_stats *stats)
+{
+	return stats->reconnects;
+}
+
+static void metrics_dap(struct metrics_text *text)
+{
+	if (!dap_get_next(NULL))
+		return;
+
+	metrics_dap_counter(text, "dap_transactions_total",
+		"DP and AP register accesses queued.", dap_transactions);
+	metrics_dap_counter(text, "dap_runs_total",
+		"Executions of the DAP transaction queue.", dap_runs);
+	metrics_dap_counter(text, "dap_waits_total",
+		"Queue executions which got a WAIT response.", dap_waits);
+	metrics_dap_counter(text, "dap_faults_total",
+		"Queue executions which failed.", dap_faults);
+	metrics_dap_counter(text, "dap_reconnects_total",
+		"Reconnections of the debug link after a failure.", dap_reconnects);
+
+	metrics_header(text, "dap_run_seconds_total", "counter",
+		"Time spent executing the DAP transaction queue.");
+	for (struct adiv5_dap *dap = dap_get_next(NULL); dap; dap = dap_get_next(dap)) {
+		metrics_printf(text, "openocd_dap_run_seconds_total{dap=");
+		metrics_label(text, adiv5_dap_name(dap));
+		metrics_printf(text, "} %.6f\n", (double)dap->stats.run_us / 1000000);
+	}
+}
+
+static void metrics_targets(struct metrics_text *text)
+{
+	struct target *target;
+
+	metrics_header(text, "target_polls_total", "counter", "Polls of the target state.");
+	for (target = all_targets; target; target = target->next) {
+		metrics_printf(text, "openocd_target_polls_total{target=");
+		metrics_label(text, target_name(target));
+		metrics_printf(text, "} %" PRIu64 "\n", target->polls);
+	}
+
+	metrics_header(text, "target_poll_errors_total", "counter", "Polls of the target state which failed.");
+	for (target = all_targets; target; target = target->next) {
+		metrics_printf(text, "openocd_target_poll_errors_total{target=");
+		metrics_label(text, target_name(target));
+		metrics_printf(text, "} %" PRIu64 "\n", target->poll_errors);
+	}
+
+	metrics_header(text, "target_halted", "gauge", "1 if the target is halted.");
+	for (target = all_targets; target; target = target->next) {
+		metrics_printf(text, "openocd_target_halted{target=");
+		metrics_label(text, target_name(target));
+		metrics_printf(text, "} %d\n", target->state == TARGET_HALTED);
+	}
+}
+
+static void metrics_gdb(struct metrics_text *text)
+{
+	metrics_header(text, "gdb_connections", "gauge", "Connected GDB clients.");
+	metrics_printf(text, "openocd_gdb_connections %d\n", gdb_get_actual_connections());
+
+	metrics_header(text, "gdb_packets_total", "counter",
+		"GDB packets received, by their first character.");
+	for (char type = '!'; type <= '~'; type++) {
+		uint64_t count = gdb_get_packet_count(type);
+		if (!count)
+			continue;
+		char label[2] = { type, '\0' };
+		metrics_printf(text, "openocd_gdb_packets_total{type=");
+		metrics_label(text, label);
+		metrics_printf(text, "} %" PRIu64 "\n", count);
+	}
+}
+
+static void metrics_rtt(struct metrics_text *text)
+{
+	const struct rtt_channel_poll *poll;
+
+	if (!rtt_get_channel_poll(0))
+		return;
+
+	metrics_header(text, "rtt_bytes_total", "counter", "Bytes read from the RTT up-channels.");
+	for (unsigned int i = 0; (poll = rtt_get_channel_poll(i)); i++)
+		metrics_printf(text, "openocd_rtt_bytes_total{channel=\"%u\"} %" PRIu64 "\n", i, poll->bytes);
+
+	metrics_header(text, "rtt_buffer_full_total", "counter",
+		"Reads which found the RTT up-channel buffer full, data may have been dropped.");
+	for (unsigned int i = 0; (poll = rtt_get_channel_poll(i)); i++)
+		metrics_printf(text, "openocd_rtt_buffer_full_total{channel=\"%u\"} %u\n", i, poll->full);
+}
+
+static void metrics_swo(struct metrics_text *text)
+{
+	struct arm_tpiu_swo_stats stats;
+	unsigned int i;
+
+	if (!arm_tpiu_swo_get_stats(0, &stats))
+		return;
+
+	metrics_header(text, "swo_bytes_total", "counter", "Bytes of trace data captured.");
+	for (i = 0; arm_tpiu_swo_get_stats(i, &stats); i++) {
+		metrics_printf(text, "openocd_swo_bytes_total{tpiu=");
+		metrics_label(text, stats.name);
+		metrics_printf(text, "} %" PRIu64 "\n", stats.trace_bytes);
+	}
+
+	metrics_header(text, "swo_busy_polls_total", "counter",
+		"Trace polls which left data in the adapter.");
+	for (i = 0; arm_tpiu_swo_get_stats(i, &stats); i++) {
+		metrics_printf(text, "openocd_swo_busy_polls_total{tpiu=");
+		metrics_label(text, stats.name);
+		metrics_printf(text, "} %u\n", stats.busy_polls);
+	}
+
+	metrics_header(text, "swo_itm_overflows_total", "counter",
+		"ITM overflow packets, trace data was dropped by the target.");
+	for (i = 0; arm_tpiu_swo_get_stats(i, &stats); i++) {
+		metrics_printf(text, "openocd_swo_itm_overflows_total{tpiu=");
+		metrics_label(text, stats.name);
+		metrics_printf(text, "} %u\n", stats.itm_overflows);
+	}
+}
+
+static void metrics_flash_bank_op(struct metrics_text *text, const char *name,
+		struct flash_bank *bank, unsigned int op)
+{
+	metrics_printf(text, "openocd_%s{bank=", name);
+	metrics_label(text, bank->name);
+	metrics_printf(text, ",op=\"%s\"}", metrics_flash_op_names[op]);
+}
+
+static void metrics_flash(struct metrics_text *text)
+{
+	unsigned int num_banks = flash_get_bank_count();
+	struct flash_bank *bank;
+
+	if (!num_banks)
+		return;
+
+	metrics_header(text, "flash_operations_total", "counter", "Flash operations.");
+	for (unsigned int i = 0; i < num_banks && (bank = get_flash_bank_by_num_noprobe(i)); i++) {
+		for (unsigned int op = 0; op < FLASH_STATS_NUM; op++) {
+			metrics_flash_bank_op(text, "flash_operations_total", bank, op);
+			metrics_printf(text, " %u\n", bank->stats[op].calls);
+		}
+	}
+
+	metrics_header(text, "flash_errors_total", "counter", "Flash operations which failed.");
+	for (unsigned int i = 0; i < num_banks && (bank = get_flash_bank_by_num_noprobe(i)); i++) {
+		for (unsigned int op = 0; op < FLASH_STATS_NUM; op++) {
+			metrics_flash_bank_op(text, "flash_errors_total", bank, op);
+			metrics_printf(text, " %u\n", bank->stats[op].errors);
+		}
+	}
+
+	metrics_header(text, "flash_bytes_total", "counter", "Bytes handled by flash operations.");
+	for (unsigned int i = 0; i < num_banks && (bank = get_flash_bank_by_num_noprobe(i)); i++) {
+		for (unsigned int op = 0; op < FLASH_STATS_NUM; op++) {
+			metrics_flash_bank_op(text, "flash_bytes_total", bank, op);
+			metrics_printf(text, " %" PRIu64 "\n", bank->stats[op].bytes);
+		}
+	}
+
+	metrics_header(text, "flash_seconds_total", "counter", "Time spent in flash operations.");
+	for (unsigned int i = 0; i < num_banks && (bank = get_flash_bank_by_num_noprobe(i)); i++) {
+		for (unsigned int op = 0; op < FLASH_STATS_NUM; op++) {
+			metrics_flash_bank_op(text, "flash_seconds_total", bank, op);
+			metrics_printf(text, " %.6f\n", (double)bank->stats[op].elapsed_us / 1000000);
+		}
+	}
+}
+
+static int metrics_reply(struct connection *connection)
+{
+	struct metrics_text body = { 0 };
+
+	metrics_adapter(&body);
+	metrics_dap(&body);
+	metrics_targets(&body);
+	metrics_gdb(&body);
+	metrics_rtt(&body);
+	metrics_swo(&body);
+	metrics_flash(&body);
+
+	if (body.oom) {
+		LOG_ERROR("metrics: out of memory");
+		free(body.data);
+		return ERROR_FAIL;
+	}
+
+	char *header = alloc_printf("HTTP/1.0 200 OK\r\n"
+		"Content-Type: text/plain; version=0.0.4\r\n"
+		"Content-Length: %zu\r\n"
+		"Connection: close\r\n\r\n", body.len);
+	if (!header) {
+		free(body.data);
+		return ERROR_FAIL;
+	}
+
+	int retval = connection_write(connection, header, strlen(header));
+	if (retval >= 0 && body.len)
+		retval = connection_write(connection, body.data, body.len);
+
+	free(header);
+	free(body.data);
+	return retval < 0 ? ERROR_FAIL : ERROR_OK;
+}
+
+static int metrics_new_connection(struct connection *connection)
+{
+	struct metrics_connection *mc = calloc(1, sizeof(*mc));
+	if (!mc)
+		return ERROR_CONNECTION_REJECTED;
+
+	connection->priv = mc;
+	return ERROR_OK;
+}
+
+static int metrics_input(struct connection *connection)
+{
+	struct metrics_connection *mc = connection->priv;
+
+	int rlen = connection_read(connection, mc->request + mc->request_len,
+			sizeof(mc->request) - mc->request_len - 1);
+	if (rlen <= 0) {
+		if (rlen < 0)
+			LOG_ERROR("metrics: error during read: %s", strerror(errno));
+		return ERROR_SERVER_REMOTE_CLOSED;
+	}
+	mc->request_len += rlen;
+	mc->request[mc->request_len] = '\0';
+
+	/* wait for the end of the HTTP request headers */
+	if (!strstr(mc->request, "\r\n\r\n") && !strstr(mc->request, "\n\n") &&
+			mc->request_len < sizeof(mc->request) - 1)
+		return ERROR_OK;
+
+	metrics_reply(connection);
+	return ERROR_SERVER_REMOTE_CLOSED;
+}
+
+static int metrics_closed(struct connection *connection)
+{
+	free(connection->priv);
+	connection->priv = NULL;
+	return ERROR_OK;
+}
+
+static const struct service_driver metrics_service_driver = {
+	.name = "metrics",
+	.new_connection_during_keep_alive_handler = NULL,
+	.new_connection_handler = metrics_new_connection,
+	.input_handler = metrics_input,
+	.connection_closed_handler = metrics_closed,
+	.keep_client_alive_handler = NULL,
+};
+
+int metrics_init(void)
+{
+	if (strcmp(metrics_port, "disabled") == 0) {
+		LOG_INFO("metrics server disabled");
+		return ERROR_OK;
+	}
+
+	return add_service(&metrics_service_driver, metrics_port, CONNECTION_LIMIT_UNLIMITED, NULL);
+}
+
+COMMAND_HANDLER(handle_metrics_port_command)
+{
+	return CALL_COMMAND_HANDLER(server_pipe_command, &metrics_port);
+}
+
+static const struct command_registration metrics_subcommand_handlers[] = {
+	{
+		.name = "port",
+		.handler = handle_metrics_port_command,
+		.mode = COMMAND_CONFIG,
+		.help = "Specify port on which to serve the metrics "
+			"in Prometheus text format, 'disabled' by default.  "
+			"Read help on 'gdb port'.",
+		.usage = "[port_num]",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration metrics_command_handlers[] = {
+	{
+		.name = "metrics",
+		.mode = COMMAND_ANY,
+		.help = "metrics server command group",
+		.usage = "",
+		.chain = metrics_subcommand_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int metrics_register_commands(struct command_context *cmd_ctx)
+{
+	metrics_port = strdup("disabled");
+	return register_commands(cmd_ctx, NULL, metrics_command_handlers);
+}
+
+void metrics_service_free(void)
+{
+	free(metrics_port);
+}
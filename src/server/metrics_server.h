@@ -0,0 +1,12 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_SERVER_METRICS_SERVER_H
+#define OPENOCD_SERVER_METRICS_SERVER_H
+
+#include <server/server.h>
+
+int metrics_init(void);
+int metrics_register_commands(struct command_context *cmd_ctx);
+void metrics_service_free(void);
+
+#endif /* OPENOCD_SERVER_METRICS_SERVER_H */
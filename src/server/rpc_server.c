@@ -0,0 +1,627 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/**
+ * @file
+ * Binary RPC server, an alternative to the Tcl server for clients that
+ * move a lot of memory: data is exchanged as raw bytes instead of being
+ * formatted to and parsed from Tcl lists.
+ *
+ * All the fields are little endian. A request is a frame:
+ *   u32 length of the rest of the frame, u32 id, u16 opcode, u16 flags,
+ *   opcode specific payload.
+ * Each request gets one reply, in the order of the requests:
+ *   u32 length, u32 id of the request, u16 opcode | RPC_REPLY, u16 flags,
+ *   s32 OpenOCD error code (0 on success), opcode specific payload.
+ * Clients can send several requests without waiting for the replies and
+ * match them with the id. Subscribed events are sent as frames with id 0
+ * and opcode RPC_EVENT, between the replies.
+ *
+ * Strings are u16 length followed by the characters, without NUL.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "rpc_server.h"
+#include <flash/nor/core.h>
+#include <target/register.h>
+#include <target/target.h>
+
+#define RPC_FRAME_HDR_SIZE		12
+#define RPC_REPLY_HDR_SIZE		16
+/* Largest memory transfer, and request */
+#define RPC_DATA_MAX			(1024 * 1024)
+#define RPC_FRAME_MAX			(RPC_DATA_MAX + 64)
+#define RPC_READ_SIZE			(64 * 1024)
+
+#define RPC_REPLY				0x8000
+#define RPC_EVENT				0xffff
+
+/* request flags */
+#define RPC_FLAG_PHYS			BIT(0)	/* memory: physical address */
+#define RPC_FLAG_ADDRESS		BIT(0)	/* resume: at given address */
+
+/* subscription mask */
+#define RPC_SUBSCRIBE_EVENTS	BIT(0)
+
+enum rpc_opcode {
+	/* -> u32 protocol version */
+	RPC_OP_VERSION = 0x00,
+	/* string target name or number -> */
+	RPC_OP_TARGET = 0x01,
+	/* -> u32 target state, as in enum target_state */
+	RPC_OP_STATE = 0x02,
+	/* u64 address, u32 width in bytes, u32 count -> data */
+	RPC_OP_READ_MEMORY = 0x10,
+	/* u64 address, u32 width in bytes, u32 count, data -> */
+	RPC_OP_WRITE_MEMORY = 0x11,
+	/* string name -> u32 size in bits, value */
+	RPC_OP_READ_REGISTER = 0x20,
+	/* string name, value -> */
+	RPC_OP_WRITE_REGISTER = 0x21,
+	/* u32 ms to wait for the halt, 0 no wait -> */
+	RPC_OP_HALT = 0x30,
+	/* [u64 address] -> */
+	RPC_OP_RESUME = 0x31,
+	/* u64 address, u32 length -> */
+	RPC_OP_FLASH_ERASE = 0x40,
+	/* u64 address, data -> */
+	RPC_OP_FLASH_WRITE = 0x41,
+	/* u32 mask of RPC_SUBSCRIBE_* -> */
+	RPC_OP_SUBSCRIBE = 0x50,
+	/* command line -> result text */
+	RPC_OP_COMMAND = 0x60,
+};
+
+#define RPC_VERSION				1
+
+struct rpc_connection {
+	uint8_t *in;
+	size_t in_len;
+	uint32_t subscriptions;
+	bool closing;
+};
+
+/* Request being processed, and the reply being built */
+struct rpc_request {
+	struct connection *connection;
+	uint32_t id;
+	uint16_t opcode;
+	uint16_t flags;
+	const uint8_t *payload;
+	size_t payload_len;
+	size_t pos;
+	uint8_t *reply;
+	size_t reply_len;
+};
+
+static char *rpc_port;
+
+static bool rpc_get_u32(struct rpc_request *req, uint32_t *value)
+{
+	if (req->payload_len - req->pos < 4)
+		return false;
+	*value = le_to_h_u32(req->payload + req->pos);
+	req->pos += 4;
+	return true;
+}
+
+static bool rpc_get_u64(struct rpc_request *req, uint64_t *value)
+{
+	if (req->payload_len - req->pos < 8)
+		return false;
+	*value = le_to_h_u64(req->payload + req->pos);
+	req->pos += 8;
+	return true;
+}
+
+/* Returns a NUL terminated copy of a string of the payload, to be freed */
+static char *rpc_get_string(struct rpc_request *req)
+{
+	if (req->payload_len - req->pos < 2)
+		return NULL;
+	size_t len = le_to_h_u16(req->payload + req->pos);
+	if (req->payload_len - req->pos - 2 < len)
+		return NULL;
+
+	char *str = malloc(len + 1);
+	if (!str)
+		return NULL;
+	memcpy(str, req->payload + req->pos + 2, len);
+	str[len] = '\0';
+	req->pos += 2 + len;
+	return str;
+}
+
+/* Makes room for @a len bytes of reply payload, returns where to write them */
+static uint8_t *rpc_reply_alloc(struct rpc_request *req, size_t len)
+{
+	uint8_t *reply = realloc(req->reply, RPC_REPLY_HDR_SIZE + req->reply_len + len);
+	if (!reply)
+		return NULL;
+
+	req->reply = reply;
+	uint8_t *data = reply + RPC_REPLY_HDR_SIZE + req->reply_len;
+	req->reply_len += len;
+	return data;
+}
+
+static int rpc_reply_u32(struct rpc_request *req, uint32_t value)
+{
+	uint8_t *data = rpc_reply_alloc(req, 4);
+	if (!data)
+		return ERROR_FAIL;
+	h_u32_to_le(data, value);
+	return ERROR_OK;
+}
+
+static int rpc_send(struct connection *connection, const uint8_t *frame, size_t len)
+{
+	if (connection_write(connection, frame, len) != (int)len) {
+		LOG_ERROR("rpc: error during write");
+		return ERROR_SERVER_REMOTE_CLOSED;
+	}
+	return ERROR_OK;
+}
+
+static int rpc_target_event_handler(struct target *target,
+		enum target_event event, void *priv)
+{
+	struct connection *connection = priv;
+	struct rpc_connection *rpcc = connection->priv;
+	const char *name = target_name(target);
+	size_t name_len = MIN(strlen(name), UINT16_MAX);
+	size_t len = RPC_REPLY_HDR_SIZE + 10 + name_len;
+
+	if (!(rpcc->subscriptions & RPC_SUBSCRIBE_EVENTS) || rpcc->closing)
+		return ERROR_OK;
+
+	uint8_t *frame = malloc(len);
+	if (!frame)
+		return ERROR_OK;
+
+	h_u32_to_le(frame, len - 4);
+	h_u32_to_le(frame + 4, 0);
+	h_u16_to_le(frame + 8, RPC_EVENT);
+	h_u16_to_le(frame + 10, 0);
+	h_u32_to_le(frame + 12, ERROR_OK);
+	h_u32_to_le(frame + 16, event);
+	h_u32_to_le(frame + 20, target->state);
+	h_u16_to_le(frame + 24, name_len);
+	memcpy(frame + 26, name, name_len);
+
+	if (rpc_send(connection, frame, len) != ERROR_OK)
+		rpcc->closing = true;
+	free(frame);
+
+	return ERROR_OK;
+}
+
+static int rpc_check_memory_args(struct rpc_request *req, target_addr_t *address,
+		uint32_t *width, uint32_t *count)
+{
+	uint64_t addr;
+
+	if (!rpc_get_u64(req, &addr) || !rpc_get_u32(req, width) || !rpc_get_u32(req, count))
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (*width != 1 && *width != 2 && *width != 4 && *width != 8)
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+
+	if (*count > RPC_DATA_MAX / *width)
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+
+	*address = addr;
+	return ERROR_OK;
+}
+
+static int rpc_read_memory(struct rpc_request *req, struct target *target)
+{
+	target_addr_t address;
+	uint32_t width, count;
+
+	int retval = rpc_check_memory_args(req, &address, &width, &count);
+	if (retval != ERROR_OK)
+		return retval;
+
+	uint8_t *data = rpc_reply_alloc(req, width * count);
+	if (!data)
+		return ERROR_FAIL;
+
+	if (req->flags & RPC_FLAG_PHYS)
+		retval = target_read_phys_memory(target, address, width, count, data);
+	else
+		retval = target_read_memory(target, address, width, count, data);
+
+	/* no partial data */
+	if (retval != ERROR_OK)
+		req->reply_len = 0;
+
+	return retval;
+}
+
+static int rpc_write_memory(struct rpc_request *req, struct target *target)
+{
+	target_addr_t address;
+	uint32_t width, count;
+
+	int retval = rpc_check_memory_args(req, &address, &width, &count);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (req->payload_len - req->pos != width * count)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	const uint8_t *data = req->payload + req->pos;
+	if (req->flags & RPC_FLAG_PHYS)
+		return target_write_phys_memory(target, address, width, count, data);
+
+	return target_write_memory(target, address, width, count, data);
+}
+
+static struct reg *rpc_get_register(struct rpc_request *req, struct target *target)
+{
+	char *name = rpc_get_string(req);
+	if (!name)
+		return NULL;
+
+	struct reg *reg = register_get_by_name(target->reg_cache, name, false);
+	if (!reg || !reg->exist)
+		LOG_DEBUG("rpc: unknown register '%s'", name);
+	free(name);
+
+	return (reg && reg->exist) ? reg : NULL;
+}
+
+static int rpc_read_register(struct rpc_request *req, struct target *target)
+{
+	struct reg *reg = rpc_get_register(req, target);
+	if (!reg)
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+
+	if (!reg->valid) {
+		int retval = reg->type->get(reg);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	size_t len = DIV_ROUND_UP(reg->size, 8);
+	uint8_t *data = rpc_reply_alloc(req, 4 + len);
+	if (!data)
+		return ERROR_FAIL;
+
+	h_u32_to_le(data, reg->size);
+	memcpy(data + 4, reg->value, len);
+
+	return ERROR_OK;
+}
+
+static int rpc_write_register(struct rpc_request *req, struct target *target)
+{
+	struct reg *reg = rpc_get_register(req, target);
+	if (!reg)
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+
+	if (req->payload_len - req->pos != DIV_ROUND_UP(reg->size, 8))
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	return reg->type->set(reg, (uint8_t *)req->payload + req->pos);
+}
+
+static int rpc_halt(struct rpc_request *req, struct target *target)
+{
+	uint32_t timeout_ms = 0;
+
+	if (req->pos < req->payload_len && !rpc_get_u32(req, &timeout_ms))
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	int retval = target_halt(target);
+	if (retval != ERROR_OK || timeout_ms == 0)
+		return retval;
+
+	return target_wait_state(target, TARGET_HALTED, timeout_ms);
+}
+
+static int rpc_resume(struct rpc_request *req, struct target *target)
+{
+	uint64_t address = 0;
+	bool current = !(req->flags & RPC_FLAG_ADDRESS);
+
+	if (!current && !rpc_get_u64(req, &address))
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	return target_resume(target, current, address, true, false);
+}
+
+static int rpc_flash_erase(struct rpc_request *req, struct target *target)
+{
+	uint64_t address;
+	uint32_t length;
+
+	if (!rpc_get_u64(req, &address) || !rpc_get_u32(req, &length))
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	return flash_erase_address_range(target, false, address, length);
+}
+
+static int rpc_flash_write(struct rpc_request *req, struct target *target)
+{
+	struct flash_bank *bank;
+	uint64_t address;
+
+	if (!rpc_get_u64(req, &address))
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	const uint8_t *data = req->payload + req->pos;
+	uint32_t length = req->payload_len - req->pos;
+
+	int retval = get_flash_bank_by_addr(target, address, true, &bank);
+	if (retval != ERROR_OK)
+		return retval;
+
+	uint32_t offset = address - bank->base;
+	if (offset + length < offset || offset + length > bank->size) {
+		LOG_ERROR("rpc: flash write beyond the end of bank '%s'", bank->name);
+		return ERROR_FLASH_DST_OUT_OF_BANK;
+	}
+
+	return flash_driver_write(bank, data, offset, length);
+}
+
+static int rpc_subscribe(struct rpc_request *req)
+{
+	struct rpc_connection *rpcc = req->connection->priv;
+	uint32_t mask;
+
+	if (!rpc_get_u32(req, &mask))
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	rpcc->subscriptions = mask & RPC_SUBSCRIBE_EVENTS;
+	return ERROR_OK;
+}
+
+static int rpc_command(struct rpc_request *req)
+{
+	struct command_context *cmd_ctx = req->connection->cmd_ctx;
+	int len;
+
+	char *line = malloc(req->payload_len + 1);
+	if (!line)
+		return ERROR_FAIL;
+	memcpy(line, req->payload, req->payload_len);
+	line[req->payload_len] = '\0';
+
+	int retval = command_run_line(cmd_ctx, line);
+	free(line);
+
+	const char *result = Jim_GetString(Jim_GetResult(cmd_ctx->interp), &len);
+	uint8_t *data = rpc_reply_alloc(req, len);
+	if (!data)
+		return ERROR_FAIL;
+	memcpy(data, result, len);
+
+	return retval;
+}
+
+static int rpc_select_target(struct rpc_request *req)
+{
+	char *name = rpc_get_string(req);
+	if (!name)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	struct target *target = get_target(name);
+	free(name);
+	if (!target)
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+
+	req->connection->cmd_ctx->current_target = target;
+	return ERROR_OK;
+}
+
+static int rpc_execute(struct rpc_request *req)
+{
+	switch (req->opcode) {
+	case RPC_OP_VERSION:
+		return rpc_reply_u32(req, RPC_VERSION);
+	case RPC_OP_TARGET:
+		return rpc_select_target(req);
+	case RPC_OP_SUBSCRIBE:
+		return rpc_subscribe(req);
+	case RPC_OP_COMMAND:
+		return rpc_command(req);
+	default:
+		break;
+	}
+
+	struct target *target = get_current_target_or_null(req->connection->cmd_ctx);
+	if (!target)
+		return ERROR_TARGET_INVALID;
+
+	switch (req->opcode) {
+	case RPC_OP_STATE:
+		return rpc_reply_u32(req, target->state);
+	case RPC_OP_READ_MEMORY:
+		return rpc_read_memory(req, target);
+	case RPC_OP_WRITE_MEMORY:
+		return rpc_write_memory(req, target);
+	case RPC_OP_READ_REGISTER:
+		return rpc_read_register(req, target);
+	case RPC_OP_WRITE_REGISTER:
+		return rpc_write_register(req, target);
+	case RPC_OP_HALT:
+		return rpc_halt(req, target);
+	case RPC_OP_RESUME:
+		return rpc_resume(req, target);
+	case RPC_OP_FLASH_ERASE:
+		return rpc_flash_erase(req, target);
+	case RPC_OP_FLASH_WRITE:
+		return rpc_flash_write(req, target);
+	default:
+		return ERROR_NOT_IMPLEMENTED;
+	}
+}
+
+/* Runs the request of a complete frame and queues the reply */
+static int rpc_process_frame(struct connection *connection, const uint8_t *frame, size_t len)
+{
+	struct rpc_request req = {
+		.connection = connection,
+		.id = le_to_h_u32(frame + 4),
+		.opcode = le_to_h_u16(frame + 8),
+		.flags = le_to_h_u16(frame + 10),
+		.payload = frame + RPC_FRAME_HDR_SIZE,
+		.payload_len = len - RPC_FRAME_HDR_SIZE,
+	};
+
+	int status = rpc_execute(&req);
+
+	/* the error path of the handlers above may have dropped the payload */
+	uint8_t *reply = realloc(req.reply, RPC_REPLY_HDR_SIZE + req.reply_len);
+	if (!reply) {
+		free(req.reply);
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	h_u32_to_le(reply, RPC_REPLY_HDR_SIZE - 4 + req.reply_len);
+	h_u32_to_le(reply + 4, req.id);
+	h_u16_to_le(reply + 8, req.opcode | RPC_REPLY);
+	h_u16_to_le(reply + 10, 0);
+	h_u32_to_le(reply + 12, status);
+
+	int retval = rpc_send(connection, reply, RPC_REPLY_HDR_SIZE + req.reply_len);
+	free(reply);
+	return retval;
+}
+
+static int rpc_new_connection(struct connection *connection)
+{
+	struct rpc_connection *rpcc = calloc(1, sizeof(*rpcc));
+	if (!rpcc)
+		return ERROR_CONNECTION_REJECTED;
+
+	rpcc->in = malloc(RPC_FRAME_MAX);
+	if (!rpcc->in) {
+		free(rpcc);
+		return ERROR_CONNECTION_REJECTED;
+	}
+
+	connection->priv = rpcc;
+	target_register_event_callback(rpc_target_event_handler, connection);
+
+	return ERROR_OK;
+}
+
+static int rpc_input(struct connection *connection)
+{
+	struct rpc_connection *rpcc = connection->priv;
+
+	if (rpcc->closing)
+		return ERROR_SERVER_REMOTE_CLOSED;
+
+	size_t room = MIN(RPC_FRAME_MAX - rpcc->in_len, RPC_READ_SIZE);
+	int rlen = connection_read(connection, rpcc->in + rpcc->in_len, room);
+	if (rlen <= 0) {
+		if (rlen < 0)
+			LOG_ERROR("rpc: error during read: %s", strerror(errno));
+		return ERROR_SERVER_REMOTE_CLOSED;
+	}
+	rpcc->in_len += rlen;
+
+	/* run all the complete requests, the replies leave in one write */
+	size_t pos = 0;
+	while (rpcc->in_len - pos >= 4) {
+		size_t len = 4 + (size_t)le_to_h_u32(rpcc->in + pos);
+		if (len < RPC_FRAME_HDR_SIZE || len > RPC_FRAME_MAX) {
+			LOG_ERROR("rpc: invalid frame length %zu, closing", len);
+			return ERROR_SERVER_REMOTE_CLOSED;
+		}
+		if (rpcc->in_len - pos < len)
+			break;
+
+		int retval = rpc_process_frame(connection, rpcc->in + pos, len);
+		if (retval != ERROR_OK || rpcc->closing)
+			return ERROR_SERVER_REMOTE_CLOSED;
+		pos += len;
+	}
+
+	memmove(rpcc->in, rpcc->in + pos, rpcc->in_len - pos);
+	rpcc->in_len -= pos;
+
+	return ERROR_OK;
+}
+
+static int rpc_closed(struct connection *connection)
+{
+	struct rpc_connection *rpcc = connection->priv;
+
+	target_unregister_event_callback(rpc_target_event_handler, connection);
+
+	if (rpcc) {
+		free(rpcc->in);
+		free(rpcc);
+		connection->priv = NULL;
+	}
+
+	return ERROR_OK;
+}
+
+static const struct service_driver rpc_service_driver = {
+	.name = "rpc",
+	.new_connection_during_keep_alive_handler = NULL,
+	.new_connection_handler = rpc_new_connection,
+	.input_handler = rpc_input,
+	.connection_closed_handler = rpc_closed,
+	.keep_client_alive_handler = NULL,
+};
+
+int rpc_init(void)
+{
+	if (strcmp(rpc_port, "disabled") == 0) {
+		LOG_INFO("rpc server disabled");
+		return ERROR_OK;
+	}
+
+	return add_service(&rpc_service_driver, rpc_port, CONNECTION_LIMIT_UNLIMITED, NULL);
+}
+
+COMMAND_HANDLER(handle_rpc_port_command)
+{
+	return CALL_COMMAND_HANDLER(server_pipe_command, &rpc_port);
+}
+
+static const struct command_registration rpc_subcommand_handlers[] = {
+	{
+		.name = "port",
+		.handler = handle_rpc_port_command,
+		.mode = COMMAND_CONFIG,
+		.help = "Specify port on which to listen "
+			"for incoming binary RPC requests, 'disabled' by default.  "
+			"Read help on 'gdb port'.",
+		.usage = "[port_num]",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration rpc_command_handlers[] = {
+	{
+		.name = "rpc",
+		.mode = COMMAND_ANY,
+		.help = "binary rpc server command group",
+		.usage = "",
+		.chain = rpc_subcommand_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int rpc_register_commands(struct command_context *cmd_ctx)
+{
+	rpc_port = strdup("disabled");
+	return register_commands(cmd_ctx, NULL, rpc_command_handlers);
+}
+
+void rpc_service_free(void)
+{
+	free(rpc_port);
+}
@@ -0,0 +1,12 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_SERVER_RPC_SERVER_H
+#define OPENOCD_SERVER_RPC_SERVER_H
+
+#include <server/server.h>
+
+int rpc_init(void);
+int rpc_register_commands(struct command_context *cmd_ctx);
+void rpc_service_free(void);
+
+#endif /* OPENOCD_SERVER_RPC_SERVER_H */
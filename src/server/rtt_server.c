@@ -29,7 +29,7 @@ struct rtt_service {
 };
 
 struct rtt_connection_data {
-	unsigned char buffer[64];
+	unsigned char buffer[1024];
 	unsigned int length;
 	unsigned int offset;
 };
@@ -16,12 +16,15 @@
 #endif
 
 #include "server.h"
+#include "server_event.h"
 #include <helper/time_support.h>
 #include <target/target.h>
 #include <target/target_request.h>
 #include <target/openrisc/jsp_server.h>
 #include "openocd.h"
 #include "tcl_server.h"
+#include "rpc_server.h"
+#include "metrics_server.h"
 #include "telnet_server.h"
 #include "ipdbg.h"
 
@@ -31,10 +34,27 @@
 #include <netdb.h>
 #endif
 
+#if defined(HAVE_POLL_H) && !defined(_WIN32)
+#include <poll.h>
+#endif
+
 #ifndef _WIN32
 #include <netinet/tcp.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 #endif
 
+/* Size of the per-connection output buffer. Larger writes are sent
+ * immediately, together with the pending output. */
+#define CONNECTION_WRITE_BUFFER_SIZE	8192
+
+/* Longest time output is kept in the buffer, in ms. Bounds the latency of
+ * log output while a command runs without going back to server_loop(). */
+#define CONNECTION_WRITE_DELAY_MS	20
+
+/* Longest time a flush waits for a stalled client, in ms */
+#define CONNECTION_WRITE_TIMEOUT_MS	5000
+
 static struct service *services;
 
 enum shutdown_reason {
@@ -48,12 +68,25 @@ static enum shutdown_reason shutdown_openocd = CONTINUE_MAIN_LOOP;
 /* store received signal to exit application by killing ourselves */
 static int last_signal;
 
-/* set the polling period to 100ms */
+/* Upper limit of the time server_loop() sleeps waiting for an event, in ms.
+ * When 0, the loop sleeps until the next target timer is due. Windows has no
+ * wakeup pipe for server_wakeup(), keep polling there. */
+#ifdef _WIN32
 static int polling_period = 100;
+#else
+static int polling_period;
+#endif
+
+/* pipe written by server_wakeup() to interrupt the wait in server_loop() */
+static int wakeup_fds[2] = { -1, -1 };
+static bool wakeup_readable;
+static volatile sig_atomic_t wakeup_pending;
 
 /* address by name on which to listen for incoming TCP/IP connections */
 static char *bindto_name;
 
+static int remove_connection(struct service *service, struct connection *connection);
+
 static int add_connection(struct service *service, struct command_context *cmd_ctx)
 {
 	socklen_t address_size;
@@ -68,6 +101,11 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 	c->cmd_ctx = copy_command_context(cmd_ctx);
 	c->service = service;
 	c->input_pending = false;
+	c->fd_readable = false;
+	c->write_buf = NULL;
+	c->write_len = 0;
+	c->write_time = 0;
+	c->write_error = false;
 	c->priv = NULL;
 	c->next = NULL;
 
@@ -91,9 +129,32 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 		LOG_INFO("accepting '%s' connection on tcp/%s", service->name, service->port);
 		retval = service->new_connection(c);
 		if (retval != ERROR_OK) {
+			connection_flush(c);
 			close_socket(c->fd);
 			LOG_ERROR("attempted '%s' connection rejected", service->name);
 			command_done(c->cmd_ctx);
+			free(c->write_buf);
+			free(c);
+			return retval;
+		}
+	} else if (service->type == CONNECTION_UNIX) {
+		c->fd = accept(service->fd, NULL, NULL);
+		c->fd_out = c->fd;
+		if (c->fd == -1) {
+			log_socket_error(service->name);
+			command_done(c->cmd_ctx);
+			free(c);
+			return ERROR_FAIL;
+		}
+
+		LOG_INFO("accepting '%s' connection on %s", service->name, service->port);
+		retval = service->new_connection(c);
+		if (retval != ERROR_OK) {
+			connection_flush(c);
+			close_socket(c->fd);
+			LOG_ERROR("attempted '%s' connection rejected", service->name);
+			command_done(c->cmd_ctx);
+			free(c->write_buf);
 			free(c);
 			return retval;
 		}
@@ -107,6 +168,7 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 #endif
 
 		/* do not check for new connections again on stdin */
+		server_event_del(service->fd);
 		service->fd = -1;
 
 		LOG_INFO("accepting '%s' connection from pipe", service->name);
@@ -114,12 +176,14 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 		if (retval != ERROR_OK) {
 			LOG_ERROR("attempted '%s' connection rejected", service->name);
 			command_done(c->cmd_ctx);
+			free(c->write_buf);
 			free(c);
 			return retval;
 		}
 	} else if (service->type == CONNECTION_PIPE) {
 		c->fd = service->fd;
 		/* do not check for new connections again on stdin */
+		server_event_del(service->fd);
 		service->fd = -1;
 
 		char *out_file = alloc_printf("%so", service->port);
@@ -137,6 +201,7 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 		if (retval != ERROR_OK) {
 			LOG_ERROR("attempted '%s' connection rejected", service->name);
 			command_done(c->cmd_ctx);
+			free(c->write_buf);
 			free(c);
 			return retval;
 		}
@@ -150,6 +215,13 @@ static int add_connection(struct service *service, struct command_context *cmd_c
 	if (service->max_connections != CONNECTION_LIMIT_UNLIMITED)
 		service->max_connections--;
 
+	retval = server_event_add(c->fd, &c->fd_readable);
+	if (retval != ERROR_OK) {
+		LOG_ERROR("cannot monitor '%s' connection", service->name);
+		remove_connection(service, c);
+		return retval;
+	}
+
 	return ERROR_OK;
 }
 
@@ -162,17 +234,21 @@ static int remove_connection(struct service *service, struct connection *connect
 	while ((c = *p)) {
 		if (c->fd == connection->fd) {
 			service->connection_closed(c);
-			if (service->type == CONNECTION_TCP)
+			connection_flush(c);
+			server_event_del(c->fd);
+			if (connection_is_socket(c))
 				close_socket(c->fd);
 			else if (service->type == CONNECTION_PIPE) {
 				/* The service will listen to the pipe again */
 				c->service->fd = c->fd;
+				server_event_add(c->service->fd, &c->service->fd_readable);
 			}
 
 			command_done(c->cmd_ctx);
 
 			/* delete connection */
 			*p = c->next;
+			free(c->write_buf);
 			free(c);
 
 			if (service->max_connections != CONNECTION_LIMIT_UNLIMITED)
@@ -195,6 +271,19 @@ static void free_service(struct service *c)
 	free(c);
 }
 
+/* Close the listening socket of a CONNECTION_UNIX service and remove its path */
+static void service_close_unix(struct service *c)
+{
+	if (c->fd == -1)
+		return;
+
+	close_socket(c->fd);
+	c->fd = -1;
+#ifndef _WIN32
+	unlink(c->port + strlen(CONNECTION_UNIX_PREFIX));
+#endif
+}
+
 int add_service(const struct service_driver *driver, const char *port,
 		int max_connections, void *priv)
 {
@@ -208,6 +297,7 @@ int add_service(const struct service_driver *driver, const char *port,
 	c->port = strdup(port);
 	c->max_connections = 1;	/* Only TCP/IP ports can support more than one connection */
 	c->fd = -1;
+	c->fd_readable = false;
 	c->connections = NULL;
 	c->new_connection_during_keep_alive = driver->new_connection_during_keep_alive_handler;
 	c->new_connection = driver->new_connection_handler;
@@ -219,6 +309,8 @@ int add_service(const struct service_driver *driver, const char *port,
 	long portnumber;
 	if (strcmp(c->port, "pipe") == 0)
 		c->type = CONNECTION_STDINOUT;
+	else if (strncmp(c->port, CONNECTION_UNIX_PREFIX, strlen(CONNECTION_UNIX_PREFIX)) == 0)
+		c->type = CONNECTION_UNIX;
 	else {
 		char *end;
 		portnumber = strtol(c->port, &end, 0);
@@ -297,6 +389,70 @@ int add_service(const struct service_driver *driver, const char *port,
 		if (getsockname(c->fd, (struct sockaddr *)&addr_in, &addr_in_size) == 0)
 			LOG_INFO("Listening on port %hu for %s connections",
 				 ntohs(addr_in.sin_port), c->name);
+	} else if (c->type == CONNECTION_UNIX) {
+#ifdef _WIN32
+		LOG_ERROR("Unix domain sockets currently not supported under this os");
+		free_service(c);
+		return ERROR_FAIL;
+#else
+		const char *path = c->port + strlen(CONNECTION_UNIX_PREFIX);
+		struct sockaddr_un addr;
+
+		if (!*path || strlen(path) >= sizeof(addr.sun_path)) {
+			LOG_ERROR("invalid unix socket path '%s' for %s", path, c->name);
+			free_service(c);
+			return ERROR_FAIL;
+		}
+
+		c->max_connections = max_connections;
+
+		c->fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (c->fd == -1) {
+			LOG_ERROR("error creating socket: %s", strerror(errno));
+			free_service(c);
+			return ERROR_FAIL;
+		}
+
+		socket_nonblock(c->fd);
+
+		memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		strcpy(addr.sun_path, path);
+
+		/* remove the socket left behind by a previous run, but never
+		 * take over the path from a server still listening on it */
+		int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (probe != -1) {
+			int connected = connect(probe, (struct sockaddr *)&addr, sizeof(addr));
+			int connect_errno = errno;
+			close_socket(probe);
+			if (connected == 0) {
+				LOG_ERROR("socket %s is in use by another process", path);
+				close_socket(c->fd);
+				free_service(c);
+				return ERROR_FAIL;
+			}
+			if (connect_errno == ECONNREFUSED)
+				unlink(path);
+		}
+
+		if (bind(c->fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+			LOG_ERROR("couldn't bind %s to socket %s: %s", c->name, path, strerror(errno));
+			close_socket(c->fd);
+			free_service(c);
+			return ERROR_FAIL;
+		}
+
+		if (listen(c->fd, 1) == -1) {
+			LOG_ERROR("couldn't listen on socket: %s", strerror(errno));
+			close_socket(c->fd);
+			unlink(path);
+			free_service(c);
+			return ERROR_FAIL;
+		}
+
+		LOG_INFO("Listening on %s for %s connections", path, c->name);
+#endif
 	} else if (c->type == CONNECTION_STDINOUT) {
 		c->fd = fileno(stdin);
 
@@ -329,6 +485,18 @@ int add_service(const struct service_driver *driver, const char *port,
 #endif
 	}
 
+	if (server_event_add(c->fd, &c->fd_readable) != ERROR_OK) {
+		LOG_ERROR("cannot monitor %s service", c->name);
+		if (c->type == CONNECTION_TCP)
+			close_socket(c->fd);
+		else if (c->type == CONNECTION_UNIX)
+			service_close_unix(c);
+		else if (c->type == CONNECTION_PIPE)
+			close(c->fd);
+		free_service(c);
+		return ERROR_FAIL;
+	}
+
 	/* add to the end of linked list */
 	for (p = &services; *p; p = &(*p)->next)
 		;
@@ -368,7 +536,10 @@ int remove_service(const char *name, const char *port)
 			else
 				prev->next = tmp->next;
 
-			if (tmp->type != CONNECTION_STDINOUT)
+			server_event_del(tmp->fd);
+			if (tmp->type == CONNECTION_UNIX)
+				service_close_unix(tmp);
+			else if (tmp->type != CONNECTION_STDINOUT)
 				close_socket(tmp->fd);
 
 			free(tmp->priv);
@@ -390,12 +561,15 @@ static int remove_services(void)
 		struct service *next = c->next;
 
 		remove_connections(c);
+		server_event_del(c->fd);
 
 		free(c->name);
 
 		if (c->type == CONNECTION_PIPE) {
 			if (c->fd != -1)
 				close(c->fd);
+		} else if (c->type == CONNECTION_UNIX) {
+			service_close_unix(c);
 		}
 		free(c->port);
 		free(c->priv);
@@ -407,16 +581,74 @@ static int remove_services(void)
 	}
 
 	services = NULL;
+	server_event_quit();
 
 	return ERROR_OK;
 }
 
+static void server_wakeup_init(void)
+{
+#ifndef _WIN32
+	if (pipe(wakeup_fds) == -1) {
+		LOG_WARNING("cannot create server wakeup pipe: %s", strerror(errno));
+		wakeup_fds[0] = -1;
+		wakeup_fds[1] = -1;
+		return;
+	}
+	socket_nonblock(wakeup_fds[0]);
+	socket_nonblock(wakeup_fds[1]);
+	if (server_event_add(wakeup_fds[0], &wakeup_readable) != ERROR_OK)
+		LOG_WARNING("cannot monitor server wakeup pipe");
+#endif
+	wakeup_pending = 0;
+}
+
+static void server_wakeup_quit(void)
+{
+	server_event_del(wakeup_fds[0]);
+	for (unsigned int i = 0; i < ARRAY_SIZE(wakeup_fds); i++) {
+		if (wakeup_fds[i] != -1)
+			close(wakeup_fds[i]);
+		wakeup_fds[i] = -1;
+	}
+}
+
+static void server_wakeup_drain(void)
+{
+	char buf[16];
+
+	wakeup_pending = 0;
+	while (read(wakeup_fds[0], buf, sizeof(buf)) > 0)
+		;
+}
+
+void server_wakeup(void)
+{
+	if (wakeup_fds[1] == -1 || wakeup_pending)
+		return;
+
+	wakeup_pending = 1;
+	/* the pipe is non-blocking, when full the loop is going to wake up anyway */
+	ssize_t written = write(wakeup_fds[1], "", 1);
+	(void)written;
+}
+
+static void server_flush_connections(void)
+{
+	for (struct service *s = services; s; s = s->next)
+		for (struct connection *c = s->connections; c; c = c->next)
+			connection_flush(c);
+}
+
 void server_keep_clients_alive(void)
 {
 	for (struct service *s = services; s; s = s->next)
 		if (s->keep_client_alive)
 			for (struct connection *c = s->connections; c; c = c->next)
 				s->keep_client_alive(c);
+
+	/* long running command, don't hold back its output */
+	server_flush_connections();
 }
 
 int server_loop(struct command_context *command_context)
@@ -425,10 +657,6 @@ int server_loop(struct command_context *command_context)
 
 	bool poll_ok = true;
 
-	/* used in select() */
-	fd_set read_fds;
-	int fd_max;
-
 	/* used in accept() */
 	int retval;
 
@@ -439,69 +667,45 @@ int server_loop(struct command_context *command_context)
 		LOG_ERROR("couldn't set SIGPIPE to SIG_IGN");
 #endif
 
-	while (shutdown_openocd == CONTINUE_MAIN_LOOP) {
-		/* monitor sockets for activity */
-		fd_max = 0;
-		FD_ZERO(&read_fds);
+	server_wakeup_init();
+	LOG_DEBUG("server event backend: %s", server_event_backend_name());
 
-		/* add service and connection fds to read_fds */
-		for (service = services; service; service = service->next) {
-			if (service->fd != -1) {
-				/* listen for new connections */
-				FD_SET(service->fd, &read_fds);
-
-				if (service->fd > fd_max)
-					fd_max = service->fd;
-			}
-
-			if (service->connections) {
-				struct connection *c;
-
-				for (c = service->connections; c; c = c->next) {
-					/* check for activity on the connection */
-					FD_SET(c->fd, &read_fds);
-					if (c->fd > fd_max)
-						fd_max = c->fd;
-				}
-			}
-		}
-
-		struct timeval tv;
-		tv.tv_sec = 0;
-		if (poll_ok) {
-			/* we're just polling this iteration, this is faster on embedded
-			 * hosts */
-			tv.tv_usec = 0;
-			retval = socket_select(fd_max + 1, &read_fds, NULL, NULL, &tv);
-		} else {
-			/* Timeout socket_select() when a target timer expires or every polling_period */
-			int timeout_ms = next_event - timeval_ms();
+	while (shutdown_openocd == CONTINUE_MAIN_LOOP) {
+		/* monitor sockets for activity, the backend keeps track of
+		 * service and connection fds as they are added and removed */
+		int timeout_ms = 0;
+		if (!poll_ok) {
+			/* Timeout when a target timer expires, when server_wakeup()
+			 * is called or, if set, after polling_period */
+			timeout_ms = next_event - timeval_ms();
 			if (timeout_ms < 0)
 				timeout_ms = 0;
-			else if (timeout_ms > polling_period)
+			else if (polling_period > 0 && timeout_ms > polling_period)
 				timeout_ms = polling_period;
-			tv.tv_usec = timeout_ms * 1000;
-			/* Only while we're sleeping we'll let others run */
-			retval = socket_select(fd_max + 1, &read_fds, NULL, NULL, &tv);
 		}
+		/* send what the previous iteration produced, in one go per connection */
+		server_flush_connections();
+		/* and write out the log before sleeping */
+		if (timeout_ms > 0)
+			log_flush();
+
+		/* we're just polling if timeout_ms is zero, this is faster on embedded
+		 * hosts. Only while we're sleeping we'll let others run */
+		retval = server_event_wait(timeout_ms);
 
 		if (retval == -1) {
 #ifdef _WIN32
 
 			errno = WSAGetLastError();
 
-			if (errno == WSAEINTR)
-				FD_ZERO(&read_fds);
-			else {
+			if (errno != WSAEINTR) {
 				LOG_ERROR("error during select: %s", strerror(errno));
 				return ERROR_FAIL;
 			}
 #else
 
-			if (errno == EINTR)
-				FD_ZERO(&read_fds);
-			else {
-				LOG_ERROR("error during select: %s", strerror(errno));
+			if (errno != EINTR) {
+				LOG_ERROR("error waiting for server events: %s", strerror(errno));
 				return ERROR_FAIL;
 			}
 #endif
@@ -517,8 +721,6 @@ int server_loop(struct command_context *command_context)
 			next_event = target_timer_next_event();
 			process_jim_events(command_context);
 
-			FD_ZERO(&read_fds);	/* eCos leaves read_fds unchanged in this case!  */
-
 			/* We timed out/there was nothing to do, timeout rather than poll next time
 			 **/
 			poll_ok = false;
@@ -534,14 +736,22 @@ int server_loop(struct command_context *command_context)
 		 */
 		poll_ok = poll_ok || target_got_message();
 
+		/* woken up by server_wakeup(); re-poll so that due timers run now */
+		if (wakeup_readable) {
+			wakeup_readable = false;
+			server_wakeup_drain();
+		}
+
 		for (service = services; service; service = service->next) {
 			/* handle new connections on listeners */
-			if ((service->fd != -1)
-				&& (FD_ISSET(service->fd, &read_fds))) {
+			if (service->fd != -1 && service->fd_readable) {
+				service->fd_readable = false;
 				if (service->max_connections != 0)
 					add_connection(service, command_context);
 				else {
-					if (service->type == CONNECTION_TCP) {
+					if (service->type == CONNECTION_UNIX) {
+						close_socket(accept(service->fd, NULL, NULL));
+					} else if (service->type == CONNECTION_TCP) {
 						struct sockaddr_in sin;
 						socklen_t address_size = sizeof(sin);
 						int tmp_fd;
@@ -561,8 +771,9 @@ int server_loop(struct command_context *command_context)
 				struct connection *c;
 
 				for (c = service->connections; c; ) {
-					if ((c->fd >= 0 && FD_ISSET(c->fd, &read_fds)) || c->input_pending) {
-						retval = service->input(c);
+					if ((c->fd >= 0 && c->fd_readable) || c->input_pending || c->write_error) {
+						c->fd_readable = false;
+						retval = c->write_error ? ERROR_SERVER_REMOTE_CLOSED : service->input(c);
 						if (retval != ERROR_OK) {
 							struct connection *next = c->next;
 							if (service->type == CONNECTION_PIPE ||
@@ -592,6 +803,8 @@ int server_loop(struct command_context *command_context)
 #endif
 	}
 
+	server_wakeup_quit();
+
 	/* when quit for signal or CTRL-C, run (eventually user implemented) "shutdown" */
 	if (shutdown_openocd == SHUTDOWN_WITH_SIGNAL_CODE)
 		command_run_line(command_context, "shutdown");
@@ -608,6 +821,10 @@ static void sig_handler(int sig)
 		LOG_DEBUG("Terminating on Signal %d", sig);
 	} else
 		LOG_DEBUG("Ignored extra Signal %d", sig);
+
+	/* the loop may sleep without timeout, with no timer due; a signal
+	 * received just before it goes to sleep must still end the wait */
+	server_wakeup();
 }
 
 
@@ -615,6 +832,7 @@ static void sig_handler(int sig)
 BOOL WINAPI control_handler(DWORD ctrl_type)
 {
 	shutdown_openocd = SHUTDOWN_WITH_SIGNAL_CODE;
+	server_wakeup();
 	return TRUE;
 }
 #else
@@ -685,6 +903,20 @@ int server_init(struct command_context *cmd_ctx)
 	if (ret != ERROR_OK)
 		return ret;
 
+	ret = rpc_init();
+
+	if (ret != ERROR_OK) {
+		remove_services();
+		return ret;
+	}
+
+	ret = metrics_init();
+
+	if (ret != ERROR_OK) {
+		remove_services();
+		return ret;
+	}
+
 	ret = telnet_init("Open On-Chip Debugger");
 
 	if (ret != ERROR_OK) {
@@ -713,6 +945,8 @@ int server_quit(void)
 void server_free(void)
 {
 	tcl_service_free();
+	rpc_service_free();
+	metrics_service_free();
 	telnet_service_free();
 	jsp_service_free();
 	ipdbg_server_free();
@@ -729,21 +963,138 @@ void exit_on_signal(int sig)
 #endif
 }
 
+/* Wait until the connection accepts more output, false on timeout or error */
+static bool connection_wait_writable(struct connection *connection)
+{
+#if defined(HAVE_POLL_H) && !defined(_WIN32)
+	/* no FD_SETSIZE limit on the descriptor, as in the server loop */
+	struct pollfd pfd = {
+		.fd = connection->fd_out,
+		.events = POLLOUT,
+	};
+
+	return poll(&pfd, 1, CONNECTION_WRITE_TIMEOUT_MS) > 0 && (pfd.revents & POLLOUT);
+#else
+	fd_set write_fds;
+	struct timeval tv;
+
+	FD_ZERO(&write_fds);
+	FD_SET(connection->fd_out, &write_fds);
+	tv.tv_sec = CONNECTION_WRITE_TIMEOUT_MS / 1000;
+	tv.tv_usec = (CONNECTION_WRITE_TIMEOUT_MS % 1000) * 1000;
+
+	if (connection_is_socket(connection))
+		return socket_select(connection->fd_out + 1, NULL, &write_fds, NULL, &tv) > 0;
+	return select(connection->fd_out + 1, NULL, &write_fds, NULL, &tv) > 0;
+#endif
+}
+
+static bool connection_write_would_block(void)
+{
+#ifdef _WIN32
+	return WSAGetLastError() == WSAEWOULDBLOCK || errno == EAGAIN;
+#else
+	return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+/* Send both buffers, handling partial writes on the non blocking socket */
+static int connection_write_all(struct connection *connection,
+		const char *data1, size_t len1, const char *data2, size_t len2)
+{
+	while (len1 + len2 > 0) {
+		ssize_t written;
+
+#ifdef _WIN32
+		const char *data = len1 ? data1 : data2;
+		size_t len = len1 ? len1 : len2;
+		if (connection_is_socket(connection))
+			written = write_socket(connection->fd_out, data, len);
+		else
+			written = write(connection->fd_out, data, len);
+#else
+		struct iovec iov[2] = {
+			{ .iov_base = (void *)data1, .iov_len = len1 },
+			{ .iov_base = (void *)data2, .iov_len = len2 },
+		};
+		written = len1 ? writev(connection->fd_out, iov, 2) : writev(connection->fd_out, iov + 1, 1);
+#endif
+
+		if (written < 0) {
+			if (connection_write_would_block() && connection_wait_writable(connection))
+				continue;
+			LOG_DEBUG("write to '%s' connection failed", connection->service->name);
+			connection->write_error = true;
+			return ERROR_SERVER_REMOTE_CLOSED;
+		}
+
+		size_t done = MIN((size_t)written, len1);
+		data1 += done;
+		len1 -= done;
+		written -= done;
+		data2 += written;
+		len2 -= written;
+	}
+
+	return ERROR_OK;
+}
+
+int connection_flush(struct connection *connection)
+{
+	if (!connection->write_len)
+		return connection->write_error ? ERROR_SERVER_REMOTE_CLOSED : ERROR_OK;
+
+	size_t len = connection->write_len;
+	connection->write_len = 0;
+	return connection_write_all(connection, connection->write_buf, len, NULL, 0);
+}
+
 int connection_write(struct connection *connection, const void *data, int len)
 {
-	if (len == 0) {
+	if (connection->write_error)
+		return -1;
+
+	if (len <= 0) {
 		/* successful no-op. Sockets and pipes behave differently here... */
 		return 0;
 	}
-	if (connection->service->type == CONNECTION_TCP)
-		return write_socket(connection->fd_out, data, len);
-	else
-		return write(connection->fd_out, data, len);
+
+	/* large payload: send it right away, behind the pending output */
+	if (connection->write_len + len > CONNECTION_WRITE_BUFFER_SIZE) {
+		size_t pending = connection->write_len;
+		connection->write_len = 0;
+		if (connection_write_all(connection, connection->write_buf, pending, data, len) != ERROR_OK)
+			return -1;
+		return len;
+	}
+
+	if (!connection->write_buf) {
+		connection->write_buf = malloc(CONNECTION_WRITE_BUFFER_SIZE);
+		if (!connection->write_buf) {
+			LOG_ERROR("Out of memory");
+			return -1;
+		}
+	}
+
+	if (!connection->write_len)
+		connection->write_time = timeval_ms();
+	memcpy(connection->write_buf + connection->write_len, data, len);
+	connection->write_len += len;
+
+	if (timeval_ms() - connection->write_time >= CONNECTION_WRITE_DELAY_MS &&
+			connection_flush(connection) != ERROR_OK)
+		return -1;
+
+	return len;
 }
 
 int connection_read(struct connection *connection, void *data, int len)
 {
-	if (connection->service->type == CONNECTION_TCP)
+	/* the peer may be waiting for our output before it sends anything */
+	if (connection_flush(connection) != ERROR_OK)
+		return -1;
+
+	if (connection_is_socket(connection))
 		return read_socket(connection->fd, data, len);
 	else
 		return read(connection->fd, data, len);
@@ -780,7 +1131,10 @@ COMMAND_HANDLER(handle_poll_period_command)
 	else
 		COMMAND_PARSE_NUMBER(int, CMD_ARGV[0], polling_period);
 
-	LOG_INFO("set servers polling period to %ums", polling_period);
+	if (polling_period > 0)
+		LOG_INFO("set servers polling period to %ums", polling_period);
+	else
+		LOG_INFO("servers wait for the next timer event");
 
 	return ERROR_OK;
 }
@@ -813,8 +1167,9 @@ static const struct command_registration server_command_handlers[] = {
 		.name = "poll_period",
 		.handler = &handle_poll_period_command,
 		.mode = COMMAND_ANY,
-		.usage = "",
-		.help = "set the servers polling period",
+		.usage = "period_ms",
+		.help = "set the maximum time the servers sleep waiting for "
+			"an event, 0 to wait for the next timer event",
 	},
 	{
 		.name = "bindto",
@@ -837,6 +1192,14 @@ int server_register_commands(struct command_context *cmd_ctx)
 	if (retval != ERROR_OK)
 		return retval;
 
+	retval = rpc_register_commands(cmd_ctx);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = metrics_register_commands(cmd_ctx);
+	if (retval != ERROR_OK)
+		return retval;
+
 	retval = jsp_register_commands(cmd_ctx);
 	if (retval != ERROR_OK)
 		return retval;
@@ -28,9 +28,14 @@
 enum connection_type {
 	CONNECTION_TCP,
 	CONNECTION_PIPE,
-	CONNECTION_STDINOUT
+	CONNECTION_STDINOUT,
+	/* AF_UNIX socket, the port is "unix:" followed by the socket path */
+	CONNECTION_UNIX
 };
 
+/* prefix of the port of CONNECTION_UNIX services */
+#define CONNECTION_UNIX_PREFIX			"unix:"
+
 #define CONNECTION_LIMIT_UNLIMITED		(-1)
 
 struct connection {
@@ -40,6 +45,15 @@ struct connection {
 	struct command_context *cmd_ctx;
 	struct service *service;
 	bool input_pending;
+	/* set by the server event backend when fd has input to read */
+	bool fd_readable;
+	/* output queued by connection_write(), see connection_flush() */
+	char *write_buf;
+	size_t write_len;
+	/* time the oldest byte in write_buf was queued */
+	int64_t write_time;
+	/* a write failed, the connection is going to be dropped */
+	bool write_error;
 	void *priv;
 	struct connection *next;
 };
@@ -70,6 +84,8 @@ struct service {
 	char *port;
 	unsigned short portnumber;
 	int fd;
+	/* set by the server event backend when fd has a connection to accept */
+	bool fd_readable;
 	struct sockaddr_in sin;
 	int max_connections;
 	struct connection *connections;
@@ -97,13 +113,38 @@ void exit_on_signal(int sig);
 
 void server_keep_clients_alive(void);
 
+/**
+ * Interrupt the wait for events in server_loop(), so that pending input and
+ * due timer callbacks are serviced immediately instead of at the next timer
+ * deadline. Drivers call it when data (e.g. trace or RTT) becomes available.
+ * It only writes to a pipe, thus it is safe to call from another thread or
+ * from a signal handler.
+ */
+void server_wakeup(void);
+
 int server_loop(struct command_context *command_context);
 
 int server_register_commands(struct command_context *context);
 
+/**
+ * Queue @a len bytes for the connection. The output is sent by the server
+ * loop, before reading from the connection, once enough data is pending or
+ * when it was queued for too long, in a single system call.
+ * @returns @a len or -1 if the connection failed
+ */
 int connection_write(struct connection *connection, const void *data, int len);
 int connection_read(struct connection *connection, void *data, int len);
 
+/** Send the output queued by connection_write() */
+int connection_flush(struct connection *connection);
+
+/** @returns true if the connection is a socket, TCP or AF_UNIX */
+static inline bool connection_is_socket(const struct connection *connection)
+{
+	return connection->service->type == CONNECTION_TCP ||
+		connection->service->type == CONNECTION_UNIX;
+}
+
 bool openocd_is_shutdown_pending(void);
 
 /**
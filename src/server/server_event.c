@@ -0,0 +1,355 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "server_event.h"
+#include <helper/log.h>
+#include <helper/replacements.h>
+
+#ifdef HAVE_POLL_H
+#include <poll.h>
+#endif
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
+/* Windows needs socket_select() to handle the console and pipes */
+#if defined(HAVE_POLL_H) && !defined(_WIN32)
+#define SERVER_EVENT_POLL
+#endif
+
+#if defined(HAVE_SYS_EPOLL_H) && !defined(_WIN32)
+#define SERVER_EVENT_EPOLL
+#endif
+
+/* number of events fetched from the kernel with a single epoll_wait() */
+#define EPOLL_MAX_EVENTS	32
+
+struct event_source {
+	int fd;
+	bool *ready;
+	/* the descriptor cannot be monitored (e.g. regular file), it is always readable */
+	bool always_ready;
+};
+
+struct event_backend {
+	const char *name;
+	int (*init)(void);
+	void (*quit)(void);
+	int (*add)(struct event_source *src);
+	void (*del)(struct event_source *src);
+	int (*wait)(int timeout_ms);
+};
+
+/* registrations, kept by all the backends */
+static struct event_source *sources;
+static unsigned int num_sources;
+static unsigned int max_sources;
+static unsigned int num_always_ready;
+
+static const struct event_backend *backend;
+
+static int select_add(struct event_source *src)
+{
+#ifndef _WIN32
+	if (src->fd >= FD_SETSIZE) {
+		LOG_ERROR("fd %d exceeds FD_SETSIZE (%d)", src->fd, FD_SETSIZE);
+		return ERROR_FAIL;
+	}
+#endif
+	return ERROR_OK;
+}
+
+static int select_wait(int timeout_ms)
+{
+	fd_set read_fds;
+	int fd_max = 0;
+
+	FD_ZERO(&read_fds);
+	for (unsigned int i = 0; i < num_sources; i++) {
+		FD_SET(sources[i].fd, &read_fds);
+		if (sources[i].fd > fd_max)
+			fd_max = sources[i].fd;
+	}
+
+	struct timeval tv;
+	tv.tv_sec = timeout_ms / 1000;
+	tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+	int retval = socket_select(fd_max + 1, &read_fds, NULL, NULL, &tv);
+	if (retval <= 0)
+		return retval;
+
+	for (unsigned int i = 0; i < num_sources; i++)
+		if (FD_ISSET(sources[i].fd, &read_fds))
+			*sources[i].ready = true;
+
+	return retval;
+}
+
+static const struct event_backend select_backend = {
+	.name = "select",
+	.add = select_add,
+	.wait = select_wait,
+};
+
+#ifdef SERVER_EVENT_POLL
+/* kept in the same order as sources[] */
+static struct pollfd *pollfds;
+
+static int poll_add(struct event_source *src)
+{
+	/* sources[] has already been grown to hold src */
+	struct pollfd *new_pollfds = realloc(pollfds, max_sources * sizeof(*pollfds));
+	if (!new_pollfds) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	pollfds = new_pollfds;
+
+	unsigned int index = src - sources;
+	pollfds[index].fd = src->fd;
+	pollfds[index].events = POLLIN;
+	pollfds[index].revents = 0;
+	return ERROR_OK;
+}
+
+static void poll_del(struct event_source *src)
+{
+	/* the caller fills the hole in sources[] with the last entry, do the same */
+	unsigned int index = src - sources;
+	pollfds[index] = pollfds[num_sources - 1];
+}
+
+static void poll_quit(void)
+{
+	free(pollfds);
+	pollfds = NULL;
+}
+
+static int poll_wait(int timeout_ms)
+{
+	int retval = poll(pollfds, num_sources, timeout_ms);
+	if (retval <= 0)
+		return retval;
+
+	int pending = retval;
+	for (unsigned int i = 0; i < num_sources && pending; i++) {
+		if (!pollfds[i].revents)
+			continue;
+		/* let the input handler detect hang-up and errors on read() */
+		*sources[i].ready = true;
+		pending--;
+	}
+
+	return retval;
+}
+
+static const struct event_backend poll_backend = {
+	.name = "poll",
+	.add = poll_add,
+	.del = poll_del,
+	.quit = poll_quit,
+	.wait = poll_wait,
+};
+#endif /* SERVER_EVENT_POLL */
+
+#ifdef SERVER_EVENT_EPOLL
+static int epoll_fd = -1;
+
+static int epoll_backend_init(void)
+{
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd == -1) {
+		LOG_DEBUG("epoll_create1() failed: %s", strerror(errno));
+		return ERROR_FAIL;
+	}
+	return ERROR_OK;
+}
+
+static void epoll_backend_quit(void)
+{
+	if (epoll_fd != -1)
+		close(epoll_fd);
+	epoll_fd = -1;
+}
+
+static int epoll_backend_add(struct event_source *src)
+{
+	struct epoll_event ev = {
+		.events = EPOLLIN,
+		.data.ptr = src->ready,
+	};
+
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, src->fd, &ev) == 0)
+		return ERROR_OK;
+
+	if (errno == EPERM) {
+		/* regular files, e.g. stdin redirected from a file, are always readable */
+		src->always_ready = true;
+		return ERROR_OK;
+	}
+
+	LOG_ERROR("epoll_ctl(ADD, %d) failed: %s", src->fd, strerror(errno));
+	return ERROR_FAIL;
+}
+
+static void epoll_backend_del(struct event_source *src)
+{
+	if (!src->always_ready)
+		epoll_ctl(epoll_fd, EPOLL_CTL_DEL, src->fd, NULL);
+}
+
+static int epoll_backend_wait(int timeout_ms)
+{
+	struct epoll_event events[EPOLL_MAX_EVENTS];
+	int ready = 0;
+
+	if (num_always_ready) {
+		for (unsigned int i = 0; i < num_sources; i++) {
+			if (sources[i].always_ready) {
+				*sources[i].ready = true;
+				ready++;
+			}
+		}
+		timeout_ms = 0;
+	}
+
+	int retval = epoll_wait(epoll_fd, events, EPOLL_MAX_EVENTS, timeout_ms);
+	if (retval < 0)
+		return ready ? ready : retval;
+
+	for (int i = 0; i < retval; i++)
+		*(bool *)events[i].data.ptr = true;
+
+	return ready + retval;
+}
+
+static const struct event_backend epoll_backend = {
+	.name = "epoll",
+	.init = epoll_backend_init,
+	.quit = epoll_backend_quit,
+	.add = epoll_backend_add,
+	.del = epoll_backend_del,
+	.wait = epoll_backend_wait,
+};
+#endif /* SERVER_EVENT_EPOLL */
+
+/* in order of preference */
+static const struct event_backend * const event_backends[] = {
+#ifdef SERVER_EVENT_EPOLL
+	&epoll_backend,
+#endif
+#ifdef SERVER_EVENT_POLL
+	&poll_backend,
+#endif
+	&select_backend,
+};
+
+int server_event_init(void)
+{
+	for (unsigned int i = 0; i < ARRAY_SIZE(event_backends); i++) {
+		if (event_backends[i]->init && event_backends[i]->init() != ERROR_OK)
+			continue;
+		backend = event_backends[i];
+		LOG_DEBUG("using '%s' server event backend", backend->name);
+		return ERROR_OK;
+	}
+
+	/* not reached, select() has no init */
+	return ERROR_FAIL;
+}
+
+void server_event_quit(void)
+{
+	if (backend && backend->quit)
+		backend->quit();
+	backend = NULL;
+
+	free(sources);
+	sources = NULL;
+	num_sources = 0;
+	max_sources = 0;
+	num_always_ready = 0;
+}
+
+const char *server_event_backend_name(void)
+{
+	return backend ? backend->name : "none";
+}
+
+int server_event_add(int fd, bool *ready)
+{
+	if (fd < 0)
+		return ERROR_OK;
+
+	if (!backend) {
+		int retval = server_event_init();
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	if (num_sources == max_sources) {
+		unsigned int new_max = max_sources ? 2 * max_sources : 16;
+		struct event_source *new_sources = realloc(sources, new_max * sizeof(*sources));
+		if (!new_sources) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		sources = new_sources;
+		max_sources = new_max;
+	}
+
+	struct event_source *src = &sources[num_sources];
+	src->fd = fd;
+	src->ready = ready;
+	src->always_ready = false;
+	*ready = false;
+
+	int retval = backend->add(src);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (src->always_ready)
+		num_always_ready++;
+	num_sources++;
+
+	return ERROR_OK;
+}
+
+void server_event_del(int fd)
+{
+	if (fd < 0)
+		return;
+
+	for (unsigned int i = 0; i < num_sources; i++) {
+		if (sources[i].fd != fd)
+			continue;
+
+		if (backend->del)
+			backend->del(&sources[i]);
+		if (sources[i].always_ready)
+			num_always_ready--;
+		*sources[i].ready = false;
+
+		sources[i] = sources[--num_sources];
+		return;
+	}
+}
+
+int server_event_wait(int timeout_ms)
+{
+	if (!backend) {
+		int retval = server_event_init();
+		if (retval != ERROR_OK)
+			return -1;
+	}
+
+	if (timeout_ms < 0)
+		timeout_ms = 0;
+
+	return backend->wait(timeout_ms);
+}
@@ -0,0 +1,48 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_SERVER_SERVER_EVENT_H
+#define OPENOCD_SERVER_SERVER_EVENT_H
+
+#include <stdbool.h>
+
+/**
+ * @file
+ * I/O readiness backend used by server_loop().
+ *
+ * File descriptors are registered once, when the service or connection
+ * owning them is created, and stay registered until it is removed. Each
+ * registration carries a pointer to a flag that server_event_wait() sets
+ * when the descriptor becomes readable; the consumer clears the flag after
+ * handling the input.
+ *
+ * Depending on the host, the backend is epoll, poll() or select(). The
+ * most efficient backend that initializes successfully is used, select()
+ * is always available as the last resort.
+ */
+
+int server_event_init(void);
+void server_event_quit(void);
+
+/** @returns the name of the backend selected by server_event_init() */
+const char *server_event_backend_name(void);
+
+/**
+ * Start monitoring @a fd for input.
+ * @param fd the file descriptor to monitor
+ * @param ready flag set to true by server_event_wait() when @a fd is readable;
+ * it must stay valid until server_event_del() is called for @a fd
+ */
+int server_event_add(int fd, bool *ready);
+
+/** Stop monitoring @a fd. Unknown or negative descriptors are ignored. */
+void server_event_del(int fd);
+
+/**
+ * Wait until at least one registered descriptor is readable or until
+ * @a timeout_ms elapsed. A timeout of 0 only polls.
+ * @returns the number of readable descriptors, 0 on timeout or -1 on error
+ * with errno (or WSAGetLastError() on Windows) describing the failure
+ */
+int server_event_wait(int timeout_ms);
+
+#endif /* OPENOCD_SERVER_SERVER_EVENT_H */
@@ -201,7 +201,10 @@ struct svf_check_tdo_para {
 	int bit_len;		/* bit length to check */
 };
 
-#define SVF_CHECK_TDO_PARA_SIZE 1024
+/* Checks collected before the queue is run, up to half of them per run.
+ * Files made of many short scans otherwise flush the queue for a few bytes
+ * each time, while the data buffer could take far more. */
+#define SVF_CHECK_TDO_PARA_SIZE 8192
 static struct svf_check_tdo_para *svf_check_tdo_para;
 static int svf_check_tdo_para_index;
 
@@ -219,6 +222,24 @@ static size_t svf_command_buffer_size;
 static int svf_line_number;
 static int svf_getline(char **lineptr, size_t *n, FILE *stream);
 
+/*
+ * Files written by svf_compile hold the commands as the parser returns
+ * them, comments and line breaks removed, upper case. All fields are
+ * little endian.
+ * - header: "OOCDSVFC", u32 version, u32 lines of the source file,
+ *   u32 number of commands.
+ * - commands: u32 line number in the source file, u32 length, text
+ *   without the ';'.
+ */
+#define SVF_COMPILED_MAGIC		"OOCDSVFC"
+#define SVF_COMPILED_VERSION	1
+#define SVF_COMPILED_HDR_SIZE	20
+#define SVF_COMPILED_REC_SIZE	8
+
+static bool svf_compiled;
+static uint32_t svf_compiled_left;
+static int svf_check_compiled(void);
+
 #define SVF_MAX_BUFFER_SIZE_TO_COMMIT   (1024 * 1024)
 static uint8_t *svf_tdi_buffer, *svf_tdo_buffer, *svf_mask_buffer;
 static int svf_buffer_index, svf_buffer_size;
@@ -465,7 +486,7 @@ COMMAND_HANDLER(handle_svf_command)
 			break;
 
 		default:
-			svf_fd = fopen(CMD_ARGV[i], "r");
+			svf_fd = fopen(CMD_ARGV[i], "rb");
 			if (!svf_fd) {
 				int err = errno;
 				command_print(CMD, "open(\"%s\"): %s", CMD_ARGV[i], strerror(err));
@@ -487,6 +508,11 @@ COMMAND_HANDLER(handle_svf_command)
 	svf_line_number = 0;
 	svf_command_buffer_size = 0;
 
+	if (svf_check_compiled() != ERROR_OK) {
+		ret = ERROR_FAIL;
+		goto free_all;
+	}
+
 	svf_check_tdo_para_index = 0;
 	svf_check_tdo_para = malloc(sizeof(struct svf_check_tdo_para) * SVF_CHECK_TDO_PARA_SIZE);
 	if (!svf_check_tdo_para) {
@@ -560,7 +586,7 @@ COMMAND_HANDLER(handle_svf_command)
 		}
 	}
 
-	if (svf_progress_enabled) {
+	if (svf_progress_enabled && !svf_compiled) {
 		/* Count total lines in file. */
 		while (!feof(svf_fd)) {
 			svf_getline(&svf_command_buffer, &svf_command_buffer_size, svf_fd);
@@ -579,11 +605,14 @@ COMMAND_HANDLER(handle_svf_command)
 				}
 			}
 		} else {
+			/* compiled files only have the command */
+			const char *line = svf_compiled ? svf_command_buffer : svf_read_line;
+			const char *line_end = svf_compiled ? ";\n" : "";
 			if (svf_progress_enabled) {
 				svf_percentage = ((svf_line_number * 20) / svf_total_lines) * 5;
-				LOG_USER_N("%3d%%  %s", svf_percentage, svf_read_line);
+				LOG_USER_N("%3d%%  %s%s", svf_percentage, line, line_end);
 			} else
-				LOG_USER_N("%s", svf_read_line);
+				LOG_USER_N("%s%s", line, line_end);
 		}
 		/* Run Command */
 		if (svf_run_command(CMD_CTX, svf_command_buffer) != ERROR_OK) {
@@ -594,7 +623,10 @@ COMMAND_HANDLER(handle_svf_command)
 		command_num++;
 	}
 
-	if ((!svf_nil) && (jtag_execute_queue() != ERROR_OK))
+	if (svf_compiled && svf_compiled_left) {
+		/* reported by svf_read_compiled_command() */
+		ret = ERROR_FAIL;
+	} else if ((!svf_nil) && (jtag_execute_queue() != ERROR_OK))
 		ret = ERROR_FAIL;
 	else if (svf_check_tdo() != ERROR_OK)
 		ret = ERROR_FAIL;
@@ -660,8 +692,8 @@ free_all:
 
 static int svf_getline(char **lineptr, size_t *n, FILE *stream)
 {
-#define MIN_CHUNK 16	/* Buffer is increased by this size each time as required */
-	size_t i = 0;
+#define MIN_CHUNK 256	/* Initial buffer size, doubled each time as required */
+	size_t len = 0;
 
 	if (!*lineptr) {
 		*n = MIN_CHUNK;
@@ -670,25 +702,87 @@ static int svf_getline(char **lineptr, size_t *n, FILE *stream)
 			return -1;
 	}
 
-	(*lineptr)[0] = fgetc(stream);
-	while ((*lineptr)[i] != '\n') {
-		(*lineptr)[++i] = fgetc(stream);
-		if (feof(stream)) {
-			(*lineptr)[0] = 0;
-			return -1;
+	while (fgets(*lineptr + len, *n - len, stream)) {
+		len += strlen(*lineptr + len);
+		if (len > 0 && (*lineptr)[len - 1] == '\n')
+			return len;
+
+		/* line longer than the buffer */
+		if (len + 1 == *n) {
+			char *line = realloc(*lineptr, 2 * *n);
+			if (!line)
+				break;
+			*lineptr = line;
+			*n *= 2;
 		}
-		if ((i + 2) > *n) {
-			*n += MIN_CHUNK;
-			*lineptr = realloc(*lineptr, *n);
+	}
+
+	/* end of file, a last line without line end is dropped */
+	(*lineptr)[0] = 0;
+	return -1;
+}
+
+#define SVFP_CMD_INC_CNT 1024
+
+/* Checks for a file written by svf_compile, else rewinds it for the parser */
+static int svf_check_compiled(void)
+{
+	uint8_t hdr[SVF_COMPILED_HDR_SIZE];
+
+	svf_compiled = false;
+	if (fread(hdr, 1, sizeof(hdr), svf_fd) != sizeof(hdr) ||
+			memcmp(hdr, SVF_COMPILED_MAGIC, strlen(SVF_COMPILED_MAGIC))) {
+		rewind(svf_fd);
+		return ERROR_OK;
+	}
+
+	if (le_to_h_u32(hdr + 8) != SVF_COMPILED_VERSION) {
+		LOG_ERROR("unsupported version %" PRIu32 " of compiled svf file", le_to_h_u32(hdr + 8));
+		return ERROR_FAIL;
+	}
+
+	svf_compiled = true;
+	svf_total_lines = le_to_h_u32(hdr + 12);
+	svf_compiled_left = le_to_h_u32(hdr + 16);
+
+	return ERROR_OK;
+}
+
+static int svf_read_compiled_command(void)
+{
+	uint8_t rec[SVF_COMPILED_REC_SIZE];
+
+	if (!svf_compiled_left)
+		return ERROR_FAIL;
+
+	if (fread(rec, 1, sizeof(rec), svf_fd) != sizeof(rec)) {
+		LOG_ERROR("compiled svf file truncated after line %d", svf_line_number);
+		return ERROR_FAIL;
+	}
+	svf_line_number = le_to_h_u32(rec);
+	uint32_t len = le_to_h_u32(rec + 4);
+
+	if (len + 1 > svf_command_buffer_size) {
+		size_t size = MAX(2 * svf_command_buffer_size, MAX(len + 1, SVFP_CMD_INC_CNT));
+		char *buffer = realloc(svf_command_buffer, size);
+		if (!buffer) {
+			LOG_ERROR("not enough memory");
+			return ERROR_FAIL;
 		}
+		svf_command_buffer = buffer;
+		svf_command_buffer_size = size;
 	}
 
-	(*lineptr)[++i] = 0;
+	if (fread(svf_command_buffer, 1, len, svf_fd) != len) {
+		LOG_ERROR("compiled svf file truncated at line %d", svf_line_number);
+		return ERROR_FAIL;
+	}
+	svf_command_buffer[len] = '\0';
+	svf_compiled_left--;
 
-	return sizeof(*lineptr);
+	return ERROR_OK;
 }
 
-#define SVFP_CMD_INC_CNT 1024
 static int svf_read_command_from_file(FILE *fd)
 {
 	unsigned char ch;
@@ -696,6 +790,9 @@ static int svf_read_command_from_file(FILE *fd)
 	size_t cmd_pos = 0;
 	int cmd_ok = 0, slash = 0;
 
+	if (svf_compiled)
+		return svf_read_compiled_command();
+
 	if (svf_getline(&svf_read_line, &svf_read_line_size, svf_fd) <= 0)
 		return ERROR_FAIL;
 	svf_line_number++;
@@ -749,12 +846,14 @@ static int svf_read_command_from_file(FILE *fd)
 				 *  - terminating NUL ('\0')
 				 */
 				if (cmd_pos + 3 > svf_command_buffer_size) {
-					svf_command_buffer = realloc(svf_command_buffer, cmd_pos + 3);
-					svf_command_buffer_size = cmd_pos + 3;
-					if (!svf_command_buffer) {
+					size_t size = MAX(2 * svf_command_buffer_size, SVFP_CMD_INC_CNT);
+					char *buffer = realloc(svf_command_buffer, size);
+					if (!buffer) {
 						LOG_ERROR("not enough memory");
 						return ERROR_FAIL;
 					}
+					svf_command_buffer = buffer;
+					svf_command_buffer_size = size;
 				}
 
 				/* insert a space before '(' */
@@ -861,6 +960,17 @@ static int svf_set_padding(struct svf_xxr_para *para, int len, unsigned char tdi
 	return error;
 }
 
+#define SVF_HEX_SPACE 0xFF
+
+/* Value + 1 of the hex digits, SVF_HEX_SPACE for whitespace, 0 for anything else */
+static const uint8_t svf_hex_digit[256] = {
+	['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+	['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+	['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+	[' '] = SVF_HEX_SPACE, ['\t'] = SVF_HEX_SPACE, ['\n'] = SVF_HEX_SPACE,
+	['\v'] = SVF_HEX_SPACE, ['\f'] = SVF_HEX_SPACE, ['\r'] = SVF_HEX_SPACE,
+};
+
 static int svf_copy_hexstring_to_binary(char *str, uint8_t **bin, int orig_bit_len, int bit_len)
 {
 	int i, str_len = strlen(str), str_hbyte_len = (bit_len + 3) >> 2;
@@ -875,7 +985,7 @@ static int svf_copy_hexstring_to_binary(char *str, uint8_t **bin, int orig_bit_l
 	for (i = 0; i < str_hbyte_len; i++) {
 		ch = 0;
 		while (str_len > 0) {
-			ch = str[--str_len];
+			uint8_t digit = svf_hex_digit[(uint8_t)str[--str_len]];
 
 			/* Skip whitespace.  The SVF specification (rev E) is
 			 * deficient in terms of basic lexical issues like
@@ -883,20 +993,14 @@ static int svf_copy_hexstring_to_binary(char *str, uint8_t **bin, int orig_bit_l
 			 * require line ends for correctness, since there is
 			 * a hard limit on line length.
 			 */
-			if (!isspace(ch)) {
-				if ((ch >= '0') && (ch <= '9')) {
-					ch = ch - '0';
-					break;
-				} else if ((ch >= 'A') && (ch <= 'F')) {
-					ch = ch - 'A' + 10;
-					break;
-				} else {
-					LOG_ERROR("invalid hex string");
-					return ERROR_FAIL;
-				}
+			if (digit == SVF_HEX_SPACE)
+				continue;
+			if (!digit) {
+				LOG_ERROR("invalid hex string");
+				return ERROR_FAIL;
 			}
-
-			ch = 0;
+			ch = digit - 1;
+			break;
 		}
 
 		/* write bin */
@@ -912,7 +1016,7 @@ static int svf_copy_hexstring_to_binary(char *str, uint8_t **bin, int orig_bit_l
 
 	/* consume optional leading '0' MSBs or whitespace */
 	while (str_len > 0 && ((str[str_len - 1] == '0')
-			|| isspace((int) str[str_len - 1])))
+			|| svf_hex_digit[(uint8_t)str[str_len - 1]] == SVF_HEX_SPACE))
 		str_len--;
 
 	/* check validity: we must have consumed everything */
@@ -979,6 +1083,25 @@ static int svf_execute_tap(void)
 	return ERROR_OK;
 }
 
+/* Commit the queued scans without waiting for them when no TDO is checked,
+ * so the adapter shifts them while the next commands are parsed. Failures
+ * are reported by the next svf_execute_tap(). */
+static int svf_submit_tap(void)
+{
+	for (int i = 0; i < svf_check_tdo_para_index; i++)
+		if (svf_check_tdo_para[i].enabled)
+			return svf_execute_tap();
+
+	if (!svf_nil)
+		jtag_submit_queue();
+
+	/* the scans keep copies of their TDI data, the buffer can be reused */
+	svf_check_tdo_para_index = 0;
+	svf_buffer_index = 0;
+
+	return ERROR_OK;
+}
+
 static int svf_run_command(struct command_context *cmd_ctx, char *cmd_str)
 {
 	char *argus[256], command;
@@ -1623,12 +1746,83 @@ xxr_common:
 				(svf_check_tdo_para_index >= SVF_CHECK_TDO_PARA_SIZE / 2)) &&
 				(((command != STATE) && (command != RUNTEST)) ||
 						((command == STATE) && (num_of_argu == 2))))
-			return svf_execute_tap();
+			return svf_submit_tap();
 	}
 
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_svf_compile_command)
+{
+	uint8_t hdr[SVF_COMPILED_HDR_SIZE], rec[SVF_COMPILED_REC_SIZE];
+	uint32_t commands = 0;
+	int ret = ERROR_OK;
+
+	if (CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	svf_fd = fopen(CMD_ARGV[0], "rb");
+	if (!svf_fd) {
+		command_print(CMD, "open(\"%s\"): %s", CMD_ARGV[0], strerror(errno));
+		return ERROR_FAIL;
+	}
+
+	FILE *out = fopen(CMD_ARGV[1], "wb");
+	if (!out) {
+		command_print(CMD, "open(\"%s\"): %s", CMD_ARGV[1], strerror(errno));
+		fclose(svf_fd);
+		svf_fd = NULL;
+		return ERROR_FAIL;
+	}
+
+	svf_compiled = false;
+	svf_line_number = 0;
+	svf_command_buffer_size = 0;
+
+	/* the header is completed at the end */
+	memset(hdr, 0, sizeof(hdr));
+	if (fwrite(hdr, 1, sizeof(hdr), out) != sizeof(hdr))
+		ret = ERROR_FAIL;
+
+	while (ret == ERROR_OK && svf_read_command_from_file(svf_fd) == ERROR_OK) {
+		size_t len = strlen(svf_command_buffer);
+
+		h_u32_to_le(rec, svf_line_number);
+		h_u32_to_le(rec + 4, len);
+		if (fwrite(rec, 1, sizeof(rec), out) != sizeof(rec) ||
+				fwrite(svf_command_buffer, 1, len, out) != len)
+			ret = ERROR_FAIL;
+		commands++;
+	}
+
+	if (ret == ERROR_OK) {
+		memcpy(hdr, SVF_COMPILED_MAGIC, strlen(SVF_COMPILED_MAGIC));
+		h_u32_to_le(hdr + 8, SVF_COMPILED_VERSION);
+		h_u32_to_le(hdr + 12, svf_line_number);
+		h_u32_to_le(hdr + 16, commands);
+		if (fseek(out, 0, SEEK_SET) != 0 || fwrite(hdr, 1, sizeof(hdr), out) != sizeof(hdr))
+			ret = ERROR_FAIL;
+	}
+	if (fclose(out) != 0)
+		ret = ERROR_FAIL;
+
+	fclose(svf_fd);
+	svf_fd = NULL;
+	free(svf_command_buffer);
+	svf_command_buffer = NULL;
+	svf_command_buffer_size = 0;
+
+	if (ret != ERROR_OK) {
+		command_print(CMD, "write to \"%s\" failed", CMD_ARGV[1]);
+		return ret;
+	}
+
+	command_print(CMD, "%" PRIu32 " commands of %d lines written to \"%s\"",
+		commands, svf_line_number, CMD_ARGV[1]);
+
+	return ERROR_OK;
+}
+
 static const struct command_registration svf_command_handlers[] = {
 	{
 		.name = "svf",
@@ -1637,6 +1831,13 @@ static const struct command_registration svf_command_handlers[] = {
 		.help = "Runs a SVF file.",
 		.usage = "[-tap device.tap] [-quiet] [-nil] [-progress] [-ignore_error] [-noreset] [-addcycles numcycles] file",
 	},
+	{
+		.name = "svf_compile",
+		.handler = handle_svf_compile_command,
+		.mode = COMMAND_ANY,
+		.help = "Converts a SVF file to the compact form run faster by the svf command.",
+		.usage = "svf_file compiled_file",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -127,6 +127,7 @@ static int aarch64_mmu_modify(struct target *target, int enable)
 	int retval = ERROR_OK;
 	enum arm_mode target_mode = ARM_MODE_ANY;
 	uint32_t instr = 0;
+	uint64_t system_control_reg_prev = aarch64->system_control_reg_curr;
 
 	if (enable) {
 		/*	if mmu enabled at target stop and mmu not enable */
@@ -149,6 +150,10 @@ static int aarch64_mmu_modify(struct target *target, int enable)
 		}
 	}
 
+	/* translations depend on SCTLR */
+	if (aarch64->system_control_reg_curr != system_control_reg_prev)
+		armv8_mmu_flush_va_cache(armv8);
+
 	switch (armv8->arm.core_mode) {
 	case ARMV8_64_EL0T:
 		target_mode = ARMV8_64_EL1H;
@@ -207,6 +212,52 @@ static int aarch64_read_prsr(struct target *target, uint32_t *prsr)
 	return ERROR_OK;
 }
 
+/*
+ * Read PRSR of all the examined PEs of the SMP group. The reads are queued
+ * and flushed with one DAP run, the values are left in prsr_smp.
+ */
+static int aarch64_read_prsr_smp(struct target *target)
+{
+	struct target_list *head;
+	struct adiv5_dap *dap = NULL;
+	int retval = ERROR_OK;
+
+	foreach_smp_target(head, target->smp_targets) {
+		struct target *curr = head->target;
+		struct armv8_common *armv8 = target_to_armv8(curr);
+
+		if (!target_was_examined(curr))
+			continue;
+
+		/* PEs behind different DAPs, flush the previous one first */
+		if (dap && dap != armv8->debug_ap->dap) {
+			retval = dap_run(dap);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+		dap = armv8->debug_ap->dap;
+
+		retval = mem_ap_read_u32(armv8->debug_ap,
+				armv8->debug_base + CPUV8_DBG_PRSR, &target_to_aarch64(curr)->prsr_smp);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	if (dap)
+		retval = dap_run(dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	foreach_smp_target(head, target->smp_targets) {
+		struct target *curr = head->target;
+
+		if (target_was_examined(curr))
+			target_to_armv8(curr)->sticky_reset |= target_to_aarch64(curr)->prsr_smp & PRSR_SR;
+	}
+
+	return ERROR_OK;
+}
+
 /*
  * Basic debug access, very low level assumes state is saved
  */
@@ -431,16 +482,17 @@ static int aarch64_halt_smp(struct target *target, bool exc_target)
 		struct target_list *head;
 		struct target *curr;
 
-		foreach_smp_target(head, target->smp_targets) {
-			int halted;
+		retval = aarch64_read_prsr_smp(target);
+		if (retval != ERROR_OK)
+			break;
 
+		foreach_smp_target(head, target->smp_targets) {
 			curr = head->target;
 
 			if (!target_was_examined(curr))
 				continue;
 
-			retval = aarch64_check_state_one(curr, PRSR_HALT, PRSR_HALT, &halted, NULL);
-			if (retval != ERROR_OK || !halted) {
+			if (!(target_to_aarch64(curr)->prsr_smp & PRSR_HALT)) {
 				all_halted = false;
 				break;
 			}
@@ -550,7 +602,7 @@ static int aarch64_poll(struct target *target)
 			if (retval != ERROR_OK)
 				return retval;
 
-			if (target->smp)
+			if (target->smp && !target->smp_nonstop)
 				update_halt_gdb(target, debug_reason);
 
 			if (arm_semihosting(target, &retval) != 0)
@@ -817,9 +869,12 @@ static int aarch64_step_restart_smp(struct target *target)
 		struct target *curr = target;
 		bool all_resumed = true;
 
+		retval = aarch64_read_prsr_smp(target);
+		if (retval != ERROR_OK)
+			break;
+
 		foreach_smp_target(head, target->smp_targets) {
 			uint32_t prsr;
-			int resumed;
 
 			curr = head->target;
 
@@ -829,9 +884,12 @@ static int aarch64_step_restart_smp(struct target *target)
 			if (!target_was_examined(curr))
 				continue;
 
-			retval = aarch64_check_state_one(curr,
-					PRSR_SDR, PRSR_SDR, &resumed, &prsr);
-			if (retval != ERROR_OK || (!resumed && (prsr & PRSR_HALT))) {
+			/* SDR is cleared by the read, don't look again at a restarted PE */
+			if (curr->state == TARGET_RUNNING)
+				continue;
+
+			prsr = target_to_aarch64(curr)->prsr_smp;
+			if (!(prsr & PRSR_SDR) && (prsr & PRSR_HALT)) {
 				all_resumed = false;
 				break;
 			}
@@ -979,6 +1037,9 @@ static int aarch64_debug_entry(struct target *target)
 	enum arm_state core_state;
 	uint32_t dscr;
 
+	/* the translation tables may have changed while running */
+	armv8_mmu_flush_va_cache(armv8);
+
 	/* make sure to clear all sticky errors */
 	retval = mem_ap_write_atomic_u32(armv8->debug_ap,
 			armv8->debug_base + CPUV8_DBG_DRCR, DRCR_CSE);
@@ -2155,14 +2216,13 @@ static int aarch64_write_cpu_memory_fast(struct target *target,
 
 	armv8_reg_current(arm, 1)->dirty = true;
 
-	/* Step 1.d   - Change DCC to memory mode */
+	/* Step 1.d   - Change DCC to memory mode, queued with the data */
 	*dscr |= DSCR_MA;
-	retval =  mem_ap_write_atomic_u32(armv8->debug_ap,
+	retval =  mem_ap_write_u32(armv8->debug_ap,
 			armv8->debug_base + CPUV8_DBG_DSCR, *dscr);
 	if (retval != ERROR_OK)
 		return retval;
 
-
 	/* Step 2.a   - Do the write */
 	retval = mem_ap_write_buf_noincr(armv8->debug_ap,
 					buffer, 4, count, armv8->debug_base + CPUV8_DBG_DTRRX);
@@ -2319,15 +2379,15 @@ static int aarch64_read_cpu_memory_slow(struct target *target,
 		if (retval != ERROR_OK)
 			return retval;
 
-		retval = mem_ap_read_atomic_u32(armv8->debug_ap,
+		/* one run for both halves of a doubleword */
+		higher = 0;
+		retval = mem_ap_read_u32(armv8->debug_ap,
 				armv8->debug_base + CPUV8_DBG_DTRTX, &lower);
-		if (retval == ERROR_OK) {
-			if (size > 4)
-				retval = mem_ap_read_atomic_u32(armv8->debug_ap,
-						armv8->debug_base + CPUV8_DBG_DTRRX, &higher);
-			else
-				higher = 0;
-		}
+		if (retval == ERROR_OK && size > 4)
+			retval = mem_ap_read_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DTRRX, &higher);
+		if (retval == ERROR_OK)
+			retval = dap_run(armv8->debug_ap->dap);
 		if (retval != ERROR_OK)
 			return retval;
 
@@ -2373,15 +2433,16 @@ static int aarch64_read_cpu_memory_fast(struct target *target,
 	if (retval != ERROR_OK)
 		return retval;
 
-	/* Step 1.e - Change DCC to memory mode */
+	/* Step 1.e - Change DCC to memory mode
+	 * Steps 1.e and 1.f are queued and run with the data reads */
 	*dscr |= DSCR_MA;
-	retval =  mem_ap_write_atomic_u32(armv8->debug_ap,
+	retval =  mem_ap_write_u32(armv8->debug_ap,
 			armv8->debug_base + CPUV8_DBG_DSCR, *dscr);
 	if (retval != ERROR_OK)
 		return retval;
 
 	/* Step 1.f - read DBGDTRTX and discard the value */
-	retval = mem_ap_read_atomic_u32(armv8->debug_ap,
+	retval = mem_ap_read_u32(armv8->debug_ap,
 			armv8->debug_base + CPUV8_DBG_DTRTX, &value);
 	if (retval != ERROR_OK)
 		return retval;
@@ -2404,14 +2465,16 @@ static int aarch64_read_cpu_memory_fast(struct target *target,
 
 	/* Step 3.a - set DTR access mode back to Normal mode	*/
 	*dscr &= ~DSCR_MA;
-	retval =  mem_ap_write_atomic_u32(armv8->debug_ap,
+	retval =  mem_ap_write_u32(armv8->debug_ap,
 					armv8->debug_base + CPUV8_DBG_DSCR, *dscr);
 	if (retval != ERROR_OK)
 		return retval;
 
 	/* Step 3.b - read DBGDTRTX for the final value */
-	retval = mem_ap_read_atomic_u32(armv8->debug_ap,
+	retval = mem_ap_read_u32(armv8->debug_ap,
 			armv8->debug_base + CPUV8_DBG_DTRTX, &value);
+	if (retval == ERROR_OK)
+		retval = dap_run(armv8->debug_ap->dap);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -2553,6 +2616,9 @@ static int aarch64_write_phys_memory(struct target *target,
 	int retval = ERROR_COMMAND_SYNTAX_ERROR;
 
 	if (count && buffer) {
+		/* the write may modify the translation tables */
+		armv8_mmu_flush_va_cache(target_to_armv8(target));
+
 		/* write memory through APB-AP */
 		retval = aarch64_mmu_modify(target, 0);
 		if (retval != ERROR_OK)
@@ -2569,6 +2635,9 @@ static int aarch64_write_memory(struct target *target, target_addr_t address,
 	int mmu_enabled = 0;
 	int retval;
 
+	/* the write may modify the translation tables */
+	armv8_mmu_flush_va_cache(target_to_armv8(target));
+
 	/* determine if MMU was enabled on target stop */
 	retval = aarch64_mmu(target, &mmu_enabled);
 	if (retval != ERROR_OK)
@@ -3149,6 +3218,9 @@ COMMAND_HANDLER(aarch64_mcrmrc_command)
 		int retval = arm->mcr(target, cpnum, op1, op2, crn, crm, value);
 		if (retval != ERROR_OK)
 			return retval;
+
+		/* the translation regime may have changed */
+		armv8_mmu_flush_va_cache(target_to_armv8(target));
 	} else {
 		value = 0;
 		/* NOTE: parameters reordered! */
@@ -58,6 +58,9 @@ struct aarch64_common {
 	struct aarch64_brp *wp_list;
 
 	enum aarch64_isrmasking_mode isrmasking_mode;
+
+	/* PRSR sampled by aarch64_read_prsr_smp() */
+	uint32_t prsr_smp;
 };
 
 static inline struct aarch64_common *
@@ -27,6 +27,7 @@
 
 #include "arm.h"
 #include "arm_adi_v5.h"
+#include <helper/event_trace.h>
 #include <helper/time_support.h>
 #include <helper/list.h>
 #include <jtag/swd.h>
@@ -126,14 +127,41 @@ struct dap_cmd {
 
 #define MAX_DAP_COMMAND_NUM 65536
 
+/* dap_cmd objects are allocated this many at a time */
+#define DAP_CMD_BLOCK_NUM 256
+
 struct dap_cmd_pool {
 	struct list_head lh;
 	struct dap_cmd cmd;
 };
 
-static void log_dap_cmd(struct adiv5_dap *dap, const char *header, struct dap_cmd *el)
+struct dap_cmd_block {
+	struct list_head lh;
+	struct dap_cmd_pool entries[DAP_CMD_BLOCK_NUM];
+};
+
+/* Step of the journal processing a command is logged at, also in the event trace */
+enum dap_cmd_stage {
+	DAP_CMD_STAGE_LOG,
+	DAP_CMD_STAGE_ERR,
+	DAP_CMD_STAGE_PND,
+	DAP_CMD_STAGE_FND,
+	DAP_CMD_STAGE_LST,
+	DAP_CMD_STAGE_REP,
+	DAP_CMD_STAGE_REC,
+};
+
+static void log_dap_cmd(struct adiv5_dap *dap, enum dap_cmd_stage stage, struct dap_cmd *el)
 {
+	EVENT_TRACE(EVENT_TRACE_DAP, EVENT_TRACE_DAP_JTAG_CMD, stage, el->instr, el->reg_addr,
+		el->rnw, buf_get_u32(el->outvalue_buf, 0, 32), buf_get_u32(el->invalue, 0, 32),
+		el->ack);
+
 #ifdef DEBUG_WAIT
+	static const char * const stage_name[] = {
+		"LOG", "ERR", "PND", "FND", "LST", "REP", "REC",
+	};
+	const char *header = stage_name[stage];
 	const char *ack;
 	switch (el->ack) {
 	case JTAG_ACK_WAIT:         /* ADIv5 and ADIv6 */
@@ -183,14 +211,18 @@ static struct dap_cmd *dap_cmd_new(struct adiv5_dap *dap, uint8_t instr,
 	struct dap_cmd_pool *pool = NULL;
 
 	if (list_empty(&dap->cmd_pool)) {
-		pool = calloc(1, sizeof(struct dap_cmd_pool));
-		if (!pool)
+		/* refill the pool with a whole block, entries are never freed one by one */
+		struct dap_cmd_block *block = calloc(1, sizeof(struct dap_cmd_block));
+		if (!block)
 			return NULL;
-	} else {
-		pool = list_first_entry(&dap->cmd_pool, struct dap_cmd_pool, lh);
-		list_del(&pool->lh);
+		list_add(&block->lh, &dap->cmd_blocks);
+		for (unsigned int i = 0; i < DAP_CMD_BLOCK_NUM; i++)
+			list_add_tail(&block->entries[i].lh, &dap->cmd_pool);
 	}
 
+	pool = list_first_entry(&dap->cmd_pool, struct dap_cmd_pool, lh);
+	list_del(&pool->lh);
+
 	INIT_LIST_HEAD(&pool->lh);
 	dap->cmd_pool_size++;
 
@@ -210,11 +242,9 @@ static struct dap_cmd *dap_cmd_new(struct adiv5_dap *dap, uint8_t instr,
 static void dap_cmd_release(struct adiv5_dap *dap, struct dap_cmd *cmd)
 {
 	struct dap_cmd_pool *pool = container_of(cmd, struct dap_cmd_pool, cmd);
-	if (dap->cmd_pool_size > MAX_DAP_COMMAND_NUM)
-		free(pool);
-	else
-		list_add(&pool->lh, &dap->cmd_pool);
 
+	/* last released is first reused, while it is still in the cache */
+	list_add(&pool->lh, &dap->cmd_pool);
 	dap->cmd_pool_size--;
 }
 
@@ -230,13 +260,14 @@ static void flush_journal(struct adiv5_dap *dap, struct list_head *lh)
 
 static void jtag_quit(struct adiv5_dap *dap)
 {
-	struct dap_cmd_pool *el, *tmp;
-	struct list_head *lh = &dap->cmd_pool;
+	struct dap_cmd_block *el, *tmp;
+	struct list_head *lh = &dap->cmd_blocks;
 
 	list_for_each_entry_safe(el, tmp, lh, lh) {
 		list_del(&el->lh);
 		free(el);
 	}
+	INIT_LIST_HEAD(&dap->cmd_pool);
 }
 
 /***************************************************************************
@@ -333,6 +364,7 @@ static int adi_jtag_dp_scan(struct adiv5_dap *dap,
 	retval = adi_jtag_dp_scan_cmd(dap, cmd, ack);
 	if (retval == ERROR_OK)
 		list_add_tail(&cmd->lh,	&dap->cmd_journal);
+	dap->stats.transactions++;
 
 	return retval;
 }
@@ -446,13 +478,13 @@ static int jtagdp_overrun_check(struct adiv5_dap *dap)
 		 * OK or FAULT is generated for ADIv5 or ADIv6
 		 */
 		if (el->ack == JTAG_ACK_OK_FAULT || (is_adiv6(dap) && el->ack == JTAG_ACK_OK)) {
-			log_dap_cmd(dap, "LOG", el);
+			log_dap_cmd(dap, DAP_CMD_STAGE_LOG, el);
 		} else if (el->ack == JTAG_ACK_WAIT) {
 			found_wait = 1;
 			break;
 		} else {
 			LOG_ERROR("Invalid ACK (%1x) in DAP response", el->ack);
-			log_dap_cmd(dap, "ERR", el);
+			log_dap_cmd(dap, DAP_CMD_STAGE_ERR, el);
 			retval = ERROR_JTAG_DEVICE_ERROR;
 			goto done;
 		}
@@ -465,7 +497,7 @@ static int jtagdp_overrun_check(struct adiv5_dap *dap)
 	if (found_wait && el != list_first_entry(&dap->cmd_journal, struct dap_cmd, lh)) {
 		prev = list_entry(el->lh.prev, struct dap_cmd, lh);
 		if (prev->rnw == DPAP_READ) {
-			log_dap_cmd(dap, "PND", prev);
+			log_dap_cmd(dap, DAP_CMD_STAGE_PND, prev);
 			/* search for the next OK transaction, it contains
 			 * the result of the previous READ */
 			tmp = el;
@@ -473,7 +505,7 @@ static int jtagdp_overrun_check(struct adiv5_dap *dap)
 				/* The following check covers OK and FAULT ACKs for both ADIv5 and ADIv6 */
 				if (tmp->ack == JTAG_ACK_OK_FAULT || (is_adiv6(dap) && tmp->ack == JTAG_ACK_OK)) {
 					/* recover the read value */
-					log_dap_cmd(dap, "FND", tmp);
+					log_dap_cmd(dap, DAP_CMD_STAGE_FND, tmp);
 					if (el->invalue != el->invalue_buf) {
 						uint32_t invalue = le_to_h_u32(tmp->invalue);
 						memcpy(el->invalue, &invalue, sizeof(uint32_t));
@@ -484,7 +516,7 @@ static int jtagdp_overrun_check(struct adiv5_dap *dap)
 			}
 
 			if (prev) {
-				log_dap_cmd(dap, "LST", el);
+				log_dap_cmd(dap, DAP_CMD_STAGE_LST, el);
 
 				/*
 				* At this point we're sure that no previous
@@ -508,7 +540,7 @@ static int jtagdp_overrun_check(struct adiv5_dap *dap)
 						break;
 					/* The following check covers OK and FAULT ACKs for both ADIv5 and ADIv6 */
 					if (tmp->ack == JTAG_ACK_OK_FAULT || (is_adiv6(dap) && tmp->ack == JTAG_ACK_OK)) {
-						log_dap_cmd(dap, "FND", tmp);
+						log_dap_cmd(dap, DAP_CMD_STAGE_FND, tmp);
 						if (el->invalue != el->invalue_buf) {
 							uint32_t invalue = le_to_h_u32(tmp->invalue);
 							memcpy(el->invalue, &invalue, sizeof(uint32_t));
@@ -517,7 +549,7 @@ static int jtagdp_overrun_check(struct adiv5_dap *dap)
 					}
 					if (tmp->ack != JTAG_ACK_WAIT) {
 						LOG_ERROR("Invalid ACK (%1x) in DAP response", tmp->ack);
-						log_dap_cmd(dap, "ERR", tmp);
+						log_dap_cmd(dap, DAP_CMD_STAGE_ERR, tmp);
 						retval = ERROR_JTAG_DEVICE_ERROR;
 						break;
 					}
@@ -557,7 +589,7 @@ static int jtagdp_overrun_check(struct adiv5_dap *dap)
 
 	/* move all remaining transactions over to the replay list */
 	list_for_each_entry_safe_from(el, tmp, &dap->cmd_journal, lh) {
-		log_dap_cmd(dap, "REP", el);
+		log_dap_cmd(dap, DAP_CMD_STAGE_REP, el);
 		list_move_tail(&el->lh, &replay_list);
 	}
 
@@ -567,6 +599,7 @@ static int jtagdp_overrun_check(struct adiv5_dap *dap)
 	/* check for overrun condition in the last batch of transactions */
 	if (found_wait) {
 		LOG_INFO("DAP transaction stalled (WAIT) - slowing down and resending");
+		dap->stats.waits++;
 		/* clear the sticky overrun condition */
 		retval = adi_jtag_scan_inout_check_u32(dap, JTAG_DP_DPACC,
 				DP_CTRL_STAT, DPAP_WRITE,
@@ -600,7 +633,7 @@ static int jtagdp_overrun_check(struct adiv5_dap *dap)
 				retval = adi_jtag_dp_scan_cmd_sync(dap, el, NULL);
 				if (retval != ERROR_OK)
 					break;
-				log_dap_cmd(dap, "REC", el);
+				log_dap_cmd(dap, DAP_CMD_STAGE_REC, el);
 				if (el->ack == JTAG_ACK_OK_FAULT || (is_adiv6(dap) && el->ack == JTAG_ACK_OK)) {
 					if (el->invalue != el->invalue_buf) {
 						uint32_t invalue = le_to_h_u32(el->invalue);
@@ -610,7 +643,7 @@ static int jtagdp_overrun_check(struct adiv5_dap *dap)
 				}
 				if (el->ack != JTAG_ACK_WAIT) {
 					LOG_ERROR("Invalid ACK (%1x) in DAP response", el->ack);
-					log_dap_cmd(dap, "ERR", el);
+					log_dap_cmd(dap, DAP_CMD_STAGE_ERR, el);
 					retval = ERROR_JTAG_DEVICE_ERROR;
 					break;
 				}
@@ -876,7 +909,9 @@ static int jtag_dp_run(struct adiv5_dap *dap)
 {
 	int retval;
 	int retval2 = ERROR_OK;
+	struct duration elapsed;
 
+	duration_start(&elapsed);
 	retval = adi_jtag_finish_read(dap);
 	if (retval != ERROR_OK)
 		goto done;
@@ -884,6 +919,11 @@ static int jtag_dp_run(struct adiv5_dap *dap)
 	retval = jtagdp_transaction_endcheck(dap);
 
  done:
+	duration_measure(&elapsed);
+	dap->stats.runs++;
+	dap->stats.run_us += duration_elapsed(&elapsed) * 1000000;
+	if (retval != ERROR_OK || retval2 != ERROR_OK)
+		dap->stats.faults++;
 	return (retval2 != ERROR_OK) ? retval2 : retval;
 }
 
@@ -0,0 +1,336 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/**
+ * @file
+ * Periodic sampling of memory through a MEM-AP while the target runs.
+ *
+ * A list of memory regions is read at a fixed period. All the regions of
+ * a sample are queued with mem_ap_read_buf_queued() and fetched with a
+ * single dap_run(), then written as one timestamped line to a file.
+ * Only MEM-AP accesses are used, the core is never halted.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+
+#include "arm_adi_v5.h"
+#include "target.h"
+#include <helper/list.h>
+#include <helper/time_support.h>
+
+/* Largest region sampled in one go */
+#define LIVEWATCH_MAX_LENGTH 1024
+
+struct dap_livewatch_region {
+	struct list_head lh;
+	struct adiv5_ap *ap;
+	target_addr_t address;
+	uint32_t length;
+	uint8_t *data;
+};
+
+struct dap_livewatch {
+	struct list_head regions;
+	FILE *output;
+	unsigned int period_ms;
+	int64_t start_ms;
+	unsigned int samples;
+	unsigned int errors;
+};
+
+static struct dap_livewatch *dap_livewatch_get(struct adiv5_dap *dap)
+{
+	if (!dap->livewatch) {
+		dap->livewatch = calloc(1, sizeof(struct dap_livewatch));
+		if (!dap->livewatch)
+			return NULL;
+		INIT_LIST_HEAD(&dap->livewatch->regions);
+	}
+
+	return dap->livewatch;
+}
+
+static int dap_livewatch_sample(void *priv)
+{
+	struct adiv5_dap *dap = priv;
+	struct dap_livewatch *lw = dap->livewatch;
+	struct dap_livewatch_region *region;
+	int retval = ERROR_OK;
+
+	list_for_each_entry(region, &lw->regions, lh) {
+		bool aligned = IS_ALIGNED(region->address, 4) && IS_ALIGNED(region->length, 4);
+		uint32_t size = aligned ? 4 : 1;
+
+		retval = mem_ap_read_buf_queued(region->ap, region->data, size,
+			region->length / size, region->address);
+		if (retval != ERROR_OK)
+			break;
+	}
+
+	/* one run for the whole sample, for all the APs of the DAP */
+	int retval_run = dap_run(dap);
+	if (retval == ERROR_OK)
+		retval = retval_run;
+
+	fprintf(lw->output, "%" PRId64, timeval_ms() - lw->start_ms);
+	if (retval != ERROR_OK) {
+		/* keep sampling, a running target may have its bus temporarily blocked */
+		if (lw->errors++ == 0)
+			LOG_WARNING("%s: live watch sample failed", adiv5_dap_name(dap));
+		fprintf(lw->output, " error\n");
+		return ERROR_OK;
+	}
+
+	list_for_each_entry(region, &lw->regions, lh) {
+		fprintf(lw->output, " " TARGET_ADDR_FMT ":", region->address);
+		for (uint32_t i = 0; i < region->length; i++)
+			fprintf(lw->output, "%02" PRIx8, region->data[i]);
+	}
+	fprintf(lw->output, "\n");
+	lw->samples++;
+
+	return ERROR_OK;
+}
+
+static void dap_livewatch_stop(struct adiv5_dap *dap)
+{
+	struct dap_livewatch *lw = dap->livewatch;
+
+	if (!lw || !lw->output)
+		return;
+
+	target_unregister_timer_callback(dap_livewatch_sample, dap);
+	fclose(lw->output);
+	lw->output = NULL;
+
+	LOG_INFO("%s: live watch stopped, %u samples, %u errors",
+		adiv5_dap_name(dap), lw->samples, lw->errors);
+}
+
+static void dap_livewatch_clear(struct dap_livewatch *lw)
+{
+	struct dap_livewatch_region *region, *tmp;
+
+	list_for_each_entry_safe(region, tmp, &lw->regions, lh) {
+		list_del(&region->lh);
+		dap_put_ap(region->ap);
+		free(region->data);
+		free(region);
+	}
+}
+
+void dap_livewatch_cleanup(struct adiv5_dap *dap)
+{
+	if (!dap->livewatch)
+		return;
+
+	dap_livewatch_stop(dap);
+	dap_livewatch_clear(dap->livewatch);
+	free(dap->livewatch);
+	dap->livewatch = NULL;
+}
+
+COMMAND_HANDLER(handle_dap_livewatch_add_command)
+{
+	struct adiv5_dap *dap = adiv5_get_dap(CMD_DATA);
+	uint64_t apsel;
+	target_addr_t address;
+	uint32_t length;
+
+	if (CMD_ARGC != 3)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_NUMBER(u64, CMD_ARGV[0], apsel);
+	if (!is_ap_num_valid(dap, apsel)) {
+		command_print(CMD, "Invalid AP number");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+	COMMAND_PARSE_ADDRESS(CMD_ARGV[1], address);
+	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[2], length);
+	if (length == 0 || length > LIVEWATCH_MAX_LENGTH) {
+		command_print(CMD, "Length must be 1 to %u bytes", LIVEWATCH_MAX_LENGTH);
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	struct dap_livewatch *lw = dap_livewatch_get(dap);
+	if (!lw) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	if (lw->output) {
+		command_print(CMD, "Stop the live watch before changing it");
+		return ERROR_FAIL;
+	}
+
+	struct dap_livewatch_region *region = calloc(1, sizeof(*region));
+	uint8_t *data = malloc(length);
+	if (!region || !data) {
+		free(region);
+		free(data);
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	region->ap = dap_get_ap(dap, apsel);
+	if (!region->ap) {
+		free(region);
+		free(data);
+		command_print(CMD, "Cannot get AP");
+		return ERROR_FAIL;
+	}
+	region->address = address;
+	region->length = length;
+	region->data = data;
+	list_add_tail(&region->lh, &lw->regions);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_dap_livewatch_clear_command)
+{
+	struct adiv5_dap *dap = adiv5_get_dap(CMD_DATA);
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	dap_livewatch_cleanup(dap);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_dap_livewatch_start_command)
+{
+	struct adiv5_dap *dap = adiv5_get_dap(CMD_DATA);
+	struct dap_livewatch *lw = dap->livewatch;
+	unsigned int period_ms;
+
+	if (CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], period_ms);
+	if (period_ms == 0)
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+
+	if (!lw || list_empty(&lw->regions)) {
+		command_print(CMD, "No memory region to watch");
+		return ERROR_FAIL;
+	}
+
+	if (lw->output) {
+		command_print(CMD, "Live watch already running");
+		return ERROR_FAIL;
+	}
+
+	lw->output = fopen(CMD_ARGV[1], "w");
+	if (!lw->output) {
+		command_print(CMD, "Cannot open file %s", CMD_ARGV[1]);
+		return ERROR_FAIL;
+	}
+
+	lw->period_ms = period_ms;
+	lw->start_ms = timeval_ms();
+	lw->samples = 0;
+	lw->errors = 0;
+
+	int retval = target_register_timer_callback(dap_livewatch_sample, period_ms,
+		TARGET_TIMER_TYPE_PERIODIC, dap);
+	if (retval != ERROR_OK) {
+		fclose(lw->output);
+		lw->output = NULL;
+	}
+
+	return retval;
+}
+
+COMMAND_HANDLER(handle_dap_livewatch_stop_command)
+{
+	struct adiv5_dap *dap = adiv5_get_dap(CMD_DATA);
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	dap_livewatch_stop(dap);
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_dap_livewatch_show_command)
+{
+	struct adiv5_dap *dap = adiv5_get_dap(CMD_DATA);
+	struct dap_livewatch *lw = dap->livewatch;
+	struct dap_livewatch_region *region;
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!lw || list_empty(&lw->regions)) {
+		command_print(CMD, "No memory region to watch");
+		return ERROR_OK;
+	}
+
+	list_for_each_entry(region, &lw->regions, lh)
+		command_print(CMD, "AP#0x%" PRIx64 " " TARGET_ADDR_FMT " %" PRIu32,
+			region->ap->ap_num, region->address, region->length);
+
+	if (lw->output)
+		command_print(CMD, "running every %u ms, %u samples, %u errors",
+			lw->period_ms, lw->samples, lw->errors);
+	else
+		command_print(CMD, "stopped");
+
+	return ERROR_OK;
+}
+
+static const struct command_registration dap_livewatch_subcommand_handlers[] = {
+	{
+		.name = "add",
+		.handler = handle_dap_livewatch_add_command,
+		.mode = COMMAND_EXEC,
+		.help = "add a memory region to the live watch",
+		.usage = "ap_num address length",
+	},
+	{
+		.name = "clear",
+		.handler = handle_dap_livewatch_clear_command,
+		.mode = COMMAND_EXEC,
+		.help = "stop the live watch and remove all memory regions",
+		.usage = "",
+	},
+	{
+		.name = "show",
+		.handler = handle_dap_livewatch_show_command,
+		.mode = COMMAND_EXEC,
+		.help = "list the memory regions and the sampling state",
+		.usage = "",
+	},
+	{
+		.name = "start",
+		.handler = handle_dap_livewatch_start_command,
+		.mode = COMMAND_EXEC,
+		.help = "sample the memory regions periodically into a file",
+		.usage = "period_ms filename",
+	},
+	{
+		.name = "stop",
+		.handler = handle_dap_livewatch_stop_command,
+		.mode = COMMAND_EXEC,
+		.help = "stop sampling and close the file",
+		.usage = "",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+const struct command_registration dap_livewatch_commands[] = {
+	{
+		.name = "livewatch",
+		.mode = COMMAND_ANY,
+		.help = "sample memory through MEM-AP while the target runs",
+		.usage = "",
+		.chain = dap_livewatch_subcommand_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
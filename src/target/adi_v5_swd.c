@@ -50,6 +50,11 @@ static struct adiv5_dap *swd_multidrop_selected_dap;
 
 static bool swd_multidrop_in_swd_state;
 
+/* DP reselected in the current queue, its IDs are checked when the queue runs */
+static struct adiv5_dap *swd_multidrop_queued_dap;
+static uint32_t swd_multidrop_queued_dpidr;
+static uint32_t swd_multidrop_queued_dlpidr;
+
 
 static int swd_queue_dp_write_inner(struct adiv5_dap *dap, unsigned int reg,
 		uint32_t data);
@@ -68,6 +73,7 @@ static void swd_finish_read(struct adiv5_dap *dap)
 	const struct swd_driver *swd = adiv5_dap_swd_driver(dap);
 	if (dap->last_read) {
 		swd->read_reg(swd_cmd(true, false, DP_RDBUFF), dap->last_read, 0);
+		dap->stats.transactions++;
 		dap->last_read = NULL;
 	}
 }
@@ -79,13 +85,26 @@ static void swd_clear_sticky_errors(struct adiv5_dap *dap)
 
 	swd->write_reg(swd_cmd(false, false, DP_ABORT),
 		STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR, 0);
+	dap->stats.transactions++;
 }
 
 static int swd_run_inner(struct adiv5_dap *dap)
 {
 	const struct swd_driver *swd = adiv5_dap_swd_driver(dap);
+	struct duration elapsed;
+
+	duration_start(&elapsed);
+	int retval = swd->run();
+	duration_measure(&elapsed);
 
-	return swd->run();
+	dap->stats.runs++;
+	dap->stats.run_us += duration_elapsed(&elapsed) * 1000000;
+	if (retval == ERROR_WAIT)
+		dap->stats.waits++;
+	else if (retval != ERROR_OK)
+		dap->stats.faults++;
+
+	return retval;
 }
 
 static inline int check_sync(struct adiv5_dap *dap)
@@ -130,6 +149,7 @@ static int swd_queue_dp_read_inner(struct adiv5_dap *dap, unsigned int reg,
 		return retval;
 
 	swd->read_reg(swd_cmd(true, false, reg), data, 0);
+	dap->stats.transactions++;
 
 	return check_sync(dap);
 }
@@ -147,6 +167,7 @@ static int swd_queue_dp_write_inner(struct adiv5_dap *dap, unsigned int reg,
 		dap->select = data | (dap->select & (0xffffffffull << 32));
 
 		swd->write_reg(swd_cmd(false, false, reg), data, 0);
+		dap->stats.transactions++;
 
 		retval = check_sync(dap);
 		dap->select_valid = (retval == ERROR_OK);
@@ -165,6 +186,7 @@ static int swd_queue_dp_write_inner(struct adiv5_dap *dap, unsigned int reg,
 
 	if (retval == ERROR_OK) {
 		swd->write_reg(swd_cmd(false, false, reg), data, 0);
+		dap->stats.transactions++;
 
 		retval = check_sync(dap);
 	}
@@ -176,11 +198,11 @@ static int swd_queue_dp_write_inner(struct adiv5_dap *dap, unsigned int reg,
 }
 
 
-static int swd_multidrop_select_inner(struct adiv5_dap *dap, uint32_t *dpidr_ptr,
-		uint32_t *dlpidr_ptr, bool clear_sticky)
+/* Queue line reset, DP_TARGETSEL write and reads of DPIDR and DLPIDR */
+static int swd_multidrop_queue_select(struct adiv5_dap *dap, uint32_t *dpidr,
+		uint32_t *dlpidr, bool clear_sticky)
 {
 	int retval;
-	uint32_t dpidr, dlpidr;
 
 	assert(dap_is_multidrop(dap));
 
@@ -209,7 +231,7 @@ static int swd_multidrop_select_inner(struct adiv5_dap *dap, uint32_t *dpidr_ptr
 	if (retval != ERROR_OK)
 		return retval;
 
-	retval = swd_queue_dp_read_inner(dap, DP_DPIDR, &dpidr);
+	retval = swd_queue_dp_read_inner(dap, DP_DPIDR, dpidr);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -223,14 +245,12 @@ static int swd_multidrop_select_inner(struct adiv5_dap *dap, uint32_t *dpidr_ptr
 			return retval;
 	}
 
-	retval = swd_queue_dp_read_inner(dap, DP_DLPIDR, &dlpidr);
-	if (retval != ERROR_OK)
-		return retval;
-
-	retval = swd_run_inner(dap);
-	if (retval != ERROR_OK)
-		return retval;
+	return swd_queue_dp_read_inner(dap, DP_DLPIDR, dlpidr);
+}
 
+/* Check DPIDR and DLPIDR read by swd_multidrop_queue_select() */
+static int swd_multidrop_check_ids(struct adiv5_dap *dap, uint32_t dpidr, uint32_t dlpidr)
+{
 	if ((dpidr & DP_DPIDR_VERSION_MASK) < (2UL << DP_DPIDR_VERSION_SHIFT)) {
 		LOG_INFO("Read DPIDR 0x%08" PRIx32
 				 " has version < 2. A non multidrop capable device connected?",
@@ -248,9 +268,58 @@ static int swd_multidrop_select_inner(struct adiv5_dap *dap, uint32_t *dpidr_ptr
 		return ERROR_FAIL;
 	}
 
+	return ERROR_OK;
+}
+
+/* Check the IDs of a DP reselected by swd_multidrop_select() without running
+ * the queue. Call after each run of the queue. */
+static int swd_multidrop_check_queued(int retval)
+{
+	struct adiv5_dap *dap = swd_multidrop_queued_dap;
+
+	if (!dap)
+		return retval;
+
+	swd_multidrop_queued_dap = NULL;
+	if (retval == ERROR_OK)
+		retval = swd_multidrop_check_ids(dap, swd_multidrop_queued_dpidr,
+			swd_multidrop_queued_dlpidr);
+
+	if (retval != ERROR_OK) {
+		LOG_DEBUG("Failed to reselect multidrop %s", adiv5_dap_name(dap));
+		dap->multidrop_verified = false;
+		dap->do_reconnect = true;
+		if (swd_multidrop_selected_dap == dap)
+			swd_multidrop_selected_dap = NULL;
+	}
+
+	return retval;
+}
+
+static int swd_multidrop_select_inner(struct adiv5_dap *dap, uint32_t *dpidr_ptr,
+		uint32_t *dlpidr_ptr, bool clear_sticky)
+{
+	int retval;
+	uint32_t dpidr, dlpidr;
+
+	dap->multidrop_verified = false;
+
+	retval = swd_multidrop_queue_select(dap, &dpidr, &dlpidr, clear_sticky);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = swd_multidrop_check_queued(swd_run_inner(dap));
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = swd_multidrop_check_ids(dap, dpidr, dlpidr);
+	if (retval != ERROR_OK)
+		return retval;
+
 	LOG_DEBUG_IO("Selected DP_TARGETSEL 0x%08" PRIx32, dap->multidrop_targetsel);
 	swd_multidrop_selected_dap = dap;
 	swd_multidrop_in_swd_state = true;
+	dap->multidrop_verified = true;
 
 	if (dpidr_ptr)
 		*dpidr_ptr = dpidr;
@@ -269,6 +338,21 @@ static int swd_multidrop_select(struct adiv5_dap *dap)
 	if (swd_multidrop_selected_dap == dap)
 		return ERROR_OK;
 
+	/* Switching back to a DP that answered before: queue the reselection
+	 * with the pending operations and check the IDs when the queue runs */
+	if (dap->multidrop_verified && swd_multidrop_in_swd_state
+			&& !swd_multidrop_queued_dap && !do_sync) {
+		int retval = swd_multidrop_queue_select(dap, &swd_multidrop_queued_dpidr,
+			&swd_multidrop_queued_dlpidr, false);
+		if (retval != ERROR_OK)
+			return retval;
+
+		LOG_DEBUG_IO("Queued DP_TARGETSEL 0x%08" PRIx32, dap->multidrop_targetsel);
+		swd_multidrop_queued_dap = dap;
+		swd_multidrop_selected_dap = dap;
+		return ERROR_OK;
+	}
+
 	int retval = ERROR_OK;
 	for (unsigned int retry = 0; ; retry++) {
 		bool clear_sticky = retry > 0;
@@ -404,6 +488,7 @@ static int swd_connect_single(struct adiv5_dap *dap)
 static int swd_pre_connect(struct adiv5_dap *dap)
 {
 	swd_multidrop_in_swd_state = false;
+	swd_multidrop_queued_dap = NULL;
 
 	return ERROR_OK;
 }
@@ -461,8 +546,10 @@ static int swd_connect(struct adiv5_dap *dap)
 
 static int swd_check_reconnect(struct adiv5_dap *dap)
 {
-	if (dap->do_reconnect)
+	if (dap->do_reconnect) {
+		dap->stats.reconnects++;
 		return swd_connect(dap);
+	}
 
 	return ERROR_OK;
 }
@@ -482,6 +569,7 @@ static int swd_queue_ap_abort(struct adiv5_dap *dap, uint8_t *ack)
 
 	swd->write_reg(swd_cmd(false, false, DP_ABORT),
 		DAPABORT | STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR, 0);
+	dap->stats.transactions++;
 	return check_sync(dap);
 }
 
@@ -584,6 +672,7 @@ static int swd_queue_ap_read(struct adiv5_ap *ap, unsigned int reg,
 		return retval;
 
 	swd->read_reg(swd_cmd(true, true, reg), dap->last_read, ap->memaccess_tck);
+	dap->stats.transactions++;
 	dap->last_read = data;
 
 	return check_sync(dap);
@@ -611,6 +700,7 @@ static int swd_queue_ap_write(struct adiv5_ap *ap, unsigned int reg,
 		return retval;
 
 	swd->write_reg(swd_cmd(false, true, reg), data, ap->memaccess_tck);
+	dap->stats.transactions++;
 
 	return check_sync(dap);
 }
@@ -624,7 +714,7 @@ static int swd_run(struct adiv5_dap *dap)
 
 	swd_finish_read(dap);
 
-	retval = swd_run_inner(dap);
+	retval = swd_multidrop_check_queued(swd_run_inner(dap));
 	if (retval != ERROR_OK) {
 		/* fault response */
 		dap->do_reconnect = true;
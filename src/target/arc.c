@@ -1759,6 +1759,7 @@ static void arc_reset_actionpoints(struct target *target)
 		free(target->breakpoints);
 		target->breakpoints = next_b;
 	}
+	breakpoint_hash_clear(target);
 	while (target->watchpoints) {
 		next_w = target->watchpoints->next;
 		arc_remove_watchpoint(target, target->watchpoints);
@@ -177,6 +177,9 @@ struct arm {
 
 	struct reg_cache *core_cache;
 
+	/** Core registers saved while an algorithm runs, see register_cache_snapshot() */
+	struct reg_snapshot *algorithm_context;
+
 	/** Handle to the PC; valid in all core modes. */
 	struct reg *pc;
 
@@ -323,6 +326,8 @@ int arm_checksum_memory(struct target *target,
 		target_addr_t address, uint32_t count, uint32_t *checksum);
 int arm_blank_check_memory(struct target *target,
 		struct target_memory_check_block *blocks, int num_blocks, uint8_t erased_value);
+int arm_fill_memory(struct target *target, target_addr_t address,
+		uint32_t size, uint32_t count, uint32_t pattern);
 
 void arm_set_cpsr(struct arm *arm, uint32_t cpsr);
 struct reg *arm_reg_current(struct arm *arm, unsigned int regnum);
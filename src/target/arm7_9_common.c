@@ -2100,7 +2100,7 @@ static int arm7_9_write_core_reg(struct target *target, struct reg *r,
 	return jtag_execute_queue();
 }
 
-int arm7_9_read_memory(struct target *target,
+static int arm7_9_read_memory_no_opt(struct target *target,
 	target_addr_t address,
 	uint32_t size,
 	uint32_t count,
@@ -2493,12 +2493,25 @@ int arm7_9_write_memory_opt(struct target *target,
 	struct arm7_9_common *arm7_9 = target_to_arm7_9(target);
 	int retval;
 
-	if (size == 4 && count > 32 && arm7_9->bulk_write_memory) {
-		/* Attempt to do a bulk write */
-		retval = arm7_9->bulk_write_memory(target, address, count, buffer);
-
-		if (retval == ERROR_OK)
-			return ERROR_OK;
+	if (count * size > 32 * 4 && arm7_9->bulk_write_memory) {
+		/* Split off an unaligned head and a partial tail, so that the
+		 * word-aligned middle can go through the bulk write whatever
+		 * the access size */
+		uint32_t head = (4 - (address & 3)) & 3;
+		uint32_t words = (count * size - head) / 4;
+		uint32_t tail = count * size - head - words * 4;
+
+		if ((head % size) == 0 && words > 32) {
+			retval = arm7_9->bulk_write_memory(target, address + head, words, buffer + head);
+			if (retval == ERROR_OK) {
+				if (head)
+					retval = arm7_9->write_memory(target, address, size, head / size, buffer);
+				if (retval == ERROR_OK && tail)
+					retval = arm7_9->write_memory(target, address + head + words * 4,
+							size, tail / size, buffer + head + words * 4);
+				return retval;
+			}
+		}
 	}
 
 	return arm7_9->write_memory(target, address, size, count, buffer);
@@ -2584,6 +2597,75 @@ static const uint32_t dcc_code[] = {
 	0xeafffff9	/*    b   w                   */
 };
 
+static const uint32_t dcc_upload_code[] = {
+	/* r0 == input, points to memory buffer
+	 * r3 == input, number of words
+	 * r1, r2 == scratch
+	 */
+
+	/* read word from memory */
+	0xe4901004,	/* l: ldr r1, [r0], #4        */
+
+	/* spin until the debugger has taken the previous word */
+	0xee102e10,	/* w: mrc p14, #0, r2, c0, c0 */
+	0xe3120002,	/*    tst r2, #2              */
+	0x1afffffc,	/*    bne w                   */
+
+	/* write word to DCC (c1) */
+	0xee011e10,	/*    mcr p14, #0, r1, c1, c0 */
+
+	/* repeat until done, then spin until halted */
+	0xe2533001,	/*    subs r3, r3, #1         */
+	0x1afffff8,	/*    bne l                   */
+	0xeafffffe	/* e: b   e                   */
+};
+
+#define DCC_UPLOAD_OFFSET	sizeof(dcc_code)
+#define DCC_LOADERS_SIZE	(sizeof(dcc_code) + sizeof(dcc_upload_code))
+
+/**
+ * Regrab the previously allocated working area holding both DCC loaders,
+ * or allocate a new one and write the loaders to it.
+ */
+static int arm7_9_dcc_loaders(struct target *target)
+{
+	struct arm7_9_common *arm7_9 = target_to_arm7_9(target);
+	uint8_t code_buf[DCC_LOADERS_SIZE];
+	int retval;
+
+	if (arm7_9->dcc_working_area)
+		return ERROR_OK;
+
+	if (arm7_9->dcc_loading)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	arm7_9->dcc_loading = true;
+
+	/* make sure we have a working area */
+	if (target_alloc_working_area(target, DCC_LOADERS_SIZE, &arm7_9->dcc_working_area) != ERROR_OK) {
+		arm7_9->dcc_loading = false;
+		LOG_INFO("no working area available, falling back to memory accesses");
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	/* copy target instructions to target endianness */
+	target_buffer_set_u32_array(target, code_buf, ARRAY_SIZE(dcc_code), dcc_code);
+	target_buffer_set_u32_array(target, code_buf + DCC_UPLOAD_OFFSET,
+			ARRAY_SIZE(dcc_upload_code), dcc_upload_code);
+
+	/* write DCC code to working area, using the non-optimized
+	 * memory write to avoid ending up here again */
+	retval = arm7_9_write_memory_no_opt(target,
+			arm7_9->dcc_working_area->address, 4, DCC_LOADERS_SIZE / 4, code_buf);
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, arm7_9->dcc_working_area);
+		arm7_9->dcc_working_area = NULL;
+	}
+
+	arm7_9->dcc_loading = false;
+	return retval;
+}
+
 int arm7_9_bulk_write_memory(struct target *target,
 	target_addr_t address,
 	uint32_t count,
@@ -2598,26 +2680,9 @@ int arm7_9_bulk_write_memory(struct target *target,
 	if (!arm7_9->dcc_downloads)
 		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
 
-	/* regrab previously allocated working_area, or allocate a new one */
-	if (!arm7_9->dcc_working_area) {
-		uint8_t dcc_code_buf[6 * 4];
-
-		/* make sure we have a working area */
-		if (target_alloc_working_area(target, 24, &arm7_9->dcc_working_area) != ERROR_OK) {
-			LOG_INFO("no working area available, falling back to memory writes");
-			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
-		}
-
-		/* copy target instructions to target endianness */
-		target_buffer_set_u32_array(target, dcc_code_buf, ARRAY_SIZE(dcc_code), dcc_code);
-
-		/* write DCC code to working area, using the non-optimized
-		 * memory write to avoid ending up here again */
-		retval = arm7_9_write_memory_no_opt(target,
-				arm7_9->dcc_working_area->address, 4, 6, dcc_code_buf);
-		if (retval != ERROR_OK)
-			return retval;
-	}
+	retval = arm7_9_dcc_loaders(target);
+	if (retval != ERROR_OK)
+		return retval;
 
 	struct arm_algorithm arm_algo;
 	struct reg_param reg_params[1];
@@ -2653,6 +2718,130 @@ int arm7_9_bulk_write_memory(struct target *target,
 	return retval;
 }
 
+static int dcc_upload_count;
+static uint8_t *dcc_upload_buffer;
+
+static int arm7_9_dcc_upload_completion(struct target *target,
+	uint32_t exit_point,
+	unsigned int timeout_ms,
+	void *arch_info)
+{
+	struct arm7_9_common *arm7_9 = target_to_arm7_9(target);
+	uint32_t *data;
+	int retval;
+
+	retval = target_wait_state(target, TARGET_DEBUG_RUNNING, 500);
+	if (retval != ERROR_OK)
+		return retval;
+
+	data = malloc(dcc_upload_count * sizeof(uint32_t));
+	if (!data) {
+		LOG_ERROR("Out of memory");
+		retval = ERROR_FAIL;
+	} else {
+		/* the words stream out back to back, handshakes are checked once
+		 * the whole block has been received */
+		retval = embeddedice_receive_checked(&arm7_9->jtag_info, data, dcc_upload_count);
+		if (retval == ERROR_OK)
+			target_buffer_set_u32_array(target, dcc_upload_buffer, dcc_upload_count, data);
+		free(data);
+	}
+
+	int halt_retval = target_halt(target);
+	if (halt_retval == ERROR_OK)
+		halt_retval = target_wait_state(target, TARGET_HALTED, 500);
+	if (retval == ERROR_OK)
+		retval = halt_retval;
+	return retval;
+}
+
+int arm7_9_bulk_read_memory(struct target *target,
+	target_addr_t address,
+	uint32_t count,
+	uint8_t *buffer)
+{
+	int retval;
+	struct arm7_9_common *arm7_9 = target_to_arm7_9(target);
+
+	if (address % 4 != 0)
+		return ERROR_TARGET_UNALIGNED_ACCESS;
+
+	if (!arm7_9->dcc_downloads)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	retval = arm7_9_dcc_loaders(target);
+	if (retval != ERROR_OK)
+		return retval;
+
+	struct arm_algorithm arm_algo;
+	struct reg_param reg_params[2];
+
+	arm_algo.common_magic = ARM_COMMON_MAGIC;
+	arm_algo.core_mode = ARM_MODE_SVC;
+	arm_algo.core_state = ARM_STATE_ARM;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);
+	init_reg_param(&reg_params[1], "r3", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, address);
+	buf_set_u32(reg_params[1].value, 0, 32, count);
+
+	dcc_upload_count = count;
+	dcc_upload_buffer = buffer;
+	retval = armv4_5_run_algorithm_inner(target, 0, NULL, 2, reg_params,
+			arm7_9->dcc_working_area->address + DCC_UPLOAD_OFFSET,
+			arm7_9->dcc_working_area->address + DCC_LOADERS_SIZE - 4,
+			20*1000, &arm_algo, arm7_9_dcc_upload_completion);
+
+	if (retval == ERROR_OK) {
+		uint32_t endaddress = buf_get_u32(reg_params[0].value, 0, 32);
+		if (endaddress != (address + count*4)) {
+			LOG_ERROR(
+				"DCC read failed, expected end address 0x%08" TARGET_PRIxADDR " got 0x%0" PRIx32 "",
+				(address + count*4),
+				endaddress);
+			retval = ERROR_FAIL;
+		}
+	}
+
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+
+	return retval;
+}
+
+int arm7_9_read_memory(struct target *target,
+	target_addr_t address,
+	uint32_t size,
+	uint32_t count,
+	uint8_t *buffer)
+{
+	struct arm7_9_common *arm7_9 = target_to_arm7_9(target);
+
+	if (count * size > 32 * 4 && arm7_9->bulk_read_memory
+			&& target->state == TARGET_HALTED && !arm7_9->dcc_loading) {
+		/* Same split as for writes: bytes and halfwords of the
+		 * word-aligned middle are read as whole words */
+		uint32_t head = (4 - (address & 3)) & 3;
+		uint32_t words = (count * size - head) / 4;
+		uint32_t tail = count * size - head - words * 4;
+
+		if ((head % size) == 0 && words > 32
+				&& arm7_9->bulk_read_memory(target, address + head, words,
+					buffer + head) == ERROR_OK) {
+			int retval = ERROR_OK;
+			if (head)
+				retval = arm7_9_read_memory_no_opt(target, address, size, head / size, buffer);
+			if (retval == ERROR_OK && tail)
+				retval = arm7_9_read_memory_no_opt(target, address + head + words * 4,
+						size, tail / size, buffer + head + words * 4);
+			return retval;
+		}
+	}
+
+	return arm7_9_read_memory_no_opt(target, address, size, count, buffer);
+}
+
 /**
  * Perform per-target setup that requires JTAG access.
  */
@@ -58,6 +58,9 @@ struct arm7_9_common {
 	bool dcc_downloads;
 
 	struct working_area *dcc_working_area;
+	/** set while a DCC loader is being put in place, the working area
+	 * backup may read target memory and must not recurse into the DCC paths */
+	bool dcc_loading;
 
 	int (*examine_debug_reason)(struct target *target);
 	/**< Function for determining why debug state was entered */
@@ -120,6 +123,12 @@ struct arm7_9_common {
 	 */
 	int (*bulk_write_memory)(struct target *target, target_addr_t address,
 			uint32_t count, const uint8_t *buffer);
+	/**
+	 * Read target memory in multiples of 4 bytes, optimized for
+	 * reading large quantities of data.
+	 */
+	int (*bulk_read_memory)(struct target *target, target_addr_t address,
+			uint32_t count, uint8_t *buffer);
 };
 
 static inline struct arm7_9_common *target_to_arm7_9(struct target *target)
@@ -159,6 +168,8 @@ int arm7_9_write_memory_no_opt(struct target *target, uint32_t address,
 		uint32_t size, uint32_t count, const uint8_t *buffer);
 int arm7_9_bulk_write_memory(struct target *target, target_addr_t address,
 		uint32_t count, const uint8_t *buffer);
+int arm7_9_bulk_read_memory(struct target *target, target_addr_t address,
+		uint32_t count, uint8_t *buffer);
 
 int arm7_9_run_algorithm(struct target *target, int num_mem_params,
 		struct mem_param *mem_params, int num_reg_prams,
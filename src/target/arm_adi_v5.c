@@ -472,7 +472,7 @@ static int mem_ap_setup_transfer_verify_size_packing_fallback(struct adiv5_ap *a
  * @return ERROR_OK on success, otherwise an error code.
  */
 static int mem_ap_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t size, uint32_t count,
-		target_addr_t address, bool addrinc)
+		target_addr_t address, bool addrinc, bool run)
 {
 	struct adiv5_dap *dap = ap->dap;
 	size_t nbytes = size * count;
@@ -573,7 +573,10 @@ static int mem_ap_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t siz
 			address += this_size;
 	}
 
-	/* REVISIT: Might want to have a queued version of this function that does not run. */
+	/* a queued write is completed, and its errors reported, by the caller's dap_run() */
+	if (!run)
+		return retval;
+
 	if (retval == ERROR_OK)
 		retval = dap_run(dap);
 
@@ -588,6 +591,90 @@ static int mem_ap_write(struct adiv5_ap *ap, const uint8_t *buffer, uint32_t siz
 	return retval;
 }
 
+/* A MEM-AP block read queued by mem_ap_read_buf_queued() */
+struct mem_ap_queued_read {
+	struct list_head lh;
+	struct adiv5_ap *ap;
+	uint8_t *buffer;
+	uint32_t size;
+	uint32_t count;
+	target_addr_t address;
+	/* the DRW words, unpacked into buffer once read */
+	uint32_t *read_buf;
+};
+
+/* Queue the DRW reads of a block read. read_buf gets one word per DRW read. */
+static int mem_ap_queue_read(struct adiv5_ap *ap, uint32_t *read_buf, uint32_t size, uint32_t count,
+		target_addr_t adr, bool addrinc)
+{
+	struct adiv5_dap *dap = ap->dap;
+	size_t nbytes = size * count;
+	target_addr_t address = adr;
+	uint32_t *read_ptr = read_buf;
+	int retval = ERROR_OK;
+
+	/* Queue up all reads. Each read will store the entire DRW word in the read buffer. How many
+	 * useful bytes it contains, and their location in the word, depends on the type of transfer
+	 * and alignment. */
+	while (nbytes > 0) {
+		unsigned int this_size;
+		retval = mem_ap_setup_transfer_verify_size_packing_fallback(ap,
+					size, address,
+					addrinc, nbytes >= 4, &this_size);
+		if (retval != ERROR_OK)
+			break;
+
+
+		unsigned int drw_ops = DIV_ROUND_UP(this_size, 4);
+		while (drw_ops--) {
+			retval = dap_queue_ap_read(ap, MEM_AP_REG_DRW(dap), read_ptr++);
+			if (retval != ERROR_OK)
+				break;
+		}
+
+		nbytes -= this_size;
+		if (addrinc)
+			address += this_size;
+
+		mem_ap_update_tar_cache(ap);
+	}
+
+	return retval;
+}
+
+/* Populate the caller's buffer from the correct DRW word and byte lane */
+static void mem_ap_unpack_read(struct adiv5_ap *ap, uint8_t *buffer, const uint32_t *read_buf,
+		uint32_t size, size_t nbytes, target_addr_t address, bool addrinc)
+{
+	const uint32_t *read_ptr = read_buf;
+	target_addr_t ti_be_lane_xor = ap->dap->ti_be_32_quirks ? 3 : 0;
+
+	while (nbytes > 0) {
+		/* Convert transfers longer than 32-bit on word-at-a-time basis */
+		unsigned int this_size = MIN(size, 4);
+
+		if (size < 4 && addrinc && ap->packed_transfers_supported && nbytes >= 4
+				&& max_tar_block_size(ap->tar_autoincr_block, address) >= 4) {
+			this_size = 4;	/* Packed read of 4 bytes or 2 halfwords */
+		}
+
+		switch (this_size) {
+		case 4:
+			*buffer++ = *read_ptr >> 8 * ((address++ & 3) ^ ti_be_lane_xor);
+			*buffer++ = *read_ptr >> 8 * ((address++ & 3) ^ ti_be_lane_xor);
+			/* fallthrough */
+		case 2:
+			*buffer++ = *read_ptr >> 8 * ((address++ & 3) ^ ti_be_lane_xor);
+			/* fallthrough */
+		case 1:
+			*buffer++ = *read_ptr >> 8 * ((address++ & 3) ^ ti_be_lane_xor);
+		}
+
+		read_ptr++;
+		nbytes -= this_size;
+	}
+}
+
 /**
  * Synchronous read of a block of memory, using a specific access size.
  *
@@ -630,46 +717,16 @@ static int mem_ap_read(struct adiv5_ap *ap, uint8_t *buffer, uint32_t size, uint
 	uint32_t *read_buf = calloc(count, MAX(sizeof(uint32_t), size));
 
 	/* Multiplication count * sizeof(uint32_t) may overflow, calloc() is safe */
-	uint32_t *read_ptr = read_buf;
 	if (!read_buf) {
 		LOG_ERROR("Failed to allocate read buffer");
 		return ERROR_FAIL;
 	}
 
-	/* Queue up all reads. Each read will store the entire DRW word in the read buffer. How many
-	 * useful bytes it contains, and their location in the word, depends on the type of transfer
-	 * and alignment. */
-	while (nbytes > 0) {
-		unsigned int this_size;
-		retval = mem_ap_setup_transfer_verify_size_packing_fallback(ap,
-					size, address,
-					addrinc, nbytes >= 4, &this_size);
-		if (retval != ERROR_OK)
-			break;
-
-
-		unsigned int drw_ops = DIV_ROUND_UP(this_size, 4);
-		while (drw_ops--) {
-			retval = dap_queue_ap_read(ap, MEM_AP_REG_DRW(dap), read_ptr++);
-			if (retval != ERROR_OK)
-				break;
-		}
-
-		nbytes -= this_size;
-		if (addrinc)
-			address += this_size;
-
-		mem_ap_update_tar_cache(ap);
-	}
+	retval = mem_ap_queue_read(ap, read_buf, size, count, adr, addrinc);
 
 	if (retval == ERROR_OK)
 		retval = dap_run(dap);
 
-	/* Restore state */
-	address = adr;
-	nbytes = size * count;
-	read_ptr = read_buf;
-
 	/* If something failed, read TAR to find out how much data was successfully read, so we can
 	 * at least give the caller what we have. */
 	if (retval == ERROR_TARGET_SIZE_NOT_SUPPORTED) {
@@ -687,35 +744,32 @@ static int mem_ap_read(struct adiv5_ap *ap, uint8_t *buffer, uint32_t size, uint
 		}
 	}
 
-	target_addr_t ti_be_lane_xor = dap->ti_be_32_quirks ? 3 : 0;
+	mem_ap_unpack_read(ap, buffer, read_buf, size, nbytes, address, addrinc);
 
-	/* Replay loop to populate caller's buffer from the correct word and byte lane */
-	while (nbytes > 0) {
-		/* Convert transfers longer than 32-bit on word-at-a-time basis */
-		unsigned int this_size = MIN(size, 4);
+	free(read_buf);
+	return retval;
+}
 
-		if (size < 4 && addrinc && ap->packed_transfers_supported && nbytes >= 4
-				&& max_tar_block_size(ap->tar_autoincr_block, address) >= 4) {
-			this_size = 4;	/* Packed read of 4 bytes or 2 halfwords */
-		}
+int mem_ap_complete_queued_reads(struct adiv5_dap *dap, int retval)
+{
+	struct mem_ap_queued_read *read, *tmp;
+	OOCD_LIST_HEAD(reads);
 
-		switch (this_size) {
-		case 4:
-			*buffer++ = *read_ptr >> 8 * ((address++ & 3) ^ ti_be_lane_xor);
-			*buffer++ = *read_ptr >> 8 * ((address++ & 3) ^ ti_be_lane_xor);
-			/* fallthrough */
-		case 2:
-			*buffer++ = *read_ptr >> 8 * ((address++ & 3) ^ ti_be_lane_xor);
-			/* fallthrough */
-		case 1:
-			*buffer++ = *read_ptr >> 8 * ((address++ & 3) ^ ti_be_lane_xor);
-		}
+	/* detach the list, a failure below may run the DAP again */
+	list_splice_init(&dap->queued_reads, &reads);
 
-		read_ptr++;
-		nbytes -= this_size;
+	list_for_each_entry_safe(read, tmp, &reads, lh) {
+		if (retval == ERROR_OK)
+			mem_ap_unpack_read(read->ap, read->buffer, read->read_buf, read->size,
+				read->size * read->count, read->address, true);
+		list_del(&read->lh);
+		free(read->read_buf);
+		free(read);
 	}
 
-	free(read_buf);
+	if (retval != ERROR_OK)
+		LOG_ERROR("Failed to complete queued memory reads");
+
 	return retval;
 }
 
@@ -728,7 +782,55 @@ int mem_ap_read_buf(struct adiv5_ap *ap,
 int mem_ap_write_buf(struct adiv5_ap *ap,
 		const uint8_t *buffer, uint32_t size, uint32_t count, target_addr_t address)
 {
-	return mem_ap_write(ap, buffer, size, count, address, true);
+	return mem_ap_write(ap, buffer, size, count, address, true, true);
+}
+
+int mem_ap_read_buf_queued(struct adiv5_ap *ap,
+		uint8_t *buffer, uint32_t size, uint32_t count, target_addr_t address)
+{
+	struct adiv5_dap *dap = ap->dap;
+
+	if (dap->ti_be_32_quirks && size > 4) {
+		LOG_ERROR("Read more than 32 bits not supported with ti_be_32_quirks");
+		return ERROR_TARGET_SIZE_NOT_SUPPORTED;
+	}
+
+	if (ap->unaligned_access_bad && (address % size != 0))
+		return ERROR_TARGET_UNALIGNED_ACCESS;
+
+	struct mem_ap_queued_read *read = malloc(sizeof(*read));
+	uint32_t *read_buf = calloc(count, MAX(sizeof(uint32_t), size));
+	if (!read || !read_buf) {
+		LOG_ERROR("Failed to allocate read buffer");
+		free(read);
+		free(read_buf);
+		return ERROR_FAIL;
+	}
+
+	int retval = mem_ap_queue_read(ap, read_buf, size, count, address, true);
+	if (retval != ERROR_OK) {
+		/* the queued DRW reads still point to read_buf, dispose of them */
+		dap_run(dap);
+		free(read);
+		free(read_buf);
+		return retval;
+	}
+
+	read->ap = ap;
+	read->buffer = buffer;
+	read->size = size;
+	read->count = count;
+	read->address = address;
+	read->read_buf = read_buf;
+	list_add_tail(&read->lh, &dap->queued_reads);
+
+	return ERROR_OK;
+}
+
+int mem_ap_write_buf_queued(struct adiv5_ap *ap,
+		const uint8_t *buffer, uint32_t size, uint32_t count, target_addr_t address)
+{
+	return mem_ap_write(ap, buffer, size, count, address, true, false);
 }
 
 int mem_ap_read_buf_noincr(struct adiv5_ap *ap,
@@ -740,7 +842,7 @@ int mem_ap_read_buf_noincr(struct adiv5_ap *ap,
 int mem_ap_write_buf_noincr(struct adiv5_ap *ap,
 		const uint8_t *buffer, uint32_t size, uint32_t count, target_addr_t address)
 {
-	return mem_ap_write(ap, buffer, size, count, address, false);
+	return mem_ap_write(ap, buffer, size, count, address, false, true);
 }
 
 /*--------------------------------------------------------------------------*/
@@ -888,7 +990,7 @@ int dap_dp_init_or_reconnect(struct adiv5_dap *dap)
 int mem_ap_init(struct adiv5_ap *ap)
 {
 	/* check that we support packed transfers */
-	uint32_t cfg;
+	uint32_t cfg, idr;
 	int retval;
 	struct adiv5_dap *dap = ap->dap;
 
@@ -898,21 +1000,43 @@ int mem_ap_init(struct adiv5_ap *ap)
 	if (retval != ERROR_OK)
 		return retval;
 
+	retval = dap_queue_ap_read(ap, AP_REG_IDR(dap), &idr);
+	if (retval != ERROR_OK)
+		return retval;
+
 	retval = dap_run(dap);
 	if (retval != ERROR_OK)
 		return retval;
 
+	/* Keep the transfer sizes and packing probed by a previous init
+	 * (e.g. before a reset or reconnect) if the AP is still the same one */
+	bool reuse_probes = ap->probes_valid && ap->probed_idr == idr
+		&& ap->probed_cfg == cfg;
+
 	ap->cfg_reg = cfg;
 	ap->tar_valid = false;
 	ap->csw_value = 0;      /* force csw and tar write */
 
-	/* CSW 32-bit size must be supported (IHI 0031F and 0074D). */
-	ap->csw_size_supported_mask = BIT(CSW_32BIT);
-	ap->csw_size_probed_mask = BIT(CSW_32BIT);
+	if (reuse_probes) {
+		LOG_DEBUG("MEM_AP IDR 0x%08" PRIx32 ": reusing probed sizes 0x%02" PRIx32 " packing %s",
+			idr, ap->csw_size_supported_mask,
+			!ap->packed_transfers_probed ? "not probed" :
+			ap->packed_transfers_supported ? "supported" : "not supported");
+	} else {
+		/* CSW 32-bit size must be supported (IHI 0031F and 0074D). */
+		ap->csw_size_supported_mask = BIT(CSW_32BIT);
+		ap->csw_size_probed_mask = BIT(CSW_32BIT);
+
+		/* Suppress probing sizes longer than 32 bit if AP has no large data extension */
+		if (!(cfg & MEM_AP_REG_CFG_LD))
+			ap->csw_size_probed_mask |= BIT(CSW_64BIT) | BIT(CSW_128BIT) | BIT(CSW_256BIT);
 
-	/* Suppress probing sizes longer than 32 bit if AP has no large data extension */
-	if (!(cfg & MEM_AP_REG_CFG_LD))
-		ap->csw_size_probed_mask |= BIT(CSW_64BIT) | BIT(CSW_128BIT) | BIT(CSW_256BIT);
+		ap->packed_transfers_supported = false;
+		ap->packed_transfers_probed = false;
+		ap->probed_idr = idr;
+		ap->probed_cfg = cfg;
+		ap->probes_valid = true;
+	}
 
 	/* Both IHI 0031F and 0074D state: Implementations that support transfers
 	 * smaller than a word must support packed transfers. Unfortunately at least
@@ -920,8 +1044,10 @@ int mem_ap_init(struct adiv5_ap *ap)
 	 * Probe for packed transfers except we know they are broken.
 	 * Packed transfers on TI BE-32 processors do not work correctly in
 	 * many cases. */
-	ap->packed_transfers_supported = false;
-	ap->packed_transfers_probed = dap->ti_be_32_quirks ? true : false;
+	if (dap->ti_be_32_quirks) {
+		ap->packed_transfers_supported = false;
+		ap->packed_transfers_probed = true;
+	}
 
 	/* The ARM ADI spec leaves implementation-defined whether unaligned
 	 * memory accesses work, only work partially, or cause a sticky error.
@@ -1223,6 +1349,8 @@ int dap_put_ap(struct adiv5_ap *ap)
 		ap->tar_autoincr_block = (1 << 10);
 		ap->csw_default = CSW_AHB_DEFAULT;
 		ap->cfg_reg = MEM_AP_REG_CFG_INVALID;
+		ap->probes_valid = false;
+		dap_free_cs_components(ap);
 	}
 	return ERROR_OK;
 }
@@ -1839,6 +1967,9 @@ static int rtp_ops_rom_table_entry(const struct rtp_ops *ops,
 /* Broken ROM tables can have circular references. Stop after a while */
 #define ROM_TABLE_MAX_DEPTH (16)
 
+/* Number of ROM table entries read in a single DAP run */
+#define ROM_TABLE_ENTRY_BATCH (16)
+
 /**
  * Value used only during lookup of a CoreSight component in ROM table.
  * Return CORESIGHT_COMPONENT_FOUND when component is found.
@@ -1861,26 +1992,44 @@ static int rtp_rom_loop(enum coresight_access_mode mode, const struct rtp_ops *o
 
 	assert(IS_ALIGNED(base_address, ARM_CS_ALIGN));
 
+	uint32_t batch_low[ROM_TABLE_ENTRY_BATCH], batch_high[ROM_TABLE_ENTRY_BATCH];
+	unsigned int batch_len = 0, batch_idx = 0;
 	unsigned int offset = 0;
 	while (max_entries--) {
 		uint64_t romentry;
 		uint32_t romentry_low, romentry_high;
 		target_addr_t component_base;
 		unsigned int saved_offset = offset;
-
-		int retval = dap_queue_read_reg(mode, ap, base_address, offset, &romentry_low);
-		offset += 4;
-		if (retval == ERROR_OK && width == 64) {
-			retval = dap_queue_read_reg(mode, ap, base_address, offset, &romentry_high);
-			offset += 4;
-		}
-		if (retval == ERROR_OK)
-			retval = dap_run(ap->dap);
-		if (retval != ERROR_OK) {
-			LOG_DEBUG("Failed read ROM table entry");
-			return retval;
+		int retval = ERROR_OK;
+
+		if (batch_idx == batch_len) {
+			/* Entries after the end of table read as zero, prefetch a batch of them */
+			batch_len = MIN(max_entries + 1, ROM_TABLE_ENTRY_BATCH);
+			unsigned int batch_offset = offset;
+			for (batch_idx = 0; retval == ERROR_OK && batch_idx < batch_len; batch_idx++) {
+				retval = dap_queue_read_reg(mode, ap, base_address, batch_offset,
+					&batch_low[batch_idx]);
+				batch_offset += 4;
+				if (retval == ERROR_OK && width == 64) {
+					retval = dap_queue_read_reg(mode, ap, base_address, batch_offset,
+						&batch_high[batch_idx]);
+					batch_offset += 4;
+				}
+			}
+			if (retval == ERROR_OK)
+				retval = dap_run(ap->dap);
+			if (retval != ERROR_OK) {
+				LOG_DEBUG("Failed read ROM table entry");
+				return retval;
+			}
+			batch_idx = 0;
 		}
 
+		romentry_low = batch_low[batch_idx];
+		romentry_high = (width == 64) ? batch_high[batch_idx] : 0;
+		batch_idx++;
+		offset += (width == 64) ? 8 : 4;
+
 		if (width == 64) {
 			romentry = (((uint64_t)romentry_high) << 32) | romentry_low;
 			component_base = base_address +
@@ -2284,9 +2433,163 @@ static int dap_lookup_cs_component_cs_component(int retval,
 	return CORESIGHT_COMPONENT_FOUND;
 }
 
+/* Actions for dap_cache_cs_components() */
+
+struct dap_cs_cache_data {
+	struct adiv5_ap *ap;
+	/* the cache could not be grown */
+	bool out_of_memory;
+};
+
+static struct adiv5_cs_component *dap_cache_cs_components_add(struct dap_cs_cache_data *data)
+{
+	struct adiv5_ap *ap = data->ap;
+
+	struct adiv5_cs_component *components = realloc(ap->cs_components,
+			(ap->num_cs_components + 1) * sizeof(*components));
+	if (!components) {
+		LOG_ERROR("Out of memory");
+		data->out_of_memory = true;
+		return NULL;
+	}
+	ap->cs_components = components;
+
+	struct adiv5_cs_component *component = &components[ap->num_cs_components++];
+	memset(component, 0, sizeof(*component));
+	return component;
+}
+
+/* Marks where the walk missed part of the ROM table: the lookups that reach
+ * it cannot tell which component they would have matched */
+static void dap_cache_cs_components_add_unreadable(struct dap_cs_cache_data *data)
+{
+	struct adiv5_cs_component *component = dap_cache_cs_components_add(data);
+
+	if (component)
+		component->unreadable = true;
+}
+
+static int dap_cache_cs_components_mem_ap_header(int retval, struct adiv5_ap *ap,
+		uint64_t dbgbase, uint32_t apid, int depth, void *priv)
+{
+	if (retval != ERROR_OK)
+		dap_cache_cs_components_add_unreadable(priv);
+	return retval;
+}
+
+static int dap_cache_cs_components_rom_table_entry(int retval, int depth,
+		unsigned int offset, uint64_t romentry, void *priv)
+{
+	if (retval != ERROR_OK)
+		dap_cache_cs_components_add_unreadable(priv);
+	return retval;
+}
+
+static int dap_cache_cs_components_cs_component(int retval,
+		struct cs_component_vals *v, int depth, void *priv)
+{
+	struct dap_cs_cache_data *data = priv;
+
+	if (retval != ERROR_OK) {
+		dap_cache_cs_components_add_unreadable(data);
+		return retval;
+	}
+
+	if (!is_valid_arm_cs_cidr(v->cid))
+		return ERROR_OK;
+
+	if (ARM_CS_CIDR_CLASS(v->cid) != ARM_CS_CLASS_0X9_CS_COMPONENT)
+		return ERROR_OK;
+
+	struct adiv5_cs_component *component = dap_cache_cs_components_add(data);
+	if (!component)
+		return ERROR_FAIL;
+	component->ap_num = v->ap->ap_num;
+	component->base = v->component_base;
+	component->devtype = v->devtype_memtype & ARM_CS_C9_DEVTYPE_MASK;
+	return ERROR_OK;
+}
+
+void dap_free_cs_components(struct adiv5_ap *ap)
+{
+	free(ap->cs_components);
+	ap->cs_components = NULL;
+	ap->num_cs_components = 0;
+	ap->cs_components_valid = false;
+}
+
+/* Walk the whole ROM table once, keeping the CoreSight components found and
+ * the places where it could not be read */
+static int dap_cache_cs_components(struct adiv5_ap *ap)
+{
+	struct dap_cs_cache_data data = {
+		.ap = ap,
+	};
+	struct rtp_ops dap_cache_cs_components_ops = {
+		.ap_header       = NULL,
+		.mem_ap_header   = dap_cache_cs_components_mem_ap_header,
+		.cs_component    = dap_cache_cs_components_cs_component,
+		.rom_table_entry = dap_cache_cs_components_rom_table_entry,
+		.priv            = &data,
+	};
+
+	dap_free_cs_components(ap);
+
+	int retval = rtp_ap(&dap_cache_cs_components_ops, ap, 0);
+	if (retval != ERROR_OK && !data.out_of_memory)
+		dap_cache_cs_components_add_unreadable(&data);
+	if (data.out_of_memory) {
+		dap_free_cs_components(ap);
+		return ERROR_FAIL;
+	}
+
+	LOG_DEBUG("%u CoreSight components cached for AP 0x%" PRIx64,
+		ap->num_cs_components, ap->ap_num);
+	ap->cs_components_valid = true;
+	return ERROR_OK;
+}
+
+static int dap_lookup_cached_cs_component(struct adiv5_ap *ap, uint8_t type,
+		target_addr_t *addr, int32_t core_id)
+{
+	for (unsigned int i = 0; i < ap->num_cs_components; i++) {
+		struct adiv5_cs_component *component = &ap->cs_components[i];
+
+		/* the match may be in the part not read, walk the table again */
+		if (component->unreadable)
+			return ERROR_FAIL;
+
+		if (component->devtype != type || core_id--)
+			continue;
+
+		if (component->ap_num != ap->ap_num) {
+			LOG_DEBUG("CS lookup ended in AP # 0x%" PRIx64 ". Ignore it", component->ap_num);
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		}
+		LOG_DEBUG("CS lookup found at 0x%" PRIx64 " (cached)", (uint64_t)component->base);
+		*addr = component->base;
+		return ERROR_OK;
+	}
+
+	/* not cached */
+	return ERROR_FAIL;
+}
+
 int dap_lookup_cs_component(struct adiv5_ap *ap, uint8_t type,
 		target_addr_t *addr, int32_t core_id)
 {
+	/* The cores of a cluster each look up their own debug base in the same
+	 * ROM table: walk it once, and serve the lookups from what was found.
+	 * A miss, or a lookup reaching a part not read, walks the table again,
+	 * in case a power domain was off when it was cached */
+	if (!ap->cs_components_valid)
+		dap_cache_cs_components(ap);
+	if (ap->cs_components_valid) {
+		int retval = dap_lookup_cached_cs_component(ap, type, addr, core_id);
+		if (retval != ERROR_FAIL)
+			return retval;
+	}
+
 	struct dap_lookup_data lookup = {
 		.type = type,
 		.idx  = core_id,
@@ -2886,6 +3189,120 @@ COMMAND_HANDLER(dap_dpreg_command)
 	return retval;
 }
 
+/* Number of DP register reads timed by "dap benchmark" */
+#define DAP_BENCHMARK_DP_READS 100
+
+static void dap_benchmark_report(struct command_invocation *cmd, const char *name,
+		struct duration *bench, size_t bytes, unsigned int transactions)
+{
+	float elapsed = duration_elapsed(bench);
+
+	if (bytes)
+		command_print(cmd, "%-22s %8.3f s %10.3f KiB/s %10.0f transactions/s",
+			name, elapsed, duration_kbps(bench, bytes), transactions / elapsed);
+	else
+		command_print(cmd, "%-22s %8.3f s %10.1f us/transaction",
+			name, elapsed, elapsed * 1e6 / transactions);
+}
+
+COMMAND_HANDLER(dap_benchmark_command)
+{
+	struct adiv5_dap *dap = adiv5_get_dap(CMD_DATA);
+	struct duration bench;
+	uint64_t apsel;
+	target_addr_t address;
+	uint32_t length = 4096;
+	uint32_t value;
+	int retval = ERROR_OK;
+
+	if (CMD_ARGC < 2 || CMD_ARGC > 3)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_NUMBER(u64, CMD_ARGV[0], apsel);
+	if (!is_ap_num_valid(dap, apsel)) {
+		command_print(CMD, "Invalid AP number");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+	COMMAND_PARSE_ADDRESS(CMD_ARGV[1], address);
+	if (CMD_ARGC == 3)
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[2], length);
+	if (length == 0 || !IS_ALIGNED(length, 4) || !IS_ALIGNED(address, 4)) {
+		command_print(CMD, "Address and length must be word aligned");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	struct adiv5_ap *ap = dap_get_ap(dap, apsel);
+	if (!ap) {
+		command_print(CMD, "Cannot get AP");
+		return ERROR_FAIL;
+	}
+
+	uint8_t *buffer = malloc(length);
+	if (!buffer) {
+		LOG_ERROR("Out of memory");
+		dap_put_ap(ap);
+		return ERROR_FAIL;
+	}
+
+	/* latency: every DP read is a full round trip */
+	duration_start(&bench);
+	for (unsigned int i = 0; retval == ERROR_OK && i < DAP_BENCHMARK_DP_READS; i++)
+		retval = dap_dp_read_atomic(dap, DP_CTRL_STAT, &value);
+	if (retval == ERROR_OK) {
+		duration_measure(&bench);
+		dap_benchmark_report(CMD, "DP read", &bench, 0, DAP_BENCHMARK_DP_READS);
+	}
+
+	if (retval == ERROR_OK) {
+		duration_start(&bench);
+		retval = mem_ap_read_buf(ap, buffer, 4, length / 4, address);
+		if (retval == ERROR_OK) {
+			duration_measure(&bench);
+			dap_benchmark_report(CMD, "read 32-bit", &bench, length, length / 4);
+		}
+	}
+
+	/* write back what was read, the memory content is preserved */
+	if (retval == ERROR_OK) {
+		duration_start(&bench);
+		retval = mem_ap_write_buf(ap, buffer, 4, length / 4, address);
+		if (retval == ERROR_OK) {
+			duration_measure(&bench);
+			dap_benchmark_report(CMD, "write 32-bit", &bench, length, length / 4);
+		}
+	}
+
+	if (retval == ERROR_OK) {
+		duration_start(&bench);
+		retval = mem_ap_read_buf_noincr(ap, buffer, 4, length / 4, address);
+		if (retval == ERROR_OK) {
+			duration_measure(&bench);
+			dap_benchmark_report(CMD, "read 32-bit no incr", &bench, length, length / 4);
+		}
+	}
+
+	/* byte reads, packed four per transaction if the MEM-AP supports it */
+	if (retval == ERROR_OK) {
+		duration_start(&bench);
+		retval = mem_ap_read_buf(ap, buffer, 1, length, address);
+		if (retval == ERROR_OK) {
+			duration_measure(&bench);
+			dap_benchmark_report(CMD, ap->packed_transfers_supported ?
+				"read 8-bit packed" : "read 8-bit", &bench, length,
+				ap->packed_transfers_supported ? length / 4 : length);
+		}
+	}
+
+	if (retval == ERROR_OK)
+		command_print(CMD, "TAR autoincrement block %" PRIu32 " bytes",
+			ap->tar_autoincr_block);
+
+	free(buffer);
+	dap_put_ap(ap);
+
+	return retval;
+}
+
 COMMAND_HANDLER(dap_ti_be_32_quirks_command)
 {
 	struct adiv5_dap *dap = adiv5_get_dap(CMD_DATA);
@@ -2949,6 +3366,14 @@ const struct command_registration dap_instance_commands[] = {
 			"(reg is byte address (bank << 4 | reg) of a word register, like 0 4 8...)",
 		.usage = "reg [value]",
 	},
+	{
+		.name = "benchmark",
+		.handler = dap_benchmark_command,
+		.mode = COMMAND_EXEC,
+		.help = "measure DP access latency and MEM-AP transfer speed "
+			"on a memory area (its content is written back unchanged)",
+		.usage = "ap_num address [length]",
+	},
 	{
 		.name = "baseaddr",
 		.handler = dap_baseaddr_command,
@@ -2979,5 +3404,8 @@ const struct command_registration dap_instance_commands[] = {
 		.help = "set/get quirks mode for Nuvoton NPCX controllers",
 		.usage = "[enable]",
 	},
+	{
+		.chain = dap_livewatch_commands,
+	},
 	COMMAND_REGISTRATION_DONE
 };
@@ -312,6 +312,18 @@ struct adiv5_ap {
 	bool packed_transfers_supported;
 	bool packed_transfers_probed;
 
+	/* IDR and CFG of the MEM-AP the size and packing probes above belong to */
+	uint32_t probed_idr;
+	uint32_t probed_cfg;
+	bool probes_valid;
+
+	/* CoreSight components found behind the AP by a complete walk of its
+	 * ROM table, to look up the debug bases of all the cores of a cluster
+	 * without walking the table again for each, see dap_lookup_cs_component() */
+	struct adiv5_cs_component *cs_components;
+	unsigned int num_cs_components;
+	bool cs_components_valid;
+
 	/* true if unaligned memory access is not supported by the MEM-AP */
 	bool unaligned_access_bad;
 
@@ -328,6 +340,30 @@ struct adiv5_ap {
 	bool config_ap_never_release;
 };
 
+/** A CoreSight component found in a ROM table */
+struct adiv5_cs_component {
+	uint64_t ap_num;
+	target_addr_t base;
+	/* DEVTYPE register, major and sub type */
+	uint8_t devtype;
+	/* stands for a part of the ROM table that could not be read */
+	bool unreadable;
+};
+
+/** Activity of a DAP since it was created */
+struct adiv5_dap_stats {
+	/** DP and AP accesses queued */
+	uint64_t transactions;
+	/** queue runs and the time spent in them */
+	uint64_t runs;
+	uint64_t run_us;
+	/** runs delayed or replayed because of a WAIT response */
+	unsigned int waits;
+	/** runs which failed for another reason */
+	unsigned int faults;
+	/** reconnections of the debug link */
+	unsigned int reconnects;
+};
 
 /**
  * This represents an ARM Debug Interface (v5) Debug Access Port (DAP).
@@ -354,9 +390,18 @@ struct adiv5_dap {
 	/* pool for dap_cmd objects */
 	struct list_head cmd_pool;
 
-	/* number of dap_cmd objects in the pool */
+	/* blocks of dap_cmd objects backing cmd_pool */
+	struct list_head cmd_blocks;
+
+	/* number of dap_cmd objects taken from the pool */
 	size_t cmd_pool_size;
 
+	/* MEM-AP block reads queued by mem_ap_read_buf_queued(), completed by dap_run() */
+	struct list_head queued_reads;
+
+	/* memory sampled by the "livewatch" command, NULL if never used */
+	struct dap_livewatch *livewatch;
+
 	struct jtag_tap *tap;
 	/* Control config */
 	uint32_t dp_ctrl_stat;
@@ -423,6 +468,8 @@ struct adiv5_dap {
 	bool multidrop_dp_id_valid;
 	/** TINSTANCE field of multidrop_targetsel has been configured */
 	bool multidrop_instance_id_valid;
+	/** DP answered to multidrop_targetsel, later reselection can be queued */
+	bool multidrop_verified;
 
 	/**
 	 * Record if enter in SWD required passing through DORMANT
@@ -434,6 +481,9 @@ struct adiv5_dap {
 
 	/* ADIv6 only field indicating ROM Table address size */
 	unsigned int asize;
+
+	/** Activity counters, reported by the metrics service */
+	struct adiv5_dap_stats stats;
 };
 
 /**
@@ -635,11 +685,15 @@ static inline int dap_queue_ap_abort(struct adiv5_dap *dap, uint8_t *ack)
 	return dap->ops->queue_ap_abort(dap, ack);
 }
 
+/* Unpack the reads queued by mem_ap_read_buf_queued(), once the DAP has run */
+int mem_ap_complete_queued_reads(struct adiv5_dap *dap, int retval);
+
 /**
  * Perform all queued DAP operations, and clear any errors posted in the
  * CTRL_STAT register when they are done.  Note that if more than one AP
  * operation will be queued, one of the first operations in the queue
  * should probably enable CORUNDETECT in the CTRL/STAT register.
+ * The MEM-AP block reads queued by mem_ap_read_buf_queued() are completed.
  *
  * @param dap The DAP used.
  *
@@ -648,7 +702,10 @@ static inline int dap_queue_ap_abort(struct adiv5_dap *dap, uint8_t *ack)
 static inline int dap_run(struct adiv5_dap *dap)
 {
 	assert(dap->ops);
-	return dap->ops->run(dap);
+	int retval = dap->ops->run(dap);
+	if (!list_empty(&dap->queued_reads))
+		retval = mem_ap_complete_queued_reads(dap, retval);
+	return retval;
 }
 
 static inline int dap_sync(struct adiv5_dap *dap)
@@ -718,6 +775,15 @@ int mem_ap_read_buf(struct adiv5_ap *ap,
 int mem_ap_write_buf(struct adiv5_ap *ap,
 		const uint8_t *buffer, uint32_t size, uint32_t count, target_addr_t address);
 
+/* Queued MEM-AP memory mapped bus block transfers. The accesses are performed,
+ * in order with the other queued DAP operations, by the next dap_run(), which
+ * acts as the barrier. The read buffer is filled in by that dap_run() and must
+ * stay valid until then, the write buffer is consumed immediately. */
+int mem_ap_read_buf_queued(struct adiv5_ap *ap,
+		uint8_t *buffer, uint32_t size, uint32_t count, target_addr_t address);
+int mem_ap_write_buf_queued(struct adiv5_ap *ap,
+		const uint8_t *buffer, uint32_t size, uint32_t count, target_addr_t address);
+
 /* Synchronous, non-incrementing buffer functions for accessing fifos. */
 int mem_ap_read_buf_noincr(struct adiv5_ap *ap,
 		uint8_t *buffer, uint32_t size, uint32_t count, target_addr_t address);
@@ -752,6 +818,9 @@ struct adiv5_ap *dap_get_config_ap(struct adiv5_dap *dap, uint64_t ap_num);
 /* Decrement AP refcount and release the AP when refcount reaches zero */
 int dap_put_ap(struct adiv5_ap *ap);
 
+/* Drop the CoreSight components cached for the AP */
+void dap_free_cs_components(struct adiv5_ap *ap);
+
 /** Check if SWD multidrop configuration is valid */
 static inline bool dap_is_multidrop(struct adiv5_dap *dap)
 {
@@ -771,6 +840,9 @@ int dap_to_swd(struct adiv5_dap *dap);
 int dap_to_jtag(struct adiv5_dap *dap);
 
 extern const struct command_registration dap_instance_commands[];
+extern const struct command_registration dap_livewatch_commands[];
+
+void dap_livewatch_cleanup(struct adiv5_dap *dap);
 
 struct arm_dap_object;
 extern struct adiv5_dap *dap_instance_by_jim_obj(Jim_Interp *interp, Jim_Obj *o);
@@ -779,6 +851,8 @@ extern int dap_info_command(struct command_invocation *cmd,
 					 struct adiv5_ap *ap);
 extern int dap_register_commands(struct command_context *cmd_ctx);
 extern const char *adiv5_dap_name(struct adiv5_dap *self);
+/* Iterate over all the DAPs, @a dap NULL for the first one */
+extern struct adiv5_dap *dap_get_next(struct adiv5_dap *dap);
 extern const struct swd_driver *adiv5_dap_swd_driver(struct adiv5_dap *self);
 extern int dap_cleanup_all(void);
 
@@ -49,6 +49,8 @@ static void dap_instance_init(struct adiv5_dap *dap)
 	}
 	INIT_LIST_HEAD(&dap->cmd_journal);
 	INIT_LIST_HEAD(&dap->cmd_pool);
+	INIT_LIST_HEAD(&dap->cmd_blocks);
+	INIT_LIST_HEAD(&dap->queued_reads);
 }
 
 const char *adiv5_dap_name(struct adiv5_dap *self)
@@ -57,6 +59,20 @@ const char *adiv5_dap_name(struct adiv5_dap *self)
 	return obj->name;
 }
 
+struct adiv5_dap *dap_get_next(struct adiv5_dap *dap)
+{
+	struct arm_dap_object *obj;
+
+	if (!dap)
+		obj = list_first_entry(&all_dap, struct arm_dap_object, lh);
+	else
+		obj = list_next_entry(container_of(dap, struct arm_dap_object, dap), lh);
+
+	if (&obj->lh == &all_dap)
+		return NULL;
+	return &obj->dap;
+}
+
 const struct swd_driver *adiv5_dap_swd_driver(struct adiv5_dap *self)
 {
 	struct arm_dap_object *obj = container_of(self, struct arm_dap_object, dap);
@@ -164,9 +180,11 @@ int dap_cleanup_all(void)
 
 	list_for_each_entry_safe(obj, tmp, &all_dap, lh) {
 		dap = &obj->dap;
+		dap_livewatch_cleanup(dap);
 		for (unsigned int i = 0; i <= DP_APSEL_MAX; i++) {
 			if (dap->ap[i].refcount != 0)
 				LOG_ERROR("BUG: refcount AP#%u still %u at exit", i, dap->ap[i].refcount);
+			dap_free_cs_components(&dap->ap[i]);
 		}
 		if (dap->ops && dap->ops->quit)
 			dap->ops->quit(dap);
@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/**
+ * @file
+ * Streaming ITM/DWT packet decoder. The state is kept across calls, so the
+ * trace data can be fed in chunks of any size as it is received.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stddef.h>
+
+#include "arm_itm.h"
+
+#define ITM_OVERFLOW		0x70
+#define ITM_SYNC_ZEROS		5
+#define ITM_SYNC_END		0x80
+#define ITM_C_BIT			0x80
+#define ITM_HW_SOURCE		0x04
+
+void itm_decoder_init(struct itm_decoder *decoder, itm_packet_handler handler,
+		void *priv)
+{
+	*decoder = (struct itm_decoder){
+		.handler = handler,
+		.priv = priv,
+		.state = ITM_STATE_HEADER,
+	};
+}
+
+static void itm_emit(struct itm_decoder *decoder, enum itm_packet_type type,
+		unsigned int id, unsigned int size, uint32_t value)
+{
+	const struct itm_packet packet = {
+		.type = type,
+		.id = id,
+		.size = size,
+		.value = value,
+	};
+
+	decoder->handler(decoder, &packet, decoder->priv);
+}
+
+static void itm_header(struct itm_decoder *decoder, uint8_t byte)
+{
+	if (byte == 0) {
+		decoder->zeros++;
+		return;
+	}
+	if (byte == ITM_SYNC_END && decoder->zeros >= ITM_SYNC_ZEROS) {
+		decoder->zeros = 0;
+		return;
+	}
+	decoder->zeros = 0;
+
+	decoder->header = byte;
+	decoder->payload = 0;
+	decoder->received = 0;
+
+	if (byte == ITM_OVERFLOW) {
+		itm_emit(decoder, ITM_PACKET_OVERFLOW, 0, 0, 0);
+	} else if ((byte & 0x0f) == 0) {
+		/* local timestamp, format 2 holds the value in the header */
+		if (byte & ITM_C_BIT) {
+			decoder->state = ITM_STATE_TIMESTAMP;
+		} else {
+			decoder->timestamp += (byte >> 4) & 0x7;
+			itm_emit(decoder, ITM_PACKET_LOCAL_TIMESTAMP, 0, 0, (byte >> 4) & 0x7);
+		}
+	} else if ((byte & 0x03) == 0) {
+		/* extension or global timestamp, skipped */
+		if (byte & ITM_C_BIT)
+			decoder->state = ITM_STATE_SKIP;
+	} else {
+		static const unsigned int source_size[] = { 0, 1, 2, 4 };
+		decoder->payload_size = source_size[byte & 0x03];
+		decoder->state = ITM_STATE_SOURCE;
+	}
+}
+
+static void itm_byte(struct itm_decoder *decoder, uint8_t byte)
+{
+	switch (decoder->state) {
+	case ITM_STATE_HEADER:
+		itm_header(decoder, byte);
+		break;
+	case ITM_STATE_SOURCE:
+		decoder->payload |= (uint32_t)byte << (8 * decoder->received);
+		if (++decoder->received == decoder->payload_size) {
+			decoder->state = ITM_STATE_HEADER;
+			itm_emit(decoder,
+				(decoder->header & ITM_HW_SOURCE) ? ITM_PACKET_HARDWARE : ITM_PACKET_SOFTWARE,
+				decoder->header >> 3, decoder->payload_size, decoder->payload);
+		}
+		break;
+	case ITM_STATE_TIMESTAMP:
+		/* 7 bits per byte, while the C bit is set */
+		if (decoder->received < 5)
+			decoder->payload |= (uint32_t)(byte & 0x7f) << (7 * decoder->received);
+		decoder->received++;
+		if (!(byte & ITM_C_BIT)) {
+			decoder->state = ITM_STATE_HEADER;
+			decoder->timestamp += decoder->payload;
+			itm_emit(decoder, ITM_PACKET_LOCAL_TIMESTAMP, 0, 0, decoder->payload);
+		}
+		break;
+	case ITM_STATE_SKIP:
+		if (!(byte & ITM_C_BIT))
+			decoder->state = ITM_STATE_HEADER;
+		break;
+	}
+}
+
+void itm_decoder_feed(struct itm_decoder *decoder, const uint8_t *data,
+		size_t length)
+{
+	for (size_t i = 0; i < length; i++)
+		itm_byte(decoder, data[i]);
+}
@@ -0,0 +1,80 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_TARGET_ARM_ITM_H
+#define OPENOCD_TARGET_ARM_ITM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @file
+ * Streaming decoder of the ITM/DWT packet protocol, as output by the ITM
+ * of a Cortex-M through the TPIU with the formatter bypassed.
+ * See ARMv7-M Architecture Reference Manual, Appendix D4.
+ */
+
+enum itm_packet_type {
+	/** Instrumentation packet, written by software to a stimulus port */
+	ITM_PACKET_SOFTWARE,
+	/** Hardware source packet, sent by the DWT */
+	ITM_PACKET_HARDWARE,
+	/** Local timestamp, the value is the delta from the previous one */
+	ITM_PACKET_LOCAL_TIMESTAMP,
+	/** Packets were lost by the ITM */
+	ITM_PACKET_OVERFLOW,
+};
+
+/* DWT hardware source packet IDs */
+#define ITM_HW_ID_EVENT_COUNTER		0
+#define ITM_HW_ID_EXCEPTION_TRACE	1
+#define ITM_HW_ID_PC_SAMPLE			2
+/* data trace PC value and address offset of comparator n */
+#define ITM_HW_ID_DATA_PC(n)		(8 + 2 * (n))
+#define ITM_HW_ID_DATA_ADDRESS(n)	(9 + 2 * (n))
+/* data trace data value of comparator n, read or write */
+#define ITM_HW_ID_DATA_READ(n)		(16 + 2 * (n))
+#define ITM_HW_ID_DATA_WRITE(n)		(17 + 2 * (n))
+
+struct itm_packet {
+	enum itm_packet_type type;
+	/** Stimulus port of a software packet, discriminator of a hardware one */
+	unsigned int id;
+	/** Payload size in bytes, 1, 2 or 4 */
+	unsigned int size;
+	uint32_t value;
+};
+
+struct itm_decoder;
+
+typedef void (*itm_packet_handler)(struct itm_decoder *decoder,
+		const struct itm_packet *packet, void *priv);
+
+enum itm_decoder_state {
+	ITM_STATE_HEADER,
+	ITM_STATE_SOURCE,
+	ITM_STATE_TIMESTAMP,
+	ITM_STATE_SKIP,
+};
+
+struct itm_decoder {
+	itm_packet_handler handler;
+	void *priv;
+
+	/* packet being decoded */
+	enum itm_decoder_state state;
+	uint8_t header;
+	unsigned int payload_size;
+	unsigned int received;
+	uint32_t payload;
+	unsigned int zeros;
+
+	/** Sum of the local timestamps, in timestamp clock ticks */
+	uint64_t timestamp;
+};
+
+void itm_decoder_init(struct itm_decoder *decoder, itm_packet_handler handler,
+		void *priv);
+void itm_decoder_feed(struct itm_decoder *decoder, const uint8_t *data,
+		size_t length);
+
+#endif /* OPENOCD_TARGET_ARM_ITM_H */
@@ -34,9 +34,11 @@
 #include <jtag/interface.h>
 #include <server/server.h>
 #include <target/arm_adi_v5.h>
+#include <target/arm_itm.h>
 #include <target/target.h>
 #include <transport/transport.h>
 #include "arm_tpiu_swo.h"
+#include "trace_recorder.h"
 
 /* START_DEPRECATED_TPIU */
 #include <target/cortex_m.h>
@@ -44,6 +46,13 @@
 /* END_DEPRECATED_TPIU */
 
 #define TCP_SERVICE_NAME                "tpiu_swo_trace"
+#define ARM_TPIU_SWO_TRACE_BUF_SIZE     4096
+/* adapter reads of a timer tick, at most */
+#define ARM_TPIU_SWO_POLL_MAX_READS     16
+#define ITM_TCP_SERVICE_NAME            "tpiu_swo_itm"
+
+/* stimulus ports the instrumentation packet header can name */
+#define ITM_NUM_PORTS                   32
 
 /* default for Cortex-M3 and Cortex-M4 specific TPIU */
 #define TPIU_SWO_DEFAULT_BASE           0xE0040000
@@ -112,6 +121,18 @@ struct arm_tpiu_swo_object {
 	char *out_filename;
 	/** track TCP connections */
 	struct list_head connections;
+	/** bytes of trace data captured */
+	uint64_t trace_bytes;
+	/** timer ticks which left data in the adapter after the last read */
+	unsigned int trace_busy_polls;
+	/** overflow packets sent by the ITM, seen when decoding */
+	unsigned int itm_overflows;
+	/** ITM decoder of the captured trace, when ports are routed or PCs sampled */
+	struct itm_decoder itm;
+	/** outputs of the ITM stimulus ports */
+	struct list_head itm_sinks;
+	/** histogram of the DWT PC samples */
+	struct arm_tpiu_swo_pc_histogram *pc_histogram;
 	/* START_DEPRECATED_TPIU */
 	bool recheck_ap_cur_target;
 	/* END_DEPRECATED_TPIU */
@@ -126,22 +147,144 @@ struct arm_tpiu_swo_priv_connection {
 	struct arm_tpiu_swo_object *obj;
 };
 
+/* output of one ITM stimulus port */
+struct arm_tpiu_swo_itm_sink {
+	struct list_head lh;
+	unsigned int port;
+	char *out_filename;
+	FILE *file;
+	struct list_head connections;
+	/* data of the port decoded from the last trace chunk */
+	uint8_t buf[ARM_TPIU_SWO_TRACE_BUF_SIZE];
+	size_t size;
+};
+
+struct arm_tpiu_swo_pc_count {
+	uint32_t pc;
+	uint32_t count;
+};
+
+/* open addressing hash table of the sampled PCs */
+struct arm_tpiu_swo_pc_histogram {
+	struct arm_tpiu_swo_pc_count *table;
+	/* a power of 2 */
+	unsigned int table_size;
+	unsigned int used;
+	uint64_t samples;
+	uint64_t sleep_samples;
+};
+
 static OOCD_LIST_HEAD(all_tpiu_swo);
 
-#define ARM_TPIU_SWO_TRACE_BUF_SIZE	4096
+static int arm_tpiu_swo_pc_histogram_add(struct arm_tpiu_swo_pc_histogram *h, uint32_t pc)
+{
+	/* keep the load under 3/4 */
+	if ((h->used + 1) * 4 > h->table_size * 3) {
+		unsigned int size = h->table_size ? h->table_size * 2 : 1024;
+		struct arm_tpiu_swo_pc_count *table = calloc(size, sizeof(*table));
+		if (!table)
+			return ERROR_FAIL;
 
-static int arm_tpiu_swo_poll_trace(void *priv)
+		for (unsigned int i = 0; i < h->table_size; i++) {
+			if (!h->table[i].count)
+				continue;
+			unsigned int j = (h->table[i].pc >> 1) & (size - 1);
+			while (table[j].count)
+				j = (j + 1) & (size - 1);
+			table[j] = h->table[i];
+		}
+		free(h->table);
+		h->table = table;
+		h->table_size = size;
+	}
+
+	/* Thumb code, bit 0 of the PC is always clear */
+	unsigned int i = (pc >> 1) & (h->table_size - 1);
+	while (h->table[i].count && h->table[i].pc != pc)
+		i = (i + 1) & (h->table_size - 1);
+
+	if (!h->table[i].count) {
+		h->table[i].pc = pc;
+		h->used++;
+	}
+	h->table[i].count++;
+	h->samples++;
+
+	return ERROR_OK;
+}
+
+static void arm_tpiu_swo_itm_packet(struct itm_decoder *decoder,
+		const struct itm_packet *packet, void *priv)
 {
 	struct arm_tpiu_swo_object *obj = priv;
+
+	if (packet->type == ITM_PACKET_OVERFLOW) {
+		obj->itm_overflows++;
+	} else if (packet->type == ITM_PACKET_SOFTWARE) {
+		struct arm_tpiu_swo_itm_sink *sink;
+
+		list_for_each_entry(sink, &obj->itm_sinks, lh) {
+			if (sink->port != packet->id || sink->size + packet->size > sizeof(sink->buf))
+				continue;
+			for (unsigned int i = 0; i < packet->size; i++)
+				sink->buf[sink->size++] = packet->value >> (8 * i);
+		}
+	} else if (packet->type == ITM_PACKET_HARDWARE && packet->id == ITM_HW_ID_PC_SAMPLE
+			&& obj->pc_histogram) {
+		/* a one byte PC sample tells the core was sleeping */
+		if (packet->size == 1) {
+			obj->pc_histogram->samples++;
+			obj->pc_histogram->sleep_samples++;
+		} else if (arm_tpiu_swo_pc_histogram_add(obj->pc_histogram, packet->value) != ERROR_OK) {
+			LOG_ERROR("Out of memory, PC sample dropped");
+		}
+	}
+}
+
+static void arm_tpiu_swo_itm_flush(struct arm_tpiu_swo_object *obj)
+{
+	struct arm_tpiu_swo_itm_sink *sink;
+	struct arm_tpiu_swo_connection *c;
+
+	list_for_each_entry(sink, &obj->itm_sinks, lh) {
+		if (!sink->size)
+			continue;
+
+		if (sink->file && fwrite(sink->buf, 1, sink->size, sink->file) == sink->size)
+			fflush(sink->file);
+		else if (sink->file)
+			LOG_ERROR("Error writing to the ITM port %u destination file", sink->port);
+
+		list_for_each_entry(c, &sink->connections, lh)
+			if (connection_write(c->connection, sink->buf, sink->size) != (int)sink->size)
+				LOG_ERROR("Error writing to ITM port %u connection", sink->port);
+
+		sink->size = 0;
+	}
+}
+
+static int arm_tpiu_swo_poll_trace_once(struct arm_tpiu_swo_object *obj, bool *full)
+{
 	uint8_t buf[ARM_TPIU_SWO_TRACE_BUF_SIZE];
 	size_t size = sizeof(buf);
 	struct arm_tpiu_swo_connection *c;
 
+	*full = false;
+
 	int retval = adapter_poll_trace(buf, &size);
 	if (retval != ERROR_OK || !size)
 		return retval;
 
+	obj->trace_bytes += size;
+	*full = size == sizeof(buf);
+
 	target_call_trace_callbacks(/*target*/NULL, size, buf);
+	trace_recorder_write(TRACE_RECORDER_SRC_SWO, 0, buf, size);
+
+	if (!list_empty(&obj->itm_sinks) || obj->pc_histogram) {
+		itm_decoder_feed(&obj->itm, buf, size);
+		arm_tpiu_swo_itm_flush(obj);
+	}
 
 	if (obj->file) {
 		if (fwrite(buf, 1, size, obj->file) == size) {
@@ -160,6 +303,28 @@ static int arm_tpiu_swo_poll_trace(void *priv)
 	return ERROR_OK;
 }
 
+static int arm_tpiu_swo_poll_trace(void *priv)
+{
+	struct arm_tpiu_swo_object *obj = priv;
+	bool full = true;
+
+	/*
+	 * Drain the adapter while it returns full buffers, so a high SWO data
+	 * rate doesn't overflow the adapter buffer between two timer ticks.
+	 */
+	for (unsigned int i = 0; i < ARM_TPIU_SWO_POLL_MAX_READS && full; i++) {
+		int retval = arm_tpiu_swo_poll_trace_once(obj, &full);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	/* still data after the last read, the capture may not keep up */
+	if (full)
+		obj->trace_busy_polls++;
+
+	return ERROR_OK;
+}
+
 static int arm_tpiu_swo_handle_event(struct arm_tpiu_swo_object *obj, enum arm_tpiu_swo_event event)
 {
 	for (struct arm_tpiu_swo_event_action *ea = obj->event_action; ea; ea = ea->next) {
@@ -206,6 +371,27 @@ static void arm_tpiu_swo_close_output(struct arm_tpiu_swo_object *obj)
 		remove_service(TCP_SERVICE_NAME, &obj->out_filename[1]);
 }
 
+static void arm_tpiu_swo_itm_sink_free(struct arm_tpiu_swo_itm_sink *sink)
+{
+	list_del(&sink->lh);
+	if (sink->file)
+		fclose(sink->file);
+	if (sink->out_filename[0] == ':')
+		remove_service(ITM_TCP_SERVICE_NAME, &sink->out_filename[1]);
+	free(sink->out_filename);
+	free(sink);
+}
+
+static void arm_tpiu_swo_pc_histogram_free(struct arm_tpiu_swo_object *obj)
+{
+	if (!obj->pc_histogram)
+		return;
+
+	free(obj->pc_histogram->table);
+	free(obj->pc_histogram);
+	obj->pc_histogram = NULL;
+}
+
 int arm_tpiu_swo_cleanup_all(void)
 {
 	struct arm_tpiu_swo_object *obj, *tmp;
@@ -238,6 +424,11 @@ int arm_tpiu_swo_cleanup_all(void)
 		if (obj->ap)
 			dap_put_ap(obj->ap);
 
+		struct arm_tpiu_swo_itm_sink *sink, *sink_tmp;
+		list_for_each_entry_safe(sink, sink_tmp, &obj->itm_sinks, lh)
+			arm_tpiu_swo_itm_sink_free(sink);
+		arm_tpiu_swo_pc_histogram_free(obj);
+
 		free(obj->name);
 		free(obj->out_filename);
 		free(obj);
@@ -597,6 +788,43 @@ static const struct service_driver arm_tpiu_swo_service_driver = {
 	.keep_client_alive_handler = NULL,
 };
 
+static int arm_tpiu_swo_itm_new_connection(struct connection *connection)
+{
+	struct arm_tpiu_swo_itm_sink *sink = connection->service->priv;
+	struct arm_tpiu_swo_connection *c = malloc(sizeof(*c));
+	if (!c) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	c->connection = connection;
+	list_add(&c->lh, &sink->connections);
+	return ERROR_OK;
+}
+
+static int arm_tpiu_swo_itm_connection_closed(struct connection *connection)
+{
+	struct arm_tpiu_swo_itm_sink *sink = connection->service->priv;
+	struct arm_tpiu_swo_connection *c, *tmp;
+
+	list_for_each_entry_safe(c, tmp, &sink->connections, lh)
+		if (c->connection == connection) {
+			list_del(&c->lh);
+			free(c);
+			return ERROR_OK;
+		}
+	LOG_ERROR("Failed to find connection to close!");
+	return ERROR_FAIL;
+}
+
+static const struct service_driver arm_tpiu_swo_itm_service_driver = {
+	.name = "tpiu_swo_itm",
+	.new_connection_during_keep_alive_handler = NULL,
+	.new_connection_handler = arm_tpiu_swo_itm_new_connection,
+	.input_handler = arm_tpiu_swo_service_input,
+	.connection_closed_handler = arm_tpiu_swo_itm_connection_closed,
+	.keep_client_alive_handler = NULL,
+};
+
 COMMAND_HANDLER(handle_arm_tpiu_swo_enable)
 {
 	struct arm_tpiu_swo_object *obj = CMD_DATA;
@@ -768,6 +996,9 @@ COMMAND_HANDLER(handle_arm_tpiu_swo_enable)
 		target_register_timer_callback(arm_tpiu_swo_poll_trace, 1,
 			TARGET_TIMER_TYPE_PERIODIC, obj);
 
+		obj->trace_bytes = 0;
+		obj->trace_busy_polls = 0;
+		obj->itm_overflows = 0;
 		obj->en_capture = true;
 	} else if (obj->pin_protocol == TPIU_SPPR_PROTOCOL_MANCHESTER || obj->pin_protocol == TPIU_SPPR_PROTOCOL_UART) {
 		prescaler = (obj->traceclkin_freq + obj->swo_pin_freq / 2) / obj->swo_pin_freq;
@@ -868,6 +1099,158 @@ COMMAND_HANDLER(handle_arm_tpiu_swo_disable)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_arm_tpiu_swo_itm_port)
+{
+	struct arm_tpiu_swo_object *obj = CMD_DATA;
+	struct arm_tpiu_swo_itm_sink *sink, *tmp;
+	unsigned int port;
+
+	if (CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], port);
+	if (port >= ITM_NUM_PORTS) {
+		command_print(CMD, "Stimulus port must be 0 to %u", ITM_NUM_PORTS - 1);
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	list_for_each_entry_safe(sink, tmp, &obj->itm_sinks, lh)
+		if (sink->port == port)
+			arm_tpiu_swo_itm_sink_free(sink);
+
+	if (!strcmp(CMD_ARGV[1], "off"))
+		return ERROR_OK;
+
+	if (obj->en_formatter)
+		LOG_WARNING("%s: ITM ports can only be decoded with the formatter off", obj->name);
+
+	sink = calloc(1, sizeof(*sink));
+	if (!sink) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	INIT_LIST_HEAD(&sink->connections);
+	sink->port = port;
+	sink->out_filename = strdup(CMD_ARGV[1]);
+	if (!sink->out_filename) {
+		LOG_ERROR("Out of memory");
+		free(sink);
+		return ERROR_FAIL;
+	}
+
+	int retval = ERROR_OK;
+	if (sink->out_filename[0] == ':') {
+		retval = add_service(&arm_tpiu_swo_itm_service_driver, &sink->out_filename[1],
+			CONNECTION_LIMIT_UNLIMITED, sink);
+		if (retval != ERROR_OK)
+			command_print(CMD, "Can't configure ITM port TCP port %s", &sink->out_filename[1]);
+	} else {
+		sink->file = fopen(sink->out_filename, "ab");
+		if (!sink->file) {
+			command_print(CMD, "Can't open ITM port destination file \"%s\"", sink->out_filename);
+			retval = ERROR_FAIL;
+		}
+	}
+
+	if (retval != ERROR_OK) {
+		/* nothing else to undo, the sink is not in the list yet */
+		free(sink->out_filename);
+		free(sink);
+		return retval;
+	}
+
+	list_add_tail(&sink->lh, &obj->itm_sinks);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_arm_tpiu_swo_stats)
+{
+	struct arm_tpiu_swo_object *obj = CMD_DATA;
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	command_print(CMD, "%" PRIu64 " bytes captured", obj->trace_bytes);
+	command_print(CMD, "%u polls left data in the adapter", obj->trace_busy_polls);
+	if (!list_empty(&obj->itm_sinks) || obj->pc_histogram)
+		command_print(CMD, "%u ITM overflows", obj->itm_overflows);
+
+	return ERROR_OK;
+}
+
+static int arm_tpiu_swo_pc_count_compare(const void *a, const void *b)
+{
+	const struct arm_tpiu_swo_pc_count *ca = a, *cb = b;
+
+	if (ca->count != cb->count)
+		return ca->count < cb->count ? 1 : -1;
+	return ca->pc < cb->pc ? -1 : ca->pc > cb->pc;
+}
+
+COMMAND_HANDLER(handle_arm_tpiu_swo_pc_histogram)
+{
+	struct arm_tpiu_swo_object *obj = CMD_DATA;
+	unsigned int count = 20;
+
+	if (CMD_ARGC < 1 || CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!strcmp(CMD_ARGV[0], "on")) {
+		if (CMD_ARGC != 1)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		if (obj->pc_histogram)
+			return ERROR_OK;
+		obj->pc_histogram = calloc(1, sizeof(*obj->pc_histogram));
+		if (!obj->pc_histogram) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		return ERROR_OK;
+	}
+
+	if (!strcmp(CMD_ARGV[0], "off")) {
+		if (CMD_ARGC != 1)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		arm_tpiu_swo_pc_histogram_free(obj);
+		return ERROR_OK;
+	}
+
+	if (strcmp(CMD_ARGV[0], "show"))
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 2)
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], count);
+
+	struct arm_tpiu_swo_pc_histogram *h = obj->pc_histogram;
+	if (!h) {
+		command_print(CMD, "PC histogram not enabled");
+		return ERROR_FAIL;
+	}
+
+	command_print(CMD, "%" PRIu64 " samples, %" PRIu64 " sleeping, %u addresses",
+		h->samples, h->sleep_samples, h->used);
+	if (!h->used)
+		return ERROR_OK;
+
+	struct arm_tpiu_swo_pc_count *sorted = malloc(h->used * sizeof(*sorted));
+	if (!sorted) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	unsigned int n = 0;
+	for (unsigned int i = 0; i < h->table_size; i++)
+		if (h->table[i].count)
+			sorted[n++] = h->table[i];
+	qsort(sorted, n, sizeof(*sorted), arm_tpiu_swo_pc_count_compare);
+
+	for (unsigned int i = 0; i < MIN(count, n); i++)
+		command_print(CMD, "0x%08" PRIx32 " %10" PRIu32 " %5.1f%%", sorted[i].pc,
+			sorted[i].count, 100.0 * sorted[i].count / h->samples);
+
+	free(sorted);
+	return ERROR_OK;
+}
+
 static const struct command_registration arm_tpiu_swo_instance_command_handlers[] = {
 	{
 		.name = "configure",
@@ -904,6 +1287,27 @@ static const struct command_registration arm_tpiu_swo_instance_command_handlers[
 		.usage = "",
 		.help = "Disables the TPIU/SWO output",
 	},
+	{
+		.name = "stats",
+		.mode = COMMAND_EXEC,
+		.handler = handle_arm_tpiu_swo_stats,
+		.usage = "",
+		.help = "Show the trace capture counters",
+	},
+	{
+		.name = "itm_port",
+		.mode = COMMAND_ANY,
+		.handler = handle_arm_tpiu_swo_itm_port,
+		.usage = "port (filename|:tcp_port|off)",
+		.help = "Route the data of an ITM stimulus port to a file or a TCP port",
+	},
+	{
+		.name = "pc_histogram",
+		.mode = COMMAND_ANY,
+		.handler = handle_arm_tpiu_swo_pc_histogram,
+		.usage = "(on|off|show [count])",
+		.help = "Collect the DWT PC samples and show the most sampled addresses",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -959,6 +1363,8 @@ static int jim_arm_tpiu_swo_create(Jim_Interp *interp, int argc, Jim_Obj *const
 		return JIM_ERR;
 	}
 	INIT_LIST_HEAD(&obj->connections);
+	INIT_LIST_HEAD(&obj->itm_sinks);
+	itm_decoder_init(&obj->itm, arm_tpiu_swo_itm_packet, obj);
 	adiv5_mem_ap_spot_init(&obj->spot);
 	obj->spot.base = TPIU_SWO_DEFAULT_BASE;
 	obj->port_width = 1;
@@ -1013,6 +1419,22 @@ COMMAND_HANDLER(handle_arm_tpiu_swo_names)
 	return ERROR_OK;
 }
 
+bool arm_tpiu_swo_get_stats(unsigned int index, struct arm_tpiu_swo_stats *stats)
+{
+	struct arm_tpiu_swo_object *obj;
+
+	list_for_each_entry(obj, &all_tpiu_swo, lh) {
+		if (index--)
+			continue;
+		stats->name = obj->name;
+		stats->trace_bytes = obj->trace_bytes;
+		stats->busy_polls = obj->trace_busy_polls;
+		stats->itm_overflows = obj->itm_overflows;
+		return true;
+	}
+	return false;
+}
+
 COMMAND_HANDLER(handle_arm_tpiu_swo_init)
 {
 	struct arm_tpiu_swo_object *obj;
@@ -3,6 +3,9 @@
 #ifndef OPENOCD_TARGET_ARM_TPIU_SWO_H
 #define OPENOCD_TARGET_ARM_TPIU_SWO_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
 /* Values should match TPIU_SPPR_PROTOCOL_xxx */
 enum tpiu_pin_protocol {
 	TPIU_PIN_PROTOCOL_SYNC = 0,                 /**< synchronous trace output */
@@ -18,4 +21,15 @@ extern const struct command_registration arm_tpiu_deprecated_command_handlers[];
 int arm_tpiu_swo_register_commands(struct command_context *cmd_ctx);
 int arm_tpiu_swo_cleanup_all(void);
 
+/** Trace capture activity of a TPIU/SWO object */
+struct arm_tpiu_swo_stats {
+	const char *name;
+	uint64_t trace_bytes;
+	unsigned int busy_polls;
+	unsigned int itm_overflows;
+};
+
+/* Get the statistics of the @a index th TPIU/SWO object, false past the last one */
+bool arm_tpiu_swo_get_stats(unsigned int index, struct arm_tpiu_swo_stats *stats);
+
 #endif /* OPENOCD_TARGET_ARM_TPIU_SWO_H */
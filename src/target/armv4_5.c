@@ -779,6 +779,9 @@ void arm_free_reg_cache(struct arm *arm)
 
 	struct reg_cache *cache = arm->core_cache;
 
+	register_snapshot_free(arm->algorithm_context);
+	arm->algorithm_context = NULL;
+
 	for (unsigned int i = 0; i < cache->num_regs; i++) {
 		struct reg *reg = &cache->reg_list[i];
 
@@ -1411,7 +1414,6 @@ int armv4_5_run_algorithm_inner(struct target *target,
 	struct arm *arm = target_to_arm(target);
 	struct arm_algorithm *arm_algorithm_info = arch_info;
 	enum arm_state core_state = arm->core_state;
-	uint32_t context[17];
 	uint32_t cpsr;
 	int exit_breakpoint_size = 0;
 	int i;
@@ -1451,10 +1453,14 @@ int armv4_5_run_algorithm_inner(struct target *target,
 		if (!r->valid)
 			arm->read_core_reg(target, r, i,
 				arm_algorithm_info->core_mode);
-		context[i] = buf_get_u32(r->value, 0, 32);
 	}
 	cpsr = buf_get_u32(arm->cpsr->value, 0, 32);
 
+	register_snapshot_free(arm->algorithm_context);
+	arm->algorithm_context = register_cache_snapshot(arm->core_cache);
+	if (!arm->algorithm_context)
+		return ERROR_FAIL;
+
 	for (i = 0; i < num_mem_params; i++) {
 		if (mem_params[i].direction == PARAM_IN)
 			continue;
@@ -1561,21 +1567,14 @@ int armv4_5_run_algorithm_inner(struct target *target,
 
 	/* restore everything we saved before (17 or 18 registers) */
 	for (i = 0; i <= 16; i++) {
-		uint32_t regvalue;
-		regvalue = buf_get_u32(ARMV4_5_CORE_REG_MODE(arm->core_cache,
-				arm_algorithm_info->core_mode, i).value, 0, 32);
-		if (regvalue != context[i]) {
+		struct reg *r = &ARMV4_5_CORE_REG_MODE(arm->core_cache,
+				arm_algorithm_info->core_mode, i);
+		if (register_snapshot_restore(arm->algorithm_context, r))
 			LOG_DEBUG("restoring register %s with value 0x%8.8" PRIx32 "",
-				ARMV4_5_CORE_REG_MODE(arm->core_cache,
-				arm_algorithm_info->core_mode, i).name, context[i]);
-			buf_set_u32(ARMV4_5_CORE_REG_MODE(arm->core_cache,
-				arm_algorithm_info->core_mode, i).value, 0, 32, context[i]);
-			ARMV4_5_CORE_REG_MODE(arm->core_cache, arm_algorithm_info->core_mode,
-				i).valid = true;
-			ARMV4_5_CORE_REG_MODE(arm->core_cache, arm_algorithm_info->core_mode,
-				i).dirty = true;
-		}
+				r->name, buf_get_u32(r->value, 0, 32));
 	}
+	register_snapshot_free(arm->algorithm_context);
+	arm->algorithm_context = NULL;
 
 	arm_set_cpsr(arm, cpsr);
 	arm->cpsr->dirty = true;
@@ -1761,6 +1760,84 @@ cleanup:
 	return 1;       /* only one block has been checked */
 }
 
+/** Runs ARM code in the target to fill memory with a pattern. */
+int arm_fill_memory(struct target *target, target_addr_t address,
+		uint32_t size, uint32_t count, uint32_t pattern)
+{
+	struct working_area *fill_algorithm;
+	struct reg_param reg_params[4];
+	struct arm_algorithm arm_algo;
+	struct arm *arm = target_to_arm(target);
+	int retval;
+	uint32_t i;
+	uint32_t exit_var = 0;
+
+	static const uint8_t fill_code_le[] = {
+#include "../../contrib/loaders/fill/armv4_5_fill.inc"
+	};
+
+	assert(sizeof(fill_code_le) % 4 == 0);
+
+	retval = target_alloc_working_area_try(target,
+			sizeof(fill_code_le), &fill_algorithm);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* the algorithm must not overwrite itself, leave such fills to the host */
+	if (address < fill_algorithm->address + fill_algorithm->size
+			&& fill_algorithm->address < address + (uint64_t)count * size) {
+		target_free_working_area(target, fill_algorithm);
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	/* convert code into a buffer in target endianness */
+	for (i = 0; i < ARRAY_SIZE(fill_code_le) / 4; i++) {
+		retval = target_write_u32(target,
+				fill_algorithm->address + i * sizeof(uint32_t),
+				le_to_h_u32(&fill_code_le[i * 4]));
+		if (retval != ERROR_OK)
+			goto cleanup;
+	}
+
+	arm_algo.common_magic = ARM_COMMON_MAGIC;
+	arm_algo.core_mode = ARM_MODE_SVC;
+	arm_algo.core_state = ARM_STATE_ARM;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, address);
+	buf_set_u32(reg_params[1].value, 0, 32, count);
+	buf_set_u32(reg_params[2].value, 0, 32, pattern);
+	buf_set_u32(reg_params[3].value, 0, 32, size);
+
+	/* 20 second timeout/megabyte */
+	uint64_t timeout64 = 20000 * (1 + ((uint64_t)count * size / (1024 * 1024)));
+	unsigned int timeout = MIN(timeout64, UINT32_MAX);
+
+	/* armv4 must exit using a hardware breakpoint */
+	if (arm->arch == ARM_ARCH_V4)
+		exit_var = fill_algorithm->address + sizeof(fill_code_le) - 4;
+
+	retval = target_run_algorithm(target, 0, NULL, 4, reg_params,
+			fill_algorithm->address,
+			exit_var,
+			timeout, &arm_algo);
+
+	if (retval != ERROR_OK)
+		LOG_ERROR("error executing ARM fill algorithm");
+
+	for (i = 0; i < ARRAY_SIZE(reg_params); i++)
+		destroy_reg_param(&reg_params[i]);
+
+cleanup:
+	target_free_working_area(target, fill_algorithm);
+
+	return retval;
+}
+
 static int arm_full_context(struct target *target)
 {
 	struct arm *arm = target_to_arm(target);
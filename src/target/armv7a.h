@@ -34,6 +34,7 @@ enum {
 struct armv7a_l2x_cache {
 	uint32_t base;
 	uint32_t way;
+	uint32_t way_size;	/* from AUX_CTRL, 0 until read */
 };
 
 struct armv7a_cachesize {
@@ -37,90 +37,120 @@ static int arm7a_l2x_sanity_check(struct target *target)
 	return ERROR_OK;
 }
 /*
- * clean and invalidate complete l2x cache
+ * Wait for a background by-way operation to complete, then drain the
+ * buffers of the controller.
  */
-int arm7a_l2x_flush_all_data(struct target *target)
+static int arm7a_l2x_wait_way_op(struct target *target,
+		struct armv7a_l2x_cache *l2x_cache, uint32_t reg)
 {
-	struct armv7a_common *armv7a = target_to_armv7a(target);
-	struct armv7a_l2x_cache *l2x_cache = (struct armv7a_l2x_cache *)
-		(armv7a->armv7a_mmu.armv7a_cache.outer_cache);
-	uint32_t l2_way_val;
+	uint32_t val;
 	int retval;
 
-	retval = arm7a_l2x_sanity_check(target);
-	if (retval)
-		return retval;
+	int64_t then = timeval_ms();
+	for (;;) {
+		retval = target_read_phys_u32(target, l2x_cache->base + reg, &val);
+		if (retval != ERROR_OK)
+			return retval;
+		if (!val)
+			break;
+		if (timeval_ms() > then + 1000) {
+			LOG_ERROR("timeout waiting for l2x way operation to complete");
+			return ERROR_TARGET_TIMEOUT;
+		}
+		keep_alive();
+	}
+
+	return target_write_phys_u32(target, l2x_cache->base + L2X0_CACHE_SYNC, 0);
+}
 
-	l2_way_val = (1 << l2x_cache->way) - 1;
+static int arm7a_l2x_way_op(struct target *target,
+		struct armv7a_l2x_cache *l2x_cache, uint32_t reg)
+{
+	uint32_t l2_way_val = (1 << l2x_cache->way) - 1;
+	int retval;
 
-	return target_write_phys_u32(target,
-			l2x_cache->base + L2X0_CLEAN_INV_WAY,
-			l2_way_val);
+	retval = target_write_phys_u32(target, l2x_cache->base + reg, l2_way_val);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return arm7a_l2x_wait_way_op(target, l2x_cache, reg);
 }
 
-int armv7a_l2x_cache_flush_virt(struct target *target, target_addr_t virt,
-					uint32_t size)
+/*
+ * clean and invalidate complete l2x cache
+ */
+int arm7a_l2x_flush_all_data(struct target *target)
 {
 	struct armv7a_common *armv7a = target_to_armv7a(target);
 	struct armv7a_l2x_cache *l2x_cache = (struct armv7a_l2x_cache *)
 		(armv7a->armv7a_mmu.armv7a_cache.outer_cache);
-	/* FIXME: different controllers have different linelen? */
-	uint32_t i, linelen = 32;
 	int retval;
 
 	retval = arm7a_l2x_sanity_check(target);
 	if (retval)
 		return retval;
 
-	for (i = 0; i < size; i += linelen) {
-		target_addr_t pa, offs = virt + i;
+	return arm7a_l2x_way_op(target, l2x_cache, L2X0_CLEAN_INV_WAY);
+}
 
-		/* FIXME: use less verbose virt2phys? */
-		retval = target->type->virt2phys(target, offs, &pa);
+/* total size of the cache, from the way size field of AUX_CTRL */
+static int arm7a_l2x_cache_size(struct target *target,
+		struct armv7a_l2x_cache *l2x_cache, uint32_t *size)
+{
+	if (!l2x_cache->way_size) {
+		uint32_t aux_ctrl;
+		int retval = target_read_phys_u32(target,
+				l2x_cache->base + L2X0_AUX_CTRL, &aux_ctrl);
 		if (retval != ERROR_OK)
-			goto done;
+			return retval;
 
-		retval = target_write_phys_u32(target,
-				l2x_cache->base + L2X0_CLEAN_INV_LINE_PA, pa);
-		if (retval != ERROR_OK)
-			goto done;
+		/* L2C-310 encoding, 16 KiB to 512 KiB */
+		unsigned int field = MAX((aux_ctrl >> 17) & 0x7, 1U);
+		l2x_cache->way_size = 8192 << field;
 	}
-	return retval;
 
-done:
-	LOG_ERROR("d-cache invalidate failed");
-
-	return retval;
+	*size = l2x_cache->way_size * l2x_cache->way;
+	return ERROR_OK;
 }
 
-static int armv7a_l2x_cache_inval_virt(struct target *target, target_addr_t virt,
-					uint32_t size)
+/*
+ * Maintenance of a virtual address range by line, the lines of a page are
+ * issued without translating each of them again.
+ */
+static int armv7a_l2x_cache_op_virt(struct target *target, target_addr_t virt,
+		uint32_t size, uint32_t line_reg)
 {
 	struct armv7a_common *armv7a = target_to_armv7a(target);
 	struct armv7a_l2x_cache *l2x_cache = (struct armv7a_l2x_cache *)
 		(armv7a->armv7a_mmu.armv7a_cache.outer_cache);
-	/* FIXME: different controllers have different linelen */
-	uint32_t i, linelen = 32;
+	/* FIXME: different controllers have different linelen? */
+	const uint32_t linelen = L2X0_CACHE_LINE_SIZE;
+	/* smallest ARMv7-A page */
+	const target_addr_t page_mask = 0xfff;
+	target_addr_t page = 1, page_pa = 0;
 	int retval;
 
 	retval = arm7a_l2x_sanity_check(target);
 	if (retval)
 		return retval;
 
-	for (i = 0; i < size; i += linelen) {
-		target_addr_t pa, offs = virt + i;
+	for (uint32_t i = 0; i < size; i += linelen) {
+		target_addr_t offs = virt + i;
 
-		/* FIXME: use less verbose virt2phys? */
-		retval = target->type->virt2phys(target, offs, &pa);
-		if (retval != ERROR_OK)
-			goto done;
+		if ((offs & ~page_mask) != page) {
+			page = offs & ~page_mask;
+			retval = target->type->virt2phys(target, page, &page_pa);
+			if (retval != ERROR_OK)
+				goto done;
+		}
 
 		retval = target_write_phys_u32(target,
-				l2x_cache->base + L2X0_INV_LINE_PA, pa);
+				l2x_cache->base + line_reg, page_pa + (offs & page_mask));
 		if (retval != ERROR_OK)
 			goto done;
 	}
-	return retval;
+
+	return target_write_phys_u32(target, l2x_cache->base + L2X0_CACHE_SYNC, 0);
 
 done:
 	LOG_ERROR("d-cache invalidate failed");
@@ -128,39 +158,52 @@ done:
 	return retval;
 }
 
-static int armv7a_l2x_cache_clean_virt(struct target *target, target_addr_t virt,
-					unsigned int size)
+/*
+ * Ranges as large as the whole cache are done by way, in a single
+ * operation of the controller. Not for invalidation, that would drop
+ * dirty lines out of the range.
+ */
+static int armv7a_l2x_cache_op_virt_or_way(struct target *target, target_addr_t virt,
+		uint32_t size, uint32_t line_reg, uint32_t way_reg)
 {
 	struct armv7a_common *armv7a = target_to_armv7a(target);
 	struct armv7a_l2x_cache *l2x_cache = (struct armv7a_l2x_cache *)
 		(armv7a->armv7a_mmu.armv7a_cache.outer_cache);
-	/* FIXME: different controllers have different linelen */
-	uint32_t i, linelen = 32;
+	uint32_t cache_size;
 	int retval;
 
 	retval = arm7a_l2x_sanity_check(target);
 	if (retval)
 		return retval;
 
-	for (i = 0; i < size; i += linelen) {
-		target_addr_t pa, offs = virt + i;
+	retval = arm7a_l2x_cache_size(target, l2x_cache, &cache_size);
+	if (retval != ERROR_OK)
+		return retval;
 
-		/* FIXME: use less verbose virt2phys? */
-		retval = target->type->virt2phys(target, offs, &pa);
-		if (retval != ERROR_OK)
-			goto done;
+	if (size >= cache_size)
+		return arm7a_l2x_way_op(target, l2x_cache, way_reg);
 
-		retval = target_write_phys_u32(target,
-				l2x_cache->base + L2X0_CLEAN_LINE_PA, pa);
-		if (retval != ERROR_OK)
-			goto done;
-	}
-	return retval;
+	return armv7a_l2x_cache_op_virt(target, virt, size, line_reg);
+}
 
-done:
-	LOG_ERROR("d-cache invalidate failed");
+int armv7a_l2x_cache_flush_virt(struct target *target, target_addr_t virt,
+					uint32_t size)
+{
+	return armv7a_l2x_cache_op_virt_or_way(target, virt, size,
+			L2X0_CLEAN_INV_LINE_PA, L2X0_CLEAN_INV_WAY);
+}
 
-	return retval;
+static int armv7a_l2x_cache_inval_virt(struct target *target, target_addr_t virt,
+					uint32_t size)
+{
+	return armv7a_l2x_cache_op_virt(target, virt, size, L2X0_INV_LINE_PA);
+}
+
+static int armv7a_l2x_cache_clean_virt(struct target *target, target_addr_t virt,
+					unsigned int size)
+{
+	return armv7a_l2x_cache_op_virt_or_way(target, virt, size,
+			L2X0_CLEAN_LINE_PA, L2X0_CLEAN_WAY);
 }
 
 static int arm7a_handle_l2x_cache_info_command(struct command_invocation *cmd,
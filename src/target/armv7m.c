@@ -557,7 +557,7 @@ int armv7m_start_algorithm(struct target *target,
 		return ERROR_TARGET_NOT_HALTED;
 	}
 
-	/* Store all non-debug execution registers to armv7m_algorithm_info context */
+	/* Store all non-debug execution registers to the algorithm context */
 	for (unsigned int i = 0; i < armv7m->arm.core_cache->num_regs; i++) {
 		struct reg *reg = &armv7m->arm.core_cache->reg_list[i];
 		if (!reg->exist)
@@ -568,9 +568,24 @@ int armv7m_start_algorithm(struct target *target,
 
 		if (!reg->valid)
 			LOG_TARGET_WARNING(target, "Storing invalid register %s", reg->name);
+	}
+
+	register_snapshot_free(armv7m->arm.algorithm_context);
+	armv7m->arm.algorithm_context = register_cache_snapshot(armv7m->arm.core_cache);
+	if (!armv7m->arm.algorithm_context)
+		return ERROR_FAIL;
 
-		armv7m_algorithm_info->context[i] = buf_get_u32(reg->value, 0, 32);
+	/* R0-R12 only hold the parameters of an algorithm. When the previous
+	 * algorithm left them to be restored, the restore at the end of this
+	 * one is enough: skip writing them before it runs */
+	unsigned int deferred = 0;
+	for (unsigned int i = ARMV7M_R0; i <= ARMV7M_R12; i++) {
+		if (register_snapshot_defer(armv7m->arm.algorithm_context,
+				&armv7m->arm.core_cache->reg_list[i]))
+			deferred++;
 	}
+	if (deferred)
+		LOG_TARGET_DEBUG(target, "%u registers restored after the algorithm only", deferred);
 
 	for (int i = 0; i < num_mem_params; i++) {
 		if (mem_params[i].direction == PARAM_IN)
@@ -719,25 +734,18 @@ int armv7m_wait_algorithm(struct target *target,
 				return ERROR_COMMAND_SYNTAX_ERROR;
 			}
 
+			if (!reg->valid)
+				armv7m_get_core_reg(reg);
+
 			buf_set_u32(reg_params[i].value, 0, 32, buf_get_u32(reg->value, 0, 32));
 		}
 	}
 
-	for (int i = armv7m->arm.core_cache->num_regs - 1; i >= 0; i--) {
-		struct reg *reg = &armv7m->arm.core_cache->reg_list[i];
-		if (!reg->exist)
-			continue;
-
-		uint32_t regvalue;
-		regvalue = buf_get_u32(reg->value, 0, 32);
-		if (regvalue != armv7m_algorithm_info->context[i]) {
-			LOG_TARGET_DEBUG(target, "restoring register %s with value 0x%8.8" PRIx32,
-					  reg->name, armv7m_algorithm_info->context[i]);
-			buf_set_u32(reg->value,
-				0, 32, armv7m_algorithm_info->context[i]);
-			reg->valid = true;
-			reg->dirty = true;
-		}
+	if (armv7m->arm.algorithm_context) {
+		unsigned int restored = register_cache_restore(armv7m->arm.algorithm_context);
+		LOG_TARGET_DEBUG(target, "restored %u registers", restored);
+		register_snapshot_free(armv7m->arm.algorithm_context);
+		armv7m->arm.algorithm_context = NULL;
 	}
 
 	/* restore previous core mode */
@@ -869,6 +877,9 @@ void armv7m_free_reg_cache(struct target *target)
 	if (!cache)
 		return;
 
+	register_snapshot_free(armv7m->arm.algorithm_context);
+	armv7m->arm.algorithm_context = NULL;
+
 	for (i = 0; i < cache->num_regs; i++) {
 		reg = &cache->reg_list[i];
 
@@ -962,6 +973,67 @@ cleanup:
 	return retval;
 }
 
+/** Fills memory with a pattern by running code on the target. */
+int armv7m_fill_memory(struct target *target, target_addr_t address,
+	uint32_t size, uint32_t count, uint32_t pattern)
+{
+	struct working_area *fill_algorithm;
+	struct armv7m_algorithm armv7m_info;
+	struct reg_param reg_params[4];
+	int retval;
+
+	static const uint8_t fill_code[] = {
+#include "../../contrib/loaders/fill/armv7m_fill.inc"
+	};
+
+	retval = target_alloc_working_area_try(target, sizeof(fill_code), &fill_algorithm);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* the algorithm must not overwrite itself, leave such fills to the host */
+	if (address < fill_algorithm->address + fill_algorithm->size
+			&& fill_algorithm->address < address + (uint64_t)count * size) {
+		target_free_working_area(target, fill_algorithm);
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	retval = target_write_buffer(target, fill_algorithm->address,
+			sizeof(fill_code), fill_code);
+	if (retval != ERROR_OK)
+		goto cleanup;
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, address);
+	buf_set_u32(reg_params[1].value, 0, 32, count);
+	buf_set_u32(reg_params[2].value, 0, 32, pattern);
+	buf_set_u32(reg_params[3].value, 0, 32, size);
+
+	uint64_t timeout64 = 20000 * (1 + ((uint64_t)count * size / (1024 * 1024)));
+	unsigned int timeout = MIN(timeout64, UINT32_MAX);
+
+	retval = target_run_algorithm(target, 0, NULL, 4, reg_params, fill_algorithm->address,
+			fill_algorithm->address + sizeof(fill_code) - 2,
+			timeout, &armv7m_info);
+
+	if (retval != ERROR_OK)
+		LOG_TARGET_ERROR(target, "error executing cortex_m fill algorithm");
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(reg_params); i++)
+		destroy_reg_param(&reg_params[i]);
+
+cleanup:
+	target_free_working_area(target, fill_algorithm);
+
+	return retval;
+}
+
 /** Checks an array of memory regions whether they are erased. */
 int armv7m_blank_check_memory(struct target *target,
 	struct target_memory_check_block *blocks, int num_blocks, uint8_t erased_value)
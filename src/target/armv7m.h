@@ -299,8 +299,6 @@ struct armv7m_algorithm {
 	unsigned int common_magic;
 
 	enum arm_mode core_mode;
-
-	uint32_t context[ARMV7M_LAST_REG]; /* ARMV7M_NUM_REGS */
 };
 
 struct reg_cache *armv7m_build_reg_cache(struct target *target);
@@ -347,6 +345,8 @@ int armv7m_checksum_memory(struct target *target,
 		target_addr_t address, uint32_t count, uint32_t *checksum);
 int armv7m_blank_check_memory(struct target *target,
 		struct target_memory_check_block *blocks, int num_blocks, uint8_t erased_value);
+int armv7m_fill_memory(struct target *target, target_addr_t address,
+		uint32_t size, uint32_t count, uint32_t pattern);
 
 int armv7m_maybe_skip_bkpt_inst(struct target *target, bool *inst_found);
 
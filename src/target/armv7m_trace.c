@@ -14,6 +14,129 @@
 #include <target/armv7m_trace.h>
 #include <jtag/interface.h>
 #include <helper/time_support.h>
+#include <rtos/rtos.h>
+#include <target/arm_itm.h>
+
+/* holders of the running thread, written at each context switch */
+static const char * const switch_trace_symbols[] = {
+	"pxCurrentTCB",				/* FreeRTOS */
+	"_tx_thread_current_ptr",	/* ThreadX */
+	"OSTCBCurPtr",				/* uC/OS-III */
+	"Rtos::sCurrentTask",		/* embKernel */
+	"current_task",				/* Chromium-EC */
+};
+
+struct armv7m_switch_trace {
+	struct target *target;
+	FILE *output;
+	unsigned int dwt_num;
+	struct itm_decoder decoder;
+	bool thread_valid;
+	uint32_t thread;
+	unsigned int switches;
+	unsigned int overflows;
+};
+
+static const char *switch_trace_thread_name(struct target *target, uint32_t thread)
+{
+	struct rtos *rtos = target->rtos;
+
+	/* names are only known for the threads seen at the last halt */
+	if (!rtos || !rtos->thread_details)
+		return "";
+
+	for (int i = 0; i < rtos->thread_count; i++)
+		if (rtos->thread_details[i].threadid == thread
+				&& rtos->thread_details[i].thread_name_str)
+			return rtos->thread_details[i].thread_name_str;
+
+	return "";
+}
+
+static void switch_trace_packet(struct itm_decoder *decoder,
+		const struct itm_packet *packet, void *priv)
+{
+	struct armv7m_switch_trace *st = priv;
+
+	if (packet->type == ITM_PACKET_OVERFLOW) {
+		/* packets were lost, switches may be missing from the log */
+		st->overflows++;
+		st->thread_valid = false;
+		fprintf(st->output, "%" PRIu64 " %" PRId64 " overflow\n",
+			decoder->timestamp, timeval_ms());
+		return;
+	}
+
+	if (packet->type != ITM_PACKET_HARDWARE
+			|| packet->id != ITM_HW_ID_DATA_WRITE(st->dwt_num))
+		return;
+
+	/* the same thread may be written again, e.g. when it is the only one ready */
+	if (st->thread_valid && st->thread == packet->value)
+		return;
+
+	st->thread = packet->value;
+	st->thread_valid = true;
+	st->switches++;
+	fprintf(st->output, "%" PRIu64 " %" PRId64 " 0x%08" PRIx32 " %s\n",
+		decoder->timestamp, timeval_ms(), st->thread,
+		switch_trace_thread_name(st->target, st->thread));
+}
+
+static int switch_trace_callback(struct target *target, size_t len, uint8_t *data, void *priv)
+{
+	struct armv7m_switch_trace *st = priv;
+
+	itm_decoder_feed(&st->decoder, data, len);
+	fflush(st->output);
+
+	return ERROR_OK;
+}
+
+static int switch_trace_find_symbol(struct target *target, target_addr_t *address)
+{
+	struct rtos *rtos = target->rtos;
+
+	if (!rtos || !rtos->symbols)
+		return ERROR_FAIL;
+
+	for (struct symbol_table_elem *sym = rtos->symbols; sym->symbol_name; sym++) {
+		if (!sym->address)
+			continue;
+		for (unsigned int i = 0; i < ARRAY_SIZE(switch_trace_symbols); i++) {
+			if (strcmp(sym->symbol_name, switch_trace_symbols[i]) == 0) {
+				*address = sym->address;
+				return ERROR_OK;
+			}
+		}
+	}
+
+	return ERROR_FAIL;
+}
+
+static int switch_trace_stop(struct target *target)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	struct armv7m_switch_trace *st = armv7m->trace_config.switch_trace;
+
+	if (!st)
+		return ERROR_OK;
+
+	target_unregister_trace_callback(switch_trace_callback, st);
+	int retval = cortex_m_clear_data_trace(target, st->dwt_num);
+	fclose(st->output);
+	LOG_TARGET_INFO(target, "thread switch trace stopped, %u switches, %u overflows",
+		st->switches, st->overflows);
+	free(st);
+	armv7m->trace_config.switch_trace = NULL;
+
+	return retval;
+}
+
+void armv7m_trace_cleanup(struct target *target)
+{
+	switch_trace_stop(target);
+}
 
 int armv7m_trace_itm_config(struct target *target)
 {
@@ -125,6 +248,70 @@ COMMAND_HANDLER(handle_itm_ports_command)
 	return armv7m_trace_itm_config(target);
 }
 
+COMMAND_HANDLER(handle_itm_switch_trace_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	target_addr_t address;
+
+	if (CMD_ARGC < 1 || CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1 && strcmp(CMD_ARGV[0], "off") == 0)
+		return switch_trace_stop(target);
+
+	if (armv7m->trace_config.switch_trace) {
+		command_print(CMD, "Thread switch trace already running");
+		return ERROR_FAIL;
+	}
+
+	if (CMD_ARGC == 2) {
+		COMMAND_PARSE_ADDRESS(CMD_ARGV[1], address);
+	} else if (switch_trace_find_symbol(target, &address) != ERROR_OK) {
+		command_print(CMD, "No RTOS current thread symbol, give its address");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	struct armv7m_switch_trace *st = calloc(1, sizeof(*st));
+	if (!st) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	st->target = target;
+	itm_decoder_init(&st->decoder, switch_trace_packet, st);
+	st->output = fopen(CMD_ARGV[0], "w");
+	if (!st->output) {
+		command_print(CMD, "Cannot open file %s", CMD_ARGV[0]);
+		free(st);
+		return ERROR_FAIL;
+	}
+
+	int retval = cortex_m_set_data_trace(target, address, &st->dwt_num);
+	if (retval != ERROR_OK) {
+		fclose(st->output);
+		free(st);
+		return retval;
+	}
+
+	/* DWT packets are only forwarded with ITM enabled */
+	retval = armv7m_trace_itm_config(target);
+	if (retval == ERROR_OK)
+		retval = target_register_trace_callback(switch_trace_callback, st);
+	if (retval != ERROR_OK) {
+		cortex_m_clear_data_trace(target, st->dwt_num);
+		fclose(st->output);
+		free(st);
+		return retval;
+	}
+
+	armv7m->trace_config.switch_trace = st;
+	command_print(CMD, "tracing the writes at " TARGET_ADDR_FMT " with DWT%u",
+		address, st->dwt_num);
+
+	return ERROR_OK;
+}
+
 static const struct command_registration itm_command_handlers[] = {
 	{
 		.name = "port",
@@ -140,6 +327,13 @@ static const struct command_registration itm_command_handlers[] = {
 		.help = "Enable or disable all ITM stimulus ports",
 		.usage = "(0|1|on|off)",
 	},
+	{
+		.name = "switch_trace",
+		.handler = handle_itm_switch_trace_command,
+		.mode = COMMAND_EXEC,
+		.help = "Log the RTOS thread switches from the data trace of the current thread variable",
+		.usage = "(filename [address]|off)",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -22,6 +22,8 @@ enum itm_ts_prescaler {
 	ITM_TS_PRESCALE64,	/**< refclock divided by 64 for the timestamp counter */
 };
 
+struct armv7m_switch_trace;
+
 struct armv7m_trace_config {
 	/** Bitmask of currently enabled ITM stimuli */
 	uint32_t itm_ter[8];
@@ -35,6 +37,8 @@ struct armv7m_trace_config {
 	bool itm_async_timestamps;
 	/** Enable synchronisation packet transmission (for sync port only) */
 	bool itm_synchro_packets;
+	/** Decoder of the RTOS thread switches, when enabled */
+	struct armv7m_switch_trace *switch_trace;
 };
 
 extern const struct command_registration armv7m_trace_command_handlers[];
@@ -44,4 +48,9 @@ extern const struct command_registration armv7m_trace_command_handlers[];
  */
 int armv7m_trace_itm_config(struct target *target);
 
+/**
+ * Stop the thread switch trace and free its resources
+ */
+void armv7m_trace_cleanup(struct target *target);
+
 #endif /* OPENOCD_TARGET_ARMV7M_TRACE_H */
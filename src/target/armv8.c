@@ -1097,6 +1097,14 @@ static void armv8_decode_memory_attr(int attr)
 }
 
 /*  V8 method VA TO PA  */
+/* Forget the translations, needed when the translation regime or the
+ * page tables may have changed */
+void armv8_mmu_flush_va_cache(struct armv8_common *armv8)
+{
+	for (unsigned int i = 0; i < ARMV8_VA_CACHE_SIZE; i++)
+		armv8->va_cache[i].valid = false;
+}
+
 int armv8_mmu_translate_va_pa(struct target *target, target_addr_t va,
 	target_addr_t *val, int meminfo)
 {
@@ -1121,6 +1129,15 @@ int armv8_mmu_translate_va_pa(struct target *target, target_addr_t va,
 		return ERROR_TARGET_NOT_HALTED;
 	}
 
+	/* PAR holds the physical address in 4 KiB units whatever the granule */
+	uint64_t va_page = (uint64_t)va >> 12;
+	struct armv8_va_cache_entry *entry = &armv8->va_cache[va_page % ARMV8_VA_CACHE_SIZE];
+	if (entry->valid && entry->va_page == va_page && entry->mode == arm->core_mode) {
+		par = entry->par;
+		retval = ERROR_OK;
+		goto translated;
+	}
+
 	retval = dpm->prepare(dpm);
 	if (retval != ERROR_OK)
 		return retval;
@@ -1165,6 +1182,14 @@ int armv8_mmu_translate_va_pa(struct target *target, target_addr_t va,
 	if (retval != ERROR_OK)
 		return retval;
 
+	if (!(par & 1)) {
+		entry->valid = true;
+		entry->va_page = va_page;
+		entry->mode = arm->core_mode;
+		entry->par = par;
+	}
+
+translated:
 	if (par & 1) {
 		LOG_ERROR("Address translation failed at stage %i, FST=%x, PTW=%i",
 				((int)(par >> 9) & 1)+1, (int)(par >> 1) & 0x3f, (int)(par >> 8) & 1);
@@ -181,6 +181,16 @@ struct armv8_mmu_common {
 	uint32_t mmu_enabled;
 };
 
+/* number of address translations remembered while the core is halted */
+#define ARMV8_VA_CACHE_SIZE 16
+
+struct armv8_va_cache_entry {
+	bool valid;
+	enum arm_mode mode;
+	uint64_t va_page;
+	uint64_t par;
+};
+
 struct armv8_common {
 	unsigned int common_magic;
 
@@ -207,6 +217,8 @@ struct armv8_common {
 	bool is_armv8r;
 
 	struct armv8_mmu_common armv8_mmu;
+	/* translations made since the core halted, see armv8_mmu_flush_va_cache() */
+	struct armv8_va_cache_entry va_cache[ARMV8_VA_CACHE_SIZE];
 
 	struct arm_cti *cti;
 
@@ -296,6 +308,7 @@ int armv8_arch_state(struct target *target);
 int armv8_read_mpidr(struct armv8_common *armv8);
 int armv8_identify_cache(struct armv8_common *armv8);
 int armv8_init_arch_info(struct target *target, struct armv8_common *armv8);
+void armv8_mmu_flush_va_cache(struct armv8_common *armv8);
 int armv8_mmu_translate_va_pa(struct target *target, target_addr_t va,
 		target_addr_t *val, int meminfo);
 
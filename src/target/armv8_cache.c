@@ -13,6 +13,8 @@
 #include "armv8_dpm.h"
 #include "armv8_opcodes.h"
 #include "smp.h"
+#include "register.h"
+#include <helper/time_support.h>
 
 /* CLIDR cache types */
 #define CACHE_LEVEL_HAS_UNIFIED_CACHE	0x4
@@ -68,6 +70,73 @@ static int armv8_cache_d_inner_flush_level(struct armv8_common *armv8, struct ar
 	return retval;
 }
 
+/*
+ * AArch64 only: X0 holds the set/way operand and X1 the set decrement, so
+ * the whole set loop of a way is a stream of "DC CISW X0; SUB X0, X0, X1"
+ * queued to EDITR, and EDSCR is only checked once per way.
+ * Returns an error if an instruction was dropped or faulted, the caller
+ * then redoes the level line by line.
+ */
+static int armv8_cache_d_inner_flush_level_queued(struct armv8_common *armv8,
+		struct armv8_cachesize *size, int cl)
+{
+	struct arm_dpm *dpm = armv8->arm.dpm;
+	uint32_t dscr;
+	int retval;
+
+	armv8_reg_current(&armv8->arm, 0)->dirty = true;
+	armv8_reg_current(&armv8->arm, 1)->dirty = true;
+
+	retval = dpm->instr_write_data_dcc_64(dpm,
+			ARMV8_MRS(SYSTEM_DBG_DBGDTR_EL0, 1), 1ULL << size->index_shift);
+	if (retval != ERROR_OK)
+		return retval;
+
+	for (int32_t c_way = size->way; c_way >= 0; c_way--) {
+		uint64_t value = ((uint64_t)size->index << size->index_shift)
+			| ((uint64_t)c_way << size->way_shift) | (cl << 1);
+
+		retval = dpm->instr_write_data_dcc_64(dpm,
+				ARMV8_MRS(SYSTEM_DBG_DBGDTR_EL0, 0), value);
+		if (retval != ERROR_OK)
+			return retval;
+
+		for (int32_t c_index = size->index; c_index >= 0; c_index--) {
+			retval = mem_ap_write_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_ITR,
+					armv8_opcode(armv8, ARMV8_OPC_DCCISW));
+			if (retval == ERROR_OK && c_index > 0)
+				retval = mem_ap_write_u32(armv8->debug_ap,
+						armv8->debug_base + CPUV8_DBG_ITR, ARMV8_SUB_64(0, 0, 1));
+			if (retval != ERROR_OK)
+				return retval;
+		}
+
+		int64_t then = timeval_ms();
+		do {
+			retval = mem_ap_read_atomic_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DSCR, &dscr);
+			if (retval != ERROR_OK)
+				return retval;
+			if (timeval_ms() > then + 1000) {
+				LOG_ERROR("Timeout waiting for DC CISW to complete");
+				return ERROR_TARGET_TIMEOUT;
+			}
+		} while ((dscr & DSCR_ITE) == 0);
+		dpm->dscr = dscr;
+
+		if (dscr & (DSCR_ITO | DSCR_ERR)) {
+			LOG_DEBUG("queued DC CISW failed, dscr 0x%08" PRIx32, dscr);
+			/* clear the sticky EDSCR error flags */
+			mem_ap_write_atomic_u32(armv8->debug_ap,
+					armv8->debug_base + CPUV8_DBG_DRCR, DRCR_CSE);
+			return ERROR_FAIL;
+		}
+	}
+
+	return ERROR_OK;
+}
+
 static int armv8_cache_d_inner_clean_inval_all(struct armv8_common *armv8)
 {
 	struct armv8_cache_common *cache = &(armv8->armv8_mmu.armv8_cache);
@@ -88,6 +157,11 @@ static int armv8_cache_d_inner_clean_inval_all(struct armv8_common *armv8)
 		if (cache->arch[cl].ctype < CACHE_LEVEL_HAS_D_CACHE)
 			continue;
 
+		if (armv8->arm.core_state == ARM_STATE_AARCH64
+				&& armv8_cache_d_inner_flush_level_queued(armv8,
+					&cache->arch[cl].d_u_size, cl) == ERROR_OK)
+			continue;
+
 		armv8_cache_d_inner_flush_level(armv8, &cache->arch[cl].d_u_size, cl);
 	}
 
@@ -152,6 +152,8 @@
 #define ARMV8_MOVFSP_32(rt) (0x11000000 | (0x1f << 5) | (rt))
 #define ARMV8_MOVTSP_32(rt) (0x11000000 | (rt << 5) | (0x1F))
 
+#define ARMV8_SUB_64(rd, rn, rm) (0xCB000000 | ((rm) << 16) | ((rn) << 5) | (rd))
+
 #define ARMV8_LDRB_IP(rd, rn) (0x38401400 | (rn << 5) | rd)
 #define ARMV8_LDRH_IP(rd, rn) (0x78402400 | (rn << 5) | rd)
 #define ARMV8_LDRW_IP(rd, rn) (0xb8404400 | (rn << 5) | rd)
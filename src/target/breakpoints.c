@@ -36,6 +36,43 @@ static const char * const watchpoint_rw_strings[] = {
 /* monotonic counter/id-number for breakpoints and watch points */
 static int bpwp_unique_id;
 
+static struct breakpoint **breakpoint_hash_bucket(struct target *target, target_addr_t address)
+{
+	/* instructions are at least 2 bytes aligned */
+	return &target->breakpoint_hash[(address >> 1) & (TARGET_BREAKPOINT_HASH_SIZE - 1)];
+}
+
+/* append, so that breakpoint_find() returns the oldest one like the list */
+static void breakpoint_hash_add(struct target *target, struct breakpoint *breakpoint)
+{
+	struct breakpoint **p = breakpoint_hash_bucket(target, breakpoint->address);
+
+	while (*p)
+		p = &(*p)->hash_next;
+
+	breakpoint->hash_next = NULL;
+	*p = breakpoint;
+}
+
+static void breakpoint_hash_remove(struct target *target, struct breakpoint *breakpoint)
+{
+	struct breakpoint **p = breakpoint_hash_bucket(target, breakpoint->address);
+
+	while (*p) {
+		if (*p == breakpoint) {
+			*p = breakpoint->hash_next;
+			return;
+		}
+		p = &(*p)->hash_next;
+	}
+}
+
+/* for the targets that free their breakpoint list themselves */
+void breakpoint_hash_clear(struct target *target)
+{
+	memset(target->breakpoint_hash, 0, sizeof(target->breakpoint_hash));
+}
+
 static int breakpoint_add_internal(struct target *target,
 	target_addr_t address,
 	unsigned int length,
@@ -90,6 +127,8 @@ fail:
 			return retval;
 	}
 
+	breakpoint_hash_add(target, *breakpoint_p);
+
 	LOG_TARGET_DEBUG(target, "added %s breakpoint at " TARGET_ADDR_FMT
 			" of length 0x%8.8x, (BPID: %" PRIu32 ")",
 		breakpoint_type_strings[(*breakpoint_p)->type],
@@ -140,6 +179,8 @@ static int context_breakpoint_add_internal(struct target *target,
 		return retval;
 	}
 
+	breakpoint_hash_add(target, *breakpoint_p);
+
 	LOG_TARGET_DEBUG(target, "added %s Context breakpoint at 0x%8.8" PRIx32 " of length 0x%8.8x, (BPID: %" PRIu32 ")",
 		breakpoint_type_strings[(*breakpoint_p)->type],
 		(*breakpoint_p)->asid, (*breakpoint_p)->length,
@@ -195,6 +236,8 @@ static int hybrid_breakpoint_add_internal(struct target *target,
 		*breakpoint_p = NULL;
 		return retval;
 	}
+	breakpoint_hash_add(target, *breakpoint_p);
+
 	LOG_TARGET_DEBUG(target,
 		"added %s Hybrid breakpoint at address " TARGET_ADDR_FMT " of length 0x%8.8x, (BPID: %" PRIu32 ")",
 		breakpoint_type_strings[(*breakpoint_p)->type],
@@ -299,6 +342,7 @@ static int breakpoint_free(struct target *target, struct breakpoint *breakpoint_
 
 	LOG_TARGET_DEBUG(target, "free BPID: %" PRIu32 " --> %d", breakpoint->unique_id, retval);
 	(*breakpoint_p) = breakpoint->next;
+	breakpoint_hash_remove(target, breakpoint);
 	free(breakpoint->orig_instr);
 	free(breakpoint);
 
@@ -488,12 +532,12 @@ int breakpoint_clear_target(struct target *target)
 
 struct breakpoint *breakpoint_find(struct target *target, target_addr_t address)
 {
-	struct breakpoint *breakpoint = target->breakpoints;
+	struct breakpoint *breakpoint = *breakpoint_hash_bucket(target, address);
 
 	while (breakpoint) {
 		if (breakpoint->address == address)
 			return breakpoint;
-		breakpoint = breakpoint->next;
+		breakpoint = breakpoint->hash_next;
 	}
 
 	return NULL;
@@ -32,6 +32,7 @@ struct breakpoint {
 	unsigned int number;
 	uint8_t *orig_instr;
 	struct breakpoint *next;
+	struct breakpoint *hash_next;
 	uint32_t unique_id;
 	int linked_brp;
 };
@@ -62,6 +63,7 @@ int breakpoint_remove(struct target *target, target_addr_t address);
 int breakpoint_remove_all(struct target *target);
 
 struct breakpoint *breakpoint_find(struct target *target, target_addr_t address);
+void breakpoint_hash_clear(struct target *target);
 
 static inline void breakpoint_hw_set(struct breakpoint *breakpoint, unsigned int hw_number)
 {
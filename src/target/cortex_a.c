@@ -767,7 +767,7 @@ static int cortex_a_poll(struct target *target)
 			if (retval != ERROR_OK)
 				return retval;
 
-			if (target->smp) {
+			if (target->smp && !target->smp_nonstop) {
 				retval = update_halt_gdb(target);
 				if (retval != ERROR_OK)
 					return retval;
@@ -3398,6 +3398,7 @@ struct target_type cortexa_target = {
 
 	.checksum_memory = arm_checksum_memory,
 	.blank_check_memory = arm_blank_check_memory,
+	.fill_memory = arm_fill_memory,
 
 	.run_algorithm = armv4_5_run_algorithm,
 
@@ -3475,6 +3476,7 @@ struct target_type cortexr4_target = {
 
 	.checksum_memory = arm_checksum_memory,
 	.blank_check_memory = arm_blank_check_memory,
+	.fill_memory = arm_fill_memory,
 
 	.run_algorithm = armv4_5_run_algorithm,
 
@@ -228,7 +228,35 @@ static int cortex_m_load_core_reg_u32(struct target *target,
 	return retval;
 }
 
-static int cortex_m_slow_read_all_regs(struct target *target)
+/*
+ * The registers read at debug entry with lazy_regs: the ones needed to
+ * resume, to step and to serve semihosting. Packed registers follow their
+ * container.
+ */
+static bool cortex_m_reg_is_basic(unsigned int reg_id)
+{
+	unsigned int reg32_id;
+	uint32_t offset;
+
+	if (armv7m_map_reg_packing(reg_id, &reg32_id, &offset))
+		reg_id = reg32_id;
+
+	switch (reg_id) {
+	case ARMV7M_R0:
+	case ARMV7M_R1:
+	case ARMV7M_R13:
+	case ARMV7M_R14:
+	case ARMV7M_PC:
+	case ARMV7M_XPSR:
+	case ARMV7M_PMSK_BPRI_FLTMSK_CTRL:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* With only_invalid, registers already in the cache are not read again */
+static int cortex_m_slow_read_all_regs(struct target *target, bool all, bool only_invalid)
 {
 	struct cortex_m_common *cortex_m = target_to_cm(target);
 	struct armv7m_common *armv7m = target_to_armv7m(target);
@@ -240,6 +268,13 @@ static int cortex_m_slow_read_all_regs(struct target *target)
 
 	for (unsigned int reg_id = 0; reg_id < num_regs; reg_id++) {
 		struct reg *r = &armv7m->arm.core_cache->reg_list[reg_id];
+		if (only_invalid && r->valid)
+			continue;
+		if (!all && !cortex_m_reg_is_basic(reg_id)) {
+			/* read on first access */
+			r->valid = false;
+			continue;
+		}
 		if (r->exist) {
 			int retval = armv7m->arm.read_core_reg(target, r, reg_id, ARM_MODE_ANY);
 			if (retval != ERROR_OK)
@@ -270,7 +305,7 @@ static int cortex_m_queue_reg_read(struct target *target, uint32_t regsel,
 	return mem_ap_read_u32(armv7m->debug_ap, DCB_DCRDR, reg_value);
 }
 
-static int cortex_m_fast_read_all_regs(struct target *target)
+static int cortex_m_fast_read_all_regs(struct target *target, bool all, bool only_invalid)
 {
 	struct cortex_m_common *cortex_m = target_to_cm(target);
 	struct armv7m_common *armv7m = target_to_armv7m(target);
@@ -301,6 +336,12 @@ static int cortex_m_fast_read_all_regs(struct target *target)
 		if (!r->exist)
 			continue;	/* skip non existent registers */
 
+		if (only_invalid && r->valid)
+			continue;
+
+		if (!all && !cortex_m_reg_is_basic(reg_id))
+			continue;
+
 		if (r->size <= 8) {
 			/* Any 8-bit or shorter register is unpacked from a 32-bit
 			 * container register. Skip it now. */
@@ -364,6 +405,15 @@ static int cortex_m_fast_read_all_regs(struct target *target)
 		if (!r->exist)
 			continue;	/* skip non existent registers */
 
+		if (only_invalid && r->valid)
+			continue;
+
+		if (!all && !cortex_m_reg_is_basic(reg_id)) {
+			/* read on first access */
+			r->valid = false;
+			continue;
+		}
+
 		r->dirty = false;
 
 		unsigned int reg32_id;
@@ -395,6 +445,42 @@ static int cortex_m_fast_read_all_regs(struct target *target)
 	return retval;
 }
 
+static int cortex_m_fetch_regs(struct target *target, struct reg **reg_list,
+		int reg_list_size)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct reg_cache *cache = cortex_m->armv7m.arm.core_cache;
+
+	if (target->state != TARGET_HALTED || cortex_m->slow_register_read || !cache)
+		return ERROR_OK;
+
+	bool fetch = false;
+	for (int i = 0; i < reg_list_size; i++) {
+		struct reg *r = reg_list[i];
+		if (r && r->exist && !r->valid &&
+				r >= cache->reg_list && r < cache->reg_list + cache->num_regs)
+			fetch = true;
+	}
+
+	/* the batch reloads the whole core cache, it must not drop pending writes */
+	for (unsigned int i = 0; i < cache->num_regs; i++)
+		if (cache->reg_list[i].exist && cache->reg_list[i].dirty)
+			fetch = false;
+
+	if (!fetch)
+		return ERROR_OK;
+
+	int retval = cortex_m_fast_read_all_regs(target, true, false);
+	if (retval == ERROR_TIMEOUT_REACHED) {
+		/* leave the registers to the per-register path with S_REGRDY polling */
+		cortex_m->slow_register_read = true;
+		LOG_TARGET_DEBUG(target, "Switched to slow register read");
+		return ERROR_OK;
+	}
+
+	return retval;
+}
+
 static int cortex_m_store_core_reg_u32(struct target *target,
 		uint32_t regsel, uint32_t value)
 {
@@ -445,12 +531,229 @@ static int cortex_m_store_core_reg_u32(struct target *target,
 	return retval;
 }
 
+static int cortex_m_queue_reg_write(struct target *target, uint32_t regsel,
+		uint32_t reg_value, uint32_t *dhcsr)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	int retval;
+
+	retval = mem_ap_write_u32(armv7m->debug_ap, DCB_DCRDR, reg_value);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = mem_ap_write_u32(armv7m->debug_ap, DCB_DCRSR, regsel | DCRSR_WNR);
+	if (retval != ERROR_OK)
+		return retval;
+
+	return mem_ap_read_u32(armv7m->debug_ap, DCB_DHCSR, dhcsr);
+}
+
+/** Write back all dirty registers in a single DAP run, the counterpart
+ * of cortex_m_fast_read_all_regs(). Returns ERROR_TIMEOUT_REACHED if
+ * any register was not ready, the registers are left dirty then. */
+static int cortex_m_fast_write_dirty_regs(struct target *target)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	struct reg_cache *cache = armv7m->arm.core_cache;
+	int retval;
+	uint32_t dcrdr;
+
+	/* Merge the partial registers into their container registers first,
+	 * the descending order puts the containers after the parts */
+	for (int reg_id = cache->num_regs - 1; reg_id >= 0; reg_id--) {
+		struct reg *r = &cache->reg_list[reg_id];
+		if (!r->exist || !r->dirty || r->size > 8)
+			continue;
+
+		unsigned int reg32_id;
+		uint32_t offset;
+		if (!armv7m_map_reg_packing(reg_id, &reg32_id, &offset))
+			return ERROR_FAIL;
+
+		struct reg *r32 = &cache->reg_list[reg32_id];
+		if (!r32->valid)
+			return ERROR_TIMEOUT_REACHED;	/* let the slow path read it */
+
+		buf_cpy(r->value, r32->value + offset, r->size);
+		r32->dirty = true;
+	}
+
+	const unsigned int n_r32 = ARMV7M_LAST_REG - ARMV7M_CORE_FIRST_REG + 1
+							   + ARMV7M_FPU_LAST_REG - ARMV7M_FPU_FIRST_REG + 1;
+	uint32_t dhcsr[n_r32];
+	unsigned int wi = 0;
+
+	/* because the DCB_DCRDR is used for the emulated dcc channel
+	 * we have to save/restore the DCB_DCRDR when used */
+	bool dbg_msg_enabled = target->dbg_msg_enabled;
+	if (dbg_msg_enabled) {
+		retval = mem_ap_read_u32(armv7m->debug_ap, DCB_DCRDR, &dcrdr);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	for (int reg_id = cache->num_regs - 1; reg_id >= 0; reg_id--) {
+		struct reg *r = &cache->reg_list[reg_id];
+		if (!r->exist || !r->dirty || r->size <= 8)
+			continue;
+
+		assert(r->size == 32 || r->size == 64);
+		struct arm_reg *armv7m_core_reg = r->arch_info;
+		uint32_t regsel = armv7m_map_id_to_regsel(armv7m_core_reg->num);
+
+		retval = cortex_m_queue_reg_write(target, regsel,
+				buf_get_u32(r->value, 0, 32), &dhcsr[wi++]);
+		if (retval != ERROR_OK)
+			return retval;
+
+		if (r->size == 64) {
+			/* the odd part of FP register (S1, S3...) */
+			retval = cortex_m_queue_reg_write(target, regsel + 1,
+					buf_get_u32(r->value + 4, 0, 32), &dhcsr[wi++]);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+	}
+
+	assert(wi <= n_r32);
+	if (wi == 0 && !dbg_msg_enabled)
+		return ERROR_OK;
+
+	retval = dap_run(armv7m->debug_ap->dap);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (dbg_msg_enabled) {
+		/* restore DCB_DCRDR - this needs to be in a separate
+		 * transaction otherwise the emulated DCC channel breaks */
+		retval = mem_ap_write_atomic_u32(armv7m->debug_ap, DCB_DCRDR, dcrdr);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	bool not_ready = false;
+	for (unsigned int i = 0; i < wi; i++) {
+		if ((dhcsr[i] & S_REGRDY) == 0) {
+			not_ready = true;
+			LOG_TARGET_DEBUG(target, "Register %u was not ready during fast write", i);
+		}
+		cortex_m_cumulate_dhcsr_sticky(cortex_m, dhcsr[i]);
+	}
+
+	if (not_ready)
+		return ERROR_TIMEOUT_REACHED;
+
+	LOG_TARGET_DEBUG(target, "wrote %u 32-bit registers", wi);
+
+	for (unsigned int reg_id = 0; reg_id < cache->num_regs; reg_id++) {
+		struct reg *r = &cache->reg_list[reg_id];
+		if (r->exist && r->dirty) {
+			r->valid = true;
+			r->dirty = false;
+		}
+	}
+
+	return ERROR_OK;
+}
+
+/** Write back the dirty registers, batched unless S_REGRDY needs polling */
+static int cortex_m_restore_context(struct target *target)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+
+	if (!cortex_m->slow_register_read && !cortex_m->armv7m.pre_restore_context) {
+		int retval = cortex_m_fast_write_dirty_regs(target);
+		if (retval != ERROR_TIMEOUT_REACHED)
+			return retval;
+
+		/* rewrite the registers one by one with S_REGRDY polling */
+		LOG_TARGET_DEBUG(target, "Falling back to slow register write");
+	}
+
+	return armv7m_restore_context(target);
+}
+
+static int cortex_m_sync_write(struct target *target, uint32_t address, uint32_t value)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+
+	/* the adapter doesn't queue, write through */
+	if (armv7m->is_hla_target)
+		return target_write_u32(target, address, value);
+
+	return mem_ap_write_u32(armv7m->debug_ap, address, value);
+}
+
+/*
+ * Breakpoints and watchpoints removed while halted are only disabled here,
+ * just before the core runs. GDB removes and inserts them again around
+ * each step and continue, a comparator set again to the same value is
+ * then never written. The writes are queued and flushed with DHCSR.
+ */
+static int cortex_m_sync_comparators(struct target *target)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	int retval;
+
+	for (unsigned int i = 0; i < cortex_m->fp_num_code + cortex_m->fp_num_lit; i++) {
+		struct cortex_m_fp_comparator *comparator = cortex_m->fp_comparator_list + i;
+
+		if (comparator->fpcr_programmed == comparator->fpcr_value)
+			continue;
+
+		retval = cortex_m_sync_write(target, comparator->fpcr_address, comparator->fpcr_value);
+		if (retval != ERROR_OK)
+			return retval;
+		comparator->fpcr_programmed = comparator->fpcr_value;
+	}
+
+	for (unsigned int i = 0; i < cortex_m->dwt_num_comp; i++) {
+		struct cortex_m_dwt_comparator *comparator = cortex_m->dwt_comparator_list + i;
+
+		if (comparator->function_programmed == comparator->function)
+			continue;
+
+		retval = cortex_m_sync_write(target, comparator->dwt_comparator_address + 8,
+				comparator->function);
+		if (retval != ERROR_OK)
+			return retval;
+		comparator->function_programmed = comparator->function;
+	}
+
+	return ERROR_OK;
+}
+
+/*
+ * Apply the comparator changes now if the core isn't halted. The adapter
+ * of a HLA target resumes the core itself, so it is always updated now.
+ */
+static int cortex_m_update_comparators(struct target *target)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+
+	if (target->state == TARGET_HALTED && !armv7m->is_hla_target)
+		return ERROR_OK;
+
+	int retval = cortex_m_sync_comparators(target);
+	if (retval != ERROR_OK || armv7m->is_hla_target)
+		return retval;
+
+	return dap_run(armv7m->debug_ap->dap);
+}
+
 static int cortex_m_write_debug_halt_mask(struct target *target,
 	uint32_t mask_on, uint32_t mask_off)
 {
 	struct cortex_m_common *cortex_m = target_to_cm(target);
 	struct armv7m_common *armv7m = &cortex_m->armv7m;
 
+	if (mask_off & C_HALT) {
+		int retval = cortex_m_sync_comparators(target);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
 	/* mask off status bits */
 	cortex_m->dcb_dhcsr &= ~((0xFFFFul << 16) | mask_off);
 	/* create new register mask */
@@ -666,6 +969,7 @@ static int cortex_m_endreset_event(struct target *target)
 		retval = target_write_u32(target, fp_list[i].fpcr_address, fp_list[i].fpcr_value);
 		if (retval != ERROR_OK)
 			return retval;
+		fp_list[i].fpcr_programmed = fp_list[i].fpcr_value;
 	}
 
 	/* Restore DWT registers */
@@ -682,6 +986,7 @@ static int cortex_m_endreset_event(struct target *target)
 				dwt_list[i].function);
 		if (retval != ERROR_OK)
 			return retval;
+		dwt_list[i].function_programmed = dwt_list[i].function;
 	}
 	retval = dap_run(swjdp);
 	if (retval != ERROR_OK)
@@ -840,7 +1145,12 @@ static int cortex_m_erratum_check_breakpoint(struct target *target)
 	return ERROR_TARGET_HALTED_DO_RESUME;
 }
 
-static int cortex_m_debug_entry(struct target *target)
+/*
+ * With may_semihost, a breakpoint halt with semihosting active only reads
+ * the basic registers, a semihosting call resumes at once. The caller
+ * reads the other ones with cortex_m_complete_regs() for a real halt.
+ */
+static int cortex_m_debug_entry(struct target *target, bool may_semihost)
 {
 	uint32_t xpsr;
 	int retval;
@@ -873,9 +1183,13 @@ static int cortex_m_debug_entry(struct target *target)
 			return retval;
 	}
 
-	/* Load all registers to arm.core_cache */
+	/* Load all registers, or only the basic ones, to arm.core_cache */
+	bool all = !cortex_m->lazy_regs;
+	if (may_semihost && target->semihosting && target->semihosting->is_active
+			&& target->debug_reason == DBG_REASON_BREAKPOINT)
+		all = false;
 	if (!cortex_m->slow_register_read) {
-		retval = cortex_m_fast_read_all_regs(target);
+		retval = cortex_m_fast_read_all_regs(target, all, false);
 		if (retval == ERROR_TIMEOUT_REACHED) {
 			cortex_m->slow_register_read = true;
 			LOG_TARGET_DEBUG(target, "Switched to slow register read");
@@ -883,7 +1197,7 @@ static int cortex_m_debug_entry(struct target *target)
 	}
 
 	if (cortex_m->slow_register_read)
-		retval = cortex_m_slow_read_all_regs(target);
+		retval = cortex_m_slow_read_all_regs(target, all, false);
 
 	if (retval != ERROR_OK)
 		return retval;
@@ -946,6 +1260,106 @@ static int cortex_m_debug_entry(struct target *target)
 	return ERROR_OK;
 }
 
+/* Read the registers left invalid by the debug entry, unless lazy_regs */
+static int cortex_m_complete_regs(struct target *target)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct reg_cache *cache = cortex_m->armv7m.arm.core_cache;
+	int retval = ERROR_OK;
+
+	if (cortex_m->lazy_regs)
+		return ERROR_OK;
+
+	bool complete = true;
+	for (unsigned int i = 0; i < cache->num_regs; i++)
+		if (cache->reg_list[i].exist && !cache->reg_list[i].valid)
+			complete = false;
+
+	if (complete)
+		return ERROR_OK;
+
+	if (!cortex_m->slow_register_read) {
+		retval = cortex_m_fast_read_all_regs(target, true, true);
+		if (retval == ERROR_TIMEOUT_REACHED) {
+			cortex_m->slow_register_read = true;
+			LOG_TARGET_DEBUG(target, "Switched to slow register read");
+		}
+	}
+
+	if (cortex_m->slow_register_read)
+		retval = cortex_m_slow_read_all_regs(target, true, true);
+
+	return retval;
+}
+
+/* A semihosting exit the target is not resumed from reports the halt
+ * itself, so the register cache has to be complete before the call */
+static bool cortex_m_semihosting_reports_halt(struct target *target)
+{
+	struct semihosting *semihosting = target->semihosting;
+	struct arm *arm = target_to_arm(target);
+
+	if (!semihosting || !semihosting->is_active || semihosting->has_resumable_exit
+			|| semihosting->hit_fileio || target->debug_reason != DBG_REASON_BREAKPOINT)
+		return false;
+
+	uint32_t op = buf_get_u32(arm->core_cache->reg_list[ARMV7M_R0].value, 0, 32);
+	return op == SEMIHOSTING_SYS_EXIT || op == SEMIHOSTING_SYS_EXIT_EXTENDED;
+}
+
+/*
+ * While the core runs, the adapter firmware can poll DHCSR instead of the
+ * host. Returns true if the firmware has seen no change of the halt, reset
+ * and lockup status, so the poll needs no target access. The sticky bits
+ * the firmware cleared by reading DHCSR are reported with the change.
+ */
+static bool cortex_m_dhcsr_watch_unchanged(struct target *target)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct adapter_watch *watch = &cortex_m->dhcsr_watch;
+	bool changed = false;
+	uint32_t dhcsr;
+
+	if (!watch->active)
+		return false;
+
+	if (target->state == TARGET_RUNNING && !target->halt_issued) {
+		int retval = adapter_poll_watch(watch, &changed, &dhcsr);
+		if (retval == ERROR_OK && !changed)
+			return true;
+		if (retval == ERROR_OK)
+			cortex_m_cumulate_dhcsr_sticky(cortex_m, dhcsr);
+	}
+
+	adapter_config_watch(false, watch);
+	return false;
+}
+
+static void cortex_m_dhcsr_watch_start(struct target *target)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct adapter_watch *watch = &cortex_m->dhcsr_watch;
+
+	if (!cortex_m->dhcsr_watch_enabled || watch->active || !cortex_m->armv7m.debug_ap ||
+			target->state != TARGET_RUNNING)
+		return;
+
+	watch->ap_num = cortex_m->armv7m.debug_ap->ap_num;
+	watch->address = DCB_DHCSR;
+	watch->mask = S_HALT | S_LOCKUP | S_RESET_ST;
+	watch->value = cortex_m->dcb_dhcsr;
+
+	int retval = adapter_config_watch(true, watch);
+	if (retval != ERROR_OK) {
+		if (retval == ERROR_NOT_IMPLEMENTED)
+			LOG_TARGET_DEBUG(target, "adapter does not support poll_watch, polling DHCSR");
+		else
+			LOG_TARGET_DEBUG(target, "adapter cannot watch DHCSR, polling it");
+		/* don't try again at every poll */
+		cortex_m->dhcsr_watch_enabled = false;
+	}
+}
+
 static int cortex_m_poll_one(struct target *target)
 {
 	int detected_failure = ERROR_OK;
@@ -954,6 +1368,9 @@ static int cortex_m_poll_one(struct target *target)
 	struct cortex_m_common *cortex_m = target_to_cm(target);
 	struct armv7m_common *armv7m = &cortex_m->armv7m;
 
+	if (cortex_m_dhcsr_watch_unchanged(target))
+		return ERROR_OK;
+
 	/* Read from Debug Halting Control and Status Register */
 	retval = cortex_m_read_dhcsr_atomic_sticky(target);
 	if (retval != ERROR_OK) {
@@ -1024,7 +1441,7 @@ static int cortex_m_poll_one(struct target *target)
 		target->state = TARGET_HALTED;
 
 		if ((prev_target_state == TARGET_RUNNING) || (prev_target_state == TARGET_RESET)) {
-			retval = cortex_m_debug_entry(target);
+			retval = cortex_m_debug_entry(target, true);
 
 			/* Errata 3092511 workaround
 			 * Cortex-M7 can halt in an incorrect address when breakpoint
@@ -1048,10 +1465,16 @@ static int cortex_m_poll_one(struct target *target)
 				return ERROR_OK;
 			}
 
+			if (retval == ERROR_OK && cortex_m_semihosting_reports_halt(target))
+				retval = cortex_m_complete_regs(target);
+
 			/* arm_semihosting needs to know registers, don't run if debug entry returned error */
 			if (retval == ERROR_OK && arm_semihosting(target, &retval) != 0)
 				return retval;
 
+			if (retval == ERROR_OK)
+				retval = cortex_m_complete_regs(target);
+
 			if (target->smp) {
 				LOG_TARGET_DEBUG(target, "postpone target event 'halted'");
 				target->smp_halt_event_postponed = true;
@@ -1061,7 +1484,7 @@ static int cortex_m_poll_one(struct target *target)
 			}
 		}
 		if (prev_target_state == TARGET_DEBUG_RUNNING) {
-			retval = cortex_m_debug_entry(target);
+			retval = cortex_m_debug_entry(target, false);
 
 			target_call_event_callbacks(target, TARGET_EVENT_DEBUG_HALTED);
 		}
@@ -1096,6 +1519,8 @@ static int cortex_m_poll_one(struct target *target)
 	/* Did we detect a failure condition that we cleared? */
 	if (detected_failure != ERROR_OK)
 		retval = detected_failure;
+	else if (retval == ERROR_OK)
+		cortex_m_dhcsr_watch_start(target);
 	return retval;
 }
 
@@ -1379,7 +1804,7 @@ static int cortex_m_restore_one(struct target *target, bool current,
 	if (current)
 		*address = resume_pc;
 
-	int retval = armv7m_restore_context(target);
+	int retval = cortex_m_restore_context(target);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -1527,7 +1952,7 @@ static int cortex_m_step(struct target *target, bool current,
 
 	target->debug_reason = DBG_REASON_SINGLESTEP;
 
-	armv7m_restore_context(target);
+	cortex_m_restore_context(target);
 
 	target_call_event_callbacks(target, TARGET_EVENT_RESUMED);
 
@@ -1670,7 +2095,7 @@ static int cortex_m_step(struct target *target, bool current,
 		" nvic_icsr = 0x%" PRIx32,
 		cortex_m->dcb_dhcsr, cortex_m->nvic_icsr);
 
-	retval = cortex_m_debug_entry(target);
+	retval = cortex_m_debug_entry(target, false);
 	if (retval != ERROR_OK && retval != ERROR_TARGET_HALTED_DO_RESUME)
 		return retval;
 	target_call_event_callbacks(target, TARGET_EVENT_HALTED);
@@ -1885,13 +2310,6 @@ int cortex_m_set_breakpoint(struct target *target, struct breakpoint *breakpoint
 
 	if (breakpoint->type == BKPT_HARD) {
 		uint32_t fpcr_value;
-		while (comparator_list[fp_num].used && (fp_num < cortex_m->fp_num_code))
-			fp_num++;
-		if (fp_num >= cortex_m->fp_num_code) {
-			LOG_TARGET_ERROR(target, "Can not find free FPB Comparator!");
-			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
-		}
-		breakpoint_hw_set(breakpoint, fp_num);
 		fpcr_value = breakpoint->address | 1;
 		if (cortex_m->fp_rev == 0) {
 			if (breakpoint->address > 0x1FFFFFFF) {
@@ -1906,10 +2324,29 @@ int cortex_m_set_breakpoint(struct target *target, struct breakpoint *breakpoint
 			LOG_TARGET_ERROR(target, "Unhandled Cortex-M Flash Patch Breakpoint architecture revision");
 			return ERROR_FAIL;
 		}
+
+		/* prefer a free comparator still programmed with this value */
+		fp_num = cortex_m->fp_num_code;
+		for (unsigned int i = 0; i < cortex_m->fp_num_code; i++) {
+			if (comparator_list[i].used)
+				continue;
+			if (comparator_list[i].fpcr_programmed == fpcr_value) {
+				fp_num = i;
+				break;
+			}
+			if (fp_num == cortex_m->fp_num_code)
+				fp_num = i;
+		}
+		if (fp_num >= cortex_m->fp_num_code) {
+			LOG_TARGET_ERROR(target, "Can not find free FPB Comparator!");
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		}
+		breakpoint_hw_set(breakpoint, fp_num);
 		comparator_list[fp_num].used = true;
 		comparator_list[fp_num].fpcr_value = fpcr_value;
-		target_write_u32(target, comparator_list[fp_num].fpcr_address,
-			comparator_list[fp_num].fpcr_value);
+		retval = cortex_m_update_comparators(target);
+		if (retval != ERROR_OK)
+			return retval;
 		LOG_TARGET_DEBUG(target, "fpc_num %i fpcr_value 0x%" PRIx32 "",
 			fp_num,
 			comparator_list[fp_num].fpcr_value);
@@ -1982,8 +2419,9 @@ int cortex_m_unset_breakpoint(struct target *target, struct breakpoint *breakpoi
 		}
 		comparator_list[fp_num].used = false;
 		comparator_list[fp_num].fpcr_value = 0;
-		target_write_u32(target, comparator_list[fp_num].fpcr_address,
-			comparator_list[fp_num].fpcr_value);
+		retval = cortex_m_update_comparators(target);
+		if (retval != ERROR_OK)
+			return retval;
 	} else {
 		/* restore original instruction (kept in target endianness) */
 		retval = target_write_memory(target, breakpoint->address & 0xFFFFFFFE,
@@ -2022,36 +2460,18 @@ int cortex_m_remove_breakpoint(struct target *target, struct breakpoint *breakpo
 
 static int cortex_m_set_watchpoint(struct target *target, struct watchpoint *watchpoint)
 {
-	unsigned int dwt_num = 0;
+	unsigned int dwt_num;
 	struct cortex_m_common *cortex_m = target_to_cm(target);
+	uint32_t comp, mask, function = 0;
 
-	/* REVISIT Don't fully trust these "not used" records ... users
-	 * may set up breakpoints by hand, e.g. dual-address data value
-	 * watchpoint using comparator #1; comparator #0 matching cycle
-	 * count; send data trace info through ITM and TPIU; etc
-	 */
-	struct cortex_m_dwt_comparator *comparator;
-
-	for (comparator = cortex_m->dwt_comparator_list;
-		comparator->used && dwt_num < cortex_m->dwt_num_comp;
-		comparator++, dwt_num++)
-		continue;
-	if (dwt_num >= cortex_m->dwt_num_comp) {
-		LOG_TARGET_ERROR(target, "Can not find free DWT Comparator");
-		return ERROR_FAIL;
-	}
-	comparator->used = true;
-	watchpoint_set(watchpoint, dwt_num);
-
-	comparator->comp = watchpoint->address;
-	target_write_u32(target, comparator->dwt_comparator_address + 0,
-		comparator->comp);
+	comp = watchpoint->address;
 
 	if ((cortex_m->dwt_devarch & 0x1FFFFF) != DWT_DEVARCH_ARMV8M_V2_0
 			&& (cortex_m->dwt_devarch & 0x1FFFFF) != DWT_DEVARCH_ARMV8M_V2_1) {
-		uint32_t mask = 0, temp;
+		uint32_t temp;
 
 		/* watchpoint params were validated earlier */
+		mask = 0;
 		temp = watchpoint->length;
 		while (temp) {
 			temp >>= 1;
@@ -2059,42 +2479,87 @@ static int cortex_m_set_watchpoint(struct target *target, struct watchpoint *wat
 		}
 		mask--;
 
-		comparator->mask = mask;
-		target_write_u32(target, comparator->dwt_comparator_address + 4,
-			comparator->mask);
-
 		switch (watchpoint->rw) {
 		case WPT_READ:
-			comparator->function = 5;
+			function = 5;
 			break;
 		case WPT_WRITE:
-			comparator->function = 6;
+			function = 6;
 			break;
 		case WPT_ACCESS:
-			comparator->function = 7;
+			function = 7;
 			break;
 		}
 	} else {
 		uint32_t data_size = watchpoint->length >> 1;
-		comparator->mask = (watchpoint->length >> 1) | 1;
+		mask = (watchpoint->length >> 1) | 1;
 
 		switch (watchpoint->rw) {
 		case WPT_ACCESS:
-			comparator->function = 4;
+			function = 4;
 			break;
 		case WPT_WRITE:
-			comparator->function = 5;
+			function = 5;
 			break;
 		case WPT_READ:
-			comparator->function = 6;
+			function = 6;
+			break;
+		}
+		function = function | (1 << 4) | (data_size << 10);
+	}
+
+	/* REVISIT Don't fully trust these "not used" records ... users
+	 * may set up breakpoints by hand, e.g. dual-address data value
+	 * watchpoint using comparator #1; comparator #0 matching cycle
+	 * count; send data trace info through ITM and TPIU; etc
+	 */
+	struct cortex_m_dwt_comparator *comparator = NULL;
+	bool programmed = false;
+
+	/* prefer a free comparator still programmed with this watchpoint */
+	for (unsigned int i = 0; i < cortex_m->dwt_num_comp; i++) {
+		struct cortex_m_dwt_comparator *c = cortex_m->dwt_comparator_list + i;
+
+		if (c->used)
+			continue;
+		if (c->comp == comp && c->mask == mask && c->function_programmed == function) {
+			comparator = c;
+			programmed = true;
 			break;
 		}
-		comparator->function = comparator->function | (1 << 4) |
-				(data_size << 10);
+		if (!comparator)
+			comparator = c;
+	}
+	if (!comparator) {
+		LOG_TARGET_ERROR(target, "Can not find free DWT Comparator");
+		return ERROR_FAIL;
+	}
+	dwt_num = comparator - cortex_m->dwt_comparator_list;
+	comparator->used = true;
+	watchpoint_set(watchpoint, dwt_num);
+
+	if (!programmed) {
+		/* disable the comparator while changing its address */
+		if (comparator->function_programmed != 0) {
+			target_write_u32(target, comparator->dwt_comparator_address + 8, 0);
+			comparator->function_programmed = 0;
+		}
+
+		comparator->comp = comp;
+		target_write_u32(target, comparator->dwt_comparator_address + 0,
+			comparator->comp);
+
+		comparator->mask = mask;
+		if ((cortex_m->dwt_devarch & 0x1FFFFF) != DWT_DEVARCH_ARMV8M_V2_0
+				&& (cortex_m->dwt_devarch & 0x1FFFFF) != DWT_DEVARCH_ARMV8M_V2_1)
+			target_write_u32(target, comparator->dwt_comparator_address + 4,
+				comparator->mask);
 	}
 
-	target_write_u32(target, comparator->dwt_comparator_address + 8,
-		comparator->function);
+	comparator->function = function;
+	int retval = cortex_m_update_comparators(target);
+	if (retval != ERROR_OK)
+		return retval;
 
 	LOG_TARGET_DEBUG(target, "Watchpoint (ID %d) DWT%d 0x%08" PRIx32 " 0x%" PRIx32 " 0x%05" PRIx32,
 		watchpoint->unique_id, dwt_num,
@@ -2127,12 +2592,10 @@ static int cortex_m_unset_watchpoint(struct target *target, struct watchpoint *w
 	comparator = cortex_m->dwt_comparator_list + dwt_num;
 	comparator->used = false;
 	comparator->function = 0;
-	target_write_u32(target, comparator->dwt_comparator_address + 8,
-		comparator->function);
 
 	watchpoint->is_set = false;
 
-	return ERROR_OK;
+	return cortex_m_update_comparators(target);
 }
 
 int cortex_m_add_watchpoint(struct target *target, struct watchpoint *watchpoint)
@@ -2197,27 +2660,106 @@ int cortex_m_remove_watchpoint(struct target *target, struct watchpoint *watchpo
 	return ERROR_OK;
 }
 
+int cortex_m_set_data_trace(struct target *target, target_addr_t address,
+		unsigned int *dwt_num)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct cortex_m_dwt_comparator *comparator = NULL;
+	uint32_t function;
+
+	/* data trace packets can only identify comparators 0 to 3 */
+	for (unsigned int i = 0; i < MIN(cortex_m->dwt_num_comp, 4u); i++) {
+		if (!cortex_m->dwt_comparator_list[i].used) {
+			comparator = cortex_m->dwt_comparator_list + i;
+			break;
+		}
+	}
+	if (!comparator || cortex_m->dwt_comp_available < 1) {
+		LOG_TARGET_ERROR(target, "Can not find free DWT Comparator");
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	if ((cortex_m->dwt_devarch & 0x1FFFFF) != DWT_DEVARCH_ARMV8M_V2_0
+			&& (cortex_m->dwt_devarch & 0x1FFFFF) != DWT_DEVARCH_ARMV8M_V2_1)
+		/* sample data value on write */
+		function = 0xd;
+	else
+		/* data address write, data trace, word */
+		function = 5 | (2 << 4) | (2 << 10);
+
+	cortex_m->dwt_comp_available--;
+	comparator->used = true;
+	*dwt_num = comparator - cortex_m->dwt_comparator_list;
+
+	if (comparator->function_programmed != 0) {
+		target_write_u32(target, comparator->dwt_comparator_address + 8, 0);
+		comparator->function_programmed = 0;
+	}
+
+	comparator->comp = address;
+	target_write_u32(target, comparator->dwt_comparator_address + 0, comparator->comp);
+	comparator->mask = 0;
+	if ((cortex_m->dwt_devarch & 0x1FFFFF) != DWT_DEVARCH_ARMV8M_V2_0
+			&& (cortex_m->dwt_devarch & 0x1FFFFF) != DWT_DEVARCH_ARMV8M_V2_1)
+		target_write_u32(target, comparator->dwt_comparator_address + 4, comparator->mask);
+
+	comparator->function = function;
+
+	LOG_TARGET_DEBUG(target, "Data trace DWT%u 0x%08" PRIx32 " 0x%05" PRIx32,
+		*dwt_num, comparator->comp, comparator->function);
+
+	return cortex_m_update_comparators(target);
+}
+
+int cortex_m_clear_data_trace(struct target *target, unsigned int dwt_num)
+{
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+
+	if (dwt_num >= cortex_m->dwt_num_comp)
+		return ERROR_OK;
+
+	struct cortex_m_dwt_comparator *comparator = cortex_m->dwt_comparator_list + dwt_num;
+	if (!comparator->used)
+		return ERROR_OK;
+
+	comparator->used = false;
+	comparator->function = 0;
+	cortex_m->dwt_comp_available++;
+
+	return cortex_m_update_comparators(target);
+}
+
 static int cortex_m_hit_watchpoint(struct target *target, struct watchpoint **hit_watchpoint)
 {
 	if (target->debug_reason != DBG_REASON_WATCHPOINT)
 		return ERROR_FAIL;
 
 	struct cortex_m_common *cortex_m = target_to_cm(target);
+	/* DWT_CTRL.NUMCOMP is 4 bits */
+	target_addr_t address[16];
+	uint32_t dwt_function[16];
+	unsigned int count = 0;
 
+	/* read the DWT_FUNCTION of all the set watchpoints at once */
 	for (struct watchpoint *wp = target->watchpoints; wp; wp = wp->next) {
-		if (!wp->is_set)
+		if (!wp->is_set || count == ARRAY_SIZE(address))
 			continue;
 
-		unsigned int dwt_num = wp->number;
-		struct cortex_m_dwt_comparator *comparator = cortex_m->dwt_comparator_list + dwt_num;
+		struct cortex_m_dwt_comparator *comparator = cortex_m->dwt_comparator_list + wp->number;
+		address[count++] = comparator->dwt_comparator_address + 8;
+	}
 
-		uint32_t dwt_function;
-		int retval = target_read_u32(target, comparator->dwt_comparator_address + 8, &dwt_function);
-		if (retval != ERROR_OK)
-			return ERROR_FAIL;
+	int retval = target_read_u32_batch(target, address, dwt_function, count);
+	if (retval != ERROR_OK)
+		return ERROR_FAIL;
+
+	count = 0;
+	for (struct watchpoint *wp = target->watchpoints; wp; wp = wp->next) {
+		if (!wp->is_set || count == ARRAY_SIZE(address))
+			continue;
 
 		/* check the MATCHED bit */
-		if (dwt_function & BIT(24)) {
+		if (dwt_function[count++] & BIT(24)) {
 			*hit_watchpoint = wp;
 			return ERROR_OK;
 		}
@@ -2252,6 +2794,24 @@ static int cortex_m_read_memory(struct target *target, target_addr_t address,
 	return mem_ap_read_buf(armv7m->debug_ap, buffer, size, count, address);
 }
 
+static int cortex_m_read_u32_batch(struct target *target, const target_addr_t *address,
+	uint32_t *value, unsigned int count)
+{
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+
+	for (unsigned int i = 0; i < count; i++) {
+		/* armv6m does not handle unaligned memory access */
+		if (armv7m->arm.arch == ARM_ARCH_V6M && (address[i] & 0x3u))
+			return ERROR_TARGET_UNALIGNED_ACCESS;
+
+		int retval = mem_ap_read_u32(armv7m->debug_ap, address[i], &value[i]);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	return dap_run(armv7m->debug_ap->dap);
+}
+
 static int cortex_m_write_memory(struct target *target, target_addr_t address,
 	uint32_t size, uint32_t count, const uint8_t *buffer)
 {
@@ -2279,11 +2839,15 @@ void cortex_m_deinit_target(struct target *target)
 	struct cortex_m_common *cortex_m = target_to_cm(target);
 	struct armv7m_common *armv7m = target_to_armv7m(target);
 
+	if (cortex_m->dhcsr_watch.active)
+		adapter_config_watch(false, &cortex_m->dhcsr_watch);
+
 	if (!armv7m->is_hla_target && armv7m->debug_ap)
 		dap_put_ap(armv7m->debug_ap);
 
 	free(cortex_m->fp_comparator_list);
 
+	armv7m_trace_cleanup(target);
 	cortex_m_dwt_free(target);
 	armv7m_free_reg_cache(target);
 
@@ -2898,6 +3462,8 @@ static int cortex_m_init_arch_info(struct target *target,
 	 * if not it will use CORTEX_M_RESET_VECTRESET */
 	cortex_m->soft_reset_config = CORTEX_M_RESET_VECTRESET;
 
+	cortex_m->dhcsr_watch_enabled = true;
+
 	armv7m->arm.dap = dap;
 
 	/* register arch-specific functions */
@@ -3128,6 +3694,184 @@ COMMAND_HANDLER(handle_cortex_m_reset_config_command)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(handle_cortex_m_lazy_regs_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	int retval;
+
+	retval = cortex_m_verify_pointer(CMD, cortex_m);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1)
+		COMMAND_PARSE_ON_OFF(CMD_ARGV[0], cortex_m->lazy_regs);
+
+	command_print(CMD, "cortex_m lazy_regs %s", cortex_m->lazy_regs ? "on" : "off");
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_cortex_m_poll_watch_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	int retval;
+
+	retval = cortex_m_verify_pointer(CMD, cortex_m);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		COMMAND_PARSE_ON_OFF(CMD_ARGV[0], cortex_m->dhcsr_watch_enabled);
+		if (!cortex_m->dhcsr_watch_enabled && cortex_m->dhcsr_watch.active)
+			adapter_config_watch(false, &cortex_m->dhcsr_watch);
+	}
+
+	command_print(CMD, "cortex_m poll_watch %s%s", cortex_m->dhcsr_watch_enabled ? "on" : "off",
+		cortex_m->dhcsr_watch.active ? ", DHCSR watched by the adapter" : "");
+
+	return ERROR_OK;
+}
+
+/*
+ * Time a code region with CYCCNT. Hardware breakpoints at both ends halt
+ * the core; CYCCNT doesn't count in Debug state, so the debugger time is
+ * not part of the result.
+ */
+COMMAND_HANDLER(handle_cortex_m_time_region_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct cortex_m_common *cortex_m = target_to_cm(target);
+	struct arm *arm = &cortex_m->armv7m.arm;
+	target_addr_t start, end;
+	unsigned int iterations = 100, timeout_ms = 10000;
+	uint32_t dwt_ctrl;
+	int retval, retval2;
+
+	retval = cortex_m_verify_pointer(CMD, cortex_m);
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (CMD_ARGC < 2 || CMD_ARGC > 4)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_ADDRESS(CMD_ARGV[0], start);
+	COMMAND_PARSE_ADDRESS(CMD_ARGV[1], end);
+	if (CMD_ARGC > 2)
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[2], iterations);
+	if (CMD_ARGC > 3)
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[3], timeout_ms);
+
+	if (start == end || iterations == 0)
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+
+	if (target->state != TARGET_HALTED) {
+		command_print(CMD, "Error: target must be stopped for \"%s\" command", CMD_NAME);
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	retval = target_read_u32(target, DWT_CTRL, &dwt_ctrl);
+	if (retval != ERROR_OK)
+		return retval;
+
+	/* NOCYCCNT */
+	if (dwt_ctrl & BIT(25)) {
+		command_print(CMD, "DWT has no cycle counter");
+		return ERROR_FAIL;
+	}
+
+	retval = target_write_u32(target, DWT_CTRL, dwt_ctrl | 1);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = breakpoint_add(target, start, 2, BKPT_HARD);
+	if (retval != ERROR_OK)
+		goto restore_ctrl;
+
+	retval = breakpoint_add(target, end, 2, BKPT_HARD);
+	if (retval != ERROR_OK)
+		goto remove_start;
+
+	uint32_t t_start = 0, min = UINT32_MAX, max = 0;
+	uint64_t total = 0;
+	unsigned int count = 0;
+	bool in_region = false;
+	int64_t deadline = timeval_ms() + timeout_ms;
+
+	while (count < iterations) {
+		int64_t now = timeval_ms();
+		if (now >= deadline) {
+			command_print(CMD, "timeout, region not completed %u times", iterations);
+			break;
+		}
+
+		retval = target_resume(target, true, 0, true, false);
+		if (retval != ERROR_OK)
+			break;
+
+		retval = target_wait_state(target, TARGET_HALTED, deadline - now);
+		if (retval != ERROR_OK) {
+			/* leave the core halted, the breakpoints are removed below */
+			target_halt(target);
+			target_wait_state(target, TARGET_HALTED, 100);
+			retval = ERROR_OK;
+			command_print(CMD, "timeout, region not completed %u times", iterations);
+			break;
+		}
+
+		uint32_t pc = buf_get_u32(arm->pc->value, 0, 32);
+		uint32_t cyccnt;
+		retval = target_read_u32(target, DWT_CYCCNT, &cyccnt);
+		if (retval != ERROR_OK)
+			break;
+
+		if (pc == start) {
+			t_start = cyccnt;
+			in_region = true;
+		} else if (pc == end) {
+			if (!in_region)
+				continue;
+
+			uint32_t delta = cyccnt - t_start;
+			min = MIN(min, delta);
+			max = MAX(max, delta);
+			total += delta;
+			count++;
+			in_region = false;
+		} else {
+			command_print(CMD, "halted out of the region at 0x%08" PRIx32, pc);
+			break;
+		}
+	}
+
+	if (count)
+		command_print(CMD, "%u runs, cycles min %" PRIu32 " avg %" PRIu64 " max %" PRIu32,
+			count, min, total / count, max);
+	else
+		command_print(CMD, "region not completed");
+
+	retval2 = breakpoint_remove(target, end);
+	if (retval == ERROR_OK)
+		retval = retval2;
+remove_start:
+	retval2 = breakpoint_remove(target, start);
+	if (retval == ERROR_OK)
+		retval = retval2;
+restore_ctrl:
+	retval2 = target_write_u32(target, DWT_CTRL, dwt_ctrl);
+	if (retval == ERROR_OK)
+		retval = retval2;
+
+	return retval;
+}
+
 static const struct command_registration cortex_m_exec_command_handlers[] = {
 	{
 		.name = "maskisr",
@@ -3150,6 +3894,27 @@ static const struct command_registration cortex_m_exec_command_handlers[] = {
 		.help = "configure software reset handling",
 		.usage = "['sysresetreq'|'vectreset']",
 	},
+	{
+		.name = "time_region",
+		.handler = handle_cortex_m_time_region_command,
+		.mode = COMMAND_EXEC,
+		.help = "measure the cycles between two addresses with CYCCNT",
+		.usage = "start_address end_address [iterations [timeout_ms]]",
+	},
+	{
+		.name = "lazy_regs",
+		.handler = handle_cortex_m_lazy_regs_command,
+		.mode = COMMAND_ANY,
+		.help = "read only the basic core registers at debug entry",
+		.usage = "['on'|'off']",
+	},
+	{
+		.name = "poll_watch",
+		.handler = handle_cortex_m_poll_watch_command,
+		.mode = COMMAND_ANY,
+		.help = "let adapters which can do it poll DHCSR while the core runs",
+		.usage = "['on'|'off']",
+	},
 	{
 		.chain = smp_command_handlers,
 	},
@@ -3198,11 +3963,14 @@ struct target_type cortexm_target = {
 
 	.get_gdb_arch = arm_get_gdb_arch,
 	.get_gdb_reg_list = armv7m_get_gdb_reg_list,
+	.fetch_regs = cortex_m_fetch_regs,
 
 	.read_memory = cortex_m_read_memory,
+	.read_u32_batch = cortex_m_read_u32_batch,
 	.write_memory = cortex_m_write_memory,
 	.checksum_memory = armv7m_checksum_memory,
 	.blank_check_memory = armv7m_blank_check_memory,
+	.fill_memory = armv7m_fill_memory,
 
 	.run_algorithm = armv7m_run_algorithm,
 	.start_algorithm = armv7m_start_algorithm,
@@ -16,6 +16,7 @@
 
 #include "armv7m.h"
 #include "helper/bits.h"
+#include "jtag/interface.h"
 
 #define CORTEX_M_COMMON_MAGIC 0x1A451A45U
 
@@ -195,6 +196,8 @@ struct cortex_m_fp_comparator {
 	bool used;
 	int type;
 	uint32_t fpcr_value;
+	/* value in the comparator, updated lazily before the core runs */
+	uint32_t fpcr_programmed;
 	uint32_t fpcr_address;
 };
 
@@ -203,6 +206,8 @@ struct cortex_m_dwt_comparator {
 	uint32_t comp;
 	uint32_t mask;
 	uint32_t function;
+	/* value in DWT_FUNCTION, updated lazily before the core runs */
+	uint32_t function_programmed;
 	uint32_t dwt_comparator_address;
 };
 
@@ -252,6 +257,7 @@ struct cortex_m_common {
 	const struct cortex_m_part_info *core_info;
 
 	bool slow_register_read;	/* A register has not been ready, poll S_REGRDY */
+	bool lazy_regs;			/* Read the other registers on first access */
 
 	uint64_t apsel;
 
@@ -262,6 +268,10 @@ struct cortex_m_common {
 	/* Errata 3092511 Cortex-M7 can halt in an incorrect address when breakpoint
 	 * and exception occurs simultaneously */
 	bool incorrect_halt_erratum;
+
+	/* While running, let the adapter firmware poll DHCSR if it can */
+	bool dhcsr_watch_enabled;
+	struct adapter_watch dhcsr_watch;
 };
 
 static inline bool is_cortex_m_or_hla(const struct cortex_m_common *cortex_m)
@@ -335,6 +345,14 @@ int cortex_m_add_breakpoint(struct target *target, struct breakpoint *breakpoint
 int cortex_m_remove_breakpoint(struct target *target, struct breakpoint *breakpoint);
 int cortex_m_add_watchpoint(struct target *target, struct watchpoint *watchpoint);
 int cortex_m_remove_watchpoint(struct target *target, struct watchpoint *watchpoint);
+
+/**
+ * Allocate a DWT comparator to emit a data trace packet, through ITM, with
+ * the value written at @a address on each write.
+ */
+int cortex_m_set_data_trace(struct target *target, target_addr_t address,
+		unsigned int *dwt_num);
+int cortex_m_clear_data_trace(struct target *target, unsigned int dwt_num);
 void cortex_m_enable_breakpoints(struct target *target);
 void cortex_m_enable_watchpoints(struct target *target);
 void cortex_m_deinit_target(struct target *target);
@@ -457,6 +457,77 @@ int embeddedice_receive(struct arm_jtag *jtag_info, uint32_t *data, uint32_t siz
 	return jtag_execute_queue();
 }
 
+/**
+ * Receive a block of size 32-bit words from the DCC, handshaking in bulk.
+ * Each word is preceded by a capture of the DCC control register; all
+ * scans are executed at once and the W bit of every capture is checked
+ * afterwards, so a target that was not fast enough is reported as a
+ * failure instead of returning stale data.
+ */
+int embeddedice_receive_checked(struct arm_jtag *jtag_info, uint32_t *data, uint32_t size)
+{
+	struct scan_field fields[3];
+	uint8_t field1_out[1];
+	uint8_t field2_out[1];
+	uint8_t *ctrl;
+	int retval;
+
+	ctrl = malloc(size * 4);
+	if (!ctrl)
+		return ERROR_FAIL;
+
+	retval = arm_jtag_scann(jtag_info, 0x2, TAP_IDLE);
+	if (retval == ERROR_OK)
+		retval = arm_jtag_set_instr(jtag_info->tap, jtag_info->intest_instr, NULL, TAP_IDLE);
+	if (retval != ERROR_OK) {
+		free(ctrl);
+		return retval;
+	}
+
+	fields[0].num_bits = 32;
+	fields[0].out_value = NULL;
+	fields[0].in_value = NULL;
+
+	fields[1].num_bits = 5;
+	fields[1].out_value = field1_out;
+	field1_out[0] = eice_regs[EICE_COMMS_CTRL].addr;
+	fields[1].in_value = NULL;
+
+	fields[2].num_bits = 1;
+	fields[2].out_value = field2_out;
+	field2_out[0] = 0;
+	fields[2].in_value = NULL;
+
+	jtag_add_dr_scan(jtag_info->tap, 3, fields, TAP_IDLE);
+
+	for (uint32_t i = 0; i < size; i++) {
+		/* capture the control register, select the data register */
+		field1_out[0] = eice_regs[EICE_COMMS_DATA].addr;
+		fields[0].in_value = ctrl + i * 4;
+		jtag_add_dr_scan(jtag_info->tap, 3, fields, TAP_IDLE);
+
+		/* capture the data register, select the control register again */
+		field1_out[0] = eice_regs[EICE_COMMS_CTRL].addr;
+		fields[0].in_value = (uint8_t *)&data[i];
+		jtag_add_dr_scan(jtag_info->tap, 3, fields, TAP_IDLE);
+		jtag_add_callback(arm_le_to_h_u32, (jtag_callback_data_t)&data[i]);
+	}
+
+	retval = jtag_execute_queue();
+	if (retval == ERROR_OK) {
+		for (uint32_t i = 0; i < size; i++) {
+			if (!buf_get_u32(ctrl + i * 4, EICE_COMM_CTRL_WBIT, 1)) {
+				LOG_DEBUG("DCC word %" PRIu32 " of %" PRIu32 " was not ready", i, size);
+				retval = ERROR_FAIL;
+				break;
+			}
+		}
+	}
+
+	free(ctrl);
+	return retval;
+}
+
 /**
  * Queue a read for an EmbeddedICE register into the register cache,
  * not checking the value read.
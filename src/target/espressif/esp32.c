@@ -464,7 +464,7 @@ struct target_type esp32_target = {
 	.poll = esp_xtensa_smp_poll,
 	.arch_state = esp32_arch_state,
 
-	.halt = xtensa_halt,
+	.halt = esp_xtensa_smp_halt,
 	.resume = esp_xtensa_smp_resume,
 	.step = esp_xtensa_smp_step,
 
@@ -484,6 +484,7 @@ struct target_type esp32_target = {
 
 	.get_gdb_arch = xtensa_get_gdb_arch,
 	.get_gdb_reg_list = xtensa_get_gdb_reg_list,
+	.fetch_regs = xtensa_fetch_regs,
 
 	.run_algorithm = xtensa_run_algorithm,
 	.start_algorithm = xtensa_start_algorithm,
@@ -20,6 +20,7 @@
 #ifndef _WIN32
 #include <netinet/tcp.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #endif
 
 #include <helper/list.h>
@@ -27,6 +28,7 @@
 #include <target/target.h>
 #include <target/target_type.h>
 #include <target/smp.h>
+#include <target/trace_recorder.h>
 #include <server/server.h>
 #include "esp_xtensa.h"
 #include "esp_xtensa_smp.h"
@@ -48,18 +50,32 @@
 #define ESP32_APPTRACE_TGT_STATE_TMO            5000
 #define ESP_APPTRACE_BLOCKS_POOL_SZ             10
 
+/* Small writes (e.g. SystemView events) are gathered in the destination
+ * buffer, larger ones are output from the caller's data together with the
+ * gathered bytes in a single writev() */
+#define ESP32_APPTRACE_DEST_BUF_SZ              4096
+#define ESP32_APPTRACE_DEST_DIRECT_SZ           512
+
+struct esp32_apptrace_dest_buf {
+	uint8_t data[ESP32_APPTRACE_DEST_BUF_SZ];
+	size_t len;
+};
+
 struct esp32_apptrace_dest_file_data {
 	int fout;
+	struct esp32_apptrace_dest_buf buf;
 };
 
 struct esp32_apptrace_dest_tcp_data {
 	int sockfd;
+	struct esp32_apptrace_dest_buf buf;
 };
 
 struct esp32_apptrace_target_state {
 	int running;
 	uint32_t block_id;
 	uint32_t data_len;
+	bool conn;
 };
 
 struct esp_apptrace_target2host_hdr {
@@ -93,13 +109,82 @@ static const bool s_time_stats_enable = true;
 *                       Trace destination API
 **********************************************************************/
 
+/* output the buffered bytes followed by 'data', returns the number of bytes
+ * written or -1 */
+static ssize_t esp32_apptrace_dest_buf_output(struct esp32_apptrace_dest_buf *buf, int fd, bool is_socket,
+	const uint8_t *data, size_t size)
+{
+	const uint8_t *data1 = buf->data, *data2 = data;
+	size_t len1 = buf->len, len2 = size;
+
+	while (len1 + len2 > 0) {
+		ssize_t written;
+
+#ifdef _WIN32
+		const uint8_t *wr_data = len1 ? data1 : data2;
+		size_t wr_len = len1 ? len1 : len2;
+		if (is_socket)
+			written = write_socket(fd, wr_data, wr_len);
+		else
+			written = write(fd, wr_data, wr_len);
+#else
+		struct iovec iov[2] = {
+			{ .iov_base = (void *)data1, .iov_len = len1 },
+			{ .iov_base = (void *)data2, .iov_len = len2 },
+		};
+		written = len1 ? writev(fd, iov, 2) : writev(fd, iov + 1, 1);
+#endif
+		if (written <= 0)
+			return -1;
+
+		size_t done = MIN((size_t)written, len1);
+		data1 += done;
+		len1 -= done;
+		written -= done;
+		data2 += written;
+		len2 -= written;
+	}
+	buf->len = 0;
+
+	return size;
+}
+
+static int esp32_apptrace_dest_buf_write(struct esp32_apptrace_dest_buf *buf, int fd, bool is_socket,
+	const uint8_t *data, size_t size)
+{
+	if (size < ESP32_APPTRACE_DEST_DIRECT_SZ) {
+		if (buf->len + size > sizeof(buf->data) &&
+			esp32_apptrace_dest_buf_output(buf, fd, is_socket, NULL, 0) < 0)
+			return ERROR_FAIL;
+		memcpy(buf->data + buf->len, data, size);
+		buf->len += size;
+		return ERROR_OK;
+	}
+
+	if (esp32_apptrace_dest_buf_output(buf, fd, is_socket, data, size) < 0)
+		return ERROR_FAIL;
+
+	return ERROR_OK;
+}
+
 static int esp32_apptrace_file_dest_write(void *priv, uint8_t *data, int size)
 {
 	struct esp32_apptrace_dest_file_data *dest_data = (struct esp32_apptrace_dest_file_data *)priv;
 
-	int wr_sz = write(dest_data->fout, data, size);
-	if (wr_sz != size) {
-		LOG_ERROR("Failed to write %d bytes to out file (%d)! Written %d.", size, errno, wr_sz);
+	int res = esp32_apptrace_dest_buf_write(&dest_data->buf, dest_data->fout, false, data, size);
+	if (res != ERROR_OK) {
+		LOG_ERROR("Failed to write %d bytes to out file (%d)!", size, errno);
+		return ERROR_FAIL;
+	}
+	return ERROR_OK;
+}
+
+static int esp32_apptrace_file_dest_flush(void *priv)
+{
+	struct esp32_apptrace_dest_file_data *dest_data = (struct esp32_apptrace_dest_file_data *)priv;
+
+	if (esp32_apptrace_dest_buf_output(&dest_data->buf, dest_data->fout, false, NULL, 0) < 0) {
+		LOG_ERROR("Failed to write %zu bytes to out file (%d)!", dest_data->buf.len, errno);
 		return ERROR_FAIL;
 	}
 	return ERROR_OK;
@@ -109,8 +194,10 @@ static int esp32_apptrace_file_dest_cleanup(void *priv)
 {
 	struct esp32_apptrace_dest_file_data *dest_data = (struct esp32_apptrace_dest_file_data *)priv;
 
-	if (dest_data->fout > 0)
+	if (dest_data->fout > 0) {
+		esp32_apptrace_file_dest_flush(dest_data);
 		close(dest_data->fout);
+	}
 	free(dest_data);
 	return ERROR_OK;
 }
@@ -133,6 +220,7 @@ static int esp32_apptrace_file_dest_init(struct esp32_apptrace_dest *dest, const
 
 	dest->priv = dest_data;
 	dest->write = esp32_apptrace_file_dest_write;
+	dest->flush = esp32_apptrace_file_dest_flush;
 	dest->clean = esp32_apptrace_file_dest_cleanup;
 	dest->log_progress = true;
 
@@ -163,9 +251,21 @@ static int esp32_apptrace_console_dest_init(struct esp32_apptrace_dest *dest, co
 static int esp32_apptrace_tcp_dest_write(void *priv, uint8_t *data, int size)
 {
 	struct esp32_apptrace_dest_tcp_data *dest_data = (struct esp32_apptrace_dest_tcp_data *)priv;
-	int wr_sz = write_socket(dest_data->sockfd, data, size);
-	if (wr_sz != size) {
-		LOG_ERROR("Failed to write %u bytes to out socket (%d)! Written %d.", size, errno, wr_sz);
+
+	int res = esp32_apptrace_dest_buf_write(&dest_data->buf, dest_data->sockfd, true, data, size);
+	if (res != ERROR_OK) {
+		LOG_ERROR("Failed to write %d bytes to out socket (%d)!", size, errno);
+		return ERROR_FAIL;
+	}
+	return ERROR_OK;
+}
+
+static int esp32_apptrace_tcp_dest_flush(void *priv)
+{
+	struct esp32_apptrace_dest_tcp_data *dest_data = (struct esp32_apptrace_dest_tcp_data *)priv;
+
+	if (esp32_apptrace_dest_buf_output(&dest_data->buf, dest_data->sockfd, true, NULL, 0) < 0) {
+		LOG_ERROR("Failed to write %zu bytes to out socket (%d)!", dest_data->buf.len, errno);
 		return ERROR_FAIL;
 	}
 	return ERROR_OK;
@@ -175,8 +275,10 @@ static int esp32_apptrace_tcp_dest_cleanup(void *priv)
 {
 	struct esp32_apptrace_dest_tcp_data *dest_data = (struct esp32_apptrace_dest_tcp_data *)priv;
 
-	if (dest_data->sockfd > 0)
+	if (dest_data->sockfd > 0) {
+		esp32_apptrace_tcp_dest_flush(dest_data);
 		close_socket(dest_data->sockfd);
+	}
 	free(dest_data);
 	return ERROR_OK;
 }
@@ -263,6 +365,7 @@ static int esp32_apptrace_tcp_dest_init(struct esp32_apptrace_dest *dest, const
 	dest_data->sockfd = sockfd;
 	dest->priv = dest_data;
 	dest->write = esp32_apptrace_tcp_dest_write;
+	dest->flush = esp32_apptrace_tcp_dest_flush;
 	dest->clean = esp32_apptrace_tcp_dest_cleanup;
 	dest->log_progress = true;
 
@@ -295,11 +398,27 @@ int esp32_apptrace_dest_init(struct esp32_apptrace_dest dest[], const char *dest
 
 int esp32_apptrace_dest_cleanup(struct esp32_apptrace_dest dest[], unsigned int max_dests)
 {
+	int retval = ERROR_OK;
+
+	/* clean all of them, buffered data of every destination must be output */
 	for (unsigned int i = 0; i < max_dests; i++) {
 		if (dest[i].clean && dest[i].priv) {
 			int res = dest[i].clean(dest[i].priv);
 			dest[i].priv = NULL;
-			return res;
+			if (res != ERROR_OK && retval == ERROR_OK)
+				retval = res;
+		}
+	}
+	return retval;
+}
+
+int esp32_apptrace_dest_flush(struct esp32_apptrace_dest dest[], unsigned int max_dests)
+{
+	for (unsigned int i = 0; i < max_dests; i++) {
+		if (dest[i].flush && dest[i].priv) {
+			int res = dest[i].flush(dest[i].priv);
+			if (res != ERROR_OK)
+				return res;
 		}
 	}
 	return ERROR_OK;
@@ -847,6 +966,59 @@ static uint32_t esp32_apptrace_usr_block_check(struct esp32_apptrace_cmd_ctx *ct
 	return usr_len;
 }
 
+/* read the control registers of all the cores, in one run when supported */
+static int esp32_apptrace_ctrl_regs_read(struct esp32_apptrace_cmd_ctx *ctx,
+	struct esp32_apptrace_target_state *target_state)
+{
+	if (ctx->hw->ctrl_regs_read) {
+		uint32_t block_id[ESP32_APPTRACE_MAX_CORES_NUM];
+		uint32_t len[ESP32_APPTRACE_MAX_CORES_NUM];
+		bool conn[ESP32_APPTRACE_MAX_CORES_NUM];
+
+		int res = ctx->hw->ctrl_regs_read(ctx->cpus, ctx->cores_num, block_id, len, conn);
+		if (res != ERROR_OK) {
+			LOG_ERROR("Failed to read apptrace control regs (%d)!", res);
+			return res;
+		}
+		for (unsigned int i = 0; i < ctx->cores_num; i++) {
+			target_state[i].block_id = block_id[i];
+			target_state[i].data_len = len[i];
+			target_state[i].conn = conn[i];
+		}
+		return ERROR_OK;
+	}
+
+	for (unsigned int i = 0; i < ctx->cores_num; i++) {
+		int res = ctx->hw->ctrl_reg_read(ctx->cpus[i], &target_state[i].block_id,
+			&target_state[i].data_len, &target_state[i].conn);
+		if (res != ERROR_OK) {
+			LOG_ERROR("Failed to read data len on (%s)!", target_name(ctx->cpus[i]));
+			return res;
+		}
+	}
+	return ERROR_OK;
+}
+
+/* write the same control register value to the listed cores */
+static int esp32_apptrace_ctrl_regs_write(struct esp32_apptrace_cmd_ctx *ctx,
+	struct target *targets[],
+	unsigned int num,
+	uint32_t block_id,
+	uint32_t len,
+	bool conn,
+	bool data)
+{
+	if (ctx->hw->ctrl_regs_write)
+		return ctx->hw->ctrl_regs_write(targets, num, block_id, len, conn, data);
+
+	for (unsigned int i = 0; i < num; i++) {
+		int res = ctx->hw->ctrl_reg_write(targets[i], block_id, len, conn, data);
+		if (res != ERROR_OK)
+			return res;
+	}
+	return ERROR_OK;
+}
+
 int esp32_apptrace_get_data_info(struct esp32_apptrace_cmd_ctx *ctx,
 	struct esp32_apptrace_target_state *target_state,
 	uint32_t *fired_target_num)
@@ -854,12 +1026,11 @@ int esp32_apptrace_get_data_info(struct esp32_apptrace_cmd_ctx *ctx,
 	if (fired_target_num)
 		*fired_target_num = UINT32_MAX;
 
+	int res = esp32_apptrace_ctrl_regs_read(ctx, target_state);
+	if (res != ERROR_OK)
+		return res;
+
 	for (unsigned int i = 0; i < ctx->cores_num; i++) {
-		int res = ctx->hw->data_len_read(ctx->cpus[i], &target_state[i].block_id, &target_state[i].data_len);
-		if (res != ERROR_OK) {
-			LOG_ERROR("Failed to read data len on (%s)!", target_name(ctx->cpus[i]));
-			return res;
-		}
 		if (target_state[i].data_len) {
 			LOG_TARGET_DEBUG(ctx->cpus[i], "Block %" PRId32 ", len %" PRId32 " bytes on fired",
 				target_state[i].block_id, target_state[i].data_len);
@@ -900,6 +1071,10 @@ static int esp32_apptrace_process_data(struct esp32_apptrace_cmd_ctx *ctx,
 		ctx->tot_len += data_len;
 	}
 
+	int res = esp32_apptrace_dest_flush(&cmd_data->data_dest, 1);
+	if (res != ERROR_OK)
+		return res;
+
 	if (cmd_data->data_dest.log_progress)
 		LOG_USER("%" PRId32 " ", ctx->tot_len);
 	/* check for stop condition */
@@ -926,6 +1101,7 @@ static int esp32_apptrace_handle_trace_block(struct esp32_apptrace_cmd_ctx *ctx,
 		/* process user block */
 		uint32_t usr_len = esp32_apptrace_usr_block_check(ctx, block->data + processed);
 		int core_id = ctx->trace_format.core_id_get(ctx->target, block->data + processed);
+		trace_recorder_write(TRACE_RECORDER_SRC_APPTRACE, core_id, block->data + processed + hdr_sz, usr_len);
 		/* process user data */
 		int res = ctx->process_data(ctx, core_id, block->data + processed + hdr_sz, usr_len);
 		if (res != ERROR_OK) {
@@ -944,41 +1120,44 @@ static int esp32_apptrace_data_processor(void *priv)
 	if (!ctx->running)
 		return ERROR_OK;
 
-	struct esp32_apptrace_block *block = esp32_apptrace_ready_block_get(ctx);
-	if (!block)
-		return ERROR_OK;
-
-	int res = esp32_apptrace_handle_trace_block(ctx, block);
-	if (res != ERROR_OK) {
-		ctx->running = 0;
-		LOG_ERROR("Failed to process trace block %" PRId32 " bytes!", block->data_len);
-		return res;
-	}
-	res = esp32_apptrace_block_free(ctx, block);
-	if (res != ERROR_OK) {
-		ctx->running = 0;
-		LOG_ERROR("Failed to free ready block!");
-		return res;
+	/* drain all the blocks acquired since the last call */
+	while (ctx->running) {
+		struct esp32_apptrace_block *block = esp32_apptrace_ready_block_get(ctx);
+		if (!block)
+			break;
+		int res = esp32_apptrace_handle_trace_block(ctx, block);
+		if (res != ERROR_OK) {
+			ctx->running = 0;
+			LOG_ERROR("Failed to process trace block %" PRId32 " bytes!", block->data_len);
+			return res;
+		}
+		res = esp32_apptrace_block_free(ctx, block);
+		if (res != ERROR_OK) {
+			ctx->running = 0;
+			LOG_ERROR("Failed to free ready block!");
+			return res;
+		}
 	}
 
 	return ERROR_OK;
 }
 
-static int esp32_apptrace_check_connection(struct esp32_apptrace_cmd_ctx *ctx)
+/* check the connection state got from the control registers, sets
+ * 'reconnected' if any core had to be connected again */
+static int esp32_apptrace_check_connection(struct esp32_apptrace_cmd_ctx *ctx,
+	const struct esp32_apptrace_target_state *target_state,
+	bool *reconnected)
 {
 	if (!ctx)
 		return ERROR_FAIL;
 
 	unsigned int busy_target_num = 0;
 
+	*reconnected = false;
 	for (unsigned int i = 0; i < ctx->cores_num; i++) {
-		bool conn = true;
-		int res = ctx->hw->ctrl_reg_read(ctx->cpus[i], NULL, NULL, &conn);
-		if (res != ERROR_OK) {
-			LOG_ERROR("Failed to read apptrace control reg for cpu(%d) res(%d)!", i, res);
-			return res;
-		}
-		if (!conn) {
+		int res;
+
+		if (!target_state[i].conn) {
 			uint32_t stat = 0;
 			LOG_TARGET_WARNING(ctx->cpus[i], "apptrace connection is lost. Re-connect.");
 			res = ctx->hw->status_reg_read(ctx->cpus[i], &stat);
@@ -1003,6 +1182,7 @@ static int esp32_apptrace_check_connection(struct esp32_apptrace_cmd_ctx *ctx)
 				LOG_ERROR("Failed to write apptrace control reg for cpu(%d) res(%d)!", i, res);
 				return res;
 			}
+			*reconnected = true;
 			if (ctx->stop_tmo != -1.0) {
 				/* re-start idle time measurement */
 				if (duration_start(&ctx->idle_time) != 0) {
@@ -1030,21 +1210,31 @@ static int esp32_apptrace_poll(void *priv)
 		return ERROR_FAIL;
 	}
 
+	/* check for data from target, the control registers of all the cores
+	 * are read at once and also give the connection state */
+	res = esp32_apptrace_get_data_info(ctx, target_state, &fired_target_num);
+	if (res != ERROR_OK) {
+		ctx->running = 0;
+		LOG_ERROR("Failed to read data len!");
+		return res;
+	}
+
 	/*  Check for connection is alive.For some reason target and therefore host_connected flag
 	 *  might have been reset */
-	res = esp32_apptrace_check_connection(ctx);
+	bool reconnected;
+	res = esp32_apptrace_check_connection(ctx, target_state, &reconnected);
 	if (res != ERROR_OK) {
 		if (res != ERROR_WAIT)
 			ctx->running = 0;
 		return res;
 	}
-
-	/* check for data from target */
-	res = esp32_apptrace_get_data_info(ctx, target_state, &fired_target_num);
-	if (res != ERROR_OK) {
-		ctx->running = 0;
-		LOG_ERROR("Failed to read data len!");
-		return res;
+	if (reconnected) {
+		res = esp32_apptrace_get_data_info(ctx, target_state, &fired_target_num);
+		if (res != ERROR_OK) {
+			ctx->running = 0;
+			LOG_ERROR("Failed to read data len!");
+			return res;
+		}
 	}
 	/* LOG_DEBUG("Block %d (%d bytes) on target (%s)!", target_state[0].block_id,
 	 * target_state[0].data_len, target_name(ctx->cpus[0])); */
@@ -1064,21 +1254,24 @@ static int esp32_apptrace_poll(void *priv)
 			/* handle block ID overflow */
 			if (max_block_id == ctx->hw->max_block_id && min_block_id == 0)
 				max_block_id = 0;
+			struct target *ack_targets[ESP32_APPTRACE_MAX_CORES_NUM];
+			unsigned int ack_num = 0;
 			for (unsigned int i = 0; i < ctx->cores_num; i++) {
 				if (max_block_id != target_state[i].block_id) {
 					LOG_TARGET_DEBUG(ctx->cpus[i], "Ack empty block %" PRId32 "!", max_block_id);
-					res = ctx->hw->ctrl_reg_write(ctx->cpus[i],
-						max_block_id,
-						0 /*all read*/,
-						true /*host connected*/,
-						false /*no host data*/);
-					if (res != ERROR_OK) {
-						ctx->running = 0;
-						LOG_TARGET_ERROR(ctx->cpus[i], "Failed to ack empty data block!");
-						return res;
-					}
+					ack_targets[ack_num++] = ctx->cpus[i];
 				}
 			}
+			res = esp32_apptrace_ctrl_regs_write(ctx, ack_targets, ack_num,
+				max_block_id,
+				0 /*all read*/,
+				true /*host connected*/,
+				false /*no host data*/);
+			if (res != ERROR_OK) {
+				ctx->running = 0;
+				LOG_ERROR("Failed to ack empty data block!");
+				return res;
+			}
 			ctx->last_blk_id = max_block_id;
 		}
 		if (ctx->stop_tmo != -1.0) {
@@ -1157,20 +1350,23 @@ static int esp32_apptrace_poll(void *priv)
 	/* in sync mode do not ack target data on other cores, esp32_apptrace_handle_trace_block() can write response
 	 * data and will do ack thereafter */
 	if (ctx->mode != ESP_APPTRACE_CMD_MODE_SYNC) {
+		struct target *ack_targets[ESP32_APPTRACE_MAX_CORES_NUM];
+		unsigned int ack_num = 0;
 		for (unsigned int i = 0; i < ctx->cores_num; i++) {
 			if (i == fired_target_num)
 				continue;
-			res = ctx->hw->ctrl_reg_write(ctx->cpus[i],
-				ctx->last_blk_id,
-				0 /*all read*/,
-				true /*host connected*/,
-				false /*no host data*/);
-			if (res != ERROR_OK) {
-				ctx->running = 0;
-				LOG_TARGET_ERROR(ctx->cpus[i], "Failed to ack data!");
-				return res;
-			}
 			LOG_TARGET_DEBUG(ctx->cpus[i], "Ack block %" PRId32, ctx->last_blk_id);
+			ack_targets[ack_num++] = ctx->cpus[i];
+		}
+		res = esp32_apptrace_ctrl_regs_write(ctx, ack_targets, ack_num,
+			ctx->last_blk_id,
+			0 /*all read*/,
+			true /*host connected*/,
+			false /*no host data*/);
+		if (res != ERROR_OK) {
+			ctx->running = 0;
+			LOG_ERROR("Failed to ack data!");
+			return res;
 		}
 		res = esp32_apptrace_ready_block_put(ctx, block);
 		if (res != ERROR_OK) {
@@ -30,6 +30,19 @@ struct esp32_apptrace_hw {
 	int (*data_len_read)(struct target *target,
 		uint32_t *block_id,
 		uint32_t *len);
+	/* Optional, access the control registers of several cores in one
+	 * debug adapter run. NULL output arrays are not filled. */
+	int (*ctrl_regs_read)(struct target *targets[],
+		unsigned int num,
+		uint32_t block_id[],
+		uint32_t len[],
+		bool conn[]);
+	int (*ctrl_regs_write)(struct target *targets[],
+		unsigned int num,
+		uint32_t block_id,
+		uint32_t len,
+		bool conn,
+		bool data);
 	int (*data_read)(struct target *target,
 		uint32_t size,
 		uint8_t *buffer,
@@ -54,6 +67,8 @@ struct esp_apptrace_host2target_hdr {
 struct esp32_apptrace_dest {
 	void *priv;
 	int (*write)(void *priv, uint8_t *data, int size);
+	/* optional, outputs the data accumulated by write() */
+	int (*flush)(void *priv);
 	int (*clean)(void *priv);
 	bool log_progress;
 };
@@ -116,6 +131,7 @@ void esp32_apptrace_cmd_args_parse(struct esp32_apptrace_cmd_ctx *cmd_ctx,
 	int argc);
 int esp32_apptrace_dest_init(struct esp32_apptrace_dest dest[], const char *dest_paths[], unsigned int max_dests);
 int esp32_apptrace_dest_cleanup(struct esp32_apptrace_dest dest[], unsigned int max_dests);
+int esp32_apptrace_dest_flush(struct esp32_apptrace_dest dest[], unsigned int max_dests);
 int esp_apptrace_usr_block_write(const struct esp32_apptrace_hw *hw, struct target *target,
 	uint32_t block_id,
 	const uint8_t *data,
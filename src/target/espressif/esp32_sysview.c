@@ -540,6 +540,12 @@ int esp32_sysview_process_data(struct esp32_apptrace_cmd_ctx *ctx,
 		ctx->tot_len += pkt_len;
 		processed += pkt_len;
 	}
+	/* the events of the block were gathered by the destinations */
+	res = esp32_apptrace_dest_flush(cmd_data->data_dests, ESP32_APPTRACE_MAX_CORES_NUM);
+	if (res != ERROR_OK) {
+		LOG_ERROR("sysview: Failed to flush trace data!");
+		return res;
+	}
 	LOG_USER("%u ", ctx->tot_len);
 	/* check for stop condition */
 	if (ctx->tot_len > cmd_data->apptrace.skip_len &&
@@ -385,7 +385,7 @@ struct target_type esp32s3_target = {
 	.poll = esp_xtensa_smp_poll,
 	.arch_state = esp32s3_arch_state,
 
-	.halt = xtensa_halt,
+	.halt = esp_xtensa_smp_halt,
 	.resume = esp_xtensa_smp_resume,
 	.step = esp_xtensa_smp_step,
 
@@ -405,6 +405,7 @@ struct target_type esp32s3_target = {
 
 	.get_gdb_arch = xtensa_get_gdb_arch,
 	.get_gdb_reg_list = xtensa_get_gdb_reg_list,
+	.fetch_regs = xtensa_fetch_regs,
 
 	.run_algorithm = xtensa_run_algorithm,
 	.start_algorithm = xtensa_start_algorithm,
@@ -54,6 +54,8 @@ struct esp32_apptrace_hw esp_xtensa_apptrace_hw = {
 	.ctrl_reg_write = esp_xtensa_apptrace_ctrl_reg_write,
 	.ctrl_reg_read = esp_xtensa_apptrace_ctrl_reg_read,
 	.data_len_read = esp_xtensa_apptrace_data_len_read,
+	.ctrl_regs_read = esp_xtensa_apptrace_ctrl_regs_read,
+	.ctrl_regs_write = esp_xtensa_apptrace_ctrl_regs_write,
 	.data_read = esp_xtensa_apptrace_data_read,
 	.usr_block_max_size_get = esp_xtensa_apptrace_usr_block_max_size_get,
 	.buffs_write = esp_xtensa_apptrace_buffs_write,
@@ -237,6 +239,102 @@ int esp_xtensa_apptrace_ctrl_reg_read(struct target *target,
 	return ERROR_OK;
 }
 
+/* All the cores are expected on the same JTAG chain, so the queued
+ * accesses of every core go out in a single run */
+static bool esp_xtensa_apptrace_same_queue(struct target *targets[], unsigned int num)
+{
+	for (unsigned int i = 0; i < num; i++) {
+		if (target_to_xtensa(targets[i])->dbg_mod.dap)
+			return false;
+	}
+	return true;
+}
+
+int esp_xtensa_apptrace_ctrl_regs_read(struct target *targets[],
+	unsigned int num,
+	uint32_t block_id[],
+	uint32_t len[],
+	bool conn[])
+{
+	uint8_t tmp[ESP32_APPTRACE_MAX_CORES_NUM][4];
+
+	if (num > ESP32_APPTRACE_MAX_CORES_NUM)
+		return ERROR_FAIL;
+
+	if (!esp_xtensa_apptrace_same_queue(targets, num)) {
+		for (unsigned int i = 0; i < num; i++) {
+			int res = esp_xtensa_apptrace_ctrl_reg_read(targets[i],
+				block_id ? &block_id[i] : NULL,
+				len ? &len[i] : NULL,
+				conn ? &conn[i] : NULL);
+			if (res != ERROR_OK)
+				return res;
+		}
+		return ERROR_OK;
+	}
+
+	for (unsigned int i = 0; i < num; i++) {
+		struct xtensa *xtensa = target_to_xtensa(targets[i]);
+
+		xtensa_queue_dbg_reg_read(xtensa, XTENSA_APPTRACE_CTRL_REG, tmp[i]);
+		xtensa_dm_queue_tdi_idle(&xtensa->dbg_mod);
+	}
+	int res = xtensa_dm_queue_execute(&target_to_xtensa(targets[0])->dbg_mod);
+	if (res != ERROR_OK) {
+		LOG_ERROR("Failed to exec JTAG queue!");
+		return res;
+	}
+
+	for (unsigned int i = 0; i < num; i++) {
+		uint32_t val = target_buffer_get_u32(targets[i], tmp[i]);
+		if (block_id)
+			block_id[i] = XTENSA_APPTRACE_BLOCK_ID_GET(val);
+		if (len)
+			len[i] = XTENSA_APPTRACE_BLOCK_LEN_GET(val);
+		if (conn)
+			conn[i] = val & XTENSA_APPTRACE_HOST_CONNECT;
+	}
+	return ERROR_OK;
+}
+
+int esp_xtensa_apptrace_ctrl_regs_write(struct target *targets[],
+	unsigned int num,
+	uint32_t block_id,
+	uint32_t len,
+	bool conn,
+	bool data)
+{
+	uint32_t tmp = (conn ? XTENSA_APPTRACE_HOST_CONNECT : 0) |
+		(data ? XTENSA_APPTRACE_HOST_DATA : 0) | XTENSA_APPTRACE_BLOCK_ID(block_id) |
+		XTENSA_APPTRACE_BLOCK_LEN(len);
+
+	if (num == 0)
+		return ERROR_OK;
+
+	if (!esp_xtensa_apptrace_same_queue(targets, num)) {
+		for (unsigned int i = 0; i < num; i++) {
+			int res = esp_xtensa_apptrace_ctrl_reg_write(targets[i], block_id, len, conn, data);
+			if (res != ERROR_OK)
+				return res;
+		}
+		return ERROR_OK;
+	}
+
+	for (unsigned int i = 0; i < num; i++) {
+		struct xtensa *xtensa = target_to_xtensa(targets[i]);
+
+		xtensa_queue_dbg_reg_write(xtensa, XTENSA_APPTRACE_CTRL_REG, tmp);
+		xtensa_dm_queue_tdi_idle(&xtensa->dbg_mod);
+	}
+	int res = xtensa_dm_queue_execute(&target_to_xtensa(targets[0])->dbg_mod);
+	if (res != ERROR_OK) {
+		LOG_ERROR("Failed to exec JTAG queue!");
+		return res;
+	}
+
+	return ERROR_OK;
+}
+
 int esp_xtensa_apptrace_status_reg_read(struct target *target, uint32_t *stat)
 {
 	struct xtensa *xtensa = target_to_xtensa(target);
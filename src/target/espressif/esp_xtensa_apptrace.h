@@ -23,6 +23,10 @@ int esp_xtensa_apptrace_data_read(struct target *target,
 	uint32_t block_id,
 	bool ack);
 int esp_xtensa_apptrace_ctrl_reg_read(struct target *target, uint32_t *block_id, uint32_t *len, bool *conn);
+int esp_xtensa_apptrace_ctrl_regs_read(struct target *targets[], unsigned int num,
+	uint32_t block_id[], uint32_t len[], bool conn[]);
+int esp_xtensa_apptrace_ctrl_regs_write(struct target *targets[], unsigned int num,
+	uint32_t block_id, uint32_t len, bool conn, bool data);
 int esp_xtensa_apptrace_ctrl_reg_write(struct target *target,
 	uint32_t block_id,
 	uint32_t len,
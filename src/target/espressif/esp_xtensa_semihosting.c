@@ -51,10 +51,15 @@ int esp_xtensa_semihosting(struct target *target, int *retval)
 {
 	struct esp_xtensa_common *esp_xtensa = target_to_esp_xtensa(target);
 
-	xtensa_reg_val_t dbg_cause = xtensa_reg_get(target, XT_REG_IDX_DEBUGCAUSE);
+	/* does not need the registers of a core whose fetch on halt is still pending */
+	xtensa_reg_val_t dbg_cause = xtensa_cause_get(target);
 	if ((dbg_cause & (DEBUGCAUSE_BI | DEBUGCAUSE_BN)) == 0)
 		return SEMIHOSTING_NONE;
 
+	*retval = xtensa_fetch_pending_regs(target);
+	if (*retval != ERROR_OK)
+		return SEMIHOSTING_NONE;
+
 	uint8_t brk_insn_buf[sizeof(uint32_t)] = { 0 };
 	xtensa_reg_val_t pc = xtensa_reg_get(target, XT_REG_IDX_PC);
 	*retval = target_read_memory(target, pc, ESP_XTENSA_SYSCALL_SZ, 1, brk_insn_buf);
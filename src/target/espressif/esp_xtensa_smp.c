@@ -204,7 +204,7 @@ int esp_xtensa_smp_poll(struct target *target)
 	}
 
 	if (old_state != TARGET_HALTED && target->state == TARGET_HALTED) {
-		if (target->smp) {
+		if (target->smp && !target->smp_nonstop) {
 			ret = esp_xtensa_smp_update_halt_gdb(target, &other_core_resume_req);
 			if (ret != ERROR_OK)
 				return ret;
@@ -291,10 +291,13 @@ static int esp_xtensa_smp_update_halt_gdb(struct target *target, bool *need_resu
 		esp_xtensa_smp->other_core_does_resume = true;
 		/* avoid recursion in esp_xtensa_smp_poll() */
 		curr->smp = 0;
+		/* GDB does not show this core yet, leave its registers until they are accessed */
+		esp_xtensa_smp->esp_xtensa.xtensa.defer_halt_fetch = true;
 		if (esp_xtensa_smp->chip_ops->poll)
 			ret = esp_xtensa_smp->chip_ops->poll(curr);
 		else
 			ret = esp_xtensa_smp_poll(curr);
+		esp_xtensa_smp->esp_xtensa.xtensa.defer_halt_fetch = false;
 		curr->smp = 1;
 		if (ret != ERROR_OK)
 			return ret;
@@ -333,6 +336,72 @@ static inline int esp_xtensa_smp_smpbreak_restore(struct target *target, uint32_
 	return xtensa_smpbreak_set(target, smp_break);
 }
 
+/* JTAG cores share one queue; cores behind a DAP are flushed per DAP */
+static int esp_xtensa_smp_queue_execute(struct target *target)
+{
+	struct xtensa *xtensa = target_to_xtensa(target);
+	struct target_list *head;
+
+	int res = xtensa_dm_queue_execute(&xtensa->dbg_mod);
+	if (res != ERROR_OK || !target->smp || !xtensa->dbg_mod.dap)
+		return res;
+
+	foreach_smp_target(head, target->smp_targets) {
+		struct xtensa *curr = target_to_xtensa(head->target);
+		if (curr->dbg_mod.dap && curr->dbg_mod.dap != xtensa->dbg_mod.dap) {
+			res = xtensa_dm_queue_execute(&curr->dbg_mod);
+			if (res != ERROR_OK)
+				return res;
+		}
+	}
+	return ERROR_OK;
+}
+
+/* other cores resumed along with the one GDB resumes */
+static bool esp_xtensa_smp_resumes_with(struct target *target, struct target *curr)
+{
+	/* in single-core mode disabled core cannot be examined, but need to be resumed too*/
+	return curr != target && curr->state != TARGET_RUNNING && target_was_examined(curr);
+}
+
+static int esp_xtensa_smp_prepare_resume(struct target *target,
+	bool current,
+	target_addr_t address,
+	bool handle_breakpoints,
+	bool debug_execution)
+{
+	uint32_t smp_break;
+
+	/* xtensa_prepare_resume() can step over breakpoint/watchpoint and generate signals on BreakInOut circuit for
+	 * other cores. So disconnect this core from BreakInOut circuit and do xtensa_prepare_resume(). */
+	int res = esp_xtensa_smp_smpbreak_disable(target, &smp_break);
+	if (res != ERROR_OK)
+		return res;
+	res = xtensa_prepare_resume(target, current, address, handle_breakpoints, debug_execution);
+	/* restore configured BreakInOut signals config */
+	int ret = esp_xtensa_smp_smpbreak_restore(target, smp_break);
+	if (ret != ERROR_OK)
+		return ret;
+	if (res != ERROR_OK) {
+		LOG_TARGET_ERROR(target, "Failed to prepare for resume!");
+		return res;
+	}
+	return ERROR_OK;
+}
+
+static void esp_xtensa_smp_set_resumed(struct target *target, bool debug_execution)
+{
+	target->debug_reason = DBG_REASON_NOTHALTED;
+	if (!debug_execution)
+		target->state = TARGET_RUNNING;
+	else
+		target->state = TARGET_DEBUG_RUNNING;
+
+	target_call_event_callbacks(target, TARGET_EVENT_RESUMED);
+}
+
+/* Prepares the other cores at their current address and queues their RFDO
+ * ahead of the one of the calling core. */
 static int esp_xtensa_smp_resume_cores(struct target *target,
 		bool handle_breakpoints, bool debug_execution)
 {
@@ -343,16 +412,17 @@ static int esp_xtensa_smp_resume_cores(struct target *target,
 
 	foreach_smp_target(head, target->smp_targets) {
 		curr = head->target;
-		/* in single-core mode disabled core cannot be examined, but need to be resumed too*/
-		if ((curr != target) && (curr->state != TARGET_RUNNING) && target_was_examined(curr)) {
-			/*  resume current address, not in SMP mode */
-			curr->smp = 0;
-			int res = esp_xtensa_smp_resume(curr, true, 0, handle_breakpoints, debug_execution);
-			curr->smp = 1;
+		if (esp_xtensa_smp_resumes_with(target, curr)) {
+			int res = esp_xtensa_smp_prepare_resume(curr, true, 0, handle_breakpoints, debug_execution);
 			if (res != ERROR_OK)
 				return res;
 		}
 	}
+	foreach_smp_target(head, target->smp_targets) {
+		curr = head->target;
+		if (esp_xtensa_smp_resumes_with(target, curr))
+			xtensa_queue_resume(curr);
+	}
 	return ERROR_OK;
 }
 
@@ -362,6 +432,7 @@ int esp_xtensa_smp_resume(struct target *target,
 	bool handle_breakpoints,
 	bool debug_execution)
 {
+	struct target_list *head;
 	int res;
 	uint32_t smp_break;
 
@@ -379,20 +450,9 @@ int esp_xtensa_smp_resume(struct target *target,
 		return ERROR_OK;
 	}
 
-	/* xtensa_prepare_resume() can step over breakpoint/watchpoint and generate signals on BreakInOut circuit for
-	 * other cores. So disconnect this core from BreakInOut circuit and do xtensa_prepare_resume(). */
-	res = esp_xtensa_smp_smpbreak_disable(target, &smp_break);
+	res = esp_xtensa_smp_prepare_resume(target, current, address, handle_breakpoints, debug_execution);
 	if (res != ERROR_OK)
 		return res;
-	res = xtensa_prepare_resume(target, current, address, handle_breakpoints, debug_execution);
-	/* restore configured BreakInOut signals config */
-	int ret = esp_xtensa_smp_smpbreak_restore(target, smp_break);
-	if (ret != ERROR_OK)
-		return ret;
-	if (res != ERROR_OK) {
-		LOG_TARGET_ERROR(target, "Failed to prepare for resume!");
-		return res;
-	}
 
 	if (target->smp) {
 		if (target->gdb_service)
@@ -402,22 +462,84 @@ int esp_xtensa_smp_resume(struct target *target,
 			return res;
 	}
 
-	res = xtensa_do_resume(target);
+	/* all cores leave debug mode in the same queue execution */
+	xtensa_queue_resume(target);
+	res = esp_xtensa_smp_queue_execute(target);
 	if (res != ERROR_OK) {
 		LOG_TARGET_ERROR(target, "Failed to resume!");
 		return res;
 	}
 
-	target->debug_reason = DBG_REASON_NOTHALTED;
-	if (!debug_execution)
-		target->state = TARGET_RUNNING;
-	else
-		target->state = TARGET_DEBUG_RUNNING;
-
-	target_call_event_callbacks(target, TARGET_EVENT_RESUMED);
+	if (target->smp) {
+		foreach_smp_target(head, target->smp_targets) {
+			struct target *curr = head->target;
+			if (esp_xtensa_smp_resumes_with(target, curr)) {
+				xtensa_core_status_check(curr);
+				esp_xtensa_smp_set_resumed(curr, debug_execution);
+			}
+		}
+	}
+	xtensa_core_status_check(target);
+	esp_xtensa_smp_set_resumed(target, debug_execution);
 	return ERROR_OK;
 }
 
+int esp_xtensa_smp_halt(struct target *target)
+{
+	struct target_list *head;
+	unsigned int i;
+	bool halt_queued = false;
+
+	if (!target->smp || target->smp_nonstop)
+		return xtensa_halt(target);
+
+	LOG_TARGET_DEBUG(target, "begin");
+
+	uint8_t (*dsr_bufs)[sizeof(uint32_t)] = calloc(list_count_nodes(target->smp_targets), sizeof(*dsr_bufs));
+	if (!dsr_bufs) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	/* read DSR of all running cores at once, then stop the ones which are not stopped yet at once */
+	i = 0;
+	foreach_smp_target(head, target->smp_targets) {
+		struct target *curr = head->target;
+		if (target_was_examined(curr) && curr->state != TARGET_HALTED)
+			xtensa_dm_queue_core_status_read(&target_to_xtensa(curr)->dbg_mod, dsr_bufs[i]);
+		i++;
+	}
+	int res = esp_xtensa_smp_queue_execute(target);
+	if (res != ERROR_OK) {
+		LOG_TARGET_ERROR(target, "Failed to read core status!");
+		goto esp_xtensa_smp_halt_done;
+	}
+
+	i = 0;
+	foreach_smp_target(head, target->smp_targets) {
+		struct target *curr = head->target;
+		struct xtensa_debug_module *dm = &target_to_xtensa(curr)->dbg_mod;
+		if (target_was_examined(curr) && curr->state != TARGET_HALTED) {
+			xtensa_dm_core_status_update(dm, dsr_bufs[i]);
+			LOG_TARGET_DEBUG(curr, "Core status 0x%" PRIx32, xtensa_dm_core_status_get(dm));
+			if (!(xtensa_dm_core_status_get(dm) & OCDDSR_STOPPED)) {
+				xtensa_queue_halt(curr);
+				halt_queued = true;
+			}
+		}
+		i++;
+	}
+	if (halt_queued) {
+		res = esp_xtensa_smp_queue_execute(target);
+		if (res != ERROR_OK)
+			LOG_TARGET_ERROR(target, "Failed to set OCDDCR_DEBUGINTERRUPT. Can't halt.");
+	}
+
+esp_xtensa_smp_halt_done:
+	free(dsr_bufs);
+	return res;
+}
+
 int esp_xtensa_smp_step(struct target *target,
 	bool current,
 	target_addr_t address,
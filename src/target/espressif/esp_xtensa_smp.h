@@ -26,6 +26,7 @@ struct esp_xtensa_smp_common {
 };
 
 int esp_xtensa_smp_poll(struct target *target);
+int esp_xtensa_smp_halt(struct target *target);
 int esp_xtensa_smp_resume(struct target *target,
 	bool current,
 	target_addr_t address,
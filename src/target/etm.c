@@ -844,17 +844,47 @@ static int etmv1_data(struct etm_context *ctx, int size, uint32_t *data)
 	return 0;
 }
 
-static int etmv1_analyze_trace(struct etm_context *ctx, struct command_invocation *cmd)
+/* decoded trace goes either to the command output, or line by line to
+ * a file so that long captures are not accumulated in the command result
+ */
+static void etm_trace_print(struct command_invocation *cmd, FILE *out,
+		const char *format, ...)
+__attribute__ ((format (PRINTF_ATTRIBUTE_FORMAT, 3, 4)));
+
+static void etm_trace_print(struct command_invocation *cmd, FILE *out,
+		const char *format, ...)
+{
+	va_list ap;
+
+	va_start(ap, format);
+	if (out) {
+		vfprintf(out, format, ap);
+		fputc('\n', out);
+	} else {
+		char *string = alloc_vprintf(format, ap);
+		if (string) {
+			command_print(cmd, "%s", string);
+			free(string);
+		}
+	}
+	va_end(ap);
+}
+
+static int etmv1_analyze_trace(struct etm_context *ctx, struct command_invocation *cmd,
+		FILE *out)
 {
 	int retval;
 	struct arm_instruction instruction;
 
 	/* read the trace data if it wasn't read already */
-	if (ctx->trace_depth == 0)
-		ctx->capture_driver->read_trace(ctx);
+	if (ctx->trace_depth == 0) {
+		retval = ctx->capture_driver->read_trace(ctx);
+		if (retval != ERROR_OK)
+			return retval;
+	}
 
 	if (ctx->trace_depth == 0) {
-		command_print(cmd, "Trace is empty.");
+		etm_trace_print(cmd, out, "Trace is empty.");
 		return ERROR_OK;
 	}
 
@@ -878,7 +908,7 @@ static int etmv1_analyze_trace(struct etm_context *ctx, struct command_invocatio
 		int current_pc_ok = ctx->pc_ok;
 
 		if (ctx->trace_data[ctx->pipe_index].flags & ETMV1_TRIGGER_CYCLE)
-			command_print(cmd, "--- trigger ---");
+			etm_trace_print(cmd, out, "--- trigger ---");
 
 		/* instructions execute in IE/D or BE/D cycles */
 		if ((pipestat == STAT_IE) || (pipestat == STAT_ID))
@@ -927,7 +957,7 @@ static int etmv1_analyze_trace(struct etm_context *ctx, struct command_invocatio
 					next_pc = ctx->last_branch;
 					break;
 				case 0x1:	/* tracing enabled */
-					command_print(cmd,
+					etm_trace_print(cmd, out,
 						"--- tracing enabled at 0x%8.8" PRIx32 " ---",
 						ctx->last_branch);
 					ctx->current_pc = ctx->last_branch;
@@ -935,7 +965,7 @@ static int etmv1_analyze_trace(struct etm_context *ctx, struct command_invocatio
 					continue;
 					break;
 				case 0x2:	/* trace restarted after FIFO overflow */
-					command_print(cmd,
+					etm_trace_print(cmd, out,
 						"--- trace restarted after FIFO overflow at 0x%8.8" PRIx32 " ---",
 						ctx->last_branch);
 					ctx->current_pc = ctx->last_branch;
@@ -943,7 +973,7 @@ static int etmv1_analyze_trace(struct etm_context *ctx, struct command_invocatio
 					continue;
 					break;
 				case 0x3:	/* exit from debug state */
-					command_print(cmd,
+					etm_trace_print(cmd, out,
 						"--- exit from debug state at 0x%8.8" PRIx32 " ---",
 						ctx->last_branch);
 					ctx->current_pc = ctx->last_branch;
@@ -956,7 +986,7 @@ static int etmv1_analyze_trace(struct etm_context *ctx, struct command_invocatio
 					 * we have to move on with the next trace cycle
 					 */
 					if (!current_pc_ok) {
-						command_print(cmd,
+						etm_trace_print(cmd, out,
 							"--- periodic synchronization point at 0x%8.8" PRIx32 " ---",
 							next_pc);
 						ctx->current_pc = next_pc;
@@ -983,9 +1013,9 @@ static int etmv1_analyze_trace(struct etm_context *ctx, struct command_invocatio
 				|| ((ctx->last_branch >= 0xffff0000) &&
 				(ctx->last_branch <= 0xffff0020))) {
 				if ((ctx->last_branch & 0xff) == 0x10)
-					command_print(cmd, "data abort");
+					etm_trace_print(cmd, out, "data abort");
 				else {
-					command_print(cmd,
+					etm_trace_print(cmd, out,
 						"exception vector 0x%2.2" PRIx32 "",
 						ctx->last_branch);
 					ctx->current_pc = ctx->last_branch;
@@ -1043,7 +1073,7 @@ static int etmv1_analyze_trace(struct etm_context *ctx, struct command_invocatio
 					ctx->ptr_ok = 1;
 
 				if (ctx->ptr_ok)
-					command_print(cmd,
+					etm_trace_print(cmd, out,
 						"address: 0x%8.8" PRIx32 "",
 						ctx->last_ptr);
 			}
@@ -1058,7 +1088,7 @@ static int etmv1_analyze_trace(struct etm_context *ctx, struct command_invocatio
 							uint32_t data;
 							if (etmv1_data(ctx, 4, &data) != 0)
 								return ERROR_ETM_ANALYSIS_FAILED;
-							command_print(cmd,
+							etm_trace_print(cmd, out,
 								"data: 0x%8.8" PRIx32 "",
 								data);
 						}
@@ -1069,7 +1099,7 @@ static int etmv1_analyze_trace(struct etm_context *ctx, struct command_invocatio
 					if (etmv1_data(ctx, arm_access_size(&instruction),
 						&data) != 0)
 						return ERROR_ETM_ANALYSIS_FAILED;
-					command_print(cmd, "data: 0x%8.8" PRIx32 "", data);
+					etm_trace_print(cmd, out, "data: 0x%8.8" PRIx32 "", data);
 				}
 			}
 
@@ -1104,7 +1134,7 @@ static int etmv1_analyze_trace(struct etm_context *ctx, struct command_invocatio
 					(cycles == 1) ? "cycle" : "cycles");
 			}
 
-			command_print(cmd, "%s%s%s",
+			etm_trace_print(cmd, out, "%s%s%s",
 				instruction.text,
 				(pipestat == STAT_IN) ? " (not executed)" : "",
 				cycles_text);
@@ -1966,7 +1996,20 @@ COMMAND_HANDLER(handle_etm_analyze_command)
 		return ERROR_FAIL;
 	}
 
-	retval = etmv1_analyze_trace(etm_ctx, CMD);
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	FILE *out = NULL;
+	if (CMD_ARGC == 1) {
+		out = fopen(CMD_ARGV[0], "w");
+		if (!out) {
+			command_print(CMD, "failed to open '%s' for writing", CMD_ARGV[0]);
+			return ERROR_FAIL;
+		}
+	}
+
+	retval = etmv1_analyze_trace(etm_ctx, CMD, out);
+
 	if (retval != ERROR_OK) {
 		/* FIX! error should be reported inside etmv1_analyze_trace() */
 		switch (retval) {
@@ -1986,6 +2029,13 @@ COMMAND_HANDLER(handle_etm_analyze_command)
 		}
 	}
 
+	if (out) {
+		if (fclose(out) != 0 && retval == ERROR_OK) {
+			command_print(CMD, "failed to write '%s'", CMD_ARGV[0]);
+			retval = ERROR_FAIL;
+		}
+	}
+
 	return retval;
 }
 
@@ -2065,8 +2115,8 @@ static const struct command_registration etm_exec_command_handlers[] = {
 		.name = "analyze",
 		.handler = handle_etm_analyze_command,
 		.mode = COMMAND_EXEC,
-		.usage = "",
-		.help = "analyze collected ETM trace",
+		.usage = "[filename]",
+		.help = "analyze collected ETM trace, optionally into a file",
 	},
 	{
 		.name = "image",
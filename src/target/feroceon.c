@@ -608,6 +608,9 @@ static void feroceon_common_setup(struct target *target)
 	arm7_9->disable_single_step = feroceon_disable_single_step;
 
 	arm7_9->bulk_write_memory = feroceon_bulk_write_memory;
+	/* the arm7_9 DCC upload loader shares dcc_working_area with the
+	 * different code of feroceon_bulk_write_memory() */
+	arm7_9->bulk_read_memory = NULL;
 
 	/* MOE is not implemented */
 	arm7_9->examine_debug_reason = feroceon_examine_debug_reason;
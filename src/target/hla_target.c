@@ -210,11 +210,54 @@ static int adapter_target_create(struct target *target,
 	return ERROR_OK;
 }
 
+/* 32-bit words needed to transfer a register cache entry */
+static unsigned int adapter_reg_words(const struct reg *r)
+{
+	return r->size == 64 ? 2 : 1;
+}
+
 static int adapter_load_context(struct target *target)
 {
+	struct hl_interface *adapter = target_to_adapter(target);
 	struct armv7m_common *armv7m = target_to_armv7m(target);
-	int num_regs = armv7m->arm.core_cache->num_regs;
+	struct reg_cache *cache = armv7m->arm.core_cache;
+	int num_regs = cache->num_regs;
+
+	/* fetch every unpacked register with one batch request */
+	unsigned int *regsel = calloc(2 * num_regs, sizeof(*regsel));
+	uint32_t *val = calloc(2 * num_regs, sizeof(*val));
+	if (regsel && val) {
+		unsigned int count = 0;
+
+		for (int i = 0; i < num_regs; i++) {
+			struct reg *r = &cache->reg_list[i];
+			if (!r->exist || r->valid || r->size <= 8)
+				continue;
+
+			struct arm_reg *arm_reg = r->arch_info;
+			uint32_t sel = armv7m_map_id_to_regsel(arm_reg->num);
+			for (unsigned int w = 0; w < adapter_reg_words(r); w++)
+				regsel[count++] = sel + w;
+		}
 
+		if (hl_layout_read_regs(adapter, regsel, val, count) == ERROR_OK) {
+			count = 0;
+			for (int i = 0; i < num_regs; i++) {
+				struct reg *r = &cache->reg_list[i];
+				if (!r->exist || r->valid || r->size <= 8)
+					continue;
+
+				for (unsigned int w = 0; w < adapter_reg_words(r); w++)
+					buf_set_u32(r->value + 4 * w, 0, 32, val[count++]);
+				r->valid = true;
+				r->dirty = false;
+			}
+		}
+	}
+	free(regsel);
+	free(val);
+
+	/* packed registers, and anything the batch failed to read */
 	for (int i = 0; i < num_regs; i++) {
 
 		struct reg *r = &armv7m->arm.core_cache->reg_list[i];
@@ -225,6 +268,67 @@ static int adapter_load_context(struct target *target)
 	return ERROR_OK;
 }
 
+static int adapter_restore_context(struct target *target)
+{
+	struct hl_interface *adapter = target_to_adapter(target);
+	struct armv7m_common *armv7m = target_to_armv7m(target);
+	struct reg_cache *cache = armv7m->arm.core_cache;
+	int num_regs = cache->num_regs;
+	int retval;
+
+	/* merge the packed registers into their 32-bit containers first, in
+	 * descending order as armv7m_restore_context() does */
+	for (int i = num_regs - 1; i >= 0; i--) {
+		struct reg *r = &cache->reg_list[i];
+
+		if (r->exist && r->dirty && r->size <= 8) {
+			retval = armv7m->arm.write_core_reg(target, r, i, ARM_MODE_ANY, r->value);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+	}
+
+	unsigned int *regsel = calloc(2 * num_regs, sizeof(*regsel));
+	uint32_t *val = calloc(2 * num_regs, sizeof(*val));
+	if (!regsel || !val) {
+		free(regsel);
+		free(val);
+		return armv7m_restore_context(target);
+	}
+
+	unsigned int count = 0;
+	for (int i = num_regs - 1; i >= 0; i--) {
+		struct reg *r = &cache->reg_list[i];
+		if (!r->exist || !r->dirty)
+			continue;
+
+		struct arm_reg *arm_reg = r->arch_info;
+		uint32_t sel = armv7m_map_id_to_regsel(arm_reg->num);
+		for (unsigned int w = 0; w < adapter_reg_words(r); w++) {
+			regsel[count] = sel + w;
+			val[count++] = buf_get_u32(r->value + 4 * w, 0, 32);
+		}
+	}
+
+	retval = hl_layout_write_regs(adapter, regsel, val, count);
+	free(regsel);
+	free(val);
+	if (retval != ERROR_OK) {
+		LOG_TARGET_ERROR(target, "Error restoring the core registers");
+		return retval;
+	}
+
+	for (int i = 0; i < num_regs; i++) {
+		struct reg *r = &cache->reg_list[i];
+		if (r->exist && r->dirty) {
+			r->valid = true;
+			r->dirty = false;
+		}
+	}
+
+	return ERROR_OK;
+}
+
 static int adapter_debug_entry(struct target *target)
 {
 	struct hl_interface *adapter = target_to_adapter(target);
@@ -479,7 +583,7 @@ static int adapter_resume(struct target *target, bool current,
 	if (res != ERROR_OK)
 		return res;
 
-	armv7m_restore_context(target);
+	adapter_restore_context(target);
 
 	/* restore SAVED_DCRDR */
 	res = target_write_u32(target, DCB_DCRDR, target->SAVED_DCRDR);
@@ -562,7 +666,7 @@ static int adapter_step(struct target *target, bool current,
 
 	target->debug_reason = DBG_REASON_SINGLESTEP;
 
-	armv7m_restore_context(target);
+	adapter_restore_context(target);
 
 	/* restore SAVED_DCRDR */
 	res = target_write_u32(target, DCB_DCRDR, target->SAVED_DCRDR);
@@ -666,6 +770,7 @@ struct target_type hla_target = {
 	.write_memory = adapter_write_memory,
 	.checksum_memory = armv7m_checksum_memory,
 	.blank_check_memory = armv7m_blank_check_memory,
+	.fill_memory = armv7m_fill_memory,
 
 	.run_algorithm = armv7m_run_algorithm,
 	.start_algorithm = armv7m_start_algorithm,
@@ -23,6 +23,8 @@
 
 #include "image.h"
 #include "target.h"
+#include <helper/crc32.h>
+#include <helper/fileio.h>
 #include <helper/log.h>
 #include <server/server.h>
 
@@ -119,6 +121,66 @@ static int identify_image_type(struct image *image, const char *type_string, con
 	return ERROR_OK;
 }
 
+/* Value + 1 of the hex digits, 0 for any other character including the end of the line */
+static const uint8_t image_hex_digit[256] = {
+	['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5,
+	['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+	['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+	['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+};
+
+/* Decodes the two hex digits of a byte, -1 if they are not hex digits */
+static inline int image_hex_byte(const char *str)
+{
+	unsigned int high = image_hex_digit[(uint8_t)str[0]];
+	if (!high)
+		return -1;
+	unsigned int low = image_hex_digit[(uint8_t)str[1]];
+	if (!low)
+		return -1;
+	return ((high - 1) << 4) | (low - 1);
+}
+
+/**
+ * Decodes a big endian field of @a num_bytes bytes from the hex digits of a
+ * record and adds its bytes to the record checksum. The decoding stops at the
+ * first character that is no hex digit, the end of a short record included.
+ */
+static int image_hex_field(const char *str, unsigned int num_bytes,
+	uint32_t *value, uint8_t *checksum)
+{
+	uint32_t field = 0;
+
+	for (unsigned int i = 0; i < num_bytes; i++) {
+		int byte = image_hex_byte(&str[2 * i]);
+		if (byte < 0)
+			return ERROR_IMAGE_FORMAT_ERROR;
+		*checksum += byte;
+		field = (field << 8) | byte;
+	}
+
+	*value = field;
+	return ERROR_OK;
+}
+
+/* Decodes the data bytes of a record into @a buffer, same as image_hex_field() */
+static int image_hex_data(const char *str, unsigned int num_bytes,
+	uint8_t *buffer, uint8_t *checksum)
+{
+	uint8_t sum = *checksum;
+
+	for (unsigned int i = 0; i < num_bytes; i++) {
+		int byte = image_hex_byte(&str[2 * i]);
+		if (byte < 0)
+			return ERROR_IMAGE_FORMAT_ERROR;
+		buffer[i] = byte;
+		sum += byte;
+	}
+
+	*checksum = sum;
+	return ERROR_OK;
+}
+
 static int image_ihex_buffer_complete_inner(struct image *image,
 	char *lpsz_line,
 	struct imagesection *section)
@@ -161,16 +223,13 @@ static int image_ihex_buffer_complete_inner(struct image *image,
 			if ((lpsz_line[0] == '#') || (strlen(lpsz_line + strspn(lpsz_line, "\n\t\r ")) == 0))
 				continue;
 
-			if (sscanf(&lpsz_line[bytes_read], ":%2" SCNx32 "%4" SCNx32 "%2" SCNx32, &count,
-				&address, &record_type) != 3)
+			if (lpsz_line[0] != ':' ||
+					image_hex_field(&lpsz_line[1], 1, &count, &cal_checksum) != ERROR_OK ||
+					image_hex_field(&lpsz_line[3], 2, &address, &cal_checksum) != ERROR_OK ||
+					image_hex_field(&lpsz_line[7], 1, &record_type, &cal_checksum) != ERROR_OK)
 				return ERROR_IMAGE_FORMAT_ERROR;
 			bytes_read += 9;
 
-			cal_checksum += (uint8_t)count;
-			cal_checksum += (uint8_t)(address >> 8);
-			cal_checksum += (uint8_t)address;
-			cal_checksum += (uint8_t)record_type;
-
 			if (record_type == 0) {	/* Data Record */
 				if ((full_address & 0xffff) != address) {
 					/* we encountered a nonconsecutive location, create a new section,
@@ -194,16 +253,15 @@ static int image_ihex_buffer_complete_inner(struct image *image,
 					full_address = (full_address & 0xffff0000) | address;
 				}
 
-				while (count-- > 0) {
-					unsigned int value;
-					sscanf(&lpsz_line[bytes_read], "%2x", &value);
-					ihex->buffer[cooked_bytes] = (uint8_t)value;
-					cal_checksum += (uint8_t)ihex->buffer[cooked_bytes];
-					bytes_read += 2;
-					cooked_bytes += 1;
-					section[image->num_sections].size += 1;
-					full_address++;
+				if (image_hex_data(&lpsz_line[bytes_read], count,
+						&ihex->buffer[cooked_bytes], &cal_checksum) != ERROR_OK) {
+					LOG_ERROR("invalid data record found in IHEX file");
+					return ERROR_IMAGE_FORMAT_ERROR;
 				}
+				bytes_read += 2 * count;
+				cooked_bytes += count;
+				section[image->num_sections].size += count;
+				full_address += count;
 			} else if (record_type == 1) {	/* End of File Record */
 				/* finish the current section */
 				image->num_sections++;
@@ -220,11 +278,11 @@ static int image_ihex_buffer_complete_inner(struct image *image,
 				end_rec = true;
 				break;
 			} else if (record_type == 2) {	/* Linear Address Record */
-				uint16_t upper_address;
+				uint32_t upper_address;
 
-				sscanf(&lpsz_line[bytes_read], "%4hx", &upper_address);
-				cal_checksum += (uint8_t)(upper_address >> 8);
-				cal_checksum += (uint8_t)upper_address;
+				if (image_hex_field(&lpsz_line[bytes_read], 2, &upper_address,
+						&cal_checksum) != ERROR_OK)
+					return ERROR_IMAGE_FORMAT_ERROR;
 				bytes_read += 4;
 
 				if ((full_address >> 4) != upper_address) {
@@ -254,16 +312,17 @@ static int image_ihex_buffer_complete_inner(struct image *image,
 				/* "Start Segment Address Record" will not be supported
 				 * but we must consume it, and do not create an error.  */
 				while (count-- > 0) {
-					sscanf(&lpsz_line[bytes_read], "%2" SCNx32, &dummy);
-					cal_checksum += (uint8_t)dummy;
+					if (image_hex_field(&lpsz_line[bytes_read], 1, &dummy,
+							&cal_checksum) != ERROR_OK)
+						return ERROR_IMAGE_FORMAT_ERROR;
 					bytes_read += 2;
 				}
 			} else if (record_type == 4) {	/* Extended Linear Address Record */
-				uint16_t upper_address;
+				uint32_t upper_address;
 
-				sscanf(&lpsz_line[bytes_read], "%4hx", &upper_address);
-				cal_checksum += (uint8_t)(upper_address >> 8);
-				cal_checksum += (uint8_t)upper_address;
+				if (image_hex_field(&lpsz_line[bytes_read], 2, &upper_address,
+						&cal_checksum) != ERROR_OK)
+					return ERROR_IMAGE_FORMAT_ERROR;
 				bytes_read += 4;
 
 				if ((full_address >> 16) != upper_address) {
@@ -290,11 +349,9 @@ static int image_ihex_buffer_complete_inner(struct image *image,
 			} else if (record_type == 5) {	/* Start Linear Address Record */
 				uint32_t start_address;
 
-				sscanf(&lpsz_line[bytes_read], "%8" SCNx32, &start_address);
-				cal_checksum += (uint8_t)(start_address >> 24);
-				cal_checksum += (uint8_t)(start_address >> 16);
-				cal_checksum += (uint8_t)(start_address >> 8);
-				cal_checksum += (uint8_t)start_address;
+				if (image_hex_field(&lpsz_line[bytes_read], 4, &start_address,
+						&cal_checksum) != ERROR_OK)
+					return ERROR_IMAGE_FORMAT_ERROR;
 				bytes_read += 8;
 
 				image->start_address_set = true;
@@ -304,9 +361,9 @@ static int image_ihex_buffer_complete_inner(struct image *image,
 				return ERROR_IMAGE_FORMAT_ERROR;
 			}
 
-			sscanf(&lpsz_line[bytes_read], "%2" SCNx32, &checksum);
-
-			if ((uint8_t)checksum != (uint8_t)(~cal_checksum + 1)) {
+			/* the checksum byte brings the sum of the record to zero */
+			if (image_hex_field(&lpsz_line[bytes_read], 1, &checksum,
+					&cal_checksum) != ERROR_OK || cal_checksum != 0) {
 				/* checksum failed */
 				LOG_ERROR("incorrect record checksum found in IHEX file");
 				return ERROR_IMAGE_CHECKSUM;
@@ -354,6 +411,20 @@ static int image_ihex_buffer_complete(struct image *image)
 	return retval;
 }
 
+/**
+ * Tells if a loadable segment directly follows the section before it, both
+ * in memory and in the ELF file. The section is then extended over the
+ * segment: linkers often emit one segment per output section, and reading
+ * and writing them as one saves a transfer per segment.
+ */
+static bool image_elf_section_extends(const struct imagesection *section,
+	uint64_t section_offset, target_addr_t base_address, uint64_t offset, uint64_t size)
+{
+	return section->base_address + section->size == base_address &&
+		section_offset + section->size == offset &&
+		section->size + size <= UINT32_MAX;
+}
+
 static int image_elf32_read_headers(struct image *image)
 {
 	struct image_elf *elf = image->type_private;
@@ -460,18 +531,29 @@ static int image_elf32_read_headers(struct image *image)
 		if ((field32(elf,
 			elf->segments32[i].p_type) == PT_LOAD) &&
 			(field32(elf, elf->segments32[i].p_filesz) != 0)) {
-			image->sections[j].size = field32(elf, elf->segments32[i].p_filesz);
+			target_addr_t base_address;
 			if (load_to_vaddr)
-				image->sections[j].base_address = field32(elf,
-						elf->segments32[i].p_vaddr);
+				base_address = field32(elf, elf->segments32[i].p_vaddr);
 			else
-				image->sections[j].base_address = field32(elf,
-						elf->segments32[i].p_paddr);
+				base_address = field32(elf, elf->segments32[i].p_paddr);
+
+			if (j > 0 && image_elf_section_extends(&image->sections[j - 1],
+					field32(elf, ((Elf32_Phdr *)image->sections[j - 1].private)->p_offset),
+					base_address, field32(elf, elf->segments32[i].p_offset),
+					field32(elf, elf->segments32[i].p_filesz))) {
+				image->sections[j - 1].size += field32(elf, elf->segments32[i].p_filesz);
+				image->sections[j - 1].flags |= field32(elf, elf->segments32[i].p_flags);
+				continue;
+			}
+
+			image->sections[j].size = field32(elf, elf->segments32[i].p_filesz);
+			image->sections[j].base_address = base_address;
 			image->sections[j].private = &elf->segments32[i];
 			image->sections[j].flags = field32(elf, elf->segments32[i].p_flags);
 			j++;
 		}
 	}
+	image->num_sections = j;
 
 	image->start_address_set = true;
 	image->start_address = field32(elf, elf->header32->e_entry);
@@ -585,18 +667,29 @@ static int image_elf64_read_headers(struct image *image)
 		if ((field32(elf,
 			elf->segments64[i].p_type) == PT_LOAD) &&
 			(field64(elf, elf->segments64[i].p_filesz) != 0)) {
-			image->sections[j].size = field64(elf, elf->segments64[i].p_filesz);
+			target_addr_t base_address;
 			if (load_to_vaddr)
-				image->sections[j].base_address = field64(elf,
-						elf->segments64[i].p_vaddr);
+				base_address = field64(elf, elf->segments64[i].p_vaddr);
 			else
-				image->sections[j].base_address = field64(elf,
-						elf->segments64[i].p_paddr);
+				base_address = field64(elf, elf->segments64[i].p_paddr);
+
+			if (j > 0 && image_elf_section_extends(&image->sections[j - 1],
+					field64(elf, ((Elf64_Phdr *)image->sections[j - 1].private)->p_offset),
+					base_address, field64(elf, elf->segments64[i].p_offset),
+					field64(elf, elf->segments64[i].p_filesz))) {
+				image->sections[j - 1].size += field64(elf, elf->segments64[i].p_filesz);
+				image->sections[j - 1].flags |= field64(elf, elf->segments64[i].p_flags);
+				continue;
+			}
+
+			image->sections[j].size = field64(elf, elf->segments64[i].p_filesz);
+			image->sections[j].base_address = base_address;
 			image->sections[j].private = &elf->segments64[i];
 			image->sections[j].flags = field64(elf, elf->segments64[i].p_flags);
 			j++;
 		}
 	}
+	image->num_sections = j;
 
 	image->start_address_set = true;
 	image->start_address = field64(elf, elf->header64->e_entry);
@@ -667,9 +760,9 @@ static int image_elf32_read_section(struct image *image,
 	LOG_DEBUG("load segment %d at 0x%" TARGET_PRIxADDR " (sz = 0x%" PRIx32 ")", section, offset, size);
 
 	/* read initialized data in current segment if any */
-	if (offset < field32(elf, segment->p_filesz)) {
-		/* maximal size present in file for the current segment */
-		read_size = MIN(size, field32(elf, segment->p_filesz) - offset);
+	if (offset < image->sections[section].size) {
+		/* maximal size present in file for the current section */
+		read_size = MIN(size, image->sections[section].size - offset);
 		LOG_DEBUG("read elf: size = 0x%zx at 0x%" TARGET_PRIxADDR "", read_size,
 			field32(elf, segment->p_offset) + offset);
 		/* read initialized area of the segment */
@@ -710,9 +803,9 @@ static int image_elf64_read_section(struct image *image,
 	LOG_DEBUG("load segment %d at 0x%" TARGET_PRIxADDR " (sz = 0x%" PRIx32 ")", section, offset, size);
 
 	/* read initialized data in current segment if any */
-	if (offset < field64(elf, segment->p_filesz)) {
-		/* maximal size present in file for the current segment */
-		read_size = MIN(size, field64(elf, segment->p_filesz) - offset);
+	if (offset < image->sections[section].size) {
+		/* maximal size present in file for the current section */
+		read_size = MIN(size, image->sections[section].size - offset);
 		LOG_DEBUG("read elf: size = 0x%zx at 0x%" TARGET_PRIxADDR "", read_size,
 			field64(elf, segment->p_offset) + offset);
 		/* read initialized area of the segment */
@@ -794,53 +887,51 @@ static int image_mot_buffer_complete_inner(struct image *image,
 				continue;
 
 			/* get record type and record length */
-			if (sscanf(&lpsz_line[bytes_read], "S%1" SCNx32 "%2" SCNx32, &record_type,
-				&count) != 2)
+			if (lpsz_line[0] != 'S' || !image_hex_digit[(uint8_t)lpsz_line[1]] ||
+					image_hex_field(&lpsz_line[2], 1, &count, &cal_checksum) != ERROR_OK)
 				return ERROR_IMAGE_FORMAT_ERROR;
+			record_type = image_hex_digit[(uint8_t)lpsz_line[1]] - 1;
 
 			bytes_read += 4;
-			cal_checksum += (uint8_t)count;
 
 			/* skip checksum byte */
 			count -= 1;
 
 			if (record_type == 0) {
 				/* S0 - starting record (optional) */
-				int value;
+				uint32_t value;
 
 				while (count-- > 0) {
-					sscanf(&lpsz_line[bytes_read], "%2x", &value);
-					cal_checksum += (uint8_t)value;
+					if (image_hex_field(&lpsz_line[bytes_read], 1, &value,
+							&cal_checksum) != ERROR_OK)
+						return ERROR_IMAGE_FORMAT_ERROR;
 					bytes_read += 2;
 				}
 			} else if (record_type >= 1 && record_type <= 3) {
 				switch (record_type) {
 					case 1:
 						/* S1 - 16 bit address data record */
-						sscanf(&lpsz_line[bytes_read], "%4" SCNx32, &address);
-						cal_checksum += (uint8_t)(address >> 8);
-						cal_checksum += (uint8_t)address;
+						if (image_hex_field(&lpsz_line[bytes_read], 2, &address,
+								&cal_checksum) != ERROR_OK)
+							return ERROR_IMAGE_FORMAT_ERROR;
 						bytes_read += 4;
 						count -= 2;
 						break;
 
 					case 2:
 						/* S2 - 24 bit address data record */
-						sscanf(&lpsz_line[bytes_read], "%6" SCNx32, &address);
-						cal_checksum += (uint8_t)(address >> 16);
-						cal_checksum += (uint8_t)(address >> 8);
-						cal_checksum += (uint8_t)address;
+						if (image_hex_field(&lpsz_line[bytes_read], 3, &address,
+								&cal_checksum) != ERROR_OK)
+							return ERROR_IMAGE_FORMAT_ERROR;
 						bytes_read += 6;
 						count -= 3;
 						break;
 
 					case 3:
 						/* S3 - 32 bit address data record */
-						sscanf(&lpsz_line[bytes_read], "%8" SCNx32, &address);
-						cal_checksum += (uint8_t)(address >> 24);
-						cal_checksum += (uint8_t)(address >> 16);
-						cal_checksum += (uint8_t)(address >> 8);
-						cal_checksum += (uint8_t)address;
+						if (image_hex_field(&lpsz_line[bytes_read], 4, &address,
+								&cal_checksum) != ERROR_OK)
+							return ERROR_IMAGE_FORMAT_ERROR;
 						bytes_read += 8;
 						count -= 4;
 						break;
@@ -863,23 +954,23 @@ static int image_mot_buffer_complete_inner(struct image *image,
 					full_address = address;
 				}
 
-				while (count-- > 0) {
-					unsigned int value;
-					sscanf(&lpsz_line[bytes_read], "%2x", &value);
-					mot->buffer[cooked_bytes] = (uint8_t)value;
-					cal_checksum += (uint8_t)mot->buffer[cooked_bytes];
-					bytes_read += 2;
-					cooked_bytes += 1;
-					section[image->num_sections].size += 1;
-					full_address++;
+				if (image_hex_data(&lpsz_line[bytes_read], count,
+						&mot->buffer[cooked_bytes], &cal_checksum) != ERROR_OK) {
+					LOG_ERROR("invalid data record found in S19 file");
+					return ERROR_IMAGE_FORMAT_ERROR;
 				}
+				bytes_read += 2 * count;
+				cooked_bytes += count;
+				section[image->num_sections].size += count;
+				full_address += count;
 			} else if (record_type == 5 || record_type == 6) {
 				/* S5 and S6 are the data count records, we ignore them */
 				uint32_t dummy;
 
 				while (count-- > 0) {
-					sscanf(&lpsz_line[bytes_read], "%2" SCNx32, &dummy);
-					cal_checksum += (uint8_t)dummy;
+					if (image_hex_field(&lpsz_line[bytes_read], 1, &dummy,
+							&cal_checksum) != ERROR_OK)
+						return ERROR_IMAGE_FORMAT_ERROR;
 					bytes_read += 2;
 				}
 			} else if (record_type >= 7 && record_type <= 9) {
@@ -903,10 +994,8 @@ static int image_mot_buffer_complete_inner(struct image *image,
 			}
 
 			/* account for checksum, will always be 0xFF */
-			sscanf(&lpsz_line[bytes_read], "%2" SCNx32, &checksum);
-			cal_checksum += (uint8_t)checksum;
-
-			if (cal_checksum != 0xFF) {
+			if (image_hex_field(&lpsz_line[bytes_read], 1, &checksum,
+					&cal_checksum) != ERROR_OK || cal_checksum != 0xFF) {
 				/* checksum failed */
 				LOG_ERROR("incorrect record checksum found in S19 file");
 				return ERROR_IMAGE_CHECKSUM;
@@ -1171,6 +1260,64 @@ int image_read_section(struct image *image,
 	return ERROR_OK;
 }
 
+/**
+ * Gives access to the content of a section without copying it: into the
+ * mapping of the file for binary and ELF images, into the parsed data
+ * for the image types held in memory. Valid until the image is closed.
+ *
+ * @returns ERROR_FILEIO_OPERATION_NOT_SUPPORTED when the content is not
+ * available in place (target memory image, file that cannot be mapped),
+ * the caller then uses image_read_section().
+ */
+int image_section_map(struct image *image, int section, target_addr_t offset,
+		uint32_t size, const uint8_t **data)
+{
+	const uint8_t *map;
+	uint64_t file_offset;
+
+	if (offset + size > image->sections[section].size)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	switch (image->type) {
+	case IMAGE_BINARY: {
+		struct image_binary *image_binary = image->type_private;
+		int retval = fileio_map(image_binary->fileio, &map);
+		if (retval != ERROR_OK)
+			return retval;
+		*data = map + offset;
+		return ERROR_OK;
+	}
+	case IMAGE_ELF: {
+		struct image_elf *elf = image->type_private;
+		if (elf->is_64_bit) {
+			Elf64_Phdr *segment = image->sections[section].private;
+			file_offset = field64(elf, segment->p_offset);
+		} else {
+			Elf32_Phdr *segment = image->sections[section].private;
+			file_offset = field32(elf, segment->p_offset);
+		}
+		int retval = fileio_map(elf->fileio, &map);
+		if (retval != ERROR_OK)
+			return retval;
+		size_t map_size;
+		fileio_size(elf->fileio, &map_size);
+		if (file_offset + offset + size > map_size) {
+			LOG_ERROR("ELF segment %d beyond the end of the file", section);
+			return ERROR_IMAGE_FORMAT_ERROR;
+		}
+		*data = map + file_offset + offset;
+		return ERROR_OK;
+	}
+	case IMAGE_IHEX:
+	case IMAGE_SRECORD:
+	case IMAGE_BUILDER:
+		*data = (const uint8_t *)image->sections[section].private + offset;
+		return ERROR_OK;
+	default:
+		return ERROR_FILEIO_OPERATION_NOT_SUPPORTED;
+	}
+}
+
 int image_add_section(struct image *image, target_addr_t base, uint32_t size, uint64_t flags, uint8_t const *data)
 {
 	struct imagesection *section;
@@ -1208,6 +1355,47 @@ int image_add_section(struct image *image, target_addr_t base, uint32_t size, ui
 	return ERROR_OK;
 }
 
+/* Move the data below addr from builder image into builder image head,
+ * trimming or dropping the sections it came from */
+int image_split_below(struct image *image, target_addr_t addr, struct image *head)
+{
+	unsigned int keep = 0;
+	int retval = ERROR_OK;
+
+	if (image->type != IMAGE_BUILDER || head->type != IMAGE_BUILDER)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	for (unsigned int i = 0; i < image->num_sections; i++) {
+		struct imagesection *section = &image->sections[i];
+
+		if (retval != ERROR_OK || section->base_address >= addr) {
+			image->sections[keep++] = *section;
+			continue;
+		}
+
+		uint32_t size = MIN((target_addr_t)section->size, addr - section->base_address);
+		retval = image_add_section(head, section->base_address, size,
+				section->flags, section->private);
+		if (retval != ERROR_OK) {
+			image->sections[keep++] = *section;
+			continue;
+		}
+
+		if (size == section->size) {
+			free(section->private);
+			continue;
+		}
+
+		memmove(section->private, (uint8_t *)section->private + size, section->size - size);
+		section->base_address += size;
+		section->size -= size;
+		image->sections[keep++] = *section;
+	}
+	image->num_sections = keep;
+
+	return retval;
+}
+
 void image_close(struct image *image)
 {
 	if (image->type == IMAGE_BINARY) {
@@ -1265,35 +1453,224 @@ void image_close(struct image *image)
 	image->sections = NULL;
 }
 
-int image_calculate_checksum(const uint8_t *buffer, uint32_t nbytes, uint32_t *checksum)
+/*
+ * The last image opened by image_open_cached(), kept open when enabled
+ * by 'flash image_cache'. Repeated programming of the same file then skips
+ * parsing it, e.g. for the IHEX and S19 formats. The image is reused only
+ * if the file content is unchanged.
+ */
+static struct {
+	bool enabled;
+	bool valid;
+	char *filename;
+	char *type;
+	bool base_address_set;
+	long long base_address;
+	size_t size;
+	uint32_t crc;
+	struct image image;
+} image_cache;
+
+#define IMAGE_CACHE_CRC_CHUNK	(64 * 1024)
+
+static int image_cache_file_crc(const char *filename, size_t *size, uint32_t *crc)
 {
-	uint32_t crc = 0xffffffff;
-	LOG_DEBUG("Calculating checksum");
+	struct fileio *fileio;
 
-	static uint32_t crc32_table[256];
+	int retval = fileio_open(&fileio, filename, FILEIO_READ, FILEIO_BINARY);
+	if (retval != ERROR_OK)
+		return retval;
 
-	static bool first_init;
-	if (!first_init) {
-		/* Initialize the CRC table and the decoding table.  */
-		unsigned int i, j, c;
-		for (i = 0; i < 256; i++) {
-			/* as per gdb */
-			for (c = i << 24, j = 8; j > 0; --j)
-				c = c & 0x80000000 ? (c << 1) ^ 0x04c11db7 : (c << 1);
-			crc32_table[i] = c;
+	uint8_t *buffer = malloc(IMAGE_CACHE_CRC_CHUNK);
+	if (!buffer) {
+		fileio_close(fileio);
+		return ERROR_FAIL;
+	}
+
+	*size = 0;
+	*crc = 0xffffffff;
+	while (!fileio_feof(fileio)) {
+		size_t size_read;
+		retval = fileio_read(fileio, IMAGE_CACHE_CRC_CHUNK, buffer, &size_read);
+		if (retval != ERROR_OK || size_read == 0)
+			break;
+		*crc = crc32_le(CRC32_POLY_LE, *crc, buffer, size_read);
+		*size += size_read;
+	}
+
+	free(buffer);
+	fileio_close(fileio);
+
+	return retval;
+}
+
+void image_cache_free(void)
+{
+	if (image_cache.valid)
+		image_close(&image_cache.image);
+	free(image_cache.filename);
+	free(image_cache.type);
+	image_cache.filename = NULL;
+	image_cache.type = NULL;
+	image_cache.valid = false;
+}
+
+int image_open_cached(struct image **image, const char *filename,
+		bool base_address_set, long long base_address, const char *type)
+{
+	size_t size;
+	uint32_t crc;
+	int retval;
+
+	/* the 'mem' and 'build' image types are not backed by a file */
+	bool cacheable = image_cache.enabled
+		&& !(type && (strcmp(type, "mem") == 0 || strcmp(type, "build") == 0));
+
+	if (!cacheable || image_cache_file_crc(filename, &size, &crc) != ERROR_OK) {
+		*image = malloc(sizeof(struct image));
+		if (!*image) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		(*image)->base_address_set = base_address_set;
+		(*image)->base_address = base_address;
+		(*image)->start_address_set = false;
+
+		retval = image_open(*image, filename, type);
+		if (retval != ERROR_OK) {
+			free(*image);
+			*image = NULL;
 		}
+		return retval;
+	}
 
-		first_init = true;
+	if (image_cache.valid
+			&& strcmp(image_cache.filename, filename) == 0
+			&& (type ? image_cache.type && strcmp(image_cache.type, type) == 0
+				: !image_cache.type)
+			&& image_cache.base_address_set == base_address_set
+			&& image_cache.base_address == base_address
+			&& image_cache.size == size
+			&& image_cache.crc == crc) {
+		LOG_DEBUG("reusing image %s", filename);
+		*image = &image_cache.image;
+		return ERROR_OK;
 	}
 
+	image_cache_free();
+
+	struct image *cached = &image_cache.image;
+	cached->base_address_set = base_address_set;
+	cached->base_address = base_address;
+	cached->start_address_set = false;
+
+	retval = image_open(cached, filename, type);
+	if (retval != ERROR_OK)
+		return retval;
+
+	image_cache.filename = strdup(filename);
+	image_cache.type = type ? strdup(type) : NULL;
+	if (!image_cache.filename || (type && !image_cache.type)) {
+		image_close(cached);
+		free(image_cache.filename);
+		free(image_cache.type);
+		image_cache.filename = NULL;
+		image_cache.type = NULL;
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	image_cache.base_address_set = base_address_set;
+	image_cache.base_address = base_address;
+	image_cache.size = size;
+	image_cache.crc = crc;
+	image_cache.valid = true;
+
+	*image = cached;
+	return ERROR_OK;
+}
+
+void image_release(struct image *image)
+{
+	if (image == &image_cache.image)
+		return;
+
+	image_close(image);
+	free(image);
+}
+
+void image_cache_enable(bool enable)
+{
+	image_cache.enabled = enable;
+	if (!enable)
+		image_cache_free();
+}
+
+bool image_cache_enabled(void)
+{
+	return image_cache.enabled;
+}
+
+const char *image_cache_filename(void)
+{
+	return image_cache.valid ? image_cache.filename : NULL;
+}
+
+/*
+ * MSB-first CRC32 tables as per gdb, for slicing-by-8: entry [k][i] is the
+ * CRC of byte i followed by k zero bytes.
+ */
+static uint32_t crc32_table[8][256];
+
+static void image_crc32_init_table(void)
+{
+	static bool first_init;
+	if (first_init)
+		return;
+
+	for (unsigned int i = 0; i < 256; i++) {
+		/* as per gdb */
+		uint32_t c = i << 24;
+		for (unsigned int j = 8; j > 0; --j)
+			c = c & 0x80000000 ? (c << 1) ^ 0x04c11db7 : (c << 1);
+		crc32_table[0][i] = c;
+	}
+
+	for (unsigned int k = 1; k < 8; k++)
+		for (unsigned int i = 0; i < 256; i++) {
+			uint32_t c = crc32_table[k - 1][i];
+			crc32_table[k][i] = (c << 8) ^ crc32_table[0][c >> 24];
+		}
+
+	first_init = true;
+}
+
+int image_calculate_checksum(const uint8_t *buffer, uint32_t nbytes, uint32_t *checksum)
+{
+	uint32_t crc = 0xffffffff;
+	LOG_DEBUG("Calculating checksum");
+
+	image_crc32_init_table();
+
 	while (nbytes > 0) {
-		int run = nbytes;
+		uint32_t run = nbytes;
 		if (run > 32768)
 			run = 32768;
 		nbytes -= run;
+		/* eight bytes per step, independent of the host alignment and endianness */
+		for (; run >= 8; run -= 8, buffer += 8) {
+			crc ^= be_to_h_u32(buffer);
+			crc = crc32_table[7][crc >> 24] ^
+				crc32_table[6][(crc >> 16) & 255] ^
+				crc32_table[5][(crc >> 8) & 255] ^
+				crc32_table[4][crc & 255] ^
+				crc32_table[3][buffer[4]] ^
+				crc32_table[2][buffer[5]] ^
+				crc32_table[1][buffer[6]] ^
+				crc32_table[0][buffer[7]];
+		}
 		while (run--) {
 			/* as per gdb */
-			crc = (crc << 8) ^ crc32_table[((crc >> 24) ^ *buffer++) & 255];
+			crc = (crc << 8) ^ crc32_table[0][((crc >> 24) ^ *buffer++) & 255];
 		}
 		keep_alive();
 		if (openocd_is_shutdown_pending())
@@ -94,10 +94,25 @@ struct image_mot {
 int image_open(struct image *image, const char *url, const char *type_string);
 int image_read_section(struct image *image, int section, target_addr_t offset,
 		uint32_t size, uint8_t *buffer, size_t *size_read);
+int image_section_map(struct image *image, int section, target_addr_t offset,
+		uint32_t size, const uint8_t **data);
 void image_close(struct image *image);
 
+/* Opens an image like image_open(), or reuses the cached one when the
+ * image cache is enabled and the file content is unchanged. The image
+ * must be released with image_release(). */
+int image_open_cached(struct image **image, const char *url,
+		bool base_address_set, long long base_address, const char *type_string);
+void image_release(struct image *image);
+void image_cache_enable(bool enable);
+bool image_cache_enabled(void);
+/* returns the name of the cached file, or NULL if none */
+const char *image_cache_filename(void);
+void image_cache_free(void);
+
 int image_add_section(struct image *image, target_addr_t base, uint32_t size,
 		uint64_t flags, uint8_t const *data);
+int image_split_below(struct image *image, target_addr_t addr, struct image *head);
 
 int image_calculate_checksum(const uint8_t *buffer, uint32_t nbytes,
 		uint32_t *checksum);
@@ -0,0 +1,257 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/**
+ * @file
+ * Memory read cache used while a target is halted.
+ *
+ * GDB, RTOS awareness and scripts read the same memory over and over while
+ * the target is halted (stack frames, TCBs, code around the PC). The cache
+ * keeps direct mapped lines of target memory so these reads are served
+ * without adapter traffic. It is dropped on every memory write, resume,
+ * step, algorithm run, halt and reset. Memory mapped peripherals can change
+ * while the core is halted, so the cache is disabled by default and such
+ * regions have to be excluded.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "mem_cache.h"
+#include "target.h"
+#include "target_type.h"
+#include <helper/command.h>
+#include <helper/log.h>
+
+#define MEM_CACHE_LINE_SIZE	64
+#define MEM_CACHE_LINES		256
+/* larger reads, like memory dumps, bypass the cache instead of thrashing it */
+#define MEM_CACHE_MAX_READ_LINES	16
+
+struct mem_cache_line {
+	bool valid;
+	target_addr_t address;
+	uint8_t data[MEM_CACHE_LINE_SIZE];
+};
+
+struct mem_cache_region {
+	target_addr_t address;
+	target_addr_t size;
+};
+
+struct target_mem_cache {
+	bool enabled;
+	struct mem_cache_line lines[MEM_CACHE_LINES];
+	struct mem_cache_region *excluded;
+	unsigned int num_excluded;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t bypasses;
+};
+
+static bool mem_cache_excluded(struct target_mem_cache *cache,
+		target_addr_t address, target_addr_t length)
+{
+	for (unsigned int i = 0; i < cache->num_excluded; i++) {
+		struct mem_cache_region *r = &cache->excluded[i];
+
+		if (address < r->address + r->size && r->address < address + length)
+			return true;
+	}
+	return false;
+}
+
+int target_mem_cache_read(struct target *target, target_addr_t address,
+	uint32_t size, uint32_t count, uint8_t *buffer)
+{
+	struct target_mem_cache *cache = target->mem_cache;
+	target_addr_t length = (target_addr_t)size * count;
+
+	if (!cache || !cache->enabled || target->state != TARGET_HALTED || !length)
+		return target->type->read_memory(target, address, size, count, buffer);
+
+	target_addr_t first = address & ~(target_addr_t)(MEM_CACHE_LINE_SIZE - 1);
+	target_addr_t last = (address + length - 1) & ~(target_addr_t)(MEM_CACHE_LINE_SIZE - 1);
+
+	if (last < first || (last - first) / MEM_CACHE_LINE_SIZE >= MEM_CACHE_MAX_READ_LINES ||
+			mem_cache_excluded(cache, first, last + MEM_CACHE_LINE_SIZE - first)) {
+		cache->bypasses++;
+		return target->type->read_memory(target, address, size, count, buffer);
+	}
+
+	for (target_addr_t line_addr = first; ; line_addr += MEM_CACHE_LINE_SIZE) {
+		struct mem_cache_line *line =
+			&cache->lines[(line_addr / MEM_CACHE_LINE_SIZE) % MEM_CACHE_LINES];
+
+		if (line->valid && line->address == line_addr) {
+			cache->hits++;
+		} else {
+			/* fill the whole line with word accesses; a line partly in
+			 * unreadable memory is left uncached */
+			line->valid = false;
+			int retval = target->type->read_memory(target, line_addr, 4,
+					MEM_CACHE_LINE_SIZE / 4, line->data);
+			if (retval != ERROR_OK) {
+				LOG_TARGET_DEBUG(target, "cache line fill at " TARGET_ADDR_FMT
+						" failed, reading uncached", line_addr);
+				cache->bypasses++;
+				return target->type->read_memory(target, address, size, count, buffer);
+			}
+			line->address = line_addr;
+			line->valid = true;
+			cache->misses++;
+		}
+
+		target_addr_t from = MAX(address, line_addr);
+		target_addr_t to = MIN(address + length, line_addr + MEM_CACHE_LINE_SIZE);
+		memcpy(buffer + (from - address), line->data + (from - line_addr), to - from);
+
+		if (line_addr == last)
+			break;
+	}
+
+	return ERROR_OK;
+}
+
+void target_mem_cache_invalidate(struct target *target)
+{
+	struct target_mem_cache *cache = target->mem_cache;
+
+	if (!cache)
+		return;
+
+	for (unsigned int i = 0; i < MEM_CACHE_LINES; i++)
+		cache->lines[i].valid = false;
+}
+
+void target_mem_cache_free(struct target *target)
+{
+	struct target_mem_cache *cache = target->mem_cache;
+
+	if (!cache)
+		return;
+
+	free(cache->excluded);
+	free(cache);
+	target->mem_cache = NULL;
+}
+
+static struct target_mem_cache *mem_cache_get(struct target *target)
+{
+	if (!target->mem_cache)
+		target->mem_cache = calloc(1, sizeof(struct target_mem_cache));
+	if (!target->mem_cache)
+		LOG_ERROR("Out of memory");
+	return target->mem_cache;
+}
+
+COMMAND_HANDLER(handle_mem_cache_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		bool enable;
+		COMMAND_PARSE_ENABLE(CMD_ARGV[0], enable);
+
+		struct target_mem_cache *cache = mem_cache_get(target);
+		if (!cache)
+			return ERROR_FAIL;
+		cache->enabled = enable;
+		target_mem_cache_invalidate(target);
+	}
+
+	command_print(CMD, "memory cache %s",
+		(target->mem_cache && target->mem_cache->enabled) ? "enabled" : "disabled");
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_mem_cache_exclude_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct mem_cache_region region;
+
+	if (CMD_ARGC == 0) {
+		if (target->mem_cache) {
+			for (unsigned int i = 0; i < target->mem_cache->num_excluded; i++)
+				command_print(CMD, TARGET_ADDR_FMT " " TARGET_ADDR_FMT,
+					target->mem_cache->excluded[i].address,
+					target->mem_cache->excluded[i].size);
+		}
+		return ERROR_OK;
+	}
+
+	if (CMD_ARGC != 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	COMMAND_PARSE_ADDRESS(CMD_ARGV[0], region.address);
+	COMMAND_PARSE_ADDRESS(CMD_ARGV[1], region.size);
+
+	struct target_mem_cache *cache = mem_cache_get(target);
+	if (!cache)
+		return ERROR_FAIL;
+
+	struct mem_cache_region *excluded = realloc(cache->excluded,
+			(cache->num_excluded + 1) * sizeof(*excluded));
+	if (!excluded) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+	excluded[cache->num_excluded++] = region;
+	cache->excluded = excluded;
+
+	target_mem_cache_invalidate(target);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_mem_cache_stats_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	struct target_mem_cache *cache = target->mem_cache;
+
+	if (CMD_ARGC > 1 || (CMD_ARGC == 1 && strcmp(CMD_ARGV[0], "clear")))
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!cache) {
+		command_print(CMD, "hits 0 misses 0 bypasses 0");
+		return ERROR_OK;
+	}
+
+	command_print(CMD, "hits %" PRIu64 " misses %" PRIu64 " bypasses %" PRIu64,
+		cache->hits, cache->misses, cache->bypasses);
+
+	if (CMD_ARGC == 1) {
+		cache->hits = 0;
+		cache->misses = 0;
+		cache->bypasses = 0;
+	}
+
+	return ERROR_OK;
+}
+
+const struct command_registration target_mem_cache_command_handlers[] = {
+	{
+		.name = "mem_cache",
+		.handler = handle_mem_cache_command,
+		.mode = COMMAND_ANY,
+		.help = "cache memory reads while the target is halted",
+		.usage = "['enable'|'disable']",
+	},
+	{
+		.name = "mem_cache_exclude",
+		.handler = handle_mem_cache_exclude_command,
+		.mode = COMMAND_ANY,
+		.help = "never cache the given region, e.g. peripherals",
+		.usage = "[address size]",
+	},
+	{
+		.name = "mem_cache_stats",
+		.handler = handle_mem_cache_stats_command,
+		.mode = COMMAND_EXEC,
+		.help = "show memory cache hits, misses and bypasses",
+		.usage = "['clear']",
+	},
+	COMMAND_REGISTRATION_DONE
+};
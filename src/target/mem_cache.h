@@ -0,0 +1,26 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_TARGET_MEM_CACHE_H
+#define OPENOCD_TARGET_MEM_CACHE_H
+
+#include <helper/command.h>
+#include <helper/types.h>
+
+struct target;
+
+/**
+ * Reads target memory through the memory cache of the target. Only used
+ * while the target is halted; misses, large reads and reads touching an
+ * excluded region go to the target.
+ */
+int target_mem_cache_read(struct target *target, target_addr_t address,
+	uint32_t size, uint32_t count, uint8_t *buffer);
+
+/** Drops all cached lines, after a write or when the target runs. */
+void target_mem_cache_invalidate(struct target *target);
+
+void target_mem_cache_free(struct target *target);
+
+extern const struct command_registration target_mem_cache_command_handlers[];
+
+#endif /* OPENOCD_TARGET_MEM_CACHE_H */
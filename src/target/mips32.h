@@ -426,6 +426,9 @@ struct mips32_common {
 
 	/* working area for fastdata access */
 	struct working_area *fast_data_area;
+	/* set while fast_data_area is allocated, the working area backup reads
+	 * target memory and must not come back for a fastdata area */
+	bool fast_data_area_alloc;
 
 	int bp_scanned;
 	int num_inst_bpoints;
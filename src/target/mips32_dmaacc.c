@@ -338,8 +338,134 @@ begin_ejtag_dma_write_b:
 	return ERROR_OK;
 }
 
+static uint32_t ejtag_dma_size_ctrl(int size)
+{
+	switch (size) {
+		case 1:
+			return EJTAG_CTRL_DMA_BYTE;
+		case 2:
+			return EJTAG_CTRL_DMA_HALFWORD;
+		default:
+			return EJTAG_CTRL_DMA_WORD;
+	}
+}
+
+static void ejtag_dma_store(uint32_t addr, int size, uint32_t v, void *buf, int i)
+{
+	/* Handle the bigendian/littleendian */
+	switch (size) {
+		case 1:
+			((uint8_t *)buf)[i] = (v >> (8 * (addr & 0x3))) & 0xff;
+			break;
+		case 2:
+			((uint16_t *)buf)[i] = (addr & 0x2) ? (v >> 16) & 0xffff : v & 0xffff;
+			break;
+		default:
+			((uint32_t *)buf)[i] = v;
+			break;
+	}
+}
+
+struct ejtag_dma_read_capture {
+	uint8_t status[4];
+	uint8_t data[4];
+	uint8_t ctrl[4];
+};
+
+/*
+ * Queued DMA read: the address, start, status, data and clear scans of up to
+ * MIPS32_DMAACC_QUEUE_SIZE accesses are queued and executed at once, with a
+ * fixed number of idle clocks standing in for the DSTRT poll. The captured
+ * status of every access is checked afterwards; an access that was not done
+ * in time ends the queued run and returns its index in *done so the caller
+ * can finish with the polled per-access path.
+ *
+ * The accesses queued after the unfinished one were clocked out too, so the
+ * polled path reads their addresses a second time: up to
+ * MIPS32_DMAACC_QUEUE_SIZE - 1 extra reads, which matters only for registers
+ * with read side effects.
+ */
+static int mips32_dmaacc_read_queued(struct mips_ejtag *ejtag_info, uint32_t addr,
+		int size, int count, void *buf, int *done)
+{
+	struct ejtag_dma_read_capture *cap;
+	uint32_t start_ctrl = EJTAG_CTRL_DMAACC | EJTAG_CTRL_DRWN | ejtag_dma_size_ctrl(size)
+			| EJTAG_CTRL_DSTRT | ejtag_info->ejtag_ctrl;
+
+	*done = 0;
+
+	cap = malloc(MIN(count, MIPS32_DMAACC_QUEUE_SIZE) * sizeof(*cap));
+	if (!cap) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	while (*done < count) {
+		int n = MIN(count - *done, MIPS32_DMAACC_QUEUE_SIZE);
+
+		for (int i = 0; i < n; i++) {
+			mips_ejtag_set_instr(ejtag_info, EJTAG_INST_ADDRESS);
+			mips_ejtag_drscan_32_out(ejtag_info, addr + (*done + i) * size);
+
+			mips_ejtag_set_instr(ejtag_info, EJTAG_INST_CONTROL);
+			mips_ejtag_drscan_32_out(ejtag_info, start_ctrl);
+			jtag_add_runtest(MIPS32_DMAACC_IDLE_CLOCKS, TAP_IDLE);
+			mips_ejtag_drscan_32_queued(ejtag_info, EJTAG_CTRL_DMAACC | ejtag_info->ejtag_ctrl,
+					cap[i].status);
+
+			mips_ejtag_set_instr(ejtag_info, EJTAG_INST_DATA);
+			mips_ejtag_drscan_32_queued(ejtag_info, 0, cap[i].data);
+
+			mips_ejtag_set_instr(ejtag_info, EJTAG_INST_CONTROL);
+			mips_ejtag_drscan_32_queued(ejtag_info, ejtag_info->ejtag_ctrl, cap[i].ctrl);
+		}
+
+		int retval = jtag_execute_queue();
+		if (retval != ERROR_OK) {
+			free(cap);
+			return retval;
+		}
+
+		for (int i = 0; i < n; i++) {
+			uint32_t a = addr + *done * size;
+
+			if (buf_get_u32(cap[i].status, 0, 32) & EJTAG_CTRL_DSTRT) {
+				LOG_DEBUG("DMA Read Addr = %08" PRIx32 " not done after %d clocks, polling",
+						a, MIPS32_DMAACC_IDLE_CLOCKS);
+				free(cap);
+				return ERROR_OK;
+			}
+			if (buf_get_u32(cap[i].ctrl, 0, 32) & EJTAG_CTRL_DERR) {
+				LOG_ERROR("DMA Read Addr = %08" PRIx32 "  Data = ERROR ON READ", a);
+				free(cap);
+				return ERROR_JTAG_DEVICE_ERROR;
+			}
+			ejtag_dma_store(a, size, buf_get_u32(cap[i].data, 0, 32), buf, *done);
+			(*done)++;
+		}
+	}
+
+	free(cap);
+	return ERROR_OK;
+}
+
 int mips32_dmaacc_read_mem(struct mips_ejtag *ejtag_info, uint32_t addr, int size, int count, void *buf)
 {
+	int done;
+
+	if (size != 1 && size != 2 && size != 4)
+		return ERROR_OK;
+
+	int retval = mips32_dmaacc_read_queued(ejtag_info, addr, size, count, buf, &done);
+	if (retval != ERROR_OK || done == count)
+		return retval;
+
+	/* the DMA is slower than the queued idle clocks, poll for the rest; this
+	 * reads again what the batch queued after the unfinished access */
+	addr += done * size;
+	count -= done;
+	buf = (uint8_t *)buf + done * size;
+
 	switch (size) {
 		case 1:
 			return mips32_dmaacc_read_mem8(ejtag_info, addr, count, (uint8_t *)buf);
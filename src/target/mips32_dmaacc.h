@@ -22,6 +22,10 @@
 
 #define RETRY_ATTEMPTS	0
 
+/* accesses queued per JTAG execution and TCKs allowed for each to finish */
+#define MIPS32_DMAACC_QUEUE_SIZE	64
+#define MIPS32_DMAACC_IDLE_CLOCKS	8
+
 int mips32_dmaacc_read_mem(struct mips_ejtag *ejtag_info,
 		uint32_t addr, int size, int count, void *buf);
 int mips32_dmaacc_write_mem(struct mips_ejtag *ejtag_info,
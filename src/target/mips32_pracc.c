@@ -476,7 +476,7 @@ int mips32_pracc_read_mem(struct mips_ejtag *ejtag_info, uint32_t addr, int size
 
 	uint32_t *data = NULL;
 	if (size != 4) {
-		data = malloc(256 * sizeof(uint32_t));
+		data = malloc(PRACC_MAX_XFER_COUNT * sizeof(uint32_t));
 		if (!data) {
 			LOG_ERROR("Out of memory");
 			goto exit;
@@ -491,7 +491,7 @@ int mips32_pracc_read_mem(struct mips_ejtag *ejtag_info, uint32_t addr, int size
 		ctx.code_count = 0;
 		ctx.store_count = 0;
 
-		int this_round_count = (count > 256) ? 256 : count;
+		int this_round_count = MIN(count, PRACC_MAX_XFER_COUNT);
 		uint32_t last_upper_base_addr = UPPER16((addr + 0x8000));
 
 		pracc_add(&ctx, 0, MIPS32_LUI(ctx.isa, 15, PRACC_UPPER_BASE_ADDR)); /* $15 = MIPS32_PRACC_BASE_ADDR */
@@ -752,7 +752,7 @@ static int mips32_pracc_write_mem_generic(struct mips_ejtag *ejtag_info,
 		ctx.code_count = 0;
 		ctx.store_count = 0;
 
-		int this_round_count = (count > 128) ? 128 : count;
+		int this_round_count = MIN(count, PRACC_MAX_XFER_COUNT);
 		uint32_t last_upper_base_addr = UPPER16((addr + 0x8000));
 			      /* load $15 with memory base address */
 		pracc_add(&ctx, 0, MIPS32_LUI(ctx.isa, 15, last_upper_base_addr));
@@ -1421,3 +1421,31 @@ int mips32_pracc_fastdata_xfer(struct mips_ejtag *ejtag_info, struct working_are
 
 	return mips32_pracc_fastdata_xfer_synchronize_cache(ejtag_info, addr, 4, count);
 }
+
+/**
+ * Moves a block of memory the fastest way available: word transfers of
+ * at least MIPS32_FASTDATA_MIN_COUNT words go through the fastdata handler
+ * in @a fastdata_area when one is given, everything else (and a failed
+ * fastdata transfer) goes through PrAcc rounds.
+ * @a buf holds host endian values of @a size bytes.
+ */
+int mips32_pracc_xfer_mem(struct mips_ejtag *ejtag_info, struct working_area *fastdata_area,
+		int write_t, uint32_t addr, int size, int count, void *buf)
+{
+	if (fastdata_area && size == 4 && count >= MIPS32_FASTDATA_MIN_COUNT) {
+		if (addr < fastdata_area->address + fastdata_area->size &&
+				fastdata_area->address < addr + count * 4) {
+			LOG_DEBUG("fastdata area " TARGET_ADDR_FMT " within transfer area, using PrAcc",
+				fastdata_area->address);
+		} else {
+			int retval = mips32_pracc_fastdata_xfer(ejtag_info, fastdata_area, write_t, addr, count, buf);
+			if (retval == ERROR_OK)
+				return ERROR_OK;
+			LOG_WARNING("Fastdata access failed, falling back to PrAcc");
+		}
+	}
+
+	if (write_t)
+		return mips32_pracc_write_mem(ejtag_info, addr, size, count, buf);
+	return mips32_pracc_read_mem(ejtag_info, addr, size, count, buf);
+}
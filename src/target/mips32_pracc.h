@@ -26,8 +26,12 @@
 #define PRACC_MAX_CODE				(MIPS32_PRACC_PARAM_OUT - MIPS32_PRACC_TEXT)
 #define PRACC_MAX_INSTRUCTIONS			(PRACC_MAX_CODE / 4)
 #define PRACC_OUT_OFFSET			(MIPS32_PRACC_PARAM_OUT - MIPS32_PRACC_BASE_ADDR)
+/* memory accesses per PrAcc round: up to 3 instructions each fit in the text area */
+#define PRACC_MAX_XFER_COUNT			((int)(PRACC_MAX_INSTRUCTIONS - 16) / 3)
 
 #define MIPS32_FASTDATA_HANDLER_SIZE		0x80
+/* word count from which a transfer goes through the fastdata handler */
+#define MIPS32_FASTDATA_MIN_COUNT		32
 #define UPPER16(addr)				((addr) >> 16)
 #define LOWER16(addr)				((addr) & 0xFFFF)
 #define NEG16(v)				(((~(v)) + 1) & 0xFFFF)
@@ -67,6 +71,8 @@ int mips32_pracc_write_mem(struct mips_ejtag *ejtag_info,
 		uint32_t addr, int size, int count, const void *buf);
 int mips32_pracc_fastdata_xfer(struct mips_ejtag *ejtag_info, struct working_area *source,
 		int write_t, uint32_t addr, int count, uint32_t *buf);
+int mips32_pracc_xfer_mem(struct mips_ejtag *ejtag_info, struct working_area *fastdata_area,
+		int write_t, uint32_t addr, int size, int count, void *buf);
 
 int mips32_pracc_read_regs(struct mips32_common *mips32);
 int mips32_pracc_write_regs(struct mips32_common *mips32);
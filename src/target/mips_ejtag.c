@@ -108,7 +108,7 @@ int mips_ejtag_drscan_64(struct mips_ejtag *ejtag_info, uint64_t *data)
 	return ERROR_OK;
 }
 
-static void mips_ejtag_drscan_32_queued(struct mips_ejtag *ejtag_info,
+void mips_ejtag_drscan_32_queued(struct mips_ejtag *ejtag_info,
 		uint32_t data_out, uint8_t *data_in)
 {
 	assert(ejtag_info->tap);
@@ -34,10 +34,8 @@ static int mips_m4k_internal_restore(struct target *target, bool current,
 		target_addr_t address, bool handle_breakpoints,
 		bool debug_execution);
 static int mips_m4k_halt(struct target *target);
-static int mips_m4k_bulk_write_memory(struct target *target, target_addr_t address,
-		uint32_t count, const uint8_t *buffer);
-static int mips_m4k_bulk_read_memory(struct target *target, target_addr_t address,
-		uint32_t count, uint8_t *buffer);
+static struct working_area *mips_m4k_fastdata_area(struct target *target,
+		uint32_t size, uint32_t count);
 
 static int mips_m4k_examine_debug_reason(struct target *target)
 {
@@ -1015,7 +1013,12 @@ static int mips_m4k_read_memory(struct target *target, target_addr_t address,
 	LOG_DEBUG("address: " TARGET_ADDR_FMT ", size: 0x%8.8" PRIx32 ", count: 0x%8.8" PRIx32 "",
 			address, size, count);
 
-	if (target->state != TARGET_HALTED) {
+	/* DMA access does not need the core in debug mode, so a running
+	 * target can still be read when the EJTAG implements it */
+	bool running_dma = target->state == TARGET_RUNNING
+			&& !(ejtag_info->impcode & EJTAG_IMP_NODMA);
+
+	if (target->state != TARGET_HALTED && !running_dma) {
 		LOG_WARNING("target not halted");
 		return ERROR_TARGET_NOT_HALTED;
 	}
@@ -1027,12 +1030,6 @@ static int mips_m4k_read_memory(struct target *target, target_addr_t address,
 	if (((size == 4) && (address & 0x3u)) || ((size == 2) && (address & 0x1u)))
 		return ERROR_TARGET_UNALIGNED_ACCESS;
 
-	if (size == 4 && count > 32) {
-		int retval = mips_m4k_bulk_read_memory(target, address, count, buffer);
-		if (retval == ERROR_OK)
-			return ERROR_OK;
-		LOG_WARNING("Falling back to non-bulk read");
-	}
 	/* since we don't know if buffer is aligned, we allocate new mem that is always aligned */
 	void *t = NULL;
 
@@ -1045,10 +1042,13 @@ static int mips_m4k_read_memory(struct target *target, target_addr_t address,
 	} else
 		t = buffer;
 
-	/* if noDMA off, use DMAACC mode for memory read */
+	/* fastdata when a working area is available, else DMAACC mode unless noDMA is on */
+	struct working_area *fastdata_area = NULL;
+	if (!running_dma)
+		fastdata_area = mips_m4k_fastdata_area(target, size, count);
 	int retval;
-	if (ejtag_info->impcode & EJTAG_IMP_NODMA)
-		retval = mips32_pracc_read_mem(ejtag_info, address, size, count, t);
+	if (fastdata_area || (ejtag_info->impcode & EJTAG_IMP_NODMA))
+		retval = mips32_pracc_xfer_mem(ejtag_info, fastdata_area, 0, address, size, count, t);
 	else
 		retval = mips32_dmaacc_read_mem(ejtag_info, address, size, count, t);
 
@@ -1085,13 +1085,6 @@ static int mips_m4k_write_memory(struct target *target, target_addr_t address,
 		return ERROR_TARGET_NOT_HALTED;
 	}
 
-	if (size == 4 && count > 32) {
-		int retval = mips_m4k_bulk_write_memory(target, address, count, buffer);
-		if (retval == ERROR_OK)
-			return ERROR_OK;
-		LOG_WARNING("Falling back to non-bulk write");
-	}
-
 	/* sanitize arguments */
 	if (((size != 4) && (size != 2) && (size != 1)) || (count == 0) || !(buffer))
 		return ERROR_COMMAND_SYNTAX_ERROR;
@@ -1121,10 +1114,11 @@ static int mips_m4k_write_memory(struct target *target, target_addr_t address,
 		buffer = t;
 	}
 
-	/* if noDMA off, use DMAACC mode for memory write */
+	/* fastdata when a working area is available, else DMAACC mode unless noDMA is on */
+	struct working_area *fastdata_area = mips_m4k_fastdata_area(target, size, count);
 	int retval;
-	if (ejtag_info->impcode & EJTAG_IMP_NODMA)
-		retval = mips32_pracc_write_mem(ejtag_info, address, size, count, buffer);
+	if (fastdata_area || (ejtag_info->impcode & EJTAG_IMP_NODMA))
+		retval = mips32_pracc_xfer_mem(ejtag_info, fastdata_area, 1, address, size, count, (void *)buffer);
 	else
 		retval = mips32_dmaacc_write_mem(ejtag_info, address, size, count, buffer);
 
@@ -1195,135 +1189,31 @@ static int mips_m4k_examine(struct target *target)
 	return mips32_examine(target);
 }
 
-static int mips_m4k_bulk_write_memory(struct target *target, target_addr_t address,
-		uint32_t count, const uint8_t *buffer)
+/* The fastdata handler is kept in a working area until the next resume or reset;
+ * without one, transfers go through PrAcc or DMA access. */
+static struct working_area *mips_m4k_fastdata_area(struct target *target,
+		uint32_t size, uint32_t count)
 {
 	struct mips32_common *mips32 = target_to_mips32(target);
-	struct mips_ejtag *ejtag_info = &mips32->ejtag_info;
-	struct working_area *fast_data_area;
-	int retval;
-	int write_t = 1;
-
-	LOG_DEBUG("address: " TARGET_ADDR_FMT ", count: 0x%8.8" PRIx32 "",
-			  address, count);
 
-	/* check alignment */
-	if (address & 0x3u)
-		return ERROR_TARGET_UNALIGNED_ACCESS;
+	if (size != 4 || count < MIPS32_FASTDATA_MIN_COUNT || mips32->fast_data_area_alloc)
+		return NULL;
 
 	if (!mips32->fast_data_area) {
-		/* Get memory for block write handler
-		 * we preserve this area between calls and gain a speed increase
-		 * of about 3kb/sec when writing flash
-		 * this will be released/nulled by the system when the target is resumed or reset */
-		retval = target_alloc_working_area(target,
-				MIPS32_FASTDATA_HANDLER_SIZE,
+		mips32->fast_data_area_alloc = true;
+		int retval = target_alloc_working_area_try(target, MIPS32_FASTDATA_HANDLER_SIZE,
 				&mips32->fast_data_area);
+		mips32->fast_data_area_alloc = false;
 		if (retval != ERROR_OK) {
-			LOG_ERROR("No working area available");
-			return retval;
+			LOG_DEBUG("No working area available for fastdata");
+			return NULL;
 		}
 
 		/* reset fastadata state so the algo get reloaded */
-		ejtag_info->fast_access_save = -1;
-	}
-
-	fast_data_area = mips32->fast_data_area;
-
-	if (address < (fast_data_area->address + fast_data_area->size) &&
-			fast_data_area->address < (address + count)) {
-		LOG_ERROR("fast_data (" TARGET_ADDR_FMT ") is within write area "
-			  "(" TARGET_ADDR_FMT "-" TARGET_ADDR_FMT ").",
-			  fast_data_area->address, address, address + count);
-		LOG_ERROR("Change work-area-phys or load_image address!");
-		return ERROR_FAIL;
-	}
-
-	/* mips32_pracc_fastdata_xfer requires uint32_t in host endianness, */
-	/* but byte array represents target endianness                      */
-	uint32_t *t = NULL;
-	t = malloc(count * sizeof(uint32_t));
-	if (!t) {
-		LOG_ERROR("Out of memory");
-		return ERROR_FAIL;
+		mips32->ejtag_info.fast_access_save = -1;
 	}
 
-	target_buffer_get_u32_array(target, buffer, count, t);
-
-	retval = mips32_pracc_fastdata_xfer(ejtag_info, mips32->fast_data_area, write_t, address,
-			count, t);
-
-	free(t);
-
-	if (retval != ERROR_OK)
-		LOG_ERROR("Fastdata access Failed");
-
-	return retval;
-}
-
-static int mips_m4k_bulk_read_memory(struct target *target, target_addr_t address,
-		uint32_t count, uint8_t *buffer)
-{
-	struct mips32_common *mips32 = target_to_mips32(target);
-	struct mips_ejtag *ejtag_info = &mips32->ejtag_info;
-	struct working_area *fast_data_area;
-	int retval;
-	int write_t = 0;
-
-	LOG_DEBUG("address: " TARGET_ADDR_FMT ", count: 0x%8.8" PRIx32 "",
-			address, count);
-
-	/* check alignment */
-	if (address & 0x3u)
-		return ERROR_TARGET_UNALIGNED_ACCESS;
-
-	if (!mips32->fast_data_area) {
-		/* Get memory for block read handler
-		 * we preserve this area between calls and gain a speed increase
-		 * of about 3kb/sec when reading flash
-		 * this will be released/nulled by the system when the target is resumed or reset */
-		retval = target_alloc_working_area(target,
-				MIPS32_FASTDATA_HANDLER_SIZE,
-				&mips32->fast_data_area);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("No working area available");
-			return retval;
-		}
-
-		/* reset fastadata state so the algo get reloaded */
-		ejtag_info->fast_access_save = -1;
-	}
-
-	fast_data_area = mips32->fast_data_area;
-
-	if (address < (fast_data_area->address + fast_data_area->size) &&
-			fast_data_area->address < (address + count)) {
-		LOG_ERROR("fast_data (" TARGET_ADDR_FMT ") is within read area "
-				"(" TARGET_ADDR_FMT "-" TARGET_ADDR_FMT ").",
-				fast_data_area->address, address, address + count);
-		LOG_ERROR("Change work-area-phys or load_image address!");
-		return ERROR_FAIL;
-	}
-
-	/* mips32_pracc_fastdata_xfer requires uint32_t in host endianness, */
-	/* but byte array represents target endianness                      */
-	uint32_t *t = malloc(count * sizeof(uint32_t));
-	if (!t) {
-		LOG_ERROR("Out of memory");
-		return ERROR_FAIL;
-	}
-
-	retval = mips32_pracc_fastdata_xfer(ejtag_info, mips32->fast_data_area, write_t, address,
-			count, t);
-
-	target_buffer_set_u32_array(target, buffer, count, t);
-
-	free(t);
-
-	if (retval != ERROR_OK)
-		LOG_ERROR("Fastdata access Failed");
-
-	return retval;
+	return mips32->fast_data_area;
 }
 
 static int mips_m4k_verify_pointer(struct command_invocation *cmd,
@@ -102,6 +102,129 @@ void register_cache_invalidate(struct reg_cache *cache)
 	}
 }
 
+/*
+ * Snapshots save the cached values of a register cache, e.g. around the run
+ * of an algorithm, and put back only the registers which changed since.
+ * They work on the cache only: registers not valid when the snapshot is taken
+ * are not saved, the caller reads the ones it needs first.
+ */
+
+struct reg_snapshot_entry {
+	bool saved;
+	uint8_t *value;
+};
+
+struct reg_snapshot {
+	struct reg_cache *cache;
+	struct reg_snapshot_entry regs[];
+};
+
+/** Saves the values of the valid registers of a cache. */
+struct reg_snapshot *register_cache_snapshot(struct reg_cache *cache)
+{
+	size_t size = sizeof(struct reg_snapshot) + cache->num_regs * sizeof(struct reg_snapshot_entry);
+	size_t values_size = 0;
+
+	for (unsigned int n = 0; n < cache->num_regs; n++)
+		values_size += DIV_ROUND_UP(cache->reg_list[n].size, 8);
+
+	struct reg_snapshot *snapshot = calloc(1, size + values_size);
+	if (!snapshot) {
+		LOG_ERROR("Out of memory");
+		return NULL;
+	}
+
+	snapshot->cache = cache;
+	uint8_t *value = (uint8_t *)snapshot + size;
+	for (unsigned int n = 0; n < cache->num_regs; n++) {
+		struct reg *reg = &cache->reg_list[n];
+		struct reg_snapshot_entry *entry = &snapshot->regs[n];
+
+		entry->value = value;
+		value += DIV_ROUND_UP(reg->size, 8);
+		if (!reg->exist || !reg->valid)
+			continue;
+		memcpy(entry->value, reg->value, DIV_ROUND_UP(reg->size, 8));
+		entry->saved = true;
+	}
+
+	return snapshot;
+}
+
+void register_snapshot_free(struct reg_snapshot *snapshot)
+{
+	free(snapshot);
+}
+
+static const struct reg_snapshot_entry *register_snapshot_entry(const struct reg_snapshot *snapshot,
+		const struct reg *reg)
+{
+	const struct reg_cache *cache = snapshot->cache;
+
+	if (reg < cache->reg_list || reg >= cache->reg_list + cache->num_regs)
+		return NULL;
+
+	const struct reg_snapshot_entry *entry = &snapshot->regs[reg - cache->reg_list];
+	return entry->saved ? entry : NULL;
+}
+
+/**
+ * Puts back the saved value of a register, if it is not the cached one.
+ * The register is then marked dirty, to be written to the target.
+ * @returns true if the register was restored.
+ */
+bool register_snapshot_restore(const struct reg_snapshot *snapshot, struct reg *reg)
+{
+	const struct reg_snapshot_entry *entry = register_snapshot_entry(snapshot, reg);
+	unsigned int bytes = DIV_ROUND_UP(reg->size, 8);
+
+	/* a register not read back may hold anything */
+	if (!entry || (reg->valid && !memcmp(reg->value, entry->value, bytes)))
+		return false;
+
+	memcpy(reg->value, entry->value, bytes);
+	reg->valid = true;
+	reg->dirty = true;
+	return true;
+}
+
+/**
+ * Puts back all the saved registers which changed.
+ * @returns the number of registers restored.
+ */
+unsigned int register_cache_restore(const struct reg_snapshot *snapshot)
+{
+	struct reg_cache *cache = snapshot->cache;
+	unsigned int restored = 0;
+
+	for (unsigned int n = 0; n < cache->num_regs; n++) {
+		if (register_snapshot_restore(snapshot, &cache->reg_list[n]))
+			restored++;
+	}
+
+	return restored;
+}
+
+/**
+ * Drops the pending write of a register holding its saved value, when the
+ * target is about to run code which does not depend on it, typically a
+ * scratch register of an algorithm. The register is left invalid and
+ * written back by the restore only, so algorithms run back to back do not
+ * write it before each run.
+ * @returns true if the write was dropped.
+ */
+bool register_snapshot_defer(const struct reg_snapshot *snapshot, struct reg *reg)
+{
+	const struct reg_snapshot_entry *entry = register_snapshot_entry(snapshot, reg);
+
+	if (!entry || !reg->dirty || memcmp(reg->value, entry->value, DIV_ROUND_UP(reg->size, 8)))
+		return false;
+
+	reg->dirty = false;
+	reg->valid = false;
+	return true;
+}
+
 static int register_get_dummy_core_reg(struct reg *reg)
 {
 	return ERROR_OK;
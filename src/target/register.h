@@ -161,6 +161,14 @@ struct reg_cache **register_get_last_cache_p(struct reg_cache **first);
 void register_unlink_cache(struct reg_cache **cache_p, const struct reg_cache *cache);
 void register_cache_invalidate(struct reg_cache *cache);
 
+struct reg_snapshot;
+
+struct reg_snapshot *register_cache_snapshot(struct reg_cache *cache);
+void register_snapshot_free(struct reg_snapshot *snapshot);
+bool register_snapshot_restore(const struct reg_snapshot *snapshot, struct reg *reg);
+unsigned int register_cache_restore(const struct reg_snapshot *snapshot);
+bool register_snapshot_defer(const struct reg_snapshot *snapshot, struct reg *reg);
+
 void register_init_dummy(struct reg *reg);
 
 #endif /* OPENOCD_TARGET_REGISTER_H */
@@ -80,6 +80,14 @@ void riscv_batch_free(struct riscv_batch *batch)
 	free(batch);
 }
 
+void riscv_batch_reset(struct riscv_batch *batch, size_t idle)
+{
+	batch->used_scans = 0;
+	batch->idle_count = idle;
+	batch->last_scan = RISCV_SCAN_TYPE_INVALID;
+	batch->read_keys_used = 0;
+}
+
 bool riscv_batch_full(struct riscv_batch *batch)
 {
 	return batch->used_scans > (batch->allocated_scans - 4);
@@ -95,8 +103,11 @@ int riscv_batch_run(struct riscv_batch *batch)
 	riscv_batch_add_nop(batch);
 
 	for (size_t i = 0; i < batch->used_scans; ++i) {
-		if (bscan_tunnel_ir_width != 0)
+		/* the IR keeps selecting the tunnel for the whole batch */
+		if (bscan_tunnel_ir_width != 0 && i == 0)
 			riscv_add_bscan_tunneled_scan(batch->target, batch->fields+i, batch->bscan_ctxt+i);
+		else if (bscan_tunnel_ir_width != 0)
+			riscv_add_bscan_tunneled_dr_scan(batch->target, batch->fields+i, batch->bscan_ctxt+i);
 		else
 			jtag_add_dr_scan(batch->target->tap, 1, batch->fields + i, TAP_IDLE);
 
@@ -52,6 +52,9 @@ struct riscv_batch {
 struct riscv_batch *riscv_batch_alloc(struct target *target, size_t scans, size_t idle);
 void riscv_batch_free(struct riscv_batch *batch);
 
+/* Empties the batch so it can be filled again, with a new idle count. */
+void riscv_batch_reset(struct riscv_batch *batch, size_t idle);
+
 /* Checks to see if this batch is full. */
 bool riscv_batch_full(struct riscv_batch *batch);
 
@@ -824,6 +824,16 @@ static void cache_invalidate(struct target *target)
 	}
 }
 
+/* Call this after writing a debug RAM word directly, without the cache, so the
+ * cache still knows what the target holds. */
+static void cache_written32(struct target *target, unsigned int index, uint32_t data)
+{
+	riscv011_info_t *info = get_info(target);
+	info->dram_cache[index].data = data;
+	info->dram_cache[index].valid = true;
+	info->dram_cache[index].dirty = false;
+}
+
 /* Called by cache_write() after the program has run. Also call this if you're
  * running programs without calling cache_write(). */
 static void cache_clean(struct target *target)
@@ -1157,7 +1167,14 @@ static int execute_resume(struct target *target, bool step)
 	uint64_t dbus_value = DMCONTROL_INTERRUPT | info->dcsr;
 	dbus_write(target, dram_address(4), dbus_value);
 
+	/* Keep the program in the cache. The data slots are invalidated when
+	 * the hart halts again. */
 	cache_invalidate(target);
+	cache_written32(target, 0, lw(S0, ZERO, DEBUG_RAM_START + 16));
+	cache_written32(target, 1, csrw(S0, CSR_DCSR));
+	cache_written32(target, 2, fence_i());
+	cache_written32(target, 3,
+			jal(0, (uint32_t) (DEBUG_ROM_RESUME - (DEBUG_RAM_START + 4*3))));
 
 	if (wait_for_debugint_clear(target, true) != ERROR_OK) {
 		LOG_ERROR("Debug interrupt didn't clear.");
@@ -1818,7 +1835,15 @@ static riscv_error_t handle_halt_routine(struct target *target)
 	info->dpc = reg_cache_get(target, CSR_DPC);
 	info->dcsr = reg_cache_get(target, CSR_DCSR);
 
-	cache_invalidate(target);
+	/* The routine left its last program in words 0 to 2, and didn't touch
+	 * word 3. The data slots, and SLOT_LAST which the debug ROM uses to
+	 * save S1, hold unknown values. */
+	for (unsigned int i = 4; i < info->dramsize; i++)
+		info->dram_cache[i].valid = false;
+	cache_written32(target, 0, csrr(S0, CSR_DCSR));
+	cache_written32(target, 1, store_slot(target, S0, SLOT0));
+	cache_written32(target, 2,
+			jal(0, (uint32_t) (DEBUG_ROM_RESUME - (DEBUG_RAM_START + 4*2))));
 
 	return RE_OK;
 
@@ -84,6 +84,22 @@ static int write_memory(struct target *target, target_addr_t address,
 
 #define RISCV013_INFO(r) riscv013_info_t *r = get_info(target)
 
+#define DELAY_DECAY_SCANS	1024
+
+/* Memory access methods that failed are remembered per 4 KiB region, in a
+ * small direct-mapped table, so the next accesses go to a working method
+ * without first trying the failing ones. */
+#define MEM_PLAN_SIZE	16
+#define MEM_PLAN_REGION_SHIFT	12
+
+struct mem_plan_entry {
+	bool valid;
+	target_addr_t region;
+	/* Bit (1 << method) set for each method that failed in this region. */
+	uint8_t read_failed;
+	uint8_t write_failed;
+};
+
 /*** JTAG registers. ***/
 
 typedef enum {
@@ -190,6 +206,19 @@ typedef struct {
 	 * go low. */
 	unsigned int ac_busy_delay;
 
+	/* Number of scans done without increasing each of the delays above.
+	 * Every DELAY_DECAY_SCANS of them, the delay is lowered a bit, so a
+	 * single slow access doesn't slow down all the later ones. */
+	unsigned int dmi_busy_quiet;
+	unsigned int ac_busy_quiet;
+	unsigned int bus_master_write_quiet, bus_master_read_quiet;
+
+	/* Batch of the last memory access, kept to be reused by the next one. */
+	struct riscv_batch *batch;
+
+	/* Failed memory access methods, cleared when the hart halts. */
+	struct mem_plan_entry mem_plan[MEM_PLAN_SIZE];
+
 	bool abstract_read_csr_supported;
 	bool abstract_write_csr_supported;
 	bool abstract_read_fpr_supported;
@@ -446,10 +475,36 @@ static uint32_t dtmcontrol_scan(struct target *target, uint32_t out)
 	return in;
 }
 
+static void decay_delay(unsigned int *delay, unsigned int *quiet, unsigned int scans)
+{
+	if (!*delay) {
+		*quiet = 0;
+		return;
+	}
+
+	*quiet += scans;
+	while (*delay && *quiet >= DELAY_DECAY_SCANS) {
+		*quiet -= DELAY_DECAY_SCANS;
+		*delay -= *delay / 8 + 1;
+	}
+}
+
+/* Called after scans that completed without busy */
+static void decay_delays(const struct target *target, unsigned int scans)
+{
+	riscv013_info_t *info = get_info(target);
+
+	decay_delay(&info->dmi_busy_delay, &info->dmi_busy_quiet, scans);
+	decay_delay(&info->ac_busy_delay, &info->ac_busy_quiet, scans);
+	decay_delay(&info->bus_master_write_delay, &info->bus_master_write_quiet, scans);
+	decay_delay(&info->bus_master_read_delay, &info->bus_master_read_quiet, scans);
+}
+
 static void increase_dmi_busy_delay(struct target *target)
 {
 	riscv013_info_t *info = get_info(target);
 	info->dmi_busy_delay += info->dmi_busy_delay / 10 + 1;
+	info->dmi_busy_quiet = 0;
 	LOG_DEBUG("dtmcs_idle=%d, dmi_busy_delay=%d, ac_busy_delay=%d",
 			info->dtmcs_idle, info->dmi_busy_delay,
 			info->ac_busy_delay);
@@ -638,6 +693,9 @@ static int dmi_op_timeout(struct target *target, uint32_t *data_in,
 		}
 	}
 
+	if (!dmi_busy_encountered || !*dmi_busy_encountered)
+		decay_delays(target, 1);
+
 	return ERROR_OK;
 }
 
@@ -711,6 +769,7 @@ static void increase_ac_busy_delay(struct target *target)
 {
 	riscv013_info_t *info = get_info(target);
 	info->ac_busy_delay += info->ac_busy_delay / 10 + 1;
+	info->ac_busy_quiet = 0;
 	LOG_DEBUG("dtmcs_idle=%d, dmi_busy_delay=%d, ac_busy_delay=%d",
 			info->dtmcs_idle, info->dmi_busy_delay,
 			info->ac_busy_delay);
@@ -1523,6 +1582,9 @@ static void deinit_target(struct target *target)
 	if (!info)
 		return;
 
+	riscv013_info_t *r = info->version_specific;
+	if (r && r->batch)
+		riscv_batch_free(r->batch);
 	free(info->version_specific);
 	/* TODO: free register arch_info */
 	info->version_specific = NULL;
@@ -1947,6 +2009,47 @@ static int cleanup_after_vector_access(struct target *target, uint64_t vtype,
 	return ERROR_OK;
 }
 
+/* Moves a whole vector register at once, with a vs1r.v or vl1re8.v through a
+ * working area, which the debugger then accesses as a block of memory.
+ * Whole register accesses don't depend on vtype and vl. S0 is clobbered.
+ * Returns ERROR_TARGET_RESOURCE_NOT_AVAILABLE when there is no working area,
+ * so the caller can fall back to moving one element at a time. */
+static int vector_register_bulk(struct target *target, unsigned int vnum,
+		uint8_t *read_buf, const uint8_t *write_buf)
+{
+	RISCV_INFO(r);
+	struct working_area *area;
+
+	if (r->vlenb % 4)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	if (target_alloc_working_area_try(target, r->vlenb, &area) != ERROR_OK)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	int result = ERROR_OK;
+	if (write_buf)
+		result = write_memory(target, area->address, 4, r->vlenb / 4, write_buf);
+	if (result == ERROR_OK)
+		result = register_write_direct(target, GDB_REGNO_S0, area->address);
+
+	if (result == ERROR_OK) {
+		struct riscv_program program;
+		riscv_program_init(&program, target);
+		if (write_buf)
+			riscv_program_insert(&program, vl1re8_v(vnum, S0));
+		else
+			riscv_program_insert(&program, vs1r_v(vnum, S0));
+		riscv_program_fence(&program);
+		result = riscv_program_exec(&program, target);
+	}
+
+	if (result == ERROR_OK && read_buf)
+		result = read_memory(target, area->address, 4, r->vlenb / 4, read_buf, 4);
+
+	target_free_working_area(target, area);
+	return result;
+}
+
 static int riscv013_get_register_buf(struct target *target,
 		uint8_t *value, int regno)
 {
@@ -1963,6 +2066,10 @@ static int riscv013_get_register_buf(struct target *target,
 	if (prep_for_register_access(target, &mstatus, regno) != ERROR_OK)
 		return ERROR_FAIL;
 
+	int result = vector_register_bulk(target, regno - GDB_REGNO_V0, value, NULL);
+	if (result != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+		goto cleanup;
+
 	uint64_t vtype, vl;
 	unsigned int debug_vl;
 	if (prep_for_vector_access(target, &vtype, &vl, &debug_vl) != ERROR_OK)
@@ -1976,7 +2083,7 @@ static int riscv013_get_register_buf(struct target *target,
 	riscv_program_insert(&program, vmv_x_s(S0, vnum));
 	riscv_program_insert(&program, vslide1down_vx(vnum, vnum, S0, true));
 
-	int result = ERROR_OK;
+	result = ERROR_OK;
 	for (unsigned int i = 0; i < debug_vl; i++) {
 		/* Executing the program might result in an exception if there is some
 		 * issue with the vector implementation/instructions we're using. If that
@@ -1998,6 +2105,7 @@ static int riscv013_get_register_buf(struct target *target,
 	if (cleanup_after_vector_access(target, vtype, vl) != ERROR_OK)
 		return ERROR_FAIL;
 
+cleanup:
 	if (cleanup_after_register_access(target, mstatus, regno) != ERROR_OK)
 		return ERROR_FAIL;
 	if (register_write_direct(target, GDB_REGNO_S0, s0) != ERROR_OK)
@@ -2022,6 +2130,10 @@ static int riscv013_set_register_buf(struct target *target,
 	if (prep_for_register_access(target, &mstatus, regno) != ERROR_OK)
 		return ERROR_FAIL;
 
+	int result = vector_register_bulk(target, regno - GDB_REGNO_V0, NULL, value);
+	if (result != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+		goto cleanup;
+
 	uint64_t vtype, vl;
 	unsigned int debug_vl;
 	if (prep_for_vector_access(target, &vtype, &vl, &debug_vl) != ERROR_OK)
@@ -2033,7 +2145,7 @@ static int riscv013_set_register_buf(struct target *target,
 	struct riscv_program program;
 	riscv_program_init(&program, target);
 	riscv_program_insert(&program, vslide1down_vx(vnum, vnum, S0, true));
-	int result = ERROR_OK;
+	result = ERROR_OK;
 	for (unsigned int i = 0; i < debug_vl; i++) {
 		if (register_write_direct(target, GDB_REGNO_S0,
 					buf_get_u64(value, xlen * i, xlen)) != ERROR_OK)
@@ -2046,6 +2158,7 @@ static int riscv013_set_register_buf(struct target *target,
 	if (cleanup_after_vector_access(target, vtype, vl) != ERROR_OK)
 		return ERROR_FAIL;
 
+cleanup:
 	if (cleanup_after_register_access(target, mstatus, regno) != ERROR_OK)
 		return ERROR_FAIL;
 	if (register_write_direct(target, GDB_REGNO_S0, s0) != ERROR_OK)
@@ -2100,7 +2213,44 @@ static int batch_run(const struct target *target, struct riscv_batch *batch)
 			info->ac_busy_delay = 0;
 		}
 	}
-	return riscv_batch_run(batch);
+	int result = riscv_batch_run(batch);
+	/* a busy result in the batch raises the delay again after this */
+	if (result == ERROR_OK)
+		decay_delays(target, batch->used_scans);
+
+	return result;
+}
+
+/* Returns a batch for at least "scans" scans. The batch kept by put_batch()
+ * is reused when it is large enough, so memory accesses don't allocate the
+ * batch buffers for every burst. */
+static struct riscv_batch *get_batch(struct target *target, size_t scans, size_t idle)
+{
+	RISCV013_INFO(info);
+	struct riscv_batch *batch = info->batch;
+
+	if (batch && batch->allocated_scans >= scans + 4) {
+		info->batch = NULL;
+		riscv_batch_reset(batch, idle);
+		return batch;
+	}
+
+	return riscv_batch_alloc(target, scans, idle);
+}
+
+/* Gives back a batch from get_batch(). The largest one is kept. */
+static void put_batch(struct target *target, struct riscv_batch *batch)
+{
+	RISCV013_INFO(info);
+
+	if (info->batch && info->batch->allocated_scans >= batch->allocated_scans) {
+		riscv_batch_free(batch);
+		return;
+	}
+
+	if (info->batch)
+		riscv_batch_free(info->batch);
+	info->batch = batch;
 }
 
 static int sba_supports_access(struct target *target, unsigned int size_bytes)
@@ -2158,11 +2308,11 @@ static int sample_memory_bus_v1(struct target *target,
 
 	while (timeval_ms() < until_ms) {
 		/*
-		 * batch_run() adds to the batch, so we can't simply reuse the same
-		 * batch over and over. So we create a new one every time through the
+		 * batch_run() adds to the batch, so we can't simply run the same
+		 * batch over and over. So we get an empty one every time through the
 		 * loop.
 		 */
-		struct riscv_batch *batch = riscv_batch_alloc(
+		struct riscv_batch *batch = get_batch(
 			target, 1 + enabled_count * 5 * repeat,
 			info->dmi_busy_delay + info->bus_master_read_delay);
 		if (!batch)
@@ -2210,29 +2360,32 @@ static int sample_memory_bus_v1(struct target *target,
 		}
 
 		if (buf->used + result_bytes >= buf->size) {
-			riscv_batch_free(batch);
+			put_batch(target, batch);
 			break;
 		}
 
 		size_t sbcs_key = riscv_batch_add_dmi_read(batch, DM_SBCS);
 
 		int result = batch_run(target, batch);
-		if (result != ERROR_OK)
+		if (result != ERROR_OK) {
+			put_batch(target, batch);
 			return result;
+		}
 
 		uint32_t sbcs_read = riscv_batch_get_dmi_read_data(batch, sbcs_key);
 		if (get_field(sbcs_read, DM_SBCS_SBBUSYERROR)) {
 			/* Discard this batch (too much hassle to try to recover partial
 			 * data) and try again with a larger delay. */
 			info->bus_master_read_delay += info->bus_master_read_delay / 10 + 1;
+			info->bus_master_read_quiet = 0;
 			dmi_write(target, DM_SBCS, sbcs_read | DM_SBCS_SBBUSYERROR | DM_SBCS_SBERROR);
-			riscv_batch_free(batch);
+			put_batch(target, batch);
 			continue;
 		}
 		if (get_field(sbcs_read, DM_SBCS_SBERROR)) {
 			/* The memory we're sampling was unreadable, somehow. Give up. */
 			dmi_write(target, DM_SBCS, DM_SBCS_SBBUSYERROR | DM_SBCS_SBERROR);
-			riscv_batch_free(batch);
+			put_batch(target, batch);
 			return ERROR_FAIL;
 		}
 
@@ -2253,7 +2406,7 @@ static int sample_memory_bus_v1(struct target *target,
 			}
 		}
 
-		riscv_batch_free(batch);
+		put_batch(target, batch);
 	}
 
 	return ERROR_OK;
@@ -2789,6 +2942,7 @@ static int read_memory_bus_v1(struct target *target, target_addr_t address,
 				return ERROR_FAIL;
 			next_address = sb_read_address(target);
 			info->bus_master_read_delay += info->bus_master_read_delay / 10 + 1;
+			info->bus_master_read_quiet = 0;
 			continue;
 		}
 
@@ -2842,6 +2996,64 @@ static void log_mem_access_result(struct target *target, bool success, int metho
 		LOG_DEBUG("%s", msg);
 }
 
+static struct mem_plan_entry *mem_plan_entry(struct target *target, target_addr_t address)
+{
+	RISCV013_INFO(info);
+	target_addr_t region = address >> MEM_PLAN_REGION_SHIFT;
+
+	return &info->mem_plan[region % MEM_PLAN_SIZE];
+}
+
+static bool mem_plan_should_skip(struct target *target, target_addr_t address,
+		int method, bool read, char **skip_reason)
+{
+	assert(skip_reason);
+
+	struct mem_plan_entry *entry = mem_plan_entry(target, address);
+	if (!entry->valid || entry->region != address >> MEM_PLAN_REGION_SHIFT)
+		return false;
+
+	uint8_t failed = read ? entry->read_failed : entry->write_failed;
+	if (!(failed & (1 << method)))
+		return false;
+
+	/* Try them all again when none of the enabled methods is left. */
+	RISCV_INFO(r);
+	uint8_t enabled = 0;
+	for (unsigned int i = 0; i < RISCV_NUM_MEM_ACCESS_METHODS; i++)
+		if (r->mem_access_methods[i] != RISCV_MEM_ACCESS_UNSPECIFIED)
+			enabled |= 1 << r->mem_access_methods[i];
+	if ((failed & enabled) == enabled)
+		return false;
+
+	LOG_DEBUG("Skipping mem %s via method %d - it failed in this region before.",
+			read ? "read" : "write", method);
+	*skip_reason = "skipped (failed before)";
+	return true;
+}
+
+static void mem_plan_update(struct target *target, target_addr_t address,
+		int method, bool read, bool success)
+{
+	struct mem_plan_entry *entry = mem_plan_entry(target, address);
+	target_addr_t region = address >> MEM_PLAN_REGION_SHIFT;
+
+	if (!entry->valid || entry->region != region) {
+		if (success)
+			return;
+		entry->valid = true;
+		entry->region = region;
+		entry->read_failed = 0;
+		entry->write_failed = 0;
+	}
+
+	uint8_t *failed = read ? &entry->read_failed : &entry->write_failed;
+	if (success)
+		*failed &= ~(1 << method);
+	else
+		*failed |= 1 << method;
+}
+
 static bool mem_should_skip_progbuf(struct target *target, target_addr_t address,
 		uint32_t size, bool read, char **skip_reason)
 {
@@ -3156,7 +3368,7 @@ static int read_memory_progbuf_inner(struct target *target, target_addr_t addres
 		 * dm_data0 contains[read_addr-size*2]
 		 */
 
-		struct riscv_batch *batch = riscv_batch_alloc(target, 32,
+		struct riscv_batch *batch = get_batch(target, 32,
 				info->dmi_busy_delay + info->ac_busy_delay);
 		if (!batch)
 			return ERROR_FAIL;
@@ -3205,11 +3417,11 @@ static int read_memory_progbuf_inner(struct target *target, target_addr_t addres
 				 * attempted to read when we discovered that the target was
 				 * busy. */
 				if (dmi_read(target, &dmi_data0, DM_DATA0) != ERROR_OK) {
-					riscv_batch_free(batch);
+					put_batch(target, batch);
 					goto error;
 				}
 				if (size > 4 && dmi_read(target, &dmi_data1, DM_DATA1) != ERROR_OK) {
-					riscv_batch_free(batch);
+					put_batch(target, batch);
 					goto error;
 				}
 
@@ -3225,7 +3437,7 @@ static int read_memory_progbuf_inner(struct target *target, target_addr_t addres
 					next_index = (next_read_addr - address) / increment;
 				}
 				if (result != ERROR_OK) {
-					riscv_batch_free(batch);
+					put_batch(target, batch);
 					goto error;
 				}
 
@@ -3248,7 +3460,7 @@ static int read_memory_progbuf_inner(struct target *target, target_addr_t addres
 			default:
 				LOG_DEBUG("error when reading memory, abstractcs=0x%08lx", (long)abstractcs);
 				riscv013_clear_abstract_error(target);
-				riscv_batch_free(batch);
+				put_batch(target, batch);
 				result = ERROR_FAIL;
 				goto error;
 		}
@@ -3278,7 +3490,7 @@ static int read_memory_progbuf_inner(struct target *target, target_addr_t addres
 				 * caller to reread the entire block. */
 				LOG_WARNING("Batch memory read encountered DMI error %d. "
 						"Falling back on slower reads.", status);
-				riscv_batch_free(batch);
+				put_batch(target, batch);
 				result = ERROR_FAIL;
 				goto error;
 			}
@@ -3287,7 +3499,7 @@ static int read_memory_progbuf_inner(struct target *target, target_addr_t addres
 				if (status != DMI_STATUS_SUCCESS) {
 					LOG_WARNING("Batch memory read encountered DMI error %d. "
 							"Falling back on slower reads.", status);
-					riscv_batch_free(batch);
+					put_batch(target, batch);
 					result = ERROR_FAIL;
 					goto error;
 				}
@@ -3302,7 +3514,7 @@ static int read_memory_progbuf_inner(struct target *target, target_addr_t addres
 
 		index = next_index;
 
-		riscv_batch_free(batch);
+		put_batch(target, batch);
 	}
 
 	dmi_write(target, DM_ABSTRACTAUTO, 0);
@@ -3551,7 +3763,8 @@ static int read_memory(struct target *target, target_addr_t address,
 		int method = r->mem_access_methods[i];
 
 		if (method == RISCV_MEM_ACCESS_PROGBUF) {
-			if (mem_should_skip_progbuf(target, address, size, true, &progbuf_result))
+			if (mem_plan_should_skip(target, address, method, true, &progbuf_result) ||
+					mem_should_skip_progbuf(target, address, size, true, &progbuf_result))
 				continue;
 
 			ret = read_memory_progbuf(target, address, size, count, buffer, increment);
@@ -3559,7 +3772,8 @@ static int read_memory(struct target *target, target_addr_t address,
 			if (ret != ERROR_OK)
 				progbuf_result = "failed";
 		} else if (method == RISCV_MEM_ACCESS_SYSBUS) {
-			if (mem_should_skip_sysbus(target, address, size, increment, true, &sysbus_result))
+			if (mem_plan_should_skip(target, address, method, true, &sysbus_result) ||
+					mem_should_skip_sysbus(target, address, size, increment, true, &sysbus_result))
 				continue;
 
 			if (get_field(info->sbcs, DM_SBCS_SBVERSION) == 0)
@@ -3570,7 +3784,8 @@ static int read_memory(struct target *target, target_addr_t address,
 			if (ret != ERROR_OK)
 				sysbus_result = "failed";
 		} else if (method == RISCV_MEM_ACCESS_ABSTRACT) {
-			if (mem_should_skip_abstract(target, address, size, increment, true, &abstract_result))
+			if (mem_plan_should_skip(target, address, method, true, &abstract_result) ||
+					mem_should_skip_abstract(target, address, size, increment, true, &abstract_result))
 				continue;
 
 			ret = read_memory_abstract(target, address, size, count, buffer, increment);
@@ -3582,6 +3797,7 @@ static int read_memory(struct target *target, target_addr_t address,
 			break;
 
 		log_mem_access_result(target, ret == ERROR_OK, method, true);
+		mem_plan_update(target, address, method, true, ret == ERROR_OK);
 
 		if (ret == ERROR_OK)
 			return ret;
@@ -3663,7 +3879,7 @@ static int write_memory_bus_v1(struct target *target, target_addr_t address,
 		LOG_DEBUG("transferring burst starting at address 0x%" TARGET_PRIxADDR,
 				next_address);
 
-		struct riscv_batch *batch = riscv_batch_alloc(
+		struct riscv_batch *batch = get_batch(
 				target,
 				32,
 				info->dmi_busy_delay + info->bus_master_write_delay);
@@ -3710,7 +3926,7 @@ static int write_memory_bus_v1(struct target *target, target_addr_t address,
 
 		/* Execute the batch of writes */
 		result = batch_run(target, batch);
-		riscv_batch_free(batch);
+		put_batch(target, batch);
 		if (result != ERROR_OK)
 			return result;
 
@@ -3743,6 +3959,7 @@ static int write_memory_bus_v1(struct target *target, target_addr_t address,
 			dmi_write(target, DM_SBCS, sbcs | DM_SBCS_SBBUSYERROR);
 			/* Slow down before trying again. */
 			info->bus_master_write_delay += info->bus_master_write_delay / 10 + 1;
+			info->bus_master_write_quiet = 0;
 		}
 
 		if (get_field(sbcs, DM_SBCS_SBBUSYERROR) || dmi_busy_encountered) {
@@ -3858,7 +4075,7 @@ static int write_memory_progbuf(struct target *target, target_addr_t address,
 		LOG_DEBUG("transferring burst starting at address 0x%016" PRIx64,
 				cur_addr);
 
-		struct riscv_batch *batch = riscv_batch_alloc(
+		struct riscv_batch *batch = get_batch(
 				target,
 				32,
 				info->dmi_busy_delay + info->ac_busy_delay);
@@ -3880,7 +4097,7 @@ static int write_memory_progbuf(struct target *target, target_addr_t address,
 				result = register_write_direct(target, GDB_REGNO_S0,
 						address + offset);
 				if (result != ERROR_OK) {
-					riscv_batch_free(batch);
+					put_batch(target, batch);
 					goto error;
 				}
 
@@ -3898,7 +4115,7 @@ static int write_memory_progbuf(struct target *target, target_addr_t address,
 						AC_ACCESS_REGISTER_WRITE);
 				result = execute_abstract_command(target, command);
 				if (result != ERROR_OK) {
-					riscv_batch_free(batch);
+					put_batch(target, batch);
 					goto error;
 				}
 
@@ -3917,7 +4134,7 @@ static int write_memory_progbuf(struct target *target, target_addr_t address,
 		}
 
 		result = batch_run(target, batch);
-		riscv_batch_free(batch);
+		put_batch(target, batch);
 		if (result != ERROR_OK)
 			goto error;
 
@@ -3997,7 +4214,8 @@ static int write_memory(struct target *target, target_addr_t address,
 		int method = r->mem_access_methods[i];
 
 		if (method == RISCV_MEM_ACCESS_PROGBUF) {
-			if (mem_should_skip_progbuf(target, address, size, false, &progbuf_result))
+			if (mem_plan_should_skip(target, address, method, false, &progbuf_result) ||
+					mem_should_skip_progbuf(target, address, size, false, &progbuf_result))
 				continue;
 
 			ret = write_memory_progbuf(target, address, size, count, buffer);
@@ -4005,7 +4223,8 @@ static int write_memory(struct target *target, target_addr_t address,
 			if (ret != ERROR_OK)
 				progbuf_result = "failed";
 		} else if (method == RISCV_MEM_ACCESS_SYSBUS) {
-			if (mem_should_skip_sysbus(target, address, size, 0, false, &sysbus_result))
+			if (mem_plan_should_skip(target, address, method, false, &sysbus_result) ||
+					mem_should_skip_sysbus(target, address, size, 0, false, &sysbus_result))
 				continue;
 
 			if (get_field(info->sbcs, DM_SBCS_SBVERSION) == 0)
@@ -4016,7 +4235,8 @@ static int write_memory(struct target *target, target_addr_t address,
 			if (ret != ERROR_OK)
 				sysbus_result = "failed";
 		} else if (method == RISCV_MEM_ACCESS_ABSTRACT) {
-			if (mem_should_skip_abstract(target, address, size, 0, false, &abstract_result))
+			if (mem_plan_should_skip(target, address, method, false, &abstract_result) ||
+					mem_should_skip_abstract(target, address, size, 0, false, &abstract_result))
 				continue;
 
 			ret = write_memory_abstract(target, address, size, count, buffer);
@@ -4028,6 +4248,7 @@ static int write_memory(struct target *target, target_addr_t address,
 			break;
 
 		log_mem_access_result(target, ret == ERROR_OK, method, false);
+		mem_plan_update(target, address, method, false, ret == ERROR_OK);
 
 		if (ret == ERROR_OK)
 			return ret;
@@ -4063,6 +4284,75 @@ struct target_type riscv013_target = {
 };
 
 /*** 0.13-specific implementations of various RISC-V helper functions. ***/
+/* Reads all the GPRs that aren't cached yet into the register cache, with one
+ * batch of abstract commands. cmderr is only checked once, at the end, so the
+ * idle cycles of the batch must cover the execution of each command. */
+static int register_read_gprs(struct target *target)
+{
+	RISCV013_INFO(info);
+	struct reg *reg_list = target->reg_cache->reg_list;
+	unsigned int xlen = riscv_xlen(target);
+	unsigned int last = riscv_supports_extension(target, 'E') ?
+		GDB_REGNO_XPR15 : GDB_REGNO_XPR31;
+	size_t key_lo[GDB_REGNO_XPR31 + 1];
+	size_t key_hi[GDB_REGNO_XPR31 + 1];
+
+	struct riscv_batch *batch = get_batch(target, 3 * GDB_REGNO_XPR31,
+			info->dmi_busy_delay + info->ac_busy_delay);
+	if (!batch)
+		return ERROR_FAIL;
+
+	for (unsigned int number = GDB_REGNO_ZERO + 1; number <= last; number++) {
+		if (reg_list[number].valid)
+			continue;
+		riscv_batch_add_dmi_write(batch, DM_COMMAND,
+				access_register_command(target, number, xlen,
+					AC_ACCESS_REGISTER_TRANSFER));
+		if (xlen > 32)
+			key_hi[number] = riscv_batch_add_dmi_read(batch, DM_DATA1);
+		key_lo[number] = riscv_batch_add_dmi_read(batch, DM_DATA0);
+	}
+
+	int result = batch_run(target, batch);
+
+	uint32_t abstractcs;
+	if (result == ERROR_OK)
+		result = wait_for_idle(target, &abstractcs);
+	if (result == ERROR_OK) {
+		info->cmderr = get_field(abstractcs, DM_ABSTRACTCS_CMDERR);
+		if (info->cmderr != CMDERR_NONE) {
+			LOG_DEBUG("bulk GPR read failed; abstractcs=0x%x", abstractcs);
+			if (info->cmderr == CMDERR_BUSY)
+				increase_ac_busy_delay(target);
+			riscv013_clear_abstract_error(target);
+			result = ERROR_FAIL;
+		}
+	}
+
+	for (unsigned int number = GDB_REGNO_ZERO + 1;
+			result == ERROR_OK && number <= last; number++) {
+		struct reg *reg = &reg_list[number];
+		if (reg->valid)
+			continue;
+
+		/* a DMI busy loses the value, leave the register to a single read */
+		if (riscv_batch_get_dmi_read_op(batch, key_lo[number]) != DMI_STATUS_SUCCESS)
+			continue;
+		uint64_t value = riscv_batch_get_dmi_read_data(batch, key_lo[number]);
+		if (xlen > 32) {
+			if (riscv_batch_get_dmi_read_op(batch, key_hi[number]) != DMI_STATUS_SUCCESS)
+				continue;
+			value |= (uint64_t)riscv_batch_get_dmi_read_data(batch, key_hi[number]) << 32;
+		}
+
+		buf_set_u64(reg->value, 0, reg->size, value);
+		reg->valid = true;
+	}
+
+	put_batch(target, batch);
+	return result;
+}
+
 static int riscv013_get_register(struct target *target,
 		riscv_reg_t *value, int rid)
 {
@@ -4083,6 +4373,11 @@ static int riscv013_get_register(struct target *target,
 		result = register_read(target, &dcsr, GDB_REGNO_DCSR);
 		*value = set_field(0, VIRT_PRIV_V, get_field(dcsr, CSR_DCSR_V));
 		*value = set_field(*value, VIRT_PRIV_PRV, get_field(dcsr, CSR_DCSR_PRV));
+	} else if (rid > GDB_REGNO_ZERO && rid <= GDB_REGNO_XPR31 && target->reg_cache &&
+			register_read_gprs(target) == ERROR_OK &&
+			target->reg_cache->reg_list[rid].valid) {
+		struct reg *reg = &target->reg_cache->reg_list[rid];
+		*value = buf_get_u64(reg->value, 0, reg->size);
 	} else {
 		result = register_read(target, value, rid);
 		if (result != ERROR_OK)
@@ -4281,6 +4576,11 @@ static int riscv013_on_step(struct target *target)
 
 static int riscv013_on_halt(struct target *target)
 {
+	RISCV013_INFO(info);
+
+	/* memory may have been remapped or protected while running */
+	memset(info->mem_plan, 0, sizeof(info->mem_plan));
+
 	return ERROR_OK;
 }
 
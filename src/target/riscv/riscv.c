@@ -513,6 +513,7 @@ static void riscv_deinit_target(struct target *target)
 	}
 
 	free(info->reg_names);
+	free(info->sample_buf.buf);
 	free(target->arch_info);
 
 	target->arch_info = NULL;
@@ -2363,6 +2364,113 @@ COMMAND_HANDLER(riscv_set_reset_timeout_sec)
 	return ERROR_OK;
 }
 
+#define RISCV_SAMPLE_BUF_SIZE	(1024 * 1024)
+
+COMMAND_HANDLER(handle_memory_sample_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	RISCV_INFO(r);
+
+	if (CMD_ARGC == 0) {
+		for (unsigned int i = 0; i < ARRAY_SIZE(r->sample_config.bucket); i++) {
+			if (r->sample_config.bucket[i].enabled)
+				command_print(CMD, "bucket %u: address=" TARGET_ADDR_FMT " size=%" PRIu32,
+						i, r->sample_config.bucket[i].address,
+						r->sample_config.bucket[i].size_bytes);
+		}
+		command_print(CMD, "%u of %u bytes used in the sample buffer",
+				r->sample_buf.used, r->sample_buf.size);
+		return ERROR_OK;
+	}
+
+	if (CMD_ARGC < 2 || CMD_ARGC > 3)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	unsigned int bucket;
+	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], bucket);
+	if (bucket >= ARRAY_SIZE(r->sample_config.bucket)) {
+		command_print(CMD, "Max bucket number is %u.",
+				(unsigned int)ARRAY_SIZE(r->sample_config.bucket) - 1);
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	if (!strcmp(CMD_ARGV[1], "clear")) {
+		if (CMD_ARGC != 2)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+		r->sample_config.bucket[bucket].enabled = false;
+	} else {
+		target_addr_t address;
+		uint32_t size_bytes = 4;
+
+		COMMAND_PARSE_ADDRESS(CMD_ARGV[1], address);
+		if (CMD_ARGC == 3)
+			COMMAND_PARSE_NUMBER(u32, CMD_ARGV[2], size_bytes);
+		if (size_bytes != 4 && size_bytes != 8) {
+			command_print(CMD, "Only 4-byte and 8-byte sizes are supported.");
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+
+		if (!r->sample_buf.buf) {
+			r->sample_buf.buf = malloc(RISCV_SAMPLE_BUF_SIZE);
+			if (!r->sample_buf.buf) {
+				LOG_ERROR("Out of memory");
+				return ERROR_FAIL;
+			}
+			r->sample_buf.size = RISCV_SAMPLE_BUF_SIZE;
+		}
+
+		r->sample_config.bucket[bucket].address = address;
+		r->sample_config.bucket[bucket].size_bytes = size_bytes;
+		r->sample_config.bucket[bucket].enabled = true;
+	}
+
+	/* The samples in the buffer no longer match the configuration. */
+	r->sample_buf.used = 0;
+
+	r->sample_config.enabled = false;
+	for (unsigned int i = 0; i < ARRAY_SIZE(r->sample_config.bucket); i++)
+		if (r->sample_config.bucket[i].enabled)
+			r->sample_config.enabled = true;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_dump_sample_buf_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+	RISCV_INFO(r);
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	unsigned int i = 0;
+	while (i < r->sample_buf.used) {
+		uint8_t command = r->sample_buf.buf[i++];
+		if (command == RISCV_SAMPLE_BUF_TIMESTAMP_BEFORE ||
+				command == RISCV_SAMPLE_BUF_TIMESTAMP_AFTER) {
+			uint32_t timestamp = le_to_h_u32(r->sample_buf.buf + i);
+			i += 4;
+			command_print(CMD, "timestamp %s: %" PRIu32,
+					command == RISCV_SAMPLE_BUF_TIMESTAMP_BEFORE ? "before" : "after",
+					timestamp);
+		} else if (command < ARRAY_SIZE(r->sample_config.bucket)) {
+			uint32_t size_bytes = r->sample_config.bucket[command].size_bytes;
+			uint64_t value = buf_get_u64(r->sample_buf.buf + i, 0, 8 * size_bytes);
+			i += size_bytes;
+			command_print(CMD, TARGET_ADDR_FMT ": %" PRIx64,
+					r->sample_config.bucket[command].address, value);
+		} else {
+			LOG_ERROR("Sample buffer is corrupted at offset %u", i - 1);
+			return ERROR_FAIL;
+		}
+	}
+
+	/* Make room for the next samples. */
+	r->sample_buf.used = 0;
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(riscv_set_mem_access)
 {
 	struct target *target = get_current_target(CMD_CTX);
@@ -2881,6 +2989,21 @@ static const struct command_registration riscv_exec_command_handlers[] = {
 		.usage = "[sec]",
 		.help = "Set the wall-clock timeout (in seconds) after reset is deasserted"
 	},
+	{
+		.name = "memory_sample",
+		.handler = handle_memory_sample_command,
+		.mode = COMMAND_ANY,
+		.usage = "[bucket address|clear [size]]",
+		.help = "Sample a memory location while the target is running, or "
+			"stop sampling it. Without arguments, show the sampled locations."
+	},
+	{
+		.name = "dump_sample_buf",
+		.handler = handle_dump_sample_buf_command,
+		.mode = COMMAND_ANY,
+		.usage = "",
+		.help = "Print the samples collected by memory_sample, and empty the buffer."
+	},
 	{
 		.name = "set_mem_access",
 		.handler = riscv_set_mem_access,
@@ -4417,7 +4540,12 @@ void riscv_add_bscan_tunneled_scan(struct target *target, struct scan_field *fie
 					riscv_bscan_tunneled_scan_context_t *ctxt)
 {
 	jtag_add_ir_scan(target->tap, &select_user4, TAP_IDLE);
+	riscv_add_bscan_tunneled_dr_scan(target, field, ctxt);
+}
 
+void riscv_add_bscan_tunneled_dr_scan(struct target *target, struct scan_field *field,
+					riscv_bscan_tunneled_scan_context_t *ctxt)
+{
 	memset(ctxt->tunneled_dr, 0, sizeof(ctxt->tunneled_dr));
 	if (bscan_tunnel_type == BSCAN_TUNNEL_DATA_REGISTER) {
 		ctxt->tunneled_dr[3].num_bits = 1;
@@ -360,6 +360,10 @@ enum semihosting_result riscv_semihosting(struct target *target, int *retval);
 
 void riscv_add_bscan_tunneled_scan(struct target *target, struct scan_field *field,
 		riscv_bscan_tunneled_scan_context_t *ctxt);
+/* Same, without selecting the tunnel in IR first. Only valid while the IR
+ * still holds the tunnel instruction from an earlier tunneled scan. */
+void riscv_add_bscan_tunneled_dr_scan(struct target *target, struct scan_field *field,
+		riscv_bscan_tunneled_scan_context_t *ctxt);
 
 int riscv_read_by_any_size(struct target *target, target_addr_t address, uint32_t size, uint8_t *buffer);
 int riscv_write_by_any_size(struct target *target, target_addr_t address, uint32_t size, uint8_t *buffer);
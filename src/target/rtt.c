@@ -17,13 +17,23 @@
 #include <target/rtt.h>
 
 #include "target.h"
+#include "trace_recorder.h"
 
-static int read_rtt_channel(struct target *target,
-		const struct rtt_control *ctrl, unsigned int channel_index,
-		enum rtt_channel_type type, struct rtt_channel *channel)
+static void parse_rtt_channel(const uint8_t *buf, target_addr_t address,
+		struct rtt_channel *channel)
+{
+	channel->address = address;
+	channel->name_addr = buf_get_u32(buf + 0, 0, 32);
+	channel->buffer_addr = buf_get_u32(buf + 4, 0, 32);
+	channel->size = buf_get_u32(buf + 8, 0, 32);
+	channel->write_pos = buf_get_u32(buf + 12, 0, 32);
+	channel->read_pos = buf_get_u32(buf + 16, 0, 32);
+	channel->flags = buf_get_u32(buf + 20, 0, 32);
+}
+
+static target_addr_t rtt_channel_address(const struct rtt_control *ctrl,
+		unsigned int channel_index, enum rtt_channel_type type)
 {
-	int ret;
-	uint8_t buf[RTT_CHANNEL_SIZE];
 	target_addr_t address;
 
 	address = ctrl->address + RTT_CB_SIZE + (channel_index * RTT_CHANNEL_SIZE);
@@ -31,22 +41,54 @@ static int read_rtt_channel(struct target *target,
 	if (type == RTT_CHANNEL_TYPE_DOWN)
 		address += ctrl->num_up_channels * RTT_CHANNEL_SIZE;
 
+	return address;
+}
+
+static int read_rtt_channel(struct target *target,
+		const struct rtt_control *ctrl, unsigned int channel_index,
+		enum rtt_channel_type type, struct rtt_channel *channel)
+{
+	int ret;
+	uint8_t buf[RTT_CHANNEL_SIZE];
+	target_addr_t address = rtt_channel_address(ctrl, channel_index, type);
+
 	ret = target_read_buffer(target, address, RTT_CHANNEL_SIZE, buf);
 
 	if (ret != ERROR_OK)
 		return ret;
 
-	channel->address = address;
-	channel->name_addr = buf_get_u32(buf + 0, 0, 32);
-	channel->buffer_addr = buf_get_u32(buf + 4, 0, 32);
-	channel->size = buf_get_u32(buf + 8, 0, 32);
-	channel->write_pos = buf_get_u32(buf + 12, 0, 32);
-	channel->read_pos = buf_get_u32(buf + 16, 0, 32);
-	channel->flags = buf_get_u32(buf + 20, 0, 32);
+	parse_rtt_channel(buf, address, channel);
 
 	return ERROR_OK;
 }
 
+/* Read the descriptions of the first num_channels channels in one access */
+static int read_rtt_channels(struct target *target,
+		const struct rtt_control *ctrl, enum rtt_channel_type type,
+		struct rtt_channel *channels, size_t num_channels)
+{
+	int ret;
+	target_addr_t address = rtt_channel_address(ctrl, 0, type);
+	uint8_t *buf = malloc(num_channels * RTT_CHANNEL_SIZE);
+
+	if (!buf) {
+		LOG_ERROR("rtt: Out of memory");
+		return ERROR_FAIL;
+	}
+
+	ret = target_read_buffer(target, address, num_channels * RTT_CHANNEL_SIZE, buf);
+
+	if (ret == ERROR_OK) {
+		for (size_t i = 0; i < num_channels; i++)
+			parse_rtt_channel(buf + i * RTT_CHANNEL_SIZE,
+				address + i * RTT_CHANNEL_SIZE, &channels[i]);
+	}
+
+	free(buf);
+
+	return ret;
+}
+
 int target_rtt_start(struct target *target, const struct rtt_control *ctrl,
 		void *user_data)
 {
@@ -87,6 +129,23 @@ static int read_channel_name(struct target *target, target_addr_t address,
 	return ERROR_OK;
 }
 
+/* Write len bytes at the write position, wrapping after first_length */
+static int write_channel_data(struct target *target,
+		const struct rtt_channel *channel, uint32_t len,
+		uint32_t first_length, const uint8_t *buffer)
+{
+	int ret;
+
+	ret = target_write_buffer(target,
+		channel->buffer_addr + channel->write_pos, first_length, buffer);
+
+	if (ret != ERROR_OK || len == first_length)
+		return ret;
+
+	return target_write_buffer(target, channel->buffer_addr,
+		len - first_length, buffer + first_length);
+}
+
 static int write_to_channel(struct target *target,
 		const struct rtt_channel *channel, const uint8_t *buffer,
 		size_t *length)
@@ -103,15 +162,7 @@ static int write_to_channel(struct target *target,
 		len = MIN(*length, channel->size - 1);
 		first_length = MIN(len, channel->size - channel->write_pos);
 
-		ret = target_write_buffer(target,
-			channel->buffer_addr + channel->write_pos, first_length,
-			buffer);
-
-		if (ret != ERROR_OK)
-			return ret;
-
-		ret = target_write_buffer(target, channel->buffer_addr,
-			len - first_length, buffer + first_length);
+		ret = write_channel_data(target, channel, len, first_length, buffer);
 
 		if (ret != ERROR_OK)
 			return ret;
@@ -141,17 +192,7 @@ static int write_to_channel(struct target *target,
 
 		first_length = MIN(len, channel->size - channel->write_pos);
 
-		ret = target_write_buffer(target,
-			channel->buffer_addr + channel->write_pos, first_length,
-			buffer);
-
-		if (ret != ERROR_OK)
-			return ret;
-
-		buffer = buffer + first_length;
-
-		ret = target_write_buffer(target, channel->buffer_addr,
-			len - first_length, buffer);
+		ret = write_channel_data(target, channel, len, first_length, buffer);
 
 		if (ret != ERROR_OK)
 			return ret;
@@ -238,48 +279,71 @@ int target_rtt_read_control_block(struct target *target,
 	return ERROR_OK;
 }
 
+/* Target memory read at once by the control block search */
+#define RTT_CB_SEARCH_CHUNK	16384
+
 int target_rtt_find_control_block(struct target *target,
 		target_addr_t *address, size_t size, const char *id, bool *found,
 		void *user_data)
 {
 	target_addr_t address_end = *address + size;
-	uint8_t buf[1024];
+	const size_t id_length = strlen(id);
+	/* length of the longest proper prefix of id[0..i] also a suffix of it */
+	size_t prefix[RTT_CB_MAX_ID_LENGTH];
+	uint8_t *buf;
 
 	*found = false;
 
-	size_t id_matched_length = 0;
-	const size_t id_length = strlen(id);
+	if (!id_length || id_length >= RTT_CB_MAX_ID_LENGTH)
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+
+	prefix[0] = 0;
+	for (size_t i = 1, k = 0; i < id_length; i++) {
+		while (k > 0 && id[i] != id[k])
+			k = prefix[k - 1];
+		if (id[i] == id[k])
+			k++;
+		prefix[i] = k;
+	}
+
+	buf = malloc(RTT_CB_SEARCH_CHUNK);
+	if (!buf) {
+		LOG_ERROR("rtt: Out of memory");
+		return ERROR_FAIL;
+	}
 
 	LOG_INFO("rtt: Searching for control block '%s'", id);
 
-	for (target_addr_t addr = *address; addr < address_end; addr += sizeof(buf)) {
-		int ret;
+	/* the match state carries over the chunk boundaries */
+	size_t id_matched_length = 0;
+	int ret = ERROR_OK;
 
-		const size_t buf_size = MIN(sizeof(buf), address_end - addr);
+	for (target_addr_t addr = *address; addr < address_end; addr += RTT_CB_SEARCH_CHUNK) {
+		const size_t buf_size = MIN(RTT_CB_SEARCH_CHUNK, address_end - addr);
 		ret = target_read_buffer(target, addr, buf_size, buf);
 
 		if (ret != ERROR_OK)
-			return ret;
+			break;
 
 		for (size_t buf_off = 0; buf_off < buf_size; buf_off++) {
-			if (id_matched_length > 0 &&
-			    buf[buf_off] != id[id_matched_length]) {
-				/* Start from beginning */
-				id_matched_length = 0;
-			}
+			while (id_matched_length > 0 && buf[buf_off] != (uint8_t)id[id_matched_length])
+				id_matched_length = prefix[id_matched_length - 1];
 
-			if (buf[buf_off] == id[id_matched_length])
+			if (buf[buf_off] == (uint8_t)id[id_matched_length])
 				id_matched_length++;
 
 			if (id_matched_length == id_length) {
 				*address = addr + buf_off + 1 - id_length;
 				*found = true;
+				free(buf);
 				return ERROR_OK;
 			}
 		}
 	}
 
-	return ERROR_OK;
+	free(buf);
+
+	return ret;
 }
 
 int target_rtt_read_channel_info(struct target *target,
@@ -365,48 +429,76 @@ static int read_from_channel(struct target *target,
 
 int target_rtt_read_callback(struct target *target,
 		const struct rtt_control *ctrl, struct rtt_sink_list **sinks,
-		size_t num_channels, void *user_data)
+		struct rtt_channel_poll *poll, size_t num_channels, void *user_data)
 {
+	struct rtt_channel *channels;
+	int ret;
+
 	num_channels = MIN(num_channels, ctrl->num_up_channels);
 
+	/* only the channels up to the last one with a sink are needed */
+	while (num_channels > 0 && !sinks[num_channels - 1])
+		num_channels--;
+
+	if (!num_channels)
+		return ERROR_OK;
+
+	channels = malloc(num_channels * sizeof(*channels));
+
+	if (!channels) {
+		LOG_ERROR("rtt: Out of memory");
+		return ERROR_FAIL;
+	}
+
+	ret = read_rtt_channels(target, ctrl, RTT_CHANNEL_TYPE_UP, channels,
+		num_channels);
+
+	if (ret != ERROR_OK) {
+		LOG_ERROR("rtt: Failed to read up-channel descriptions");
+		free(channels);
+		return ret;
+	}
+
 	for (size_t i = 0; i < num_channels; i++) {
-		int ret;
-		struct rtt_channel channel;
+		struct rtt_channel *channel = &channels[i];
 		uint8_t buffer[1024];
 		size_t length;
 
 		if (!sinks[i])
 			continue;
 
-		ret = read_rtt_channel(target, ctrl, i, RTT_CHANNEL_TYPE_UP,
-			&channel);
-
-		if (ret != ERROR_OK) {
-			LOG_ERROR("rtt: Failed to read up-channel %zu description", i);
-			return ret;
-		}
-
-		if (!channel_is_active(&channel)) {
+		if (!channel_is_active(channel)) {
 			LOG_WARNING("rtt: Up-channel %zu is not active", i);
 			continue;
 		}
 
-		if (channel.size < RTT_CHANNEL_BUFFER_MIN_SIZE) {
+		if (channel->size < RTT_CHANNEL_BUFFER_MIN_SIZE) {
 			LOG_WARNING("rtt: Up-channel %zu is not large enough", i);
 			continue;
 		}
 
 		length = sizeof(buffer);
-		ret = read_from_channel(target, &channel, buffer, &length);
+		ret = read_from_channel(target, channel, buffer, &length);
 
 		if (ret != ERROR_OK) {
 			LOG_ERROR("rtt: Failed to read from up-channel %zu", i);
-			return ret;
+			break;
 		}
 
+		poll[i].size = channel->size;
+		poll[i].pending = (channel->write_pos + channel->size - channel->read_pos)
+			% channel->size;
+		poll[i].bytes += length;
+		if (poll[i].pending == channel->size - 1)
+			poll[i].full++;
+
+		trace_recorder_write(TRACE_RECORDER_SRC_RTT, i, buffer, length);
+
 		for (struct rtt_sink_list *sink = sinks[i]; sink; sink = sink->next)
 			sink->read(i, buffer, length, sink->user_data);
 	}
 
-	return ERROR_OK;
+	free(channels);
+
+	return ret;
 }
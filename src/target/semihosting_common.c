@@ -36,6 +36,7 @@
 #include "target.h"
 #include "target_type.h"
 #include "semihosting_common.h"
+#include "trace_recorder.h"
 
 #include <helper/binarybuffer.h>
 #include <helper/log.h>
@@ -139,6 +140,12 @@ int semihosting_common_init(struct target *target, void *setup,
 	semihosting->sys_errno = -1;
 	semihosting->cmdline = NULL;
 	semihosting->basedir = NULL;
+	semihosting->io_buf = NULL;
+	semihosting->io_buf_size = 0;
+	semihosting->out_buf = NULL;
+	semihosting->out_len = 0;
+	semihosting->out_fd = -1;
+	semihosting->out_timer = false;
 
 	/* If possible, update it in setup(). */
 	semihosting->setup_time = clock();
@@ -211,6 +218,8 @@ static ssize_t semihosting_redirect_write(struct semihosting *semihosting, void
 
 	struct semihosting_tcp_service *service = semihosting->tcp_connection->service->priv;
 
+	trace_recorder_write(TRACE_RECORDER_SRC_SEMIHOSTING, STDOUT_FILENO, buf, size);
+
 	int retval = connection_write(semihosting->tcp_connection, buf, size);
 
 	if (retval < 0)
@@ -219,11 +228,128 @@ static ssize_t semihosting_redirect_write(struct semihosting *semihosting, void
 	return retval;
 }
 
+/* Target memory read at once by SYS_WRITE0, also its alignment */
+#define SEMIHOSTING_WRITE0_CHUNK	64
+
+/* Smallest size of the buffer kept for SYS_READ and SYS_WRITE */
+#define SEMIHOSTING_IO_BUF_MIN	256
+
+/**
+ * Returns a buffer of at least len bytes for the data of SYS_READ and
+ * SYS_WRITE. The buffer is kept for the next calls, and only grows.
+ */
+static uint8_t *semihosting_io_buf(struct semihosting *semihosting, size_t len)
+{
+	if (len > semihosting->io_buf_size || !semihosting->io_buf) {
+		size_t size = MAX(len, SEMIHOSTING_IO_BUF_MIN);
+		uint8_t *buf = realloc(semihosting->io_buf, size);
+		if (!buf)
+			return NULL;
+		semihosting->io_buf = buf;
+		semihosting->io_buf_size = size;
+	}
+
+	return semihosting->io_buf;
+}
+
+static int semihosting_out_timer_callback(void *priv);
+
+/* Console output kept on the host before writing it */
+#define SEMIHOSTING_OUT_BUF_SIZE	4096
+/* Longest time console output stays buffered */
+#define SEMIHOSTING_OUT_FLUSH_MS	20
+
+/**
+ * Writes the buffered console output. It is called before any semihosting
+ * operation other than a write, so that the output is complete when the
+ * target exits, closes a file or waits for input.
+ */
+void semihosting_flush_output(struct semihosting *semihosting)
+{
+	if (semihosting->out_timer) {
+		target_unregister_timer_callback(semihosting_out_timer_callback, semihosting);
+		semihosting->out_timer = false;
+	}
+
+	if (!semihosting->out_len)
+		return;
+
+	/* keep the order with other users of the process stdout */
+	if (semihosting->out_fd == STDOUT_FILENO)
+		fflush(stdout);
+
+	size_t done = 0;
+	while (done < semihosting->out_len) {
+		ssize_t written = write(semihosting->out_fd, semihosting->out_buf + done,
+			semihosting->out_len - done);
+		if (written <= 0) {
+			LOG_ERROR("semihosting: failed to write %zu bytes of console output",
+				semihosting->out_len - done);
+			break;
+		}
+		done += written;
+	}
+	semihosting->out_len = 0;
+}
+
+static int semihosting_out_timer_callback(void *priv)
+{
+	struct semihosting *semihosting = priv;
+
+	/* the one-shot timer is already removed */
+	semihosting->out_timer = false;
+	semihosting_flush_output(semihosting);
+
+	return ERROR_OK;
+}
+
+/**
+ * Copies console output into the host buffer, so that the target is resumed
+ * without waiting for a slow terminal or pipe.
+ */
+static ssize_t semihosting_buffer_output(struct semihosting *semihosting, int fd,
+	const void *buf, size_t size)
+{
+	if (!semihosting->out_buf) {
+		semihosting->out_buf = malloc(SEMIHOSTING_OUT_BUF_SIZE);
+		if (!semihosting->out_buf) {
+			semihosting->sys_errno = ENOMEM;
+			return -1;
+		}
+	}
+
+	trace_recorder_write(TRACE_RECORDER_SRC_SEMIHOSTING, fd, buf, size);
+
+	if (fd != semihosting->out_fd || semihosting->out_len + size > SEMIHOSTING_OUT_BUF_SIZE)
+		semihosting_flush_output(semihosting);
+	semihosting->out_fd = fd;
+
+	if (size > SEMIHOSTING_OUT_BUF_SIZE) {
+		int result = write(fd, buf, size);
+		if (result == -1)
+			semihosting->sys_errno = errno;
+		return result;
+	}
+
+	memcpy(semihosting->out_buf + semihosting->out_len, buf, size);
+	semihosting->out_len += size;
+
+	if (!semihosting->out_timer &&
+		target_register_timer_callback(semihosting_out_timer_callback, SEMIHOSTING_OUT_FLUSH_MS,
+			TARGET_TIMER_TYPE_ONESHOT, semihosting) == ERROR_OK)
+		semihosting->out_timer = true;
+
+	return size;
+}
+
 static ssize_t semihosting_write(struct semihosting *semihosting, int fd, void *buf, int size)
 {
 	if (semihosting_is_redirected(semihosting, fd))
 		return semihosting_redirect_write(semihosting, buf, size);
 
+	if (fd >= 0 && (fd == semihosting->stdout_fd || fd == semihosting->stderr_fd))
+		return semihosting_buffer_output(semihosting, fd, buf, size);
+
 	/* default write */
 	int result = write(fd, buf, size);
 	if (result == -1)
@@ -263,7 +389,19 @@ static inline int semihosting_putchar(struct semihosting *semihosting, int fd, i
 		return semihosting_redirect_write(semihosting, &c, 1);
 
 	/* default putchar */
-	return putchar(c);
+	unsigned char ch = c;
+	if (semihosting_buffer_output(semihosting, STDOUT_FILENO, &ch, 1) != 1)
+		return EOF;
+	return ch;
+}
+
+/* debug channel output of SYS_WRITE0 */
+static ssize_t semihosting_puts(struct semihosting *semihosting, int fd, const void *buf, size_t size)
+{
+	if (semihosting_is_redirected(semihosting, fd))
+		return semihosting_redirect_write(semihosting, (void *)buf, size);
+
+	return semihosting_buffer_output(semihosting, STDOUT_FILENO, buf, size);
 }
 
 static inline ssize_t semihosting_read(struct semihosting *semihosting, int fd, void *buf, int size)
@@ -398,6 +536,11 @@ int semihosting_common(struct target *target)
 			  semihosting_opcode_to_str(semihosting->op),
 			  semihosting->param);
 
+	/* make the buffered console output visible before anything else */
+	if (semihosting->op != SEMIHOSTING_SYS_WRITE && semihosting->op != SEMIHOSTING_SYS_WRITEC &&
+		semihosting->op != SEMIHOSTING_SYS_WRITE0)
+		semihosting_flush_output(semihosting);
+
 	switch (semihosting->op) {
 
 		case SEMIHOSTING_SYS_CLOCK:	/* 0x10 */
@@ -1049,7 +1192,7 @@ int semihosting_common(struct target *target)
 					fileio_info->param_2 = addr;
 					fileio_info->param_3 = len;
 				} else {
-					uint8_t *buf = malloc(len);
+					uint8_t *buf = semihosting_io_buf(semihosting, len);
 					if (!buf) {
 						semihosting->result = -1;
 						semihosting->sys_errno = ENOMEM;
@@ -1064,15 +1207,12 @@ int semihosting_common(struct target *target)
 							retval = target_write_buffer(target, addr,
 									semihosting->result,
 									buf);
-							if (retval != ERROR_OK) {
-								free(buf);
+							if (retval != ERROR_OK)
 								return retval;
-							}
 							/* the number of bytes NOT filled in */
 							semihosting->result = len -
 								semihosting->result;
 						}
-						free(buf);
 					}
 				}
 			}
@@ -1385,16 +1525,14 @@ int semihosting_common(struct target *target)
 					fileio_info->param_2 = addr;
 					fileio_info->param_3 = len;
 				} else {
-					uint8_t *buf = malloc(len);
+					uint8_t *buf = semihosting_io_buf(semihosting, len);
 					if (!buf) {
 						semihosting->result = -1;
 						semihosting->sys_errno = ENOMEM;
 					} else {
 						retval = target_read_buffer(target, addr, len, buf);
-						if (retval != ERROR_OK) {
-							free(buf);
+						if (retval != ERROR_OK)
 							return retval;
-						}
 						semihosting->result = semihosting_write(semihosting, fd, buf, len);
 						LOG_DEBUG("write(%d, 0x%" PRIx64 ", %zu)=%" PRId64,
 							fd,
@@ -1407,8 +1545,6 @@ int semihosting_common(struct target *target)
 							semihosting->result = len -
 								semihosting->result;
 						}
-
-						free(buf);
 					}
 				}
 			}
@@ -1476,15 +1612,28 @@ int semihosting_common(struct target *target)
 				fileio_info->param_3 = count;
 			} else {
 				uint64_t addr = semihosting->param;
-				do {
-					unsigned char c;
-					retval = target_read_memory(target, addr++, 1, 1, &c);
-					if (retval != ERROR_OK)
-						return retval;
-					if (!c)
-						break;
-					semihosting_putchar(semihosting, semihosting->stdout_fd, c);
-				} while (1);
+				bool end = false;
+				while (!end) {
+					/* read up to the next aligned chunk, so that no read
+					 * crosses into a possibly unmapped region */
+					uint8_t chunk[SEMIHOSTING_WRITE0_CHUNK];
+					size_t count = SEMIHOSTING_WRITE0_CHUNK - (addr % SEMIHOSTING_WRITE0_CHUNK);
+					retval = target_read_buffer(target, addr, count, chunk);
+					if (retval != ERROR_OK) {
+						count = 1;
+						retval = target_read_memory(target, addr, 1, 1, chunk);
+						if (retval != ERROR_OK)
+							return retval;
+					}
+					uint8_t *nul = memchr(chunk, '\0', count);
+					if (nul) {
+						count = nul - chunk;
+						end = true;
+					}
+					if (count)
+						semihosting_puts(semihosting, semihosting->stdout_fd, chunk, count);
+					addr += count;
+				}
 				semihosting->result = 0;
 			}
 			break;
@@ -177,6 +177,17 @@ struct semihosting {
 	/** Base directory for semihosting I/O operations. */
 	char *basedir;
 
+	/** Buffer reused for the data of SYS_READ and SYS_WRITE. */
+	uint8_t *io_buf;
+	size_t io_buf_size;
+
+	/** Console output not yet written to the host, and its file descriptor. */
+	uint8_t *out_buf;
+	size_t out_len;
+	int out_fd;
+	/** A one-shot timer is pending to flush the console output. */
+	bool out_timer;
+
 	/**
 	 * Target's extension of semihosting user commands.
 	 * @returns ERROR_NOT_IMPLEMENTED when user command is not handled, otherwise
@@ -191,6 +202,7 @@ struct semihosting {
 int semihosting_common_init(struct target *target, void *setup,
 	void *post_result);
 int semihosting_common(struct target *target);
+void semihosting_flush_output(struct semihosting *semihosting);
 
 /* utility functions which may also be used by semihosting extensions (custom vendor-defined syscalls) */
 int semihosting_read_fields(struct target *target, size_t number,
@@ -38,6 +38,7 @@
 
 #include "target.h"
 #include "target_type.h"
+#include "mem_cache.h"
 #include "target_request.h"
 #include "breakpoints.h"
 #include "register.h"
@@ -110,7 +111,10 @@ static struct target_timer_callback *target_timer_callbacks;
 static int64_t target_timer_next_event_value;
 static OOCD_LIST_HEAD(target_reset_callback_list);
 static OOCD_LIST_HEAD(target_trace_callback_list);
+static OOCD_LIST_HEAD(target_reclaim_callback_list);
 static const int polling_interval = TARGET_DEFAULT_POLLING_INTERVAL;
+/* longest polling period of a target running without change, 0 to disable */
+static unsigned int polling_idle_max;
 static OOCD_LIST_HEAD(empty_smp_targets);
 
 enum nvp_assert {
@@ -484,9 +488,12 @@ int target_poll(struct target *target)
 		return ERROR_FAIL;
 	}
 
+	target->polls++;
 	retval = target->type->poll(target);
-	if (retval != ERROR_OK)
+	if (retval != ERROR_OK) {
+		target->poll_errors++;
 		return retval;
+	}
 
 	if (target->halt_issued) {
 		if (target->state == TARGET_HALTED)
@@ -565,6 +572,7 @@ int target_resume(struct target *target, bool current, target_addr_t address,
 	}
 
 	target_call_event_callbacks(target, TARGET_EVENT_RESUME_START);
+	target_mem_cache_invalidate(target);
 
 	/* note that resume *must* be asynchronous. The CPU can halt before
 	 * we poll. The CPU can even halt at the current PC as a result of
@@ -789,6 +797,7 @@ int target_run_algorithm(struct target *target,
 		goto done;
 	}
 
+	target_mem_cache_invalidate(target);
 	target->running_alg = true;
 	retval = target->type->run_algorithm(target,
 			num_mem_params, mem_params,
@@ -834,6 +843,7 @@ int target_start_algorithm(struct target *target,
 		goto done;
 	}
 
+	target_mem_cache_invalidate(target);
 	target->running_alg = true;
 	retval = target->type->start_algorithm(target,
 			num_mem_params, mem_params,
@@ -972,26 +982,33 @@ int target_run_flash_async_algorithm(struct target *target,
 		return retval;
 	}
 
+	/* The algorithm only ever advances rp, so the free space computed from
+	 * a previously read rp is a lower bound of the real one. Poll rp only
+	 * once that space is used up, e.g. not after the write wrapping the fifo. */
+	bool rp_stale = true;
+
 	while (count > 0) {
 
-		retval = target_read_u32(target, rp_addr, &rp);
-		if (retval != ERROR_OK) {
-			LOG_ERROR("failed to get read pointer");
-			break;
-		}
+		if (rp_stale) {
+			retval = target_read_u32(target, rp_addr, &rp);
+			if (retval != ERROR_OK) {
+				LOG_ERROR("failed to get read pointer");
+				break;
+			}
 
-		LOG_DEBUG("offs 0x%zx count 0x%" PRIx32 " wp 0x%" PRIx32 " rp 0x%" PRIx32,
-			(size_t) (buffer - buffer_orig), count, wp, rp);
+			LOG_DEBUG("offs 0x%zx count 0x%" PRIx32 " wp 0x%" PRIx32 " rp 0x%" PRIx32,
+				(size_t) (buffer - buffer_orig), count, wp, rp);
 
-		if (rp == 0) {
-			LOG_ERROR("flash write algorithm aborted by target");
-			retval = ERROR_FLASH_OPERATION_FAILED;
-			break;
-		}
+			if (rp == 0) {
+				LOG_ERROR("flash write algorithm aborted by target");
+				retval = ERROR_FLASH_OPERATION_FAILED;
+				break;
+			}
 
-		if (!IS_ALIGNED(rp - fifo_start_addr, block_size) || rp < fifo_start_addr || rp >= fifo_end_addr) {
-			LOG_ERROR("corrupted fifo read pointer 0x%" PRIx32, rp);
-			break;
+			if (!IS_ALIGNED(rp - fifo_start_addr, block_size) || rp < fifo_start_addr || rp >= fifo_end_addr) {
+				LOG_ERROR("corrupted fifo read pointer 0x%" PRIx32, rp);
+				break;
+			}
 		}
 
 		/* Count the number of bytes available in the fifo without
@@ -1005,6 +1022,12 @@ int target_run_flash_async_algorithm(struct target *target,
 		else
 			thisrun_bytes = fifo_end_addr - wp - block_size;
 
+		if (thisrun_bytes == 0 && !rp_stale) {
+			/* the space known from the last rp is used up, poll it again */
+			rp_stale = true;
+			continue;
+		}
+
 		if (thisrun_bytes == 0) {
 			/* Throttle polling a bit if transfer is (much) faster than flash
 			 * programming. The exact delay shouldn't matter as long as it's
@@ -1049,6 +1072,8 @@ int target_run_flash_async_algorithm(struct target *target,
 		if (retval != ERROR_OK)
 			break;
 
+		rp_stale = false;
+
 		/* Avoid GDB timeouts */
 		keep_alive();
 	}
@@ -1246,7 +1271,7 @@ int target_read_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support read_memory", target_name(target));
 		return ERROR_FAIL;
 	}
-	return target->type->read_memory(target, address, size, count, buffer);
+	return target_mem_cache_read(target, address, size, count, buffer);
 }
 
 int target_read_phys_memory(struct target *target,
@@ -1274,6 +1299,7 @@ int target_write_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support write_memory", target_name(target));
 		return ERROR_FAIL;
 	}
+	target_mem_cache_invalidate(target);
 	return target->type->write_memory(target, address, size, count, buffer);
 }
 
@@ -1288,6 +1314,7 @@ int target_write_phys_memory(struct target *target,
 		LOG_ERROR("Target %s doesn't support write_phys_memory", target_name(target));
 		return ERROR_FAIL;
 	}
+	target_mem_cache_invalidate(target);
 	return target->type->write_phys_memory(target, address, size, count, buffer);
 }
 
@@ -1399,6 +1426,22 @@ int target_get_gdb_reg_list_noread(struct target *target,
 	return target_get_gdb_reg_list(target, reg_list, reg_list_size, reg_class);
 }
 
+int target_fetch_regs(struct target *target, struct reg **reg_list,
+		int reg_list_size)
+{
+	if (!target->type->fetch_regs)
+		return ERROR_OK;
+
+	for (int i = 0; i < reg_list_size; i++) {
+		struct reg *reg = reg_list[i];
+		if (reg && reg->exist && !reg->valid)
+			return target->type->fetch_regs(target, reg_list, reg_list_size);
+	}
+
+	/* nothing to fetch */
+	return ERROR_OK;
+}
+
 bool target_supports_gdb_connection(const struct target *target)
 {
 	/*
@@ -1414,6 +1457,7 @@ int target_step(struct target *target,
 	int retval;
 
 	target_call_event_callbacks(target, TARGET_EVENT_STEP_START);
+	target_mem_cache_invalidate(target);
 
 	retval = target->type->step(target, current, address, handle_breakpoints);
 	if (retval != ERROR_OK)
@@ -1656,6 +1700,27 @@ int target_register_trace_callback(int (*callback)(struct target *target,
 	return ERROR_OK;
 }
 
+int target_register_reclaim_callback(void (*callback)(struct target *target,
+		void *priv), void *priv)
+{
+	struct target_reclaim_callback *entry;
+
+	if (!callback)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	entry = malloc(sizeof(struct target_reclaim_callback));
+	if (!entry) {
+		LOG_ERROR("error allocating buffer for reclaim callback entry");
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	entry->callback = callback;
+	entry->priv = priv;
+	list_add(&entry->list, &target_reclaim_callback_list);
+
+	return ERROR_OK;
+}
+
 int target_register_timer_callback(int (*callback)(void *priv),
 		unsigned int time_ms, enum target_timer_type type, void *priv)
 {
@@ -1767,6 +1832,20 @@ int target_call_event_callbacks(struct target *target, enum target_event event)
 	struct target_event_callback *callback = target_event_callbacks;
 	struct target_event_callback *next_callback;
 
+	switch (event) {
+	case TARGET_EVENT_HALTED:
+	case TARGET_EVENT_DEBUG_HALTED:
+	case TARGET_EVENT_RESUMED:
+	case TARGET_EVENT_DEBUG_RESUMED:
+	case TARGET_EVENT_RESET_ASSERT:
+	case TARGET_EVENT_RESET_END:
+		/* memory may have changed while the target was not halted */
+		target_mem_cache_invalidate(target);
+		break;
+	default:
+		break;
+	}
+
 	if (event == TARGET_EVENT_HALTED) {
 		/* execute early halted first */
 		target_call_event_callbacks(target, TARGET_EVENT_GDB_HALT);
@@ -1836,12 +1915,18 @@ static int target_call_timer_callbacks_check_time(int checktime)
 	if (callback_processing)
 		return ERROR_OK;
 
-	callback_processing = true;
-
 	keep_alive();
 
 	int64_t now = timeval_ms();
 
+	/* Nothing is due before the next event computed by the last walk or
+	 * lowered by target_register_timer_callback(). The server loop calls
+	 * this far more often than the timers expire, skip the list walk. */
+	if (checktime && now < target_timer_next_event_value)
+		return ERROR_OK;
+
+	callback_processing = true;
+
 	/* Initialize to a default value that's a ways into the future.
 	 * The loop below will make it closer to now if there are
 	 * callbacks that want to be called sooner. */
@@ -1896,13 +1981,26 @@ int64_t target_timer_next_event(void)
 static void print_wa_layout(struct target *target)
 {
 	struct working_area *c = target->working_areas;
+	uint32_t free_total = 0, free_max = 0;
+	unsigned int free_count = 0;
 
 	while (c) {
 		LOG_DEBUG("%c%c " TARGET_ADDR_FMT "-" TARGET_ADDR_FMT " (%" PRIu32 " bytes)",
 			c->backup ? 'b' : ' ', c->free ? ' ' : '*',
 			c->address, c->address + c->size - 1, c->size);
+		if (c->free) {
+			free_total += c->size;
+			free_max = MAX(free_max, c->size);
+			free_count++;
+		}
 		c = c->next;
 	}
+
+	/* fragmentation: share of the free space not in the largest free area */
+	if (free_total)
+		LOG_DEBUG("%" PRIu32 " bytes free in %u areas, largest %" PRIu32 " bytes, %u%% fragmented",
+			free_total, free_count, free_max,
+			(unsigned int)(100 - (uint64_t)free_max * 100 / free_total));
 }
 
 /* Reduce area to size bytes, create a new free area from the remaining bytes, if any. */
@@ -1964,6 +2062,23 @@ static void target_merge_working_areas(struct target *target)
 	}
 }
 
+/* Find the smallest large enough working area, so that small allocations
+ * do not split the large free areas other users may need later */
+static struct working_area *target_find_working_area(struct target *target, uint32_t size)
+{
+	struct working_area *c = NULL;
+
+	for (struct working_area *wa = target->working_areas; wa; wa = wa->next) {
+		if (wa->free && wa->size >= size && (!c || wa->size < c->size)) {
+			c = wa;
+			if (c->size == size)
+				break;
+		}
+	}
+
+	return c;
+}
+
 int target_alloc_working_area_try(struct target *target, uint32_t size, struct working_area **area)
 {
 	/* Reevaluate working area address based on MMU state*/
@@ -2016,13 +2131,13 @@ int target_alloc_working_area_try(struct target *target, uint32_t size, struct w
 	/* only allocate multiples of 4 byte */
 	size = ALIGN_UP(size, 4);
 
-	struct working_area *c = target->working_areas;
-
-	/* Find the first large enough working area */
-	while (c) {
-		if (c->free && c->size >= size)
-			break;
-		c = c->next;
+	struct working_area *c = target_find_working_area(target, size);
+	if (!c && !list_empty(&target_reclaim_callback_list)) {
+		/* free what is only kept for reuse, and try again */
+		struct target_reclaim_callback *callback;
+		list_for_each_entry(callback, &target_reclaim_callback_list, list)
+			callback->callback(target, callback->priv);
+		c = target_find_working_area(target, size);
 	}
 
 	if (!c)
@@ -2188,8 +2303,12 @@ static void target_destroy(struct target *target)
 	if (target->type->deinit_target)
 		target->type->deinit_target(target);
 
-	if (target->semihosting)
+	if (target->semihosting) {
+		semihosting_flush_output(target->semihosting);
 		free(target->semihosting->basedir);
+		free(target->semihosting->io_buf);
+		free(target->semihosting->out_buf);
+	}
 	free(target->semihosting);
 
 	jtag_unregister_event_callback(jtag_enable_callback, target);
@@ -2203,6 +2322,7 @@ static void target_destroy(struct target *target)
 	}
 
 	target_free_all_working_areas(target);
+	target_mem_cache_free(target);
 
 	/* release the targets SMP list */
 	if (target->smp) {
@@ -2221,6 +2341,7 @@ static void target_destroy(struct target *target)
 	rtos_destroy(target);
 
 	free(target->gdb_port_override);
+	free(target->gdb_tdesc);
 	free(target->type);
 	free(target->trace_info);
 	free(target->fileio_info);
@@ -2304,6 +2425,7 @@ int target_profiling_default(struct target *target, uint32_t *samples,
 	struct reg *reg = register_get_by_name(target->reg_cache, "pc", true);
 
 	int retval = ERROR_OK;
+	int64_t halt_start = timeval_ms();
 	for (;;) {
 		target_poll(target);
 		if (target->state == TARGET_HALTED) {
@@ -2312,9 +2434,13 @@ int target_profiling_default(struct target *target, uint32_t *samples,
 			/* current pc, addr = 0, do not handle breakpoints, not debugging */
 			retval = target_resume(target, true, 0, false, false);
 			target_poll(target);
-			alive_sleep(10); /* sleep 10ms, i.e. <100 samples/second. */
+			/* let the target run at least as long as it was stopped, so
+			 * the sample rate follows the adapter speed while sampling
+			 * keeps stealing at most half of the target time */
+			alive_sleep(MAX(timeval_ms() - halt_start, 1));
 		} else if (target->state == TARGET_RUNNING) {
 			/* We want to quickly sample the PC. */
+			halt_start = timeval_ms();
 			retval = target_halt(target);
 		} else {
 			LOG_INFO("Target not halted or running");
@@ -2361,6 +2487,7 @@ int target_write_buffer(struct target *target, target_addr_t address, uint32_t s
 		return ERROR_FAIL;
 	}
 
+	target_mem_cache_invalidate(target);
 	return target->type->write_buffer(target, address, size, buffer);
 }
 
@@ -2572,6 +2699,26 @@ int target_read_u32(struct target *target, target_addr_t address, uint32_t *valu
 	return retval;
 }
 
+int target_read_u32_batch(struct target *target, const target_addr_t *address,
+		uint32_t *value, unsigned int count)
+{
+	if (!target_was_examined(target)) {
+		LOG_ERROR("Target not examined yet");
+		return ERROR_FAIL;
+	}
+
+	if (target->type->read_u32_batch)
+		return target->type->read_u32_batch(target, address, value, count);
+
+	for (unsigned int i = 0; i < count; i++) {
+		int retval = target_read_u32(target, address[i], &value[i]);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	return ERROR_OK;
+}
+
 int target_read_u16(struct target *target, target_addr_t address, uint16_t *value)
 {
 	uint8_t value_buf[2];
@@ -2981,10 +3128,29 @@ static int handle_target(void *priv)
 		}
 		target->backoff.count = 0;
 
+		if (target->idle.times > target->idle.count) {
+			/* do not poll this time, the target has not changed for a while */
+			target->idle.count++;
+			continue;
+		}
+		target->idle.count = 0;
+
 		/* only poll target if we've got power and srst isn't asserted */
 		if (!power_dropout && !srst_asserted) {
+			enum target_state prev_state = target->state;
+
 			/* polling may fail silently until the target has been examined */
 			retval = target_poll(target);
+
+			/* slow down polling a target that keeps running, up to polling_idle_max */
+			if (retval == ERROR_OK && polling_idle_max
+					&& prev_state == TARGET_RUNNING && target->state == TARGET_RUNNING) {
+				int idle_max = polling_idle_max / polling_interval - 1;
+				target->idle.times = MIN(target->idle.times * 2 + 1, MAX(idle_max, 0));
+			} else {
+				target->idle.times = 0;
+			}
+
 			if (retval != ERROR_OK) {
 				/* 100ms polling interval. Increase interval between polling up to 5000ms */
 				if (target->backoff.times * polling_interval < 5000) {
@@ -3184,6 +3350,10 @@ COMMAND_HANDLER(handle_poll_command)
 		bool enable;
 		COMMAND_PARSE_ON_OFF(CMD_ARGV[0], enable);
 		jtag_poll_set_enabled(enable);
+	} else if (CMD_ARGC == 2 && !strcmp(CMD_ARGV[0], "idle")) {
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[1], polling_idle_max);
+		for (struct target *t = all_targets; t; t = t->next)
+			t->idle.times = 0;
 	} else
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
@@ -3481,6 +3651,18 @@ static int target_fill_mem(struct target *target,
 	/* We have to write in reasonably large chunks to be able
 	 * to fill large memory areas with any sane speed */
 	const unsigned int chunk_size = 16384;
+
+	/* Large areas are filled much faster by the target itself */
+	if (fn == target_write_memory && target->type->fill_memory
+			&& target->state == TARGET_HALTED
+			&& data_size <= 4 && c >= chunk_size
+			&& IS_ALIGNED(address, data_size)) {
+		int retval = target->type->fill_memory(target, address, data_size, c, b);
+		if (retval != ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+			return retval;
+		LOG_DEBUG("no working area for the fill algorithm, writing from the host");
+	}
+
 	uint8_t *target_buf = malloc(chunk_size * data_size);
 	if (!target_buf) {
 		LOG_ERROR("Out of memory");
@@ -3612,6 +3794,7 @@ static COMMAND_HELPER(parse_load_image_command, struct image *image,
 COMMAND_HANDLER(handle_load_image_command)
 {
 	uint8_t *buffer;
+	const uint8_t *data;
 	size_t buf_cnt;
 	uint32_t image_size;
 	target_addr_t min_address = 0;
@@ -3634,19 +3817,25 @@ COMMAND_HANDLER(handle_load_image_command)
 	image_size = 0x0;
 	retval = ERROR_OK;
 	for (unsigned int i = 0; i < image.num_sections; i++) {
-		buffer = malloc(image.sections[i].size);
-		if (!buffer) {
-			command_print(CMD,
-						  "error allocating buffer for section (%d bytes)",
-						  (int)(image.sections[i].size));
-			retval = ERROR_FAIL;
-			break;
-		}
+		/* write straight from the file mapping or the parsed image if possible */
+		buffer = NULL;
+		buf_cnt = image.sections[i].size;
+		if (image_section_map(&image, i, 0x0, image.sections[i].size, &data) != ERROR_OK) {
+			buffer = malloc(image.sections[i].size);
+			if (!buffer) {
+				command_print(CMD,
+							  "error allocating buffer for section (%d bytes)",
+							  (int)(image.sections[i].size));
+				retval = ERROR_FAIL;
+				break;
+			}
 
-		retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
-		if (retval != ERROR_OK) {
-			free(buffer);
-			break;
+			retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
+			if (retval != ERROR_OK) {
+				free(buffer);
+				break;
+			}
+			data = buffer;
 		}
 
 		uint32_t offset = 0;
@@ -3667,7 +3856,7 @@ COMMAND_HANDLER(handle_load_image_command)
 				length -= (image.sections[i].base_address + buf_cnt)-max_address;
 
 			retval = target_write_buffer(target,
-					image.sections[i].base_address + offset, length, buffer + offset);
+					image.sections[i].base_address + offset, length, data + offset);
 			if (retval != ERROR_OK) {
 				free(buffer);
 				break;
@@ -3708,7 +3897,8 @@ COMMAND_HANDLER(handle_dump_image_command)
 	COMMAND_PARSE_ADDRESS(CMD_ARGV[1], address);
 	COMMAND_PARSE_ADDRESS(CMD_ARGV[2], size);
 
-	uint32_t buf_size = (size > 4096) ? 4096 : size;
+	/* large chunks let the adapter driver queue many transfers per round trip */
+	uint32_t buf_size = (size > 0x10000) ? 0x10000 : size;
 	buffer = malloc(buf_size);
 	if (!buffer)
 		return ERROR_FAIL;
@@ -3734,6 +3924,7 @@ COMMAND_HANDLER(handle_dump_image_command)
 
 		size -= this_run_size;
 		address += this_run_size;
+		keep_alive();
 	}
 
 	free(buffer);
@@ -3755,6 +3946,9 @@ COMMAND_HANDLER(handle_dump_image_command)
 	return retval;
 }
 
+/* largest run of contiguous image sections checksummed at once */
+#define VERIFY_IMAGE_MAX_RUN	(16 * 1024 * 1024)
+
 enum verify_mode {
 	IMAGE_TEST = 0,
 	IMAGE_VERIFY = 1,
@@ -3770,7 +3964,7 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 	uint32_t checksum = 0;
 	uint32_t mem_checksum = 0;
 
-	struct image image;
+	struct image *image;
 
 	struct target *target = get_current_target(CMD_CTX);
 
@@ -3785,39 +3979,62 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 	struct duration bench;
 	duration_start(&bench);
 
+	bool base_address_set = false;
+	target_addr_t base_address = 0x0;
 	if (CMD_ARGC >= 2) {
-		target_addr_t addr;
-		COMMAND_PARSE_ADDRESS(CMD_ARGV[1], addr);
-		image.base_address = addr;
-		image.base_address_set = true;
-	} else {
-		image.base_address_set = false;
-		image.base_address = 0x0;
+		COMMAND_PARSE_ADDRESS(CMD_ARGV[1], base_address);
+		base_address_set = true;
 	}
 
-	image.start_address_set = false;
-
-	retval = image_open(&image, CMD_ARGV[0], (CMD_ARGC == 3) ? CMD_ARGV[2] : NULL);
+	retval = image_open_cached(&image, CMD_ARGV[0], base_address_set, base_address,
+		(CMD_ARGC == 3) ? CMD_ARGV[2] : NULL);
 	if (retval != ERROR_OK)
 		return retval;
 
 	image_size = 0x0;
 	int diffs = 0;
 	retval = ERROR_OK;
-	for (unsigned int i = 0; i < image.num_sections; i++) {
-		buffer = malloc(image.sections[i].size);
+	unsigned int next;
+	for (unsigned int i = 0; i < image->num_sections; i = next) {
+		uint32_t run_size = image->sections[i].size;
+
+		/* checksum contiguous sections at once, one loader run for all of them */
+		next = i + 1;
+		while (verify >= IMAGE_VERIFY && next < image->num_sections
+				&& image->sections[next].base_address ==
+					image->sections[next - 1].base_address + image->sections[next - 1].size
+				&& run_size <= VERIFY_IMAGE_MAX_RUN
+				&& image->sections[next].size <= VERIFY_IMAGE_MAX_RUN - run_size) {
+			run_size += image->sections[next].size;
+			next++;
+		}
+
+		buffer = malloc(run_size);
 		if (!buffer) {
 			command_print(CMD,
 					"error allocating buffer for section (%" PRIu32 " bytes)",
-					image.sections[i].size);
+					run_size);
 			break;
 		}
-		retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
+
+		buf_cnt = 0;
+		for (unsigned int j = i; j < next; j++) {
+			size_t read_cnt;
+			retval = image_read_section(image, j, 0x0, image->sections[j].size,
+					buffer + buf_cnt, &read_cnt);
+			if (retval != ERROR_OK)
+				break;
+			buf_cnt += read_cnt;
+		}
 		if (retval != ERROR_OK) {
 			free(buffer);
 			break;
 		}
 
+		if (next - i > 1)
+			LOG_DEBUG("verifying sections %u to %u at " TARGET_ADDR_FMT " at once, %zu bytes",
+				i, next - 1, image->sections[i].base_address, buf_cnt);
+
 		if (verify >= IMAGE_VERIFY) {
 			/* calculate checksum of image */
 			retval = image_calculate_checksum(buffer, buf_cnt, &checksum);
@@ -3826,7 +4043,7 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 				break;
 			}
 
-			retval = target_checksum_memory(target, image.sections[i].base_address, buf_cnt, &mem_checksum);
+			retval = target_checksum_memory(target, image->sections[i].base_address, buf_cnt, &mem_checksum);
 			if (retval != ERROR_OK) {
 				free(buffer);
 				break;
@@ -3846,7 +4063,7 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 
 				data = malloc(buf_cnt);
 
-				retval = target_read_buffer(target, image.sections[i].base_address, buf_cnt, data);
+				retval = target_read_buffer(target, image->sections[i].base_address, buf_cnt, data);
 				if (retval == ERROR_OK) {
 					uint32_t t;
 					for (t = 0; t < buf_cnt; t++) {
@@ -3854,7 +4071,7 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 							command_print(CMD,
 								"diff %d address " TARGET_ADDR_FMT ". Was 0x%02" PRIx8 " instead of 0x%02" PRIx8,
 								diffs,
-								t + image.sections[i].base_address,
+								t + image->sections[i].base_address,
 								data[t],
 								buffer[t]);
 							if (diffs++ >= 127) {
@@ -3877,7 +4094,7 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 			}
 		} else {
 			command_print(CMD, "address " TARGET_ADDR_FMT " length 0x%08zx",
-						  image.sections[i].base_address,
+						  image->sections[i].base_address,
 						  buf_cnt);
 		}
 
@@ -3895,7 +4112,7 @@ done:
 				duration_elapsed(&bench), duration_kbps(&bench, image_size));
 	}
 
-	image_close(&image);
+	image_release(image);
 
 	return retval;
 }
@@ -4401,16 +4618,19 @@ COMMAND_HANDLER(handle_profile_command)
 	return retval;
 }
 
+/* Largest transfer of read_memory and write_memory with the '-binary' option */
+#define MEMORY_BINARY_MAX (16 * 1024 * 1024)
+
 COMMAND_HANDLER(handle_target_read_memory)
 {
 	/*
 	 * CMD_ARGV[0] = memory address
 	 * CMD_ARGV[1] = desired element width in bits
 	 * CMD_ARGV[2] = number of elements to read
-	 * CMD_ARGV[3] = optional "phys"
+	 * CMD_ARGV[3..4] = optional "phys" and "-binary"
 	 */
 
-	if (CMD_ARGC < 3 || CMD_ARGC > 4)
+	if (CMD_ARGC < 3 || CMD_ARGC > 5)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
 	/* Arg 1: Memory address. */
@@ -4425,15 +4645,18 @@ COMMAND_HANDLER(handle_target_read_memory)
 	unsigned int count;
 	COMMAND_PARSE_NUMBER(uint, CMD_ARGV[2], count);
 
-	/* Arg 4: Optional 'phys'. */
+	/* Args 4 and 5: Optional 'phys' and '-binary'. */
 	bool is_phys = false;
-	if (CMD_ARGC == 4) {
-		if (strcmp(CMD_ARGV[3], "phys")) {
-			command_print(CMD, "invalid argument '%s', must be 'phys'", CMD_ARGV[3]);
+	bool is_binary = false;
+	for (unsigned int i = 3; i < CMD_ARGC; i++) {
+		if (!strcmp(CMD_ARGV[i], "phys")) {
+			is_phys = true;
+		} else if (!strcmp(CMD_ARGV[i], "-binary")) {
+			is_binary = true;
+		} else {
+			command_print(CMD, "invalid argument '%s', must be 'phys' or '-binary'", CMD_ARGV[i]);
 			return ERROR_COMMAND_ARGUMENT_INVALID;
 		}
-
-		is_phys = true;
 	}
 
 	switch (width_bits) {
@@ -4454,13 +4677,41 @@ COMMAND_HANDLER(handle_target_read_memory)
 		return ERROR_COMMAND_ARGUMENT_INVALID;
 	}
 
-	if (count > 65536) {
+	if (is_binary) {
+		if ((uint64_t)count * width > MEMORY_BINARY_MAX) {
+			command_print(CMD, "read_memory: too large read request, exceeds %u bytes",
+				MEMORY_BINARY_MAX);
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+	} else if (count > 65536) {
 		command_print(CMD, "read_memory: too large read request, exceeds 64K elements");
 		return ERROR_COMMAND_ARGUMENT_INVALID;
 	}
 
 	struct target *target = get_current_target(CMD_CTX);
 
+	if (is_binary) {
+		/* the bytes as in target memory, in a single Tcl byte string */
+		uint8_t *data = malloc(count * width);
+		if (!data && count) {
+			LOG_ERROR("Failed to allocate memory");
+			return ERROR_FAIL;
+		}
+
+		int retval;
+		if (is_phys)
+			retval = target_read_phys_memory(target, addr, width, count, data);
+		else
+			retval = target_read_memory(target, addr, width, count, data);
+
+		if (retval == ERROR_OK)
+			command_print_binary(CMD, data, count * width);
+		else
+			command_print(CMD, "read_memory: failed to read memory");
+		free(data);
+		return retval;
+	}
+
 	const size_t buffersize = 4096;
 	uint8_t *buffer = malloc(buffersize);
 
@@ -4469,7 +4720,10 @@ COMMAND_HANDLER(handle_target_read_memory)
 		return ERROR_FAIL;
 	}
 
-	char *separator = "";
+	/* values are formatted in a local buffer, appended to the result when full */
+	char text[1024];
+	size_t text_len = 0;
+	const char *separator = "";
 	while (count > 0) {
 		const unsigned int max_chunk_len = buffersize / width;
 		const size_t chunk_len = MIN(count, max_chunk_len);
@@ -4488,6 +4742,8 @@ COMMAND_HANDLER(handle_target_read_memory)
 			 * FIXME: we append the errmsg to the list of value already read.
 			 * Add a way to flush and replace old output, but LOG_DEBUG() it
 			 */
+			if (text_len)
+				command_print_sameline(CMD, "%s", text);
 			command_print(CMD, "read_memory: failed to read memory");
 			free(buffer);
 			return retval;
@@ -4511,7 +4767,13 @@ COMMAND_HANDLER(handle_target_read_memory)
 				break;
 			}
 
-			command_print_sameline(CMD, "%s0x%" PRIx64, separator, v);
+			/* room for a separator, "0x" and 16 digits */
+			if (text_len > sizeof(text) - 20) {
+				command_print_sameline(CMD, "%s", text);
+				text_len = 0;
+			}
+			text_len += snprintf(text + text_len, sizeof(text) - text_len,
+				"%s0x%" PRIx64, separator, v);
 			separator = " ";
 		}
 
@@ -4519,6 +4781,9 @@ COMMAND_HANDLER(handle_target_read_memory)
 		addr += chunk_len * width;
 	}
 
+	if (text_len)
+		command_print_sameline(CMD, "%s", text);
+
 	free(buffer);
 
 	return ERROR_OK;
@@ -4530,12 +4795,12 @@ static int target_jim_write_memory(Jim_Interp *interp, int argc,
 	/*
 	 * argv[1] = memory address
 	 * argv[2] = desired element width in bits
-	 * argv[3] = list of data to write
-	 * argv[4] = optional "phys"
+	 * argv[3] = list of data to write, or byte string with "-binary"
+	 * argv[4..5] = optional "phys" and "-binary"
 	 */
 
-	if (argc < 4 || argc > 5) {
-		Jim_WrongNumArgs(interp, 1, argv, "address width data ['phys']");
+	if (argc < 4 || argc > 6) {
+		Jim_WrongNumArgs(interp, 1, argv, "address width data ['phys'] ['-binary']");
 		return JIM_ERR;
 	}
 
@@ -4557,20 +4822,22 @@ static int target_jim_write_memory(Jim_Interp *interp, int argc,
 		return e;
 
 	const unsigned int width_bits = l;
-	size_t count = Jim_ListLength(interp, argv[3]);
 
-	/* Arg 4: Optional 'phys'. */
+	/* Args 4 and 5: Optional 'phys' and '-binary'. */
 	bool is_phys = false;
+	bool is_binary = false;
 
-	if (argc > 4) {
-		const char *phys = Jim_GetString(argv[4], NULL);
+	for (int i = 4; i < argc; i++) {
+		const char *option = Jim_GetString(argv[i], NULL);
 
-		if (strcmp(phys, "phys")) {
-			Jim_SetResultFormatted(interp, "invalid argument '%s', must be 'phys'", phys);
+		if (!strcmp(option, "phys")) {
+			is_phys = true;
+		} else if (!strcmp(option, "-binary")) {
+			is_binary = true;
+		} else {
+			Jim_SetResultFormatted(interp, "invalid argument '%s', must be 'phys' or '-binary'", option);
 			return JIM_ERR;
 		}
-
-		is_phys = true;
 	}
 
 	switch (width_bits) {
@@ -4586,12 +4853,32 @@ static int target_jim_write_memory(Jim_Interp *interp, int argc,
 
 	const unsigned int width = width_bits / 8;
 
+	size_t count;
+	const uint8_t *binary_data = NULL;
+	if (is_binary) {
+		int len;
+		binary_data = (const uint8_t *)Jim_GetString(argv[3], &len);
+		if (len % width) {
+			Jim_SetResultString(interp, "write_memory: data length is not a multiple of the width", -1);
+			return JIM_ERR;
+		}
+		count = len / width;
+	} else {
+		count = Jim_ListLength(interp, argv[3]);
+	}
+
 	if ((addr + (count * width)) < addr) {
 		Jim_SetResultString(interp, "write_memory: addr + len wraps to zero", -1);
 		return JIM_ERR;
 	}
 
-	if (count > 65536) {
+	if (is_binary) {
+		if (count * width > MEMORY_BINARY_MAX) {
+			Jim_SetResultFormatted(interp, "write_memory: too large memory write request, exceeds %d bytes",
+				MEMORY_BINARY_MAX);
+			return JIM_ERR;
+		}
+	} else if (count > 65536) {
 		Jim_SetResultString(interp, "write_memory: too large memory write request, exceeds 64K elements", -1);
 		return JIM_ERR;
 	}
@@ -4600,6 +4887,23 @@ static int target_jim_write_memory(Jim_Interp *interp, int argc,
 	assert(cmd_ctx);
 	struct target *target = get_current_target(cmd_ctx);
 
+	if (is_binary) {
+		/* the bytes go to target memory as they are */
+		int retval;
+		if (is_phys)
+			retval = target_write_phys_memory(target, addr, width, count, binary_data);
+		else
+			retval = target_write_memory(target, addr, width, count, binary_data);
+
+		if (retval != ERROR_OK) {
+			LOG_ERROR("write_memory: write at " TARGET_ADDR_FMT " with width=%u and count=%zu failed",
+				addr, width_bits, count);
+			Jim_SetResultString(interp, "write_memory: failed to write memory", -1);
+			return JIM_ERR;
+		}
+		return JIM_OK;
+	}
+
 	const size_t buffersize = 4096;
 	uint8_t *buffer = malloc(buffersize);
 
@@ -4665,11 +4969,22 @@ static int target_jim_write_memory(Jim_Interp *interp, int argc,
 /* FIX? should we propagate errors here rather than printing them
  * and continuing?
  */
+/* Filter of the events with a Tcl action, bits can be shared by several
+ * events so a set bit still requires to look up the action list */
+static uint64_t target_event_bit(enum target_event e)
+{
+	return BIT_ULL(e % 64);
+}
+
 void target_handle_event(struct target *target, enum target_event e)
 {
 	struct target_event_action *teap;
 	int retval;
 
+	/* most events have no action, skip the list */
+	if (!(target->event_action_mask & target_event_bit(e)))
+		return;
+
 	for (teap = target->event_action; teap; teap = teap->next) {
 		if (teap->event == e) {
 			LOG_DEBUG("target: %s (%s) event: %d (%s) action: %s",
@@ -4862,6 +5177,9 @@ bool target_has_event_action(const struct target *target, enum target_event even
 {
 	struct target_event_action *teap;
 
+	if (!(target->event_action_mask & target_event_bit(event)))
+		return false;
+
 	for (teap = target->event_action; teap; teap = teap->next) {
 		if (teap->event == event)
 			return true;
@@ -5024,6 +5342,7 @@ no_params:
 						/* add to head of event list */
 						teap->next = target->event_action;
 						target->event_action = teap;
+						target->event_action_mask |= target_event_bit(teap->event);
 					}
 					Jim_SetEmptyResult(goi->interp);
 				} else {
@@ -5584,6 +5903,7 @@ static const struct command_registration target_instance_command_handlers[] = {
 	},
 	{
 		.name = "get_reg",
+		.fast = true,
 		.mode = COMMAND_EXEC,
 		.jim_handler = target_jim_get_reg,
 		.help = "Get register values from the target",
@@ -5591,6 +5911,7 @@ static const struct command_registration target_instance_command_handlers[] = {
 	},
 	{
 		.name = "set_reg",
+		.fast = true,
 		.mode = COMMAND_EXEC,
 		.handler = handle_set_reg_command,
 		.help = "Set target register values",
@@ -5598,17 +5919,19 @@ static const struct command_registration target_instance_command_handlers[] = {
 	},
 	{
 		.name = "read_memory",
+		.fast = true,
 		.mode = COMMAND_EXEC,
 		.handler = handle_target_read_memory,
 		.help = "Read Tcl list of 8/16/32/64 bit numbers from target memory",
-		.usage = "address width count ['phys']",
+		.usage = "address width count ['phys'] ['-binary']",
 	},
 	{
 		.name = "write_memory",
+		.fast = true,
 		.mode = COMMAND_EXEC,
 		.jim_handler = target_jim_write_memory,
 		.help = "Write Tcl list of 8/16/32/64 bit numbers to target memory",
-		.usage = "address width data ['phys']",
+		.usage = "address width data ['phys'] ['-binary']",
 	},
 	{
 		.name = "eventlist",
@@ -5694,6 +6017,9 @@ static const struct command_registration target_instance_command_handlers[] = {
 		.help = "invoke handler for specified event",
 		.usage = "event_name",
 	},
+	{
+		.chain = target_mem_cache_command_handlers,
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -6116,7 +6442,7 @@ struct fast_load {
 	target_addr_t address;
 	uint8_t *data;
 	int length;
-
+	uint32_t checksum;
 };
 
 static int fastload_num;
@@ -6156,6 +6482,7 @@ COMMAND_HANDLER(handle_fast_load_image_command)
 
 	image_size = 0x0;
 	retval = ERROR_OK;
+	free_fastload();
 	fastload_num = image.num_sections;
 	fastload = malloc(sizeof(struct fast_load)*image.num_sections);
 	if (!fastload) {
@@ -6206,6 +6533,11 @@ COMMAND_HANDLER(handle_fast_load_image_command)
 			}
 			memcpy(fastload[i].data, buffer + offset, length);
 			fastload[i].length = length;
+			retval = image_calculate_checksum(fastload[i].data, length, &fastload[i].checksum);
+			if (retval != ERROR_OK) {
+				free(buffer);
+				break;
+			}
 
 			image_size += length;
 			command_print(CMD, "%u bytes written at address 0x%8.8x",
@@ -6236,7 +6568,11 @@ COMMAND_HANDLER(handle_fast_load_image_command)
 
 COMMAND_HANDLER(handle_fast_load_command)
 {
-	if (CMD_ARGC > 0)
+	bool skip_unchanged = false;
+
+	if (CMD_ARGC == 1 && strcmp(CMD_ARGV[0], "skip_unchanged") == 0)
+		skip_unchanged = true;
+	else if (CMD_ARGC > 0)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 	if (!fastload) {
 		LOG_ERROR("No image in memory");
@@ -6248,6 +6584,21 @@ COMMAND_HANDLER(handle_fast_load_command)
 	int retval = ERROR_OK;
 	for (i = 0; i < fastload_num; i++) {
 		struct target *target = get_current_target(CMD_CTX);
+		if (!fastload[i].data)
+			continue;
+
+		if (skip_unchanged) {
+			/* a checksum on the target is much faster than the download */
+			uint32_t checksum;
+			if (target_checksum_memory(target, fastload[i].address, fastload[i].length,
+					&checksum) == ERROR_OK && checksum == fastload[i].checksum) {
+				command_print(CMD, "Unchanged at 0x%08x, length 0x%08x",
+							  (unsigned int)(fastload[i].address),
+							  (unsigned int)(fastload[i].length));
+				continue;
+			}
+		}
+
 		command_print(CMD, "Write to 0x%08x, length 0x%08x",
 					  (unsigned int)(fastload[i].address),
 					  (unsigned int)(fastload[i].length));
@@ -6322,6 +6673,21 @@ COMMAND_HANDLER(handle_ps_command)
 	}
 }
 
+COMMAND_HANDLER(handle_stack_usage_command)
+{
+	struct target *target = get_current_target(CMD_CTX);
+
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (target->state != TARGET_HALTED) {
+		command_print(CMD, "Error: [%s] not halted", target_name(target));
+		return ERROR_TARGET_NOT_HALTED;
+	}
+
+	return rtos_stack_usage(CMD, target);
+}
+
 static void binprint(struct command_invocation *cmd, const char *text, const uint8_t *buf, int size)
 {
 	if (text)
@@ -6528,7 +6894,7 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.mode = COMMAND_EXEC,
 		.help = "loads active fast load image to current target "
 			"- mainly for profiling purposes",
-		.usage = "",
+		.usage = "['skip_unchanged']",
 	},
 	{
 		.name = "profile",
@@ -6547,6 +6913,7 @@ static const struct command_registration target_exec_command_handlers[] = {
 	},
 	{
 		.name = "reg",
+		.fast = true,
 		.handler = handle_reg_command,
 		.mode = COMMAND_EXEC,
 		.help = "display (reread from target with \"force\") or set a register; "
@@ -6558,7 +6925,7 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.handler = handle_poll_command,
 		.mode = COMMAND_EXEC,
 		.help = "poll target state; or reconfigure background polling",
-		.usage = "['on'|'off']",
+		.usage = "['on'|'off'|'idle' max_ms]",
 	},
 	{
 		.name = "wait_halt",
@@ -6722,6 +7089,7 @@ static const struct command_registration target_exec_command_handlers[] = {
 	},
 	{
 		.name = "get_reg",
+		.fast = true,
 		.mode = COMMAND_EXEC,
 		.jim_handler = target_jim_get_reg,
 		.help = "Get register values from the target",
@@ -6729,6 +7097,7 @@ static const struct command_registration target_exec_command_handlers[] = {
 	},
 	{
 		.name = "set_reg",
+		.fast = true,
 		.mode = COMMAND_EXEC,
 		.handler = handle_set_reg_command,
 		.help = "Set target register values",
@@ -6736,17 +7105,19 @@ static const struct command_registration target_exec_command_handlers[] = {
 	},
 	{
 		.name = "read_memory",
+		.fast = true,
 		.mode = COMMAND_EXEC,
 		.handler = handle_target_read_memory,
 		.help = "Read Tcl list of 8/16/32/64 bit numbers from target memory",
-		.usage = "address width count ['phys']",
+		.usage = "address width count ['phys'] ['-binary']",
 	},
 	{
 		.name = "write_memory",
+		.fast = true,
 		.mode = COMMAND_EXEC,
 		.jim_handler = target_jim_write_memory,
 		.help = "Write Tcl list of 8/16/32/64 bit numbers to target memory",
-		.usage = "address width data ['phys']",
+		.usage = "address width data ['phys'] ['-binary']",
 	},
 	{
 		.name = "debug_reason",
@@ -6770,6 +7141,13 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.help = "list all tasks",
 		.usage = "",
 	},
+	{
+		.name = "stack_usage",
+		.handler = handle_stack_usage_command,
+		.mode = COMMAND_EXEC,
+		.help = "report the never used part of each RTOS thread stack",
+		.usage = "",
+	},
 	{
 		.name = "test_mem_access",
 		.handler = handle_test_mem_access_command,
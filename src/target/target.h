@@ -37,6 +37,9 @@ struct reg_param;
 struct target_list;
 struct gdb_fileio_info;
 
+/* buckets of the per target breakpoint index, a power of 2 */
+#define TARGET_BREAKPOINT_HASH_SIZE 64
+
 /*
  * TARGET_UNKNOWN = 0: we don't know anything about the target yet
  * TARGET_RUNNING = 1: the target is executing or ready to execute user code
@@ -98,6 +101,10 @@ struct gdb_service {
 	/*  element 1 coreid to be displayed at next resume 1 till n 0 means resume
 	 *  all cores core displayed  */
 	int32_t core[2];
+	/* gdb multiprocess: services of all the processes served on this port,
+	 * the process id is the position plus one; NULL for a single process */
+	struct gdb_service **processes;
+	unsigned int num_processes;
 };
 
 /* target back off timer */
@@ -140,6 +147,7 @@ struct target {
 	bool running_alg;
 
 	struct target_event_action *event_action;
+	uint64_t event_action_mask;				/* events with an action, see target_event_bit() */
 
 	bool reset_halt;						/* attempt resetting the CPU into the halted mode? */
 	target_addr_t working_area;				/* working area (initialised RAM). Evaluated
@@ -157,6 +165,7 @@ struct target {
 	enum target_state state;			/* the current backend-state (running, halted, ...) */
 	struct reg_cache *reg_cache;		/* the first register cache of the target (core regs) */
 	struct breakpoint *breakpoints;		/* list of breakpoints */
+	struct breakpoint *breakpoint_hash[TARGET_BREAKPOINT_HASH_SIZE];	/* breakpoints by address */
 	struct watchpoint *watchpoints;		/* list of watchpoints */
 	struct trace *trace_info;			/* generic trace information */
 	struct debug_msg_receiver *dbgmsg;	/* list of debug message receivers */
@@ -184,6 +193,9 @@ struct target {
 	bool rtos_auto_detect;				/* A flag that indicates that the RTOS has been specified as "auto"
 										 * and must be detected when symbols are offered */
 	struct backoff_timer backoff;
+	struct backoff_timer idle;			/* polls skipped while the target keeps running */
+	uint64_t polls;						/* target_poll() calls, reported by the metrics service */
+	uint64_t poll_errors;				/* ... and how many of them failed */
 	unsigned int smp;					/* Unique non-zero number for each SMP group */
 	struct list_head *smp_targets;		/* list all targets in this smp group/cluster
 										 * The head of the list is shared between the
@@ -191,6 +203,8 @@ struct target {
 	bool smp_halt_event_postponed;		/* Some SMP implementations (currently Cortex-M) stores
 										 * 'halted' events and emits them after all targets of
 										 * the SMP group has been polled */
+	bool smp_nonstop;					/* Set by the gdb server in non-stop mode: a core
+										 * of the SMP group halting does not halt the others */
 
 	/* the gdb service is there in case of smp, we have only one gdb server
 	 * for all smp target
@@ -205,8 +219,17 @@ struct target {
 
 	int gdb_max_connections;			/* max number of simultaneous gdb connections */
 
+	/* Target description XML generated by the gdb server. It is reused by
+	 * later connections as long as the register layout it was generated from,
+	 * identified by gdb_tdesc_layout, does not change. */
+	char *gdb_tdesc;
+	uint32_t gdb_tdesc_layout;
+
 	/* The semihosting information, extracted from the target. */
 	struct semihosting *semihosting;
+
+	/* memory read cache used while halted, see mem_cache.c */
+	struct target_mem_cache *mem_cache;
 };
 
 struct target_list {
@@ -322,6 +345,12 @@ struct target_trace_callback {
 	int (*callback)(struct target *target, size_t len, uint8_t *data, void *priv);
 };
 
+struct target_reclaim_callback {
+	struct list_head list;
+	void *priv;
+	void (*callback)(struct target *target, void *priv);
+};
+
 enum target_timer_type {
 	TARGET_TIMER_TYPE_ONESHOT,
 	TARGET_TIMER_TYPE_PERIODIC
@@ -373,6 +402,14 @@ int target_unregister_trace_callback(
 		size_t len, uint8_t *data, void *priv),
 		void *priv);
 
+/**
+ * Registers a callback run when the working area has no room left for an
+ * allocation, to free the areas kept only for later reuse.
+ */
+int target_register_reclaim_callback(
+		void (*callback)(struct target *target, void *priv),
+		void *priv);
+
 /* Poll the status of the target, detect any error conditions and report them.
  *
  * Also note that this fn will clear such error conditions, so a subsequent
@@ -523,6 +560,16 @@ int target_get_gdb_reg_list_noread(struct target *target,
 		struct reg **reg_list[], int *reg_list_size,
 		enum target_register_class reg_class);
 
+/**
+ * Read the invalid registers of @a reg_list in one batch, if the target
+ * supports it. Registers which are still invalid afterwards have to be read
+ * one by one through reg->type->get() by the caller.
+ *
+ * This routine is a wrapper for target->type->fetch_regs.
+ */
+int target_fetch_regs(struct target *target, struct reg **reg_list,
+		int reg_list_size);
+
 /**
  * Check if @a target allows GDB connections.
  *
@@ -760,6 +807,10 @@ void target_buffer_set_u16_array(struct target *target, uint8_t *buffer, uint32_
 
 int target_read_u64(struct target *target, target_addr_t address, uint64_t *value);
 int target_read_u32(struct target *target, target_addr_t address, uint32_t *value);
+/* read the words at count scattered addresses, in one adapter round trip when
+ * the target supports it */
+int target_read_u32_batch(struct target *target, const target_addr_t *address,
+		uint32_t *value, unsigned int count);
 int target_read_u16(struct target *target, target_addr_t address, uint16_t *value);
 int target_read_u8(struct target *target, target_addr_t address, uint8_t *value);
 int target_write_u64(struct target *target, target_addr_t address, uint64_t value);
@@ -106,6 +106,15 @@ struct target_type {
 			struct reg **reg_list[], int *reg_list_size,
 			enum target_register_class reg_class);
 
+	/**
+	 * Optional. Bring the cached values of the registers in @a reg_list up
+	 * to date using as few debug transactions as possible, e.g. a single
+	 * queued batch. Valid and dirty registers must be left untouched.
+	 * Do @b not call this function directly, use target_fetch_regs() instead.
+	 */
+	int (*fetch_regs)(struct target *target, struct reg **reg_list,
+			int reg_list_size);
+
 	/* target memory access
 	* size: 1 = byte (8bit), 2 = half-word (16bit), 4 = word (32bit)
 	* count: number of items of <size>
@@ -132,11 +141,26 @@ struct target_type {
 	int (*write_buffer)(struct target *target, target_addr_t address,
 			uint32_t size, const uint8_t *buffer);
 
+	/**
+	 * Read @a count 32-bit words at scattered addresses, flushing the
+	 * adapter queue once. Optional, do @b not call this function directly,
+	 * use target_read_u32_batch() instead.
+	 */
+	int (*read_u32_batch)(struct target *target, const target_addr_t *address,
+			uint32_t *value, unsigned int count);
+
 	int (*checksum_memory)(struct target *target, target_addr_t address,
 			uint32_t count, uint32_t *checksum);
 	int (*blank_check_memory)(struct target *target,
 			struct target_memory_check_block *blocks, int num_blocks,
 			uint8_t erased_value);
+	/**
+	 * Fill @a count elements of @a size bytes at @a address with @a pattern
+	 * by running code on the halted target. Optional, memory is written
+	 * from the host when it is missing.
+	 */
+	int (*fill_memory)(struct target *target, target_addr_t address,
+			uint32_t size, uint32_t count, uint32_t pattern);
 
 	/*
 	 * target break-/watchpoint control
@@ -0,0 +1,402 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+
+/**
+ * @file
+ * Records the data of all the trace sources (SWO, RTT, ESP apptrace and
+ * semihosting console output) into a single binary file.
+ *
+ * All the fields are little endian and every structure is aligned on 8
+ * bytes, so the file can be memory mapped and walked directly.
+ *
+ * - file header (32 bytes): "OOCDTREC", u32 version, u32 maximum chunk size,
+ *   u64 host time of the start in us, u64 reserved.
+ * - chunks: header (32 bytes): "CHNK", u32 size of the records,
+ *   which can be less than the maximum when the chunk was flushed early,
+ *   u32 number of records, u32 mask of sources (bit n for source n),
+ *   u64 time of the first record, u64 time of the last record.
+ *   Followed by the records: u64 host time in us, u16 source,
+ *   u16 channel, u32 data length, data padded to 8 bytes.
+ * - index (written on stop): "INDX", u32 number of chunks, then per chunk
+ *   u64 file offset, u64 first time, u64 last time, u32 number of
+ *   records, u32 mask of sources.
+ * - trailer (16 bytes): u64 file offset of the index, "OOCDTEND".
+ *
+ * A file without trailer, e.g. after a crash, can still be read by
+ * walking the chunks from the file header.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+
+#include <helper/align.h>
+#include <helper/command.h>
+#include <helper/log.h>
+#include <helper/time_support.h>
+#include <helper/types.h>
+#include "target.h"
+#include "trace_recorder.h"
+
+#define TRACE_RECORDER_VERSION			1
+#define TRACE_RECORDER_FILE_HDR_SIZE	32
+#define TRACE_RECORDER_CHUNK_HDR_SIZE	32
+#define TRACE_RECORDER_RECORD_HDR_SIZE	16
+#define TRACE_RECORDER_INDEX_ENTRY_SIZE	32
+
+#define TRACE_RECORDER_CHUNK_DEFAULT	(64 * 1024)
+#define TRACE_RECORDER_CHUNK_MIN		1024
+#define TRACE_RECORDER_CHUNK_MAX		(16 * 1024 * 1024)
+
+/* Longest time recorded data stays in memory before reaching the file */
+#define TRACE_RECORDER_FLUSH_MS			1000
+
+#define TRACE_RECORDER_SRC_NUM			(TRACE_RECORDER_SRC_SEMIHOSTING + 1)
+
+struct trace_recorder_index_entry {
+	uint64_t offset;
+	uint64_t first_time;
+	uint64_t last_time;
+	uint32_t records;
+	uint32_t sources;
+};
+
+struct trace_recorder {
+	FILE *file;
+	char *filename;
+	uint64_t offset;
+
+	/* chunk being filled, header included */
+	uint8_t *chunk;
+	uint32_t chunk_size;
+	uint32_t chunk_len;
+	struct trace_recorder_index_entry current;
+
+	struct trace_recorder_index_entry *index;
+	unsigned int index_num;
+	unsigned int index_size;
+
+	uint64_t bytes[TRACE_RECORDER_SRC_NUM];
+	uint64_t records[TRACE_RECORDER_SRC_NUM];
+	bool error;
+};
+
+static struct trace_recorder recorder;
+
+static const char * const trace_recorder_source_names[TRACE_RECORDER_SRC_NUM] = {
+	[TRACE_RECORDER_SRC_SWO] = "swo",
+	[TRACE_RECORDER_SRC_RTT] = "rtt",
+	[TRACE_RECORDER_SRC_APPTRACE] = "apptrace",
+	[TRACE_RECORDER_SRC_SEMIHOSTING] = "semihosting",
+};
+
+static uint64_t trace_recorder_time_us(void)
+{
+	struct timeval now;
+
+	gettimeofday(&now, NULL);
+	return (uint64_t)now.tv_sec * 1000000 + now.tv_usec;
+}
+
+static int trace_recorder_file_write(const uint8_t *data, size_t size)
+{
+	if (recorder.error)
+		return ERROR_FAIL;
+
+	if (fwrite(data, 1, size, recorder.file) != size) {
+		LOG_ERROR("trace recorder: failed to write '%s'", recorder.filename);
+		recorder.error = true;
+		return ERROR_FAIL;
+	}
+	recorder.offset += size;
+
+	return ERROR_OK;
+}
+
+static int trace_recorder_flush_chunk(void)
+{
+	struct trace_recorder_index_entry *entry = &recorder.current;
+
+	if (!entry->records)
+		return ERROR_OK;
+
+	if (recorder.index_num == recorder.index_size) {
+		unsigned int size = recorder.index_size ? 2 * recorder.index_size : 64;
+		struct trace_recorder_index_entry *index = realloc(recorder.index, size * sizeof(*index));
+		if (!index) {
+			LOG_ERROR("trace recorder: out of memory");
+			recorder.error = true;
+			return ERROR_FAIL;
+		}
+		recorder.index = index;
+		recorder.index_size = size;
+	}
+
+	uint8_t *hdr = recorder.chunk;
+	memcpy(hdr, "CHNK", 4);
+	h_u32_to_le(hdr + 4, recorder.chunk_len - TRACE_RECORDER_CHUNK_HDR_SIZE);
+	h_u32_to_le(hdr + 8, entry->records);
+	h_u32_to_le(hdr + 12, entry->sources);
+	h_u64_to_le(hdr + 16, entry->first_time);
+	h_u64_to_le(hdr + 24, entry->last_time);
+
+	entry->offset = recorder.offset;
+	int retval = trace_recorder_file_write(recorder.chunk, recorder.chunk_len);
+	if (retval == ERROR_OK && fflush(recorder.file) != 0) {
+		LOG_ERROR("trace recorder: failed to write '%s'", recorder.filename);
+		recorder.error = true;
+		retval = ERROR_FAIL;
+	}
+	if (retval == ERROR_OK)
+		recorder.index[recorder.index_num++] = *entry;
+
+	memset(entry, 0, sizeof(*entry));
+	recorder.chunk_len = TRACE_RECORDER_CHUNK_HDR_SIZE;
+
+	return retval;
+}
+
+static int trace_recorder_timer_callback(void *priv)
+{
+	trace_recorder_flush_chunk();
+
+	return ERROR_OK;
+}
+
+void trace_recorder_write(enum trace_recorder_source source, unsigned int channel,
+	const uint8_t *data, size_t size)
+{
+	if (!recorder.file || recorder.error || !size)
+		return;
+
+	uint64_t now = trace_recorder_time_us();
+	const uint32_t max_data = recorder.chunk_size - TRACE_RECORDER_CHUNK_HDR_SIZE -
+		TRACE_RECORDER_RECORD_HDR_SIZE;
+
+	recorder.bytes[source] += size;
+
+	/* data larger than a chunk is split in several records */
+	while (size) {
+		uint32_t len = MIN(size, max_data);
+		uint32_t record_size = TRACE_RECORDER_RECORD_HDR_SIZE + ALIGN_UP(len, 8);
+
+		if (recorder.chunk_len + record_size > recorder.chunk_size &&
+			trace_recorder_flush_chunk() != ERROR_OK)
+			return;
+
+		uint8_t *record = recorder.chunk + recorder.chunk_len;
+		h_u64_to_le(record, now);
+		h_u16_to_le(record + 8, source);
+		h_u16_to_le(record + 10, channel);
+		h_u32_to_le(record + 12, len);
+		memcpy(record + TRACE_RECORDER_RECORD_HDR_SIZE, data, len);
+		memset(record + TRACE_RECORDER_RECORD_HDR_SIZE + len, 0, ALIGN_UP(len, 8) - len);
+		recorder.chunk_len += record_size;
+
+		struct trace_recorder_index_entry *entry = &recorder.current;
+		if (!entry->records)
+			entry->first_time = now;
+		entry->last_time = now;
+		entry->records++;
+		entry->sources |= BIT(source);
+		recorder.records[source]++;
+
+		data += len;
+		size -= len;
+	}
+}
+
+static int trace_recorder_stop(void)
+{
+	if (!recorder.file)
+		return ERROR_OK;
+
+	target_unregister_timer_callback(trace_recorder_timer_callback, NULL);
+
+	int retval = trace_recorder_flush_chunk();
+
+	/* index and trailer */
+	uint64_t index_offset = recorder.offset;
+	uint8_t buf[TRACE_RECORDER_INDEX_ENTRY_SIZE];
+
+	memcpy(buf, "INDX", 4);
+	h_u32_to_le(buf + 4, recorder.index_num);
+	trace_recorder_file_write(buf, 8);
+	for (unsigned int i = 0; i < recorder.index_num; i++) {
+		h_u64_to_le(buf, recorder.index[i].offset);
+		h_u64_to_le(buf + 8, recorder.index[i].first_time);
+		h_u64_to_le(buf + 16, recorder.index[i].last_time);
+		h_u32_to_le(buf + 24, recorder.index[i].records);
+		h_u32_to_le(buf + 28, recorder.index[i].sources);
+		trace_recorder_file_write(buf, TRACE_RECORDER_INDEX_ENTRY_SIZE);
+	}
+	h_u64_to_le(buf, index_offset);
+	memcpy(buf + 8, "OOCDTEND", 8);
+	trace_recorder_file_write(buf, 16);
+
+	if (fclose(recorder.file) != 0)
+		recorder.error = true;
+	if (recorder.error) {
+		LOG_ERROR("trace recorder: '%s' is incomplete", recorder.filename);
+		retval = ERROR_FAIL;
+	}
+
+	recorder.file = NULL;
+	free(recorder.chunk);
+	recorder.chunk = NULL;
+	free(recorder.index);
+	recorder.index = NULL;
+	recorder.index_num = 0;
+	recorder.index_size = 0;
+
+	return retval;
+}
+
+static int trace_recorder_start(const char *filename, uint32_t chunk_size)
+{
+	free(recorder.filename);
+	memset(&recorder, 0, sizeof(recorder));
+
+	recorder.filename = strdup(filename);
+	recorder.chunk = malloc(chunk_size);
+	if (!recorder.filename || !recorder.chunk) {
+		LOG_ERROR("trace recorder: out of memory");
+		goto error;
+	}
+	recorder.chunk_size = chunk_size;
+	recorder.chunk_len = TRACE_RECORDER_CHUNK_HDR_SIZE;
+
+	recorder.file = fopen(filename, "wb");
+	if (!recorder.file) {
+		LOG_ERROR("trace recorder: cannot open '%s'", filename);
+		goto error;
+	}
+
+	uint8_t hdr[TRACE_RECORDER_FILE_HDR_SIZE] = { 0 };
+	memcpy(hdr, "OOCDTREC", 8);
+	h_u32_to_le(hdr + 8, TRACE_RECORDER_VERSION);
+	h_u32_to_le(hdr + 12, chunk_size);
+	h_u64_to_le(hdr + 16, trace_recorder_time_us());
+
+	if (trace_recorder_file_write(hdr, sizeof(hdr)) != ERROR_OK ||
+		target_register_timer_callback(trace_recorder_timer_callback,
+			TRACE_RECORDER_FLUSH_MS, TARGET_TIMER_TYPE_PERIODIC, NULL) != ERROR_OK)
+		goto error;
+
+	return ERROR_OK;
+
+error:
+	if (recorder.file)
+		fclose(recorder.file);
+	recorder.file = NULL;
+	free(recorder.chunk);
+	recorder.chunk = NULL;
+	free(recorder.filename);
+	recorder.filename = NULL;
+	return ERROR_FAIL;
+}
+
+void trace_recorder_cleanup(void)
+{
+	trace_recorder_stop();
+	free(recorder.filename);
+	recorder.filename = NULL;
+}
+
+COMMAND_HANDLER(handle_trace_recorder_start_command)
+{
+	uint32_t chunk_size = TRACE_RECORDER_CHUNK_DEFAULT;
+
+	if (CMD_ARGC < 1 || CMD_ARGC > 2)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 2) {
+		COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], chunk_size);
+		if (chunk_size < TRACE_RECORDER_CHUNK_MIN || chunk_size > TRACE_RECORDER_CHUNK_MAX) {
+			command_print(CMD, "chunk size must be %u to %u bytes",
+				TRACE_RECORDER_CHUNK_MIN, TRACE_RECORDER_CHUNK_MAX);
+			return ERROR_COMMAND_ARGUMENT_INVALID;
+		}
+		chunk_size = ALIGN_UP(chunk_size, 8);
+	}
+
+	if (recorder.file) {
+		command_print(CMD, "trace recorder already writing '%s'", recorder.filename);
+		return ERROR_FAIL;
+	}
+
+	return trace_recorder_start(CMD_ARGV[0], chunk_size);
+}
+
+COMMAND_HANDLER(handle_trace_recorder_stop_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	return trace_recorder_stop();
+}
+
+COMMAND_HANDLER(handle_trace_recorder_status_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (recorder.file)
+		command_print(CMD, "recording to '%s', %u chunks written%s", recorder.filename,
+			recorder.index_num, recorder.error ? ", write error" : "");
+	else if (recorder.filename)
+		command_print(CMD, "stopped, last recording '%s'", recorder.filename);
+	else
+		command_print(CMD, "stopped");
+
+	for (unsigned int i = 0; i < TRACE_RECORDER_SRC_NUM; i++) {
+		if (!trace_recorder_source_names[i])
+			continue;
+		command_print(CMD, "%-12s %" PRIu64 " records, %" PRIu64 " bytes",
+			trace_recorder_source_names[i], recorder.records[i], recorder.bytes[i]);
+	}
+
+	return ERROR_OK;
+}
+
+static const struct command_registration trace_recorder_subcommand_handlers[] = {
+	{
+		.name = "start",
+		.handler = handle_trace_recorder_start_command,
+		.mode = COMMAND_ANY,
+		.help = "record the data of all the trace sources into a file",
+		.usage = "filename [chunk_size]",
+	},
+	{
+		.name = "stop",
+		.handler = handle_trace_recorder_stop_command,
+		.mode = COMMAND_ANY,
+		.help = "stop recording, write the index and close the file",
+		.usage = "",
+	},
+	{
+		.name = "status",
+		.handler = handle_trace_recorder_status_command,
+		.mode = COMMAND_ANY,
+		.help = "show the recording state and the amount of data per source",
+		.usage = "",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration trace_recorder_command_handlers[] = {
+	{
+		.name = "trace_recorder",
+		.mode = COMMAND_ANY,
+		.help = "timestamped recording of the trace sources",
+		.usage = "",
+		.chain = trace_recorder_subcommand_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int trace_recorder_register_commands(struct command_context *cmd_ctx)
+{
+	return register_commands(cmd_ctx, NULL, trace_recorder_command_handlers);
+}
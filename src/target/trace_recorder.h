@@ -0,0 +1,33 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+
+#ifndef OPENOCD_TARGET_TRACE_RECORDER_H
+#define OPENOCD_TARGET_TRACE_RECORDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct command_context;
+
+/* Source tags of the records, stored in the file */
+enum trace_recorder_source {
+	TRACE_RECORDER_SRC_SWO = 1,
+	TRACE_RECORDER_SRC_RTT = 2,
+	TRACE_RECORDER_SRC_APPTRACE = 3,
+	TRACE_RECORDER_SRC_SEMIHOSTING = 4,
+};
+
+/**
+ * Records data received from a trace source, with the host time.
+ * Does nothing when no recording is running.
+ *
+ * @param source Source of the data.
+ * @param channel Source specific channel: RTT channel, apptrace core or
+ * semihosting file descriptor.
+ */
+void trace_recorder_write(enum trace_recorder_source source, unsigned int channel,
+	const uint8_t *data, size_t size);
+
+int trace_recorder_register_commands(struct command_context *cmd_ctx);
+void trace_recorder_cleanup(void);
+
+#endif /* OPENOCD_TARGET_TRACE_RECORDER_H */
@@ -631,7 +631,9 @@ static unsigned int parity(unsigned int v)
 	return (0x6996 >> v) & 1;
 }
 
-static int xscale_load_ic(struct target *target, uint32_t va, uint32_t buffer[8])
+/* queue loading a mini-icache line, scans are copied so several lines
+ * can be queued before the queue is executed */
+static void xscale_queue_load_ic(struct target *target, uint32_t va, const uint32_t buffer[8])
 {
 	struct xscale_common *xscale = target_to_xscale(target);
 	uint8_t packet[4] = { 0 };
@@ -681,10 +683,48 @@ static int xscale_load_ic(struct target *target, uint32_t va, uint32_t buffer[8]
 
 		jtag_add_dr_scan(target->tap, 2, fields, TAP_IDLE);
 	}
+}
+
+static int xscale_load_ic(struct target *target, uint32_t va, uint32_t buffer[8])
+{
+	xscale_queue_load_ic(target, va, buffer);
 
 	return jtag_execute_queue();
 }
 
+/* The debug handler as mini-icache lines, converted once and padded
+ * with "mov r8, r8" */
+static const uint32_t *xscale_debug_handler_lines(unsigned int *num_lines)
+{
+	static uint32_t lines[DIV_ROUND_UP(sizeof(xscale_debug_handler), 32)][8];
+	static bool converted;
+
+	if (!converted) {
+		for (unsigned int i = 0; i < ARRAY_SIZE(lines) * 32; i += 4) {
+			if (i < sizeof(xscale_debug_handler))
+				/* convert LE buffer to host-endian uint32_t */
+				lines[i / 32][(i % 32) / 4] = le_to_h_u32(&xscale_debug_handler[i]);
+			else
+				lines[i / 32][(i % 32) / 4] = 0xe1a08008;
+		}
+		converted = true;
+	}
+
+	*num_lines = ARRAY_SIZE(lines);
+	return &lines[0][0];
+}
+
+static int xscale_jtag_callback(enum jtag_event event, void *priv)
+{
+	struct xscale_common *xscale = priv;
+
+	/* TRST invalidates the mini-icache */
+	if (event == JTAG_TRST_ASSERTED)
+		xscale->handler_resident = false;
+
+	return ERROR_OK;
+}
+
 static int xscale_invalidate_ic_line(struct target *target, uint32_t va)
 {
 	struct xscale_common *xscale = target_to_xscale(target);
@@ -852,8 +892,11 @@ static int xscale_debug_entry(struct target *target)
 
 	/* get r0, pc, r1 to r7 and cpsr */
 	retval = xscale_receive(target, buffer, 10);
-	if (retval != ERROR_OK)
+	if (retval != ERROR_OK) {
+		/* no answer from the handler, load it again on the next reset */
+		xscale->handler_resident = false;
 		return retval;
+	}
 
 	/* move r0 from buffer to register cache */
 	buf_set_u32(arm->core_cache->reg_list[0].value, 0, 32, buffer[0]);
@@ -1514,9 +1557,8 @@ static int xscale_deassert_reset(struct target *target)
 	 * contents can't ever fail..
 	 */
 	{
-		uint32_t address;
-		unsigned int buf_cnt;
-		const uint8_t *buffer = xscale_debug_handler;
+		const uint32_t *lines;
+		unsigned int num_lines;
 		int retval;
 
 		/* release SRST */
@@ -1537,45 +1579,35 @@ static int xscale_deassert_reset(struct target *target)
 		 * it's using halt mode (not monitor mode), it runs in
 		 * "Special Debug State" for access to registers, memory,
 		 * coprocessors, trace data, etc.
+		 *
+		 * The mini-icache survives SRST, so the handler lines are
+		 * only loaded again after a TRST or a handler move; all lines
+		 * and the reset vectors go out in a single queue execution.
 		 */
-		address = xscale->handler_address;
-		for (unsigned int binary_size = sizeof(xscale_debug_handler);
-			binary_size > 0;
-			binary_size -= buf_cnt, buffer += buf_cnt) {
-			uint32_t cache_line[8];
-			unsigned int i;
-
-			buf_cnt = binary_size;
-			if (buf_cnt > 32)
-				buf_cnt = 32;
-
-			for (i = 0; i < buf_cnt; i += 4) {
-				/* convert LE buffer to host-endian uint32_t */
-				cache_line[i / 4] = le_to_h_u32(&buffer[i]);
+		if (!xscale->handler_resident) {
+			lines = xscale_debug_handler_lines(&num_lines);
+			for (unsigned int i = 0; i < num_lines; i++) {
+				uint32_t address = xscale->handler_address + i * 32;
+
+				/* only load addresses other than the reset vectors */
+				if ((address % 0x400) != 0x0)
+					xscale_queue_load_ic(target, address, &lines[i * 8]);
 			}
-
-			for (; i < 32; i += 4)
-				cache_line[i / 4] = 0xe1a08008;
-
-			/* only load addresses other than the reset vectors */
-			if ((address % 0x400) != 0x0) {
-				retval = xscale_load_ic(target, address,
-						cache_line);
-				if (retval != ERROR_OK)
-					return retval;
-			}
-
-			address += buf_cnt;
+		} else {
+			LOG_DEBUG("debug handler resident, reloading vectors only");
+			xscale_invalidate_ic_line(target, 0x0);
+			xscale_invalidate_ic_line(target, 0xffff0000);
 		}
 
-		retval = xscale_load_ic(target, 0x0,
-				xscale->low_vectors);
-		if (retval != ERROR_OK)
-			return retval;
-		retval = xscale_load_ic(target, 0xffff0000,
-				xscale->high_vectors);
-		if (retval != ERROR_OK)
+		xscale_queue_load_ic(target, 0x0, xscale->low_vectors);
+		xscale_queue_load_ic(target, 0xffff0000, xscale->high_vectors);
+
+		retval = jtag_execute_queue();
+		if (retval != ERROR_OK) {
+			xscale->handler_resident = false;
 			return retval;
+		}
+		xscale->handler_resident = true;
 
 		jtag_add_runtest(30, TAP_IDLE);
 
@@ -2918,6 +2950,7 @@ static void xscale_deinit_target(struct target *target)
 {
 	struct xscale_common *xscale = target_to_xscale(target);
 
+	jtag_unregister_event_callback(xscale_jtag_callback, xscale);
 	xscale_free_reg_cache(target);
 	free(xscale);
 }
@@ -2942,6 +2975,8 @@ static int xscale_init_arch_info(struct target *target,
 
 	/* the debug handler isn't installed (and thus not running) at this time */
 	xscale->handler_address = 0xfe000800;
+	xscale->handler_resident = false;
+	jtag_register_event_callback(xscale_jtag_callback, xscale);
 
 	/* clear the vectors we keep locally for reference */
 	memset(xscale->low_vectors, 0, sizeof(xscale->low_vectors));
@@ -3052,9 +3087,11 @@ COMMAND_HANDLER(xscale_handle_debug_handler_command)
 	COMMAND_PARSE_NUMBER(u32, CMD_ARGV[1], handler_address);
 
 	if (((handler_address >= 0x800) && (handler_address <= 0x1fef800)) ||
-		((handler_address >= 0xfe000800) && (handler_address <= 0xfffff800)))
+		((handler_address >= 0xfe000800) && (handler_address <= 0xfffff800))) {
+		if (handler_address != xscale->handler_address)
+			xscale->handler_resident = false;
 		xscale->handler_address = handler_address;
-	else {
+	} else {
 		LOG_ERROR(
 			"xscale debug_handler <address> must be between 0x800 and 0x1fef800 or between 0xfe000800 and 0xfffff800");
 		return ERROR_FAIL;
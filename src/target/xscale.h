@@ -81,6 +81,9 @@ struct xscale_common {
 
 	/* current state of the debug handler */
 	uint32_t handler_address;
+	/* handler loaded into the mini-icache at handler_address; only a
+	 * TRST or an LDIC invalidate clears the mini-icache */
+	bool handler_resident;
 
 	/* target-endian buffers with exception vectors */
 	uint32_t low_vectors[8];
@@ -166,6 +166,9 @@
 
 #define XT_WATCHPOINTS_NUM_MAX  2
 
+/* Words of memory moved per queue flush and status check */
+#define XT_MEM_BURST_WORDS		1024
+
 /* Special register number macro for DDR, PS, WB, A3, A4 registers.
  * These get used a lot so making a shortcut is useful.
  */
@@ -428,9 +431,11 @@ static inline bool xtensa_is_dcacheable(struct xtensa *xtensa, target_addr_t add
 	       xtensa_is_cacheable(&xtensa->core_config->dcache, &xtensa->core_config->srom, address);
 }
 
+static int xtensa_fetch_deferred_regs(struct target *target);
+
 static int xtensa_core_reg_get(struct reg *reg)
 {
-	/* We don't need this because we read all registers on halt anyway. */
+	/* Most registers are read on halt, the others in one batch on first access. */
 	struct xtensa *xtensa = (struct xtensa *)reg->arch_info;
 	struct target *target = xtensa->target;
 
@@ -444,6 +449,11 @@ static int xtensa_core_reg_get(struct reg *reg)
 		}
 		return ERROR_COMMAND_ARGUMENT_INVALID;
 	}
+	int res = xtensa_fetch_pending_regs(target);
+	if (res != ERROR_OK)
+		return res;
+	if (!reg->valid && xtensa->regs_deferred)
+		return xtensa_fetch_deferred_regs(target);
 	return ERROR_OK;
 }
 
@@ -465,6 +475,11 @@ static int xtensa_core_reg_set(struct reg *reg, uint8_t *buf)
 		return ERROR_COMMAND_ARGUMENT_INVALID;
 	}
 
+	/* a later fetch on halt would overwrite the value */
+	int res = xtensa_fetch_pending_regs(target);
+	if (res != ERROR_OK)
+		return res;
+
 	buf_cpy(buf, reg->value, reg->size);
 
 	if (xtensa->core_config->windowed) {
@@ -553,6 +568,8 @@ static inline bool xtensa_region_ar_exec(struct target *target, target_addr_t st
 {
 	struct xtensa *xtensa = target_to_xtensa(target);
 	if (xtensa->core_config->mpu.enabled) {
+		if (xtensa_fetch_pending_regs(target) != ERROR_OK)
+			return false;
 		/* For cores with the MPU option, issue PPTLB on start and end addresses.
 		 * Parse access rights field, and confirm both have execute permissions.
 		 */
@@ -647,6 +664,24 @@ static bool xtensa_reg_is_readable(int flags, int cpenable)
 	return true;
 }
 
+/**
+ * Config-specific user, FP and special registers are left out of the fetch
+ * on halt and read on first access by xtensa_fetch_deferred_regs(). Those
+ * the driver itself works with (EPS of the debug level, the NX registers)
+ * are always fetched on halt.
+ */
+static bool xtensa_reg_is_deferred(struct xtensa *xtensa, unsigned int idx)
+{
+	if (idx < XT_NUM_REGS || idx == xtensa->eps_dbglevel_idx)
+		return false;
+	for (unsigned int i = 0; i < XT_NX_REG_IDX_NUM; i++)
+		if (xtensa->nx_reg_idx[i] == idx)
+			return false;
+
+	enum xtensa_reg_type type = xtensa->optregs[idx - XT_NUM_REGS].type;
+	return type == XT_REG_USER || type == XT_REG_FR || type == XT_REG_SPECIAL;
+}
+
 static bool xtensa_scratch_regs_fixup(struct xtensa *xtensa, struct reg *reg_list, int i, int j, int a_idx, int ar_idx)
 {
 	int a_name = (a_idx == XT_AR_SCRATCH_A3) ? 3 : 4;
@@ -678,6 +713,10 @@ static int xtensa_write_dirty_registers(struct target *target)
 
 	LOG_TARGET_DEBUG(target, "start");
 
+	res = xtensa_fetch_pending_regs(target);
+	if (res != ERROR_OK)
+		return res;
+
 	/* We need to write the dirty registers in the cache list back to the processor.
 	 * Start by writing the SFR/user registers. */
 	for (unsigned int i = 0; i < reg_list_size; i++) {
@@ -1063,6 +1102,9 @@ int xtensa_core_status_check(struct target *target)
 xtensa_reg_val_t xtensa_reg_get(struct target *target, enum xtensa_reg_id reg_id)
 {
 	struct xtensa *xtensa = target_to_xtensa(target);
+	/* callers that can fail call xtensa_fetch_pending_regs() themselves first */
+	if (xtensa_fetch_pending_regs(target) != ERROR_OK)
+		LOG_TARGET_ERROR(target, "Failed to fetch registers left out on halt");
 	struct reg *reg = &xtensa->core_cache->reg_list[reg_id];
 	return xtensa_reg_get_value(reg);
 }
@@ -1070,6 +1112,8 @@ xtensa_reg_val_t xtensa_reg_get(struct target *target, enum xtensa_reg_id reg_id
 void xtensa_reg_set(struct target *target, enum xtensa_reg_id reg_id, xtensa_reg_val_t value)
 {
 	struct xtensa *xtensa = target_to_xtensa(target);
+	if (xtensa_fetch_pending_regs(target) != ERROR_OK)
+		LOG_TARGET_ERROR(target, "Failed to fetch registers left out on halt");
 	struct reg *reg = &xtensa->core_cache->reg_list[reg_id];
 	if (xtensa_reg_get_value(reg) == value)
 		return;
@@ -1096,7 +1140,9 @@ uint32_t xtensa_cause_get(struct target *target)
 {
 	struct xtensa *xtensa = target_to_xtensa(target);
 	if (xtensa->core_config->core_type == XT_LX) {
-		/* LX cause in DEBUGCAUSE */
+		/* LX cause in DEBUGCAUSE, read alone on halt if the fetch is pending */
+		if (xtensa->regs_pending)
+			return xtensa->pending_cause;
 		return xtensa_reg_get(target, XT_REG_IDX_DEBUGCAUSE);
 	}
 	if (xtensa->nx_stop_cause & DEBUGCAUSE_VALID)
@@ -1232,6 +1278,7 @@ int xtensa_fetch_all_regs(struct target *target)
 	}
 
 	LOG_TARGET_DEBUG(target, "start");
+	xtensa->regs_pending = false;
 
 	/* Save (windowed) A3 so cache matches physical AR3; A3 usable as scratch */
 	xtensa_queue_exec_ins(xtensa, XT_INS_WSR(xtensa, XT_SR_DDR, XT_REG_A3));
@@ -1323,7 +1370,8 @@ int xtensa_fetch_all_regs(struct target *target)
 	for (unsigned int i = 0; i < reg_list_size; i++) {
 		struct xtensa_reg_desc *rlist = (i < XT_NUM_REGS) ? xtensa_regs : xtensa->optregs;
 		unsigned int ridx = (i < XT_NUM_REGS) ? i : i - XT_NUM_REGS;
-		if (xtensa_reg_is_readable(rlist[ridx].flags, cpenable) && rlist[ridx].exist) {
+		if (xtensa_reg_is_readable(rlist[ridx].flags, cpenable) && rlist[ridx].exist &&
+			!xtensa_reg_is_deferred(xtensa, i)) {
 			bool reg_fetched = true;
 			unsigned int reg_num = rlist[ridx].reg_num;
 			switch (rlist[ridx].type) {
@@ -1385,6 +1433,7 @@ int xtensa_fetch_all_regs(struct target *target)
 			struct xtensa_reg_desc *rlist = (i < XT_NUM_REGS) ? xtensa_regs : xtensa->optregs;
 			unsigned int ridx = (i < XT_NUM_REGS) ? i : i - XT_NUM_REGS;
 			if (xtensa_reg_is_readable(rlist[ridx].flags, cpenable) && rlist[ridx].exist &&
+				!xtensa_reg_is_deferred(xtensa, i) &&
 				(rlist[ridx].type != XT_REG_DEBUG) &&
 				(rlist[ridx].type != XT_REG_RELGEN) &&
 				(rlist[ridx].type != XT_REG_TIE) &&
@@ -1407,11 +1456,12 @@ int xtensa_fetch_all_regs(struct target *target)
 			windowbase = (windowbase & XT_WB_P_MSK) >> XT_WB_P_SHIFT;
 	}
 
-	/* Decode the result and update the cache. */
+	/* Decode the result and update the cache, the deferred registers are left invalid. */
 	for (unsigned int i = 0; i < reg_list_size; i++) {
 		struct xtensa_reg_desc *rlist = (i < XT_NUM_REGS) ? xtensa_regs : xtensa->optregs;
 		unsigned int ridx = (i < XT_NUM_REGS) ? i : i - XT_NUM_REGS;
-		if (xtensa_reg_is_readable(rlist[ridx].flags, cpenable) && rlist[ridx].exist) {
+		if (xtensa_reg_is_readable(rlist[ridx].flags, cpenable) && rlist[ridx].exist &&
+			!xtensa_reg_is_deferred(xtensa, i)) {
 			if ((xtensa->core_config->windowed) && (rlist[ridx].type == XT_REG_GENERAL)) {
 				/* The 64-value general register set is read from (windowbase) on down.
 				 * We need to get the real register address by subtracting windowbase and
@@ -1480,12 +1530,143 @@ int xtensa_fetch_all_regs(struct target *target)
 	}
 
 	xtensa->regs_fetched = true;
+	xtensa->regs_deferred = true;
 xtensa_fetch_all_regs_done:
 	free(regvals);
 	free(dsrs);
 	return res;
 }
 
+/**
+ * Reads in one batch the registers xtensa_fetch_all_regs() left out, except
+ * the ones set since then.
+ */
+static int xtensa_fetch_deferred_regs(struct target *target)
+{
+	struct xtensa *xtensa = target_to_xtensa(target);
+	struct reg *reg_list = xtensa->core_cache->reg_list;
+	unsigned int reg_list_size = xtensa->core_cache->num_regs;
+	xtensa_reg_val_t cpenable = 0;
+	bool debug_dsrs = LOG_LEVEL_IS(LOG_LVL_DEBUG);
+	int res = ERROR_OK;
+
+	if (target->state != TARGET_HALTED)
+		return xtensa->regs_deferred ? ERROR_TARGET_NOT_HALTED : ERROR_OK;
+	res = xtensa_fetch_pending_regs(target);
+	if (res != ERROR_OK || !xtensa->regs_deferred)
+		return res;
+
+	union xtensa_reg_val_u *regvals = calloc(reg_list_size, sizeof(*regvals));
+	union xtensa_reg_val_u *dsrs = calloc(reg_list_size, sizeof(*dsrs));
+	if (!regvals || !dsrs) {
+		LOG_TARGET_ERROR(target, "unable to allocate memory for regvals!");
+		res = ERROR_FAIL;
+		goto xtensa_fetch_deferred_regs_done;
+	}
+
+	LOG_TARGET_DEBUG(target, "start");
+
+	/* We're going to use A3 here */
+	xtensa_mark_register_dirty(xtensa, XT_REG_IDX_A3);
+	if (xtensa->core_config->coproc) {
+		/* The cache keeps the value CPENABLE had on halt. Enable all coprocessors again,
+		 * registers may have been written back since the fetch. */
+		cpenable = xtensa_reg_get(target, XT_REG_IDX_CPENABLE);
+		xtensa_queue_dbg_reg_write(xtensa, XDMREG_DDR, 0xffffffff);
+		xtensa_queue_exec_ins(xtensa, XT_INS_RSR(xtensa, XT_SR_DDR, XT_REG_A3));
+		xtensa_queue_exec_ins(xtensa, XT_INS_WSR(xtensa, xtensa_regs[XT_REG_IDX_CPENABLE].reg_num, XT_REG_A3));
+		xtensa_mark_register_dirty(xtensa, XT_REG_IDX_CPENABLE);
+	}
+
+	for (unsigned int i = XT_NUM_REGS; i < reg_list_size; i++) {
+		struct xtensa_reg_desc *rdesc = &xtensa->optregs[i - XT_NUM_REGS];
+		if (!xtensa_reg_is_deferred(xtensa, i) || reg_list[i].valid || !rdesc->exist ||
+			!xtensa_reg_is_readable(rdesc->flags, cpenable))
+			continue;
+		if (rdesc->type == XT_REG_USER)
+			xtensa_queue_exec_ins(xtensa, XT_INS_RUR(xtensa, rdesc->reg_num, XT_REG_A3));
+		else if (rdesc->type == XT_REG_FR)
+			xtensa_queue_exec_ins(xtensa, XT_INS_RFR(xtensa, rdesc->reg_num, XT_REG_A3));
+		else
+			xtensa_queue_exec_ins(xtensa, XT_INS_RSR(xtensa, rdesc->reg_num, XT_REG_A3));
+		xtensa_queue_exec_ins(xtensa, XT_INS_WSR(xtensa, XT_SR_DDR, XT_REG_A3));
+		xtensa_queue_dbg_reg_read(xtensa, XDMREG_DDR, regvals[i].buf);
+		if (debug_dsrs)
+			xtensa_queue_dbg_reg_read(xtensa, XDMREG_DSR, dsrs[i].buf);
+	}
+	res = xtensa_dm_queue_execute(&xtensa->dbg_mod);
+	if (res != ERROR_OK) {
+		LOG_TARGET_ERROR(target, "Failed to fetch deferred regs!");
+		goto xtensa_fetch_deferred_regs_done;
+	}
+	xtensa_core_status_check(target);
+
+	for (unsigned int i = XT_NUM_REGS; i < reg_list_size; i++) {
+		struct xtensa_reg_desc *rdesc = &xtensa->optregs[i - XT_NUM_REGS];
+		if (!xtensa_reg_is_deferred(xtensa, i) || reg_list[i].valid || !rdesc->exist ||
+			!xtensa_reg_is_readable(rdesc->flags, cpenable))
+			continue;
+		if (debug_dsrs && (buf_get_u32(dsrs[i].buf, 0, 32) & OCDDSR_EXECEXCEPTION)) {
+			LOG_ERROR("Exception reading %s!", reg_list[i].name);
+			res = ERROR_FAIL;
+			continue;
+		}
+		xtensa_reg_val_t regval = buf_get_u32(regvals[i].buf, 0, 32);
+		if (xtensa_extra_debug_log)
+			LOG_INFO("Register %s: 0x%X", reg_list[i].name, regval);
+		xtensa_reg_set(target, i, regval);
+		reg_list[i].dirty = false;	/*always do this _after_ xtensa_reg_set! */
+		reg_list[i].valid = true;
+	}
+
+	xtensa->regs_deferred = false;
+xtensa_fetch_deferred_regs_done:
+	free(regvals);
+	free(dsrs);
+	return res;
+}
+
+int xtensa_fetch_regs(struct target *target, struct reg **reg_list, int reg_list_size)
+{
+	struct xtensa *xtensa = target_to_xtensa(target);
+	struct reg_cache *cache = xtensa->core_cache;
+
+	if (target->state != TARGET_HALTED || !cache)
+		return ERROR_OK;
+	int res = xtensa_fetch_pending_regs(target);
+	if (res != ERROR_OK || !xtensa->regs_deferred)
+		return res;
+
+	/* one batch for all the deferred registers GDB asks for */
+	for (int i = 0; i < reg_list_size; i++) {
+		struct reg *r = reg_list[i];
+		if (r && r->exist && !r->valid &&
+				r >= cache->reg_list && r < cache->reg_list + cache->num_regs &&
+				xtensa_reg_is_deferred(xtensa, r - cache->reg_list))
+			return xtensa_fetch_deferred_regs(target);
+	}
+
+	return ERROR_OK;
+}
+
+/**
+ * Does the fetch on halt left out by xtensa_poll() when defer_halt_fetch is
+ * set, ahead of anything that reads or clobbers the register cache.
+ */
+int xtensa_fetch_pending_regs(struct target *target)
+{
+	struct xtensa *xtensa = target_to_xtensa(target);
+
+	if (!xtensa->regs_pending)
+		return ERROR_OK;
+	if (target->state != TARGET_HALTED) {
+		xtensa->regs_pending = false;
+		return ERROR_OK;
+	}
+	LOG_TARGET_DEBUG(target, "fetching registers left out on halt");
+	return xtensa_fetch_all_regs(target);
+}
+
 int xtensa_get_gdb_reg_list(struct target *target,
 	struct reg **reg_list[],
 	int *reg_list_size,
@@ -1580,8 +1761,7 @@ int xtensa_halt(struct target *target)
 	}
 	LOG_TARGET_DEBUG(target, "Core status 0x%" PRIx32, xtensa_dm_core_status_get(&xtensa->dbg_mod));
 	if (!xtensa_is_stopped(target)) {
-		xtensa_queue_dbg_reg_write(xtensa, XDMREG_DCRSET, OCDDCR_ENABLEOCD | OCDDCR_DEBUGINTERRUPT);
-		xtensa_dm_queue_tdi_idle(&xtensa->dbg_mod);
+		xtensa_queue_halt(target);
 		res = xtensa_dm_queue_execute(&xtensa->dbg_mod);
 		if (res != ERROR_OK)
 			LOG_TARGET_ERROR(target, "Failed to set OCDDCR_DEBUGINTERRUPT. Can't halt.");
@@ -1590,6 +1770,59 @@ int xtensa_halt(struct target *target)
 	return res;
 }
 
+/**
+ * Queues the debug interrupt that stops a running core, so that SMP code can
+ * stop several cores with a single queue execution.
+ */
+void xtensa_queue_halt(struct target *target)
+{
+	struct xtensa *xtensa = target_to_xtensa(target);
+
+	xtensa_queue_dbg_reg_write(xtensa, XDMREG_DCRSET, OCDDCR_ENABLEOCD | OCDDCR_DEBUGINTERRUPT);
+	xtensa_dm_queue_tdi_idle(&xtensa->dbg_mod);
+}
+
+/**
+ * Writes the hw breakpoints of a core whose fetch on halt is still pending,
+ * without fetching its registers. A3 is kept in DDR meanwhile.
+ */
+static int xtensa_write_pending_ibreaks(struct target *target)
+{
+	struct xtensa *xtensa = target_to_xtensa(target);
+	uint32_t bpena = 0;
+	uint8_t a3_buf[4];
+
+	xtensa_queue_exec_ins(xtensa, XT_INS_WSR(xtensa, XT_SR_DDR, XT_REG_A3));
+	xtensa_queue_dbg_reg_read(xtensa, XDMREG_DDR, a3_buf);
+	int res = xtensa_dm_queue_execute(&xtensa->dbg_mod);
+	if (res == ERROR_OK)
+		res = xtensa_core_status_check(target);
+	if (res != ERROR_OK)
+		return res;
+
+	for (unsigned int slot = 0; slot < xtensa->core_config->debug.ibreaks_num; slot++) {
+		if (xtensa->hw_brps[slot]) {
+			xtensa_queue_dbg_reg_write(xtensa, XDMREG_DDR, xtensa->hw_brps[slot]->address);
+			xtensa_queue_exec_ins(xtensa, XT_INS_RSR(xtensa, XT_SR_DDR, XT_REG_A3));
+			xtensa_queue_exec_ins(xtensa, XT_INS_WSR(xtensa,
+				xtensa_regs[XT_REG_IDX_IBREAKA0 + slot].reg_num, XT_REG_A3));
+			bpena |= BIT(slot);
+		}
+	}
+	xtensa_queue_dbg_reg_write(xtensa, XDMREG_DDR, bpena);
+	xtensa_queue_exec_ins(xtensa, XT_INS_RSR(xtensa, XT_SR_DDR, XT_REG_A3));
+	xtensa_queue_exec_ins(xtensa, XT_INS_WSR(xtensa,
+		xtensa_regs[XT_REG_IDX_IBREAKENABLE].reg_num, XT_REG_A3));
+	xtensa_queue_dbg_reg_write(xtensa, XDMREG_DDR, buf_get_u32(a3_buf, 0, 32));
+	xtensa_queue_exec_ins(xtensa, XT_INS_RSR(xtensa, XT_SR_DDR, XT_REG_A3));
+	res = xtensa_dm_queue_execute(&xtensa->dbg_mod);
+	if (res == ERROR_OK)
+		res = xtensa_core_status_check(target);
+	if (res != ERROR_OK)
+		LOG_TARGET_ERROR(target, "Failed to write hw breakpoints.");
+	return res;
+}
+
 int xtensa_prepare_resume(struct target *target,
 	bool current,
 	target_addr_t address,
@@ -1613,6 +1846,9 @@ int xtensa_prepare_resume(struct target *target,
 	xtensa->halt_request = false;
 
 	if (address && !current) {
+		int res = xtensa_fetch_pending_regs(target);
+		if (res != ERROR_OK)
+			return res;
 		xtensa_reg_set(target, XT_REG_IDX_PC, address);
 	} else {
 		uint32_t cause = xtensa_cause_get(target);
@@ -1632,6 +1868,11 @@ int xtensa_prepare_resume(struct target *target,
 			xtensa_do_step(target, current, address, handle_breakpoints);
 	}
 
+	/* Nothing read or changed the cache since the halt, so there is nothing
+	 * to write back but the hw breakpoints */
+	if (xtensa->regs_pending)
+		return xtensa_write_pending_ibreaks(target);
+
 	/* Write back hw breakpoints. Current FreeRTOS SMP code can set a hw breakpoint on an
 	 * exception; we need to clear that and return to the breakpoints gdb has set on resume. */
 	for (unsigned int slot = 0; slot < xtensa->core_config->debug.ibreaks_num; slot++) {
@@ -1653,14 +1894,26 @@ int xtensa_prepare_resume(struct target *target,
 	return res;
 }
 
+/**
+ * Queues the return from debug mode of a core prepared by
+ * xtensa_prepare_resume(); the caller executes the queue and checks DSR.
+ */
+void xtensa_queue_resume(struct target *target)
+{
+	struct xtensa *xtensa = target_to_xtensa(target);
+
+	xtensa_cause_reset(target);
+	xtensa->regs_pending = false;
+	xtensa_queue_exec_ins(xtensa, XT_INS_RFDO(xtensa));
+}
+
 int xtensa_do_resume(struct target *target)
 {
 	struct xtensa *xtensa = target_to_xtensa(target);
 
 	LOG_TARGET_DEBUG(target, "start");
 
-	xtensa_cause_reset(target);
-	xtensa_queue_exec_ins(xtensa, XT_INS_RFDO(xtensa));
+	xtensa_queue_resume(target);
 	int res = xtensa_dm_queue_execute(&xtensa->dbg_mod);
 	if (res != ERROR_OK) {
 		LOG_TARGET_ERROR(target, "Failed to exec RFDO %d!", res);
@@ -1744,6 +1997,10 @@ int xtensa_do_step(struct target *target, bool current, target_addr_t address,
 		return ERROR_FAIL;
 	}
 
+	res = xtensa_fetch_pending_regs(target);
+	if (res != ERROR_OK)
+		return res;
+
 	/* Save old ps (EPS[dbglvl] on LX), pc */
 	oldps = xtensa_reg_get(target, (xtensa->core_config->core_type == XT_LX) ?
 		xtensa->eps_dbglevel_idx : XT_REG_IDX_PS);
@@ -2008,6 +2265,135 @@ static bool xtensa_memory_op_validate_range(struct xtensa *xtensa, target_addr_t
 	return true;
 }
 
+/**
+ * Queues the read of @a nwords words from the aligned address @a adr, with
+ * LDDR32.P if @a fast, then executes them and checks DSR once at the end.
+ */
+static int xtensa_read_words(struct target *target, target_addr_t adr, unsigned int nwords,
+	uint8_t *buf, bool fast)
+{
+	struct xtensa *xtensa = target_to_xtensa(target);
+	int res = xtensa_fetch_pending_regs(target);
+	if (res != ERROR_OK)
+		return res;
+
+	/* We're going to use A3 here */
+	xtensa_mark_register_dirty(xtensa, XT_REG_IDX_A3);
+	/* Write start address to A3 */
+	xtensa_queue_dbg_reg_write(xtensa, XDMREG_DDR, adr);
+	xtensa_queue_exec_ins(xtensa, XT_INS_RSR(xtensa, XT_SR_DDR, XT_REG_A3));
+	if (fast) {
+		xtensa_queue_exec_ins(xtensa, XT_INS_LDDR32P(xtensa, XT_REG_A3));
+		for (unsigned int i = 0; i < nwords; i++)
+			xtensa_queue_dbg_reg_read(xtensa,
+				(i + 1 == nwords) ? XDMREG_DDR : XDMREG_DDREXEC,
+				&buf[i * sizeof(uint32_t)]);
+	} else {
+		xtensa_mark_register_dirty(xtensa, XT_REG_IDX_A4);
+		for (unsigned int i = 0; i < nwords; i++) {
+			adr += sizeof(uint32_t);
+			xtensa_queue_exec_ins(xtensa, XT_INS_L32I(xtensa, XT_REG_A3, XT_REG_A4, 0));
+			xtensa_queue_exec_ins(xtensa, XT_INS_WSR(xtensa, XT_SR_DDR, XT_REG_A4));
+			xtensa_queue_dbg_reg_read(xtensa, XDMREG_DDR, &buf[i * sizeof(uint32_t)]);
+			xtensa_queue_dbg_reg_write(xtensa, XDMREG_DDR, adr);
+			xtensa_queue_exec_ins(xtensa, XT_INS_RSR(xtensa, XT_SR_DDR, XT_REG_A3));
+		}
+	}
+
+	res = xtensa_dm_queue_execute(&xtensa->dbg_mod);
+	if (res == ERROR_OK) {
+		bool prev_suppress = xtensa->suppress_dsr_errors;
+		xtensa->suppress_dsr_errors = true;
+		res = xtensa_core_status_check(target);
+		xtensa->suppress_dsr_errors = prev_suppress;
+	}
+	return res;
+}
+
+/**
+ * Queues the write of @a nwords words to the aligned address @a adr, with
+ * SDDR32.P if @a fast, then executes them and checks DSR once at the end.
+ */
+static int xtensa_write_words(struct target *target, target_addr_t adr, unsigned int nwords,
+	const uint8_t *buf, bool fast)
+{
+	struct xtensa *xtensa = target_to_xtensa(target);
+	int res = xtensa_fetch_pending_regs(target);
+	if (res != ERROR_OK)
+		return res;
+
+	/* We're going to use A3 here */
+	xtensa_mark_register_dirty(xtensa, XT_REG_IDX_A3);
+	/* Write start address to A3 */
+	xtensa_queue_dbg_reg_write(xtensa, XDMREG_DDR, adr);
+	xtensa_queue_exec_ins(xtensa, XT_INS_RSR(xtensa, XT_SR_DDR, XT_REG_A3));
+	if (fast) {
+		for (unsigned int i = 0; i < nwords; i++) {
+			uint32_t word = buf_get_u32(&buf[i * sizeof(uint32_t)], 0, 32);
+			if (i == 0) {
+				xtensa_queue_dbg_reg_write(xtensa, XDMREG_DDR, word);
+				xtensa_queue_exec_ins(xtensa, XT_INS_SDDR32P(xtensa, XT_REG_A3));
+			} else {
+				xtensa_queue_dbg_reg_write(xtensa, XDMREG_DDREXEC, word);
+			}
+		}
+	} else {
+		xtensa_mark_register_dirty(xtensa, XT_REG_IDX_A4);
+		for (unsigned int i = 0; i < nwords; i++) {
+			adr += sizeof(uint32_t);
+			xtensa_queue_dbg_reg_write(xtensa, XDMREG_DDR,
+				buf_get_u32(&buf[i * sizeof(uint32_t)], 0, 32));
+			xtensa_queue_exec_ins(xtensa, XT_INS_RSR(xtensa, XT_SR_DDR, XT_REG_A4));
+			xtensa_queue_exec_ins(xtensa, XT_INS_S32I(xtensa, XT_REG_A3, XT_REG_A4, 0));
+			xtensa_queue_dbg_reg_write(xtensa, XDMREG_DDR, adr);
+			xtensa_queue_exec_ins(xtensa, XT_INS_RSR(xtensa, XT_SR_DDR, XT_REG_A3));
+		}
+	}
+
+	res = xtensa_dm_queue_execute(&xtensa->dbg_mod);
+	if (res == ERROR_OK) {
+		bool prev_suppress = xtensa->suppress_dsr_errors;
+		xtensa->suppress_dsr_errors = true;
+		res = xtensa_core_status_check(target);
+		xtensa->suppress_dsr_errors = prev_suppress;
+	}
+	return res;
+}
+
+/**
+ * Moves one burst with LDDR32.P/SDDR32.P when available. A failing burst is
+ * replayed with L32I/S32I, which do not depend on the DDREXEC timing: the
+ * first failure of the probe disables the fast instructions, a later one
+ * only costs the replay of this burst (e.g. on an overrun from a slow
+ * peripheral).
+ */
+static int xtensa_transfer_burst(struct target *target, target_addr_t adr, unsigned int nwords,
+	uint8_t *buf, bool write)
+{
+	struct xtensa *xtensa = target_to_xtensa(target);
+	int res = ERROR_FAIL;
+
+	if (xtensa->probe_lsddr32p != 0) {
+		res = write ? xtensa_write_words(target, adr, nwords, buf, true)
+			: xtensa_read_words(target, adr, nwords, buf, true);
+		if (res == ERROR_OK) {
+			if (xtensa->probe_lsddr32p == -1)
+				xtensa->probe_lsddr32p = 1;
+			return ERROR_OK;
+		}
+		if (xtensa->probe_lsddr32p == -1) {
+			LOG_TARGET_INFO(target, "Disabling LDDR32.P/SDDR32.P");
+			xtensa->probe_lsddr32p = 0;
+		} else {
+			LOG_TARGET_DEBUG(target, "Replaying %u words at " TARGET_ADDR_FMT " without LDDR32.P/SDDR32.P",
+				nwords, adr);
+		}
+	}
+
+	return write ? xtensa_write_words(target, adr, nwords, buf, false)
+		: xtensa_read_words(target, adr, nwords, buf, false);
+}
+
 int xtensa_read_memory(struct target *target, target_addr_t address, uint32_t size, uint32_t count, uint8_t *buffer)
 {
 	struct xtensa *xtensa = target_to_xtensa(target);
@@ -2015,9 +2401,9 @@ int xtensa_read_memory(struct target *target, target_addr_t address, uint32_t si
 	 * function expects, so we may need to allocate a temp buffer and read into that first. */
 	target_addr_t addrstart_al = ALIGN_DOWN(address, 4);
 	target_addr_t addrend_al = ALIGN_UP(address + size * count, 4);
-	target_addr_t adr = addrstart_al;
 	uint8_t *albuff;
 	bool bswap = xtensa->target->endianness == TARGET_BIG_ENDIAN;
+	int res = ERROR_OK;
 
 	if (target->state != TARGET_HALTED) {
 		LOG_TARGET_ERROR(target, "not halted");
@@ -2040,48 +2426,19 @@ int xtensa_read_memory(struct target *target, target_addr_t address, uint32_t si
 		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
 	}
 
-	/* We're going to use A3 here */
-	xtensa_mark_register_dirty(xtensa, XT_REG_IDX_A3);
-	/* Write start address to A3 */
-	xtensa_queue_dbg_reg_write(xtensa, XDMREG_DDR, addrstart_al);
-	xtensa_queue_exec_ins(xtensa, XT_INS_RSR(xtensa, XT_SR_DDR, XT_REG_A3));
-	/* Now we can safely read data from addrstart_al up to addrend_al into albuff */
-	if (xtensa->probe_lsddr32p != 0) {
-		xtensa_queue_exec_ins(xtensa, XT_INS_LDDR32P(xtensa, XT_REG_A3));
-		for (unsigned int i = 0; adr != addrend_al; i += sizeof(uint32_t), adr += sizeof(uint32_t))
-			xtensa_queue_dbg_reg_read(xtensa,
-				(adr + sizeof(uint32_t) == addrend_al) ? XDMREG_DDR : XDMREG_DDREXEC,
-				&albuff[i]);
-	} else {
-		xtensa_mark_register_dirty(xtensa, XT_REG_IDX_A4);
-		for (unsigned int i = 0; adr != addrend_al; i += sizeof(uint32_t), adr += sizeof(uint32_t)) {
-			xtensa_queue_exec_ins(xtensa, XT_INS_L32I(xtensa, XT_REG_A3, XT_REG_A4, 0));
-			xtensa_queue_exec_ins(xtensa, XT_INS_WSR(xtensa, XT_SR_DDR, XT_REG_A4));
-			xtensa_queue_dbg_reg_read(xtensa, XDMREG_DDR, &albuff[i]);
-			xtensa_queue_dbg_reg_write(xtensa, XDMREG_DDR, adr + sizeof(uint32_t));
-			xtensa_queue_exec_ins(xtensa, XT_INS_RSR(xtensa, XT_SR_DDR, XT_REG_A3));
-		}
-	}
-	int res = xtensa_dm_queue_execute(&xtensa->dbg_mod);
-	if (res == ERROR_OK) {
-		bool prev_suppress = xtensa->suppress_dsr_errors;
-		xtensa->suppress_dsr_errors = true;
-		res = xtensa_core_status_check(target);
-		if (xtensa->probe_lsddr32p == -1)
-			xtensa->probe_lsddr32p = 1;
-		xtensa->suppress_dsr_errors = prev_suppress;
-	}
-	if (res != ERROR_OK) {
-		if (xtensa->probe_lsddr32p != 0) {
-			/* Disable fast memory access instructions and retry before reporting an error */
-			LOG_TARGET_DEBUG(target, "Disabling LDDR32.P/SDDR32.P");
-			xtensa->probe_lsddr32p = 0;
-			res = xtensa_read_memory(target, address, size, count, albuff);
-			bswap = false;
-		} else {
+	/* Now we can safely read data from addrstart_al up to addrend_al into albuff,
+	 * in bursts checked once each */
+	unsigned int nwords = (addrend_al - addrstart_al) / sizeof(uint32_t);
+	for (unsigned int done = 0; done < nwords; ) {
+		unsigned int n = MIN(nwords - done, XT_MEM_BURST_WORDS);
+		res = xtensa_transfer_burst(target, addrstart_al + done * sizeof(uint32_t), n,
+			&albuff[done * sizeof(uint32_t)], false);
+		if (res != ERROR_OK) {
 			LOG_TARGET_WARNING(target, "Failed reading %d bytes at address "TARGET_ADDR_FMT,
 				count * size, address);
+			break;
 		}
+		done += n;
 	}
 
 	if (bswap)
@@ -2130,6 +2487,10 @@ int xtensa_write_memory(struct target *target,
 	if (size == 0 || count == 0 || !buffer)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
+	res = xtensa_fetch_pending_regs(target);
+	if (res != ERROR_OK)
+		return res;
+
 	/* Allocate a temporary buffer to put the aligned bytes in, if needed. */
 	if (addrstart_al == address && addrend_al == address + (size * count)) {
 		if (xtensa->target->endianness == TARGET_BIG_ENDIAN)
@@ -2209,49 +2570,20 @@ int xtensa_write_memory(struct target *target,
 	if (xtensa->target->endianness == TARGET_BIG_ENDIAN)
 		buf_bswap32(albuff, fill_head_tail ? albuff : buffer, addrend_al - addrstart_al);
 
-	/* Write start address to A3 */
-	xtensa_queue_dbg_reg_write(xtensa, XDMREG_DDR, addrstart_al);
-	xtensa_queue_exec_ins(xtensa, XT_INS_RSR(xtensa, XT_SR_DDR, XT_REG_A3));
-	/* Write the aligned buffer */
-	if (xtensa->probe_lsddr32p != 0) {
-		for (unsigned int i = 0; adr != addrend_al; i += sizeof(uint32_t), adr += sizeof(uint32_t)) {
-			if (i == 0) {
-				xtensa_queue_dbg_reg_write(xtensa, XDMREG_DDR, buf_get_u32(&albuff[i], 0, 32));
-				xtensa_queue_exec_ins(xtensa, XT_INS_SDDR32P(xtensa, XT_REG_A3));
-			} else {
-				xtensa_queue_dbg_reg_write(xtensa, XDMREG_DDREXEC, buf_get_u32(&albuff[i], 0, 32));
-			}
-		}
-	} else {
-		xtensa_mark_register_dirty(xtensa, XT_REG_IDX_A4);
-		for (unsigned int i = 0; adr != addrend_al; i += sizeof(uint32_t), adr += sizeof(uint32_t)) {
-			xtensa_queue_dbg_reg_write(xtensa, XDMREG_DDR, buf_get_u32(&albuff[i], 0, 32));
-			xtensa_queue_exec_ins(xtensa, XT_INS_RSR(xtensa, XT_SR_DDR, XT_REG_A4));
-			xtensa_queue_exec_ins(xtensa, XT_INS_S32I(xtensa, XT_REG_A3, XT_REG_A4, 0));
-			xtensa_queue_dbg_reg_write(xtensa, XDMREG_DDR, adr + sizeof(uint32_t));
-			xtensa_queue_exec_ins(xtensa, XT_INS_RSR(xtensa, XT_SR_DDR, XT_REG_A3));
-		}
+	/* Write the aligned buffer, in bursts checked once each */
+	unsigned int nwords = (addrend_al - addrstart_al) / sizeof(uint32_t);
+	for (unsigned int done = 0; done < nwords; ) {
+		unsigned int n = MIN(nwords - done, XT_MEM_BURST_WORDS);
+		res = xtensa_transfer_burst(target, addrstart_al + done * sizeof(uint32_t), n,
+			&albuff[done * sizeof(uint32_t)], true);
+		if (res != ERROR_OK)
+			break;
+		done += n;
 	}
 
-	res = xtensa_dm_queue_execute(&xtensa->dbg_mod);
-	if (res == ERROR_OK) {
-		bool prev_suppress = xtensa->suppress_dsr_errors;
-		xtensa->suppress_dsr_errors = true;
-		res = xtensa_core_status_check(target);
-		if (xtensa->probe_lsddr32p == -1)
-			xtensa->probe_lsddr32p = 1;
-		xtensa->suppress_dsr_errors = prev_suppress;
-	}
 	if (res != ERROR_OK) {
-		if (xtensa->probe_lsddr32p != 0) {
-			/* Disable fast memory access instructions and retry before reporting an error */
-			LOG_TARGET_INFO(target, "Disabling LDDR32.P/SDDR32.P");
-			xtensa->probe_lsddr32p = 0;
-			res = xtensa_write_memory(target, address, size, count, buffer);
-		} else {
-			LOG_TARGET_WARNING(target, "Failed writing %d bytes at address "TARGET_ADDR_FMT,
-				count * size, address);
-		}
+		LOG_TARGET_WARNING(target, "Failed writing %d bytes at address "TARGET_ADDR_FMT,
+			count * size, address);
 	} else {
 		/* Invalidate ICACHE, writeback DCACHE if present */
 		bool issue_ihi = xtensa_is_icacheable(xtensa, address) &&
@@ -2314,6 +2646,36 @@ int xtensa_checksum_memory(struct target *target, target_addr_t address, uint32_
 	return ERROR_FAIL;
 }
 
+/**
+ * Stands in for the fetch on halt of a core with defer_halt_fetch set: only
+ * DEBUGCAUSE is read, A3 is swapped back from DDR so that the fetch done later
+ * by xtensa_fetch_pending_regs() finds the core as it stopped.
+ */
+static int xtensa_fetch_halt_cause(struct target *target)
+{
+	struct xtensa *xtensa = target_to_xtensa(target);
+	uint8_t cause_buf[4];
+
+	/* NX takes its stop cause from DSR, but sets PS.DIEXC from the cache on halt */
+	if (xtensa->core_config->core_type != XT_LX)
+		return xtensa_fetch_all_regs(target);
+
+	xtensa_queue_exec_ins(xtensa, XT_INS_WSR(xtensa, XT_SR_DDR, XT_REG_A3));
+	xtensa_queue_exec_ins(xtensa, XT_INS_RSR(xtensa, xtensa_regs[XT_REG_IDX_DEBUGCAUSE].reg_num, XT_REG_A3));
+	xtensa_queue_exec_ins(xtensa, XT_INS_XSR(xtensa, XT_SR_DDR, XT_REG_A3));
+	xtensa_queue_dbg_reg_read(xtensa, XDMREG_DDR, cause_buf);
+	int res = xtensa_dm_queue_execute(&xtensa->dbg_mod);
+	if (res == ERROR_OK)
+		res = xtensa_core_status_check(target);
+	if (res != ERROR_OK) {
+		LOG_TARGET_DEBUG(target, "Failed to read DEBUGCAUSE (%d), fetching all registers", res);
+		return xtensa_fetch_all_regs(target);
+	}
+	xtensa->pending_cause = buf_get_u32(cause_buf, 0, 32);
+	xtensa->regs_pending = true;
+	return ERROR_OK;
+}
+
 int xtensa_poll(struct target *target)
 {
 	struct xtensa *xtensa = target_to_xtensa(target);
@@ -2355,6 +2717,8 @@ int xtensa_poll(struct target *target)
 			"DSR has changed: was 0x%08" PRIx32 " now 0x%08" PRIx32,
 			prev_dsr,
 			xtensa->dbg_mod.core_status.dsr);
+	if (!xtensa_is_stopped(target))
+		xtensa->regs_pending = false;
 	if (xtensa->dbg_mod.power_status.stath & PWRSTAT_COREWASRESET(xtensa)) {
 		/* if RESET state is persitent  */
 		target->state = TARGET_RESET;
@@ -2373,7 +2737,10 @@ int xtensa_poll(struct target *target)
 			target->state = TARGET_HALTED;
 			/* Examine why the target has been halted */
 			target->debug_reason = DBG_REASON_DBGRQ;
-			xtensa_fetch_all_regs(target);
+			if (xtensa->defer_halt_fetch)
+				xtensa_fetch_halt_cause(target);
+			else
+				xtensa_fetch_all_regs(target);
 			/* When setting debug reason DEBUGCAUSE events have the following
 			 * priorities: watchpoint == breakpoint > single step > debug interrupt. */
 			/* Watchpoint and breakpoint events at the same time results in special
@@ -2390,15 +2757,25 @@ int xtensa_poll(struct target *target)
 			} else if (halt_cause & DEBUGCAUSE_DB) {
 				target->debug_reason = DBG_REASON_WATCHPOINT;
 			}
-			LOG_TARGET_DEBUG(target, "Target halted, pc=0x%08" PRIx32
-				", debug_reason=%08" PRIx32 ", oldstate=%08" PRIx32,
-				xtensa_reg_get(target, XT_REG_IDX_PC),
-				target->debug_reason,
-				oldstate);
-			LOG_TARGET_DEBUG(target, "Halt reason=0x%08" PRIX32 ", exc_cause=%" PRId32 ", dsr=0x%08" PRIx32,
-				halt_cause,
-				xtensa_reg_get(target, XT_REG_IDX_EXCCAUSE),
-				xtensa->dbg_mod.core_status.dsr);
+			if (xtensa->regs_pending) {
+				LOG_TARGET_DEBUG(target, "Target halted, debug_reason=%08" PRIx32
+					", oldstate=%08" PRIx32 ", registers not fetched yet",
+					target->debug_reason,
+					oldstate);
+				LOG_TARGET_DEBUG(target, "Halt reason=0x%08" PRIX32 ", dsr=0x%08" PRIx32,
+					halt_cause,
+					xtensa->dbg_mod.core_status.dsr);
+			} else {
+				LOG_TARGET_DEBUG(target, "Target halted, pc=0x%08" PRIx32
+					", debug_reason=%08" PRIx32 ", oldstate=%08" PRIx32,
+					xtensa_reg_get(target, XT_REG_IDX_PC),
+					target->debug_reason,
+					oldstate);
+				LOG_TARGET_DEBUG(target, "Halt reason=0x%08" PRIX32 ", exc_cause=%" PRId32 ", dsr=0x%08" PRIx32,
+					halt_cause,
+					xtensa_reg_get(target, XT_REG_IDX_EXCCAUSE),
+					xtensa->dbg_mod.core_status.dsr);
+			}
 			xtensa_dm_core_status_clear(
 				&xtensa->dbg_mod,
 				OCDDSR_DEBUGPENDBREAK | OCDDSR_DEBUGINTBREAK | OCDDSR_DEBUGPENDTRAX |
@@ -2464,6 +2841,9 @@ static int xtensa_update_instruction(struct target *target, target_addr_t addres
 		return ERROR_FAIL;
 
 	if (issue_ihi || issue_dhwbi) {
+		ret = xtensa_fetch_pending_regs(target);
+		if (ret != ERROR_OK)
+			return ret;
 		/* We're going to use A3 here */
 		xtensa_mark_register_dirty(xtensa, XT_REG_IDX_A3);
 
@@ -2662,6 +3042,10 @@ int xtensa_watchpoint_add(struct target *target, struct watchpoint *watchpoint)
 		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
 	}
 
+	int res = xtensa_fetch_pending_regs(target);
+	if (res != ERROR_OK)
+		return res;
+
 	for (slot = 0; slot < xtensa->core_config->debug.dbreaks_num; slot++) {
 		if (!xtensa->hw_wps[slot] || xtensa->hw_wps[slot] == watchpoint)
 			break;
@@ -2715,6 +3099,9 @@ int xtensa_watchpoint_remove(struct target *target, struct watchpoint *watchpoin
 		LOG_TARGET_WARNING(target, "HW watchpoint " TARGET_ADDR_FMT " not found!", watchpoint->address);
 		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
 	}
+	int res = xtensa_fetch_pending_regs(target);
+	if (res != ERROR_OK)
+		return res;
 	xtensa_reg_set(target, XT_REG_IDX_DBREAKC0 + slot, 0);
 	xtensa->hw_wps[slot] = NULL;
 	LOG_TARGET_DEBUG(target, "cleared HW watchpoint @ " TARGET_ADDR_FMT,
@@ -2742,6 +3129,11 @@ int xtensa_start_algorithm(struct target *target,
 		return ERROR_TARGET_NOT_HALTED;
 	}
 
+	/* the whole context is saved and restored */
+	retval = xtensa_fetch_deferred_regs(target);
+	if (retval != ERROR_OK)
+		return retval;
+
 	for (unsigned int i = 0; i < xtensa->core_cache->num_regs; i++) {
 		struct reg *reg = &xtensa->core_cache->reg_list[i];
 		buf_cpy(reg->value, xtensa->algo_context_backup[i], reg->size);
@@ -2847,6 +3239,10 @@ int xtensa_wait_algorithm(struct target *target,
 		LOG_ERROR("failed algorithm halted at 0x%" PRIx32 ", expected " TARGET_ADDR_FMT, pc, exit_point);
 		return ERROR_TARGET_TIMEOUT;
 	}
+	/* the registers the algorithm changed are compared with the saved context below */
+	retval = xtensa_fetch_deferred_regs(target);
+	if (retval != ERROR_OK)
+		LOG_TARGET_ERROR(target, "Failed to fetch deferred regs, context not fully restored");
 	/* Copy core register values to reg_params[] */
 	for (int i = 0; i < num_reg_params; i++) {
 		if (reg_params[i].direction != PARAM_OUT) {
@@ -286,6 +286,10 @@ struct xtensa {
 	uint32_t nx_reg_idx[XT_NX_REG_IDX_NUM];
 	struct xtensa_keyval_info scratch_ars[XT_AR_SCRATCH_NUM];
 	bool regs_fetched;	/* true after first register fetch completed successfully */
+	bool regs_deferred;	/* true while registers left out of the fetch on halt are unread */
+	bool defer_halt_fetch;	/* on halt read only the stop cause, the registers on first access */
+	bool regs_pending;	/* true while halted with the fetch on halt still to do */
+	uint32_t pending_cause;	/* DEBUGCAUSE read on halt while regs_pending */
 };
 
 static inline struct xtensa *target_to_xtensa(struct target *target)
@@ -367,6 +371,8 @@ xtensa_reg_val_t xtensa_reg_get(struct target *target, enum xtensa_reg_id reg_id
 void xtensa_reg_set(struct target *target, enum xtensa_reg_id reg_id, xtensa_reg_val_t value);
 void xtensa_reg_set_deep_relgen(struct target *target, enum xtensa_reg_id a_idx, xtensa_reg_val_t value);
 int xtensa_fetch_all_regs(struct target *target);
+int xtensa_fetch_regs(struct target *target, struct reg **reg_list, int reg_list_size);
+int xtensa_fetch_pending_regs(struct target *target);
 int xtensa_get_gdb_reg_list(struct target *target,
 	struct reg **reg_list[],
 	int *reg_list_size,
@@ -377,6 +383,7 @@ void xtensa_cause_reset(struct target *target);
 int xtensa_poll(struct target *target);
 void xtensa_on_poll(struct target *target);
 int xtensa_halt(struct target *target);
+void xtensa_queue_halt(struct target *target);
 int xtensa_resume(struct target *target,
 	bool current,
 	target_addr_t address,
@@ -388,6 +395,7 @@ int xtensa_prepare_resume(struct target *target,
 	bool handle_breakpoints,
 	bool debug_execution);
 int xtensa_do_resume(struct target *target);
+void xtensa_queue_resume(struct target *target);
 int xtensa_step(struct target *target, bool current, target_addr_t address,
 		bool handle_breakpoints);
 int xtensa_do_step(struct target *target, bool current, target_addr_t address,
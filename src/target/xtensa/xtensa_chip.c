@@ -173,6 +173,7 @@ struct target_type xtensa_chip_target = {
 	.checksum_memory = xtensa_checksum_memory,
 
 	.get_gdb_reg_list = xtensa_get_gdb_reg_list,
+	.fetch_regs = xtensa_fetch_regs,
 
 	.run_algorithm = xtensa_run_algorithm,
 	.start_algorithm = xtensa_start_algorithm,
@@ -166,10 +166,7 @@ int xtensa_dm_queue_reg_read(struct xtensa_debug_module *dm, enum xtensa_dm_reg
 		return ERROR_FAIL;
 	}
 	if (dm->dap)
-		/* NOTE: Future optimization: mem_ap_read_u32() offers higher performance with
-		 * queued reads, but requires an API change to pass value as a 32-bit pointer.
-		 */
-		return mem_ap_read_buf(dm->debug_ap, value, 4, 1, xdm_regs[reg].apb + dm->ap_offset);
+		return mem_ap_read_buf_queued(dm->debug_ap, value, 4, 1, xdm_regs[reg].apb + dm->ap_offset);
 	uint8_t regdata = (xdm_regs[reg].nar << 1) | 0;
 	uint8_t dummy[4] = { 0, 0, 0, 0 };
 	xtensa_dm_add_set_ir(dm, TAPINS_NARSEL);
@@ -204,11 +201,8 @@ int xtensa_dm_queue_pwr_reg_read(struct xtensa_debug_module *dm,
 		return ERROR_FAIL;
 	}
 	if (dm->dap) {
-		/* NOTE: Future optimization: mem_ap_read_u32() offers higher performance with
-		 * queued reads, but requires an API change to pass value as a 32-bit pointer.
-		 */
 		uint32_t apbreg = xdm_pwr_regs[reg].apb + dm->ap_offset;
-		int retval = mem_ap_read_buf(dm->debug_ap, data, 4, 1, apbreg);
+		int retval = mem_ap_read_buf_queued(dm->debug_ap, data, 4, 1, apbreg);
 		if (retval == ERROR_OK)
 			retval = mem_ap_write_u32(dm->debug_ap, apbreg, clear);
 		return retval;
@@ -274,17 +268,22 @@ int xtensa_dm_power_status_read(struct xtensa_debug_module *dm, uint32_t clear)
 	return res;
 }
 
-int xtensa_dm_core_status_read(struct xtensa_debug_module *dm)
+void xtensa_dm_queue_core_status_read(struct xtensa_debug_module *dm, uint8_t *dsr_buf)
 {
-	uint8_t dsr_buf[sizeof(uint32_t)];
-
 	xtensa_dm_queue_enable(dm);
 	dm->dbg_ops->queue_reg_read(dm, XDMREG_DSR, dsr_buf);
 	xtensa_dm_queue_tdi_idle(dm);
+}
+
+int xtensa_dm_core_status_read(struct xtensa_debug_module *dm)
+{
+	uint8_t dsr_buf[sizeof(uint32_t)];
+
+	xtensa_dm_queue_core_status_read(dm, dsr_buf);
 	int res = xtensa_dm_queue_execute(dm);
 	if (res != ERROR_OK)
 		return res;
-	dm->core_status.dsr = buf_get_u32(dsr_buf, 0, 32);
+	xtensa_dm_core_status_update(dm, dsr_buf);
 	return res;
 }
 
@@ -544,6 +544,8 @@ static inline xtensa_pwrstat_t xtensa_dm_power_status_get(struct xtensa_debug_mo
 }
 
 int xtensa_dm_core_status_read(struct xtensa_debug_module *dm);
+/* Queued half of xtensa_dm_core_status_read(), for reading DSR of several cores at once */
+void xtensa_dm_queue_core_status_read(struct xtensa_debug_module *dm, uint8_t *dsr_buf);
 int xtensa_dm_core_status_clear(struct xtensa_debug_module *dm, xtensa_dsr_t bits);
 int xtensa_dm_core_status_check(struct xtensa_debug_module *dm);
 static inline xtensa_dsr_t xtensa_dm_core_status_get(struct xtensa_debug_module *dm)
@@ -551,6 +553,11 @@ static inline xtensa_dsr_t xtensa_dm_core_status_get(struct xtensa_debug_module
 	return dm->core_status.dsr;
 }
 
+static inline void xtensa_dm_core_status_update(struct xtensa_debug_module *dm, const uint8_t *dsr_buf)
+{
+	dm->core_status.dsr = buf_get_u32(dsr_buf, 0, 32);
+}
+
 int xtensa_dm_read(struct xtensa_debug_module *dm, uint32_t addr, uint32_t *val);
 int xtensa_dm_write(struct xtensa_debug_module *dm, uint32_t addr, uint32_t val);
 
@@ -47,6 +47,10 @@ int xtensa_fileio_detect_proc(struct target *target)
 	if ((dbg_cause & (DEBUGCAUSE_BI | DEBUGCAUSE_BN)) == 0 || xtensa->halt_request)
 		return ERROR_FAIL;
 
+	retval = xtensa_fetch_pending_regs(target);
+	if (retval != ERROR_OK)
+		return retval;
+
 	uint8_t brk_insn_buf[sizeof(uint32_t)] = {0};
 	xtensa_reg_val_t pc = xtensa_reg_get(target, XT_REG_IDX_PC);
 	retval = target_read_memory(target,
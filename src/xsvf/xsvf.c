@@ -175,17 +175,42 @@ static enum tap_state xsvf_to_tap(int xsvf_state)
 
 static int xsvf_read_buffer(int num_bits, int fd, uint8_t *buf)
 {
-	int num_bytes;
+	int num_bytes = (num_bits + 7) / 8;
+	int got = 0;
 
-	for (num_bytes = (num_bits + 7) / 8; num_bytes > 0; num_bytes--) {
-		/* reverse the order of bytes as they are read sequentially from file */
-		if (read(fd, buf + num_bytes - 1, 1) < 0)
+	/* one read for the whole vector, not a system call per byte */
+	while (got < num_bytes) {
+		ssize_t ret = read(fd, buf + got, num_bytes - got);
+		if (ret < 0)
 			return ERROR_XSVF_EOF;
+		if (ret == 0)
+			break;
+		got += ret;
+	}
+
+	/* reverse the order of bytes as they are read sequentially from file */
+	for (int i = 0; i < num_bytes / 2; i++) {
+		uint8_t tmp = buf[i];
+		buf[i] = buf[num_bytes - 1 - i];
+		buf[num_bytes - 1 - i] = tmp;
 	}
 
 	return ERROR_OK;
 }
 
+/* True when no TDO bit is compared, the bits past num_bits included */
+static bool xsvf_mask_is_zero(const uint8_t *mask, int num_bits)
+{
+	if (!mask)
+		return false;
+
+	for (int i = 0; i < (num_bits + 7) / 8; i++)
+		if (mask[i])
+			return false;
+
+	return true;
+}
+
 COMMAND_HANDLER(handle_xsvf_command)
 {
 	uint8_t *dr_out_buf = NULL;				/* from host to device (TDI) */
@@ -215,6 +240,9 @@ COMMAND_HANDLER(handle_xsvf_command)
 	int result;
 	int verbose = 1;
 
+	/* scans queued without flush, their errors are not known yet */
+	bool pending = false;
+
 	bool collecting_path = false;
 	enum tap_state path[XSTATE_MAX_PATH];
 	unsigned int pathlen = 0;
@@ -438,6 +466,37 @@ COMMAND_HANDLER(handle_xsvf_command)
 
 				LOG_DEBUG("%s %d", op_name, xsdrsize);
 
+				if (xsvf_mask_is_zero(dr_in_mask, xsdrsize)) {
+					/* No TDO bit to compare, so no retry either: queue
+					 * the scan and go on without waiting for it.
+					 */
+					struct scan_field field;
+
+					field.num_bits = xsdrsize;
+					field.out_value = dr_out_buf;
+					field.in_value = NULL;
+
+					if (!tap)
+						jtag_add_plain_dr_scan(field.num_bits,
+								field.out_value, NULL, TAP_DRPAUSE);
+					else
+						jtag_add_dr_scan(tap, 1, &field, TAP_DRPAUSE);
+
+					pending = true;
+					matched = 1;
+					limit = 0;
+				} else if (pending) {
+					/* a failure of the queued scans must not be taken for
+					 * a mismatch of this one, and retried
+					 */
+					pending = false;
+					result = jtag_execute_queue();
+					if (result != ERROR_OK) {
+						tdo_mismatch = 1;
+						break;
+					}
+				}
+
 				for (attempt = 0; attempt < limit; ++attempt) {
 					struct scan_field field;
 
@@ -701,12 +760,19 @@ COMMAND_HANDLER(handle_xsvf_command)
 					/* Note that an -irmask of non-zero in your config file
 					 * can cause this to fail.  Setting -irmask to zero cand work
 					 * around the problem.
+					 *
+					 * Without capture check (plain scan or verify_ircapture
+					 * disabled) there is nothing to wait for.
 					 */
-
-					/* LOG_DEBUG("FLUSHING QUEUE"); */
-					result = jtag_execute_queue();
-					if (result != ERROR_OK)
-						tdo_mismatch = 1;
+					if (tap && jtag_will_verify_capture_ir()) {
+						/* LOG_DEBUG("FLUSHING QUEUE"); */
+						pending = false;
+						result = jtag_execute_queue();
+						if (result != ERROR_OK)
+							tdo_mismatch = 1;
+					} else {
+						pending = true;
+					}
 				}
 				free(ir_buf);
 			}
@@ -901,6 +967,16 @@ COMMAND_HANDLER(handle_xsvf_command)
 				if (limit < 1)
 					limit = 1;
 
+				if (pending) {
+					/* see XSDRTDO */
+					pending = false;
+					result = jtag_execute_queue();
+					if (result != ERROR_OK) {
+						tdo_mismatch = 1;
+						break;
+					}
+				}
+
 				for (attempt = 0; attempt < limit; ++attempt) {
 					struct scan_field field;
 
@@ -993,6 +1069,11 @@ COMMAND_HANDLER(handle_xsvf_command)
 		}
 	}
 
+	/* files that end without XCOMPLETE leave the last scans queued */
+	if (pending && !do_abort && !unsupported && !tdo_mismatch &&
+			jtag_execute_queue() != ERROR_OK)
+		tdo_mismatch = 1;
+
 	if (tdo_mismatch) {
 		command_print(CMD,
 			"TDO mismatch, somewhere near offset %lu in xsvf file, aborting",
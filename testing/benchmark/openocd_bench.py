@@ -0,0 +1,360 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+"""
+OpenOCD benchmark suite.
+
+Drives a running OpenOCD through the TCL RPC server (and its GDB port for the
+GDB benchmarks), measures the speed of the usual debug operations and writes
+the results as JSON, so runs on different releases or probes can be compared.
+
+The target must be halted and have RAM at the address given with --ram.
+Benchmarks which do not apply (no GDB port, no flash image, no RTOS, no RTT
+channel) are reported as skipped.
+
+    openocd -f testing/benchmark/sim.cfg &
+    ./openocd_bench.py --sim --output results.json
+    ./openocd_bench.py --sim --baseline results.json
+
+With --baseline, the results are compared with a previous run and the exit
+status is 1 when a value got worse by more than --tolerance percent.
+"""
+
+import argparse
+import json
+import socket
+import sys
+import time
+
+
+class OpenOcd:
+    COMMAND_TOKEN = '\x1a'
+
+    def __init__(self, host, port):
+        self.sock = socket.create_connection((host, port))
+
+    def close(self):
+        try:
+            self.send("exit")
+        finally:
+            self.sock.close()
+
+    def send(self, cmd):
+        """Send a command to TCL RPC, return its output."""
+        self.sock.sendall((cmd + OpenOcd.COMMAND_TOKEN).encode("utf-8"))
+        data = bytes()
+        token = OpenOcd.COMMAND_TOKEN.encode("utf-8")
+        while not data.endswith(token):
+            chunk = self.sock.recv(4096)
+            if not chunk:
+                raise ConnectionError("OpenOCD closed the TCL RPC connection")
+            data += chunk
+        return data[:-1].decode("utf-8").strip()
+
+    def timed_ms(self, script, iterations=1):
+        """Run a TCL script inside OpenOCD, return the mean time in ms.
+
+        Timing is done by OpenOCD itself, so the RPC round trips and the
+        transfer of the results are not part of the measurement.
+        """
+        reply = self.send("set _b [ms]; for {set _i 0} {$_i < %d} {incr _i} { %s }; "
+                          "expr {[ms] - $_b}" % (iterations, script))
+        return int(reply.split()[-1]) / iterations
+
+
+class Gdb:
+    """Minimal GDB remote protocol client."""
+
+    def __init__(self, host, port, timeout=10.0):
+        self.sock = socket.create_connection((host, port), timeout=timeout)
+        self.buf = bytes()
+
+    def close(self):
+        try:
+            self.sock.sendall(b"$D#44")
+        finally:
+            self.sock.close()
+
+    def _byte(self):
+        while not self.buf:
+            chunk = self.sock.recv(4096)
+            if not chunk:
+                raise ConnectionError("OpenOCD closed the GDB connection")
+            self.buf += chunk
+        b, self.buf = self.buf[:1], self.buf[1:]
+        return b
+
+    def packet(self, payload):
+        """Send a packet, return the reply, skipping console output."""
+        data = payload.encode("latin-1")
+        frame = b"$" + data + b"#%02x" % (sum(data) & 0xff)
+        self.sock.sendall(frame)
+        while True:
+            b = self._byte()
+            if b == b"-":
+                self.sock.sendall(frame)
+            if b != b"$":
+                continue
+            reply = bytes()
+            while True:
+                b = self._byte()
+                if b == b"#":
+                    break
+                reply += b
+            self._byte()
+            self._byte()
+            self.sock.sendall(b"+")
+            reply = reply.decode("latin-1")
+            # 'O' output packets come before the actual reply
+            if reply.startswith("O") and reply != "OK":
+                continue
+            return reply
+
+
+class Skip(Exception):
+    pass
+
+
+class Bench:
+    def __init__(self, args):
+        self.args = args
+        self.ocd = OpenOcd(args.host, args.tcl_port)
+        self.results = {}
+        self.skipped = {}
+
+    def record(self, name, value, unit, higher_is_better, **extra):
+        result = {"value": round(value, 3), "unit": unit,
+                  "higher_is_better": higher_is_better}
+        result.update(extra)
+        self.results[name] = result
+        print("%-24s %12.3f %s" % (name, value, unit), file=sys.stderr)
+
+    def run(self, name, func):
+        if self.args.only and name not in self.args.only:
+            return
+        if self.args.sim:
+            self.ocd.send("dummy stats clear")
+        try:
+            func(name)
+        except Skip as e:
+            self.skipped[name] = str(e)
+            print("%-24s skipped: %s" % (name, e), file=sys.stderr)
+            return
+        if self.args.sim and name in self.results:
+            stats = self.ocd.send("dummy stats")
+            for line in stats.splitlines():
+                if line.startswith("queue runs:"):
+                    self.results[name]["queue_runs"] = int(line.split(":")[1])
+
+    def gdb(self):
+        port = self.ocd.send("[target current] cget -gdb-port")
+        if not port.isdigit():
+            raise Skip("target has no GDB TCP port (%s)" % port)
+        return Gdb(self.args.host, int(port))
+
+    # memory
+
+    def mem_read(self, name):
+        count = self.args.size // 4
+        ms = self.ocd.timed_ms("read_memory 0x%x 32 %d" % (self.args.ram, count),
+                               self.args.iterations)
+        if ms <= 0:
+            raise Skip("too fast to measure, increase --size")
+        self.record(name, self.args.size / ms / 1000, "MB/s", True)
+
+    def mem_write(self, name):
+        count = self.args.size // 4
+        self.ocd.send("set _d [lrepeat %d 0x5a5aa5a5]" % count)
+        ms = self.ocd.timed_ms("write_memory 0x%x 32 $_d" % self.args.ram,
+                               self.args.iterations)
+        if ms <= 0:
+            raise Skip("too fast to measure, increase --size")
+        self.record(name, self.args.size / ms / 1000, "MB/s", True)
+
+    def mem_word_latency(self, name):
+        ms = self.ocd.timed_ms("read_memory 0x%x 32 1" % self.args.ram, 100)
+        self.record(name, ms, "ms", False)
+
+    # flash
+
+    def flash_program(self, name):
+        if not self.args.flash_image:
+            raise Skip("no --flash-image")
+        ms = self.ocd.timed_ms("flash write_image erase {%s} 0x%x" %
+                               (self.args.flash_image, self.args.flash_address))
+        self.record(name, ms, "ms", False)
+
+    def flash_verify(self, name):
+        if not self.args.flash_image:
+            raise Skip("no --flash-image")
+        ms = self.ocd.timed_ms("verify_image {%s} 0x%x" %
+                               (self.args.flash_image, self.args.flash_address))
+        self.record(name, ms, "ms", False)
+
+    # GDB
+
+    def gdb_attach(self, name):
+        start = time.perf_counter()
+        gdb = self.gdb()
+        try:
+            # what GDB sends before showing the prompt
+            gdb.packet("qSupported:multiprocess+;swbreak+;hwbreak+;qRelocInsn+")
+            gdb.packet("?")
+            gdb.packet("qfThreadInfo")
+            gdb.packet("g")
+            self.record(name, (time.perf_counter() - start) * 1000, "ms", False)
+        finally:
+            gdb.close()
+
+    def gdb_g(self, name):
+        gdb = self.gdb()
+        try:
+            gdb.packet("?")
+            start = time.perf_counter()
+            for _ in range(self.args.iterations * 10):
+                gdb.packet("g")
+            elapsed = time.perf_counter() - start
+            self.record(name, elapsed * 1000 / (self.args.iterations * 10), "ms", False)
+        finally:
+            gdb.close()
+
+    def gdb_step(self, name):
+        gdb = self.gdb()
+        try:
+            gdb.packet("?")
+            steps = self.args.iterations * 10
+            start = time.perf_counter()
+            for _ in range(steps):
+                reply = gdb.packet("s")
+                if not reply.startswith(("S", "T")):
+                    raise Skip("step failed: %s" % reply)
+            self.record(name, steps / (time.perf_counter() - start), "steps/s", True)
+        finally:
+            gdb.close()
+
+    def rtos_refresh(self, name):
+        gdb = self.gdb()
+        try:
+            gdb.packet("?")
+            start = time.perf_counter()
+            threads = []
+            reply = gdb.packet("qfThreadInfo")
+            while reply.startswith("m"):
+                threads += reply[1:].split(",")
+                reply = gdb.packet("qsThreadInfo")
+            if len(threads) < 2:
+                raise Skip("no RTOS threads")
+            # what GDB asks for 'info threads'
+            for thread in threads:
+                gdb.packet("qThreadExtraInfo," + thread)
+            self.record(name, (time.perf_counter() - start) * 1000, "ms", False,
+                        threads=len(threads))
+        finally:
+            gdb.close()
+
+    # RTT
+
+    def rtt(self, name):
+        if not self.args.rtt_port:
+            raise Skip("no --rtt-port")
+        sock = socket.create_connection((self.args.host, self.args.rtt_port), timeout=1.0)
+        received = 0
+        end = time.perf_counter() + self.args.rtt_seconds
+        try:
+            while time.perf_counter() < end:
+                try:
+                    received += len(sock.recv(65536))
+                except socket.timeout:
+                    pass
+        finally:
+            sock.close()
+        self.record(name, received / self.args.rtt_seconds / 1000, "kB/s", True)
+
+    def run_all(self):
+        self.run("mem_read", self.mem_read)
+        self.run("mem_write", self.mem_write)
+        self.run("mem_word_latency", self.mem_word_latency)
+        self.run("flash_program", self.flash_program)
+        self.run("flash_verify", self.flash_verify)
+        self.run("gdb_attach", self.gdb_attach)
+        self.run("gdb_g_latency", self.gdb_g)
+        self.run("gdb_step_rate", self.gdb_step)
+        self.run("rtos_refresh", self.rtos_refresh)
+        self.run("rtt_throughput", self.rtt)
+
+    def report(self):
+        return {
+            "openocd": self.ocd.send("version"),
+            "adapter": self.ocd.send("adapter name"),
+            "transport": self.ocd.send("transport select"),
+            "speed_khz": self.ocd.send("adapter speed"),
+            "target": self.ocd.send("target current"),
+            "time": time.strftime("%Y-%m-%dT%H:%M:%S%z"),
+            "results": self.results,
+            "skipped": self.skipped,
+        }
+
+
+def compare(report, baseline, tolerance):
+    """Print the change of every result, return the number of regressions."""
+    regressions = 0
+    for name, result in sorted(report["results"].items()):
+        old = baseline.get("results", {}).get(name)
+        if not old or not old["value"]:
+            continue
+        change = (result["value"] - old["value"]) * 100 / old["value"]
+        worse = -change if result["higher_is_better"] else change
+        status = "REGRESSION" if worse > tolerance else "ok"
+        if worse > tolerance:
+            regressions += 1
+        print("%-24s %12.3f -> %12.3f %s %+7.1f%% %s" % (name, old["value"],
+              result["value"], result["unit"], change, status), file=sys.stderr)
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description="OpenOCD benchmark suite")
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--tcl-port", type=int, default=6666)
+    parser.add_argument("--ram", type=lambda x: int(x, 0), default=0x20000000,
+                        help="address of target RAM used by the memory benchmarks")
+    parser.add_argument("--size", type=lambda x: int(x, 0), default=0x4000,
+                        help="bytes per memory transfer")
+    parser.add_argument("--iterations", type=int, default=10)
+    parser.add_argument("--flash-image", help="image for the flash benchmarks")
+    parser.add_argument("--flash-address", type=lambda x: int(x, 0), default=0)
+    parser.add_argument("--rtt-port", type=int, help="TCP port of an RTT channel")
+    parser.add_argument("--rtt-seconds", type=float, default=5.0)
+    parser.add_argument("--sim", action="store_true",
+                        help="record the SWD queue runs of the dummy adapter")
+    parser.add_argument("--only", action="append", help="run this benchmark only")
+    parser.add_argument("--output", help="write the JSON report to this file")
+    parser.add_argument("--baseline", help="JSON report to compare with")
+    parser.add_argument("--tolerance", type=float, default=10.0,
+                        help="percent a result may get worse before it is a regression")
+    args = parser.parse_args()
+
+    bench = Bench(args)
+    try:
+        bench.run_all()
+        report = bench.report()
+    finally:
+        bench.ocd.close()
+
+    text = json.dumps(report, indent=2, sort_keys=True)
+    if args.output:
+        with open(args.output, "w") as f:
+            f.write(text + "\n")
+    else:
+        print(text)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        if compare(report, baseline, args.tolerance):
+            return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())